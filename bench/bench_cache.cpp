@@ -0,0 +1,140 @@
+#include "mimir/cache.h"
+#include <benchmark/benchmark.h>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    constexpr int KEY_COUNT = 10000;
+
+    std::unique_ptr<mimir::Cache> sharedCache;
+    std::vector<std::string> keys;
+
+    /**
+    * @brief Mixed needsRebuild / setSignature traffic against one shared cache
+    * @details range(0) is the shard count (1 reproduces a single global lock),
+    *          range(1) the percentage of operations that write.
+    */
+    void BM_CacheMixed(benchmark::State& state)
+    {
+        const std::string cacheDir = (fs::temp_directory_path() / "mimir_bench_cache").string();
+        if (state.thread_index() == 0)
+        {
+            sharedCache = std::make_unique<mimir::Cache>(cacheDir, static_cast<size_t>(state.range(0)));
+            keys.clear();
+            for (int i = 0; i < KEY_COUNT; ++i)
+            {
+                keys.push_back("target_" + std::to_string(i));
+                sharedCache->setSignature(keys.back(), "signature");
+            }
+        }
+
+        const auto writePercent = static_cast<std::uint32_t>(state.range(1));
+        std::uint32_t rng = 0x9E3779B9u * static_cast<std::uint32_t>(state.thread_index() + 1);
+        for (auto _ : state)
+        {
+            rng ^= rng << 13;
+            rng ^= rng >> 17;
+            rng ^= rng << 5;
+            const std::string& key = keys[rng % KEY_COUNT];
+            if (rng / KEY_COUNT % 100 < writePercent)
+            {
+                sharedCache->setSignature(key, "updated");
+            }
+            else
+            {
+                benchmark::DoNotOptimize(sharedCache->needsRebuild(key, "signature"));
+            }
+        }
+
+        state.SetItemsProcessed(state.iterations());
+        if (state.thread_index() == 0)
+        {
+            sharedCache.reset();
+            fs::remove_all(cacheDir);
+        }
+    }
+
+    /**
+    * @brief Fill a cache the way a build of targetCount targets with one input each would
+    * @param cache Cache to fill
+    * @param targetCount Number of targets
+    */
+    void populate(mimir::Cache& cache, const std::int64_t targetCount)
+    {
+        const std::string hash(64, 'a');
+        for (std::int64_t i = 0; i < targetCount; ++i)
+        {
+            const std::string name = "target_" + std::to_string(i);
+            cache.setSignature(name, hash);
+            cache.setDuration(name, static_cast<std::uint64_t>(i));
+            mimir::FileRecord record;
+            record.stamp.size = static_cast<std::uint64_t>(i);
+            record.stamp.mtimeNs = i;
+            record.hash = hash;
+            cache.setFileRecord("src/file_" + std::to_string(i) + ".c", record);
+        }
+    }
+
+    /**
+    * @brief Write a full cache snapshot
+    * @details range(0) is the number of targets, range(1) the CacheFormat
+    *          (0 for binary, 1 for text).
+    */
+    void BM_CacheSave(benchmark::State& state)
+    {
+        const std::string cacheDir = (fs::temp_directory_path() / "mimir_bench_cache_save").string();
+        mimir::Cache cache(cacheDir);
+        cache.setFormat(static_cast<mimir::CacheFormat>(state.range(1)));
+        populate(cache, state.range(0));
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(cache.save());
+        }
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+        fs::remove_all(cacheDir);
+    }
+
+    /**
+    * @brief Load a cache snapshot into a fresh Cache, as every build starts by doing
+    * @details range(0) is the number of targets, range(1) the CacheFormat
+    *          (0 for binary, 1 for text).
+    */
+    void BM_CacheLoad(benchmark::State& state)
+    {
+        const std::string cacheDir = (fs::temp_directory_path() / "mimir_bench_cache_load").string();
+        {
+            mimir::Cache cache(cacheDir);
+            cache.setFormat(static_cast<mimir::CacheFormat>(state.range(1)));
+            populate(cache, state.range(0));
+            cache.save();
+        }
+        for (auto _ : state)
+        {
+            mimir::Cache cache(cacheDir);
+            benchmark::DoNotOptimize(cache.load());
+        }
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+        fs::remove_all(cacheDir);
+    }
+}
+
+BENCHMARK(BM_CacheMixed)
+    ->ArgsProduct({{1, mimir::Cache::DEFAULT_SHARD_COUNT}, {10, 50}})
+    ->ArgNames({"shards", "write%"})
+    ->ThreadRange(1, 32)
+    ->UseRealTime();
+
+BENCHMARK(BM_CacheSave)
+    ->ArgsProduct({{1000, 100000}, {0, 1}})
+    ->ArgNames({"targets", "text"})
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK(BM_CacheLoad)
+    ->ArgsProduct({{1000, 100000}, {0, 1}})
+    ->ArgNames({"targets", "text"})
+    ->Unit(benchmark::kMillisecond);
@@ -0,0 +1,48 @@
+#include "mimir/command_runner.h"
+#include <benchmark/benchmark.h>
+#include <cstdlib>
+
+namespace
+{
+    /**
+    * @brief Spawn a trivial command through the runner, exec'd without a shell
+    */
+    void BM_SpawnDirect(benchmark::State& state)
+    {
+        mimir::SystemCommandRunner runner;
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(runner.runSimple("true"));
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    /**
+    * @brief Spawn a trivial command that needs /bin/sh
+    */
+    void BM_SpawnShell(benchmark::State& state)
+    {
+        mimir::SystemCommandRunner runner;
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(runner.runSimple("true;"));
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    /**
+    * @brief Baseline: the std::system call the runner used to make
+    */
+    void BM_StdSystem(benchmark::State& state)
+    {
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(std::system("true"));
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+}
+
+BENCHMARK(BM_SpawnDirect)->UseRealTime();
+BENCHMARK(BM_SpawnShell)->UseRealTime();
+BENCHMARK(BM_StdSystem)->UseRealTime();
@@ -0,0 +1,120 @@
+#include "dag_generators.h"
+#include "mimir/executor.h"
+#include "mimir/dag.h"
+#include "mimir/cache.h"
+#include "mimir/command_runner.h"
+#include <benchmark/benchmark.h>
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    void runSchedule(benchmark::State& state, const mimir::DAG& dag, mimir::SchedulerType scheduler)
+    {
+        const std::string cacheDir = (fs::temp_directory_path() / "mimir_bench_executor").string();
+        auto runner = std::make_shared<mimir::MockCommandRunner>();
+
+        mimir::Executor executor(static_cast<int>(state.range(1)), runner);
+        mimir::ExecutorConfig config = executor.getConfig();
+        config.scheduler = scheduler;
+        config.colorOutput = false;
+        executor.setConfig(config);
+
+        // Status lines would dominate the measurement; drop them on the floor
+        std::streambuf* saved = std::cout.rdbuf(nullptr);
+        for (auto _ : state)
+        {
+            mimir::Cache cache(cacheDir);
+            mimir::BuildStats stats;
+            benchmark::DoNotOptimize(executor.executeWithStats(dag, cache, stats));
+        }
+        std::cout.rdbuf(saved);
+        std::cout.clear();
+
+        state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(dag.size()));
+        fs::remove_all(cacheDir);
+    }
+
+    void BM_WideSharedQueue(benchmark::State& state)
+    {
+        const mimir::DAG dag = bench::makeDAG(bench::Shape::Wide, static_cast<size_t>(state.range(0)));
+        runSchedule(state, dag, mimir::SchedulerType::SharedQueue);
+    }
+
+    void BM_WideWorkStealing(benchmark::State& state)
+    {
+        const mimir::DAG dag = bench::makeDAG(bench::Shape::Wide, static_cast<size_t>(state.range(0)));
+        runSchedule(state, dag, mimir::SchedulerType::WorkStealing);
+    }
+
+    void BM_DeepSharedQueue(benchmark::State& state)
+    {
+        const mimir::DAG dag = bench::makeDAG(bench::Shape::Deep, static_cast<size_t>(state.range(0)));
+        runSchedule(state, dag, mimir::SchedulerType::SharedQueue);
+    }
+
+    void BM_DeepWorkStealing(benchmark::State& state)
+    {
+        const mimir::DAG dag = bench::makeDAG(bench::Shape::Deep, static_cast<size_t>(state.range(0)));
+        runSchedule(state, dag, mimir::SchedulerType::WorkStealing);
+    }
+
+    /**
+    * @brief Rebuild a DAG whose targets are all up to date, the latency of an idle `mimir build`
+    * @details range(0) is the number of targets, range(1) the thread count.
+    *          Every iteration loads the cache from disk like a fresh process
+    *          would, then finds nothing to run.
+    */
+    void BM_NoOpBuild(benchmark::State& state, const bench::Shape shape)
+    {
+        const mimir::DAG dag = bench::makeDAG(shape, static_cast<size_t>(state.range(0)));
+        const std::string cacheDir = (fs::temp_directory_path() / "mimir_bench_noop").string();
+        fs::remove_all(cacheDir);
+        auto runner = std::make_shared<mimir::MockCommandRunner>();
+
+        mimir::Executor executor(static_cast<int>(state.range(1)), runner);
+        mimir::ExecutorConfig config = executor.getConfig();
+        config.colorOutput = false;
+        executor.setConfig(config);
+
+        std::streambuf* saved = std::cout.rdbuf(nullptr);
+        {
+            mimir::Cache cache(cacheDir);
+            mimir::BuildStats stats;
+            executor.executeWithStats(dag, cache, stats);
+            cache.save();
+        }
+        for (auto _ : state)
+        {
+            mimir::Cache cache(cacheDir);
+            cache.load();
+            mimir::BuildStats stats;
+            benchmark::DoNotOptimize(executor.executeWithStats(dag, cache, stats));
+        }
+        std::cout.rdbuf(saved);
+        std::cout.clear();
+
+        state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(dag.size()));
+        fs::remove_all(cacheDir);
+    }
+}
+
+#define MIMIR_SCHEDULER_ARGS \
+    ArgsProduct({{1000, 10000}, {2, 8, 32}})->ArgNames({"targets", "threads"})->UseRealTime()
+
+BENCHMARK(BM_WideSharedQueue)->MIMIR_SCHEDULER_ARGS;
+BENCHMARK(BM_WideWorkStealing)->MIMIR_SCHEDULER_ARGS;
+BENCHMARK(BM_DeepSharedQueue)->MIMIR_SCHEDULER_ARGS;
+BENCHMARK(BM_DeepWorkStealing)->MIMIR_SCHEDULER_ARGS;
+
+#define MIMIR_NOOP_ARGS \
+    ArgsProduct({{1000, 10000, 100000}, {1, 8}})->ArgNames({"targets", "threads"})->UseRealTime() \
+        ->Unit(benchmark::kMillisecond)
+
+BENCHMARK_CAPTURE(BM_NoOpBuild, wide, bench::Shape::Wide)->MIMIR_NOOP_ARGS;
+BENCHMARK_CAPTURE(BM_NoOpBuild, deep, bench::Shape::Deep)->MIMIR_NOOP_ARGS;
+BENCHMARK_CAPTURE(BM_NoOpBuild, random, bench::Shape::Random)->MIMIR_NOOP_ARGS;
+BENCHMARK_CAPTURE(BM_NoOpBuild, monorepo, bench::Shape::Monorepo)->MIMIR_NOOP_ARGS;
@@ -0,0 +1,83 @@
+#include "dag_generators.h"
+#include "mimir/compiled_graph.h"
+#include "mimir/dag.h"
+#include <benchmark/benchmark.h>
+#include <vector>
+
+namespace
+{
+    /**
+    * @brief Insert generated targets into a fresh DAG
+    * @details range(0) is the number of targets; the targets are generated
+    *          once, so only addTarget() and dependency indexing are timed.
+    */
+    void BM_BuildDAG(benchmark::State& state, const bench::Shape shape)
+    {
+        const std::vector<mimir::Target> targets = bench::makeTargets(shape, static_cast<size_t>(state.range(0)));
+        for (auto _ : state)
+        {
+            mimir::DAG dag = bench::makeDAG(targets);
+            benchmark::DoNotOptimize(dag.size());
+        }
+        state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(targets.size()));
+    }
+
+    /**
+    * @brief Compile a DAG into the executor's integer-indexed graph
+    * @details range(0) is the number of targets.
+    */
+    void BM_CompileGraph(benchmark::State& state, const bench::Shape shape)
+    {
+        const mimir::DAG dag = bench::makeDAG(shape, static_cast<size_t>(state.range(0)));
+        for (auto _ : state)
+        {
+            const mimir::CompiledGraph graph(dag);
+            benchmark::DoNotOptimize(graph.nodeCount());
+        }
+        state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(dag.size()));
+    }
+
+    /**
+    * @brief Order every target of a DAG
+    * @details range(0) is the number of targets.
+    */
+    void BM_TopologicalSort(benchmark::State& state, const bench::Shape shape)
+    {
+        const mimir::DAG dag = bench::makeDAG(shape, static_cast<size_t>(state.range(0)));
+        for (auto _ : state)
+        {
+            auto order = dag.topologicalSort();
+            benchmark::DoNotOptimize(order);
+        }
+        state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(dag.size()));
+    }
+
+    /**
+    * @brief Search an acyclic DAG for cycles, the worst case since nothing stops it early
+    * @details range(0) is the number of targets.
+    */
+    void BM_DetectCycles(benchmark::State& state, const bench::Shape shape)
+    {
+        const mimir::DAG dag = bench::makeDAG(shape, static_cast<size_t>(state.range(0)));
+        for (auto _ : state)
+        {
+            auto result = dag.detectCyclesWithResult();
+            benchmark::DoNotOptimize(result);
+        }
+        state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(dag.size()));
+    }
+}
+
+#define MIMIR_GRAPH_BENCHMARK(fn) \
+    BENCHMARK_CAPTURE(fn, wide, bench::Shape::Wide)->MIMIR_GRAPH_ARGS; \
+    BENCHMARK_CAPTURE(fn, deep, bench::Shape::Deep)->MIMIR_GRAPH_ARGS; \
+    BENCHMARK_CAPTURE(fn, random, bench::Shape::Random)->MIMIR_GRAPH_ARGS; \
+    BENCHMARK_CAPTURE(fn, monorepo, bench::Shape::Monorepo)->MIMIR_GRAPH_ARGS
+
+#define MIMIR_GRAPH_ARGS \
+    RangeMultiplier(10)->Range(1000, 1000000)->ArgName("targets")->Unit(benchmark::kMillisecond)
+
+MIMIR_GRAPH_BENCHMARK(BM_BuildDAG);
+MIMIR_GRAPH_BENCHMARK(BM_CompileGraph);
+MIMIR_GRAPH_BENCHMARK(BM_TopologicalSort);
+MIMIR_GRAPH_BENCHMARK(BM_DetectCycles);
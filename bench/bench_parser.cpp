@@ -0,0 +1,171 @@
+#include "dag_generators.h"
+#include "mimir/parser.h"
+#include <benchmark/benchmark.h>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    /**
+    * @brief Write a YAML build file with variables, conditionals and list references
+    * @param path Destination
+    * @param targetCount Number of targets
+    */
+    void writeBuildFile(const fs::path& path, const int targetCount)
+    {
+        std::ofstream out(path);
+        out << "variables:\n  cc: gcc\n  cflags: -O2 -Wall\n  debug_flags: -O0 -g\n"
+            << "config:\n  mode: release\n"
+            << "targets:\n";
+        for (int i = 0; i < targetCount; ++i)
+        {
+            out << "  - name: obj" << i << "\n"
+                << "    inputs:\n      - src/file" << i << ".c\n      - include/common.h\n"
+                << "    outputs:\n      - build/file" << i << ".o\n";
+            if (i > 0)
+            {
+                out << "    dependencies:\n      - obj" << (i - 1) << "\n";
+            }
+            out << "    command: ${cc} ${cflags} ${{ debug_flags if config.mode == \"debug\" else cflags }}"
+                << " -c ${inputs} -o ${outputs}\n";
+        }
+    }
+
+    /**
+    * @brief Parse a generated build file from scratch or from the graph cache
+    * @details range(0) is the number of targets, range(1) is 1 to answer from
+    *          the graph cache (warmed before timing) and 0 to parse every time.
+    */
+    void BM_ParseYAML(benchmark::State& state)
+    {
+        const fs::path dir = fs::temp_directory_path() / "mimir_bench_parser";
+        fs::remove_all(dir);
+        fs::create_directories(dir);
+        const std::string buildFile = (dir / "build.yaml").string();
+        writeBuildFile(buildFile, static_cast<int>(state.range(0)));
+        const bool cached = state.range(1) != 0;
+        if (cached)
+        {
+            // A stamp younger than the timestamp slack never vouches for the
+            // file, and every iteration would rehash it and rewrite the cache
+            fs::last_write_time(buildFile, fs::file_time_type::clock::now() - std::chrono::seconds(2));
+            mimir::Parser warm;
+            warm.setCacheDirectory((dir / "cache").string());
+            warm.parseFile(buildFile);
+        }
+
+        for (auto _ : state)
+        {
+            mimir::Parser parser;
+            if (cached)
+            {
+                parser.setCacheDirectory((dir / "cache").string());
+            }
+            auto result = parser.parseFile(buildFile);
+            benchmark::DoNotOptimize(result);
+            if (cached && !parser.loadedFromCache())
+            {
+                state.SkipWithError("the graph cache missed");
+                break;
+            }
+        }
+
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+        state.SetBytesProcessed(state.iterations() * static_cast<std::int64_t>(fs::file_size(buildFile)));
+        fs::remove_all(dir);
+    }
+
+    /**
+    * @brief Parse a build file whose targets glob overlapping parts of a source tree
+    * @details range(0) is the number of packages (20 sources in 4 directories
+    *          each). range(1) is 1 to reparse with the same parser, whose
+    *          directory listings then carry over, and 0 for a fresh parser.
+    */
+    void BM_ParseGlobs(benchmark::State& state)
+    {
+        const fs::path dir = fs::temp_directory_path() / "mimir_bench_globs";
+        fs::remove_all(dir);
+        fs::create_directories(dir);
+        const int packages = static_cast<int>(state.range(0));
+        std::ofstream out(dir / "build.yaml");
+        for (int i = 0; i < packages; ++i)
+        {
+            const fs::path package = dir / ("pkg" + std::to_string(i));
+            for (int j = 0; j < 20; ++j)
+            {
+                const fs::path sub = package / ("dir" + std::to_string(j % 4));
+                fs::create_directories(sub);
+                std::ofstream(sub / ("file" + std::to_string(j) + (j % 2 ? ".c" : ".h")));
+            }
+            if (i == 0)
+            {
+                out << "targets:\n";
+            }
+            out << "  - name: lib" << i << "\n    inputs:\n      - " << package.string() << "/**/*.c\n"
+                << "      - " << package.string() << "/*/*.h\n      - " << package.string() << "/dir[01]/*\n"
+                << "    command: cc ${inputs}\n";
+        }
+        out.close();
+        const std::string buildFile = (dir / "build.yaml").string();
+        const bool reuse = state.range(1) != 0;
+
+        mimir::Parser shared;
+        for (auto _ : state)
+        {
+            mimir::Parser fresh;
+            auto result = (reuse ? shared : fresh).parseFile(buildFile);
+            benchmark::DoNotOptimize(result);
+        }
+
+        state.SetItemsProcessed(state.iterations() * packages);
+        fs::remove_all(dir);
+    }
+
+    /**
+    * @brief Parse the YAML form of a generated graph, without the graph cache
+    * @details range(0) is the number of targets. Unlike BM_ParseYAML the
+    *          dependency edges follow the shape, so the parser's validation
+    *          sees realistic fan-in and fan-out.
+    */
+    void BM_ParseShape(benchmark::State& state, const bench::Shape shape)
+    {
+        const fs::path dir = fs::temp_directory_path() / "mimir_bench_parse_shape";
+        fs::remove_all(dir);
+        fs::create_directories(dir);
+        const std::string buildFile = (dir / "build.yaml").string();
+        bench::writeYAML(buildFile, bench::makeTargets(shape, static_cast<size_t>(state.range(0))));
+
+        for (auto _ : state)
+        {
+            mimir::Parser parser;
+            auto result = parser.parseFile(buildFile);
+            benchmark::DoNotOptimize(result);
+        }
+
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+        state.SetBytesProcessed(state.iterations() * static_cast<std::int64_t>(fs::file_size(buildFile)));
+        fs::remove_all(dir);
+    }
+}
+
+BENCHMARK(BM_ParseYAML)
+    ->ArgsProduct({{1000, 20000}, {0, 1}})
+    ->ArgNames({"targets", "cached"})
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK(BM_ParseGlobs)
+    ->ArgsProduct({{100, 1000}, {0, 1}})
+    ->ArgNames({"packages", "reuse"})
+    ->Unit(benchmark::kMillisecond);
+
+#define MIMIR_PARSE_SHAPE_ARGS \
+    RangeMultiplier(10)->Range(1000, 100000)->ArgName("targets")->Unit(benchmark::kMillisecond)
+
+BENCHMARK_CAPTURE(BM_ParseShape, wide, bench::Shape::Wide)->MIMIR_PARSE_SHAPE_ARGS;
+BENCHMARK_CAPTURE(BM_ParseShape, deep, bench::Shape::Deep)->MIMIR_PARSE_SHAPE_ARGS;
+BENCHMARK_CAPTURE(BM_ParseShape, random, bench::Shape::Random)->MIMIR_PARSE_SHAPE_ARGS;
+BENCHMARK_CAPTURE(BM_ParseShape, monorepo, bench::Shape::Monorepo)->MIMIR_PARSE_SHAPE_ARGS;
@@ -0,0 +1,75 @@
+#include "mimir/signature.h"
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    /**
+    * @brief Hash one file of a given size, the work behind every changed input
+    * @details range(0) is the file size in bytes, range(1) the HashAlgorithm
+    *          (0 for SHA-256, 1 for BLAKE3). The file stays in the page cache,
+    *          so this is hashing throughput rather than disk speed.
+    */
+    void BM_HashFile(benchmark::State& state)
+    {
+        const fs::path path = fs::temp_directory_path() / "mimir_bench_hash.bin";
+        {
+            std::string block(64 * 1024, '\0');
+            for (size_t i = 0; i < block.size(); ++i)
+            {
+                block[i] = static_cast<char>(i * 131 + 7);
+            }
+            std::ofstream out(path, std::ios::binary | std::ios::trunc);
+            for (std::int64_t left = state.range(0); left > 0; left -= static_cast<std::int64_t>(block.size()))
+            {
+                out.write(block.data(), std::min<std::int64_t>(left, static_cast<std::int64_t>(block.size())));
+            }
+        }
+
+        const mimir::HashAlgorithm saved = mimir::Signature::getAlgorithm();
+        mimir::Signature::setAlgorithm(static_cast<mimir::HashAlgorithm>(state.range(1)));
+        for (auto _ : state)
+        {
+            auto signature = mimir::Signature::computeFileSignature(path.string());
+            benchmark::DoNotOptimize(signature);
+        }
+        mimir::Signature::setAlgorithm(saved);
+
+        state.SetBytesProcessed(state.iterations() * state.range(0));
+        fs::remove(path);
+    }
+
+    /**
+    * @brief Combine a command with already hashed inputs into a target signature
+    * @details range(0) is the number of input signatures.
+    */
+    void BM_CombineTargetSignature(benchmark::State& state)
+    {
+        std::vector<std::string> inputs;
+        for (std::int64_t i = 0; i < state.range(0); ++i)
+        {
+            inputs.push_back(mimir::Signature::computeCommandSignature("input " + std::to_string(i)));
+        }
+        const std::string command = "gcc -O2 -Wall -c src/file.c -o build/file.o";
+        for (auto _ : state)
+        {
+            auto signature = mimir::Signature::combineTargetSignature(command, inputs);
+            benchmark::DoNotOptimize(signature);
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+}
+
+BENCHMARK(BM_HashFile)
+    ->ArgsProduct({{4 * 1024, 1024 * 1024, 64 * 1024 * 1024}, {0, 1}})
+    ->ArgNames({"bytes", "blake3"});
+
+BENCHMARK(BM_CombineTargetSignature)
+    ->Arg(1)->Arg(16)->Arg(256)
+    ->ArgName("inputs");
@@ -0,0 +1,215 @@
+#pragma once
+
+#include "mimir/dag.h"
+#include "mimir/target.h"
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/// @brief Synthetic build graphs shared by the benchmarks \namespace bench
+namespace bench
+{
+    /// @brief Graph shapes the generators produce \enum Shape
+    enum class Shape
+    {
+        Wide,       ///< One root fanning out to every other target, which all feed one sink
+        Deep,       ///< Eight independent chains
+        Random,     ///< Each target depends on up to four random earlier targets
+        Monorepo    ///< Packages of codegen, compiles, a library and a test, libraries linking earlier packages
+    };
+
+    /// @brief Small deterministic PRNG, so every run builds the same graph \class XorShift
+    class XorShift
+    {
+    public:
+        explicit XorShift(std::uint32_t seed)
+            : state_(seed == 0 ? 0x9E3779B9u : seed)
+        {
+        }
+
+        std::uint32_t next() noexcept
+        {
+            state_ ^= state_ << 13;
+            state_ ^= state_ >> 17;
+            state_ ^= state_ << 5;
+            return state_;
+        }
+
+        /// Uniform in [0, bound)
+        std::uint32_t below(std::uint32_t bound) noexcept
+        {
+            return next() % bound;
+        }
+
+    private:
+        std::uint32_t state_;
+    };
+
+    /**
+    * @brief Make a target whose command is its name
+    * @param name Target name
+    * @return The target
+    */
+    inline mimir::Target makeTarget(const std::string& name)
+    {
+        mimir::Target target(name);
+        target.setCommand("run " + name);
+        return target;
+    }
+
+    /**
+    * @brief Generate about count targets of a shape
+    * @param shape Graph shape
+    * @param count Number of targets (Monorepo rounds up to whole packages)
+    * @return Targets in dependency order
+    */
+    inline std::vector<mimir::Target> makeTargets(const Shape shape, const size_t count)
+    {
+        std::vector<mimir::Target> targets;
+        targets.reserve(count + 64);
+        switch (shape)
+        {
+            case Shape::Wide:
+            {
+                targets.push_back(makeTarget("root"));
+                mimir::Target sink = makeTarget("sink");
+                for (size_t i = 0; i + 2 < count; ++i)
+                {
+                    mimir::Target leaf = makeTarget("leaf_" + std::to_string(i));
+                    leaf.addDependency("root");
+                    sink.addDependency(leaf.getName());
+                    targets.push_back(std::move(leaf));
+                }
+                targets.push_back(std::move(sink));
+                break;
+            }
+            case Shape::Deep:
+            {
+                constexpr size_t chains = 8;
+                const size_t depth = (count + chains - 1) / chains;
+                for (size_t c = 0; c < chains; ++c)
+                {
+                    for (size_t i = 0; i < depth; ++i)
+                    {
+                        mimir::Target target = makeTarget("c" + std::to_string(c) + "_" + std::to_string(i));
+                        if (i > 0)
+                        {
+                            target.addDependency("c" + std::to_string(c) + "_" + std::to_string(i - 1));
+                        }
+                        targets.push_back(std::move(target));
+                    }
+                }
+                break;
+            }
+            case Shape::Random:
+            {
+                XorShift rng(static_cast<std::uint32_t>(count));
+                for (size_t i = 0; i < count; ++i)
+                {
+                    mimir::Target target = makeTarget("n" + std::to_string(i));
+                    const std::uint32_t edges = i == 0 ? 0 : rng.below(5);
+                    for (std::uint32_t e = 0; e < edges; ++e)
+                    {
+                        const std::string dependency = "n" + std::to_string(rng.below(static_cast<std::uint32_t>(i)));
+                        const auto& existing = target.getDependencies();
+                        if (std::find(existing.begin(), existing.end(), dependency) == existing.end())
+                        {
+                            target.addDependency(dependency);
+                        }
+                    }
+                    targets.push_back(std::move(target));
+                }
+                break;
+            }
+            case Shape::Monorepo:
+            {
+                constexpr size_t objects = 40;
+                constexpr size_t perPackage = objects + 3;
+                const size_t packages = (count + perPackage - 1) / perPackage;
+                XorShift rng(static_cast<std::uint32_t>(packages));
+                for (size_t p = 0; p < packages; ++p)
+                {
+                    const std::string package = "pkg" + std::to_string(p) + "/";
+                    targets.push_back(makeTarget(package + "gen"));
+                    mimir::Target lib = makeTarget(package + "lib");
+                    for (size_t j = 0; j < objects; ++j)
+                    {
+                        mimir::Target object = makeTarget(package + "obj" + std::to_string(j));
+                        object.addDependency(package + "gen");
+                        lib.addDependency(object.getName());
+                        targets.push_back(std::move(object));
+                    }
+                    // Mostly recent packages, like layers of a real tree
+                    for (std::uint32_t k = 0; p > 0 && k < 3; ++k)
+                    {
+                        const std::uint32_t back = 1 + rng.below(static_cast<std::uint32_t>(std::min<size_t>(p, 20)));
+                        const std::string dependency = "pkg" + std::to_string(p - back) + "/lib";
+                        const auto& existing = lib.getDependencies();
+                        if (std::find(existing.begin(), existing.end(), dependency) == existing.end())
+                        {
+                            lib.addDependency(dependency);
+                        }
+                    }
+                    mimir::Target test = makeTarget(package + "test");
+                    test.addDependency(lib.getName());
+                    targets.push_back(std::move(lib));
+                    targets.push_back(std::move(test));
+                }
+                break;
+            }
+        }
+        return targets;
+    }
+
+    /**
+    * @brief Put targets into a DAG
+    * @param targets The targets
+    * @return The DAG
+    */
+    inline mimir::DAG makeDAG(const std::vector<mimir::Target>& targets)
+    {
+        mimir::DAG dag;
+        for (const auto& target : targets)
+        {
+            dag.addTarget(target);
+        }
+        return dag;
+    }
+
+    /**
+    * @brief Generate a DAG of a shape
+    * @param shape Graph shape
+    * @param count Number of targets
+    * @return The DAG
+    */
+    inline mimir::DAG makeDAG(const Shape shape, const size_t count)
+    {
+        return makeDAG(makeTargets(shape, count));
+    }
+
+    /**
+    * @brief Write targets as a YAML build file
+    * @param path Destination
+    * @param targets The targets
+    */
+    inline void writeYAML(const std::string& path, const std::vector<mimir::Target>& targets)
+    {
+        std::ofstream out(path);
+        out << "targets:\n";
+        for (const auto& target : targets)
+        {
+            out << "  - name: " << target.getName() << "\n";
+            if (target.hasDependencies())
+            {
+                out << "    dependencies:\n";
+                for (const auto& dependency : target.getDependencies())
+                {
+                    out << "      - " << dependency << "\n";
+                }
+            }
+            out << "    command: " << target.getCommand() << "\n";
+        }
+    }
+} // namespace bench
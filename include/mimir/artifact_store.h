@@ -0,0 +1,251 @@
+#pragma once
+
+#include "http_client.h"
+#include "thread_pool.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// @brief Content-addressed store for sharing build outputs between machines \namespace mimir
+namespace mimir
+{
+    /// @brief Key/value blob storage behind an ArtifactStore \class IArtifactBackend
+    /// @note Keys look like "ac/<action key>" (manifests) or "cas/<sha256>" (output
+    ///       blobs). Implementations must be safe to call from several threads.
+    class IArtifactBackend
+    {
+    public:
+        virtual ~IArtifactBackend() = default;
+
+        /**
+        * @brief Fetch a blob
+        * @param key Blob key
+        * @return The blob, or nullopt if it is missing or unreachable
+        */
+        virtual std::optional<std::string> fetch(const std::string& key) = 0;
+
+        /**
+        * @brief Store a blob
+        * @param key Blob key
+        * @param data Blob contents
+        * @return True if the blob was stored
+        */
+        virtual bool store(const std::string& key, std::string_view data) = 0;
+
+        /**
+        * @brief Check whether a blob exists
+        * @param key Blob key
+        * @return True if the blob is present
+        */
+        virtual bool contains(const std::string& key) = 0;
+
+        /**
+        * @brief Describe the backend for messages
+        * @return Human-readable location
+        */
+        virtual std::string describe() const = 0;
+    };
+
+    /**
+    * @brief Shared pointer type for artifact backends
+    */
+    using ArtifactBackendPtr = std::shared_ptr<IArtifactBackend>;
+
+    /// @brief Backend over a (possibly network-mounted) shared directory \class LocalArtifactBackend
+    /// @note Blobs are written to a temporary name and renamed into place, so
+    ///       concurrent writers and readers on other machines never see partial files.
+    class LocalArtifactBackend : public IArtifactBackend
+    {
+    public:
+        /**
+        * @brief Construct a backend rooted at a directory
+        * @param rootDir Directory holding the ac/ and cas/ trees (created on demand)
+        */
+        explicit LocalArtifactBackend(std::string rootDir);
+
+        std::optional<std::string> fetch(const std::string& key) override;
+        bool store(const std::string& key, std::string_view data) override;
+        bool contains(const std::string& key) override;
+        std::string describe() const override;
+
+    private:
+        /**
+        * @brief Map a key to its file, fanned out by the first two key characters
+        * @param key Blob key
+        * @return Path of the blob file
+        */
+        std::string pathFor(const std::string& key) const;
+
+        std::string rootDir_;
+    };
+
+    /// @brief Backend speaking the GET/PUT/HEAD protocol of common HTTP build caches \class HttpArtifactBackend
+    /// @note Requests go to <base>/ac/<key> and <base>/cas/<digest>, as served by
+    ///       bazel-remote, nginx WebDAV and similar servers.
+    class HttpArtifactBackend : public IArtifactBackend
+    {
+    public:
+        /**
+        * @brief Construct a backend for a server
+        * @param url Server and path prefix
+        */
+        explicit HttpArtifactBackend(HttpUrl url);
+
+        std::optional<std::string> fetch(const std::string& key) override;
+        bool store(const std::string& key, std::string_view data) override;
+        bool contains(const std::string& key) override;
+        std::string describe() const override;
+
+    private:
+        HttpClient client_;
+    };
+
+    /**
+    * @brief Create a backend from a location string
+    * @param location "http://host[:port][/prefix]" or a directory path
+    * @return The backend, or nullptr if the location is malformed
+    */
+    ArtifactBackendPtr createArtifactBackend(const std::string& location);
+
+    /// @brief Counters describing artifact cache traffic \struct ArtifactStoreStats
+    struct ArtifactStoreStats
+    {
+        size_t hits = 0;                ///< Targets restored from the store
+        size_t misses = 0;              ///< Lookups that found no usable manifest
+        size_t uploads = 0;             ///< Targets whose outputs were published
+        size_t uploadFailures = 0;      ///< Publications that failed part-way
+        size_t bytesDownloaded = 0;     ///< Encoded bytes fetched
+        size_t bytesUploaded = 0;       ///< Encoded bytes sent
+    };
+
+    /// @brief Restores and publishes target outputs keyed by target signature \class ArtifactStore
+    /// @details Each target's outputs are stored as content-addressed blobs plus a
+    ///          manifest under an action key derived from the target signature and
+    ///          its output paths. Blobs are deflate-compressed when zlib is
+    ///          available. Downloads for one target run in parallel on the store's
+    ///          download pool; uploads are queued on a pool of their own and overlap
+    ///          with the rest of the build, so a restore never waits behind them.
+    class ArtifactStore
+    {
+    public:
+        /**
+        * @brief Construct a store over a backend
+        * @param backend Where blobs live
+        * @param numThreads Threads used for transfers in each direction
+        */
+        explicit ArtifactStore(ArtifactBackendPtr backend, size_t numThreads = 8);
+
+        /**
+        * @brief Wait for queued uploads, then stop the transfer threads
+        */
+        ~ArtifactStore();
+
+        ArtifactStore(const ArtifactStore&) = delete;
+        ArtifactStore& operator=(const ArtifactStore&) = delete;
+
+        /**
+        * @brief Restore a target's outputs from the store
+        * @param signature The target signature
+        * @param outputs The target's declared outputs
+        * @return True if every output was fetched, verified and written
+        * @note Outputs are only replaced after every blob has been verified
+        */
+        bool restore(const std::string& signature, const std::vector<std::string>& outputs);
+
+        /**
+        * @brief Queue publication of a target's outputs
+        * @param signature The target signature
+        * @param outputs The target's declared outputs
+        * @note Does nothing in read-only mode. The outputs are hashed before
+        *       this returns, and the upload is abandoned if they no longer match
+        *       when it runs. The manifest is written after its blobs, so readers
+        *       never see a manifest whose blobs are missing.
+        */
+        void storeAsync(const std::string& signature, const std::vector<std::string>& outputs);
+
+        /**
+        * @brief Block until every queued upload has finished
+        */
+        void waitForUploads();
+
+        /**
+        * @brief Enable or disable read-only mode
+        * @param readOnly If true, storeAsync() is a no-op
+        */
+        void setReadOnly(bool readOnly) noexcept;
+
+        /**
+        * @brief Check if the store is read-only
+        * @return True if uploads are disabled
+        */
+        bool isReadOnly() const noexcept;
+
+        /**
+        * @brief Get a snapshot of the traffic counters
+        * @return Current statistics
+        */
+        ArtifactStoreStats getStats() const;
+
+        /**
+        * @brief Get the backend
+        * @return The backend
+        */
+        const ArtifactBackendPtr& getBackend() const noexcept;
+
+        /**
+        * @brief Derive the manifest key for a target
+        * @param signature The target signature
+        * @param outputs The target's declared outputs
+        * @return Hex key covering both, so targets that share a command and
+        *         inputs but write different files never collide
+        */
+        static std::string actionKey(const std::string& signature, const std::vector<std::string>& outputs);
+
+        /**
+        * @brief Wrap data in the blob framing, compressing it if that helps
+        * @param data Raw contents
+        * @return Encoded blob
+        */
+        static std::string encodeBlob(std::string_view data);
+
+        /**
+        * @brief Unwrap a blob produced by encodeBlob()
+        * @param blob Encoded blob
+        * @return Raw contents, or nullopt if the blob is corrupt or uses an unsupported codec
+        */
+        static std::optional<std::string> decodeBlob(std::string_view blob);
+
+        /**
+        * @brief Check if blobs are compressed by this build
+        * @return True if mimir was built with zlib
+        */
+        static bool compressionAvailable() noexcept;
+
+    private:
+        /**
+        * @brief Read, hash and upload a target's outputs, then its manifest
+        * @param key Action key of the target
+        * @param outputs The target's declared outputs
+        * @param digests Content digest of each output when it was queued
+        * @return True if everything was stored
+        */
+        bool publish(const std::string& key, const std::vector<std::string>& outputs,
+                     const std::vector<std::string>& digests);
+
+        ArtifactBackendPtr backend_;
+        std::atomic<bool> readOnly_;
+        std::atomic<size_t> hits_;
+        std::atomic<size_t> misses_;
+        std::atomic<size_t> uploads_;
+        std::atomic<size_t> uploadFailures_;
+        std::atomic<size_t> bytesDownloaded_;
+        std::atomic<size_t> bytesUploaded_;
+        // Declared last so they are joined before the counters go away
+        ThreadPool downloadPool_;
+        ThreadPool uploadPool_;
+    };
+} // namespace mimir
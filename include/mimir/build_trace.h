@@ -0,0 +1,123 @@
+#pragma once
+
+#include "cache.h"
+#include "command_runner.h"
+#include "dag.h"
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+/// @brief Per-target timing of builds \namespace mimir
+namespace mimir
+{
+    /// @brief What happened to one target during a traced build \struct TraceEvent
+    /// @note Times are microseconds since BuildTrace::start()
+    struct TraceEvent
+    {
+        std::string name;                   ///< Target name
+        std::string status;                 ///< UP-TO-DATE, SUCCESS, RESTORED or FAILED
+        size_t worker = 0;                  ///< Worker thread that processed the target
+        std::int64_t readyUs = 0;           ///< When its last dependency finished
+        std::int64_t startUs = 0;           ///< When a worker picked it up
+        std::int64_t endUs = 0;             ///< When it was done
+        std::int64_t hashUs = 0;            ///< Time spent computing its signature
+        std::int64_t commandStartUs = -1;   ///< When its command was started, or -1 if it did not run
+        std::int64_t commandUs = 0;         ///< Wall time of the command
+        std::int64_t spawnUs = 0;           ///< Part of commandUs spent starting the process
+        ResourceUsage usage{};              ///< CPU time and peak RSS of the command
+
+        /**
+        * @brief Get how long the target waited for a free worker
+        * @return startUs - readyUs
+        */
+        std::int64_t queueUs() const noexcept
+        {
+            return startUs - readyUs;
+        }
+    };
+
+    /// @brief Thread-safe collector of TraceEvents with Chrome trace export \class BuildTrace
+    /// @details The export is the Trace Event Format's JSON object form, which
+    ///          chrome://tracing and ui.perfetto.dev open directly. Each worker
+    ///          is a thread; a target is a complete ("X") event with its
+    ///          command nested inside it, and the remaining fields are args.
+    class BuildTrace
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        /**
+        * @brief Construct a trace whose clock starts now
+        */
+        BuildTrace();
+
+        /**
+        * @brief Drop recorded events and restart the clock
+        */
+        void start();
+
+        /**
+        * @brief Get the time since start()
+        * @return Elapsed microseconds
+        * @note Thread-safe
+        */
+        std::int64_t elapsedUs() const;
+
+        /**
+        * @brief Add a finished target
+        * @param event The target's timeline
+        * @note Thread-safe
+        */
+        void record(TraceEvent event);
+
+        /**
+        * @brief Get the recorded events
+        * @return Copies ordered by start time
+        * @note Thread-safe
+        */
+        std::vector<TraceEvent> events() const;
+
+        /**
+        * @brief Render the events in Chrome trace event format
+        * @return The JSON document
+        */
+        std::string toChromeTrace() const;
+
+        /**
+        * @brief Write toChromeTrace() to a file
+        * @param path Destination path
+        * @return True if the file was written
+        */
+        bool writeChromeTrace(const std::string& path) const;
+
+    private:
+        mutable std::mutex mutex_;
+        Clock::time_point epoch_;
+        std::vector<TraceEvent> events_;
+    };
+
+    /// @brief Where the time of past builds went, from durations in the cache \struct BuildProfile
+    struct BuildProfile
+    {
+        using Entry = std::pair<std::string, std::uint64_t>;   ///< Target and duration in microseconds
+
+        size_t targets = 0;                 ///< Targets in the DAG
+        size_t recorded = 0;                ///< Targets with a recorded duration
+        std::uint64_t totalUs = 0;          ///< Sum of every recorded duration
+        std::uint64_t criticalPathUs = 0;   ///< Heaviest dependency chain, the floor for any -j
+        std::vector<Entry> criticalPath;    ///< That chain, dependencies first
+        std::vector<Entry> slowest;         ///< Longest durations first
+    };
+
+    /**
+    * @brief Summarize the durations recorded for a DAG's targets
+    * @param dag The DAG
+    * @param cache Cache holding the durations of earlier builds
+    * @param slowestCount How many of the slowest targets to list
+    * @return The profile; targets that never ran count as taking no time
+    */
+    BuildProfile profileBuild(const DAG& dag, const Cache& cache, size_t slowestCount = 10);
+} // namespace mimir
@@ -1,24 +1,37 @@
 #pragma once
 
+#include "cache_format.h"
+#include "cache_journal.h"
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <mutex>
 #include <shared_mutex>
 #include <optional>
+#include <vector>
 
 
 /// @brief Thread-safe cache for storing and retrieving build signatures \namespace mimir
 namespace mimir
 {
     /// @brief Thread-safe cache for storing and retrieving build signatures \class Cache
+    /// @note Entries are spread over independently locked shards keyed by a hash of
+    ///       the target name (or file path), so workers touching different targets
+    ///       do not contend. Whole-cache operations (load, save, clear, size) lock
+    ///       every shard.
     class Cache
     {
     public:
+        /// Number of shards used unless the constructor is told otherwise
+        static constexpr size_t DEFAULT_SHARD_COUNT = 64;
+
         /**
         * @brief Construct a cache with the specified directory
         * @param cacheDir Directory path for cache storage (default: ".mimir")
+        * @param shardCount Number of lock shards (rounded up to a power of two)
         */
-        explicit Cache(const std::string& cacheDir = ".mimir");
+        explicit Cache(const std::string& cacheDir = ".mimir", size_t shardCount = DEFAULT_SHARD_COUNT);
 
         /**
         * @brief Destructor
@@ -51,22 +64,72 @@ namespace mimir
         /**
         * @brief Load cache data from persistent storage
         * @return True if loading succeeded, false otherwise
-        * @note Thread-safe: acquires exclusive lock
+        * @note Thread-safe: locks every shard exclusively. A binary cache.bin is
+        *       mapped read-only and queried in place; without one, the text
+        *       cache.txt / files.txt / durations.txt / outputs.txt files are
+        *       parsed instead.
+        *       Records in the journal are then replayed on top, and a large
+        *       journal is compacted straight away.
         */
         bool load();
 
         /**
         * @brief Save cache data to persistent storage
         * @return True if saving succeeded, false otherwise
-        * @note Thread-safe: acquires shared lock
+        * @note Thread-safe: locks every shard shared. Writes the format selected
+        *       with setFormat(), removes files of the other format and
+        *       truncates the journal (everything in it is now in the snapshot).
         */
         bool save() const;
 
+        /**
+        * @brief Make every change durable as cheaply as possible
+        * @return True if the changes are on disk
+        * @note Thread-safe: locks every shard shared. With a journal this only
+        *       waits for it to reach the disk, so the cost does not grow with
+        *       the cache; the snapshot is rewritten (and the journal emptied)
+        *       once the journal has grown past the size load() compacts at.
+        *       Without a journal it is save().
+        */
+        bool checkpoint() const;
+
+        /**
+        * @brief Start logging every change to .mimir/journal.log
+        * @return True if the journal is open
+        * @note Thread-safe: locks every shard exclusively. Changes are written by a
+        *       background thread with batched fsyncs, so a killed build keeps
+        *       everything but the last few in-flight updates.
+        */
+        bool enableJournal();
+
+        /**
+        * @brief Block until every journaled change is on disk
+        */
+        void flushJournal();
+
+        /**
+        * @brief Check if changes are being journaled
+        * @return True after a successful enableJournal()
+        */
+        bool isJournalEnabled() const;
+
+        /**
+        * @brief Select the format written by save()
+        * @param format Binary (default) or Text
+        */
+        void setFormat(CacheFormat format);
+
+        /**
+        * @brief Get the format written by save()
+        * @return The current format
+        */
+        CacheFormat getFormat() const;
+
         /**
         * @brief Get the stored signature for a target
         * @param targetName Name of the target to query
         * @return The stored signature, or empty string if not found
-        * @note Thread-safe: acquires shared lock
+        * @note Thread-safe: locks one shard shared
         */
         std::string getSignature(const std::string& targetName) const;
 
@@ -74,7 +137,7 @@ namespace mimir
         * @brief Get the stored signature as optional
         * @param targetName Name of the target to query
         * @return Optional containing signature if found, nullopt otherwise
-        * @note Thread-safe: acquires shared lock
+        * @note Thread-safe: locks one shard shared
         */
         std::optional<std::string> findSignature(const std::string& targetName) const;
 
@@ -82,7 +145,7 @@ namespace mimir
         * @brief Set the signature for a target
         * @param targetName Name of the target
         * @param signature The signature to store
-        * @note Thread-safe: acquires exclusive lock
+        * @note Thread-safe: locks one shard exclusively
         */
         void setSignature(const std::string& targetName, const std::string& signature);
 
@@ -91,35 +154,109 @@ namespace mimir
         * @param targetName Name of the target to check
         * @param currentSignature The current computed signature
         * @return True if rebuild is needed, false if up-to-date
-        * @note Thread-safe: acquires shared lock
+        * @note Thread-safe: locks one shard shared
         */
         bool needsRebuild(const std::string& targetName, const std::string& currentSignature) const;
 
+        /**
+        * @brief Get a file's content signature, rehashing only if its stat tuple changed
+        * @param path Path of the input file
+        * @return The content signature, or empty string if the file cannot be read
+        * @note Thread-safe. A record is only trusted if the file's mtime is at least a
+        *       second older than the time it was hashed, so writes landing within the
+        *       filesystem's timestamp granularity are never missed.
+        */
+        std::string getFileSignature(const std::string& path);
+
+        /**
+        * @brief Get the stored record for an input file
+        * @param path Path of the input file
+        * @return The record, or nullopt if the file was never hashed
+        * @note Thread-safe: locks one shard shared
+        */
+        std::optional<FileRecord> findFileRecord(const std::string& path) const;
+
+        /**
+        * @brief Store the record for an input file
+        * @param path Path of the input file
+        * @param record The stat tuple and hash to remember
+        * @note Thread-safe: locks one shard exclusively
+        */
+        void setFileRecord(const std::string& path, const FileRecord& record);
+
+        /**
+        * @brief Get the wall time a target's command took the last time it ran
+        * @param targetName Name of the target
+        * @return Duration in microseconds, or nullopt if the target never ran
+        * @note Thread-safe: locks one shard shared
+        */
+        std::optional<std::uint64_t> findDuration(const std::string& targetName) const;
+
+        /**
+        * @brief Remember how long a target's command took
+        * @param targetName Name of the target
+        * @param durationUs Wall time in microseconds
+        * @note Thread-safe: locks one shard exclusively. Durations outlive
+        *       removeSignature() so a forced rebuild keeps its history; clear()
+        *       drops them.
+        */
+        void setDuration(const std::string& targetName, std::uint64_t durationUs);
+
+        /**
+        * @brief Get the digest a restat target's outputs had after its last build
+        * @param targetName Name of the target
+        * @return The output signature, or nullopt if none was recorded
+        * @note Thread-safe: locks one shard shared
+        */
+        std::optional<std::string> findOutputSignature(const std::string& targetName) const;
+
+        /**
+        * @brief Remember the digest of a target's outputs
+        * @param targetName Name of the target
+        * @param signature Combined signature of its output files
+        * @note Thread-safe: locks one shard exclusively. Like durations, output
+        *       signatures outlive removeSignature(); clear() drops them.
+        */
+        void setOutputSignature(const std::string& targetName, const std::string& signature);
+
+        /**
+        * @brief Get the number of remembered input files
+        * @return Number of file records
+        * @note Thread-safe: locks every shard shared
+        */
+        size_t fileRecordCount() const;
+
+        /**
+        * @brief Get the number of lock shards
+        * @return Shard count
+        */
+        size_t shardCount() const noexcept;
+
         /**
         * @brief Remove a target's signature from the cache
         * @param targetName Name of the target to remove
         * @return True if the target was found and removed
-        * @note Thread-safe: acquires exclusive lock
+        * @note Thread-safe: locks one shard exclusively
         */
         bool removeSignature(const std::string& targetName);
 
         /**
-        * @brief Clear all cached signatures
-        * @note Thread-safe: acquires exclusive lock
+        * @brief Clear all cached signatures and file records
+        * @note Thread-safe: locks every shard exclusively
         */
         void clear();
 
         /**
         * @brief Get the number of cached signatures
         * @return Number of entries in the cache
-        * @note Thread-safe: acquires shared lock
+        * @note Thread-safe: locks every shard shared
         */
         size_t size() const;
 
         /**
         * @brief Check if the cache is empty
         * @return True if no signatures are cached
-        * @note Thread-safe: acquires shared lock
+        * @note Thread-safe: locks every shard shared
         */
         bool empty() const;
 
@@ -131,20 +268,148 @@ namespace mimir
 
         /**
         * @brief Get the cache file path
-        * @return Const reference to the cache file path
+        * @return Const reference to the binary cache file path
         */
         const std::string& getCacheFile() const noexcept;
 
+        /**
+        * @brief Get the text-format signature file path
+        * @return Const reference to the text cache file path
+        */
+        const std::string& getTextCacheFile() const noexcept;
+
+        /**
+        * @brief Get the text-format file record path
+        * @return Const reference to the text file record path
+        */
+        const std::string& getFileRecordFile() const noexcept;
+
+        /**
+        * @brief Get the text-format duration file path
+        * @return Const reference to the text duration file path
+        */
+        const std::string& getDurationFile() const noexcept;
+
+        /**
+        * @brief Get the text-format output signature file path
+        * @return Const reference to the text output signature file path
+        */
+        const std::string& getOutputSignatureFile() const noexcept;
+
+        /**
+        * @brief Get the journal path
+        * @return Const reference to the journal path
+        */
+        const std::string& getJournalFile() const noexcept;
+
     private:
+        /// @brief Independently locked slice of the in-memory overlay \struct Shard
+        struct alignas(64) Shard
+        {
+            mutable std::shared_mutex mutex;
+            /// Changes since load(); nullopt marks an entry removed from the image
+            std::unordered_map<std::string, std::optional<std::string>> signatures;
+            std::unordered_map<std::string, std::optional<FileRecord>> fileRecords;
+            std::unordered_map<std::string, std::uint64_t> durations;
+            std::unordered_map<std::string, std::string> outputSignatures;
+        };
+
+        using ExclusiveLocks = std::vector<std::unique_lock<std::shared_mutex>>;
+        using SharedLocks = std::vector<std::shared_lock<std::shared_mutex>>;
+
         /**
         * @brief Ensure the cache directory exists
         * @return True if directory exists or was created
         */
         bool ensureCacheDir() const;
 
+        /**
+        * @brief Pick the shard that owns a key
+        * @param key Target name or file path
+        * @return The owning shard
+        */
+        Shard& shardFor(const std::string& key) const;
+
+        /**
+        * @brief Lock every shard exclusively, in index order
+        * @return The held locks
+        */
+        ExclusiveLocks lockAllShards() const;
+
+        /**
+        * @brief Lock every shard shared, in index order
+        * @return The held locks
+        */
+        SharedLocks lockAllShardsShared() const;
+
+        /**
+        * @brief Look up a signature in the overlay, then the mapped image
+        * @param shard The shard owning targetName (locked by the caller)
+        * @param targetName Name of the target
+        * @return The signature, or nullopt if absent or removed
+        */
+        std::optional<std::string> lookupSignature(const Shard& shard, const std::string& targetName) const;
+
+        /**
+        * @brief Look up a file record in the overlay, then the mapped image
+        * @param shard The shard owning path (locked by the caller)
+        * @param path Path of the input file
+        * @return The record, or nullopt if absent or removed
+        */
+        std::optional<FileRecord> lookupFileRecord(const Shard& shard, const std::string& path) const;
+
+        /**
+        * @brief Drop the image and every overlay entry
+        * @note Caller must hold every shard exclusively
+        */
+        void resetLocked();
+
+        /**
+        * @brief Apply one replayed journal record to the overlay
+        * @param entry The decoded record
+        * @note Caller must hold every shard exclusively
+        */
+        void applyJournalEntry(const JournalEntry& entry);
+
+        /**
+        * @brief Write the selected format and empty the journal
+        * @return True if the snapshot was written
+        * @note Caller must hold every shard
+        */
+        bool writeSnapshot() const;
+
+        /**
+        * @brief Parse the text format into the overlay
+        * @return True if cache.txt was read
+        * @note Caller must hold every shard exclusively
+        */
+        bool loadText();
+
+        /**
+        * @brief Write the text format
+        * @return True if every text file was written
+        * @note Caller must hold every shard
+        */
+        bool saveText() const;
+
+        /**
+        * @brief Write the binary format
+        * @return True if cache.bin was written
+        * @note Caller must hold every shard
+        */
+        bool saveBinary() const;
+
         std::string cacheDir_;
         std::string cacheFile_;
-        std::unordered_map<std::string, std::string> signatures_;
-        mutable std::shared_mutex mutex_;
+        std::string textCacheFile_;
+        std::string fileRecordFile_;
+        std::string durationFile_;
+        std::string outputSignatureFile_;
+        std::string journalFile_;
+        CacheFormat format_;             ///< Guarded by all shards
+        std::unique_ptr<CacheJournal> journal_;  ///< Replaced only with every shard held
+        CacheImage image_;               ///< Immutable snapshot; replaced only with every shard held
+        std::unique_ptr<Shard[]> shards_;
+        size_t shardMask_;
     };
 } // namespace mimir
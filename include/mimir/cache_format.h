@@ -0,0 +1,254 @@
+#pragma once
+
+#include "file_stat.h"
+#include "hasher.h"
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/// @brief On-disk formats of the build cache \namespace mimir
+namespace mimir
+{
+    /// @brief Content hash of an input file, remembered together with its stat tuple \struct FileRecord
+    struct FileRecord
+    {
+        FileStamp stamp;                ///< stat() result when the file was hashed
+        std::int64_t hashedAtNs = 0;    ///< Wall-clock time of the hash
+        HashAlgorithm algorithm = HashAlgorithm::SHA256;  ///< Algorithm that produced the hash
+        std::string hash;               ///< Content signature of the file
+    };
+
+    /// @brief Format written by Cache::save() \enum CacheFormat
+    enum class CacheFormat
+    {
+        Binary,     ///< Memory-mappable cache.bin (default)
+        Text        ///< Versioned line-based cache.txt / files.txt / durations.txt / outputs.txt
+    };
+
+    /**
+    * @brief Durably replace a file's contents
+    * @param path Destination path
+    * @param parts Contents, written back to back
+    * @return True if the new contents are on disk under path
+    * @note Writes path + ".tmp", syncs it, renames it over path and syncs the
+    *       directory, so after a crash path holds its old or its new contents
+    *       in full. On failure path is left as it was.
+    */
+    bool replaceFileDurably(const std::string& path, const std::vector<std::string_view>& parts);
+
+    /// @brief Read-only, memory-mapped view of a binary cache file \class CacheImage
+    /// @details Layout: a fixed header, a signature index sorted by target name,
+    ///          a file record index sorted by path, a duration index sorted by
+    ///          target name, an output signature index sorted by target name,
+    ///          then a string pool. Index entries are fixed width and refer to
+    ///          the pool by offset, so lookups are binary searches straight
+    ///          over the mapping. Version 1 files (no duration index) and
+    ///          version 2 files (no output signature index) are still read.
+    class CacheImage
+    {
+    public:
+        /// Magic bytes at the start of every binary cache
+        static constexpr char MAGIC[8] = {'M', 'I', 'M', 'I', 'R', 'C', 'B', '\0'};
+
+        /// Current binary format version
+        static constexpr std::uint32_t VERSION = 3;
+
+        /// Oldest binary format version open() accepts
+        static constexpr std::uint32_t MIN_VERSION = 1;
+
+        /// A (key, value) pair handed to write()
+        using SignatureEntry = std::pair<std::string_view, std::string_view>;
+
+        /// A (path, record) pair handed to write()
+        using FileRecordEntry = std::pair<std::string_view, const FileRecord*>;
+
+        /// A (target, wall time in microseconds) pair handed to write()
+        using DurationEntry = std::pair<std::string_view, std::uint64_t>;
+
+        /**
+        * @brief Construct an empty (unmapped) image
+        */
+        CacheImage() = default;
+
+        /**
+        * @brief Unmap the file
+        */
+        ~CacheImage();
+
+        /**
+        * @brief Image is not copyable
+        */
+        CacheImage(const CacheImage&) = delete;
+
+        /**
+        * @brief Image is not copy-assignable
+        */
+        CacheImage& operator=(const CacheImage&) = delete;
+
+        /**
+        * @brief Image is movable
+        * @param other Image to move from
+        */
+        CacheImage(CacheImage&& other) noexcept;
+
+        /**
+        * @brief Image is move-assignable
+        * @param other Image to move from
+        * @return Reference to this image
+        */
+        CacheImage& operator=(CacheImage&& other) noexcept;
+
+        /**
+        * @brief Map a binary cache file and validate its structure
+        * @param path Path of the cache file
+        * @return True if the file exists and is a valid image of this version
+        */
+        bool open(const std::string& path);
+
+        /**
+        * @brief Unmap the file, leaving the image empty
+        */
+        void close() noexcept;
+
+        /**
+        * @brief Check if a file is mapped
+        * @return True after a successful open()
+        */
+        bool isOpen() const noexcept;
+
+        /**
+        * @brief Look up a target signature
+        * @param targetName Name of the target
+        * @return View into the mapping, or nullopt if absent
+        */
+        std::optional<std::string_view> findSignature(std::string_view targetName) const noexcept;
+
+        /**
+        * @brief Look up an input file record
+        * @param path Path of the input file
+        * @return Copy of the record, or nullopt if absent
+        */
+        std::optional<FileRecord> findFileRecord(std::string_view path) const;
+
+        /**
+        * @brief Look up a target's last recorded build time
+        * @param targetName Name of the target
+        * @return Wall time in microseconds, or nullopt if absent
+        */
+        std::optional<std::uint64_t> findDuration(std::string_view targetName) const noexcept;
+
+        /**
+        * @brief Look up the digest of a target's outputs
+        * @param targetName Name of the target
+        * @return View into the mapping, or nullopt if absent
+        */
+        std::optional<std::string_view> findOutputSignature(std::string_view targetName) const noexcept;
+
+        /**
+        * @brief Get the number of target signatures
+        * @return Number of signature entries
+        */
+        size_t signatureCount() const noexcept;
+
+        /**
+        * @brief Get the number of file records
+        * @return Number of file record entries
+        */
+        size_t fileRecordCount() const noexcept;
+
+        /**
+        * @brief Get the number of recorded durations
+        * @return Number of duration entries (0 for a version 1 file)
+        */
+        size_t durationCount() const noexcept;
+
+        /**
+        * @brief Get the number of recorded output signatures
+        * @return Number of output signature entries (0 before version 3)
+        */
+        size_t outputSignatureCount() const noexcept;
+
+        /**
+        * @brief Get a signature entry by index
+        * @param index Index below signatureCount()
+        * @return Target name and signature
+        */
+        SignatureEntry signatureAt(size_t index) const noexcept;
+
+        /**
+        * @brief Get a file record entry by index
+        * @param index Index below fileRecordCount()
+        * @return Path and a copy of the record
+        */
+        std::pair<std::string_view, FileRecord> fileRecordAt(size_t index) const;
+
+        /**
+        * @brief Get a duration entry by index
+        * @param index Index below durationCount()
+        * @return Target name and wall time in microseconds
+        */
+        DurationEntry durationAt(size_t index) const noexcept;
+
+        /**
+        * @brief Get an output signature entry by index
+        * @param index Index below outputSignatureCount()
+        * @return Target name and output signature
+        */
+        SignatureEntry outputSignatureAt(size_t index) const noexcept;
+
+        /**
+        * @brief Write a binary cache file durably through replaceFileDurably()
+        * @param path Destination path
+        * @param signatures Target signatures, in any order
+        * @param records Input file records, in any order
+        * @param durations Target build times, in any order
+        * @param outputs Output signatures of restat targets, in any order
+        * @return True if the file was written
+        */
+        static bool write(
+            const std::string& path,
+            std::vector<SignatureEntry> signatures,
+            std::vector<FileRecordEntry> records,
+            std::vector<DurationEntry> durations = {},
+            std::vector<SignatureEntry> outputs = {});
+
+    private:
+        struct Header;
+        struct SignatureSlot;
+        struct FileSlot;
+        struct DurationSlot;
+
+        /**
+        * @brief Check the mapped bytes form a complete, consistent image
+        * @return True if every index entry points inside the string pool
+        */
+        bool validate() const noexcept;
+
+        /**
+        * @brief Resolve a pool reference
+        * @param offset Offset into the pool
+        * @param length Length of the string
+        * @return View into the mapping
+        */
+        std::string_view poolString(std::uint32_t offset, std::uint32_t length) const noexcept;
+
+        const Header* header() const noexcept;
+        const SignatureSlot* signatureSlots() const noexcept;
+        const FileSlot* fileSlots() const noexcept;
+        const DurationSlot* durationSlots() const noexcept;
+        const SignatureSlot* outputSlots() const noexcept;
+
+        /**
+        * @brief Get the size of the header as laid out by the mapped file's version
+        * @return Header bytes preceding the signature index
+        */
+        size_t headerSize() const noexcept;
+
+        const char* data_ = nullptr;
+        size_t size_ = 0;
+        bool mapped_ = false;           ///< True if data_ came from mmap (false: heap copy)
+    };
+} // namespace mimir
@@ -0,0 +1,191 @@
+#pragma once
+
+#include "cache_format.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/// @brief Append-only write-ahead log for cache updates \namespace mimir
+namespace mimir
+{
+    /// @brief Kind of change stored in a journal record \enum JournalRecordType
+    enum class JournalRecordType : std::uint8_t
+    {
+        SetSignature = 1,       ///< key = target, value = signature
+        RemoveSignature = 2,    ///< key = target
+        SetFileRecord = 3,      ///< key = path, record = stat tuple and hash
+        RemoveFileRecord = 4,   ///< key = path
+        Clear = 5,              ///< Drop everything recorded so far
+        SetDuration = 6,        ///< key = target, durationUs = last build time
+        SetOutputSignature = 7  ///< key = target, value = digest of its outputs
+    };
+
+    /// @brief One decoded journal record \struct JournalEntry
+    struct JournalEntry
+    {
+        JournalRecordType type = JournalRecordType::Clear;
+        std::string key;
+        std::string value;
+        FileRecord record;
+        std::uint64_t durationUs = 0;
+    };
+
+    /// @brief Result of scanning a journal file \struct JournalReplayResult
+    struct JournalReplayResult
+    {
+        size_t records = 0;             ///< Records applied
+        std::uint64_t validBytes = 0;   ///< Length of the intact prefix (0 if the file is missing or foreign)
+        bool truncatedTail = false;     ///< True if a torn or corrupt record was found after the prefix
+    };
+
+    /// @brief Append-only journal with a background writer that batches fsyncs \class CacheJournal
+    /// @details Each record is framed as [length][crc32][payload]. Appends are
+    ///          encoded on the caller's thread and queued; the writer thread
+    ///          writes everything queued so far with one write() and one
+    ///          fdatasync(), so concurrent updates during a sync share the next one.
+    ///          A crash loses at most the records queued since the last sync.
+    class CacheJournal
+    {
+    public:
+        /**
+        * @brief Construct a journal for a path (nothing is opened yet)
+        * @param path Path of the journal file
+        */
+        explicit CacheJournal(std::string path);
+
+        /**
+        * @brief Flush pending records and stop the writer
+        */
+        ~CacheJournal();
+
+        /**
+        * @brief Journal is not copyable
+        */
+        CacheJournal(const CacheJournal&) = delete;
+
+        /**
+        * @brief Journal is not copy-assignable
+        */
+        CacheJournal& operator=(const CacheJournal&) = delete;
+
+        /**
+        * @brief Open the file for appending and start the writer thread
+        * @return True if the journal is ready
+        * @note A torn tail left by a crash is cut off before appending
+        */
+        bool open();
+
+        /**
+        * @brief Check if the journal is open and no write has failed
+        * @return True if appends are reaching disk
+        */
+        bool good() const noexcept;
+
+        /**
+        * @brief Queue a signature update
+        * @param targetName Name of the target
+        * @param signature The new signature
+        */
+        void appendSetSignature(const std::string& targetName, const std::string& signature);
+
+        /**
+        * @brief Queue a signature removal
+        * @param targetName Name of the target
+        */
+        void appendRemoveSignature(const std::string& targetName);
+
+        /**
+        * @brief Queue a file record update
+        * @param path Path of the input file
+        * @param record The new record
+        */
+        void appendFileRecord(const std::string& path, const FileRecord& record);
+
+        /**
+        * @brief Queue a file record removal
+        * @param path Path of the input file
+        */
+        void appendRemoveFileRecord(const std::string& path);
+
+        /**
+        * @brief Queue a build time update
+        * @param targetName Name of the target
+        * @param durationUs Wall time of its command in microseconds
+        */
+        void appendDuration(const std::string& targetName, std::uint64_t durationUs);
+
+        /**
+        * @brief Queue an output signature update
+        * @param targetName Name of the target
+        * @param signature Digest of its outputs
+        */
+        void appendOutputSignature(const std::string& targetName, const std::string& signature);
+
+        /**
+        * @brief Queue a record that discards all earlier state
+        */
+        void appendClear();
+
+        /**
+        * @brief Block until every record queued so far is on disk
+        */
+        void flush();
+
+        /**
+        * @brief Discard all records (after their contents were compacted elsewhere)
+        * @note Flushes first; the caller must prevent concurrent appends
+        */
+        void truncate();
+
+        /**
+        * @brief Get the current size of the journal file
+        * @return Bytes on disk, including the header
+        */
+        std::uint64_t sizeBytes() const noexcept;
+
+        /**
+        * @brief Get the journal path
+        * @return Const reference to the path
+        */
+        const std::string& getPath() const noexcept;
+
+        /**
+        * @brief Decode a journal file, applying each intact record in order
+        * @param path Path of the journal file
+        * @param apply Called for each record
+        * @return Number of records and length of the intact prefix
+        */
+        static JournalReplayResult replay(
+            const std::string& path,
+            const std::function<void(const JournalEntry&)>& apply);
+
+    private:
+        /**
+        * @brief Frame and queue an encoded payload
+        * @param payload Encoded record
+        */
+        void enqueue(const std::string& payload);
+
+        /**
+        * @brief Writer thread body
+        */
+        void writerLoop();
+
+        std::string path_;
+        int fd_ = -1;
+        std::thread writer_;
+        mutable std::mutex mutex_;
+        std::condition_variable pendingCv_;
+        std::condition_variable syncedCv_;
+        std::string pending_;
+        std::uint64_t enqueuedSeq_ = 0;
+        std::uint64_t syncedSeq_ = 0;
+        bool stopping_ = false;
+        std::atomic<bool> failed_{false};
+        std::atomic<std::uint64_t> sizeBytes_{0};
+    };
+} // namespace mimir
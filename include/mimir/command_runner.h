@@ -1,20 +1,35 @@
 #pragma once
 
+#include "output_buffer.h"
 #include <string>
 #include <memory>
 #include <functional>
 #include <optional>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 
 /// @brief Command execution abstraction for testability and portability \namespace mimir
 namespace mimir
 {
+    /// @brief Resources consumed by a finished command \struct ResourceUsage
+    struct ResourceUsage
+    {
+        double userSeconds = 0.0;   ///< CPU time spent in user mode
+        double systemSeconds = 0.0; ///< CPU time spent in the kernel
+        long maxRssKb = 0;          ///< Peak resident set size in KiB
+    };
+
     /// @brief Result of command execution \struct CommandResult
     struct CommandResult
     {
-        int exitCode;           ///< Process exit code (0 = success)
+        int exitCode;           ///< Process exit code (0 = success, 128+N if killed by signal N)
         std::string stdOut;     ///< Standard output captured
         std::string stdErr;     ///< Standard error captured
         bool timedOut;          ///< True if command timed out
+        ResourceUsage usage{};  ///< Resource usage reported by wait4 (zero if unavailable)
+        double spawnSeconds = 0.0;  ///< Time from run() until the process was started (zero if unavailable)
+        size_t droppedBytes = 0;    ///< Captured bytes discarded from the front to stay within maxCaptureBytes
 
         /**
         * @brief Check if command succeeded
@@ -33,6 +48,11 @@ namespace mimir
         std::optional<int> timeoutSeconds;  ///< Timeout in seconds (nullopt = no timeout)
         bool captureOutput;                 ///< Whether to capture stdout/stderr
         bool inheritEnvironment;            ///< Whether to inherit parent environment
+        size_t maxCaptureBytes;             ///< Per-stream capture limit; only the last bytes are kept
+        std::vector<std::pair<std::string, std::string>> environment;  ///< Variables set on top of the (inherited or empty) environment
+        bool hermetic;                      ///< The command reads only inputs and writes only outputs, so it may run elsewhere
+        std::vector<std::string> inputs;    ///< Files a hermetic command reads
+        std::vector<std::string> outputs;   ///< Files a hermetic command writes
 
         /**
         * @brief Default options
@@ -42,6 +62,11 @@ namespace mimir
             , timeoutSeconds(std::nullopt)
             , captureOutput(false)
             , inheritEnvironment(true)
+            , maxCaptureBytes(OutputBuffer::DEFAULT_CAPACITY)
+            , environment()
+            , hermetic(false)
+            , inputs()
+            , outputs()
         {
         }
     };
@@ -78,7 +103,12 @@ namespace mimir
     */
     using CommandRunnerPtr = std::shared_ptr<ICommandRunner>;
 
-    /// @brief Default command runner using system calls \class SystemCommandRunner
+    /// @brief Default command runner that spawns processes directly \class SystemCommandRunner
+    /// @note Uses posix_spawn, so no fork of the (possibly large, multithreaded)
+    ///       parent is made. Commands without shell syntax are exec'd directly;
+    ///       anything else runs under /bin/sh -c. Captured output is read from
+    ///       pipes with poll() into per-call ring buffers, so nothing touches
+    ///       the disk. Falls back to std::system on Windows.
     class SystemCommandRunner : public ICommandRunner
     {
     public:
@@ -95,8 +125,10 @@ namespace mimir
         /**
         * @brief Execute a shell command
         * @param command The command string to execute
-        * @param options Execution options (workingDir and captureOutput supported)
-        * @return Result of command execution
+        * @param options Execution options (all supported)
+        * @return Result of command execution, including rusage
+        * @note With timeoutSeconds set the command runs in its own process group,
+        *       which ProcessSupervisor terminates (SIGTERM, then SIGKILL) on expiry
         */
         CommandResult run(
             const std::string& command,
@@ -108,9 +140,18 @@ namespace mimir
         * @return True if command succeeded (exit code 0)
         */
         bool runSimple(const std::string& command) override;
+
+        /**
+        * @brief Split a command that can be exec'd without a shell
+        * @param command The command string
+        * @return The argument vector, or nullopt if the command uses quoting,
+        *         expansion, redirection, variable assignment or a shell builtin
+        */
+        static std::optional<std::vector<std::string>> directArguments(const std::string& command);
     };
 
     /// @brief Mock command runner for unit testing \class MockCommandRunner
+    /// @note Safe to share between executor worker threads
     class MockCommandRunner : public ICommandRunner
     {
     public:
@@ -188,6 +229,7 @@ namespace mimir
         CommandHandler handler_;
         std::string lastCommand_;
         size_t commandCount_;
+        mutable std::mutex mutex_;
     };
 
     /**
@@ -0,0 +1,181 @@
+#pragma once
+
+#include "dag.h"
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/// @brief Frozen, integer-indexed form of the build graph \namespace mimir
+namespace mimir
+{
+    /**
+    * @brief Dense index of a target inside a CompiledGraph
+    */
+    using NodeId = std::uint32_t;
+
+    /**
+    * @brief Sentinel for "no node"
+    */
+    constexpr NodeId INVALID_NODE = std::numeric_limits<NodeId>::max();
+
+    /// @brief Read-only view over a contiguous run of CSR indices \struct IdRange
+    struct IdRange
+    {
+        const std::uint32_t* first;  ///< First index in the run
+        const std::uint32_t* last;   ///< One past the last index
+
+        const std::uint32_t* begin() const noexcept { return first; }
+        const std::uint32_t* end() const noexcept { return last; }
+        size_t size() const noexcept { return static_cast<size_t>(last - first); }
+        bool empty() const noexcept { return first == last; }
+        std::uint32_t operator[](size_t i) const noexcept { return first[i]; }
+    };
+
+    /// @brief Immutable CSR snapshot of a DAG with dense node IDs \class CompiledGraph
+    /// @note Holds pointers to the DAG's targets; the DAG must outlive the graph
+    ///       and must not be modified while the graph is in use.
+    class CompiledGraph
+    {
+    public:
+        /**
+        * @brief Compile a DAG into dense integer form
+        * @param dag The DAG to compile
+        */
+        explicit CompiledGraph(const DAG& dag);
+
+        /**
+        * @brief Graph is not copyable
+        */
+        CompiledGraph(const CompiledGraph&) = delete;
+
+        /**
+        * @brief Graph is not copy-assignable
+        */
+        CompiledGraph& operator=(const CompiledGraph&) = delete;
+
+        /**
+        * @brief Graph is movable
+        */
+        CompiledGraph(CompiledGraph&&) noexcept = default;
+
+        /**
+        * @brief Graph is move-assignable
+        */
+        CompiledGraph& operator=(CompiledGraph&&) noexcept = default;
+
+        /**
+        * @brief Get the number of targets
+        * @return Number of nodes
+        */
+        size_t nodeCount() const noexcept;
+
+        /**
+        * @brief Get the number of resolved dependency edges
+        * @return Number of edges
+        */
+        size_t edgeCount() const noexcept;
+
+        /**
+        * @brief Find a node by target name
+        * @param name Target name
+        * @return Node ID, or INVALID_NODE if the target does not exist
+        */
+        NodeId findNode(std::string_view name) const;
+
+        /**
+        * @brief Get the target name of a node
+        * @param node A valid node ID
+        * @return View of the target's name
+        */
+        std::string_view nodeName(NodeId node) const noexcept;
+
+        /**
+        * @brief Get the target a node was compiled from
+        * @param node A valid node ID
+        * @return Reference to the DAG's target
+        */
+        const Target& target(NodeId node) const noexcept;
+
+        /**
+        * @brief Get the resolved dependencies of a node
+        * @param node A valid node ID
+        * @return Deduplicated dependency node IDs
+        */
+        IdRange dependencies(NodeId node) const noexcept;
+
+        /**
+        * @brief Get the nodes that depend on a node
+        * @param node A valid node ID
+        * @return Dependent node IDs
+        */
+        IdRange dependents(NodeId node) const noexcept;
+
+        /**
+        * @brief Get the number of dependencies that name no existing target
+        * @param node A valid node ID
+        * @return Count of unresolved dependency names
+        */
+        std::uint32_t unresolvedDependencies(NodeId node) const noexcept;
+
+        /**
+        * @brief Compute the number of dependencies a node waits on before it can run
+        * @param node A valid node ID
+        * @return Resolved plus unresolved dependency count
+        */
+        std::uint32_t inDegree(NodeId node) const noexcept;
+
+        /**
+        * @brief Topologically sort the graph (dependencies first)
+        * @return Node IDs in build order; nodes on a cycle or behind an
+        *         unresolved dependency are omitted
+        */
+        std::vector<NodeId> topologicalOrder() const;
+
+        /**
+        * @brief Compute every node's critical path: the heaviest chain from it to a sink
+        * @param weights Cost of each node, indexed by node ID
+        * @return For each node, its own weight plus the largest critical path
+        *         among its dependents; 0 for nodes omitted by topologicalOrder()
+        */
+        std::vector<std::uint64_t> criticalPaths(const std::vector<std::uint64_t>& weights) const;
+
+        /**
+        * @brief Find every strongly connected component that contains a cycle
+        * @details Iterative Tarjan over the dependency edges: one linear pass,
+        *          no recursion, so arbitrarily deep chains are safe.
+        * @return Cyclic components (size > 1, or a single self-dependent node)
+        */
+        std::vector<std::vector<NodeId>> cyclicComponents() const;
+
+        /**
+        * @brief Extract one concrete cycle from a cyclic component
+        * @param component A component returned by cyclicComponents()
+        * @return Nodes along the cycle, with the first node repeated at the end
+        */
+        std::vector<NodeId> cycleIn(const std::vector<NodeId>& component) const;
+
+    private:
+        /**
+        * @brief Build a CSR range view
+        * @param offsets Offset array
+        * @param indices Index array
+        * @param node Row to view
+        * @return Range of indices for the row
+        */
+        static IdRange row(
+            const std::vector<std::uint32_t>& offsets,
+            const std::vector<std::uint32_t>& indices,
+            NodeId node) noexcept;
+
+        std::unordered_map<std::string_view, NodeId> nodeIds_;  ///< Views into the DAG's target names
+        std::vector<const Target*> targets_;
+        std::vector<std::uint32_t> unresolved_;
+        std::vector<std::uint32_t> depOffsets_;
+        std::vector<std::uint32_t> deps_;
+        std::vector<std::uint32_t> dependentOffsets_;
+        std::vector<std::uint32_t> dependents_;
+    };
+} // namespace mimir
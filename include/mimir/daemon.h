@@ -0,0 +1,238 @@
+#pragma once
+
+#include "dag.h"
+#include "cache.h"
+#include "executor.h"
+#include "file_watcher.h"
+#include "glob.h"
+#include "graph_cache.h"
+#include <atomic>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/// @brief Long-lived build server and its client \namespace mimir
+namespace mimir
+{
+    /// @brief Settings for a BuildDaemon \struct DaemonOptions
+    struct DaemonOptions
+    {
+        std::string buildFile = "build.yaml";   ///< Build file to load and watch
+        std::string cacheDir = ".mimir";        ///< Cache directory kept open by the daemon
+        std::string socketPath = ".mimir/daemon.sock";  ///< Unix socket clients connect to
+        ExecutorConfig config;                  ///< Executor settings used for every build
+        JobserverPtr jobserver;                 ///< Optional jobserver shared by every build
+        std::shared_ptr<ArtifactStore> artifactStore;   ///< Optional artifact cache shared by every build
+        std::string settings;                   ///< Fingerprint of the options above; clients sending another are refused
+    };
+
+    /// @brief Build server that keeps the graph and cache in memory \class BuildDaemon
+    /// @details The daemon parses the build file once, keeps the DAG and Cache
+    ///          loaded, and watches every input, output and build file
+    ///          (including any the build file includes), plus the headers
+    ///          recorded in the deps log.
+    ///          A change marks the targets naming that file, and everything
+    ///          depending on them, dirty. Builds then skip the signature check
+    ///          for clean targets entirely, so a no-op build never touches the
+    ///          file system. A changed build file is reparsed and everything
+    ///          becomes dirty. Targets whose files cannot be watched (or every
+    ///          target, where the platform has no watcher) are always checked.
+    ///          The directories the build file's globs list are watched as
+    ///          well. When an entry appears in or disappears from one of them,
+    ///          the globs are re-run, and the build file is reparsed if any of
+    ///          them now matches different files.
+    ///
+    ///          Clients send one request line per connection over a Unix
+    ///          socket: "build\tFILE\tGOAL..." or "stop". The reply is a series
+    ///          of "O <length>\n<bytes>" output frames ended by "X <exit code>\n",
+    ///          or "R <reason>\n" when the daemon serves a different build file.
+    class BuildDaemon
+    {
+    public:
+        /**
+        * @brief Construct a daemon; nothing is loaded until start()
+        * @param options Build file, socket and executor settings
+        * @param runner Command runner for builds (default: the system runner)
+        */
+        explicit BuildDaemon(DaemonOptions options, CommandRunnerPtr runner = nullptr);
+
+        /**
+        * @brief Save the cache and remove the socket
+        */
+        ~BuildDaemon();
+
+        /**
+        * @brief Daemon is not copyable
+        */
+        BuildDaemon(const BuildDaemon&) = delete;
+
+        /**
+        * @brief Daemon is not copy-assignable
+        */
+        BuildDaemon& operator=(const BuildDaemon&) = delete;
+
+        /**
+        * @brief Load the build file and cache without listening on the socket
+        * @return An error message, or nullopt on success
+        */
+        std::optional<std::string> load();
+
+        /**
+        * @brief Load everything and start listening
+        * @return An error message, or nullopt on success
+        * @note Fails if another daemon already answers on the socket
+        */
+        std::optional<std::string> start();
+
+        /**
+        * @brief Serve clients until stop() is called or a client sends "stop"
+        */
+        void serve();
+
+        /**
+        * @brief Make serve() return
+        * @note Async-signal-safe, so it may be called from a signal handler
+        */
+        void stop() noexcept;
+
+        /**
+        * @brief Build goals with the in-memory graph
+        * @param goals Targets to build; empty builds everything
+        * @param sink Receives status lines, command output and the summary
+        * @return Exit code for the client (0 on success)
+        */
+        int build(const std::vector<std::string>& goals, const OutputSink& sink);
+
+        /**
+        * @brief Apply pending file change events
+        * @note build() calls this first; serve() also calls it as events arrive
+        */
+        void refresh();
+
+        /**
+        * @brief Check if a target will be checked by the next build
+        * @param target Target name
+        * @return True if a watched file changed or the target has not built cleanly
+        */
+        bool isDirty(const std::string& target) const;
+
+        /**
+        * @brief Get the number of dirty targets
+        * @return Dirty targets
+        */
+        size_t dirtyCount() const;
+
+        /**
+        * @brief Get the socket path
+        * @return Path clients connect to
+        */
+        const std::string& socketPath() const noexcept;
+
+        /**
+        * @brief Get the normalized build file path clients must ask for
+        * @return Absolute path of the build file
+        */
+        const std::string& buildFile() const noexcept;
+
+    private:
+        /**
+        * @brief Parse the build file and rebuild the graph and file index
+        * @return An error message, or nullopt on success
+        */
+        std::optional<std::string> loadGraph();
+
+        /**
+        * @brief Watch every file the graph names, remembering which ones failed
+        */
+        void watchFiles();
+
+        /**
+        * @brief Watch the directories the last parse's globs list
+        * @note A missing base directory is watched through its nearest existing
+        *       ancestor. If any directory cannot be watched, the globs are
+        *       re-run on every refresh instead.
+        */
+        void watchProbeDirectories();
+
+        /**
+        * @brief Re-run the last parse's globs
+        * @return True if any of them matches different files now
+        */
+        bool probesChanged();
+
+        /**
+        * @brief Mark targets and everything depending on them dirty
+        * @param targets Target names
+        */
+        void markDirty(const std::vector<std::string>& targets);
+
+        /**
+        * @brief Map the dependencies a target's last build discovered to the target
+        * @param target The target
+        * @return True if a path was added to fileTargets_
+        */
+        bool addDiscoveredDeps(const Target& target);
+
+        /**
+        * @brief Mark every target dirty
+        */
+        void markAllDirty();
+
+        /**
+        * @brief Answer one client connection
+        * @param fd Connected socket
+        */
+        void handleClient(int fd);
+
+        DaemonOptions options_;
+        CommandRunnerPtr runner_;
+        std::string buildFile_;     ///< Normalized build file path
+        std::unordered_set<std::string> buildFiles_;    ///< Normalized build file and the files it includes
+        Cache cache_;
+        std::shared_ptr<DepsLog> depsLog_;     ///< Headers discovered by builds, watched like inputs
+        DAG dag_;
+        PoolCapacities pools_;
+        std::optional<std::string> loadError_;  ///< Set while the build file fails to parse
+        FileWatcher watcher_;
+        std::unordered_map<std::string, std::vector<std::string>> fileTargets_;  ///< Normalized path -> targets naming it
+        std::unordered_set<std::string> dirty_;
+        std::unordered_set<std::string> unwatched_;     ///< Targets with a file the watcher cannot see
+        std::vector<GlobProbe> probes_;                 ///< Glob lookups the last parse depended on
+        std::unordered_set<std::string> probeDirs_;     ///< Normalized directories those lookups list
+        bool probesUnwatched_ = false;                  ///< Some probe directory has no watch
+        GlobEngine globEngine_{1};                      ///< Re-runs the probes; listings are reused while unchanged
+        bool reloadPending_ = false;
+        bool loaded_ = false;       ///< The cache was loaded, so it may be saved
+        int listenFd_ = -1;
+        int wakeRead_ = -1;
+        int wakeWrite_ = -1;
+        std::atomic<bool> stopping_{false};
+    };
+
+    /**
+    * @brief Run a build on a running daemon
+    * @param socketPath Daemon socket
+    * @param buildFile Build file the client would have loaded
+    * @param settings Fingerprint of the client's build options (see DaemonOptions::settings)
+    * @param goals Targets to build; empty builds everything
+    * @param out Receives the daemon's output
+    * @return The build's exit code, or nullopt if no daemon serves this build
+    *         file with these settings
+    */
+    std::optional<int> buildOnDaemon(
+        const std::string& socketPath,
+        const std::string& buildFile,
+        const std::string& settings,
+        const std::vector<std::string>& goals,
+        std::ostream& out);
+
+    /**
+    * @brief Ask a running daemon to exit
+    * @param socketPath Daemon socket
+    * @return True if a daemon answered
+    */
+    bool stopDaemon(const std::string& socketPath);
+} // namespace mimir
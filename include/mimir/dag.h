@@ -14,7 +14,8 @@ namespace mimir
     struct CycleDetectionResult
     {
         bool hasCycle;                      ///< True if a cycle was detected
-        std::vector<std::string> cycleNodes; ///< Nodes involved in the cycle
+        std::vector<std::string> cycleNodes; ///< One cycle path, first node repeated at the end
+        std::vector<std::vector<std::string>> components; ///< Every strongly connected component containing a cycle
     };
 
     /// @brief Directed Acyclic Graph (DAG) for build targets \class DAG
@@ -95,6 +96,8 @@ namespace mimir
         /**
         * @brief Detect cycles and return the cycle path if found
         * @return CycleDetectionResult containing cycle information
+        * @note Runs an iterative Tarjan pass over the compiled graph, so every
+        *       cyclic component is reported and deep chains cannot overflow the stack
         */
         CycleDetectionResult detectCyclesWithPath() const;
 
@@ -107,7 +110,7 @@ namespace mimir
         /**
         * @brief Perform topological sort on the DAG
         * @return Vector of target names in topologically sorted order (dependencies first)
-        * @note Returns empty vector if a cycle is detected
+        * @note Runs in O(V+E); targets on a cycle or behind a missing dependency are omitted
         */
         std::vector<std::string> topologicalSort() const;
 
@@ -122,6 +125,8 @@ namespace mimir
         * @brief Get a target by name (mutable version)
         * @param name The name of the target
         * @return Pointer to the Target, or nullptr if not found
+        * @note Dependency edits made through this pointer bypass the dependents
+        *       index; remove and re-add the target to change its edges
         */
         Target* getTarget(const std::string& name);
 
@@ -172,30 +177,33 @@ namespace mimir
         * @brief Get all targets that depend on a given target
         * @param name Name of the target
         * @return Vector of dependent target names
+        * @note Answered from the dependents index in O(out-degree)
         */
         std::vector<std::string> getDependents(const std::string& name) const;
 
         /**
         * @brief Validate that all dependencies exist in the DAG
-        * @return Vector of missing dependency names (empty if all valid)
+        * @return Vector of missing dependency names, each reported once (empty if all valid)
         */
         std::vector<std::string> validateDependencies() const;
 
+        /**
+        * @brief Extract the targets needed to build a set of goals
+        * @param goals Names of the targets to build
+        * @return A DAG holding the goals and their transitive dependencies
+        * @note Targets are shared with this DAG, not copied. Unknown goals and
+        *       missing dependencies are skipped, so check hasTarget() first.
+        */
+        DAG closure(const std::vector<std::string>& goals) const;
+
     private:
         /**
-        * @brief Utility function for cycle detection using DFS
-        * @param node Current node being visited
-        * @param visited Map of visited nodes (0=unvisited, 1=in-progress, 2=completed)
-        * @param recStack Current recursion stack for path tracking
-        * @param cycleNodes Output parameter for the cycle nodes if found
-        * @return True if a cycle is detected
+        * @brief Record a target's dependency edges in the dependents index
+        * @param target The target being added
         */
-        bool hasCycleUtil(
-            const std::string& node,
-            std::unordered_map<std::string, int>& visited,
-            std::vector<std::string>& recStack,
-            std::vector<std::string>& cycleNodes) const;
+        void indexDependencies(const Target& target);
 
         std::unordered_map<std::string, TargetPtr> targets_;
+        std::unordered_map<std::string, std::vector<std::string>> dependents_;  ///< Reverse edges: dependency -> dependents
     };
 } // namespace mimir
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// @brief Readers for the dependency lists compilers emit \namespace mimir
+namespace mimir
+{
+    /// Prefix cl.exe puts before every header it opens under /showIncludes
+    constexpr std::string_view SHOW_INCLUDES_PREFIX = "Note: including file:";
+
+    /**
+    * @brief Parse a Makefile-style depfile (gcc/clang -MD, -MMD, -MP)
+    * @param text The depfile's contents
+    * @return Prerequisites of every rule in first-seen order without duplicates,
+    *         or nullopt if the text is not a depfile
+    * @note Understands line continuations, `\ ` and `\#` escapes, `$$`, and
+    *       colons inside paths such as Windows drive letters. Other backslashes
+    *       are kept, so Windows separators survive.
+    */
+    std::optional<std::vector<std::string>> parseDepfile(std::string_view text);
+
+    /**
+    * @brief Extract the headers cl.exe reports with /showIncludes
+    * @param output The command's standard output
+    * @param filtered Receives output without the include notes
+    * @return Reported headers in first-seen order without duplicates
+    */
+    std::vector<std::string> parseShowIncludes(std::string_view output, std::string& filtered);
+} // namespace mimir
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// @brief Persistent record of dependencies discovered while building \namespace mimir
+namespace mimir
+{
+    /// @brief Discovered dependencies per target, kept in a compact binary log \class DepsLog
+    /// @details The file starts with a magic/version/byte-order header and is
+    ///          followed by records framed as [u32 size | deps bit][payload].
+    ///          A path record holds a path and the one's complement of the id
+    ///          it receives (ids count up from 0 in file order), so a torn
+    ///          write is caught. A deps record holds the id of a target name
+    ///          followed by the ids of its dependencies; the latest record for
+    ///          a target wins. Records are appended as targets finish. A
+    ///          corrupt tail is cut off on open, and a log that is mostly
+    ///          superseded records is rewritten.
+    class DepsLog
+    {
+    public:
+        /// Magic bytes at the start of every deps log
+        static constexpr char MAGIC[8] = {'M', 'I', 'M', 'I', 'R', 'D', 'L', '\0'};
+
+        /// Current format version
+        static constexpr std::uint32_t VERSION = 1;
+
+        /// Shared, immutable dependency list of one target
+        using DepsPtr = std::shared_ptr<const std::vector<std::string>>;
+
+        /**
+        * @brief Construct a log for a path (nothing is opened yet)
+        * @param path Path of the log file
+        */
+        explicit DepsLog(std::string path);
+
+        /**
+        * @brief Close the file
+        */
+        ~DepsLog();
+
+        DepsLog(const DepsLog&) = delete;
+        DepsLog& operator=(const DepsLog&) = delete;
+
+        /**
+        * @brief Read the log and open it for appending
+        * @return True if the log can be appended to; a missing or foreign file starts empty
+        */
+        bool open();
+
+        /**
+        * @brief Close the file, keeping what was loaded in memory
+        */
+        void close();
+
+        /**
+        * @brief Check if the log is open for appending
+        * @return True after a successful open()
+        */
+        bool isOpen() const;
+
+        /**
+        * @brief Get a target's discovered dependencies
+        * @param target Target name
+        * @return The dependencies from its last successful build, or nullptr if none were recorded
+        * @note Thread-safe
+        */
+        DepsPtr getDeps(const std::string& target) const;
+
+        /**
+        * @brief Record a target's discovered dependencies
+        * @param target Target name
+        * @param deps Dependencies reported by its command
+        * @return True if the record is in the file (an unchanged list writes nothing)
+        * @note Thread-safe
+        */
+        bool record(const std::string& target, std::vector<std::string> deps);
+
+        /**
+        * @brief Rewrite the file with only the latest record of each target
+        * @return True if the log was rewritten and reopened
+        */
+        bool recompact();
+
+        /**
+        * @brief Get the number of targets with recorded dependencies
+        * @return Target count
+        */
+        size_t size() const;
+
+        /**
+        * @brief Get the path of the log file
+        * @return The path
+        */
+        const std::string& getPath() const noexcept;
+
+    private:
+        /**
+        * @brief Parse the file into memory
+        * @return False if it is missing or not a deps log; a corrupt tail is cut off
+        */
+        bool load();
+
+        /**
+        * @brief Rewrite the file from memory and reopen it for appending; the lock must be held
+        * @return True on success; on failure the old file is left in place and closed
+        */
+        bool compactLocked();
+
+        /**
+        * @brief Truncate the file to a fresh header and open it for appending
+        * @return True on success
+        */
+        bool startFile();
+
+        /**
+        * @brief Write one framed record
+        * @param payload Record contents
+        * @param deps True for a deps record, false for a path record
+        * @return True on success
+        */
+        bool writeRecord(const std::string& payload, bool deps);
+
+        /**
+        * @brief Get a path's id, writing a path record for unseen paths
+        * @param path The path (or target name)
+        * @param id Receives the id
+        * @return True on success
+        */
+        bool intern(const std::string& path, std::uint32_t& id);
+
+        std::string path_;
+        std::FILE* file_ = nullptr;
+        mutable std::mutex mutex_;
+        std::vector<std::string> paths_;                    ///< Path by id
+        std::unordered_map<std::string, std::uint32_t> ids_;///< Id by path
+        std::unordered_map<std::string, DepsPtr> deps_;     ///< Latest dependencies by target
+        size_t depsRecords_ = 0;                            ///< Deps records in the file, superseded ones included
+    };
+} // namespace mimir
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// @brief Build-scoped memo of file content digests \namespace mimir
+namespace mimir
+{
+    /// @brief Thread-safe, sharded path -> digest memo that computes each digest once \class FileDigestTable
+    /// @note Intended to live for one build: a file that changes mid-build keeps
+    ///       the digest first computed for it.
+    class FileDigestTable
+    {
+    public:
+        /**
+        * @brief Function that computes the digest of a path on a miss
+        */
+        using ComputeFn = std::function<std::string(const std::string& path)>;
+
+        /**
+        * @brief Construct an empty table
+        * @param shardCount Number of independently locked shards (rounded up to a power of two)
+        */
+        explicit FileDigestTable(size_t shardCount = 64);
+
+        /**
+        * @brief Table is not copyable
+        */
+        FileDigestTable(const FileDigestTable&) = delete;
+
+        /**
+        * @brief Table is not copy-assignable
+        */
+        FileDigestTable& operator=(const FileDigestTable&) = delete;
+
+        /**
+        * @brief Get a path's digest, computing it on first use
+        * @param path The file path
+        * @param compute Called at most once per path across all threads
+        * @return The memoized digest
+        * @note Concurrent callers for the same path block until the single
+        *       computation finishes; callers for other paths are not blocked.
+        *       If compute throws, the next caller retries.
+        */
+        std::string get(const std::string& path, const ComputeFn& compute);
+
+        /**
+        * @brief Get the number of paths in the table
+        * @return Number of entries
+        */
+        size_t size() const;
+
+        /**
+        * @brief Get how many times a digest was actually computed
+        * @return Number of compute calls that completed
+        */
+        size_t computations() const noexcept;
+
+        /**
+        * @brief Drop all entries
+        * @note Must not race with get()
+        */
+        void clear();
+
+    private:
+        /// @brief One memoized digest \struct Entry
+        struct Entry
+        {
+            std::once_flag once;
+            std::string digest;
+        };
+
+        /// @brief Independently locked slice of the table \struct Shard
+        struct Shard
+        {
+            mutable std::mutex mutex;
+            std::unordered_map<std::string, std::unique_ptr<Entry>> entries;
+        };
+
+        /**
+        * @brief Pick the shard responsible for a path
+        * @param path The file path
+        * @return The owning shard
+        */
+        Shard& shardFor(const std::string& path);
+
+        std::vector<Shard> shards_;
+        size_t mask_;
+        std::atomic<size_t> computations_{0};
+    };
+} // namespace mimir
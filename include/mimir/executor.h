@@ -1,13 +1,22 @@
 #pragma once
 
 #include "dag.h"
+#include "compiled_graph.h"
 #include "cache.h"
 #include "command_runner.h"
+#include "digest_table.h"
+#include "artifact_store.h"
+#include "build_trace.h"
+#include "deps_log.h"
+#include "load_governor.h"
+#include "jobserver.h"
 #include <string>
+#include <vector>
 #include <memory>
 #include <functional>
 #include <atomic>
 #include <mutex>
+#include <optional>
 
 /// @brief Executor for building targets in a DAG \namespace mimir
 namespace mimir
@@ -17,7 +26,7 @@ namespace mimir
     * @param targetName Name of the target being processed
     * @param current Current target number (1-based)
     * @param total Total number of targets
-    * @param status Status message (BUILDING, UP-TO-DATE, FAILED, SUCCESS)
+    * @param status Status message (BUILDING, UP-TO-DATE, RESTORED, FAILED, SUCCESS)
     */
     using ProgressCallback = std::function<void(
         const std::string& targetName,
@@ -25,6 +34,19 @@ namespace mimir
         size_t total,
         const std::string& status)>;
 
+    /**
+    * @brief Destination for status lines and command output
+    * @param text One status line plus the target's output, written whole
+    */
+    using OutputSink = std::function<void(const std::string& text)>;
+
+    /**
+    * @brief Predicate marking targets that are known to be up to date
+    * @param target The target about to be checked
+    * @return True to report the target up to date without hashing its inputs
+    */
+    using UpToDateHint = std::function<bool(const Target& target)>;
+
     /// @brief Statistics about a build execution \struct BuildStats
     struct BuildStats
     {
@@ -32,6 +54,8 @@ namespace mimir
         size_t builtTargets;    ///< Number of targets that were built
         size_t skippedTargets;  ///< Number of targets skipped (up-to-date)
         size_t failedTargets;   ///< Number of targets that failed
+        size_t restoredTargets; ///< Number of targets restored from the artifact store
+        size_t lowestJobSlots;  ///< Fewest job slots adaptive concurrency allowed (0 if not used)
         double elapsedSeconds;  ///< Total build time in seconds
 
         /**
@@ -42,11 +66,20 @@ namespace mimir
             , builtTargets(0)
             , skippedTargets(0)
             , failedTargets(0)
+            , restoredTargets(0)
+            , lowestJobSlots(0)
             , elapsedSeconds(0.0)
         {
         }
     };
 
+    /// @brief Scheduling strategy used for multi-threaded builds \enum SchedulerType
+    enum class SchedulerType
+    {
+        SharedQueue,    ///< One ready queue shared by all workers
+        WorkStealing    ///< Per-worker deques with LIFO local pop and FIFO steal
+    };
+
     /// @brief Configuration options for the executor \struct ExecutorConfig
     struct ExecutorConfig
     {
@@ -55,6 +88,13 @@ namespace mimir
         bool verbose;               ///< If true, print detailed output
         bool stopOnError;           ///< If true, stop on first error
         bool colorOutput;           ///< If true, use ANSI color codes
+        SchedulerType scheduler;    ///< Scheduler used when numThreads > 1
+        bool paranoid;              ///< If true, rehash every input instead of trusting the stat cache
+        bool bufferOutput;          ///< If true, capture command output and print it with the target's status
+        std::optional<int> timeoutSeconds;  ///< Per-command time limit; an expired command fails the target
+        PoolCapacities pools;       ///< Capacity of each resource pool targets may name
+        LoadLimits loadLimits;      ///< If any is set, numThreads becomes a ceiling that load can lower
+        int remoteJobs;             ///< Extra workers for remote targets; the rest still share numThreads
 
         /**
         * @brief Default configuration
@@ -65,11 +105,27 @@ namespace mimir
             , verbose(false)
             , stopOnError(true)
             , colorOutput(true)
+            , scheduler(SchedulerType::SharedQueue)
+            , paranoid(false)
+            , bufferOutput(true)
+            , timeoutSeconds(std::nullopt)
+            , pools()
+            , loadLimits()
+            , remoteJobs(0)
         {
         }
     };
 
     /// @brief Executor for building targets in a DAG \class Executor
+    /// @note With numThreads > 1, a ready target that names a pool in
+    ///       ExecutorConfig::pools only starts once the pool has room for its
+    ///       weight; until then it is parked and the worker moves on to other
+    ///       ready targets.
+    ///
+    ///       With ExecutorConfig::remoteJobs set, numThreads + remoteJobs
+    ///       workers run, and targets that are not marked remote (and name no
+    ///       pool of their own) share an implicit pool of numThreads, so only
+    ///       remote targets go beyond the local core count.
     class Executor
     {
     public:
@@ -114,6 +170,22 @@ namespace mimir
         */
         bool executeWithStats(const DAG& dag, Cache& cache, BuildStats& stats) const;
 
+        /**
+        * @brief Build only the given goals and what they depend on
+        * @param dag The DAG of targets
+        * @param goals Names of the targets to build; empty builds the whole DAG
+        * @param cache The build cache for incremental builds
+        * @param stats Output parameter for build statistics, counting only the closure
+        * @return True if the build was successful; false if a goal is not in the DAG
+        * @note Targets outside the goals' dependency closure are neither checked
+        *       nor hashed, so an edit-compile loop scales with the goal's closure
+        */
+        bool executeWithStats(
+            const DAG& dag,
+            const std::vector<std::string>& goals,
+            Cache& cache,
+            BuildStats& stats) const;
+
         /**
         * @brief Execute a single target
         * @param target The target to execute
@@ -128,6 +200,80 @@ namespace mimir
         */
         void setProgressCallback(ProgressCallback callback);
 
+        /**
+        * @brief Send status lines and command output somewhere other than stdout
+        * @param sink The sink, or nullptr for stdout
+        * @note Called under the output lock, one block per target
+        */
+        void setOutputSink(OutputSink sink);
+
+        /**
+        * @brief Skip the signature check for targets known to be up to date
+        * @param hint The predicate, or nullptr to check every target
+        * @note Used by the daemon, whose file watcher knows which targets no
+        *       input or output change can have reached. Called concurrently
+        *       from worker threads, so it must not modify shared state.
+        */
+        void setUpToDateHint(UpToDateHint hint);
+
+        /**
+        * @brief Share outputs through a content-addressed artifact store
+        * @param store The store, or nullptr to disable
+        * @note Out-of-date targets are restored from the store instead of being
+        *       run when their signature is found; built targets are published
+        *       in the background, and executeWithStats() waits for those uploads.
+        */
+        void setArtifactStore(std::shared_ptr<ArtifactStore> store);
+
+        /**
+        * @brief Get the artifact store
+        * @return The store, or nullptr if none is set
+        */
+        const std::shared_ptr<ArtifactStore>& getArtifactStore() const noexcept;
+
+        /**
+        * @brief Record the dependencies commands discover (depfiles, /showIncludes)
+        * @param log The log, or nullptr to track declared inputs only
+        * @note Discovered headers join a target's inputs for its next signature.
+        *       A target with a deps format but no record is out of date, and a
+        *       gcc depfile is deleted once it is in the log.
+        */
+        void setDepsLog(std::shared_ptr<DepsLog> log);
+
+        /**
+        * @brief Get the deps log
+        * @return The log, or nullptr if none is set
+        */
+        const std::shared_ptr<DepsLog>& getDepsLog() const noexcept;
+
+        /**
+        * @brief Record a TraceEvent for every target the next builds process
+        * @param trace The trace, or nullptr to disable tracing
+        * @note executeWithStats() restarts the trace, so it holds the last build
+        */
+        void setBuildTrace(std::shared_ptr<BuildTrace> trace);
+
+        /**
+        * @brief Get the build trace
+        * @return The trace, or nullptr if none is set
+        */
+        const std::shared_ptr<BuildTrace>& getBuildTrace() const noexcept;
+
+        /**
+        * @brief Replace the source of load samples used with ExecutorConfig::loadLimits
+        * @param probe The probe, or nullptr for the platform default
+        */
+        void setLoadProbe(LoadProbePtr probe);
+
+        /**
+        * @brief Share job slots with a GNU make jobserver
+        * @param jobserver Client or server; every command holds one of its slots while it runs
+        * @note A server's makeflags() is appended to the inherited MAKEFLAGS of
+        *       commands so nested make, ninja or mimir processes draw from the
+        *       same pool without losing the caller's other flags.
+        */
+        void setJobserver(JobserverPtr jobserver);
+
         /**
         * @brief Get the executor configuration
         * @return Const reference to the configuration
@@ -158,20 +304,120 @@ namespace mimir
         void resetCancelled();
 
     private:
+        /// @brief Outcome of processing a single target \enum TargetStatus
+        enum class TargetStatus
+        {
+            UpToDate,   ///< Target was skipped because it is up-to-date
+            Built,      ///< Target command ran successfully
+            Restored,   ///< Target outputs were fetched from the artifact store
+            Failed      ///< Target command failed
+        };
+
+        /**
+        * @brief Check whether all declared outputs of a target exist
+        * @param target The target to check
+        * @return True if every output file exists
+        */
+        bool outputsExist(const Target& target) const;
+
+        /**
+        * @brief Check, build and record a single target
+        * @param target The target to process
+        * @param cache The build cache
+        * @param digests Input digests memoized for the current build
+        * @param event Receives hash and command timings when tracing, or nullptr
+        * @return Outcome of processing the target
+        */
+        TargetStatus processTarget(
+            const Target& target,
+            Cache& cache,
+            FileDigestTable& digests,
+            TraceEvent* event = nullptr) const;
+
+        /**
+        * @brief Get the status name a trace records for an outcome
+        * @param status The outcome
+        * @return UP-TO-DATE, SUCCESS, RESTORED or FAILED
+        */
+        static const char* statusName(TargetStatus status) noexcept;
+
+        /**
+        * @brief Start a trace event for a target a worker is about to process
+        * @param graph The compiled graph
+        * @param node The target's node
+        * @param worker Index of the worker
+        * @param finishedUs Finish time of every node processed so far
+        * @return The event, with its ready time taken from its dependencies
+        */
+        TraceEvent beginTrace(const CompiledGraph& graph, NodeId node, size_t worker,
+            const std::vector<std::int64_t>& finishedUs) const;
+
+        /**
+        * @brief Complete and record a trace event
+        * @param event The event from beginTrace()
+        * @param status The target's outcome
+        * @param finishedUs Finish times; the event's node entry is set
+        * @param node The target's node
+        */
+        void endTrace(TraceEvent& event, TargetStatus status, std::vector<std::int64_t>& finishedUs,
+            NodeId node) const;
+
+        /**
+        * @brief Compute a target's current signature
+        * @param target The target
+        * @param cache The build cache, consulted for unchanged inputs unless paranoid
+        * @param digests Input digests memoized for the current build
+        * @return The target signature, covering what its dependencies last produced
+        */
+        std::string computeSignature(const Target& target, Cache& cache, FileDigestTable& digests) const;
+
+        /**
+        * @brief Hash a target's outputs as they are on disk now
+        * @param target The target
+        * @param cache The build cache, consulted for unchanged outputs unless paranoid
+        * @return Combined signature of the output files
+        * @note Bypasses the build's digest table, which may predate the command
+        */
+        std::string computeOutputSignature(const Target& target, Cache& cache) const;
+
+        /**
+        * @brief Record what dependents of a freshly built or restored target will see
+        * @param target The target
+        * @param signature Its new target signature
+        * @param cache The build cache
+        */
+        void recordOutputSignature(const Target& target, const std::string& signature, Cache& cache) const;
+
         /**
         * @brief Check if a target is out of date
         * @param target The target to check
+        * @param signature The target's current signature
         * @param cache The build cache
         * @return True if the target needs rebuilding
         */
-        bool isOutOfDate(const Target& target, const Cache& cache) const;
+        bool isOutOfDate(const Target& target, const std::string& signature, const Cache& cache) const;
 
         /**
-        * @brief Run a shell command
-        * @param command The command to run
-        * @return True if the command succeeded
+        * @brief Check if a target's discovered dependencies have never been recorded
+        * @param target The target
+        * @return True if it reports dependencies but the deps log has none for it
         */
-        bool runCommand(const std::string& command) const;
+        bool depsUnknown(const Target& target) const;
+
+        /**
+        * @brief Run a target's command
+        * @param target The target; a remote one is passed to the runner with its files
+        * @param capture Capture output instead of passing it through
+        * @return The command result
+        * @note Remote targets don't hold a jobserver slot when remoteJobs is set
+        */
+        CommandResult runCommand(const Target& target, bool capture) const;
+
+        /**
+        * @brief Get the number of parallel workers
+        * @return numThreads plus remoteJobs
+        */
+        int workerCount() const noexcept;
 
         /**
         * @brief Execute targets in single-threaded mode
@@ -185,6 +431,9 @@ namespace mimir
             Cache& cache,
             BuildStats& stats) const;
 
+        /// @brief Dense scheduling state shared by the parallel schedulers \struct ScheduleState
+        struct ScheduleState;
+
         /**
         * @brief Execute targets in multi-threaded mode
         * @param dag The DAG of targets
@@ -197,20 +446,79 @@ namespace mimir
             Cache& cache,
             BuildStats& stats) const;
 
+        /**
+        * @brief Run ready targets from one queue shared by all workers
+        * @details Each target carries a pending-dependency counter; when it
+        *          drops to zero the target is pushed onto the shared ready queue
+        *          and exactly one idle worker is woken for it. The queue is
+        *          ordered by critical path, weighted by the durations the cache
+        *          recorded on earlier builds.
+        * @param state Scheduling state for the build
+        * @param cache The build cache
+        */
+        void runSharedQueue(ScheduleState& state, Cache& cache) const;
+
+        /**
+        * @brief Run ready targets on a work-stealing pool
+        * @details A worker that unblocks several dependents keeps the one with
+        *          the longest critical path for itself and pushes the rest onto
+        *          its own deque, where idle workers steal them oldest-first.
+        * @param state Scheduling state for the build
+        * @param cache The build cache
+        */
+        void runWorkStealing(ScheduleState& state, Cache& cache) const;
+
+        /**
+        * @brief Process one scheduled target and collect newly ready dependents
+        * @param state Scheduling state for the build
+        * @param cache The build cache
+        * @param idx Node of the target to process
+        * @param worker Index of the worker processing it
+        * @param unblocked Output list of dependents whose counters reached zero,
+        *        plus targets that were parked waiting for the pool capacity
+        *        this target gave back
+        * @return Outcome of processing the target
+        */
+        TargetStatus runScheduled(
+            ScheduleState& state,
+            Cache& cache,
+            NodeId idx,
+            size_t worker,
+            std::vector<NodeId>& unblocked) const;
+
+        /**
+        * @brief Check whether workers should stop taking new targets
+        * @param state Scheduling state for the build
+        * @return True if the build was cancelled or failed with stopOnError
+        */
+        bool shouldStop(const ScheduleState& state) const;
+
         /**
         * @brief Print status message with optional color
-        * @param status Status tag (BUILD, SUCCESS, FAILED, UP-TO-DATE)
+        * @param status Status tag (BUILD, SUCCESS, FAILED, UP-TO-DATE, RESTORED)
         * @param targetName Name of the target
-        * @param message Optional additional message
+        * @param message Optional additional message (shown when verbose)
+        * @param output Captured command output, always shown
+        * @note The status line and output are written under one lock, so output
+        *       of parallel targets never interleaves
         */
         void printStatus(
             const std::string& status,
             const std::string& targetName,
-            const std::string& message = "") const;
+            const std::string& message = "",
+            const std::string& output = "") const;
 
         ExecutorConfig config_;
         CommandRunnerPtr commandRunner_;
         ProgressCallback progressCallback_;
+        OutputSink outputSink_;
+        UpToDateHint upToDateHint_;
+        std::shared_ptr<ArtifactStore> artifactStore_;
+        std::shared_ptr<DepsLog> depsLog_;
+        std::shared_ptr<BuildTrace> trace_;
+        LoadProbePtr loadProbe_;
+        JobserverPtr jobserver_;
+        std::string childMakeflags_;    ///< MAKEFLAGS for commands when serving, else empty
         mutable std::atomic<bool> cancelled_;
         mutable std::mutex outputMutex_;
 
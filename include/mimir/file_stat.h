@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+/// @brief Lightweight file metadata queries \namespace mimir
+namespace mimir
+{
+    /// A file whose mtime is this close to the time it was read may have been
+    /// modified again within the same timestamp tick, so its stamp is not trusted
+    constexpr std::int64_t TIMESTAMP_SLACK_NS = 1000000000;
+
+    /// @brief The stat tuple used to detect file changes without reading contents \struct FileStamp
+    struct FileStamp
+    {
+        std::uint64_t size = 0;     ///< File size in bytes
+        std::int64_t mtimeNs = 0;   ///< Modification time in nanoseconds since the epoch
+        std::uint64_t inode = 0;    ///< Inode number (0 where unavailable)
+
+        bool operator==(const FileStamp& other) const noexcept
+        {
+            return size == other.size && mtimeNs == other.mtimeNs && inode == other.inode;
+        }
+
+        bool operator!=(const FileStamp& other) const noexcept
+        {
+            return !(*this == other);
+        }
+    };
+
+    /**
+    * @brief stat() a path
+    * @param path The file to query
+    * @return The file's stamp, or nullopt if it does not exist or is not a regular file
+    */
+    std::optional<FileStamp> statFile(const std::string& path);
+
+    /**
+    * @brief stat() a directory
+    * @param path The directory to query
+    * @return The directory's stamp, or nullopt if it does not exist or is not a directory
+    * @note A directory's mtime changes whenever an entry is created, removed or renamed
+    */
+    std::optional<FileStamp> statDirectory(const std::string& path);
+
+    /**
+    * @brief Get the current wall-clock time on the same scale as FileStamp::mtimeNs
+    * @return Nanoseconds since the epoch
+    */
+    std::int64_t currentTimeNs() noexcept;
+} // namespace mimir
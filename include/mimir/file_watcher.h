@@ -0,0 +1,110 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/// @brief Change notification for build inputs and outputs \namespace mimir
+namespace mimir
+{
+    /// @brief Reports changes to a set of files \class FileWatcher
+    /// @details Watches the directory holding each file rather than the file
+    ///          itself, so editors that save by writing a new file and renaming
+    ///          it over the old one are still seen. Events for names nobody
+    ///          asked about are dropped. Uses inotify on Linux; elsewhere
+    ///          available() is false and callers must assume anything changed.
+    class FileWatcher
+    {
+    public:
+        /**
+        * @brief Open the notification channel
+        */
+        FileWatcher();
+
+        /**
+        * @brief Close the notification channel
+        */
+        ~FileWatcher();
+
+        /**
+        * @brief Watcher is not copyable
+        */
+        FileWatcher(const FileWatcher&) = delete;
+
+        /**
+        * @brief Watcher is not copy-assignable
+        */
+        FileWatcher& operator=(const FileWatcher&) = delete;
+
+        /**
+        * @brief Check if change notification works on this system
+        * @return True if watch() can succeed
+        */
+        bool available() const noexcept;
+
+        /**
+        * @brief Start reporting changes to a file
+        * @param path File to watch; it need not exist, but its directory must
+        * @return True if changes to path will be reported
+        */
+        bool watch(const std::string& path);
+
+        /**
+        * @brief Start reporting entries appearing in or disappearing from a directory
+        * @param path Directory to watch; it must exist
+        * @return True if poll() will report the directory's own path when an
+        *         entry is created, deleted or renamed in or out of it
+        * @note Changes to the contents of existing entries are not reported
+        */
+        bool watchDirectory(const std::string& path);
+
+        /**
+        * @brief Stop watching everything
+        */
+        void clear();
+
+        /**
+        * @brief Collect changes reported since the last call
+        * @param timeoutMs How long to wait for a first event (0: don't wait, -1: forever)
+        * @return Normalized paths of watched files that changed and of watched
+        *         directories whose entries changed, each once
+        */
+        std::vector<std::string> poll(int timeoutMs = 0);
+
+        /**
+        * @brief Check if events were lost since the last call
+        * @return True once after the kernel queue overflowed or a watched
+        *         directory went away; callers should treat every file as changed
+        */
+        bool takeOverflow() noexcept;
+
+        /**
+        * @brief Get the descriptor that becomes readable when events arrive
+        * @return The descriptor, or -1 if unavailable
+        */
+        int fd() const noexcept;
+
+        /**
+        * @brief Normalize a path the way watch() and poll() report it
+        * @param path Relative or absolute path
+        * @return Absolute, lexically normal path without a trailing separator
+        */
+        static std::string normalize(const std::string& path);
+
+    private:
+        /**
+        * @brief Add an inotify watch for a directory unless it has one
+        * @param directory Normalized directory path
+        * @return True if the directory is watched
+        */
+        bool addDirectory(const std::string& directory);
+
+        int fd_ = -1;
+        bool overflow_ = false;
+        std::unordered_map<int, std::string> directories_;      ///< Watch descriptor -> directory
+        std::unordered_map<std::string, int> directoryWatches_; ///< Directory -> watch descriptor
+        std::unordered_set<std::string> files_;                 ///< Normalized watched files
+        std::unordered_set<std::string> listings_;              ///< Normalized directories watched for entry changes
+    };
+} // namespace mimir
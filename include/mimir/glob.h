@@ -0,0 +1,187 @@
+#pragma once
+
+#include "file_stat.h"
+#include "thread_pool.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/// @brief Glob pattern matching over cached directory listings \namespace mimir
+namespace mimir
+{
+    /// @brief A glob pattern split into its literal base and path segments \class GlobPattern
+    /// @details Within a segment, `*` matches any run of characters, `?` a single
+    ///          character and `[...]` one character of a set (`[a-z]`, negated
+    ///          with `[!...]` or `[^...]`; write `[*]` for a literal star). A
+    ///          segment that is exactly `**` matches zero or more directories,
+    ///          and a trailing `**` matches every file below its directory.
+    ///          A name starting with `.` only matches a segment that starts
+    ///          with `.` too, so wildcards and `**` skip hidden files and
+    ///          directories (.git, .mimir). Wildcards never match `/`.
+    class GlobPattern
+    {
+    public:
+        /// @brief One path segment after the literal base \struct Segment
+        struct Segment
+        {
+            std::string text;           ///< The segment as written
+            bool literal = false;       ///< No wildcard characters: compared verbatim
+            bool recursive = false;     ///< The segment is `**`
+        };
+
+        /**
+        * @brief Compile a pattern
+        * @param pattern The pattern, with `/` separating path segments
+        */
+        explicit GlobPattern(std::string_view pattern);
+
+        /**
+        * @brief Check if the pattern contains no wildcards
+        * @return True if the pattern names a single path
+        */
+        bool isLiteral() const noexcept;
+
+        /**
+        * @brief Check if the pattern contains a `**` segment
+        * @return True if matching descends an unbounded number of directories
+        */
+        bool isRecursive() const noexcept;
+
+        /**
+        * @brief Get the literal directory prefix before the first wildcard
+        * @return "" (current directory) or a prefix ending in '/'
+        */
+        const std::string& base() const noexcept;
+
+        /**
+        * @brief Get the segments after base()
+        * @return Segments, the first of which has wildcards (empty for literal patterns)
+        */
+        const std::vector<Segment>& segments() const noexcept;
+
+        /**
+        * @brief Match one file name against one segment
+        * @param glob The segment, with `*`, `?` and `[...]` wildcards
+        * @param name The file name
+        * @return True if name matches the whole segment; a leading '.' in name must be matched by one in glob
+        */
+        static bool matchSegment(std::string_view glob, std::string_view name) noexcept;
+
+    private:
+        std::string base_;
+        std::vector<Segment> segments_;
+        bool recursive_ = false;
+    };
+
+    /// @brief Expands glob patterns against shared, cached directory listings \class GlobEngine
+    /// @details Each directory is read once per pass no matter how many patterns
+    ///          touch it, and the subtree under a `**` is read on a thread pool
+    ///          before it is matched. Listings outlive the pass: the next pass
+    ///          reuses a listing while its directory's stat tuple is unchanged
+    ///          and was not within TIMESTAMP_SLACK_NS of the read. The engine is
+    ///          safe to use from several threads at once.
+    class GlobEngine
+    {
+    public:
+        /**
+        * @brief Create an engine
+        * @param numThreads Threads used to read directory trees (<= 1 reads on the calling thread)
+        */
+        explicit GlobEngine(size_t numThreads);
+
+        /**
+        * @brief Finish outstanding reads and stop the thread pool
+        */
+        ~GlobEngine();
+
+        GlobEngine(const GlobEngine&) = delete;
+        GlobEngine& operator=(const GlobEngine&) = delete;
+
+        /**
+        * @brief Start a new pass over the file system
+        * @note Listings from earlier passes are revalidated by their directory's stamp
+        */
+        void beginPass();
+
+        /**
+        * @brief Expand a pattern
+        * @param pattern The glob pattern
+        * @return Matching files in sorted order; a literal pattern yields itself if the path exists
+        */
+        std::vector<std::string> expand(const std::string& pattern);
+
+        /**
+        * @brief Get the number of directories read from disk so far
+        * @return Directory reads, not counting listings served from the cache
+        */
+        size_t directoriesRead() const noexcept;
+
+    private:
+        /// @brief A directory entry's name and what it points to \struct Entry
+        struct Entry
+        {
+            std::string name;
+            bool directory = false;     ///< A directory, or a symlink to one
+            bool symlink = false;       ///< A symlink; `**` does not descend into these
+        };
+
+        /// Sorted entries of one directory
+        using Listing = std::vector<Entry>;
+
+        /// @brief Cache slot for one directory, locked while it is being read \struct Slot
+        struct Slot
+        {
+            std::mutex mutex;
+            std::shared_ptr<const Listing> listing;
+            std::optional<FileStamp> stamp;     ///< Directory stamp taken before the read
+            std::int64_t listedAtNs = 0;        ///< currentTimeNs() before the read
+            std::uint64_t pass = 0;             ///< Pass the listing was last read or validated in
+        };
+
+        /**
+        * @brief Get a directory's listing, reading it if this pass has not
+        * @param prefix "" for the current directory, otherwise a path ending in '/'
+        * @return The listing (empty if the directory cannot be read)
+        */
+        std::shared_ptr<const Listing> list(const std::string& prefix);
+
+        /**
+        * @brief Read a directory tree on the thread pool so matching finds it cached
+        * @param prefix Root of the tree, as for list()
+        */
+        void prefetch(const std::string& prefix);
+
+        /**
+        * @brief Match segments from index onwards below a directory
+        * @param pattern The compiled pattern
+        * @param prefix Directory the remaining segments are matched in, as for list()
+        * @param index First unmatched segment
+        * @param out Receives matching files
+        */
+        void match(const GlobPattern& pattern, const std::string& prefix, size_t index,
+            std::vector<std::string>& out);
+
+        /**
+        * @brief Add every file below a directory, not following directory symlinks
+        * @param prefix The directory, as for list()
+        * @param out Receives the files
+        */
+        void collect(const std::string& prefix, std::vector<std::string>& out);
+
+        size_t numThreads_;
+        std::unique_ptr<ThreadPool> pool_;
+        std::atomic<std::uint64_t> pass_{1};
+        std::atomic<size_t> reads_{0};
+        std::mutex mutex_;      ///< Guards slots_, patterns_ and walked_
+        std::unordered_map<std::string, std::unique_ptr<Slot>> slots_;
+        std::unordered_map<std::string, std::shared_ptr<const GlobPattern>> patterns_;
+        std::unordered_set<std::string> walked_;    ///< Trees prefetched this pass
+    };
+} // namespace mimir
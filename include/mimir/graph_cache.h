@@ -0,0 +1,111 @@
+#pragma once
+
+#include "file_stat.h"
+#include "hasher.h"
+#include "target.h"
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// @brief Binary cache of parsed build files \namespace mimir
+namespace mimir
+{
+    /// @brief A glob lookup whose result went into an expanded command \struct GlobProbe
+    /// @note Commands expand ${inputs}, ${outputs} and ${dependencies} to the
+    ///       files that exist at parse time, so a cached parse is only valid
+    ///       while every probe still yields the same matches.
+    struct GlobProbe
+    {
+        std::string pattern;                ///< Pattern passed to the glob expansion
+        std::vector<std::string> matches;   ///< Files it matched
+    };
+
+    /// @brief A build file pulled in by an include directive \struct SourceFile
+    struct SourceFile
+    {
+        std::string path;                   ///< Path as resolved against the including file
+        Digest hash{};                      ///< GraphCache::hashSource() of its contents
+        std::optional<FileStamp> stamp;     ///< stat() tuple taken before it was read
+    };
+
+    /// @brief Everything a parse produces \struct ParsedGraph
+    struct ParsedGraph
+    {
+        std::vector<Target> targets;        ///< Targets in file order
+        PoolCapacities pools;               ///< Resource pools defined by the files
+        std::vector<GlobProbe> probes;      ///< File system lookups the parse depended on
+        std::vector<SourceFile> includes;   ///< Included build files, in include order
+    };
+
+    /// @brief A parse read back from the graph cache \struct CachedGraph
+    struct CachedGraph
+    {
+        ParsedGraph graph;                  ///< The cached parse
+        Digest sourceHash{};                ///< Digest of the build file it was parsed from
+        std::vector<size_t> recheck;        ///< Indices of probes the cache could not vouch for
+        bool refresh = false;               ///< Some stamp could not be trusted; rewrite once the probes check out
+    };
+
+    /// @brief Reads and writes parsed build files in a compact binary form \class GraphCache
+    /// @details The cache holds one parse: the build file's path, stat tuple and
+    ///          content digest, and the resulting targets, pools and glob probes
+    ///          as length-prefixed records. Included build files are recorded
+    ///          the same way as the root. An unchanged stat tuple stands in for
+    ///          rehashing a build file, and probes confined to one directory
+    ///          are vouched for by that directory's stat tuple, whose mtime
+    ///          moves whenever an entry appears or disappears. Stamps within TIMESTAMP_SLACK_NS
+    ///          of the parse are not trusted. Anything that does not match —
+    ///          another file, changed contents, a different format version, a
+    ///          truncated or foreign-endian file — reads back as a miss.
+    class GraphCache
+    {
+    public:
+        /// Magic bytes at the start of every graph cache
+        static constexpr char MAGIC[8] = {'M', 'I', 'M', 'I', 'R', 'G', 'C', '\0'};
+
+        /// Current format version; bump whenever parsing results could change
+        static constexpr std::uint32_t VERSION = 5;
+
+        /**
+        * @brief Hash build file contents the way the cache keys them
+        * @param contents The build file's bytes
+        * @return Digest of the contents
+        */
+        static Digest hashSource(std::string_view contents) noexcept;
+
+        /**
+        * @brief Read a cached parse
+        * @param path Cache file
+        * @param buildFile Build file the caller is parsing
+        * @param contents The build file's current bytes (hashed only if its stamp changed)
+        * @param sourceStamp The build file's stat tuple, taken before reading contents
+        * @return The cached parse, or nullopt on any mismatch or corruption
+        * @note The caller must re-run the probes listed in CachedGraph::recheck
+        */
+        static std::optional<CachedGraph> load(
+            const std::string& path,
+            std::string_view buildFile,
+            std::string_view contents,
+            const std::optional<FileStamp>& sourceStamp);
+
+        /**
+        * @brief Write a parse atomically (temp file + rename)
+        * @param path Cache file
+        * @param buildFile Build file that was parsed
+        * @param sourceHash hashSource() of the contents that were parsed
+        * @param sourceStamp The build file's stat tuple, taken before reading contents
+        * @param parsedAtNs currentTimeNs() before the build file was stat'ed
+        * @param graph Parse result
+        * @return True if the file was written
+        */
+        static bool write(
+            const std::string& path,
+            std::string_view buildFile,
+            const Digest& sourceHash,
+            const std::optional<FileStamp>& sourceStamp,
+            std::int64_t parsedAtNs,
+            const ParsedGraph& graph);
+    };
+} // namespace mimir
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+/// @brief Streaming cryptographic hash engine used for signatures \namespace mimir
+namespace mimir
+{
+    /// @brief Hash algorithms available for signatures \enum HashAlgorithm
+    enum class HashAlgorithm
+    {
+        SHA256,     ///< FIPS 180-4 SHA-256 (SHA-NI / ARMv8 crypto when available)
+        BLAKE3      ///< BLAKE3 with a 256-bit output (4 or 8 chunks per step with SSE4.1 / AVX2)
+    };
+
+    /**
+    * @brief Raw 256-bit digest
+    */
+    using Digest = std::array<std::uint8_t, 32>;
+
+    /// @brief Internal streaming state for the hash implementations \namespace detail
+    namespace detail
+    {
+        /// @brief SHA-256 streaming state \struct Sha256State
+        struct Sha256State
+        {
+            std::uint32_t h[8];          ///< Chaining state
+            std::uint64_t length;        ///< Total bytes absorbed
+            std::uint8_t buffer[64];     ///< Partial block
+            size_t bufferLen;            ///< Bytes in the partial block
+        };
+
+        /// @brief BLAKE3 streaming state (chunk state plus CV stack) \struct Blake3State
+        struct Blake3State
+        {
+            std::uint32_t key[8];           ///< Key words (the IV for plain hashing)
+            std::uint32_t cv[8];            ///< Chaining value of the current chunk
+            std::uint64_t chunkCounter;     ///< Index of the current chunk
+            std::uint8_t block[64];         ///< Partial block of the current chunk
+            std::uint8_t blockLen;          ///< Bytes in the partial block
+            std::uint8_t blocksCompressed;  ///< Full blocks already compressed in this chunk
+            std::uint32_t cvStack[54][8];   ///< Subtree chaining values awaiting merge
+            std::uint8_t cvStackLen;        ///< Entries on the CV stack
+        };
+
+        void sha256Init(Sha256State& state) noexcept;
+        void sha256Update(Sha256State& state, const std::uint8_t* data, size_t len) noexcept;
+        void sha256Final(Sha256State& state, std::uint8_t out[32]) noexcept;
+        bool sha256Accelerated() noexcept;
+
+        void blake3Init(Blake3State& state) noexcept;
+        void blake3Update(Blake3State& state, const std::uint8_t* data, size_t len) noexcept;
+        void blake3Final(const Blake3State& state, std::uint8_t out[32]) noexcept;
+    } // namespace detail
+
+    /// @brief Incremental hasher over a selectable algorithm \class Hasher
+    /// @note Holds its state inline; hashing never allocates
+    class Hasher
+    {
+    public:
+        /**
+        * @brief Start a new hash computation
+        * @param algorithm The algorithm to use
+        */
+        explicit Hasher(HashAlgorithm algorithm);
+
+        /**
+        * @brief Absorb bytes
+        * @param data Pointer to the bytes
+        * @param len Number of bytes
+        */
+        void update(const void* data, size_t len) noexcept;
+
+        /**
+        * @brief Absorb a string
+        * @param data The bytes to absorb
+        */
+        void update(std::string_view data) noexcept;
+
+        /**
+        * @brief Finish and return the raw digest
+        * @return 32-byte digest
+        * @note The hasher must not be updated afterwards
+        */
+        Digest finalize() noexcept;
+
+        /**
+        * @brief Finish and return the digest as lowercase hex
+        * @return 64-character hex string
+        */
+        std::string finalizeHex();
+
+        /**
+        * @brief Get the algorithm this hasher runs
+        * @return The hash algorithm
+        */
+        HashAlgorithm algorithm() const noexcept;
+
+        /**
+        * @brief One-shot hash of a buffer
+        * @param algorithm The algorithm to use
+        * @param data The bytes to hash
+        * @return Lowercase hex digest
+        */
+        static std::string hashHex(HashAlgorithm algorithm, std::string_view data);
+
+        /**
+        * @brief Convert a digest to lowercase hex
+        * @param digest The digest to format
+        * @return 64-character hex string
+        */
+        static std::string toHex(const Digest& digest);
+
+        /**
+        * @brief Get the canonical name of an algorithm
+        * @param algorithm The algorithm
+        * @return "sha256" or "blake3"
+        */
+        static const char* algorithmName(HashAlgorithm algorithm) noexcept;
+
+        /**
+        * @brief Parse an algorithm name
+        * @param name Name such as "sha256" or "blake3"
+        * @return The algorithm, or nullopt if unknown
+        */
+        static std::optional<HashAlgorithm> parseAlgorithm(std::string_view name) noexcept;
+
+        /**
+        * @brief Check if SHA-256 runs on hardware instructions on this CPU
+        * @return True if SHA-NI or ARMv8 SHA2 instructions are used
+        */
+        static bool hardwareSha256() noexcept;
+
+    private:
+        HashAlgorithm algorithm_;
+        union
+        {
+            detail::Sha256State sha256_;
+            detail::Blake3State blake3_;
+        };
+    };
+} // namespace mimir
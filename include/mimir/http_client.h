@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+/// @brief Minimal blocking HTTP/1.1 client \namespace mimir
+namespace mimir
+{
+    /// @brief Parsed http:// URL \struct HttpUrl
+    struct HttpUrl
+    {
+        std::string host;           ///< Host name or address
+        std::uint16_t port = 80;    ///< TCP port
+        std::string basePath;       ///< Path prefix without a trailing slash (may be empty)
+
+        /**
+        * @brief Parse an http:// URL
+        * @param url URL such as "http://cache:8080/mimir"
+        * @return The parsed URL, or nullopt if it is not a plain http URL
+        */
+        static std::optional<HttpUrl> parse(std::string_view url);
+    };
+
+    /// @brief Status and body of an HTTP response \struct HttpResponse
+    struct HttpResponse
+    {
+        int status = 0;     ///< HTTP status code
+        std::string body;   ///< Decoded body (empty for HEAD)
+
+        bool ok() const noexcept
+        {
+            return status >= 200 && status < 300;
+        }
+    };
+
+    /// @brief Issues one request per connection against a base URL \class HttpClient
+    /// @note Stateless and safe to share between threads. TLS is not supported;
+    ///       put a terminating proxy in front of https endpoints.
+    class HttpClient
+    {
+    public:
+        /**
+        * @brief Construct a client for a server
+        * @param baseUrl Server and path prefix
+        * @param timeoutMs Connect, send and receive timeout in milliseconds
+        */
+        explicit HttpClient(HttpUrl baseUrl, int timeoutMs = 30000);
+
+        /**
+        * @brief GET a resource
+        * @param path Path below the base URL, starting with '/'
+        * @return The response, or nullopt on a transport error
+        */
+        std::optional<HttpResponse> get(const std::string& path) const;
+
+        /**
+        * @brief HEAD a resource
+        * @param path Path below the base URL, starting with '/'
+        * @return The response, or nullopt on a transport error
+        */
+        std::optional<HttpResponse> head(const std::string& path) const;
+
+        /**
+        * @brief PUT a resource
+        * @param path Path below the base URL, starting with '/'
+        * @param body Request body
+        * @return The response, or nullopt on a transport error
+        */
+        std::optional<HttpResponse> put(const std::string& path, std::string_view body) const;
+
+        /**
+        * @brief Get the base URL
+        * @return Const reference to the base URL
+        */
+        const HttpUrl& getBaseUrl() const noexcept;
+
+    private:
+        /**
+        * @brief Send a request and read the whole response
+        * @param method HTTP method
+        * @param path Path below the base URL
+        * @param body Request body (sent with Content-Length)
+        * @return The response, or nullopt on a transport or framing error
+        */
+        std::optional<HttpResponse> request(const char* method, const std::string& path, std::string_view body) const;
+
+        HttpUrl baseUrl_;
+        int timeoutMs_;
+    };
+} // namespace mimir
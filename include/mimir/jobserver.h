@@ -0,0 +1,145 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+/// @brief GNU make jobserver protocol \namespace mimir
+namespace mimir
+{
+    /// @brief Token pool shared with make and other jobserver-aware tools \class Jobserver
+    /// @details A jobserver is a pipe or named fifo that holds one byte per job
+    ///          slot beyond the first. Every process owns one implicit slot. To
+    ///          run another job it reads a byte, and it writes the same byte back
+    ///          when that job finishes. connect() joins the jobserver announced in
+    ///          a parent's MAKEFLAGS. create() starts a new one, and makeflags()
+    ///          is what child commands need in their MAKEFLAGS to share it.
+    /// @note Reads go through a private non-blocking descriptor (the fifo opened
+    ///       again, or /proc/self/fd/N for a pipe), so a token another process
+    ///       takes first never leaves a worker blocked in read().
+    class Jobserver
+    {
+    public:
+        /// @brief Kind of jobserver created by create() \enum Style
+        enum class Style
+        {
+            Fifo,   ///< Named fifo, announced as --jobserver-auth=fifo:PATH (make 4.4+)
+            Pipe    ///< Anonymous pipe inherited by children, announced as --jobserver-auth=R,W
+        };
+
+        /**
+        * @brief Join the jobserver announced in a MAKEFLAGS value
+        * @param makeflags Contents of MAKEFLAGS
+        * @return The client, or nullptr if none is announced or it cannot be opened
+        */
+        static std::unique_ptr<Jobserver> connect(const std::string& makeflags);
+
+        /**
+        * @brief Join the jobserver announced in this process's MAKEFLAGS
+        * @return The client, or nullptr if there is none
+        */
+        static std::unique_ptr<Jobserver> fromEnvironment();
+
+        /**
+        * @brief Start a jobserver
+        * @param jobs Total parallelism; jobs - 1 tokens are put in the pool
+        * @param style Fifo or pipe
+        * @return The server, or nullptr if the fifo or pipe could not be created
+        */
+        static std::unique_ptr<Jobserver> create(size_t jobs, Style style = Style::Fifo);
+
+        /**
+        * @brief Parse the jobserver argument out of MAKEFLAGS
+        * @param makeflags Contents of MAKEFLAGS
+        * @return The value after --jobserver-auth= (or --jobserver-fds=), last one wins
+        */
+        static std::optional<std::string> authFromMakeflags(const std::string& makeflags);
+
+        /**
+        * @brief Return held tokens; a server also closes and unlinks its fifo
+        */
+        ~Jobserver();
+
+        /**
+        * @brief Jobserver is not copyable
+        */
+        Jobserver(const Jobserver&) = delete;
+
+        /**
+        * @brief Jobserver is not copy-assignable
+        */
+        Jobserver& operator=(const Jobserver&) = delete;
+
+        /**
+        * @brief Block until this process may start one more job
+        * @return True with a slot held; false once shutdown() was called
+        * @note Thread-safe. The implicit slot is handed out first.
+        */
+        bool acquire();
+
+        /**
+        * @brief Give back a slot taken by acquire()
+        * @note Thread-safe. Tokens read from the pool go back before the implicit slot.
+        */
+        void release();
+
+        /**
+        * @brief Make every current and future acquire() return false
+        */
+        void shutdown();
+
+        /**
+        * @brief Get the flags children need in MAKEFLAGS to share this jobserver
+        * @return For example " -j8 --jobserver-auth=fifo:/tmp/mimir-jobserver-123-0"
+        */
+        const std::string& makeflags() const noexcept;
+
+        /**
+        * @brief Check if this process created the jobserver
+        * @return True for create(), false for connect()
+        */
+        bool isServer() const noexcept;
+
+        /**
+        * @brief Get the number of tokens currently read from the pool
+        * @return Held tokens, not counting the implicit slot
+        */
+        size_t heldTokens() const;
+
+    private:
+        Jobserver() = default;
+
+        /**
+        * @brief Open the private descriptors and the wake pipe
+        * @param readFd Descriptor to reopen for non-blocking reads
+        * @param writeFd Descriptor tokens are written back to
+        * @return True if every descriptor is usable
+        */
+        bool openChannels(int readFd, int writeFd);
+
+        /**
+        * @brief Interrupt threads polling the pool
+        */
+        void wake() noexcept;
+
+        int readFd_ = -1;           ///< Private non-blocking read side
+        int writeFd_ = -1;          ///< Write side (owned if ownsWriteFd_)
+        bool ownsWriteFd_ = false;
+        int wakeRead_ = -1;
+        int wakeWrite_ = -1;
+        int serverFds_[2] = {-1, -1};   ///< Inheritable pipe of a pipe-style server
+        std::string fifoPath_;          ///< Fifo of a fifo-style server, unlinked on destruction
+        std::string makeflags_;
+        bool server_ = false;
+
+        mutable std::mutex mutex_;
+        bool implicitHeld_ = false;
+        bool shutdown_ = false;
+        std::vector<char> tokens_;      ///< Bytes read from the pool, written back as read
+    };
+
+    using JobserverPtr = std::shared_ptr<Jobserver>;
+} // namespace mimir
@@ -0,0 +1,186 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+
+/// @brief Job slot control driven by system load and memory pressure \namespace mimir
+namespace mimir
+{
+    /// @brief One reading of the machine's load \struct LoadSample
+    /// @note Every field is optional; a metric the platform cannot report is nullopt
+    struct LoadSample
+    {
+        std::optional<double> loadAverage;              ///< One-minute load average
+        std::optional<double> memoryPressure;           ///< PSI "some avg10": % of time tasks stalled on memory
+        std::optional<std::uint64_t> availableMemoryKb; ///< MemAvailable
+    };
+
+    /// @brief Thresholds past which the executor runs fewer jobs \struct LoadLimits
+    struct LoadLimits
+    {
+        std::optional<double> maxLoadAverage;           ///< Shrink while the load average is above this
+        std::optional<double> maxMemoryPressure;        ///< Shrink while memory PSI (percent) is above this
+        std::optional<std::uint64_t> minAvailableMemoryKb;  ///< Shrink while less memory than this is available
+
+        /**
+        * @brief Check if any limit is set
+        * @return True if adaptive concurrency should be used
+        */
+        bool enabled() const noexcept
+        {
+            return maxLoadAverage || maxMemoryPressure || minAvailableMemoryKb;
+        }
+    };
+
+    /// @brief Source of load samples \class ILoadProbe
+    class ILoadProbe
+    {
+    public:
+        virtual ~ILoadProbe() = default;
+
+        /**
+        * @brief Read the current load
+        * @return The sample; missing metrics are nullopt
+        */
+        virtual LoadSample sample() = 0;
+    };
+
+    using LoadProbePtr = std::shared_ptr<ILoadProbe>;
+
+    /// @brief Probe reading /proc/loadavg, /proc/pressure/memory and /proc/meminfo \class ProcLoadProbe
+    /// @note Where /proc/loadavg is missing (non-Linux), the load average comes
+    ///       from getloadavg() and the memory metrics stay unknown.
+    class ProcLoadProbe : public ILoadProbe
+    {
+    public:
+        /**
+        * @brief Construct a probe
+        * @param procRoot Directory holding the proc files (default: "/proc")
+        */
+        explicit ProcLoadProbe(std::string procRoot = "/proc");
+
+        /**
+        * @brief Read the current load
+        * @return The sample
+        */
+        LoadSample sample() override;
+
+    private:
+        std::string procRoot_;
+    };
+
+    /// @brief Counting semaphore whose size follows the machine's load \class LoadGovernor
+    /// @details Workers acquire() a slot before taking a target and release()
+    ///          it afterwards. Whichever thread passes through acquire() or
+    ///          release() once the sample interval has elapsed takes a new
+    ///          sample: memory pressure or low free memory halves the slot
+    ///          limit, a high load average takes one slot away, and once every
+    ///          metric is back under 80% of its threshold (or free memory above
+    ///          125%) the limit grows by one. The limit never drops below one,
+    ///          so a build always makes progress. Threads blocked in acquire()
+    ///          wake at every interval, so the limit also grows while all of
+    ///          them are waiting.
+    class LoadGovernor
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        /**
+        * @brief Construct a governor and take the first sample
+        * @param maxSlots Upper bound on the slot limit (the -j value)
+        * @param limits Thresholds that shrink the limit
+        * @param probe Source of samples
+        * @param interval Minimum time between samples
+        */
+        LoadGovernor(
+            size_t maxSlots,
+            LoadLimits limits,
+            LoadProbePtr probe,
+            std::chrono::milliseconds interval = std::chrono::milliseconds(1000));
+
+        /**
+        * @brief Governor is not copyable
+        */
+        LoadGovernor(const LoadGovernor&) = delete;
+
+        /**
+        * @brief Governor is not copy-assignable
+        */
+        LoadGovernor& operator=(const LoadGovernor&) = delete;
+
+        /**
+        * @brief Block until a slot is free
+        * @return True with a slot held; false once shutdown() was called
+        */
+        bool acquire();
+
+        /**
+        * @brief Give back a slot taken by acquire()
+        */
+        void release();
+
+        /**
+        * @brief Make every current and future acquire() return false
+        */
+        void shutdown();
+
+        /**
+        * @brief Take a sample now and adjust the limit
+        */
+        void refresh();
+
+        /**
+        * @brief Get the current slot limit
+        * @return Number of slots workers may hold at once
+        */
+        size_t limit() const;
+
+        /**
+        * @brief Get the number of slots currently held
+        * @return Held slots
+        */
+        size_t active() const;
+
+        /**
+        * @brief Get the smallest limit seen so far
+        * @return Lowest limit since construction
+        */
+        size_t lowestLimit() const;
+
+    private:
+        /**
+        * @brief Sample if the interval elapsed
+        * @note Caller must hold mutex_
+        */
+        void maybeRefreshLocked();
+
+        /**
+        * @brief Sample and adjust the limit
+        * @note Caller must hold mutex_
+        */
+        void refreshLocked();
+
+        const size_t maxSlots_;
+        const LoadLimits limits_;
+        const LoadProbePtr probe_;
+        const std::chrono::milliseconds interval_;
+        mutable std::mutex mutex_;
+        std::condition_variable slotFreed_;
+        size_t limit_;
+        size_t lowestLimit_;
+        size_t active_ = 0;
+        Clock::time_point lastSample_;
+        bool shutdown_ = false;
+    };
+
+    /**
+    * @brief Create the probe for this platform
+    * @return A ProcLoadProbe reading /proc
+    */
+    LoadProbePtr createDefaultLoadProbe();
+} // namespace mimir
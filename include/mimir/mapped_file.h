@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+/// @brief Read-only file contents without copying \namespace mimir
+namespace mimir
+{
+    /// @brief Read-only view of a whole file, memory-mapped where possible \class MappedFile
+    /// @note Falls back to reading the file into memory on platforms without mmap
+    class MappedFile
+    {
+    public:
+        /**
+        * @brief Construct an empty (closed) file
+        */
+        MappedFile() = default;
+
+        /**
+        * @brief Unmap the file
+        */
+        ~MappedFile();
+
+        /**
+        * @brief File is not copyable
+        */
+        MappedFile(const MappedFile&) = delete;
+
+        /**
+        * @brief File is not copy-assignable
+        */
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        /**
+        * @brief File is movable
+        * @param other File to move from
+        */
+        MappedFile(MappedFile&& other) noexcept;
+
+        /**
+        * @brief File is move-assignable
+        * @param other File to move from
+        * @return Reference to this file
+        */
+        MappedFile& operator=(MappedFile&& other) noexcept;
+
+        /**
+        * @brief Map a file
+        * @param path File to open
+        * @return True if the file could be opened; an empty file maps to an empty view
+        */
+        bool open(const std::string& path);
+
+        /**
+        * @brief Unmap the file, leaving the view empty
+        */
+        void close() noexcept;
+
+        /**
+        * @brief Check if a file is open
+        * @return True after a successful open()
+        */
+        bool isOpen() const noexcept;
+
+        /**
+        * @brief Get the file contents
+        * @return View valid until close() or destruction
+        */
+        std::string_view view() const noexcept;
+
+    private:
+        const char* data_ = nullptr;
+        size_t size_ = 0;
+        bool open_ = false;
+        bool mapped_ = false;       ///< True if data_ came from mmap (false: heap copy)
+    };
+} // namespace mimir
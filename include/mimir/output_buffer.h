@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/// @brief Bounded capture buffer for command output \namespace mimir
+namespace mimir
+{
+    /// @brief Ring buffer that keeps the most recent bytes written to it \class OutputBuffer
+    /// @note Storage grows with the output until it reaches the capacity, so the
+    ///       many targets that print nothing or a line or two never allocate the
+    ///       full capacity. Not thread-safe; each capture owns its buffers.
+    class OutputBuffer
+    {
+    public:
+        /// Capacity used unless the constructor is told otherwise
+        static constexpr size_t DEFAULT_CAPACITY = 1024 * 1024;
+
+        /**
+        * @brief Construct an empty buffer
+        * @param capacity Maximum number of bytes retained (at least one)
+        */
+        explicit OutputBuffer(size_t capacity = DEFAULT_CAPACITY);
+
+        /**
+        * @brief Append bytes, discarding the oldest ones once full
+        * @param data Pointer to the bytes
+        * @param len Number of bytes
+        */
+        void append(const char* data, size_t len);
+
+        /**
+        * @brief Get the retained bytes, oldest first
+        * @return The buffer contents
+        */
+        std::string str() const;
+
+        /**
+        * @brief Get the number of retained bytes
+        * @return Byte count (never more than capacity())
+        */
+        size_t size() const noexcept;
+
+        /**
+        * @brief Check if nothing has been written
+        * @return True if the buffer is empty
+        */
+        bool empty() const noexcept;
+
+        /**
+        * @brief Get the maximum number of retained bytes
+        * @return The capacity
+        */
+        size_t capacity() const noexcept;
+
+        /**
+        * @brief Get the number of bytes that were discarded to make room
+        * @return Dropped byte count
+        */
+        size_t droppedBytes() const noexcept;
+
+        /**
+        * @brief Discard all content and reset the dropped counter
+        */
+        void clear() noexcept;
+
+    private:
+        std::string data_;  ///< Linear until full, then a ring starting at start_
+        size_t capacity_;
+        size_t start_;
+        size_t dropped_;
+    };
+} // namespace mimir
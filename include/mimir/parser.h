@@ -1,15 +1,20 @@
 #pragma once
 
+#include "graph_cache.h"
 #include "target.h"
 #include <vector>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <variant>
+#include <memory>
 #include <optional>
 
 /// @brief Parser for build configuration files \namespace mimir
 namespace mimir
 {
+    class GlobEngine;
+
     /// @brief Error information for parsing failures \struct ParseError
     struct ParseError
     {
@@ -51,6 +56,21 @@ namespace mimir
     using ParseResult = std::variant<T, ParseError>;
 
     /// @brief Parser for build configuration files (YAML and TOML) \class Parser
+    /// @details Files are memory-mapped and scanned once; keys, values and
+    ///          variables stay views into the mapping until they are stored in
+    ///          a Target. With a cache directory set, parseFile() keeps the
+    ///          result in a binary graph cache keyed by the file's contents and
+    ///          skips parsing while the file and the globs its commands
+    ///          expanded are unchanged.
+    ///
+    ///          A build file may include others: a top-level "include:" list in
+    ///          YAML, an include = [...] array before the first table in TOML.
+    ///          Paths are relative to the including file, and each file picks
+    ///          its format by extension. Included files start from a copy of
+    ///          their includer's variables and config, are parsed concurrently
+    ///          (one wave per include depth), and a file reached twice is read
+    ///          once. Targets are merged in file order; a target name or output
+    ///          defined twice, or a pool given two capacities, is an error.
     class Parser
     {
     public:
@@ -101,6 +121,18 @@ namespace mimir
         */
         ParseResult<std::vector<Target>> parseFile(const std::string& filepath);
 
+        /**
+        * @brief Keep parseFile() results in a graph cache
+        * @param cacheDir Directory for graph.bin (empty disables the cache)
+        */
+        void setCacheDirectory(std::string cacheDir);
+
+        /**
+        * @brief Check if the last parseFile() was answered by the graph cache
+        * @return True if the file was not parsed
+        */
+        bool loadedFromCache() const noexcept;
+
         /**
         * @brief Get the last parse error (if any)
         * @return Optional containing the last error
@@ -112,7 +144,84 @@ namespace mimir
         */
         void clearError();
 
+        /**
+        * @brief Get the resource pools defined by the last parsed file
+        * @return Pool name to capacity; empty if the file defined none
+        * @note YAML files define pools in a top-level "pools:" map, TOML files
+        *       in a [pools] table. Targets pick one with "pool" and claim
+        *       "weight" units of its capacity (default 1).
+        */
+        const PoolCapacities& getPools() const noexcept;
+
+        /**
+        * @brief Get every build file the last parse read
+        * @return The root file first, then included files in include order
+        */
+        const std::vector<std::string>& getSourceFiles() const noexcept;
+
+        /**
+        * @brief Get the glob lookups the last parseFile() depended on
+        * @return Each pattern with the files it matched, whether parsed or read from the graph cache
+        * @note A file created or removed where a pattern looks changes its
+        *       matches without touching any build file
+        */
+        const std::vector<GlobProbe>& getGlobProbes() const noexcept;
+
     private:
+        struct VariableScope;
+        struct FileScope;
+        struct IncludeUnit;
+
+        /**
+        * @brief Parse YAML text
+        * @param text Contents of the build file
+        * @param filepath File the text came from (for errors)
+        * @param scope Inherited variables; receives the file's variables and includes
+        * @return Parsed targets (empty on failure)
+        */
+        std::vector<Target> parseYAMLText(std::string_view text, const std::string& filepath, FileScope& scope);
+
+        /**
+        * @brief Parse TOML text
+        * @param text Contents of the build file
+        * @param filepath File the text came from (for errors)
+        * @param scope Inherited variables; receives the file's includes
+        * @return Parsed targets (empty on failure)
+        */
+        std::vector<Target> parseTOMLText(std::string_view text, const std::string& filepath, FileScope& scope);
+
+        /**
+        * @brief Parse a build file and everything it includes
+        * @param filepath Root build file
+        * @param text Contents of the root file
+        * @param yaml Parse the root as YAML (false: TOML)
+        * @param hashSources Record the digest and stamp of every included file
+        * @return Merged targets (empty on failure)
+        */
+        std::vector<Target> parseTree(const std::string& filepath, std::string_view text, bool yaml, bool hashSources);
+
+        /**
+        * @brief Re-run the glob lookups the graph cache could not vouch for
+        * @param cached Parse read from the graph cache
+        * @return True if every pattern still yields the same files
+        */
+        bool probesMatch(const CachedGraph& cached);
+
+        /**
+        * @brief Parse a pool capacity or target weight
+        * @param value Text of the value
+        * @return The number, or nullopt unless value is a positive integer
+        */
+        static std::optional<std::uint32_t> parsePositive(std::string_view value);
+
+        /**
+        * @brief Check every target's pool was defined and record an error if not
+        * @param targets Parsed targets
+        * @param filepath File the targets came from
+        * @return True if all pools are known
+        */
+        bool validatePools(const std::vector<Target>& targets, const std::string& filepath);
+
         /**
         * @brief Replace all occurrences of a substring
         * @param str String to modify
@@ -122,35 +231,51 @@ namespace mimir
         static void replaceAll(std::string& str, const std::string& from, const std::string& to);
 
         /**
-        * @brief Evaluate a conditional expression
+        * @brief Look up a variable, including the target's list variables
+        * @param name Variable name
+        * @param scope Variables of the command being expanded
+        * @return The unexpanded value, or nullopt if undefined
+        */
+        std::optional<std::string_view> lookupVariable(std::string_view name, VariableScope& scope);
+
+        /**
+        * @brief Evaluate a conditional expression or variable name
         * @param expr Expression to evaluate
-        * @param vars Variable map
-        * @param cfg Configuration map
-        * @return Evaluated result
+        * @param scope Variables of the command being expanded
+        * @param out Receives the expanded result
+        * @param depth Nesting depth of the expansion
         */
-        std::string evaluateExpression(
-            const std::string& expr,
-            const std::unordered_map<std::string, std::string>& vars,
-            const std::unordered_map<std::string, std::string>& cfg);
+        void evaluateExpression(std::string_view expr, VariableScope& scope, std::string& out, int depth);
+
+        /**
+        * @brief Expand ${name} and ${{expression}} references in one pass
+        * @param input Text with variable references
+        * @param scope Variables of the command being expanded
+        * @param out Receives the expanded text
+        * @param depth Nesting depth; values are expanded recursively up to a limit
+        */
+        void expandInto(std::string_view input, VariableScope& scope, std::string& out, int depth);
 
         /**
         * @brief Expand variables in a string
         * @param input Input string with variable references
-        * @param vars Variable map
-        * @param cfg Configuration map
+        * @param scope Variables of the command being expanded
         * @return String with variables expanded
         */
-        std::string expandVariables(
-            const std::string& input,
-            const std::unordered_map<std::string, std::string>& vars,
-            const std::unordered_map<std::string, std::string>& cfg);
+        std::string expandVariables(std::string_view input, VariableScope& scope);
 
         /**
         * @brief Expand glob patterns to file list
-        * @param pattern Glob pattern
-        * @return Vector of matching file paths
+        * @param pattern Glob pattern (see GlobPattern for the syntax)
+        * @return Sorted matching file paths, memoized for the current parse
+        */
+        const std::vector<std::string>& expandGlob(const std::string& pattern);
+
+        /**
+        * @brief Get the glob engine, creating it on first use
+        * @return Engine shared with the parsers of included files
         */
-        std::vector<std::string> expandGlob(const std::string& pattern);
+        GlobEngine& globEngine();
 
         /**
         * @brief Join a list of strings with spaces
@@ -160,5 +285,13 @@ namespace mimir
         std::string joinList(const std::vector<std::string>& list);
 
         std::optional<ParseError> lastError_;
+        PoolCapacities pools_;
+        std::string cacheDir_;
+        bool loadedFromCache_ = false;
+        std::vector<std::string> sourceFiles_;      ///< Files read by the last parse, root first
+        std::vector<SourceFile> includes_;          ///< Included files of the last parse
+        std::unordered_map<std::string, std::vector<std::string>> globs_;   ///< Glob results of the current parse
+        std::vector<GlobProbe> probes_;             ///< Glob results of the last parseFile()
+        std::shared_ptr<GlobEngine> globEngine_;   ///< Directory listings, kept across parses
     };
 } // namespace mimir
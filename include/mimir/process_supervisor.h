@@ -0,0 +1,112 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/// @brief Deadline enforcement for running commands \namespace mimir
+namespace mimir
+{
+    /// @brief Background thread that kills process groups whose deadline passed \class ProcessSupervisor
+    /// @details Deadlines live in a min-heap ordered by expiry, so the thread
+    ///          sleeps exactly until the next one. An expired group gets SIGTERM,
+    ///          then SIGKILL if it is still registered after the grace period.
+    ///          Released watches stay in the heap and are skipped when they surface.
+    /// @note Callers must release() a watch before reaping the child, so a
+    ///       recycled process group id is never signalled.
+    class ProcessSupervisor
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+        using Token = std::uint64_t;
+
+        /**
+        * @brief Get the process-wide supervisor, starting it on first use
+        * @return The shared supervisor
+        */
+        static ProcessSupervisor& instance();
+
+        /**
+        * @brief Start a supervisor thread
+        * @param killGrace Time between SIGTERM and SIGKILL
+        */
+        explicit ProcessSupervisor(std::chrono::milliseconds killGrace = std::chrono::milliseconds(2000));
+
+        /**
+        * @brief Stop the thread; remaining watches are abandoned
+        */
+        ~ProcessSupervisor();
+
+        ProcessSupervisor(const ProcessSupervisor&) = delete;
+        ProcessSupervisor& operator=(const ProcessSupervisor&) = delete;
+
+        /**
+        * @brief Start tracking a process group's deadline
+        * @param processGroup Id of the process group to kill on expiry
+        * @param deadline When the group runs out of time
+        * @return Token to pass to release()
+        */
+        Token watch(int processGroup, Clock::time_point deadline);
+
+        /**
+        * @brief Stop tracking a process group
+        * @param token Token returned by watch()
+        * @return True if the deadline had already fired
+        */
+        bool release(Token token);
+
+        /**
+        * @brief Send a signal to every tracked process group now
+        * @param signal Signal to send, e.g. the SIGINT the build was interrupted by
+        * @return Number of groups signalled
+        * @note Takes the supervisor's lock, so it must not be called from a signal handler
+        */
+        size_t signalAll(int signal);
+
+        /**
+        * @brief Get the number of groups currently tracked
+        * @return Active watch count
+        */
+        size_t watchedCount() const;
+
+    private:
+        /// @brief Heap entry: when to look at a watch next \struct Deadline
+        struct Deadline
+        {
+            Clock::time_point when;
+            Token token;
+
+            bool operator>(const Deadline& other) const noexcept
+            {
+                return when > other.when;
+            }
+        };
+
+        /// @brief State of one tracked process group \struct Watch
+        struct Watch
+        {
+            int processGroup;
+            bool expired;   ///< SIGTERM has been sent
+        };
+
+        /**
+        * @brief Thread main loop
+        */
+        void run();
+
+        std::chrono::milliseconds killGrace_;
+        mutable std::mutex mutex_;
+        std::condition_variable cv_;
+        std::priority_queue<Deadline, std::vector<Deadline>, std::greater<Deadline>> heap_;
+        std::unordered_map<Token, Watch> watches_;
+        Token nextToken_;
+        bool stopping_;
+        std::thread thread_;
+    };
+} // namespace mimir
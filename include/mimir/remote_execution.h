@@ -0,0 +1,324 @@
+#pragma once
+
+#include "artifact_store.h"
+#include "command_runner.h"
+#include "file_stat.h"
+#include "thread_pool.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/// @brief Running hermetic commands on a pool of worker machines \namespace mimir
+namespace mimir
+{
+    /// @brief Address of a remote worker \struct RemoteEndpoint
+    struct RemoteEndpoint
+    {
+        /// Port a worker listens on unless told otherwise
+        static constexpr std::uint16_t DEFAULT_PORT = 7411;
+
+        std::string host;                   ///< Host name or address
+        std::uint16_t port = DEFAULT_PORT;  ///< TCP port
+
+        /**
+        * @brief Parse "host[:port]"
+        * @param text The address
+        * @return The endpoint, or nullopt if the host is empty or the port invalid
+        */
+        static std::optional<RemoteEndpoint> parse(std::string_view text);
+
+        /**
+        * @brief Parse a comma-separated list of endpoints
+        * @param text Addresses such as "build1,build2:7500"
+        * @return The endpoints, or nullopt if any of them is malformed
+        */
+        static std::optional<std::vector<RemoteEndpoint>> parseList(std::string_view text);
+
+        /**
+        * @brief Format the endpoint for messages
+        * @return "host:port"
+        */
+        std::string describe() const;
+    };
+
+    /// Longest token a worker accepts
+    constexpr size_t MAX_REMOTE_TOKEN_BYTES = 256;
+
+    /// Largest whole request a worker reads before giving up on the client
+    constexpr size_t MAX_REMOTE_REQUEST_BYTES = 64 * 1024 * 1024;
+
+    /// Largest command frame
+    constexpr size_t MAX_REMOTE_COMMAND_BYTES = 1024 * 1024;
+
+    /// Largest environment variable frame
+    constexpr size_t MAX_REMOTE_VARIABLE_BYTES = 128 * 1024;
+
+    /// Largest input or output path
+    constexpr size_t MAX_REMOTE_PATH_BYTES = 4096;
+
+    /// Most output a worker captures per stream, whatever limit the client asks for
+    constexpr size_t MAX_REMOTE_CAPTURE_BYTES = 64 * 1024 * 1024;
+
+    /// @brief Counters describing remote execution traffic \struct RemoteExecutionStats
+    struct RemoteExecutionStats
+    {
+        size_t remoteRuns = 0;      ///< Commands a worker ran
+        size_t localRuns = 0;       ///< Commands that were never eligible to leave the host
+        size_t fallbacks = 0;       ///< Hermetic commands run locally because no worker could take them
+        size_t blobsUploaded = 0;   ///< Input blobs sent to the content store
+        size_t blobsReused = 0;     ///< Input blobs the content store already had
+        size_t bytesUploaded = 0;   ///< Encoded input bytes sent
+        size_t bytesDownloaded = 0; ///< Encoded output bytes received from workers
+    };
+
+    /// @brief Command runner that ships hermetic commands to RemoteWorkers \class RemoteCommandRunner
+    /// @details A command runs remotely when its options are hermetic and every
+    ///          input and output is a relative path inside the project. Its
+    ///          inputs are hashed with SHA-256 and uploaded as "cas/<digest>"
+    ///          blobs to the artifact backend the workers share, which is where
+    ///          an ArtifactStore keeps published outputs too, so anything
+    ///          already there is never sent again. The worker with the fewest
+    ///          commands in flight gets the action and streams the outputs back,
+    ///          which are written in place before run() returns.
+    ///          Everything else runs on the local runner, as does a hermetic
+    ///          command when no worker answers; an unreachable worker is left
+    ///          alone for a while before it is tried again. Every request
+    ///          carries the token the workers were started with.
+    class RemoteCommandRunner : public ICommandRunner
+    {
+    public:
+        /**
+        * @brief Construct a runner over a worker pool
+        * @param workers Workers to spread commands over
+        * @param backend Content store shared with the workers
+        * @param token Shared secret the workers require
+        * @param local Runner for everything that stays on the host (default: the system runner)
+        * @param connectTimeoutMs Connect and send timeout per worker in milliseconds
+        */
+        RemoteCommandRunner(
+            std::vector<RemoteEndpoint> workers,
+            ArtifactBackendPtr backend,
+            std::string token,
+            CommandRunnerPtr local = nullptr,
+            int connectTimeoutMs = 5000);
+
+        /**
+        * @brief Run a command on a worker or locally
+        * @param command The command string to execute
+        * @param options Execution options; hermetic ones may be shipped
+        * @return Result of command execution; spawnSeconds covers uploading
+        *         inputs and handing the action to a worker
+        * @note Thread-safe
+        */
+        CommandResult run(
+            const std::string& command,
+            const CommandOptions& options = CommandOptions()) override;
+
+        /**
+        * @brief Run a command locally
+        * @param command The command string to execute
+        * @return True if command succeeded (exit code 0)
+        */
+        bool runSimple(const std::string& command) override;
+
+        /**
+        * @brief Check if a command could be shipped to a worker
+        * @param options Execution options
+        * @return True if they are hermetic, use no working directory and name
+        *         only relative paths that stay inside the project
+        */
+        static bool isShippable(const CommandOptions& options);
+
+        /**
+        * @brief Get a snapshot of the traffic counters
+        * @return Current statistics
+        */
+        RemoteExecutionStats getStats() const;
+
+        /**
+        * @brief Get the workers
+        * @return The endpoints passed to the constructor
+        */
+        const std::vector<RemoteEndpoint>& getWorkers() const noexcept;
+
+    private:
+        /// @brief An input ready to be named in a request \struct Input
+        struct Input
+        {
+            std::string path;
+            std::string digest;
+            unsigned mode;
+        };
+
+        /// @brief Load balancing state of one worker \struct WorkerState
+        struct WorkerState
+        {
+            size_t inFlight = 0;
+            std::int64_t downUntilMs = 0;   ///< Steady-clock time before which it is skipped
+        };
+
+        /**
+        * @brief Hash every input and upload the blobs the store lacks
+        * @param options Hermetic execution options
+        * @param inputs Receives the inputs by digest
+        * @return False if an input is unreadable or an upload failed
+        */
+        bool uploadInputs(const CommandOptions& options, std::vector<Input>& inputs);
+
+        /**
+        * @brief Get an input's digest, rehashing it only when its stat tuple changed
+        * @param path The input
+        * @param raw Receives the contents if the file had to be read
+        * @return The SHA-256 digest, or nullopt if the file is unreadable
+        */
+        std::optional<std::string> digestOf(const std::string& path, std::optional<std::string>& raw);
+
+        /**
+        * @brief Claim the least busy worker that is not marked down
+        * @param tried Workers already tried for this command
+        * @return Index of the worker, or nullopt if none is left
+        */
+        std::optional<size_t> acquireWorker(const std::vector<bool>& tried);
+
+        /**
+        * @brief Give a worker back
+        * @param index The worker
+        * @param failed True to skip it for a while
+        */
+        void releaseWorker(size_t index, bool failed);
+
+        /**
+        * @brief Send one action to a worker and apply its reply
+        * @param worker The worker
+        * @param request The encoded action
+        * @param options Execution options the action came from
+        * @param result Receives the command's result
+        * @return False on a transport or protocol error, with no output written
+        */
+        bool runOn(const RemoteEndpoint& worker, const std::string& request, const CommandOptions& options,
+            CommandResult& result);
+
+        std::vector<RemoteEndpoint> workers_;
+        ArtifactBackendPtr backend_;
+        std::string token_;
+        CommandRunnerPtr local_;
+        int connectTimeoutMs_;
+
+        mutable std::mutex mutex_;  ///< Guards everything below
+        std::vector<WorkerState> states_;
+        std::unordered_set<std::string> stored_;    ///< Digests known to be in the store
+        std::unordered_map<std::string, std::pair<FileStamp, std::string>> digests_;   ///< Path -> stamp and digest
+        RemoteExecutionStats stats_;
+    };
+
+    /// @brief Settings for a RemoteWorker \struct RemoteWorkerOptions
+    struct RemoteWorkerOptions
+    {
+        std::string bindAddress = "127.0.0.1";              ///< Address to listen on (loopback unless widened)
+        std::uint16_t port = RemoteEndpoint::DEFAULT_PORT;  ///< Port to listen on (0 picks a free one)
+        std::string workDir = ".mimir/worker";              ///< Blob cache and per-action sandboxes
+        size_t maxJobs = 0;                                 ///< Actions run at once (0 = one per core)
+        std::string token;                                  ///< Shared secret clients must send (required)
+    };
+
+    /// @brief Worker daemon that runs actions for RemoteCommandRunners \class RemoteWorker
+    /// @details Clients open one TCP connection per action. A request starts with
+    ///          "A <length>\n<token>" and is rejected unless the token matches;
+    ///          the rest is a series of frames ended by "G\n": "C <length>\n<command>", an optional
+    ///          "T <seconds>\n", "L <capture bytes>\n", "V <length>\n<NAME=value>" per environment
+    ///          variable, "I <digest> <mode> <length>\n<path>" per input and
+    ///          "O <length>\n<path>" per output. Inputs are fetched from the
+    ///          content store once and kept in the work directory's blob cache,
+    ///          then copied into a fresh sandbox in which the command runs.
+    ///          The reply holds "S <length>\n<stdout>" and "E <length>\n<stderr>",
+    ///          "F <mode> <path length> <blob length>\n<path><blob>" per output
+    ///          the command wrote (blobs framed by ArtifactStore::encodeBlob),
+    ///          and "X <exit> <timed out> <user s> <system s> <max rss kB> <dropped bytes>\n".
+    ///          A request that cannot be run gets "R <reason>\n" instead. Frames
+    ///          and whole requests past the MAX_REMOTE_* limits are refused
+    ///          before they are buffered. The token is sent in the clear, so
+    ///          workers belong on a trusted network.
+    class RemoteWorker
+    {
+    public:
+        /**
+        * @brief Construct a worker; nothing is opened until start()
+        * @param options Address, work directory and concurrency
+        * @param backend Content store shared with the clients
+        * @param runner Runner for actions (default: the system runner)
+        */
+        RemoteWorker(RemoteWorkerOptions options, ArtifactBackendPtr backend, CommandRunnerPtr runner = nullptr);
+
+        /**
+        * @brief Stop serving and wait for running actions
+        */
+        ~RemoteWorker();
+
+        RemoteWorker(const RemoteWorker&) = delete;
+        RemoteWorker& operator=(const RemoteWorker&) = delete;
+
+        /**
+        * @brief Create the work directory and start listening
+        * @return An error message, or nullopt on success
+        * @note Fails without a token, so a worker never runs commands for anyone who connects
+        */
+        std::optional<std::string> start();
+
+        /**
+        * @brief Accept clients until stop() is called
+        * @note Each connection is handled on the worker's thread pool
+        */
+        void serve();
+
+        /**
+        * @brief Make serve() return
+        * @note Async-signal-safe, so it may be called from a signal handler
+        */
+        void stop() noexcept;
+
+        /**
+        * @brief Get the port the worker listens on
+        * @return The bound port, which differs from the options when they asked for 0
+        */
+        std::uint16_t port() const noexcept;
+
+        /**
+        * @brief Get the number of actions that ran
+        * @return Commands run since start()
+        */
+        size_t actionsRun() const noexcept;
+
+    private:
+        /**
+        * @brief Read one action, run it and send the reply
+        * @param fd Connected socket; closed when done
+        */
+        void handleClient(int fd);
+
+        /**
+        * @brief Get the blob cache file of a digest, fetching it if needed
+        * @param digest SHA-256 of the contents
+        * @return Path of the cached file, or nullopt if the store lacks the blob
+        */
+        std::optional<std::string> cachedBlob(const std::string& digest);
+
+        RemoteWorkerOptions options_;
+        ArtifactBackendPtr backend_;
+        CommandRunnerPtr runner_;
+        int listenFd_ = -1;
+        int wakeRead_ = -1;
+        int wakeWrite_ = -1;
+        std::uint16_t port_ = 0;
+        std::atomic<bool> stopping_{false};
+        std::atomic<size_t> actions_{0};
+        std::atomic<size_t> nextSandbox_{0};
+        std::unique_ptr<ThreadPool> pool_;
+    };
+} // namespace mimir
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "hasher.h"
 #include <string>
 #include <vector>
 
@@ -11,9 +12,11 @@ namespace mimir
     {
     public:
         /**
-         * @brief Compute the SHA-256 signature of a file
+         * @brief Compute the signature of a file's contents
          * @param filepath The path to the file
-         * @return The SHA-256 signature as a hex string
+         * @return The digest as a hex string, or empty if the file cannot be read
+         * @note Large files are hashed through mmap, small ones with a pread into a
+         *       per-thread buffer; no per-file allocation either way
          */
         static std::string computeFileSignature(const std::string& filepath);
 
@@ -32,12 +35,25 @@ namespace mimir
          */
         static std::string computeTargetSignature(const std::string& command, const std::vector<std::string>& inputs);
 
-    private:
         /**
-         * @brief Compute the SHA-256 hash of a data string
-         * @param data The input data string
-         * @return The SHA-256 hash as a hex string
+         * @brief Combine a command with already computed input file signatures
+         * @param command The command string
+         * @param fileSignatures Content signatures of the inputs, in input order
+         * @return The target signature, identical to computeTargetSignature() over the same files
+         */
+        static std::string combineTargetSignature(const std::string& command, const std::vector<std::string>& fileSignatures);
+
+        /**
+         * @brief Select the hash algorithm used for all signatures
+         * @param algorithm The algorithm to use
+         * @note Changing the algorithm invalidates every cached signature
+         */
+        static void setAlgorithm(HashAlgorithm algorithm) noexcept;
+
+        /**
+         * @brief Get the hash algorithm used for signatures
+         * @return The current algorithm (SHA-256 by default)
          */
-        static std::string sha256(const std::string& data);
+        static HashAlgorithm getAlgorithm() noexcept;
     };
 }
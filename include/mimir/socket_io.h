@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <string>
+#include <string_view>
+
+/// @brief Blocking socket helpers shared by the daemon and remote execution \namespace mimir
+namespace mimir
+{
+    /**
+    * @brief Send all of a buffer, retrying short writes
+    * @param fd Connected socket
+    * @param data Bytes to send
+    * @return False if the peer went away or the send timed out
+    * @note Never raises SIGPIPE where MSG_NOSIGNAL exists
+    */
+    bool sendAll(int fd, std::string_view data);
+
+    /**
+    * @brief Keep a descriptor from leaking into spawned commands
+    * @param fd The descriptor
+    */
+    void setCloseOnExec(int fd);
+
+    /// @brief Buffered reads of lines and fixed-size blocks from a socket \class SocketReader
+    /// @details Every read fails once the bytes consumed plus the bytes asked for
+    ///          would pass maxBytes, so a peer cannot make the reader buffer more
+    ///          than that however large the lengths it announces.
+    class SocketReader
+    {
+    public:
+        /**
+        * @brief Construct a reader
+        * @param fd Connected socket; not owned
+        * @param timeoutMs Longest wait for more data per read (-1 = no limit)
+        * @param maxBytes Most bytes the reader hands out over its lifetime
+        */
+        SocketReader(int fd, int timeoutMs, size_t maxBytes = std::numeric_limits<size_t>::max());
+
+        /**
+        * @brief Read up to the next newline
+        * @param line Receives the line without its newline
+        * @return False on timeout, end of stream or a line past the byte limit
+        */
+        bool readLine(std::string& line);
+
+        /**
+        * @brief Read exactly length bytes
+        * @param length Number of bytes
+        * @param data Receives the bytes
+        * @return False on timeout, end of stream or a length past the byte limit
+        */
+        bool readExact(size_t length, std::string& data);
+
+        /**
+        * @brief Get the number of bytes handed out so far
+        * @return Bytes returned by readLine() (including newlines) and readExact()
+        */
+        size_t consumed() const noexcept;
+
+    private:
+        /**
+        * @brief Wait for and append one chunk from the socket
+        * @return False on timeout, error or end of stream
+        */
+        bool fill();
+
+        /**
+        * @brief Get the bytes that may still be handed out
+        * @return maxBytes minus consumed()
+        */
+        size_t remaining() const noexcept;
+
+        const int fd_;
+        const int timeoutMs_;
+        const size_t maxBytes_;
+        std::string buffer_;
+        size_t scanned_ = 0;    ///< Bytes of buffer_ known to hold no newline
+        size_t consumed_ = 0;
+    };
+} // namespace mimir
@@ -1,12 +1,25 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include <memory>
 
 /// @brief Build target representation for mimir Build System \namespace mimir
 namespace mimir
 {
+    /// @brief Capacity of each named resource pool, in weight units
+    using PoolCapacities = std::unordered_map<std::string, std::uint32_t>;
+
+    /// @brief How a target's command reports the headers it read \enum DepsFormat
+    enum class DepsFormat
+    {
+        None,       ///< Only the declared inputs are tracked
+        GCC,        ///< A Makefile-style depfile, as written by gcc/clang -MD
+        MSVC        ///< "Note: including file:" lines in stdout, as printed by cl /showIncludes
+    };
+
     /// @brief Represents a build target with inputs, outputs, and dependencies \class Target
     class Target
     {
@@ -131,6 +144,78 @@ namespace mimir
         */
         void setDependencies(std::vector<std::string> dependencies);
 
+        /**
+        * @brief Get the resource pool the target's command runs in
+        * @return Pool name, or empty if the target is limited only by the job count
+        */
+        const std::string& getPool() const noexcept;
+
+        /**
+        * @brief Set the resource pool
+        * @param pool Name of a pool defined in the build file (empty for none)
+        */
+        void setPool(std::string pool);
+
+        /**
+        * @brief Get the share of its pool's capacity the target occupies while running
+        * @return Weight (default: 1)
+        */
+        std::uint32_t getWeight() const noexcept;
+
+        /**
+        * @brief Set the pool weight
+        * @param weight Capacity units taken from the pool while the command runs
+        */
+        void setWeight(std::uint32_t weight);
+
+        /**
+        * @brief Get the depfile the command writes
+        * @return Path of the depfile, or empty if there is none
+        */
+        const std::string& getDepfile() const noexcept;
+
+        /**
+        * @brief Set the depfile
+        * @param depfile Path the command writes its discovered dependencies to
+        */
+        void setDepfile(std::string depfile);
+
+        /**
+        * @brief Get how the command reports discovered dependencies
+        * @return The format (default: None)
+        */
+        DepsFormat getDepsFormat() const noexcept;
+
+        /**
+        * @brief Set how the command reports discovered dependencies
+        * @param format GCC needs a depfile; MSVC reads the command's output
+        */
+        void setDepsFormat(DepsFormat format);
+
+        /**
+        * @brief Check if dependents are cut off when the outputs come out unchanged
+        * @return True if the outputs are rehashed after every run (default: false)
+        */
+        bool getRestat() const noexcept;
+
+        /**
+        * @brief Enable or disable early cutoff
+        * @param restat True to judge dependents by the outputs' contents instead of this target's signature
+        */
+        void setRestat(bool restat);
+
+        /**
+        * @brief Check if the command may run on a remote worker
+        * @return True if it reads only its inputs and writes only its outputs (default: false)
+        */
+        bool getRemote() const noexcept;
+
+        /**
+        * @brief Mark the command hermetic, so a remote runner may ship it to a worker
+        * @param remote True if the declared inputs and outputs are everything the command touches
+        */
+        void setRemote(bool remote);
+
         /**
         * @brief Get the cached signature
         * @return Const reference to the signature string
@@ -167,6 +252,12 @@ namespace mimir
         std::vector<std::string> outputs_;
         std::string command_;
         std::vector<std::string> dependencies_;
+        std::string pool_;
+        std::uint32_t weight_ = 1;
+        std::string depfile_;
+        DepsFormat depsFormat_ = DepsFormat::None;
+        bool restat_ = false;
+        bool remote_ = false;
         std::string signature_;
     };
 
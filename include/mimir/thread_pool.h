@@ -0,0 +1,82 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/// @brief Fixed-size pool of worker threads for background work \namespace mimir
+namespace mimir
+{
+    /// @brief FIFO task queue served by a fixed set of threads \class ThreadPool
+    /// @note Tasks must not block on other tasks of the same pool
+    class ThreadPool
+    {
+    public:
+        /**
+        * @brief Start the worker threads
+        * @param numThreads Number of workers (at least one is started)
+        */
+        explicit ThreadPool(size_t numThreads);
+
+        /**
+        * @brief Run every queued task, then join the workers
+        */
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        /**
+        * @brief Queue a callable
+        * @param fn The callable to run on a worker
+        * @return Future for the callable's result (exceptions are forwarded)
+        */
+        template <typename Fn>
+        std::future<std::invoke_result_t<std::decay_t<Fn>>> submit(Fn&& fn)
+        {
+            using Result = std::invoke_result_t<std::decay_t<Fn>>;
+            auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Fn>(fn));
+            std::future<Result> future = task->get_future();
+            enqueue([task]() { (*task)(); });
+            return future;
+        }
+
+        /**
+        * @brief Block until the queue is empty and every worker is idle
+        */
+        void wait();
+
+        /**
+        * @brief Get the number of worker threads
+        * @return Thread count
+        */
+        size_t threadCount() const noexcept;
+
+    private:
+        /**
+        * @brief Push a type-erased task and wake one worker
+        * @param task The task
+        */
+        void enqueue(std::function<void()> task);
+
+        /**
+        * @brief Worker main loop
+        */
+        void workerLoop();
+
+        std::mutex mutex_;
+        std::condition_variable workCv_;
+        std::condition_variable idleCv_;
+        std::deque<std::function<void()>> tasks_;
+        size_t active_;
+        bool stopping_;
+        std::vector<std::thread> threads_;
+    };
+} // namespace mimir
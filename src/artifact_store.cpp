@@ -0,0 +1,517 @@
+#include "mimir/artifact_store.h"
+#include "mimir/hasher.h"
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <sstream>
+
+#ifdef MIMIR_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+using namespace mimir;
+
+namespace
+{
+    constexpr char BLOB_MAGIC[4] = {'M', 'Z', 'B', '1'};
+    constexpr size_t BLOB_HEADER_SIZE = sizeof(BLOB_MAGIC) + 1 + 8;
+    constexpr const char* MANIFEST_HEADER = "mimir-artifact 1";
+
+    /// @brief Payload encodings in the blob header \enum BlobCodec
+    enum class BlobCodec : std::uint8_t
+    {
+        Stored = 0,     ///< Raw bytes
+        Deflate = 1     ///< zlib stream
+    };
+
+    /// @brief One output recorded in a manifest \struct ManifestEntry
+    struct ManifestEntry
+    {
+        std::string digest;
+        std::uint64_t size;
+        unsigned mode;
+        std::string path;
+    };
+
+    std::string makeBlob(const BlobCodec codec, const std::uint64_t rawSize, const std::string_view payload)
+    {
+        std::string blob;
+        blob.reserve(BLOB_HEADER_SIZE + payload.size());
+        blob.append(BLOB_MAGIC, sizeof(BLOB_MAGIC));
+        blob.push_back(static_cast<char>(codec));
+        for (int i = 0; i < 8; ++i)
+        {
+            blob.push_back(static_cast<char>(rawSize >> (8 * i)));
+        }
+        blob.append(payload.data(), payload.size());
+        return blob;
+    }
+
+    std::optional<std::string> readWholeFile(const std::string& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+        {
+            return std::nullopt;
+        }
+        std::ostringstream contents;
+        contents << file.rdbuf();
+        if (file.bad())
+        {
+            return std::nullopt;
+        }
+        return std::move(contents).str();
+    }
+
+    bool writeFileAtomically(const std::string& path, const std::string_view data, const std::optional<unsigned> mode)
+    {
+        std::error_code ec;
+        const fs::path target(path);
+        if (target.has_parent_path())
+        {
+            fs::create_directories(target.parent_path(), ec);
+        }
+
+        // Unique per process and call, so concurrent writers of one key never share a temp file
+        static std::atomic<unsigned> counter{0};
+        std::string tmpPath = path + ".tmp.";
+#ifndef _WIN32
+        tmpPath += std::to_string(::getpid()) + ".";
+#endif
+        tmpPath += std::to_string(counter.fetch_add(1));
+        {
+            std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+            if (!out)
+            {
+                return false;
+            }
+            out.write(data.data(), static_cast<std::streamsize>(data.size()));
+            if (!out.flush())
+            {
+                out.close();
+                fs::remove(tmpPath, ec);
+                return false;
+            }
+        }
+        if (mode)
+        {
+            fs::permissions(tmpPath, static_cast<fs::perms>(*mode) & fs::perms::mask, ec);
+        }
+        fs::rename(tmpPath, path, ec);
+        if (ec)
+        {
+            fs::remove(tmpPath, ec);
+            return false;
+        }
+        return true;
+    }
+
+    std::optional<std::vector<ManifestEntry>> parseManifest(const std::string& text)
+    {
+        std::istringstream in(text);
+        std::string line;
+        if (!std::getline(in, line) || line != MANIFEST_HEADER)
+        {
+            return std::nullopt;
+        }
+
+        std::vector<ManifestEntry> entries;
+        while (std::getline(in, line))
+        {
+            if (line.empty())
+            {
+                continue;
+            }
+            std::istringstream fields(line);
+            ManifestEntry entry;
+            if (!(fields >> entry.digest >> entry.size >> std::oct >> entry.mode))
+            {
+                return std::nullopt;
+            }
+            // The path is the rest of the line and may contain spaces
+            fields.get();
+            std::getline(fields, entry.path);
+            if (entry.path.empty())
+            {
+                return std::nullopt;
+            }
+            entries.push_back(std::move(entry));
+        }
+        return entries;
+    }
+}
+
+LocalArtifactBackend::LocalArtifactBackend(std::string rootDir)
+    : rootDir_(std::move(rootDir))
+{
+}
+
+std::string LocalArtifactBackend::pathFor(const std::string& key) const
+{
+    const size_t slash = key.find('/');
+    if (slash == std::string::npos || key.size() < slash + 3)
+    {
+        return rootDir_ + "/" + key;
+    }
+    return rootDir_ + "/" + key.substr(0, slash) + "/" + key.substr(slash + 1, 2) + "/" + key.substr(slash + 1);
+}
+
+std::optional<std::string> LocalArtifactBackend::fetch(const std::string& key)
+{
+    return readWholeFile(pathFor(key));
+}
+
+bool LocalArtifactBackend::store(const std::string& key, const std::string_view data)
+{
+    return writeFileAtomically(pathFor(key), data, std::nullopt);
+}
+
+bool LocalArtifactBackend::contains(const std::string& key)
+{
+    std::error_code ec;
+    return fs::is_regular_file(pathFor(key), ec);
+}
+
+std::string LocalArtifactBackend::describe() const
+{
+    return rootDir_;
+}
+
+HttpArtifactBackend::HttpArtifactBackend(HttpUrl url)
+    : client_(std::move(url))
+{
+}
+
+std::optional<std::string> HttpArtifactBackend::fetch(const std::string& key)
+{
+    auto response = client_.get("/" + key);
+    if (!response || !response->ok())
+    {
+        return std::nullopt;
+    }
+    return std::move(response->body);
+}
+
+bool HttpArtifactBackend::store(const std::string& key, const std::string_view data)
+{
+    const auto response = client_.put("/" + key, data);
+    return response && response->ok();
+}
+
+bool HttpArtifactBackend::contains(const std::string& key)
+{
+    const auto response = client_.head("/" + key);
+    return response && response->ok();
+}
+
+std::string HttpArtifactBackend::describe() const
+{
+    const HttpUrl& url = client_.getBaseUrl();
+    return "http://" + url.host + ":" + std::to_string(url.port) + url.basePath;
+}
+
+ArtifactBackendPtr mimir::createArtifactBackend(const std::string& location)
+{
+    if (location.compare(0, 7, "http://") == 0)
+    {
+        auto url = HttpUrl::parse(location);
+        if (!url)
+        {
+            return nullptr;
+        }
+        return std::make_shared<HttpArtifactBackend>(std::move(*url));
+    }
+    if (location.empty() || location.find("://") != std::string::npos)
+    {
+        return nullptr;
+    }
+    return std::make_shared<LocalArtifactBackend>(location);
+}
+
+ArtifactStore::ArtifactStore(ArtifactBackendPtr backend, const size_t numThreads)
+    : backend_(std::move(backend))
+    , readOnly_(false)
+    , hits_(0)
+    , misses_(0)
+    , uploads_(0)
+    , uploadFailures_(0)
+    , bytesDownloaded_(0)
+    , bytesUploaded_(0)
+    , downloadPool_(numThreads)
+    , uploadPool_(numThreads)
+{
+}
+
+ArtifactStore::~ArtifactStore()
+{
+    waitForUploads();
+}
+
+std::string ArtifactStore::actionKey(const std::string& signature, const std::vector<std::string>& outputs)
+{
+    Hasher hasher(HashAlgorithm::SHA256);
+    hasher.update(std::string_view("mimir-action-1\0", 15));
+    hasher.update(signature);
+    for (const auto& output : outputs)
+    {
+        hasher.update(std::string_view("\0", 1));
+        hasher.update(output);
+    }
+    return hasher.finalizeHex();
+}
+
+bool ArtifactStore::compressionAvailable() noexcept
+{
+#ifdef MIMIR_HAVE_ZLIB
+    return true;
+#else
+    return false;
+#endif
+}
+
+std::string ArtifactStore::encodeBlob(const std::string_view data)
+{
+#ifdef MIMIR_HAVE_ZLIB
+    uLongf compressedSize = compressBound(static_cast<uLong>(data.size()));
+    std::string compressed(compressedSize, '\0');
+    // Level 1: outputs are mostly object code, where higher levels buy little over the wire
+    if (compress2(reinterpret_cast<Bytef*>(compressed.data()), &compressedSize,
+                  reinterpret_cast<const Bytef*>(data.data()), static_cast<uLong>(data.size()), 1) == Z_OK
+        && compressedSize < data.size())
+    {
+        compressed.resize(compressedSize);
+        return makeBlob(BlobCodec::Deflate, data.size(), compressed);
+    }
+#endif
+    return makeBlob(BlobCodec::Stored, data.size(), data);
+}
+
+std::optional<std::string> ArtifactStore::decodeBlob(const std::string_view blob)
+{
+    if (blob.size() < BLOB_HEADER_SIZE || std::memcmp(blob.data(), BLOB_MAGIC, sizeof(BLOB_MAGIC)) != 0)
+    {
+        return std::nullopt;
+    }
+    const auto codec = static_cast<BlobCodec>(blob[sizeof(BLOB_MAGIC)]);
+    std::uint64_t rawSize = 0;
+    for (int i = 0; i < 8; ++i)
+    {
+        rawSize |= static_cast<std::uint64_t>(static_cast<unsigned char>(blob[sizeof(BLOB_MAGIC) + 1 + i])) << (8 * i);
+    }
+    const std::string_view payload = blob.substr(BLOB_HEADER_SIZE);
+
+    if (codec == BlobCodec::Stored)
+    {
+        if (payload.size() != rawSize)
+        {
+            return std::nullopt;
+        }
+        return std::string(payload);
+    }
+#ifdef MIMIR_HAVE_ZLIB
+    if (codec == BlobCodec::Deflate)
+    {
+        std::string raw(rawSize, '\0');
+        uLongf rawLen = static_cast<uLongf>(rawSize);
+        if (uncompress(reinterpret_cast<Bytef*>(raw.data()), &rawLen,
+                       reinterpret_cast<const Bytef*>(payload.data()), static_cast<uLong>(payload.size())) != Z_OK
+            || rawLen != rawSize)
+        {
+            return std::nullopt;
+        }
+        return raw;
+    }
+#endif
+    return std::nullopt;
+}
+
+bool ArtifactStore::restore(const std::string& signature, const std::vector<std::string>& outputs)
+{
+    if (outputs.empty())
+    {
+        return false;
+    }
+
+    const auto manifestText = backend_->fetch("ac/" + actionKey(signature, outputs));
+    const auto manifest = manifestText ? parseManifest(*manifestText) : std::nullopt;
+    if (!manifest || manifest->size() != outputs.size())
+    {
+        ++misses_;
+        return false;
+    }
+    for (size_t i = 0; i < outputs.size(); ++i)
+    {
+        if ((*manifest)[i].path != outputs[i])
+        {
+            ++misses_;
+            return false;
+        }
+    }
+    bytesDownloaded_ += manifestText->size();
+
+    std::vector<std::future<std::optional<std::string>>> downloads;
+    downloads.reserve(manifest->size());
+    for (const ManifestEntry& entry : *manifest)
+    {
+        downloads.push_back(downloadPool_.submit([this, &entry]() -> std::optional<std::string>
+        {
+            const auto blob = backend_->fetch("cas/" + entry.digest);
+            if (!blob)
+            {
+                return std::nullopt;
+            }
+            bytesDownloaded_ += blob->size();
+            auto raw = decodeBlob(*blob);
+            if (!raw || raw->size() != entry.size
+                || Hasher::hashHex(HashAlgorithm::SHA256, *raw) != entry.digest)
+            {
+                return std::nullopt;
+            }
+            return raw;
+        }));
+    }
+
+    // Collect every future before bailing out: the tasks reference the manifest
+    std::vector<std::optional<std::string>> contents;
+    contents.reserve(downloads.size());
+    bool complete = true;
+    for (auto& download : downloads)
+    {
+        contents.push_back(download.get());
+        complete = complete && contents.back().has_value();
+    }
+    if (!complete)
+    {
+        ++misses_;
+        return false;
+    }
+
+    for (size_t i = 0; i < outputs.size(); ++i)
+    {
+        if (!writeFileAtomically(outputs[i], *contents[i], (*manifest)[i].mode))
+        {
+            ++misses_;
+            return false;
+        }
+    }
+    ++hits_;
+    return true;
+}
+
+void ArtifactStore::storeAsync(const std::string& signature, const std::vector<std::string>& outputs)
+{
+    if (readOnly_.load() || outputs.empty())
+    {
+        return;
+    }
+    // Anything may rewrite the outputs before the upload runs; remember what
+    // this signature produced so other bytes are never published under it
+    std::vector<std::string> digests;
+    digests.reserve(outputs.size());
+    for (const auto& output : outputs)
+    {
+        const auto raw = readWholeFile(output);
+        if (!raw)
+        {
+            ++uploadFailures_;
+            return;
+        }
+        digests.push_back(Hasher::hashHex(HashAlgorithm::SHA256, *raw));
+    }
+    uploadPool_.submit([this, key = actionKey(signature, outputs), outputs, digests = std::move(digests)]()
+    {
+        if (publish(key, outputs, digests))
+        {
+            ++uploads_;
+        }
+        else
+        {
+            ++uploadFailures_;
+        }
+    });
+}
+
+bool ArtifactStore::publish(const std::string& key, const std::vector<std::string>& outputs,
+                            const std::vector<std::string>& digests)
+{
+    std::string manifest = MANIFEST_HEADER;
+    manifest += '\n';
+    for (size_t i = 0; i < outputs.size(); ++i)
+    {
+        const std::string& output = outputs[i];
+        const auto raw = readWholeFile(output);
+        if (!raw)
+        {
+            return false;
+        }
+        std::error_code ec;
+        const auto perms = fs::status(output, ec).permissions();
+        const unsigned mode = ec ? 0644u : static_cast<unsigned>(perms & fs::perms::mask);
+        const std::string digest = Hasher::hashHex(HashAlgorithm::SHA256, *raw);
+        if (digest != digests[i])
+        {
+            return false;
+        }
+
+        const std::string blobKey = "cas/" + digest;
+        if (!backend_->contains(blobKey))
+        {
+            const std::string blob = encodeBlob(*raw);
+            if (!backend_->store(blobKey, blob))
+            {
+                return false;
+            }
+            bytesUploaded_ += blob.size();
+        }
+
+        std::ostringstream line;
+        line << digest << ' ' << raw->size() << ' ' << std::oct << mode << ' ' << output << '\n';
+        manifest += line.str();
+    }
+
+    if (!backend_->store("ac/" + key, manifest))
+    {
+        return false;
+    }
+    bytesUploaded_ += manifest.size();
+    return true;
+}
+
+void ArtifactStore::waitForUploads()
+{
+    uploadPool_.wait();
+}
+
+void ArtifactStore::setReadOnly(const bool readOnly) noexcept
+{
+    readOnly_.store(readOnly);
+}
+
+bool ArtifactStore::isReadOnly() const noexcept
+{
+    return readOnly_.load();
+}
+
+ArtifactStoreStats ArtifactStore::getStats() const
+{
+    ArtifactStoreStats stats;
+    stats.hits = hits_.load();
+    stats.misses = misses_.load();
+    stats.uploads = uploads_.load();
+    stats.uploadFailures = uploadFailures_.load();
+    stats.bytesDownloaded = bytesDownloaded_.load();
+    stats.bytesUploaded = bytesUploaded_.load();
+    return stats;
+}
+
+const ArtifactBackendPtr& ArtifactStore::getBackend() const noexcept
+{
+    return backend_;
+}
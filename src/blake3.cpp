@@ -0,0 +1,581 @@
+#include "mimir/hasher.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define MIMIR_BLAKE3_X86 1
+#include <immintrin.h>
+#endif
+
+using namespace mimir;
+
+namespace
+{
+    constexpr std::uint32_t IV[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+    };
+
+    // Message word order for each of the seven rounds (the permutation applied repeatedly)
+    constexpr std::uint8_t MSG_SCHEDULE[7][16] = {
+        {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+        {2, 6, 3, 10, 7, 0, 4, 13, 1, 11, 12, 5, 9, 14, 15, 8},
+        {3, 4, 10, 12, 13, 2, 7, 14, 6, 5, 9, 0, 11, 15, 8, 1},
+        {10, 7, 12, 9, 14, 3, 13, 15, 4, 0, 11, 2, 5, 8, 1, 6},
+        {12, 13, 9, 11, 15, 10, 14, 8, 7, 2, 5, 3, 0, 1, 6, 4},
+        {9, 14, 11, 5, 8, 12, 15, 1, 13, 3, 0, 10, 2, 6, 4, 7},
+        {11, 15, 5, 0, 1, 9, 8, 6, 14, 10, 2, 12, 3, 4, 7, 13},
+    };
+
+    constexpr std::uint32_t CHUNK_START = 1u << 0;
+    constexpr std::uint32_t CHUNK_END = 1u << 1;
+    constexpr std::uint32_t PARENT = 1u << 2;
+    constexpr std::uint32_t ROOT = 1u << 3;
+
+    constexpr size_t BLOCK_LEN = 64;
+    constexpr size_t CHUNK_LEN = 1024;
+
+    inline std::uint32_t rotr(std::uint32_t x, int n) noexcept
+    {
+        return (x >> n) | (x << (32 - n));
+    }
+
+    inline void g(std::uint32_t* s, int a, int b, int c, int d, std::uint32_t x, std::uint32_t y) noexcept
+    {
+        s[a] = s[a] + s[b] + x;
+        s[d] = rotr(s[d] ^ s[a], 16);
+        s[c] = s[c] + s[d];
+        s[b] = rotr(s[b] ^ s[c], 12);
+        s[a] = s[a] + s[b] + y;
+        s[d] = rotr(s[d] ^ s[a], 8);
+        s[c] = s[c] + s[d];
+        s[b] = rotr(s[b] ^ s[c], 7);
+    }
+
+    void loadWords(const std::uint8_t block[BLOCK_LEN], std::uint32_t words[16]) noexcept
+    {
+        for (int i = 0; i < 16; ++i)
+        {
+            words[i] = static_cast<std::uint32_t>(block[4 * i])
+                | (static_cast<std::uint32_t>(block[4 * i + 1]) << 8)
+                | (static_cast<std::uint32_t>(block[4 * i + 2]) << 16)
+                | (static_cast<std::uint32_t>(block[4 * i + 3]) << 24);
+        }
+    }
+
+    /**
+    * @brief Run the BLAKE3 compression function
+    * @param cv Input chaining value
+    * @param block 64-byte message block (zero padded)
+    * @param blockLen Bytes of the block actually used
+    * @param counter Chunk counter (0 for parent nodes)
+    * @param flags Domain separation flags
+    * @param out Receives the first 8 output words (the new chaining value)
+    */
+    void compress(
+        const std::uint32_t cv[8],
+        const std::uint8_t block[BLOCK_LEN],
+        std::uint8_t blockLen,
+        std::uint64_t counter,
+        std::uint32_t flags,
+        std::uint32_t out[8]) noexcept
+    {
+        std::uint32_t m[16];
+        loadWords(block, m);
+
+        std::uint32_t s[16] = {
+            cv[0], cv[1], cv[2], cv[3], cv[4], cv[5], cv[6], cv[7],
+            IV[0], IV[1], IV[2], IV[3],
+            static_cast<std::uint32_t>(counter), static_cast<std::uint32_t>(counter >> 32),
+            blockLen, flags,
+        };
+
+        for (const auto& order : MSG_SCHEDULE)
+        {
+            g(s, 0, 4, 8, 12, m[order[0]], m[order[1]]);
+            g(s, 1, 5, 9, 13, m[order[2]], m[order[3]]);
+            g(s, 2, 6, 10, 14, m[order[4]], m[order[5]]);
+            g(s, 3, 7, 11, 15, m[order[6]], m[order[7]]);
+            g(s, 0, 5, 10, 15, m[order[8]], m[order[9]]);
+            g(s, 1, 6, 11, 12, m[order[10]], m[order[11]]);
+            g(s, 2, 7, 8, 13, m[order[12]], m[order[13]]);
+            g(s, 3, 4, 9, 14, m[order[14]], m[order[15]]);
+        }
+
+        for (int i = 0; i < 8; ++i)
+        {
+            out[i] = s[i] ^ s[i + 8];
+        }
+    }
+
+    /// @brief Inputs to a deferred compression (a chunk's last block or a parent node) \struct Output
+    struct Output
+    {
+        std::uint32_t cv[8];
+        std::uint8_t block[BLOCK_LEN];
+        std::uint8_t blockLen;
+        std::uint64_t counter;
+        std::uint32_t flags;
+
+        void chainingValue(std::uint32_t out[8]) const noexcept
+        {
+            compress(cv, block, blockLen, counter, flags, out);
+        }
+    };
+
+    Output parentOutput(const std::uint32_t left[8], const std::uint32_t right[8], const std::uint32_t key[8]) noexcept
+    {
+        Output output{};
+        std::memcpy(output.cv, key, sizeof(output.cv));
+        for (int i = 0; i < 8; ++i)
+        {
+            const std::uint32_t words[2] = {left[i], right[i]};
+            for (int half = 0; half < 2; ++half)
+            {
+                std::uint8_t* p = output.block + 32 * half + 4 * i;
+                p[0] = static_cast<std::uint8_t>(words[half]);
+                p[1] = static_cast<std::uint8_t>(words[half] >> 8);
+                p[2] = static_cast<std::uint8_t>(words[half] >> 16);
+                p[3] = static_cast<std::uint8_t>(words[half] >> 24);
+            }
+        }
+        output.blockLen = BLOCK_LEN;
+        output.counter = 0;
+        output.flags = PARENT;
+        return output;
+    }
+
+    Output chunkOutput(const detail::Blake3State& state) noexcept
+    {
+        Output output{};
+        std::memcpy(output.cv, state.cv, sizeof(output.cv));
+        std::memcpy(output.block, state.block, sizeof(output.block));
+        output.blockLen = state.blockLen;
+        output.counter = state.chunkCounter;
+        output.flags = CHUNK_END | (state.blocksCompressed == 0 ? CHUNK_START : 0);
+        return output;
+    }
+
+    size_t chunkLength(const detail::Blake3State& state) noexcept
+    {
+        return BLOCK_LEN * state.blocksCompressed + state.blockLen;
+    }
+
+    void resetChunk(detail::Blake3State& state, std::uint64_t counter) noexcept
+    {
+        std::memcpy(state.cv, state.key, sizeof(state.cv));
+        std::memset(state.block, 0, sizeof(state.block));
+        state.chunkCounter = counter;
+        state.blockLen = 0;
+        state.blocksCompressed = 0;
+    }
+
+    /**
+    * @brief Hash whole chunks one at a time
+    * @param key Key words
+    * @param data Contiguous chunks of CHUNK_LEN bytes
+    * @param chunks Number of chunks
+    * @param counter Chunk counter of the first chunk
+    * @param out Receives 8 chaining value words per chunk
+    */
+    void hashChunksPortable(
+        const std::uint32_t key[8],
+        const std::uint8_t* data,
+        size_t chunks,
+        std::uint64_t counter,
+        std::uint32_t* out) noexcept
+    {
+        for (; chunks > 0; --chunks, data += CHUNK_LEN, ++counter, out += 8)
+        {
+            std::memcpy(out, key, 8 * sizeof(std::uint32_t));
+            for (size_t b = 0; b < CHUNK_LEN / BLOCK_LEN; ++b)
+            {
+                const std::uint32_t flags = (b == 0 ? CHUNK_START : 0) | (b + 1 == CHUNK_LEN / BLOCK_LEN ? CHUNK_END : 0);
+                compress(out, data + b * BLOCK_LEN, BLOCK_LEN, counter, flags, out);
+            }
+        }
+    }
+
+#if defined(MIMIR_BLAKE3_X86)
+    // The SIMD versions hash one chunk per lane: every state and message word
+    // is a vector holding that word of 4 (SSE4.1) or 8 (AVX2) chunks at once.
+
+    __attribute__((target("sse4.1")))
+    inline __m128i rotr16(__m128i x) noexcept
+    {
+        return _mm_shuffle_epi8(x, _mm_set_epi8(13, 12, 15, 14, 9, 8, 11, 10, 5, 4, 7, 6, 1, 0, 3, 2));
+    }
+
+    __attribute__((target("sse4.1")))
+    inline __m128i rotr8(__m128i x) noexcept
+    {
+        return _mm_shuffle_epi8(x, _mm_set_epi8(12, 15, 14, 13, 8, 11, 10, 9, 4, 7, 6, 5, 0, 3, 2, 1));
+    }
+
+    __attribute__((target("sse4.1")))
+    inline void g4(__m128i* v, int a, int b, int c, int d, __m128i x, __m128i y) noexcept
+    {
+        v[a] = _mm_add_epi32(_mm_add_epi32(v[a], v[b]), x);
+        v[d] = rotr16(_mm_xor_si128(v[d], v[a]));
+        v[c] = _mm_add_epi32(v[c], v[d]);
+        v[b] = _mm_xor_si128(v[b], v[c]);
+        v[b] = _mm_or_si128(_mm_srli_epi32(v[b], 12), _mm_slli_epi32(v[b], 20));
+        v[a] = _mm_add_epi32(_mm_add_epi32(v[a], v[b]), y);
+        v[d] = rotr8(_mm_xor_si128(v[d], v[a]));
+        v[c] = _mm_add_epi32(v[c], v[d]);
+        v[b] = _mm_xor_si128(v[b], v[c]);
+        v[b] = _mm_or_si128(_mm_srli_epi32(v[b], 7), _mm_slli_epi32(v[b], 25));
+    }
+
+    __attribute__((target("sse4.1")))
+    inline void transpose4(__m128i& a, __m128i& b, __m128i& c, __m128i& d) noexcept
+    {
+        const __m128i ab01 = _mm_unpacklo_epi32(a, b);
+        const __m128i ab23 = _mm_unpackhi_epi32(a, b);
+        const __m128i cd01 = _mm_unpacklo_epi32(c, d);
+        const __m128i cd23 = _mm_unpackhi_epi32(c, d);
+        a = _mm_unpacklo_epi64(ab01, cd01);
+        b = _mm_unpackhi_epi64(ab01, cd01);
+        c = _mm_unpacklo_epi64(ab23, cd23);
+        d = _mm_unpackhi_epi64(ab23, cd23);
+    }
+
+    __attribute__((target("sse4.1")))
+    void hash4(const std::uint32_t key[8], const std::uint8_t* data, std::uint64_t counter, std::uint32_t* out) noexcept
+    {
+        __m128i h[8];
+        for (int i = 0; i < 8; ++i)
+        {
+            h[i] = _mm_set1_epi32(static_cast<int>(key[i]));
+        }
+        alignas(16) std::uint32_t low[4];
+        alignas(16) std::uint32_t high[4];
+        for (int lane = 0; lane < 4; ++lane)
+        {
+            low[lane] = static_cast<std::uint32_t>(counter + lane);
+            high[lane] = static_cast<std::uint32_t>((counter + lane) >> 32);
+        }
+        const __m128i counterLow = _mm_load_si128(reinterpret_cast<const __m128i*>(low));
+        const __m128i counterHigh = _mm_load_si128(reinterpret_cast<const __m128i*>(high));
+
+        for (size_t b = 0; b < CHUNK_LEN / BLOCK_LEN; ++b)
+        {
+            __m128i m[16];
+            for (int group = 0; group < 4; ++group)
+            {
+                for (int lane = 0; lane < 4; ++lane)
+                {
+                    m[4 * group + lane] = _mm_loadu_si128(
+                        reinterpret_cast<const __m128i*>(data + lane * CHUNK_LEN + b * BLOCK_LEN + 16 * group));
+                }
+                transpose4(m[4 * group], m[4 * group + 1], m[4 * group + 2], m[4 * group + 3]);
+            }
+
+            const std::uint32_t flags = (b == 0 ? CHUNK_START : 0) | (b + 1 == CHUNK_LEN / BLOCK_LEN ? CHUNK_END : 0);
+            __m128i v[16] = {
+                h[0], h[1], h[2], h[3], h[4], h[5], h[6], h[7],
+                _mm_set1_epi32(static_cast<int>(IV[0])), _mm_set1_epi32(static_cast<int>(IV[1])),
+                _mm_set1_epi32(static_cast<int>(IV[2])), _mm_set1_epi32(static_cast<int>(IV[3])),
+                counterLow, counterHigh,
+                _mm_set1_epi32(static_cast<int>(BLOCK_LEN)), _mm_set1_epi32(static_cast<int>(flags)),
+            };
+            for (const auto& order : MSG_SCHEDULE)
+            {
+                g4(v, 0, 4, 8, 12, m[order[0]], m[order[1]]);
+                g4(v, 1, 5, 9, 13, m[order[2]], m[order[3]]);
+                g4(v, 2, 6, 10, 14, m[order[4]], m[order[5]]);
+                g4(v, 3, 7, 11, 15, m[order[6]], m[order[7]]);
+                g4(v, 0, 5, 10, 15, m[order[8]], m[order[9]]);
+                g4(v, 1, 6, 11, 12, m[order[10]], m[order[11]]);
+                g4(v, 2, 7, 8, 13, m[order[12]], m[order[13]]);
+                g4(v, 3, 4, 9, 14, m[order[14]], m[order[15]]);
+            }
+            for (int i = 0; i < 8; ++i)
+            {
+                h[i] = _mm_xor_si128(v[i], v[i + 8]);
+            }
+        }
+
+        // Back from one vector per word to one chaining value per lane
+        transpose4(h[0], h[1], h[2], h[3]);
+        transpose4(h[4], h[5], h[6], h[7]);
+        for (int lane = 0; lane < 4; ++lane)
+        {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 8 * lane), h[lane]);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 8 * lane + 4), h[lane + 4]);
+        }
+    }
+
+    __attribute__((target("sse4.1")))
+    void hashChunksSse41(
+        const std::uint32_t key[8],
+        const std::uint8_t* data,
+        size_t chunks,
+        std::uint64_t counter,
+        std::uint32_t* out) noexcept
+    {
+        for (; chunks >= 4; chunks -= 4, data += 4 * CHUNK_LEN, counter += 4, out += 32)
+        {
+            hash4(key, data, counter, out);
+        }
+        hashChunksPortable(key, data, chunks, counter, out);
+    }
+
+    __attribute__((target("avx2")))
+    inline __m256i rotr16(__m256i x) noexcept
+    {
+        return _mm256_shuffle_epi8(x, _mm256_set_epi8(
+            13, 12, 15, 14, 9, 8, 11, 10, 5, 4, 7, 6, 1, 0, 3, 2,
+            13, 12, 15, 14, 9, 8, 11, 10, 5, 4, 7, 6, 1, 0, 3, 2));
+    }
+
+    __attribute__((target("avx2")))
+    inline __m256i rotr8(__m256i x) noexcept
+    {
+        return _mm256_shuffle_epi8(x, _mm256_set_epi8(
+            12, 15, 14, 13, 8, 11, 10, 9, 4, 7, 6, 5, 0, 3, 2, 1,
+            12, 15, 14, 13, 8, 11, 10, 9, 4, 7, 6, 5, 0, 3, 2, 1));
+    }
+
+    __attribute__((target("avx2")))
+    inline void g8(__m256i* v, int a, int b, int c, int d, __m256i x, __m256i y) noexcept
+    {
+        v[a] = _mm256_add_epi32(_mm256_add_epi32(v[a], v[b]), x);
+        v[d] = rotr16(_mm256_xor_si256(v[d], v[a]));
+        v[c] = _mm256_add_epi32(v[c], v[d]);
+        v[b] = _mm256_xor_si256(v[b], v[c]);
+        v[b] = _mm256_or_si256(_mm256_srli_epi32(v[b], 12), _mm256_slli_epi32(v[b], 20));
+        v[a] = _mm256_add_epi32(_mm256_add_epi32(v[a], v[b]), y);
+        v[d] = rotr8(_mm256_xor_si256(v[d], v[a]));
+        v[c] = _mm256_add_epi32(v[c], v[d]);
+        v[b] = _mm256_xor_si256(v[b], v[c]);
+        v[b] = _mm256_or_si256(_mm256_srli_epi32(v[b], 7), _mm256_slli_epi32(v[b], 25));
+    }
+
+    __attribute__((target("avx2")))
+    inline void transpose8(__m256i v[8]) noexcept
+    {
+        const __m256i ab0145 = _mm256_unpacklo_epi32(v[0], v[1]);
+        const __m256i ab2367 = _mm256_unpackhi_epi32(v[0], v[1]);
+        const __m256i cd0145 = _mm256_unpacklo_epi32(v[2], v[3]);
+        const __m256i cd2367 = _mm256_unpackhi_epi32(v[2], v[3]);
+        const __m256i ef0145 = _mm256_unpacklo_epi32(v[4], v[5]);
+        const __m256i ef2367 = _mm256_unpackhi_epi32(v[4], v[5]);
+        const __m256i gh0145 = _mm256_unpacklo_epi32(v[6], v[7]);
+        const __m256i gh2367 = _mm256_unpackhi_epi32(v[6], v[7]);
+
+        const __m256i abcd04 = _mm256_unpacklo_epi64(ab0145, cd0145);
+        const __m256i abcd15 = _mm256_unpackhi_epi64(ab0145, cd0145);
+        const __m256i abcd26 = _mm256_unpacklo_epi64(ab2367, cd2367);
+        const __m256i abcd37 = _mm256_unpackhi_epi64(ab2367, cd2367);
+        const __m256i efgh04 = _mm256_unpacklo_epi64(ef0145, gh0145);
+        const __m256i efgh15 = _mm256_unpackhi_epi64(ef0145, gh0145);
+        const __m256i efgh26 = _mm256_unpacklo_epi64(ef2367, gh2367);
+        const __m256i efgh37 = _mm256_unpackhi_epi64(ef2367, gh2367);
+
+        v[0] = _mm256_permute2x128_si256(abcd04, efgh04, 0x20);
+        v[1] = _mm256_permute2x128_si256(abcd15, efgh15, 0x20);
+        v[2] = _mm256_permute2x128_si256(abcd26, efgh26, 0x20);
+        v[3] = _mm256_permute2x128_si256(abcd37, efgh37, 0x20);
+        v[4] = _mm256_permute2x128_si256(abcd04, efgh04, 0x31);
+        v[5] = _mm256_permute2x128_si256(abcd15, efgh15, 0x31);
+        v[6] = _mm256_permute2x128_si256(abcd26, efgh26, 0x31);
+        v[7] = _mm256_permute2x128_si256(abcd37, efgh37, 0x31);
+    }
+
+    __attribute__((target("avx2")))
+    void hash8(const std::uint32_t key[8], const std::uint8_t* data, std::uint64_t counter, std::uint32_t* out) noexcept
+    {
+        __m256i h[8];
+        for (int i = 0; i < 8; ++i)
+        {
+            h[i] = _mm256_set1_epi32(static_cast<int>(key[i]));
+        }
+        alignas(32) std::uint32_t low[8];
+        alignas(32) std::uint32_t high[8];
+        for (int lane = 0; lane < 8; ++lane)
+        {
+            low[lane] = static_cast<std::uint32_t>(counter + lane);
+            high[lane] = static_cast<std::uint32_t>((counter + lane) >> 32);
+        }
+        const __m256i counterLow = _mm256_load_si256(reinterpret_cast<const __m256i*>(low));
+        const __m256i counterHigh = _mm256_load_si256(reinterpret_cast<const __m256i*>(high));
+
+        for (size_t b = 0; b < CHUNK_LEN / BLOCK_LEN; ++b)
+        {
+            __m256i m[16];
+            for (int half = 0; half < 2; ++half)
+            {
+                for (int lane = 0; lane < 8; ++lane)
+                {
+                    m[8 * half + lane] = _mm256_loadu_si256(
+                        reinterpret_cast<const __m256i*>(data + lane * CHUNK_LEN + b * BLOCK_LEN + 32 * half));
+                }
+                transpose8(m + 8 * half);
+            }
+
+            const std::uint32_t flags = (b == 0 ? CHUNK_START : 0) | (b + 1 == CHUNK_LEN / BLOCK_LEN ? CHUNK_END : 0);
+            __m256i v[16] = {
+                h[0], h[1], h[2], h[3], h[4], h[5], h[6], h[7],
+                _mm256_set1_epi32(static_cast<int>(IV[0])), _mm256_set1_epi32(static_cast<int>(IV[1])),
+                _mm256_set1_epi32(static_cast<int>(IV[2])), _mm256_set1_epi32(static_cast<int>(IV[3])),
+                counterLow, counterHigh,
+                _mm256_set1_epi32(static_cast<int>(BLOCK_LEN)), _mm256_set1_epi32(static_cast<int>(flags)),
+            };
+            for (const auto& order : MSG_SCHEDULE)
+            {
+                g8(v, 0, 4, 8, 12, m[order[0]], m[order[1]]);
+                g8(v, 1, 5, 9, 13, m[order[2]], m[order[3]]);
+                g8(v, 2, 6, 10, 14, m[order[4]], m[order[5]]);
+                g8(v, 3, 7, 11, 15, m[order[6]], m[order[7]]);
+                g8(v, 0, 5, 10, 15, m[order[8]], m[order[9]]);
+                g8(v, 1, 6, 11, 12, m[order[10]], m[order[11]]);
+                g8(v, 2, 7, 8, 13, m[order[12]], m[order[13]]);
+                g8(v, 3, 4, 9, 14, m[order[14]], m[order[15]]);
+            }
+            for (int i = 0; i < 8; ++i)
+            {
+                h[i] = _mm256_xor_si256(v[i], v[i + 8]);
+            }
+        }
+
+        transpose8(h);
+        for (int lane = 0; lane < 8; ++lane)
+        {
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 8 * lane), h[lane]);
+        }
+    }
+
+    __attribute__((target("avx2")))
+    void hashChunksAvx2(
+        const std::uint32_t key[8],
+        const std::uint8_t* data,
+        size_t chunks,
+        std::uint64_t counter,
+        std::uint32_t* out) noexcept
+    {
+        for (; chunks >= 8; chunks -= 8, data += 8 * CHUNK_LEN, counter += 8, out += 64)
+        {
+            hash8(key, data, counter, out);
+        }
+        hashChunksSse41(key, data, chunks, counter, out);
+    }
+#endif
+
+    using HashChunksFn = void (*)(const std::uint32_t*, const std::uint8_t*, size_t, std::uint64_t, std::uint32_t*) noexcept;
+
+    HashChunksFn selectHashChunks() noexcept
+    {
+#if defined(MIMIR_BLAKE3_X86)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+        {
+            return &hashChunksAvx2;
+        }
+        if (__builtin_cpu_supports("sse4.1"))
+        {
+            return &hashChunksSse41;
+        }
+#endif
+        return &hashChunksPortable;
+    }
+
+    const HashChunksFn hashChunks = selectHashChunks();
+
+    /// Chunks hashed per SIMD batch; a multiple of every lane count
+    constexpr size_t BATCH_CHUNKS = 16;
+
+    void pushChunkCv(detail::Blake3State& state, std::uint32_t cv[8], std::uint64_t totalChunks) noexcept
+    {
+        // Each trailing zero bit of the chunk count completes one subtree
+        while ((totalChunks & 1) == 0)
+        {
+            --state.cvStackLen;
+            parentOutput(state.cvStack[state.cvStackLen], cv, state.key).chainingValue(cv);
+            totalChunks >>= 1;
+        }
+        std::memcpy(state.cvStack[state.cvStackLen], cv, 8 * sizeof(std::uint32_t));
+        ++state.cvStackLen;
+    }
+}
+
+void detail::blake3Init(Blake3State& state) noexcept
+{
+    std::memcpy(state.key, IV, sizeof(state.key));
+    state.cvStackLen = 0;
+    resetChunk(state, 0);
+}
+
+void detail::blake3Update(Blake3State& state, const std::uint8_t* data, size_t len) noexcept
+{
+    while (len > 0)
+    {
+        if (chunkLength(state) == CHUNK_LEN)
+        {
+            std::uint32_t cv[8];
+            chunkOutput(state).chainingValue(cv);
+            const std::uint64_t totalChunks = state.chunkCounter + 1;
+            pushChunkCv(state, cv, totalChunks);
+            resetChunk(state, totalChunks);
+        }
+
+        // Whole chunks go straight from the caller's buffer, several at a time.
+        // At least one byte stays behind: the last chunk may be the root
+        if (chunkLength(state) == 0 && len > CHUNK_LEN)
+        {
+            const size_t chunks = std::min((len - 1) / CHUNK_LEN, BATCH_CHUNKS);
+            std::uint32_t cvs[BATCH_CHUNKS][8];
+            hashChunks(state.key, data, chunks, state.chunkCounter, cvs[0]);
+            for (size_t i = 0; i < chunks; ++i)
+            {
+                pushChunkCv(state, cvs[i], state.chunkCounter + i + 1);
+            }
+            resetChunk(state, state.chunkCounter + chunks);
+            data += chunks * CHUNK_LEN;
+            len -= chunks * CHUNK_LEN;
+            continue;
+        }
+
+        size_t want = CHUNK_LEN - chunkLength(state);
+        while (want > 0 && len > 0)
+        {
+            // A full block is only compressed once more input arrives, so the
+            // final block of a chunk is always left for chunkOutput()
+            if (state.blockLen == BLOCK_LEN)
+            {
+                const std::uint32_t flags = state.blocksCompressed == 0 ? CHUNK_START : 0;
+                compress(state.cv, state.block, BLOCK_LEN, state.chunkCounter, flags, state.cv);
+                ++state.blocksCompressed;
+                std::memset(state.block, 0, sizeof(state.block));
+                state.blockLen = 0;
+            }
+
+            const size_t take = std::min({want, len, BLOCK_LEN - state.blockLen});
+            std::memcpy(state.block + state.blockLen, data, take);
+            state.blockLen = static_cast<std::uint8_t>(state.blockLen + take);
+            data += take;
+            len -= take;
+            want -= take;
+        }
+    }
+}
+
+void detail::blake3Final(const Blake3State& state, std::uint8_t out[32]) noexcept
+{
+    Output output = chunkOutput(state);
+    for (size_t remaining = state.cvStackLen; remaining > 0; --remaining)
+    {
+        std::uint32_t cv[8];
+        output.chainingValue(cv);
+        output = parentOutput(state.cvStack[remaining - 1], cv, state.key);
+    }
+
+    std::uint32_t words[8];
+    compress(output.cv, output.block, output.blockLen, output.counter, output.flags | ROOT, words);
+    for (int i = 0; i < 8; ++i)
+    {
+        out[4 * i] = static_cast<std::uint8_t>(words[i]);
+        out[4 * i + 1] = static_cast<std::uint8_t>(words[i] >> 8);
+        out[4 * i + 2] = static_cast<std::uint8_t>(words[i] >> 16);
+        out[4 * i + 3] = static_cast<std::uint8_t>(words[i] >> 24);
+    }
+}
@@ -0,0 +1,213 @@
+#include "mimir/build_trace.h"
+#include "mimir/compiled_graph.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <set>
+#include <sstream>
+
+using namespace mimir;
+
+namespace
+{
+    /**
+    * @brief Quote a string for JSON
+    * @param out Stream to write to
+    * @param text Raw text
+    */
+    void writeJsonString(std::ostream& out, const std::string& text)
+    {
+        out << '"';
+        for (const char c : text)
+        {
+            switch (c)
+            {
+                case '"':
+                    out << "\\\"";
+                    break;
+                case '\\':
+                    out << "\\\\";
+                    break;
+                case '\n':
+                    out << "\\n";
+                    break;
+                case '\t':
+                    out << "\\t";
+                    break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20)
+                    {
+                        char escaped[8];
+                        std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+                        out << escaped;
+                    }
+                    else
+                    {
+                        out << c;
+                    }
+            }
+        }
+        out << '"';
+    }
+}
+
+BuildTrace::BuildTrace()
+    : epoch_(Clock::now())
+{
+}
+
+void BuildTrace::start()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    events_.clear();
+    epoch_ = Clock::now();
+}
+
+std::int64_t BuildTrace::elapsedUs() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - epoch_).count();
+}
+
+void BuildTrace::record(TraceEvent event)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    events_.push_back(std::move(event));
+}
+
+std::vector<TraceEvent> BuildTrace::events() const
+{
+    std::vector<TraceEvent> events;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        events = events_;
+    }
+    std::stable_sort(events.begin(), events.end(),
+        [](const TraceEvent& a, const TraceEvent& b) { return a.startUs < b.startUs; });
+    return events;
+}
+
+std::string BuildTrace::toChromeTrace() const
+{
+    const std::vector<TraceEvent> events = this->events();
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(3);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+    bool first = true;
+    const auto separate = [&out, &first]()
+    {
+        out << (first ? "" : ",\n");
+        first = false;
+    };
+
+    std::set<size_t> workers;
+    for (const auto& event : events)
+    {
+        workers.insert(event.worker);
+    }
+    for (const size_t worker : workers)
+    {
+        separate();
+        out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << worker
+            << ",\"args\":{\"name\":\"worker " << worker << "\"}}";
+    }
+
+    for (const auto& event : events)
+    {
+        separate();
+        out << "{\"name\":";
+        writeJsonString(out, event.name);
+        out << ",\"cat\":\"target\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.worker
+            << ",\"ts\":" << event.startUs << ",\"dur\":" << event.endUs - event.startUs
+            << ",\"args\":{\"status\":";
+        writeJsonString(out, event.status);
+        out << ",\"queue_us\":" << event.queueUs() << ",\"hash_us\":" << event.hashUs;
+        if (event.commandStartUs >= 0)
+        {
+            out << ",\"command_us\":" << event.commandUs << ",\"spawn_us\":" << event.spawnUs
+                << ",\"user_ms\":" << event.usage.userSeconds * 1000.0
+                << ",\"sys_ms\":" << event.usage.systemSeconds * 1000.0
+                << ",\"max_rss_kb\":" << event.usage.maxRssKb;
+        }
+        out << "}}";
+
+        if (event.commandStartUs >= 0)
+        {
+            separate();
+            out << "{\"name\":";
+            writeJsonString(out, event.name);
+            out << ",\"cat\":\"command\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.worker
+                << ",\"ts\":" << event.commandStartUs << ",\"dur\":" << event.commandUs << "}";
+        }
+    }
+    out << "\n]}\n";
+    return out.str();
+}
+
+bool BuildTrace::writeChromeTrace(const std::string& path) const
+{
+    std::ofstream file(path, std::ios::trunc);
+    if (!file.is_open())
+    {
+        return false;
+    }
+    file << toChromeTrace();
+    return file.good();
+}
+
+BuildProfile mimir::profileBuild(const DAG& dag, const Cache& cache, const size_t slowestCount)
+{
+    const CompiledGraph graph(dag);
+    BuildProfile profile;
+    profile.targets = graph.nodeCount();
+
+    std::vector<std::uint64_t> weights(graph.nodeCount(), 0);
+    for (NodeId node = 0; node < graph.nodeCount(); ++node)
+    {
+        const std::string& name = graph.target(node).getName();
+        if (const auto duration = cache.findDuration(name))
+        {
+            weights[node] = *duration;
+            profile.totalUs += *duration;
+            ++profile.recorded;
+            profile.slowest.emplace_back(name, *duration);
+        }
+    }
+    std::stable_sort(profile.slowest.begin(), profile.slowest.end(),
+        [](const BuildProfile::Entry& a, const BuildProfile::Entry& b) { return a.second > b.second; });
+    if (profile.slowest.size() > slowestCount)
+    {
+        profile.slowest.resize(slowestCount);
+    }
+
+    // Follow the heaviest dependent from the heaviest root down to a sink
+    const std::vector<std::uint64_t> lengths = graph.criticalPaths(weights);
+    std::optional<NodeId> current;
+    for (NodeId node = 0; node < graph.nodeCount(); ++node)
+    {
+        if (graph.inDegree(node) == 0 && (!current || lengths[node] > lengths[*current]))
+        {
+            current = node;
+        }
+    }
+    if (current)
+    {
+        profile.criticalPathUs = lengths[*current];
+    }
+    while (current)
+    {
+        profile.criticalPath.emplace_back(graph.target(*current).getName(), weights[*current]);
+        std::optional<NodeId> next;
+        for (const NodeId dependent : graph.dependents(*current))
+        {
+            if (!next || lengths[dependent] > lengths[*next])
+            {
+                next = dependent;
+            }
+        }
+        current = next;
+    }
+    return profile;
+}
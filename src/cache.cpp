@@ -1,4 +1,6 @@
 #include "mimir/cache.h"
+#include "mimir/signature.h"
+#include <cstdlib>
 #include <fstream>
 #include <sstream>
 #include <filesystem>
@@ -6,9 +8,74 @@
 namespace fs = std::filesystem;
 using namespace mimir;
 
-Cache::Cache(const std::string& cacheDir) 
+namespace
+{
+    /// A journal larger than this at load time is folded into the snapshot immediately
+    constexpr std::uint64_t COMPACT_JOURNAL_BYTES = 8 * 1024 * 1024;
+
+    /// Version written in the first line of the text format; files without it are version 1
+    constexpr int TEXT_FORMAT_VERSION = 4;
+    constexpr const char* TEXT_HEADER = "# mimir-cache ";
+
+    /**
+    * @brief Check if a record can stand in for rehashing the file
+    * @param record The stored record
+    * @param stamp The file's current stat tuple
+    * @return True if the file is unchanged, was not racily modified and was
+    *         hashed with the current algorithm
+    */
+    bool recordIsFresh(const FileRecord& record, const FileStamp& stamp)
+    {
+        return record.stamp == stamp
+            && record.stamp.mtimeNs + TIMESTAMP_SLACK_NS <= record.hashedAtNs
+            && record.algorithm == Signature::getAlgorithm();
+    }
+
+    /**
+    * @brief Consume the optional version header of a text cache file
+    * @param file Stream positioned at the start of the file
+    * @param line Receives the first data line, if the first line was not a header
+    * @param hasLine Set if line holds data that still needs processing
+    * @return False if the file was written by a newer, unknown version
+    */
+    bool readTextHeader(std::istream& file, std::string& line, bool& hasLine)
+    {
+        hasLine = false;
+        if (!std::getline(file, line))
+        {
+            return true;
+        }
+        if (line.rfind(TEXT_HEADER, 0) != 0)
+        {
+            hasLine = true;
+            return true;
+        }
+        const int version = std::atoi(line.c_str() + std::char_traits<char>::length(TEXT_HEADER));
+        return version >= 1 && version <= TEXT_FORMAT_VERSION;
+    }
+
+    size_t roundUpToPowerOfTwo(size_t value)
+    {
+        size_t result = 1;
+        while (result < value)
+        {
+            result <<= 1;
+        }
+        return result;
+    }
+}
+
+Cache::Cache(const std::string& cacheDir, const size_t shardCount)
     : cacheDir_(cacheDir)
-    , cacheFile_(cacheDir + "/cache.txt")
+    , cacheFile_(cacheDir + "/cache.bin")
+    , textCacheFile_(cacheDir + "/cache.txt")
+    , fileRecordFile_(cacheDir + "/files.txt")
+    , durationFile_(cacheDir + "/durations.txt")
+    , outputSignatureFile_(cacheDir + "/outputs.txt")
+    , journalFile_(cacheDir + "/journal.log")
+    , format_(CacheFormat::Binary)
+    , shards_(new Shard[roundUpToPowerOfTwo(shardCount == 0 ? 1 : shardCount)])
+    , shardMask_(roundUpToPowerOfTwo(shardCount == 0 ? 1 : shardCount) - 1)
 {
     ensureCacheDir();
 }
@@ -16,7 +83,16 @@ Cache::Cache(const std::string& cacheDir)
 Cache::Cache(Cache&& other) noexcept
     : cacheDir_(std::move(other.cacheDir_))
     , cacheFile_(std::move(other.cacheFile_))
-    , signatures_(std::move(other.signatures_))
+    , textCacheFile_(std::move(other.textCacheFile_))
+    , fileRecordFile_(std::move(other.fileRecordFile_))
+    , durationFile_(std::move(other.durationFile_))
+    , outputSignatureFile_(std::move(other.outputSignatureFile_))
+    , journalFile_(std::move(other.journalFile_))
+    , format_(other.format_)
+    , journal_(std::move(other.journal_))
+    , image_(std::move(other.image_))
+    , shards_(std::move(other.shards_))
+    , shardMask_(other.shardMask_)
 {
 }
 
@@ -24,10 +100,22 @@ Cache& Cache::operator=(Cache&& other) noexcept
 {
     if (this != &other)
     {
-        std::unique_lock<std::shared_mutex> lock(mutex_);
+        ExclusiveLocks locks = lockAllShards();
         cacheDir_ = std::move(other.cacheDir_);
         cacheFile_ = std::move(other.cacheFile_);
-        signatures_ = std::move(other.signatures_);
+        textCacheFile_ = std::move(other.textCacheFile_);
+        fileRecordFile_ = std::move(other.fileRecordFile_);
+        durationFile_ = std::move(other.durationFile_);
+        outputSignatureFile_ = std::move(other.outputSignatureFile_);
+        journalFile_ = std::move(other.journalFile_);
+        format_ = other.format_;
+        journal_ = std::move(other.journal_);
+        image_ = std::move(other.image_);
+        std::unique_ptr<Shard[]> previous = std::move(shards_);
+        shards_ = std::move(other.shards_);
+        shardMask_ = other.shardMask_;
+        // The old shards' mutexes are still held by locks; release them before freeing
+        locks.clear();
     }
     return *this;
 }
@@ -42,26 +130,196 @@ bool Cache::ensureCacheDir() const
     return true;
 }
 
+Cache::Shard& Cache::shardFor(const std::string& key) const
+{
+    return shards_[std::hash<std::string>{}(key) & shardMask_];
+}
+
+Cache::ExclusiveLocks Cache::lockAllShards() const
+{
+    ExclusiveLocks locks;
+    if (!shards_)
+    {
+        return locks;
+    }
+    locks.reserve(shardMask_ + 1);
+    for (size_t i = 0; i <= shardMask_; ++i)
+    {
+        locks.emplace_back(shards_[i].mutex);
+    }
+    return locks;
+}
+
+Cache::SharedLocks Cache::lockAllShardsShared() const
+{
+    SharedLocks locks;
+    locks.reserve(shardMask_ + 1);
+    for (size_t i = 0; i <= shardMask_; ++i)
+    {
+        locks.emplace_back(shards_[i].mutex);
+    }
+    return locks;
+}
+
+void Cache::resetLocked()
+{
+    image_.close();
+    for (size_t i = 0; i <= shardMask_; ++i)
+    {
+        shards_[i].signatures.clear();
+        shards_[i].fileRecords.clear();
+        shards_[i].durations.clear();
+        shards_[i].outputSignatures.clear();
+    }
+}
+
 bool Cache::load()
 {
-    std::unique_lock<std::shared_mutex> lock(mutex_);
-    
-    std::ifstream file(cacheFile_);
+    ExclusiveLocks locks = lockAllShards();
+
+    resetLocked();
+    const bool loaded = image_.open(cacheFile_) || loadText();
+
+    if (journal_)
+    {
+        journal_->flush();
+    }
+    const JournalReplayResult replayed = CacheJournal::replay(journalFile_, [this](const JournalEntry& entry)
+    {
+        applyJournalEntry(entry);
+    });
+    if (replayed.validBytes > COMPACT_JOURNAL_BYTES)
+    {
+        writeSnapshot();
+    }
+    return loaded || replayed.records > 0;
+}
+
+void Cache::applyJournalEntry(const JournalEntry& entry)
+{
+    switch (entry.type)
+    {
+        case JournalRecordType::SetSignature:
+            shardFor(entry.key).signatures[entry.key] = entry.value;
+            break;
+        case JournalRecordType::RemoveSignature:
+            shardFor(entry.key).signatures[entry.key] = std::nullopt;
+            break;
+        case JournalRecordType::SetFileRecord:
+            shardFor(entry.key).fileRecords[entry.key] = entry.record;
+            break;
+        case JournalRecordType::RemoveFileRecord:
+            shardFor(entry.key).fileRecords[entry.key] = std::nullopt;
+            break;
+        case JournalRecordType::Clear:
+            resetLocked();
+            break;
+        case JournalRecordType::SetDuration:
+            shardFor(entry.key).durations[entry.key] = entry.durationUs;
+            break;
+        case JournalRecordType::SetOutputSignature:
+            shardFor(entry.key).outputSignatures[entry.key] = entry.value;
+            break;
+    }
+}
+
+bool Cache::loadText()
+{
+    std::ifstream file(textCacheFile_);
     if (!file.is_open())
     {
         return false;
     }
-    
-    signatures_.clear();
+
     std::string line;
-    while (std::getline(file, line))
+    bool hasLine = false;
+    if (!readTextHeader(file, line, hasLine))
+    {
+        return false;
+    }
+    while (hasLine || std::getline(file, line))
     {
+        hasLine = false;
         size_t pos = line.find('=');
         if (pos != std::string::npos)
         {
             std::string key = line.substr(0, pos);
             std::string value = line.substr(pos + 1);
-            signatures_[key] = value;
+            shardFor(key).signatures[key] = value;
+        }
+    }
+
+    std::ifstream records(fileRecordFile_);
+    if (!readTextHeader(records, line, hasLine))
+    {
+        return true;
+    }
+    while (hasLine || std::getline(records, line))
+    {
+        hasLine = false;
+
+        // size mtime inode hashedAt algorithm hash path (path last so it may contain spaces)
+        std::istringstream fields(line);
+        FileRecord record;
+        std::string algorithm;
+        if (!(fields >> record.stamp.size >> record.stamp.mtimeNs >> record.stamp.inode
+                     >> record.hashedAtNs >> algorithm >> record.hash))
+        {
+            continue;
+        }
+        const auto parsed = Hasher::parseAlgorithm(algorithm);
+        if (!parsed)
+        {
+            continue;
+        }
+        record.algorithm = *parsed;
+        fields.get();
+        std::string path;
+        std::getline(fields, path);
+        if (!path.empty())
+        {
+            shardFor(path).fileRecords[path] = std::move(record);
+        }
+    }
+
+    // durationUs target (target last so it may contain spaces); added in version 3
+    std::ifstream durations(durationFile_);
+    if (!readTextHeader(durations, line, hasLine))
+    {
+        return true;
+    }
+    while (hasLine || std::getline(durations, line))
+    {
+        hasLine = false;
+        std::istringstream fields(line);
+        std::uint64_t durationUs = 0;
+        if (!(fields >> durationUs))
+        {
+            continue;
+        }
+        fields.get();
+        std::string targetName;
+        std::getline(fields, targetName);
+        if (!targetName.empty())
+        {
+            shardFor(targetName).durations[targetName] = durationUs;
+        }
+    }
+
+    // target=signature, as in cache.txt; added in version 4
+    std::ifstream outputs(outputSignatureFile_);
+    if (!readTextHeader(outputs, line, hasLine))
+    {
+        return true;
+    }
+    while (hasLine || std::getline(outputs, line))
+    {
+        hasLine = false;
+        const size_t pos = line.rfind('=');
+        if (pos != std::string::npos && pos > 0)
+        {
+            const std::string targetName = line.substr(0, pos);
+            shardFor(targetName).outputSignatures[targetName] = line.substr(pos + 1);
         }
     }
     return true;
@@ -69,83 +327,558 @@ bool Cache::load()
 
 bool Cache::save() const
 {
-    std::shared_lock<std::shared_mutex> lock(mutex_);
-    
+    SharedLocks locks = lockAllShardsShared();
+    return writeSnapshot();
+}
+
+bool Cache::checkpoint() const
+{
+    SharedLocks locks = lockAllShardsShared();
+    if (!journal_)
+    {
+        return writeSnapshot();
+    }
+    journal_->flush();
+    if (journal_->sizeBytes() > COMPACT_JOURNAL_BYTES)
+    {
+        return writeSnapshot();
+    }
+    return journal_->good();
+}
+
+bool Cache::writeSnapshot() const
+{
     ensureCacheDir();
-    
-    std::ofstream file(cacheFile_);
-    if (!file.is_open())
+
+    std::error_code ec;
+    if (format_ == CacheFormat::Text)
     {
-        return false;
+        if (!saveText())
+        {
+            return false;
+        }
+        fs::remove(cacheFile_, ec);
+    }
+    else
+    {
+        if (!saveBinary())
+        {
+            return false;
+        }
+        fs::remove(textCacheFile_, ec);
+        fs::remove(fileRecordFile_, ec);
+        fs::remove(durationFile_, ec);
+        fs::remove(outputSignatureFile_, ec);
     }
-    
-    for (const auto& [targetName, signature] : signatures_)
+
+    // Only after the snapshot is in place may the journal be dropped
+    if (journal_)
+    {
+        journal_->truncate();
+    }
+    else
     {
-        file << targetName << "=" << signature << "\n";
+        fs::remove(journalFile_, ec);
     }
     return true;
 }
 
-std::string Cache::getSignature(const std::string& targetName) const
+bool Cache::saveText() const
 {
-    std::shared_lock<std::shared_mutex> lock(mutex_);
-    
-    auto it = signatures_.find(targetName);
-    return it != signatures_.end() ? it->second : "";
+    // Built in memory and swapped in whole: the journal is dropped right after
+    std::ostringstream file;
+    file << TEXT_HEADER << TEXT_FORMAT_VERSION << "\n";
+    for (size_t i = 0; i < image_.signatureCount(); ++i)
+    {
+        const auto [targetName, signature] = image_.signatureAt(i);
+        const std::string key(targetName);
+        if (shardFor(key).signatures.count(key) == 0)
+        {
+            file << targetName << "=" << signature << "\n";
+        }
+    }
+    for (size_t i = 0; i <= shardMask_; ++i)
+    {
+        for (const auto& [targetName, signature] : shards_[i].signatures)
+        {
+            if (signature)
+            {
+                file << targetName << "=" << *signature << "\n";
+            }
+        }
+    }
+
+    std::ostringstream records;
+
+    const auto writeRecord = [&records](std::string_view path, const FileRecord& record)
+    {
+        records << record.stamp.size << ' ' << record.stamp.mtimeNs << ' ' << record.stamp.inode << ' '
+                << record.hashedAtNs << ' ' << Hasher::algorithmName(record.algorithm) << ' '
+                << record.hash << ' ' << path << "\n";
+    };
+    records << TEXT_HEADER << TEXT_FORMAT_VERSION << "\n";
+    for (size_t i = 0; i < image_.fileRecordCount(); ++i)
+    {
+        const auto [path, record] = image_.fileRecordAt(i);
+        const std::string key(path);
+        if (shardFor(key).fileRecords.count(key) == 0)
+        {
+            writeRecord(path, record);
+        }
+    }
+    for (size_t i = 0; i <= shardMask_; ++i)
+    {
+        for (const auto& [path, record] : shards_[i].fileRecords)
+        {
+            if (record)
+            {
+                writeRecord(path, *record);
+            }
+        }
+    }
+
+    std::ostringstream durations;
+
+    durations << TEXT_HEADER << TEXT_FORMAT_VERSION << "\n";
+    for (size_t i = 0; i < image_.durationCount(); ++i)
+    {
+        const auto [targetName, durationUs] = image_.durationAt(i);
+        const std::string key(targetName);
+        if (shardFor(key).durations.count(key) == 0)
+        {
+            durations << durationUs << ' ' << targetName << "\n";
+        }
+    }
+    for (size_t i = 0; i <= shardMask_; ++i)
+    {
+        for (const auto& [targetName, durationUs] : shards_[i].durations)
+        {
+            durations << durationUs << ' ' << targetName << "\n";
+        }
+    }
+
+    std::ostringstream outputs;
+
+    outputs << TEXT_HEADER << TEXT_FORMAT_VERSION << "\n";
+    for (size_t i = 0; i < image_.outputSignatureCount(); ++i)
+    {
+        const auto [targetName, signature] = image_.outputSignatureAt(i);
+        const std::string key(targetName);
+        if (shardFor(key).outputSignatures.count(key) == 0)
+        {
+            outputs << targetName << "=" << signature << "\n";
+        }
+    }
+    for (size_t i = 0; i <= shardMask_; ++i)
+    {
+        for (const auto& [targetName, signature] : shards_[i].outputSignatures)
+        {
+            outputs << targetName << "=" << signature << "\n";
+        }
+    }
+    return replaceFileDurably(textCacheFile_, {file.str()})
+        && replaceFileDurably(fileRecordFile_, {records.str()})
+        && replaceFileDurably(durationFile_, {durations.str()})
+        && replaceFileDurably(outputSignatureFile_, {outputs.str()});
 }
 
-std::optional<std::string> Cache::findSignature(const std::string& targetName) const
+bool Cache::saveBinary() const
 {
-    std::shared_lock<std::shared_mutex> lock(mutex_);
-    
-    auto it = signatures_.find(targetName);
-    if (it != signatures_.end())
+    // Signature views point straight into the mapped image; image file records
+    // are decoded into imageRecords, which outlives the write
+    std::vector<CacheImage::SignatureEntry> signatures;
+    signatures.reserve(image_.signatureCount());
+    for (size_t i = 0; i < image_.signatureCount(); ++i)
+    {
+        const CacheImage::SignatureEntry entry = image_.signatureAt(i);
+        const std::string key(entry.first);
+        if (shardFor(key).signatures.count(key) == 0)
+        {
+            signatures.push_back(entry);
+        }
+    }
+
+    std::vector<std::pair<std::string_view, FileRecord>> imageRecords;
+    imageRecords.reserve(image_.fileRecordCount());
+    for (size_t i = 0; i < image_.fileRecordCount(); ++i)
+    {
+        auto entry = image_.fileRecordAt(i);
+        const std::string key(entry.first);
+        if (shardFor(key).fileRecords.count(key) == 0)
+        {
+            imageRecords.push_back(std::move(entry));
+        }
+    }
+
+    std::vector<CacheImage::FileRecordEntry> records;
+    records.reserve(imageRecords.size());
+    for (const auto& [path, record] : imageRecords)
+    {
+        records.emplace_back(path, &record);
+    }
+
+    std::vector<CacheImage::DurationEntry> durations;
+    durations.reserve(image_.durationCount());
+    for (size_t i = 0; i < image_.durationCount(); ++i)
+    {
+        const CacheImage::DurationEntry entry = image_.durationAt(i);
+        const std::string key(entry.first);
+        if (shardFor(key).durations.count(key) == 0)
+        {
+            durations.push_back(entry);
+        }
+    }
+
+    std::vector<CacheImage::SignatureEntry> outputs;
+    outputs.reserve(image_.outputSignatureCount());
+    for (size_t i = 0; i < image_.outputSignatureCount(); ++i)
+    {
+        const CacheImage::SignatureEntry entry = image_.outputSignatureAt(i);
+        const std::string key(entry.first);
+        if (shardFor(key).outputSignatures.count(key) == 0)
+        {
+            outputs.push_back(entry);
+        }
+    }
+
+    for (size_t i = 0; i <= shardMask_; ++i)
+    {
+        for (const auto& [targetName, signature] : shards_[i].signatures)
+        {
+            if (signature)
+            {
+                signatures.emplace_back(targetName, *signature);
+            }
+        }
+        for (const auto& [targetName, durationUs] : shards_[i].durations)
+        {
+            durations.emplace_back(targetName, durationUs);
+        }
+        for (const auto& [targetName, signature] : shards_[i].outputSignatures)
+        {
+            outputs.emplace_back(targetName, signature);
+        }
+        for (const auto& [path, record] : shards_[i].fileRecords)
+        {
+            if (record)
+            {
+                records.emplace_back(path, &*record);
+            }
+        }
+    }
+
+    return CacheImage::write(cacheFile_, std::move(signatures), std::move(records), std::move(durations),
+        std::move(outputs));
+}
+
+bool Cache::enableJournal()
+{
+    ExclusiveLocks locks = lockAllShards();
+    if (journal_)
+    {
+        return journal_->good();
+    }
+
+    ensureCacheDir();
+    auto journal = std::make_unique<CacheJournal>(journalFile_);
+    if (!journal->open())
+    {
+        return false;
+    }
+    journal_ = std::move(journal);
+    return true;
+}
+
+void Cache::flushJournal()
+{
+    std::shared_lock<std::shared_mutex> lock(shards_[0].mutex);
+    if (journal_)
+    {
+        journal_->flush();
+    }
+}
+
+bool Cache::isJournalEnabled() const
+{
+    std::shared_lock<std::shared_mutex> lock(shards_[0].mutex);
+    return journal_ != nullptr;
+}
+
+void Cache::setFormat(const CacheFormat format)
+{
+    ExclusiveLocks locks = lockAllShards();
+    format_ = format;
+}
+
+CacheFormat Cache::getFormat() const
+{
+    std::shared_lock<std::shared_mutex> lock(shards_[0].mutex);
+    return format_;
+}
+
+std::optional<std::string> Cache::lookupSignature(const Shard& shard, const std::string& targetName) const
+{
+    auto it = shard.signatures.find(targetName);
+    if (it != shard.signatures.end())
     {
         return it->second;
     }
+    if (auto mapped = image_.findSignature(targetName))
+    {
+        return std::string(*mapped);
+    }
     return std::nullopt;
 }
 
+std::optional<FileRecord> Cache::lookupFileRecord(const Shard& shard, const std::string& path) const
+{
+    auto it = shard.fileRecords.find(path);
+    if (it != shard.fileRecords.end())
+    {
+        return it->second;
+    }
+    return image_.findFileRecord(path);
+}
+
+std::string Cache::getSignature(const std::string& targetName) const
+{
+    const Shard& shard = shardFor(targetName);
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    return lookupSignature(shard, targetName).value_or("");
+}
+
+std::optional<std::string> Cache::findSignature(const std::string& targetName) const
+{
+    const Shard& shard = shardFor(targetName);
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    return lookupSignature(shard, targetName);
+}
+
 void Cache::setSignature(const std::string& targetName, const std::string& signature)
 {
-    std::unique_lock<std::shared_mutex> lock(mutex_);
-    signatures_[targetName] = signature;
+    Shard& shard = shardFor(targetName);
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    shard.signatures[targetName] = signature;
+    if (journal_)
+    {
+        journal_->appendSetSignature(targetName, signature);
+    }
 }
 
 bool Cache::needsRebuild(const std::string& targetName, const std::string& currentSignature) const
 {
-    std::shared_lock<std::shared_mutex> lock(mutex_);
-    
-    auto it = signatures_.find(targetName);
-    if (it == signatures_.end())
+    const Shard& shard = shardFor(targetName);
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+
+    const std::optional<std::string> stored = lookupSignature(shard, targetName);
+    return !stored || *stored != currentSignature;
+}
+
+std::string Cache::getFileSignature(const std::string& path)
+{
+    Shard& shard = shardFor(path);
+    const std::optional<FileStamp> stamp = statFile(path);
+    if (!stamp)
     {
-        return true;
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        if (lookupFileRecord(shard, path) && journal_)
+        {
+            journal_->appendRemoveFileRecord(path);
+        }
+        if (image_.findFileRecord(path))
+        {
+            shard.fileRecords[path] = std::nullopt;
+        }
+        else
+        {
+            shard.fileRecords.erase(path);
+        }
+        return Signature::computeFileSignature(path);
+    }
+
+    {
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        const std::optional<FileRecord> existing = lookupFileRecord(shard, path);
+        if (existing && recordIsFresh(*existing, *stamp))
+        {
+            return existing->hash;
+        }
+    }
+
+    // Stamp taken before hashing: a write during the hash changes the stamp and
+    // forces a rehash next time
+    FileRecord record;
+    record.stamp = *stamp;
+    record.hashedAtNs = currentTimeNs();
+    record.algorithm = Signature::getAlgorithm();
+    record.hash = Signature::computeFileSignature(path);
+    if (record.hash.empty())
+    {
+        return record.hash;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    shard.fileRecords[path] = record;
+    if (journal_)
+    {
+        journal_->appendFileRecord(path, record);
+    }
+    return record.hash;
+}
+
+std::optional<FileRecord> Cache::findFileRecord(const std::string& path) const
+{
+    const Shard& shard = shardFor(path);
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    return lookupFileRecord(shard, path);
+}
+
+void Cache::setFileRecord(const std::string& path, const FileRecord& record)
+{
+    Shard& shard = shardFor(path);
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    shard.fileRecords[path] = record;
+    if (journal_)
+    {
+        journal_->appendFileRecord(path, record);
+    }
+}
+
+std::optional<std::uint64_t> Cache::findDuration(const std::string& targetName) const
+{
+    const Shard& shard = shardFor(targetName);
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    auto it = shard.durations.find(targetName);
+    if (it != shard.durations.end())
+    {
+        return it->second;
+    }
+    return image_.findDuration(targetName);
+}
+
+void Cache::setDuration(const std::string& targetName, const std::uint64_t durationUs)
+{
+    Shard& shard = shardFor(targetName);
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    shard.durations[targetName] = durationUs;
+    if (journal_)
+    {
+        journal_->appendDuration(targetName, durationUs);
+    }
+}
+
+std::optional<std::string> Cache::findOutputSignature(const std::string& targetName) const
+{
+    const Shard& shard = shardFor(targetName);
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    auto it = shard.outputSignatures.find(targetName);
+    if (it != shard.outputSignatures.end())
+    {
+        return it->second;
+    }
+    if (auto mapped = image_.findOutputSignature(targetName))
+    {
+        return std::string(*mapped);
+    }
+    return std::nullopt;
+}
+
+void Cache::setOutputSignature(const std::string& targetName, const std::string& signature)
+{
+    Shard& shard = shardFor(targetName);
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    shard.outputSignatures[targetName] = signature;
+    if (journal_)
+    {
+        journal_->appendOutputSignature(targetName, signature);
     }
-    return it->second != currentSignature;
+}
+
+size_t Cache::fileRecordCount() const
+{
+    SharedLocks locks = lockAllShardsShared();
+
+    size_t count = image_.fileRecordCount();
+    for (size_t i = 0; i <= shardMask_; ++i)
+    {
+        for (const auto& [path, record] : shards_[i].fileRecords)
+        {
+            const bool inImage = image_.findFileRecord(path).has_value();
+            if (record && !inImage)
+            {
+                ++count;
+            }
+            else if (!record && inImage)
+            {
+                --count;
+            }
+        }
+    }
+    return count;
+}
+
+size_t Cache::shardCount() const noexcept
+{
+    return shardMask_ + 1;
 }
 
 bool Cache::removeSignature(const std::string& targetName)
 {
-    std::unique_lock<std::shared_mutex> lock(mutex_);
-    return signatures_.erase(targetName) > 0;
+    Shard& shard = shardFor(targetName);
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+
+    const bool existed = lookupSignature(shard, targetName).has_value();
+    if (existed && journal_)
+    {
+        journal_->appendRemoveSignature(targetName);
+    }
+    if (image_.findSignature(targetName))
+    {
+        shard.signatures[targetName] = std::nullopt;
+    }
+    else
+    {
+        shard.signatures.erase(targetName);
+    }
+    return existed;
 }
 
 void Cache::clear()
 {
-    std::unique_lock<std::shared_mutex> lock(mutex_);
-    signatures_.clear();
+    ExclusiveLocks locks = lockAllShards();
+    resetLocked();
+    if (journal_)
+    {
+        journal_->appendClear();
+    }
 }
 
 size_t Cache::size() const
 {
-    std::shared_lock<std::shared_mutex> lock(mutex_);
-    return signatures_.size();
+    SharedLocks locks = lockAllShardsShared();
+
+    size_t count = image_.signatureCount();
+    for (size_t i = 0; i <= shardMask_; ++i)
+    {
+        for (const auto& [targetName, signature] : shards_[i].signatures)
+        {
+            const bool inImage = image_.findSignature(targetName).has_value();
+            if (signature && !inImage)
+            {
+                ++count;
+            }
+            else if (!signature && inImage)
+            {
+                --count;
+            }
+        }
+    }
+    return count;
 }
 
 bool Cache::empty() const
 {
-    std::shared_lock<std::shared_mutex> lock(mutex_);
-    return signatures_.empty();
+    return size() == 0;
 }
 
 const std::string& Cache::getCacheDir() const noexcept
@@ -156,4 +889,29 @@ const std::string& Cache::getCacheDir() const noexcept
 const std::string& Cache::getCacheFile() const noexcept
 {
     return cacheFile_;
-}
\ No newline at end of file
+}
+
+const std::string& Cache::getTextCacheFile() const noexcept
+{
+    return textCacheFile_;
+}
+
+const std::string& Cache::getFileRecordFile() const noexcept
+{
+    return fileRecordFile_;
+}
+
+const std::string& Cache::getDurationFile() const noexcept
+{
+    return durationFile_;
+}
+
+const std::string& Cache::getOutputSignatureFile() const noexcept
+{
+    return outputSignatureFile_;
+}
+
+const std::string& Cache::getJournalFile() const noexcept
+{
+    return journalFile_;
+}
@@ -0,0 +1,587 @@
+#include "mimir/cache_format.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <tuple>
+#include <fstream>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace mimir;
+
+struct CacheImage::Header
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t byteOrder;        ///< BYTE_ORDER_MARK as written; rejects foreign-endian files
+    std::uint32_t signatureCount;
+    std::uint32_t fileRecordCount;
+    std::uint64_t poolOffset;
+    std::uint64_t poolSize;
+    // Version 2 and later
+    std::uint32_t durationCount;
+    std::uint32_t outputCount;      ///< Version 3 and later; reserved (zero) before
+};
+
+struct CacheImage::SignatureSlot
+{
+    std::uint32_t keyOffset;
+    std::uint32_t keyLength;
+    std::uint32_t valueOffset;
+    std::uint32_t valueLength;
+};
+
+struct CacheImage::FileSlot
+{
+    std::uint32_t pathOffset;
+    std::uint32_t pathLength;
+    std::uint32_t hashOffset;
+    std::uint32_t hashLength;
+    std::uint64_t size;
+    std::int64_t mtimeNs;
+    std::uint64_t inode;
+    std::int64_t hashedAtNs;
+    std::uint32_t algorithm;
+    std::uint32_t reserved;
+};
+
+struct CacheImage::DurationSlot
+{
+    std::uint32_t keyOffset;
+    std::uint32_t keyLength;
+    std::uint64_t durationUs;
+};
+
+namespace
+{
+    constexpr std::uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+    /// Size of the version 1 header, which ends at poolSize
+    constexpr size_t V1_HEADER_SIZE = 40;
+
+    /// @brief Accumulates strings into the pool, returning (offset, length) references
+    class PoolBuilder
+    {
+    public:
+        std::pair<std::uint32_t, std::uint32_t> add(std::string_view value)
+        {
+            const auto offset = static_cast<std::uint32_t>(pool_.size());
+            pool_.append(value.data(), value.size());
+            return {offset, static_cast<std::uint32_t>(value.size())};
+        }
+
+        const std::string& bytes() const noexcept
+        {
+            return pool_;
+        }
+
+    private:
+        std::string pool_;
+    };
+
+    template <typename Slot, typename Key>
+    const Slot* lowerBound(const Slot* first, const Slot* last, std::string_view key, Key slotKey)
+    {
+        return std::lower_bound(first, last, key, [&](const Slot& slot, std::string_view value)
+        {
+            return slotKey(slot) < value;
+        });
+    }
+}
+
+CacheImage::~CacheImage()
+{
+    close();
+}
+
+CacheImage::CacheImage(CacheImage&& other) noexcept
+    : data_(other.data_)
+    , size_(other.size_)
+    , mapped_(other.mapped_)
+{
+    other.data_ = nullptr;
+    other.size_ = 0;
+    other.mapped_ = false;
+}
+
+CacheImage& CacheImage::operator=(CacheImage&& other) noexcept
+{
+    if (this != &other)
+    {
+        close();
+        data_ = other.data_;
+        size_ = other.size_;
+        mapped_ = other.mapped_;
+        other.data_ = nullptr;
+        other.size_ = 0;
+        other.mapped_ = false;
+    }
+    return *this;
+}
+
+bool CacheImage::open(const std::string& path)
+{
+    close();
+
+#ifdef _WIN32
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+    {
+        return false;
+    }
+    const auto length = static_cast<size_t>(file.tellg());
+    if (length < V1_HEADER_SIZE)
+    {
+        return false;
+    }
+    auto* buffer = new char[length];
+    file.seekg(0);
+    if (!file.read(buffer, static_cast<std::streamsize>(length)))
+    {
+        delete[] buffer;
+        return false;
+    }
+    data_ = buffer;
+    size_ = length;
+    mapped_ = false;
+#else
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct stat st{};
+    if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < V1_HEADER_SIZE)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    const auto length = static_cast<size_t>(st.st_size);
+    void* mapping = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        return false;
+    }
+    data_ = static_cast<const char*>(mapping);
+    size_ = length;
+    mapped_ = true;
+#endif
+
+    if (!validate())
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void CacheImage::close() noexcept
+{
+    if (data_ == nullptr)
+    {
+        return;
+    }
+#ifndef _WIN32
+    if (mapped_)
+    {
+        ::munmap(const_cast<char*>(data_), size_);
+    }
+    else
+#endif
+    {
+        delete[] data_;
+    }
+    data_ = nullptr;
+    size_ = 0;
+    mapped_ = false;
+}
+
+bool CacheImage::isOpen() const noexcept
+{
+    return data_ != nullptr;
+}
+
+const CacheImage::Header* CacheImage::header() const noexcept
+{
+    return reinterpret_cast<const Header*>(data_);
+}
+
+size_t CacheImage::headerSize() const noexcept
+{
+    return header()->version >= 2 ? sizeof(Header) : V1_HEADER_SIZE;
+}
+
+const CacheImage::SignatureSlot* CacheImage::signatureSlots() const noexcept
+{
+    return reinterpret_cast<const SignatureSlot*>(data_ + headerSize());
+}
+
+const CacheImage::FileSlot* CacheImage::fileSlots() const noexcept
+{
+    return reinterpret_cast<const FileSlot*>(signatureSlots() + header()->signatureCount);
+}
+
+const CacheImage::DurationSlot* CacheImage::durationSlots() const noexcept
+{
+    return reinterpret_cast<const DurationSlot*>(fileSlots() + header()->fileRecordCount);
+}
+
+const CacheImage::SignatureSlot* CacheImage::outputSlots() const noexcept
+{
+    return reinterpret_cast<const SignatureSlot*>(durationSlots() + durationCount());
+}
+
+std::string_view CacheImage::poolString(const std::uint32_t offset, const std::uint32_t length) const noexcept
+{
+    return std::string_view(data_ + header()->poolOffset + offset, length);
+}
+
+bool CacheImage::validate() const noexcept
+{
+    const Header* h = header();
+    if (std::memcmp(h->magic, MAGIC, sizeof(MAGIC)) != 0
+        || h->version < MIN_VERSION || h->version > VERSION
+        || h->byteOrder != BYTE_ORDER_MARK
+        || size_ < headerSize())
+    {
+        return false;
+    }
+
+    const std::uint64_t indexBytes = headerSize()
+        + std::uint64_t{h->signatureCount} * sizeof(SignatureSlot)
+        + std::uint64_t{h->fileRecordCount} * sizeof(FileSlot)
+        + std::uint64_t{durationCount()} * sizeof(DurationSlot)
+        + std::uint64_t{outputSignatureCount()} * sizeof(SignatureSlot);
+    if (h->poolOffset != indexBytes || h->poolOffset + h->poolSize != size_)
+    {
+        return false;
+    }
+
+    const auto inPool = [h](std::uint64_t offset, std::uint64_t length)
+    {
+        return offset + length <= h->poolSize;
+    };
+    for (std::uint32_t i = 0; i < h->signatureCount; ++i)
+    {
+        const SignatureSlot& slot = signatureSlots()[i];
+        if (!inPool(slot.keyOffset, slot.keyLength) || !inPool(slot.valueOffset, slot.valueLength))
+        {
+            return false;
+        }
+    }
+    for (std::uint32_t i = 0; i < h->fileRecordCount; ++i)
+    {
+        const FileSlot& slot = fileSlots()[i];
+        if (!inPool(slot.pathOffset, slot.pathLength) || !inPool(slot.hashOffset, slot.hashLength)
+            || slot.algorithm > static_cast<std::uint32_t>(HashAlgorithm::BLAKE3))
+        {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < durationCount(); ++i)
+    {
+        const DurationSlot& slot = durationSlots()[i];
+        if (!inPool(slot.keyOffset, slot.keyLength))
+        {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < outputSignatureCount(); ++i)
+    {
+        const SignatureSlot& slot = outputSlots()[i];
+        if (!inPool(slot.keyOffset, slot.keyLength) || !inPool(slot.valueOffset, slot.valueLength))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::optional<std::string_view> CacheImage::findSignature(const std::string_view targetName) const noexcept
+{
+    if (!isOpen())
+    {
+        return std::nullopt;
+    }
+
+    const SignatureSlot* first = signatureSlots();
+    const SignatureSlot* last = first + header()->signatureCount;
+    const auto key = [this](const SignatureSlot& slot) { return poolString(slot.keyOffset, slot.keyLength); };
+    const SignatureSlot* it = lowerBound(first, last, targetName, key);
+    if (it == last || key(*it) != targetName)
+    {
+        return std::nullopt;
+    }
+    return poolString(it->valueOffset, it->valueLength);
+}
+
+std::optional<FileRecord> CacheImage::findFileRecord(const std::string_view path) const
+{
+    if (!isOpen())
+    {
+        return std::nullopt;
+    }
+
+    const FileSlot* first = fileSlots();
+    const FileSlot* last = first + header()->fileRecordCount;
+    const auto key = [this](const FileSlot& slot) { return poolString(slot.pathOffset, slot.pathLength); };
+    const FileSlot* it = lowerBound(first, last, path, key);
+    if (it == last || key(*it) != path)
+    {
+        return std::nullopt;
+    }
+    return fileRecordAt(static_cast<size_t>(it - first)).second;
+}
+
+std::optional<std::uint64_t> CacheImage::findDuration(const std::string_view targetName) const noexcept
+{
+    if (!isOpen())
+    {
+        return std::nullopt;
+    }
+
+    const DurationSlot* first = durationSlots();
+    const DurationSlot* last = first + durationCount();
+    const auto key = [this](const DurationSlot& slot) { return poolString(slot.keyOffset, slot.keyLength); };
+    const DurationSlot* it = lowerBound(first, last, targetName, key);
+    if (it == last || key(*it) != targetName)
+    {
+        return std::nullopt;
+    }
+    return it->durationUs;
+}
+
+std::optional<std::string_view> CacheImage::findOutputSignature(const std::string_view targetName) const noexcept
+{
+    if (!isOpen())
+    {
+        return std::nullopt;
+    }
+
+    const SignatureSlot* first = outputSlots();
+    const SignatureSlot* last = first + outputSignatureCount();
+    const auto key = [this](const SignatureSlot& slot) { return poolString(slot.keyOffset, slot.keyLength); };
+    const SignatureSlot* it = lowerBound(first, last, targetName, key);
+    if (it == last || key(*it) != targetName)
+    {
+        return std::nullopt;
+    }
+    return poolString(it->valueOffset, it->valueLength);
+}
+
+size_t CacheImage::signatureCount() const noexcept
+{
+    return isOpen() ? header()->signatureCount : 0;
+}
+
+size_t CacheImage::fileRecordCount() const noexcept
+{
+    return isOpen() ? header()->fileRecordCount : 0;
+}
+
+size_t CacheImage::durationCount() const noexcept
+{
+    return isOpen() && header()->version >= 2 ? header()->durationCount : 0;
+}
+
+size_t CacheImage::outputSignatureCount() const noexcept
+{
+    return isOpen() && header()->version >= 3 ? header()->outputCount : 0;
+}
+
+CacheImage::SignatureEntry CacheImage::signatureAt(const size_t index) const noexcept
+{
+    const SignatureSlot& slot = signatureSlots()[index];
+    return {poolString(slot.keyOffset, slot.keyLength), poolString(slot.valueOffset, slot.valueLength)};
+}
+
+std::pair<std::string_view, FileRecord> CacheImage::fileRecordAt(const size_t index) const
+{
+    const FileSlot& slot = fileSlots()[index];
+    FileRecord record;
+    record.stamp.size = slot.size;
+    record.stamp.mtimeNs = slot.mtimeNs;
+    record.stamp.inode = slot.inode;
+    record.hashedAtNs = slot.hashedAtNs;
+    record.algorithm = static_cast<HashAlgorithm>(slot.algorithm);
+    record.hash = std::string(poolString(slot.hashOffset, slot.hashLength));
+    return {poolString(slot.pathOffset, slot.pathLength), std::move(record)};
+}
+
+CacheImage::DurationEntry CacheImage::durationAt(const size_t index) const noexcept
+{
+    const DurationSlot& slot = durationSlots()[index];
+    return {poolString(slot.keyOffset, slot.keyLength), slot.durationUs};
+}
+
+CacheImage::SignatureEntry CacheImage::outputSignatureAt(const size_t index) const noexcept
+{
+    const SignatureSlot& slot = outputSlots()[index];
+    return {poolString(slot.keyOffset, slot.keyLength), poolString(slot.valueOffset, slot.valueLength)};
+}
+
+bool CacheImage::write(
+    const std::string& path,
+    std::vector<SignatureEntry> signatures,
+    std::vector<FileRecordEntry> records,
+    std::vector<DurationEntry> durations,
+    std::vector<SignatureEntry> outputs)
+{
+    std::sort(signatures.begin(), signatures.end(),
+        [](const SignatureEntry& a, const SignatureEntry& b) { return a.first < b.first; });
+    std::sort(records.begin(), records.end(),
+        [](const FileRecordEntry& a, const FileRecordEntry& b) { return a.first < b.first; });
+    std::sort(durations.begin(), durations.end(),
+        [](const DurationEntry& a, const DurationEntry& b) { return a.first < b.first; });
+    std::sort(outputs.begin(), outputs.end(),
+        [](const SignatureEntry& a, const SignatureEntry& b) { return a.first < b.first; });
+
+    PoolBuilder pool;
+    std::vector<SignatureSlot> signatureSlots;
+    signatureSlots.reserve(signatures.size());
+    for (const auto& [key, value] : signatures)
+    {
+        SignatureSlot slot{};
+        std::tie(slot.keyOffset, slot.keyLength) = pool.add(key);
+        std::tie(slot.valueOffset, slot.valueLength) = pool.add(value);
+        signatureSlots.push_back(slot);
+    }
+
+    std::vector<FileSlot> fileSlots;
+    fileSlots.reserve(records.size());
+    for (const auto& [filePath, record] : records)
+    {
+        FileSlot slot{};
+        std::tie(slot.pathOffset, slot.pathLength) = pool.add(filePath);
+        std::tie(slot.hashOffset, slot.hashLength) = pool.add(record->hash);
+        slot.size = record->stamp.size;
+        slot.mtimeNs = record->stamp.mtimeNs;
+        slot.inode = record->stamp.inode;
+        slot.hashedAtNs = record->hashedAtNs;
+        slot.algorithm = static_cast<std::uint32_t>(record->algorithm);
+        fileSlots.push_back(slot);
+    }
+
+    std::vector<DurationSlot> durationSlots;
+    durationSlots.reserve(durations.size());
+    for (const auto& [key, durationUs] : durations)
+    {
+        DurationSlot slot{};
+        std::tie(slot.keyOffset, slot.keyLength) = pool.add(key);
+        slot.durationUs = durationUs;
+        durationSlots.push_back(slot);
+    }
+
+    std::vector<SignatureSlot> outputSlots;
+    outputSlots.reserve(outputs.size());
+    for (const auto& [key, value] : outputs)
+    {
+        SignatureSlot slot{};
+        std::tie(slot.keyOffset, slot.keyLength) = pool.add(key);
+        std::tie(slot.valueOffset, slot.valueLength) = pool.add(value);
+        outputSlots.push_back(slot);
+    }
+
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.byteOrder = BYTE_ORDER_MARK;
+    header.signatureCount = static_cast<std::uint32_t>(signatureSlots.size());
+    header.fileRecordCount = static_cast<std::uint32_t>(fileSlots.size());
+    header.durationCount = static_cast<std::uint32_t>(durationSlots.size());
+    header.outputCount = static_cast<std::uint32_t>(outputSlots.size());
+    header.poolOffset = sizeof(Header)
+        + signatureSlots.size() * sizeof(SignatureSlot)
+        + fileSlots.size() * sizeof(FileSlot)
+        + durationSlots.size() * sizeof(DurationSlot)
+        + outputSlots.size() * sizeof(SignatureSlot);
+    header.poolSize = pool.bytes().size();
+
+    // Readers (and a still-mapped previous image) never see a half-written
+    // file, and the journal is only dropped once this one is on disk
+    const auto bytes = [](const auto& slots)
+    {
+        return std::string_view(reinterpret_cast<const char*>(slots.data()), slots.size() * sizeof(slots[0]));
+    };
+    return replaceFileDurably(path, {
+        std::string_view(reinterpret_cast<const char*>(&header), sizeof(header)),
+        bytes(signatureSlots),
+        bytes(fileSlots),
+        bytes(durationSlots),
+        bytes(outputSlots),
+        std::string_view(pool.bytes().data(), pool.bytes().size())});
+}
+
+bool mimir::replaceFileDurably(const std::string& path, const std::vector<std::string_view>& parts)
+{
+    const std::string tmpPath = path + ".tmp";
+#ifdef _WIN32
+    {
+        std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+        for (const auto part : parts)
+        {
+            file.write(part.data(), static_cast<std::streamsize>(part.size()));
+        }
+        file.close();
+        if (file.fail())
+        {
+            std::remove(tmpPath.c_str());
+            return false;
+        }
+    }
+    std::remove(path.c_str());
+    return std::rename(tmpPath.c_str(), path.c_str()) == 0;
+#else
+    const int fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        return false;
+    }
+    bool ok = true;
+    for (const auto part : parts)
+    {
+        const char* data = part.data();
+        size_t left = part.size();
+        while (ok && left > 0)
+        {
+            const ssize_t written = ::write(fd, data, left);
+            if (written < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            ok = written > 0;
+            data += ok ? written : 0;
+            left -= ok ? static_cast<size_t>(written) : 0;
+        }
+    }
+    // Delayed allocation can report ENOSPC as late as fsync or close
+    ok = ok && ::fsync(fd) == 0;
+    ok = ::close(fd) == 0 && ok;
+    if (!ok || std::rename(tmpPath.c_str(), path.c_str()) != 0)
+    {
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+
+    // The rename itself is only durable once the directory entry is
+    const size_t slash = path.find_last_of('/');
+    const std::string directory = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+    const int dirFd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirFd < 0)
+    {
+        return false;
+    }
+    const bool synced = ::fsync(dirFd) == 0;
+    ::close(dirFd);
+    return synced;
+#endif
+}
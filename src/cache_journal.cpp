@@ -0,0 +1,439 @@
+#include "mimir/cache_journal.h"
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace mimir;
+
+namespace
+{
+    constexpr char JOURNAL_MAGIC[8] = {'M', 'I', 'M', 'I', 'R', 'J', '1', '\n'};
+    constexpr size_t FRAME_HEADER = 8;                      ///< length + crc
+    constexpr std::uint32_t MAX_RECORD = 64 * 1024 * 1024;  ///< Larger lengths mean corruption
+
+    std::uint32_t crc32(const char* data, size_t len) noexcept
+    {
+        static const auto table = []()
+        {
+            std::array<std::uint32_t, 256> entries{};
+            for (std::uint32_t i = 0; i < 256; ++i)
+            {
+                std::uint32_t c = i;
+                for (int k = 0; k < 8; ++k)
+                {
+                    c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+                }
+                entries[i] = c;
+            }
+            return entries;
+        }();
+
+        std::uint32_t crc = 0xFFFFFFFFu;
+        for (size_t i = 0; i < len; ++i)
+        {
+            crc = table[(crc ^ static_cast<std::uint8_t>(data[i])) & 0xFF] ^ (crc >> 8);
+        }
+        return crc ^ 0xFFFFFFFFu;
+    }
+
+    template <typename T>
+    void putInt(std::string& out, T value)
+    {
+        char bytes[sizeof(T)];
+        std::memcpy(bytes, &value, sizeof(T));
+        out.append(bytes, sizeof(T));
+    }
+
+    void putString(std::string& out, const std::string& value)
+    {
+        putInt(out, static_cast<std::uint32_t>(value.size()));
+        out.append(value);
+    }
+
+    /// @brief Bounds-checked reader over one record payload
+    class PayloadReader
+    {
+    public:
+        PayloadReader(const char* data, size_t len)
+            : data_(data)
+            , len_(len)
+        {
+        }
+
+        template <typename T>
+        bool getInt(T& value)
+        {
+            if (len_ - pos_ < sizeof(T))
+            {
+                return false;
+            }
+            std::memcpy(&value, data_ + pos_, sizeof(T));
+            pos_ += sizeof(T);
+            return true;
+        }
+
+        bool getString(std::string& value)
+        {
+            std::uint32_t size = 0;
+            if (!getInt(size) || len_ - pos_ < size)
+            {
+                return false;
+            }
+            value.assign(data_ + pos_, size);
+            pos_ += size;
+            return true;
+        }
+
+        bool atEnd() const noexcept
+        {
+            return pos_ == len_;
+        }
+
+    private:
+        const char* data_;
+        size_t len_;
+        size_t pos_ = 0;
+    };
+
+    bool decode(const char* data, size_t len, JournalEntry& entry)
+    {
+        PayloadReader reader(data, len);
+        std::uint8_t type = 0;
+        if (!reader.getInt(type))
+        {
+            return false;
+        }
+        entry = JournalEntry{};
+        entry.type = static_cast<JournalRecordType>(type);
+
+        bool ok = false;
+        switch (entry.type)
+        {
+            case JournalRecordType::SetSignature:
+            case JournalRecordType::SetOutputSignature:
+                ok = reader.getString(entry.key) && reader.getString(entry.value);
+                break;
+            case JournalRecordType::RemoveSignature:
+            case JournalRecordType::RemoveFileRecord:
+                ok = reader.getString(entry.key);
+                break;
+            case JournalRecordType::SetFileRecord:
+            {
+                std::uint8_t algorithm = 0;
+                ok = reader.getString(entry.key)
+                    && reader.getInt(entry.record.stamp.size)
+                    && reader.getInt(entry.record.stamp.mtimeNs)
+                    && reader.getInt(entry.record.stamp.inode)
+                    && reader.getInt(entry.record.hashedAtNs)
+                    && reader.getInt(algorithm)
+                    && reader.getString(entry.record.hash)
+                    && algorithm <= static_cast<std::uint8_t>(HashAlgorithm::BLAKE3);
+                entry.record.algorithm = static_cast<HashAlgorithm>(algorithm);
+                break;
+            }
+            case JournalRecordType::Clear:
+                ok = true;
+                break;
+            case JournalRecordType::SetDuration:
+                ok = reader.getString(entry.key) && reader.getInt(entry.durationUs);
+                break;
+        }
+        return ok && reader.atEnd();
+    }
+
+    bool writeAll(int fd, const char* data, size_t len)
+    {
+        while (len > 0)
+        {
+            const ssize_t written = ::write(fd, data, len);
+            if (written < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                return false;
+            }
+            data += written;
+            len -= static_cast<size_t>(written);
+        }
+        return true;
+    }
+
+    int syncData(int fd)
+    {
+#if defined(__linux__)
+        return ::fdatasync(fd);
+#else
+        return ::fsync(fd);
+#endif
+    }
+}
+
+CacheJournal::CacheJournal(std::string path)
+    : path_(std::move(path))
+{
+}
+
+CacheJournal::~CacheJournal()
+{
+    if (writer_.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        pendingCv_.notify_all();
+        writer_.join();
+    }
+    if (fd_ >= 0)
+    {
+        ::close(fd_);
+    }
+}
+
+bool CacheJournal::open()
+{
+    if (fd_ >= 0)
+    {
+        return good();
+    }
+
+    const JournalReplayResult scan = replay(path_, [](const JournalEntry&) {});
+
+    fd_ = ::open(path_.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd_ < 0)
+    {
+        return false;
+    }
+
+    // Cut a torn tail (or a foreign file) back to the last intact record
+    if (::ftruncate(fd_, static_cast<off_t>(scan.validBytes)) != 0)
+    {
+        ::close(fd_);
+        fd_ = -1;
+        return false;
+    }
+    sizeBytes_ = scan.validBytes;
+    if (scan.validBytes == 0)
+    {
+        if (!writeAll(fd_, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) || syncData(fd_) != 0)
+        {
+            ::close(fd_);
+            fd_ = -1;
+            return false;
+        }
+        sizeBytes_ = sizeof(JOURNAL_MAGIC);
+    }
+
+    writer_ = std::thread(&CacheJournal::writerLoop, this);
+    return true;
+}
+
+bool CacheJournal::good() const noexcept
+{
+    return fd_ >= 0 && !failed_.load();
+}
+
+void CacheJournal::enqueue(const std::string& payload)
+{
+    // Frame the record before locking so workers only contend on the append
+    std::string header;
+    putInt(header, static_cast<std::uint32_t>(payload.size()));
+    putInt(header, crc32(payload.data(), payload.size()));
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_.append(header);
+        pending_.append(payload);
+        ++enqueuedSeq_;
+    }
+    pendingCv_.notify_one();
+}
+
+void CacheJournal::appendSetSignature(const std::string& targetName, const std::string& signature)
+{
+    std::string payload;
+    putInt(payload, static_cast<std::uint8_t>(JournalRecordType::SetSignature));
+    putString(payload, targetName);
+    putString(payload, signature);
+    enqueue(payload);
+}
+
+void CacheJournal::appendRemoveSignature(const std::string& targetName)
+{
+    std::string payload;
+    putInt(payload, static_cast<std::uint8_t>(JournalRecordType::RemoveSignature));
+    putString(payload, targetName);
+    enqueue(payload);
+}
+
+void CacheJournal::appendFileRecord(const std::string& path, const FileRecord& record)
+{
+    std::string payload;
+    putInt(payload, static_cast<std::uint8_t>(JournalRecordType::SetFileRecord));
+    putString(payload, path);
+    putInt(payload, record.stamp.size);
+    putInt(payload, record.stamp.mtimeNs);
+    putInt(payload, record.stamp.inode);
+    putInt(payload, record.hashedAtNs);
+    putInt(payload, static_cast<std::uint8_t>(record.algorithm));
+    putString(payload, record.hash);
+    enqueue(payload);
+}
+
+void CacheJournal::appendRemoveFileRecord(const std::string& path)
+{
+    std::string payload;
+    putInt(payload, static_cast<std::uint8_t>(JournalRecordType::RemoveFileRecord));
+    putString(payload, path);
+    enqueue(payload);
+}
+
+void CacheJournal::appendDuration(const std::string& targetName, const std::uint64_t durationUs)
+{
+    std::string payload;
+    putInt(payload, static_cast<std::uint8_t>(JournalRecordType::SetDuration));
+    putString(payload, targetName);
+    putInt(payload, durationUs);
+    enqueue(payload);
+}
+
+void CacheJournal::appendOutputSignature(const std::string& targetName, const std::string& signature)
+{
+    std::string payload;
+    putInt(payload, static_cast<std::uint8_t>(JournalRecordType::SetOutputSignature));
+    putString(payload, targetName);
+    putString(payload, signature);
+    enqueue(payload);
+}
+
+void CacheJournal::appendClear()
+{
+    std::string payload;
+    putInt(payload, static_cast<std::uint8_t>(JournalRecordType::Clear));
+    enqueue(payload);
+}
+
+void CacheJournal::writerLoop()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true)
+    {
+        pendingCv_.wait(lock, [this]() { return stopping_ || !pending_.empty(); });
+        if (pending_.empty())
+        {
+            return;
+        }
+
+        // Everything queued while the previous sync ran goes out in one batch
+        std::string batch;
+        batch.swap(pending_);
+        const std::uint64_t batchSeq = enqueuedSeq_;
+        lock.unlock();
+
+        const bool ok = writeAll(fd_, batch.data(), batch.size()) && syncData(fd_) == 0;
+        if (!ok)
+        {
+            failed_ = true;
+        }
+        sizeBytes_ += batch.size();
+
+        lock.lock();
+        syncedSeq_ = batchSeq;
+        syncedCv_.notify_all();
+    }
+}
+
+void CacheJournal::flush()
+{
+    if (!writer_.joinable())
+    {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    const std::uint64_t target = enqueuedSeq_;
+    syncedCv_.wait(lock, [this, target]() { return syncedSeq_ >= target; });
+}
+
+void CacheJournal::truncate()
+{
+    if (fd_ < 0)
+    {
+        return;
+    }
+    flush();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (::ftruncate(fd_, sizeof(JOURNAL_MAGIC)) != 0 || syncData(fd_) != 0)
+    {
+        failed_ = true;
+        return;
+    }
+    sizeBytes_ = sizeof(JOURNAL_MAGIC);
+}
+
+std::uint64_t CacheJournal::sizeBytes() const noexcept
+{
+    return sizeBytes_.load();
+}
+
+const std::string& CacheJournal::getPath() const noexcept
+{
+    return path_;
+}
+
+JournalReplayResult CacheJournal::replay(
+    const std::string& path,
+    const std::function<void(const JournalEntry&)>& apply)
+{
+    JournalReplayResult result;
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+    {
+        return result;
+    }
+    const std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (data.size() < sizeof(JOURNAL_MAGIC) || std::memcmp(data.data(), JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) != 0)
+    {
+        result.truncatedTail = !data.empty();
+        return result;
+    }
+
+    size_t pos = sizeof(JOURNAL_MAGIC);
+    result.validBytes = pos;
+    JournalEntry entry;
+    while (pos < data.size())
+    {
+        std::uint32_t length = 0;
+        std::uint32_t checksum = 0;
+        if (data.size() - pos < FRAME_HEADER)
+        {
+            break;
+        }
+        std::memcpy(&length, data.data() + pos, sizeof(length));
+        std::memcpy(&checksum, data.data() + pos + sizeof(length), sizeof(checksum));
+        if (length > MAX_RECORD || data.size() - pos - FRAME_HEADER < length)
+        {
+            break;
+        }
+
+        const char* payload = data.data() + pos + FRAME_HEADER;
+        if (crc32(payload, length) != checksum || !decode(payload, length, entry))
+        {
+            break;
+        }
+
+        apply(entry);
+        ++result.records;
+        pos += FRAME_HEADER + length;
+        result.validBytes = pos;
+    }
+    result.truncatedTail = result.validBytes < data.size();
+    return result;
+}
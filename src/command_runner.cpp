@@ -1,13 +1,183 @@
 #include "../include/mimir/command_runner.h"
+#include "../include/mimir/process_supervisor.h"
 #include <cstdlib>
+#include <cerrno>
+#include <cstring>
 #include <array>
+#include <chrono>
 #include <sstream>
 #include <fstream>
 #include <filesystem>
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+#endif
+
 namespace fs = std::filesystem;
 using namespace mimir;
 
+namespace
+{
+    bool isPlainChar(const char c)
+    {
+        if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9'))
+        {
+            return true;
+        }
+        return c != '\0' && std::strchr("_-./+,:@%=^", c) != nullptr;
+    }
+
+    bool isShellBuiltin(const std::string& word)
+    {
+        static const char* const builtins[] = {
+            ".", ":", "alias", "break", "cd", "command", "continue", "eval", "exec", "exit",
+            "export", "getopts", "hash", "read", "readonly", "return", "set", "shift",
+            "source", "times", "trap", "type", "ulimit", "umask", "unalias", "unset", "wait",
+        };
+        for (const char* builtin : builtins)
+        {
+            if (word == builtin)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+#ifndef _WIN32
+    std::string shellQuote(const std::string& word)
+    {
+        std::string quoted = "'";
+        for (const char c : word)
+        {
+            if (c == '\'')
+            {
+                quoted += "'\\''";
+            }
+            else
+            {
+                quoted += c;
+            }
+        }
+        quoted += "'";
+        return quoted;
+    }
+
+    bool makePipe(int fds[2])
+    {
+#ifdef __linux__
+        return ::pipe2(fds, O_CLOEXEC) == 0;
+#else
+        if (::pipe(fds) != 0)
+        {
+            return false;
+        }
+        ::fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+        ::fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+        return true;
+#endif
+    }
+
+    /// @brief Read both capture pipes into ring buffers until the child closes them
+    void drainPipes(int outFd, int errFd, OutputBuffer& out, OutputBuffer& err)
+    {
+        std::array<char, 16384> buffer;
+        pollfd fds[2] = {{outFd, POLLIN, 0}, {errFd, POLLIN, 0}};
+        OutputBuffer* sinks[2] = {&out, &err};
+        int open = 2;
+        while (open > 0)
+        {
+            if (::poll(fds, 2, -1) < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                break;
+            }
+            for (int i = 0; i < 2; ++i)
+            {
+                if (fds[i].fd < 0 || fds[i].revents == 0)
+                {
+                    continue;
+                }
+                const ssize_t n = ::read(fds[i].fd, buffer.data(), buffer.size());
+                if (n > 0)
+                {
+                    sinks[i]->append(buffer.data(), static_cast<size_t>(n));
+                }
+                else if (n == 0 || errno != EINTR)
+                {
+                    ::close(fds[i].fd);
+                    fds[i].fd = -1;
+                    --open;
+                }
+            }
+        }
+    }
+
+    /// @brief Render a capture buffer, noting how much was cut from the front
+    std::string captured(const OutputBuffer& buffer)
+    {
+        if (buffer.droppedBytes() == 0)
+        {
+            return buffer.str();
+        }
+        return "[mimir: " + std::to_string(buffer.droppedBytes()) + " earlier bytes discarded]\n" + buffer.str();
+    }
+
+    double toSeconds(const timeval& tv)
+    {
+        return static_cast<double>(tv.tv_sec) + static_cast<double>(tv.tv_usec) / 1e6;
+    }
+#endif
+}
+
+std::optional<std::vector<std::string>> SystemCommandRunner::directArguments(const std::string& command)
+{
+    std::vector<std::string> args;
+    std::string current;
+    for (const char c : command)
+    {
+        if (c == ' ' || c == '\t')
+        {
+            if (!current.empty())
+            {
+                args.push_back(std::move(current));
+                current.clear();
+            }
+        }
+        else if (isPlainChar(c))
+        {
+            current += c;
+        }
+        else
+        {
+            return std::nullopt;
+        }
+    }
+    if (!current.empty())
+    {
+        args.push_back(std::move(current));
+    }
+
+    // "VAR=value cmd" is an assignment, and builtins only exist inside the shell
+    if (args.empty() || args[0].find('=') != std::string::npos || isShellBuiltin(args[0]))
+    {
+        return std::nullopt;
+    }
+    return args;
+}
+
+#ifdef _WIN32
 CommandResult SystemCommandRunner::run(
     const std::string& command,
     const CommandOptions& options)
@@ -30,14 +200,12 @@ CommandResult SystemCommandRunner::run(
         
         result.exitCode = std::system(fullCommand.c_str());
 
-        // Read captured output
         std::ifstream outFile(tmpOut);
         if (outFile.is_open())
         {
             std::ostringstream oss;
             oss << outFile.rdbuf();
             result.stdOut = oss.str();
-            outFile.close();
         }
 
         std::ifstream errFile(tmpErr);
@@ -46,10 +214,8 @@ CommandResult SystemCommandRunner::run(
             std::ostringstream oss;
             oss << errFile.rdbuf();
             result.stdErr = oss.str();
-            errFile.close();
         }
 
-        // Cleanup
         std::error_code ec;
         fs::remove(tmpOut, ec);
         fs::remove(tmpErr, ec);
@@ -59,24 +225,239 @@ CommandResult SystemCommandRunner::run(
         result.exitCode = std::system(fullCommand.c_str());
     }
 
-    //normalize exit code (system())
-#ifdef _WIN32
-    // Windows returns the exit code directly
+    return result;
+}
+#else
+CommandResult SystemCommandRunner::run(
+    const std::string& command,
+    const CommandOptions& options)
+{
+    CommandResult result{0, "", "", false};
+    const auto runStart = std::chrono::steady_clock::now();
+
+    // Exec'ing directly saves a /bin/sh per target; chdir needs glibc 2.29's addchdir_np
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 29)
+    constexpr bool canChdir = true;
 #else
-    // Unix: WEXITSTATUS macro extracts the exit code
-    if (WIFEXITED(result.exitCode))
+    constexpr bool canChdir = false;
+#endif
+    std::optional<std::vector<std::string>> args;
+    if (canChdir || options.workingDir.empty())
+    {
+        args = directArguments(command);
+    }
+    if (!args)
+    {
+        std::string script = command;
+        if (!canChdir && !options.workingDir.empty())
+        {
+            script = "cd " + shellQuote(options.workingDir) + " && " + command;
+        }
+        args = std::vector<std::string>{"/bin/sh", "-c", std::move(script)};
+    }
+
+    std::vector<char*> argv;
+    argv.reserve(args->size() + 1);
+    for (auto& arg : *args)
     {
-        result.exitCode = WEXITSTATUS(result.exitCode);
+        argv.push_back(arg.data());
+    }
+    argv.push_back(nullptr);
+
+    char* emptyEnvironment[] = {nullptr};
+    char** envp = options.inheritEnvironment ? environ : emptyEnvironment;
+
+    // Overrides replace inherited variables of the same name
+    std::vector<std::string> envStrings;
+    std::vector<char*> envList;
+    if (!options.environment.empty())
+    {
+        for (char** entry = envp; *entry != nullptr; ++entry)
+        {
+            const char* equals = std::strchr(*entry, '=');
+            const size_t nameLength = equals != nullptr ? static_cast<size_t>(equals - *entry) : std::strlen(*entry);
+            bool overridden = false;
+            for (const auto& [name, value] : options.environment)
+            {
+                overridden = overridden || (name.size() == nameLength && name.compare(0, nameLength, *entry, nameLength) == 0);
+            }
+            if (!overridden)
+            {
+                envList.push_back(*entry);
+            }
+        }
+        envStrings.reserve(options.environment.size());
+        for (const auto& [name, value] : options.environment)
+        {
+            envStrings.push_back(name + "=" + value);
+        }
+        for (auto& entry : envStrings)
+        {
+            envList.push_back(entry.data());
+        }
+        envList.push_back(nullptr);
+        envp = envList.data();
+    }
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+
+    // The child starts with default signal handling and an empty mask regardless of ours
+    sigset_t mask;
+    sigemptyset(&mask);
+    posix_spawnattr_setsigmask(&attr, &mask);
+    sigset_t defaults;
+    sigemptyset(&defaults);
+    sigaddset(&defaults, SIGPIPE);
+    sigaddset(&defaults, SIGINT);
+    sigaddset(&defaults, SIGTERM);
+    posix_spawnattr_setsigdefault(&attr, &defaults);
+    short flags = POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF;
+
+    // A timed command leads its own process group so expiry can kill everything it started.
+    // Untimed commands stay in ours and keep receiving the terminal's Ctrl-C.
+    const bool timed = options.timeoutSeconds.has_value() && *options.timeoutSeconds > 0;
+    if (timed)
+    {
+        flags |= POSIX_SPAWN_SETPGROUP;
+        posix_spawnattr_setpgroup(&attr, 0);
+    }
+    posix_spawnattr_setflags(&attr, flags);
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 29)
+    if (!options.workingDir.empty())
+    {
+        posix_spawn_file_actions_addchdir_np(&actions, options.workingDir.c_str());
     }
 #endif
 
+    int outPipe[2] = {-1, -1};
+    int errPipe[2] = {-1, -1};
+    if (options.captureOutput)
+    {
+        if (!makePipe(outPipe) || !makePipe(errPipe))
+        {
+            for (const int fd : {outPipe[0], outPipe[1], errPipe[0], errPipe[1]})
+            {
+                if (fd >= 0)
+                {
+                    ::close(fd);
+                }
+            }
+            posix_spawn_file_actions_destroy(&actions);
+            posix_spawnattr_destroy(&attr);
+            result.exitCode = 127;
+            result.stdErr = std::string("mimir: pipe: ") + std::strerror(errno);
+            return result;
+        }
+        // dup2 clears FD_CLOEXEC on the copies, so only fds 1 and 2 survive the exec
+        posix_spawn_file_actions_adddup2(&actions, outPipe[1], STDOUT_FILENO);
+        posix_spawn_file_actions_adddup2(&actions, errPipe[1], STDERR_FILENO);
+    }
+
+    pid_t pid = -1;
+    int spawnError = argv[0][0] == '/'
+        ? posix_spawn(&pid, argv[0], &actions, &attr, argv.data(), envp)
+        : posix_spawnp(&pid, argv[0], &actions, &attr, argv.data(), envp);
+
+    if (spawnError == ENOENT && argv[0][0] != '/')
+    {
+        // Let the shell report "command not found" (exit 127) exactly as before
+        const std::vector<std::string> shellArgs = {"/bin/sh", "-c", command};
+        std::vector<char*> shellArgv;
+        for (const auto& arg : shellArgs)
+        {
+            shellArgv.push_back(const_cast<char*>(arg.c_str()));
+        }
+        shellArgv.push_back(nullptr);
+        spawnError = posix_spawn(&pid, shellArgv[0], &actions, &attr, shellArgv.data(), envp);
+    }
+
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attr);
+    result.spawnSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - runStart).count();
+
+    const bool supervised = timed && spawnError == 0;
+    ProcessSupervisor::Token watch = 0;
+    if (supervised)
+    {
+        watch = ProcessSupervisor::instance().watch(
+            pid, ProcessSupervisor::Clock::now() + std::chrono::seconds(*options.timeoutSeconds));
+    }
+
+    if (options.captureOutput)
+    {
+        ::close(outPipe[1]);
+        ::close(errPipe[1]);
+        if (spawnError == 0)
+        {
+            OutputBuffer out(options.maxCaptureBytes);
+            OutputBuffer err(options.maxCaptureBytes);
+            drainPipes(outPipe[0], errPipe[0], out, err);
+            result.stdOut = captured(out);
+            result.stdErr = captured(err);
+            result.droppedBytes = out.droppedBytes() + err.droppedBytes();
+        }
+        else
+        {
+            ::close(outPipe[0]);
+            ::close(errPipe[0]);
+        }
+    }
+
+    if (spawnError != 0)
+    {
+        result.exitCode = 127;
+        result.stdErr += std::string("mimir: cannot run ") + argv[0] + ": " + std::strerror(spawnError);
+        return result;
+    }
+
+    if (supervised)
+    {
+        // Wait without reaping, so the group id cannot be recycled while still watched
+        siginfo_t info{};
+        while (::waitid(P_PID, static_cast<id_t>(pid), &info, WEXITED | WNOWAIT) < 0 && errno == EINTR)
+        {
+        }
+        result.timedOut = ProcessSupervisor::instance().release(watch);
+    }
+
+    int status = 0;
+    rusage usage{};
+    while (::wait4(pid, &status, 0, &usage) < 0)
+    {
+        if (errno != EINTR)
+        {
+            result.exitCode = 127;
+            return result;
+        }
+    }
+
+    if (WIFEXITED(status))
+    {
+        result.exitCode = WEXITSTATUS(status);
+    }
+    else if (WIFSIGNALED(status))
+    {
+        result.exitCode = 128 + WTERMSIG(status);
+    }
+
+    result.usage.userSeconds = toSeconds(usage.ru_utime);
+    result.usage.systemSeconds = toSeconds(usage.ru_stime);
+#ifdef __APPLE__
+    result.usage.maxRssKb = usage.ru_maxrss / 1024;
+#else
+    result.usage.maxRssKb = usage.ru_maxrss;
+#endif
     return result;
 }
+#endif
 
 bool SystemCommandRunner::runSimple(const std::string& command)
 {
-    int result = std::system(command.c_str());
-    return result == 0;
+    return run(command).success();
 }
 
 MockCommandRunner::MockCommandRunner()
@@ -91,21 +472,25 @@ CommandResult MockCommandRunner::run(
 {
     (void)options;
     
-    lastCommand_ = command;
-    ++commandCount_;
-
-    if (handler_)
+    CommandHandler handler;
     {
-        return handler_(command, options);
-    }
+        std::lock_guard<std::mutex> lock(mutex_);
+        lastCommand_ = command;
+        ++commandCount_;
 
-    auto it = commandResults_.find(command);
-    if (it != commandResults_.end())
-    {
-        return it->second;
+        if (!handler_)
+        {
+            auto it = commandResults_.find(command);
+            if (it != commandResults_.end())
+            {
+                return it->second;
+            }
+            return defaultResult_;
+        }
+        handler = handler_;
     }
 
-    return defaultResult_;
+    return handler(command, options);
 }
 
 bool MockCommandRunner::runSimple(const std::string& command)
@@ -115,31 +500,37 @@ bool MockCommandRunner::runSimple(const std::string& command)
 
 void MockCommandRunner::setDefaultResult(const CommandResult& result)
 {
+    std::lock_guard<std::mutex> lock(mutex_);
     defaultResult_ = result;
 }
 
 void MockCommandRunner::setResultFor(const std::string& command, const CommandResult& result)
 {
+    std::lock_guard<std::mutex> lock(mutex_);
     commandResults_[command] = result;
 }
 
 void MockCommandRunner::setHandler(CommandHandler handler)
 {
+    std::lock_guard<std::mutex> lock(mutex_);
     handler_ = std::move(handler);
 }
 
 const std::string& MockCommandRunner::getLastCommand() const
 {
+    std::lock_guard<std::mutex> lock(mutex_);
     return lastCommand_;
 }
 
 size_t MockCommandRunner::getCommandCount() const
 {
+    std::lock_guard<std::mutex> lock(mutex_);
     return commandCount_;
 }
 
 void MockCommandRunner::reset()
 {
+    std::lock_guard<std::mutex> lock(mutex_);
     lastCommand_.clear();
     commandCount_ = 0;
     commandResults_.clear();
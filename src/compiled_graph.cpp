@@ -0,0 +1,284 @@
+#include "mimir/compiled_graph.h"
+#include <algorithm>
+
+using namespace mimir;
+
+CompiledGraph::CompiledGraph(const DAG& dag)
+{
+    targets_ = dag.getAllTargets();
+    const size_t count = targets_.size();
+
+    nodeIds_.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        nodeIds_.emplace(targets_[i]->getName(), static_cast<NodeId>(i));
+    }
+
+    unresolved_.assign(count, 0);
+    depOffsets_.reserve(count + 1);
+    depOffsets_.push_back(0);
+
+    std::vector<std::uint32_t> dependentCounts(count, 0);
+    for (size_t i = 0; i < count; ++i)
+    {
+        const Target& t = *targets_[i];
+
+        const size_t rowStart = deps_.size();
+        for (const auto& dep : t.getDependencies())
+        {
+            auto it = nodeIds_.find(dep);
+            if (it == nodeIds_.end())
+            {
+                ++unresolved_[i];
+                continue;
+            }
+            deps_.push_back(it->second);
+        }
+
+        // Repeated dependency names collapse to a single edge
+        std::sort(deps_.begin() + rowStart, deps_.end());
+        deps_.erase(std::unique(deps_.begin() + rowStart, deps_.end()), deps_.end());
+        for (size_t e = rowStart; e < deps_.size(); ++e)
+        {
+            ++dependentCounts[deps_[e]];
+        }
+        depOffsets_.push_back(static_cast<std::uint32_t>(deps_.size()));
+    }
+
+    // Transpose the dependency rows into dependent rows
+    dependentOffsets_.assign(count + 1, 0);
+    for (size_t i = 0; i < count; ++i)
+    {
+        dependentOffsets_[i + 1] = dependentOffsets_[i] + dependentCounts[i];
+    }
+    dependents_.resize(deps_.size());
+    std::vector<std::uint32_t> cursor(dependentOffsets_.begin(), dependentOffsets_.end() - 1);
+    for (size_t i = 0; i < count; ++i)
+    {
+        for (std::uint32_t e = depOffsets_[i]; e < depOffsets_[i + 1]; ++e)
+        {
+            dependents_[cursor[deps_[e]]++] = static_cast<std::uint32_t>(i);
+        }
+    }
+}
+
+size_t CompiledGraph::nodeCount() const noexcept
+{
+    return targets_.size();
+}
+
+size_t CompiledGraph::edgeCount() const noexcept
+{
+    return deps_.size();
+}
+
+NodeId CompiledGraph::findNode(std::string_view name) const
+{
+    auto it = nodeIds_.find(name);
+    return it != nodeIds_.end() ? it->second : INVALID_NODE;
+}
+
+std::string_view CompiledGraph::nodeName(NodeId node) const noexcept
+{
+    return targets_[node]->getName();
+}
+
+const Target& CompiledGraph::target(NodeId node) const noexcept
+{
+    return *targets_[node];
+}
+
+IdRange CompiledGraph::row(
+    const std::vector<std::uint32_t>& offsets,
+    const std::vector<std::uint32_t>& indices,
+    NodeId node) noexcept
+{
+    const std::uint32_t* base = indices.data();
+    return IdRange{base + offsets[node], base + offsets[node + 1]};
+}
+
+IdRange CompiledGraph::dependencies(NodeId node) const noexcept
+{
+    return row(depOffsets_, deps_, node);
+}
+
+IdRange CompiledGraph::dependents(NodeId node) const noexcept
+{
+    return row(dependentOffsets_, dependents_, node);
+}
+
+std::uint32_t CompiledGraph::unresolvedDependencies(NodeId node) const noexcept
+{
+    return unresolved_[node];
+}
+
+std::uint32_t CompiledGraph::inDegree(NodeId node) const noexcept
+{
+    return (depOffsets_[node + 1] - depOffsets_[node]) + unresolved_[node];
+}
+
+std::vector<NodeId> CompiledGraph::topologicalOrder() const
+{
+    const size_t count = targets_.size();
+    std::vector<std::uint32_t> remaining(count);
+    std::vector<NodeId> order;
+    order.reserve(count);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        remaining[i] = inDegree(static_cast<NodeId>(i));
+        if (remaining[i] == 0)
+        {
+            order.push_back(static_cast<NodeId>(i));
+        }
+    }
+
+    for (size_t idx = 0; idx < order.size(); ++idx)
+    {
+        for (const NodeId dependent : dependents(order[idx]))
+        {
+            if (--remaining[dependent] == 0)
+            {
+                order.push_back(dependent);
+            }
+        }
+    }
+    return order;
+}
+
+std::vector<std::uint64_t> CompiledGraph::criticalPaths(const std::vector<std::uint64_t>& weights) const
+{
+    std::vector<std::uint64_t> lengths(targets_.size(), 0);
+    const std::vector<NodeId> order = topologicalOrder();
+
+    // Dependents come later in the order, so a reverse sweep sees them first
+    for (auto it = order.rbegin(); it != order.rend(); ++it)
+    {
+        std::uint64_t longest = 0;
+        for (const NodeId dependent : dependents(*it))
+        {
+            longest = std::max(longest, lengths[dependent]);
+        }
+        lengths[*it] = weights[*it] + longest;
+    }
+    return lengths;
+}
+
+std::vector<std::vector<NodeId>> CompiledGraph::cyclicComponents() const
+{
+    constexpr std::uint32_t UNVISITED = std::numeric_limits<std::uint32_t>::max();
+    const size_t count = targets_.size();
+
+    std::vector<std::uint32_t> index(count, UNVISITED);
+    std::vector<std::uint32_t> low(count, 0);
+    std::vector<char> onStack(count, 0);
+    std::vector<NodeId> sccStack;
+
+    // Explicit DFS frames: the node and how many of its edges have been explored
+    std::vector<std::pair<NodeId, std::uint32_t>> frames;
+    std::vector<std::vector<NodeId>> components;
+    std::uint32_t counter = 0;
+
+    for (NodeId root = 0; root < count; ++root)
+    {
+        if (index[root] != UNVISITED)
+        {
+            continue;
+        }
+
+        index[root] = low[root] = counter++;
+        sccStack.push_back(root);
+        onStack[root] = 1;
+        frames.emplace_back(root, 0);
+
+        while (!frames.empty())
+        {
+            const NodeId v = frames.back().first;
+            const IdRange edges = dependencies(v);
+
+            if (frames.back().second < edges.size())
+            {
+                const NodeId w = edges[frames.back().second++];
+                if (index[w] == UNVISITED)
+                {
+                    index[w] = low[w] = counter++;
+                    sccStack.push_back(w);
+                    onStack[w] = 1;
+                    frames.emplace_back(w, 0);
+                }
+                else if (onStack[w])
+                {
+                    low[v] = std::min(low[v], index[w]);
+                }
+                continue;
+            }
+
+            frames.pop_back();
+            if (!frames.empty())
+            {
+                const NodeId parent = frames.back().first;
+                low[parent] = std::min(low[parent], low[v]);
+            }
+            if (low[v] != index[v])
+            {
+                continue;
+            }
+
+            // v is the root of a component: everything above it on the stack belongs to it
+            auto first = std::find(sccStack.rbegin(), sccStack.rend(), v).base() - 1;
+            const bool cyclic = (sccStack.end() - first) > 1
+                || std::find(edges.begin(), edges.end(), v) != edges.end();
+            if (cyclic)
+            {
+                components.emplace_back(first, sccStack.end());
+            }
+            for (auto it = first; it != sccStack.end(); ++it)
+            {
+                onStack[*it] = 0;
+            }
+            sccStack.erase(first, sccStack.end());
+        }
+    }
+    return components;
+}
+
+std::vector<NodeId> CompiledGraph::cycleIn(const std::vector<NodeId>& component) const
+{
+    if (component.empty())
+    {
+        return {};
+    }
+
+    // Every node of a strongly connected component has an edge back into it,
+    // so following any such edge must eventually revisit a node
+    std::unordered_map<NodeId, size_t> members;
+    members.reserve(component.size());
+    for (const NodeId node : component)
+    {
+        members.emplace(node, std::numeric_limits<size_t>::max());
+    }
+
+    std::vector<NodeId> path;
+    NodeId current = component.front();
+    while (true)
+    {
+        auto& seenAt = members[current];
+        if (seenAt != std::numeric_limits<size_t>::max())
+        {
+            std::vector<NodeId> cycle(path.begin() + static_cast<std::ptrdiff_t>(seenAt), path.end());
+            cycle.push_back(current);
+            return cycle;
+        }
+        seenAt = path.size();
+        path.push_back(current);
+
+        for (const NodeId next : dependencies(current))
+        {
+            if (members.count(next) != 0)
+            {
+                current = next;
+                break;
+            }
+        }
+    }
+}
@@ -0,0 +1,750 @@
+#include "mimir/daemon.h"
+#include "mimir/parser.h"
+#include "mimir/socket_io.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <sstream>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+using namespace mimir;
+
+namespace
+{
+    /// How long a connected client may take to send its request (ms)
+    constexpr int REQUEST_TIMEOUT_MS = 5000;
+
+    /// Longest request line a client may send; a build request is one line of goals
+    constexpr size_t MAX_REQUEST_BYTES = 1024 * 1024;
+
+    std::vector<std::string> splitFields(const std::string& line)
+    {
+        std::vector<std::string> fields;
+        size_t start = 0;
+        while (true)
+        {
+            const size_t tab = line.find('\t', start);
+            fields.push_back(line.substr(start, tab == std::string::npos ? std::string::npos : tab - start));
+            if (tab == std::string::npos)
+            {
+                return fields;
+            }
+            start = tab + 1;
+        }
+    }
+
+    std::string formatSummary(const BuildStats& stats, const bool success)
+    {
+        char elapsed[32];
+        std::snprintf(elapsed, sizeof(elapsed), "%.3f", stats.elapsedSeconds);
+        std::ostringstream summary;
+        summary << "\nBuilt " << stats.builtTargets << ", up to date " << stats.skippedTargets;
+        if (stats.restoredTargets > 0)
+        {
+            summary << ", restored " << stats.restoredTargets;
+        }
+        summary << ", failed " << stats.failedTargets << " of " << stats.totalTargets
+                << " target(s) in " << elapsed << "s\n";
+        summary << (success ? "\nBuild completed successfully!\n" : "\nBuild failed!\n");
+        return summary.str();
+    }
+
+#ifndef _WIN32
+    int connectSocket(const std::string& path)
+    {
+        sockaddr_un address{};
+        if (path.size() >= sizeof(address.sun_path))
+        {
+            return -1;
+        }
+        address.sun_family = AF_UNIX;
+        std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+        const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0)
+        {
+            return -1;
+        }
+        setCloseOnExec(fd);
+        if (::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0)
+        {
+            ::close(fd);
+            return -1;
+        }
+        return fd;
+    }
+#endif
+}
+
+BuildDaemon::BuildDaemon(DaemonOptions options, CommandRunnerPtr runner)
+    : options_(std::move(options))
+    , runner_(runner ? std::move(runner) : createDefaultCommandRunner())
+    , buildFile_(FileWatcher::normalize(options_.buildFile))
+    , cache_(options_.cacheDir)
+    , depsLog_(std::make_shared<DepsLog>(options_.cacheDir + "/deps.bin"))
+{
+}
+
+BuildDaemon::~BuildDaemon()
+{
+#ifndef _WIN32
+    if (listenFd_ >= 0)
+    {
+        ::close(listenFd_);
+        ::unlink(options_.socketPath.c_str());
+    }
+    for (const int fd : {wakeRead_, wakeWrite_})
+    {
+        if (fd >= 0)
+        {
+            ::close(fd);
+        }
+    }
+#endif
+    if (loaded_)
+    {
+        cache_.checkpoint();
+    }
+}
+
+std::optional<std::string> BuildDaemon::load()
+{
+    if (!loaded_)
+    {
+        cache_.load();
+        cache_.enableJournal();
+        depsLog_->open();
+        loaded_ = true;
+    }
+    return loadGraph();
+}
+
+std::optional<std::string> BuildDaemon::loadGraph()
+{
+    // Whatever happens, a fixed build file must trigger the next reload
+    markAllDirty();
+    watcher_.clear();
+    watcher_.watch(options_.buildFile);
+
+    Parser parser;
+    parser.setCacheDirectory(options_.cacheDir);
+    auto result = parser.parseFile(options_.buildFile);
+    // Included files reload the graph just like the root; even after an
+    // error, the files read so far are the ones to fix
+    buildFiles_.clear();
+    for (const auto& file : parser.getSourceFiles())
+    {
+        buildFiles_.insert(FileWatcher::normalize(file));
+        watcher_.watch(file);
+    }
+    // A new file matching a glob changes the graph as surely as an edit to the build file
+    probes_ = parser.getGlobProbes();
+    probeDirs_.clear();
+    probesUnwatched_ = false;
+    watchProbeDirectories();
+    if (const auto* error = std::get_if<ParseError>(&result))
+    {
+        loadError_ = error->toString();
+        return loadError_;
+    }
+    auto& targets = std::get<std::vector<Target>>(result);
+    if (targets.empty())
+    {
+        loadError_ = "No targets found in " + options_.buildFile;
+        return loadError_;
+    }
+
+    DAG dag;
+    for (auto& target : targets)
+    {
+        dag.addTarget(std::move(target));
+    }
+    const auto missing = dag.validateDependencies();
+    if (!missing.empty())
+    {
+        std::string message = "Missing dependencies:";
+        for (const auto& dep : missing)
+        {
+            message += " " + dep;
+        }
+        loadError_ = message;
+        return loadError_;
+    }
+    const auto cycles = dag.detectCyclesWithResult();
+    if (cycles.hasCycle)
+    {
+        std::string message = "Cycle detected in dependency graph:";
+        for (size_t i = 0; i < cycles.cycleNodes.size(); ++i)
+        {
+            message += (i > 0 ? " -> " : " ") + cycles.cycleNodes[i];
+        }
+        loadError_ = message;
+        return loadError_;
+    }
+
+    dag_ = std::move(dag);
+    pools_ = parser.getPools();
+    loadError_.reset();
+
+    fileTargets_.clear();
+    for (const Target* target : dag_.getAllTargets())
+    {
+        for (const auto* paths : {&target->getInputs(), &target->getOutputs()})
+        {
+            for (const auto& path : *paths)
+            {
+                fileTargets_[FileWatcher::normalize(path)].push_back(target->getName());
+            }
+        }
+        addDiscoveredDeps(*target);
+    }
+    watchFiles();
+    dirty_.clear();
+    markAllDirty();
+    return std::nullopt;
+}
+
+void BuildDaemon::watchFiles()
+{
+    unwatched_.clear();
+    for (const auto& file : buildFiles_)
+    {
+        watcher_.watch(file);
+    }
+    for (const auto& [path, targets] : fileTargets_)
+    {
+        if (!watcher_.watch(path))
+        {
+            unwatched_.insert(targets.begin(), targets.end());
+        }
+    }
+}
+
+void BuildDaemon::watchProbeDirectories()
+{
+    const auto watchDirectory = [this](fs::path directory)
+    {
+        std::error_code ec;
+        while (!fs::is_directory(directory, ec) && directory.has_relative_path())
+        {
+            directory = directory.parent_path();
+        }
+        if (directory.empty())
+        {
+            directory = ".";
+        }
+        if (watcher_.watchDirectory(directory.string()))
+        {
+            probeDirs_.insert(FileWatcher::normalize(directory.string()));
+        }
+        else
+        {
+            probesUnwatched_ = true;
+        }
+    };
+
+    for (const auto& probe : probes_)
+    {
+        const GlobPattern pattern(probe.pattern);
+        if (pattern.isLiteral())
+        {
+            // A literal names one path, which only its directory can make appear
+            watchDirectory(fs::path(probe.pattern).parent_path());
+            continue;
+        }
+        const fs::path base = pattern.base().empty() ? fs::path(".") : fs::path(pattern.base());
+        watchDirectory(base);
+        if (pattern.segments().size() < 2)
+        {
+            continue;
+        }
+        // Wildcards past the first segment can match in any directory below the base
+        std::error_code ec;
+        for (auto it = fs::recursive_directory_iterator(base, fs::directory_options::skip_permission_denied, ec);
+             !ec && it != fs::recursive_directory_iterator(); it.increment(ec))
+        {
+            if (it->is_directory(ec) && !it->is_symlink(ec))
+            {
+                watchDirectory(it->path());
+            }
+        }
+    }
+}
+
+bool BuildDaemon::probesChanged()
+{
+    globEngine_.beginPass();
+    return std::any_of(probes_.begin(), probes_.end(), [this](const GlobProbe& probe)
+    {
+        return globEngine_.expand(probe.pattern) != probe.matches;
+    });
+}
+
+bool BuildDaemon::addDiscoveredDeps(const Target& target)
+{
+    const auto deps = target.getDepsFormat() == DepsFormat::None ? nullptr : depsLog_->getDeps(target.getName());
+    if (!deps)
+    {
+        return false;
+    }
+    bool added = false;
+    for (const auto& dep : *deps)
+    {
+        auto& targets = fileTargets_[FileWatcher::normalize(dep)];
+        if (std::find(targets.begin(), targets.end(), target.getName()) == targets.end())
+        {
+            targets.push_back(target.getName());
+            added = true;
+        }
+    }
+    return added;
+}
+
+void BuildDaemon::markDirty(const std::vector<std::string>& targets)
+{
+    std::unordered_set<std::string> visited;
+    std::vector<std::string> stack(targets.begin(), targets.end());
+    while (!stack.empty())
+    {
+        std::string name = std::move(stack.back());
+        stack.pop_back();
+        if (!visited.insert(name).second)
+        {
+            continue;
+        }
+        for (auto& dependent : dag_.getDependents(name))
+        {
+            stack.push_back(std::move(dependent));
+        }
+        dirty_.insert(std::move(name));
+    }
+}
+
+void BuildDaemon::markAllDirty()
+{
+    for (const Target* target : dag_.getAllTargets())
+    {
+        dirty_.insert(target->getName());
+    }
+}
+
+void BuildDaemon::refresh()
+{
+    bool probeEvent = probesUnwatched_;
+    for (const auto& path : watcher_.poll())
+    {
+        if (path == buildFile_ || buildFiles_.count(path) != 0)
+        {
+            reloadPending_ = true;
+            continue;
+        }
+        probeEvent = probeEvent || probeDirs_.count(path) != 0;
+        const auto it = fileTargets_.find(path);
+        if (it != fileTargets_.end())
+        {
+            markDirty(it->second);
+        }
+    }
+    if (watcher_.takeOverflow())
+    {
+        // Events were lost: trust nothing and re-establish the watches
+        reloadPending_ = true;
+    }
+    if (probeEvent && !reloadPending_)
+    {
+        // Most entries that come and go (objects, editor backups) match no glob
+        reloadPending_ = probesChanged();
+        if (!reloadPending_)
+        {
+            // New subdirectories need watches of their own
+            watchProbeDirectories();
+        }
+    }
+    if (reloadPending_)
+    {
+        reloadPending_ = false;
+        loadGraph();
+    }
+}
+
+int BuildDaemon::build(const std::vector<std::string>& goals, const OutputSink& sink)
+{
+    refresh();
+    if (loadError_)
+    {
+        sink("Error: " + *loadError_ + "\n");
+        return 1;
+    }
+    for (const auto& goal : goals)
+    {
+        if (!dag_.hasTarget(goal))
+        {
+            sink("Error: Unknown target: " + goal + "\n");
+            return 1;
+        }
+    }
+
+    ExecutorConfig config = options_.config;
+    config.pools = pools_;
+    Executor executor(config.numThreads, runner_);
+    executor.setConfig(config);
+    executor.setJobserver(options_.jobserver);
+    executor.setArtifactStore(options_.artifactStore);
+    executor.setDepsLog(depsLog_);
+    executor.setOutputSink(sink);
+    // dirty_ is only read while the executor runs; outcomes are applied afterwards
+    executor.setUpToDateHint([this](const Target& target)
+    {
+        return dirty_.count(target.getName()) == 0;
+    });
+    std::mutex outcomesMutex;
+    std::vector<std::string> clean;
+    std::vector<std::string> built;
+    executor.setProgressCallback([&](const std::string& name, size_t, size_t, const std::string& status)
+    {
+        if (status == "UP-TO-DATE" || status == "SUCCESS" || status == "RESTORED")
+        {
+            std::lock_guard<std::mutex> lock(outcomesMutex);
+            clean.push_back(name);
+            if (status == "SUCCESS")
+            {
+                built.push_back(name);
+            }
+        }
+    });
+
+    sink("Building with " + std::to_string(config.numThreads) + " parallel job(s)...\n");
+    BuildStats stats;
+    const bool success = executor.executeWithStats(dag_, goals, cache_, stats);
+    // The daemon never reloads its cache, so this is what keeps the journal from growing forever
+    cache_.checkpoint();
+
+    // Output directories may exist now that weren't there to watch before,
+    // and built targets may have reported headers nobody watches yet
+    bool discovered = false;
+    for (const auto& name : built)
+    {
+        discovered = addDiscoveredDeps(*dag_.getTarget(name)) || discovered;
+    }
+    if (discovered || !unwatched_.empty())
+    {
+        watchFiles();
+    }
+    for (const auto& name : clean)
+    {
+        // A command that never writes its outputs stays out of date, and no
+        // event would ever say so
+        const Target* target = dag_.getTarget(name);
+        const bool complete = std::all_of(target->getOutputs().begin(), target->getOutputs().end(),
+            [](const std::string& output)
+            {
+                std::error_code ec;
+                return fs::exists(output, ec);
+            });
+        if (complete && unwatched_.count(name) == 0)
+        {
+            dirty_.erase(name);
+        }
+    }
+    // A target stays clean only while everything it depends on is clean
+    markDirty(std::vector<std::string>(dirty_.begin(), dirty_.end()));
+
+    sink(formatSummary(stats, success));
+    return success ? 0 : 1;
+}
+
+bool BuildDaemon::isDirty(const std::string& target) const
+{
+    return dirty_.count(target) != 0;
+}
+
+size_t BuildDaemon::dirtyCount() const
+{
+    return dirty_.size();
+}
+
+const std::string& BuildDaemon::socketPath() const noexcept
+{
+    return options_.socketPath;
+}
+
+const std::string& BuildDaemon::buildFile() const noexcept
+{
+    return buildFile_;
+}
+
+#ifndef _WIN32
+std::optional<std::string> BuildDaemon::start()
+{
+    if (auto error = load())
+    {
+        return error;
+    }
+
+    const std::string& path = options_.socketPath;
+    sockaddr_un address{};
+    if (path.size() >= sizeof(address.sun_path))
+    {
+        return "Socket path is too long: " + path;
+    }
+    const int existing = connectSocket(path);
+    if (existing >= 0)
+    {
+        ::close(existing);
+        return "A daemon is already running on " + path;
+    }
+    std::error_code ec;
+    const fs::path directory = fs::path(path).parent_path();
+    if (!directory.empty())
+    {
+        fs::create_directories(directory, ec);
+    }
+    // Nobody answered, so any socket file left behind is stale
+    ::unlink(path.c_str());
+
+    listenFd_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd_ < 0)
+    {
+        return std::string("Cannot create socket: ") + std::strerror(errno);
+    }
+    setCloseOnExec(listenFd_);
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    if (::bind(listenFd_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0
+        || ::listen(listenFd_, 16) != 0)
+    {
+        const std::string error = std::string("Cannot listen on ") + path + ": " + std::strerror(errno);
+        ::close(listenFd_);
+        listenFd_ = -1;
+        return error;
+    }
+
+    int wakeFds[2];
+    if (::pipe(wakeFds) != 0)
+    {
+        return std::string("Cannot create wake pipe: ") + std::strerror(errno);
+    }
+    wakeRead_ = wakeFds[0];
+    wakeWrite_ = wakeFds[1];
+    for (const int fd : wakeFds)
+    {
+        setCloseOnExec(fd);
+        ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+    }
+    return std::nullopt;
+}
+
+void BuildDaemon::serve()
+{
+    while (!stopping_.load())
+    {
+        pollfd fds[3] = {
+            {listenFd_, POLLIN, 0},
+            {wakeRead_, POLLIN, 0},
+            {watcher_.fd(), POLLIN, 0},
+        };
+        if (::poll(fds, 3, -1) < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            break;
+        }
+        if ((fds[2].revents & POLLIN) != 0)
+        {
+            // Draining events as they arrive keeps the kernel queue from overflowing
+            refresh();
+        }
+        if ((fds[0].revents & POLLIN) != 0)
+        {
+            const int client = ::accept(listenFd_, nullptr, nullptr);
+            if (client >= 0)
+            {
+                setCloseOnExec(client);
+                handleClient(client);
+                ::close(client);
+            }
+        }
+    }
+
+    // Refuse new clients right away instead of leaving them in the backlog
+    if (listenFd_ >= 0)
+    {
+        ::close(listenFd_);
+        ::unlink(options_.socketPath.c_str());
+        listenFd_ = -1;
+    }
+}
+
+void BuildDaemon::stop() noexcept
+{
+    stopping_.store(true);
+    if (wakeWrite_ >= 0)
+    {
+        const char byte = 0;
+        const ssize_t written = ::write(wakeWrite_, &byte, 1);
+        (void)written;
+    }
+}
+
+void BuildDaemon::handleClient(const int fd)
+{
+    SocketReader reader(fd, REQUEST_TIMEOUT_MS, MAX_REQUEST_BYTES);
+    std::string line;
+    if (!reader.readLine(line))
+    {
+        return;
+    }
+    const std::vector<std::string> fields = splitFields(line);
+
+    if (fields[0] == "stop")
+    {
+        sendAll(fd, "X 0\n");
+        stop();
+        return;
+    }
+    if (fields[0] != "build" || fields.size() < 3)
+    {
+        sendAll(fd, "R unknown request\n");
+        return;
+    }
+    if (FileWatcher::normalize(fields[1]) != buildFile_)
+    {
+        sendAll(fd, "R serving " + buildFile_ + "\n");
+        return;
+    }
+    // Building with our own options instead of the client's would ignore what it asked for
+    if (fields[2] != options_.settings)
+    {
+        sendAll(fd, "R started with other options\n");
+        return;
+    }
+
+    const std::vector<std::string> goals(fields.begin() + 3, fields.end());
+    bool connected = true;
+    const int code = build(goals, [fd, &connected](const std::string& text)
+    {
+        // A client that went away doesn't stop the build
+        connected = connected && sendAll(fd, "O " + std::to_string(text.size()) + "\n" + text);
+    });
+    if (connected)
+    {
+        sendAll(fd, "X " + std::to_string(code) + "\n");
+    }
+}
+
+std::optional<int> mimir::buildOnDaemon(
+    const std::string& socketPath,
+    const std::string& buildFile,
+    const std::string& settings,
+    const std::vector<std::string>& goals,
+    std::ostream& out)
+{
+    const int fd = connectSocket(socketPath);
+    if (fd < 0)
+    {
+        return std::nullopt;
+    }
+
+    std::string request = "build\t" + FileWatcher::normalize(buildFile) + "\t" + settings;
+    for (const auto& goal : goals)
+    {
+        request += "\t" + goal;
+    }
+    request += "\n";
+
+    std::optional<int> code;
+    if (sendAll(fd, request))
+    {
+        SocketReader reader(fd, -1);
+        std::string line;
+        bool lost = true;
+        while (reader.readLine(line))
+        {
+            if (line.rfind("O ", 0) == 0)
+            {
+                std::string text;
+                if (!reader.readExact(std::stoull(line.substr(2)), text))
+                {
+                    break;
+                }
+                out << text;
+                out.flush();
+                continue;
+            }
+            lost = false;
+            if (line.rfind("X ", 0) == 0)
+            {
+                code = std::stoi(line.substr(2));
+            }
+            break;
+        }
+        if (lost)
+        {
+            out << "mimir: lost connection to the daemon\n";
+            code = 1;
+        }
+    }
+    ::close(fd);
+    return code;
+}
+
+bool mimir::stopDaemon(const std::string& socketPath)
+{
+    const int fd = connectSocket(socketPath);
+    if (fd < 0)
+    {
+        return false;
+    }
+    std::string reply;
+    SocketReader reader(fd, REQUEST_TIMEOUT_MS);
+    const bool stopped = sendAll(fd, "stop\n") && reader.readLine(reply) && reply == "X 0";
+    ::close(fd);
+    return stopped;
+}
+#else
+std::optional<std::string> BuildDaemon::start()
+{
+    return std::string("The daemon needs Unix domain sockets, which this platform lacks");
+}
+
+void BuildDaemon::serve()
+{
+}
+
+void BuildDaemon::stop() noexcept
+{
+    stopping_.store(true);
+}
+
+void BuildDaemon::handleClient(int)
+{
+}
+
+std::optional<int> mimir::buildOnDaemon(
+    const std::string&,
+    const std::string&,
+    const std::string&,
+    const std::vector<std::string>&,
+    std::ostream&)
+{
+    return std::nullopt;
+}
+
+bool mimir::stopDaemon(const std::string&)
+{
+    return false;
+}
+#endif
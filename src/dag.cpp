@@ -1,6 +1,7 @@
 #include "mimir/dag.h"
+#include "mimir/compiled_graph.h"
 #include <algorithm>
-#include <stack>
+#include <unordered_set>
 
 using namespace mimir;
 
@@ -10,7 +11,9 @@ bool DAG::addTarget(const Target& target)
     {
         return false;
     }
-    targets_[target.getName()] = std::make_shared<Target>(target);
+    auto ptr = std::make_shared<Target>(target);
+    indexDependencies(*ptr);
+    targets_[target.getName()] = std::move(ptr);
     return true;
 }
 
@@ -21,7 +24,9 @@ bool DAG::addTarget(Target&& target)
     {
         return false;
     }
-    targets_[name] = std::make_shared<Target>(std::move(target));
+    auto ptr = std::make_shared<Target>(std::move(target));
+    indexDependencies(*ptr);
+    targets_[name] = std::move(ptr);
     return true;
 }
 
@@ -31,55 +36,52 @@ bool DAG::addTarget(TargetPtr target)
     {
         return false;
     }
+    indexDependencies(*target);
     targets_[target->getName()] = std::move(target);
     return true;
 }
 
 bool DAG::removeTarget(const std::string& name)
 {
-    return targets_.erase(name) > 0;
-}
+    auto it = targets_.find(name);
+    if (it == targets_.end())
+    {
+        return false;
+    }
 
-bool DAG::hasTarget(const std::string& name) const
-{
-    return targets_.find(name) != targets_.end();
+    for (const auto& dep : it->second->getDependencies())
+    {
+        auto depIt = dependents_.find(dep);
+        if (depIt == dependents_.end())
+        {
+            continue;
+        }
+        auto& list = depIt->second;
+        auto pos = std::find(list.begin(), list.end(), name);
+        if (pos != list.end())
+        {
+            list.erase(pos);
+        }
+        if (list.empty())
+        {
+            dependents_.erase(depIt);
+        }
+    }
+    targets_.erase(it);
+    return true;
 }
 
-bool DAG::hasCycleUtil(
-    const std::string& node,
-    std::unordered_map<std::string, int>& visited,
-    std::vector<std::string>& recStack,
-    std::vector<std::string>& cycleNodes) const
+void DAG::indexDependencies(const Target& target)
 {
-    visited[node] = 1;
-    recStack.push_back(node);
-
-    auto it = targets_.find(node);
-    if (it != targets_.end())
+    for (const auto& dep : target.getDependencies())
     {
-        for (const auto& dep : it->second->getDependencies())
-        {
-            if (visited[dep] == 0)
-            {
-                if (hasCycleUtil(dep, visited, recStack, cycleNodes))
-                {
-                    return true;
-                }
-            }
-            else if (visited[dep] == 1)
-            {
-                // Found cycle - extract cycle path
-                auto cycleStart = std::find(recStack.begin(), recStack.end(), dep);
-                cycleNodes.assign(cycleStart, recStack.end());
-                cycleNodes.push_back(dep);
-                return true;
-            }
-        }
+        dependents_[dep].push_back(target.getName());
     }
-    
-    visited[node] = 2;
-    recStack.pop_back();
-    return false;
+}
+
+bool DAG::hasTarget(const std::string& name) const
+{
+    return targets_.find(name) != targets_.end();
 }
 
 bool DAG::detectCycles() const
@@ -90,20 +92,30 @@ bool DAG::detectCycles() const
 
 CycleDetectionResult DAG::detectCyclesWithPath() const
 {
-    CycleDetectionResult result{false, {}};
-    std::unordered_map<std::string, int> visited;
-    std::vector<std::string> recStack;
-    
-    for (const auto& [name, target] : targets_)
+    CycleDetectionResult result{false, {}, {}};
+    const CompiledGraph graph(*this);
+    const auto components = graph.cyclicComponents();
+    if (components.empty())
+    {
+        return result;
+    }
+
+    result.hasCycle = true;
+    for (const auto& cycleNode : graph.cycleIn(components.front()))
     {
-        if (visited[name] == 0)
+        result.cycleNodes.emplace_back(graph.nodeName(cycleNode));
+    }
+
+    result.components.reserve(components.size());
+    for (const auto& component : components)
+    {
+        std::vector<std::string> names;
+        names.reserve(component.size());
+        for (const NodeId node : component)
         {
-            if (hasCycleUtil(name, visited, recStack, result.cycleNodes))
-            {
-                result.hasCycle = true;
-                return result;
-            }
+            names.emplace_back(graph.nodeName(node));
         }
+        result.components.push_back(std::move(names));
     }
     return result;
 }
@@ -115,60 +127,41 @@ CycleDetectionResult DAG::detectCyclesWithResult() const
 
 std::vector<std::string> DAG::topologicalSort() const
 {
-    std::unordered_map<std::string, int> inDegree;
-    std::vector<std::string> result;
-    
-    // Initialize in-degree for all targets
-    for (const auto& [name, target] : targets_)
-    {
-        if (inDegree.find(name) == inDegree.end())
-        {
-            inDegree[name] = 0;
-        }
-    }
-    
-    // Calculate in-degree based on dependencies
-    for (const auto& [name, target] : targets_)
-    {
-        for (const auto& dep : target->getDependencies())
-        {
-            inDegree[name]++;
-        }
-    }
-    
-    // Find all nodes with zero in-degree
+    std::unordered_map<std::string, size_t> inDegree;
+    inDegree.reserve(targets_.size());
     std::vector<std::string> queue;
-    for (const auto& [name, degree] : inDegree)
+    queue.reserve(targets_.size());
+
+    // Missing dependencies keep their dependents' in-degree above zero
+    for (const auto& [name, target] : targets_)
     {
+        const size_t degree = target->getDependencies().size();
+        inDegree.emplace(name, degree);
         if (degree == 0)
         {
             queue.push_back(name);
         }
     }
-    
-    // Process queue
+
+    // The queue doubles as the result: each node is appended exactly once
     size_t idx = 0;
     while (idx < queue.size())
     {
-        std::string current = queue[idx++];
-        result.push_back(current);
-        
-        // Reduce in-degree for dependents
-        for (const auto& [name, target] : targets_)
+        auto it = dependents_.find(queue[idx++]);
+        if (it == dependents_.end())
+        {
+            continue;
+        }
+        for (const auto& dependent : it->second)
         {
-            const auto& deps = target->getDependencies();
-            if (std::find(deps.begin(), deps.end(), current) != deps.end())
+            if (--inDegree[dependent] == 0)
             {
-                inDegree[name]--;
-                if (inDegree[name] == 0)
-                {
-                    queue.push_back(name);
-                }
+                queue.push_back(dependent);
             }
         }
     }
-    
-    return result;
+
+    return queue;
 }
 
 const Target* DAG::getTarget(const std::string& name) const
@@ -224,6 +217,7 @@ bool DAG::empty() const noexcept
 void DAG::clear()
 {
     targets_.clear();
+    dependents_.clear();
 }
 
 std::vector<std::string> DAG::getDependencies(const std::string& name) const
@@ -238,13 +232,21 @@ std::vector<std::string> DAG::getDependencies(const std::string& name) const
 
 std::vector<std::string> DAG::getDependents(const std::string& name) const
 {
+    auto it = dependents_.find(name);
+    if (it == dependents_.end())
+    {
+        return {};
+    }
+
+    // A target listing the same dependency twice is indexed twice; report it once
     std::vector<std::string> dependents;
-    for (const auto& [targetName, target] : targets_)
+    dependents.reserve(it->second.size());
+    std::unordered_set<std::string> seen;
+    for (const auto& dependent : it->second)
     {
-        const auto& deps = target->getDependencies();
-        if (std::find(deps.begin(), deps.end(), name) != deps.end())
+        if (seen.insert(dependent).second)
         {
-            dependents.push_back(targetName);
+            dependents.push_back(dependent);
         }
     }
     return dependents;
@@ -252,16 +254,42 @@ std::vector<std::string> DAG::getDependents(const std::string& name) const
 
 std::vector<std::string> DAG::validateDependencies() const
 {
+    // Every referenced name is a key of the dependents index, so one pass over it suffices
     std::vector<std::string> missing;
-    for (const auto& [name, target] : targets_)
+    for (const auto& [dep, dependents] : dependents_)
     {
-        for (const auto& dep : target->getDependencies())
+        if (targets_.find(dep) == targets_.end())
         {
-            if (targets_.find(dep) == targets_.end())
-            {
-                missing.push_back(dep);
-            }
+            missing.push_back(dep);
         }
     }
     return missing;
-}
\ No newline at end of file
+}
+
+DAG DAG::closure(const std::vector<std::string>& goals) const
+{
+    DAG result;
+    std::vector<const std::string*> stack;
+    stack.reserve(goals.size());
+    for (const auto& goal : goals)
+    {
+        stack.push_back(&goal);
+    }
+
+    while (!stack.empty())
+    {
+        const std::string& name = *stack.back();
+        stack.pop_back();
+        const auto it = targets_.find(name);
+        if (it == targets_.end() || result.hasTarget(name))
+        {
+            continue;
+        }
+        result.addTarget(it->second);
+        for (const auto& dep : it->second->getDependencies())
+        {
+            stack.push_back(&dep);
+        }
+    }
+    return result;
+}
@@ -0,0 +1,176 @@
+#include "mimir/depfile.h"
+#include <unordered_set>
+
+using namespace mimir;
+
+namespace
+{
+    bool isBlank(const char c) noexcept
+    {
+        return c == ' ' || c == '\t';
+    }
+
+    /**
+    * @brief Check for a backslash-newline continuation
+    * @param text Depfile text
+    * @param pos Position of the backslash
+    * @return Length of the continuation (2 or 3 with CRLF), or 0 if there is none
+    */
+    size_t continuationAt(std::string_view text, const size_t pos) noexcept
+    {
+        if (text[pos] != '\\' || pos + 1 >= text.size())
+        {
+            return 0;
+        }
+        if (text[pos + 1] == '\n')
+        {
+            return 2;
+        }
+        return text[pos + 1] == '\r' && pos + 2 < text.size() && text[pos + 2] == '\n' ? 3 : 0;
+    }
+
+    /**
+    * @brief Check whether a colon ends a rule's targets
+    * @param text Depfile text
+    * @param pos Position of the colon
+    * @return True if the colon is followed by a blank, a line end or the end of text
+    */
+    bool isSeparator(std::string_view text, const size_t pos) noexcept
+    {
+        const size_t next = pos + 1;
+        return next >= text.size() || isBlank(text[next]) || text[next] == '\n' || text[next] == '\r'
+            || continuationAt(text, next) != 0;
+    }
+}
+
+std::optional<std::vector<std::string>> mimir::parseDepfile(std::string_view text)
+{
+    std::vector<std::string> prerequisites;
+    std::unordered_set<std::string> seen;
+    bool inPrerequisites = false;
+    bool sawTarget = false;
+    size_t pos = 0;
+    while (pos < text.size())
+    {
+        const char c = text[pos];
+        if (const size_t skip = continuationAt(text, pos))
+        {
+            pos += skip;
+            continue;
+        }
+        if (isBlank(c) || c == '\r')
+        {
+            ++pos;
+            continue;
+        }
+        if (c == '\n')
+        {
+            // A rule's targets must be followed by a colon on the same logical line
+            if (sawTarget && !inPrerequisites)
+            {
+                return std::nullopt;
+            }
+            sawTarget = false;
+            inPrerequisites = false;
+            ++pos;
+            continue;
+        }
+        if (c == '#' && !sawTarget)
+        {
+            while (pos < text.size() && text[pos] != '\n')
+            {
+                ++pos;
+            }
+            continue;
+        }
+
+        std::string token;
+        bool endsTargets = false;
+        while (pos < text.size())
+        {
+            const char ch = text[pos];
+            if (isBlank(ch) || ch == '\n' || ch == '\r' || continuationAt(text, pos) != 0)
+            {
+                break;
+            }
+            if (ch == '\\' && pos + 1 < text.size() && (isBlank(text[pos + 1]) || text[pos + 1] == '#'))
+            {
+                token.push_back(text[pos + 1]);
+                pos += 2;
+                continue;
+            }
+            if (ch == '$' && pos + 1 < text.size() && text[pos + 1] == '$')
+            {
+                token.push_back('$');
+                pos += 2;
+                continue;
+            }
+            if (ch == ':' && !inPrerequisites && isSeparator(text, pos))
+            {
+                endsTargets = true;
+                ++pos;
+                break;
+            }
+            token.push_back(ch);
+            ++pos;
+        }
+
+        if (inPrerequisites)
+        {
+            if (seen.insert(token).second)
+            {
+                prerequisites.push_back(std::move(token));
+            }
+            continue;
+        }
+        if (endsTargets)
+        {
+            if (token.empty() && !sawTarget)
+            {
+                return std::nullopt;
+            }
+            inPrerequisites = true;
+        }
+        sawTarget = true;
+    }
+    if (sawTarget && !inPrerequisites)
+    {
+        return std::nullopt;
+    }
+    return prerequisites;
+}
+
+std::vector<std::string> mimir::parseShowIncludes(std::string_view output, std::string& filtered)
+{
+    std::vector<std::string> headers;
+    std::unordered_set<std::string_view> seen;
+    filtered.clear();
+    size_t pos = 0;
+    while (pos < output.size())
+    {
+        size_t end = output.find('\n', pos);
+        end = end == std::string_view::npos ? output.size() : end + 1;
+        const std::string_view line = output.substr(pos, end - pos);
+        pos = end;
+
+        if (line.compare(0, SHOW_INCLUDES_PREFIX.size(), SHOW_INCLUDES_PREFIX) != 0)
+        {
+            filtered.append(line);
+            continue;
+        }
+        // Nesting is shown as extra spaces between the prefix and the path
+        std::string_view path = line.substr(SHOW_INCLUDES_PREFIX.size());
+        const size_t first = path.find_first_not_of(" \t");
+        const size_t last = path.find_last_not_of(" \t\r\n");
+        if (first == std::string_view::npos || last < first)
+        {
+            continue;
+        }
+        path = path.substr(first, last - first + 1);
+        if (seen.insert(path).second)
+        {
+            headers.emplace_back(path);
+        }
+    }
+    return headers;
+}
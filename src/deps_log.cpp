@@ -0,0 +1,350 @@
+#include "mimir/deps_log.h"
+#include "mimir/mapped_file.h"
+#include <cstring>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+using namespace mimir;
+
+namespace
+{
+    constexpr std::uint32_t BYTE_ORDER_MARK = 0x01020304;
+    constexpr size_t HEADER_SIZE = sizeof(DepsLog::MAGIC) + 2 * sizeof(std::uint32_t);
+
+    /// Set in a record's size word for deps records
+    constexpr std::uint32_t DEPS_RECORD = 0x80000000u;
+
+    /// Larger records mean corruption
+    constexpr std::uint32_t MAX_RECORD_SIZE = 1u << 24;
+
+    /// Compact once superseded records outnumber live ones this many times over
+    constexpr size_t COMPACTION_RATIO = 3;
+
+    /// ... and the log holds at least this many deps records
+    constexpr size_t MIN_COMPACTION_RECORDS = 1000;
+
+    void putU32(std::string& out, const std::uint32_t value)
+    {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    void appendRecord(std::string& out, const std::string& payload, const bool deps)
+    {
+        putU32(out, static_cast<std::uint32_t>(payload.size()) | (deps ? DEPS_RECORD : 0));
+        out.append(payload);
+    }
+
+    std::uint32_t getU32(const char* data)
+    {
+        std::uint32_t value;
+        std::memcpy(&value, data, sizeof(value));
+        return value;
+    }
+}
+
+DepsLog::DepsLog(std::string path)
+    : path_(std::move(path))
+{
+}
+
+DepsLog::~DepsLog()
+{
+    close();
+}
+
+bool DepsLog::open()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (file_ != nullptr)
+    {
+        return true;
+    }
+    std::error_code ec;
+    const fs::path parent = fs::path(path_).parent_path();
+    if (!parent.empty())
+    {
+        fs::create_directories(parent, ec);
+    }
+    if (!load())
+    {
+        return startFile();
+    }
+    if (depsRecords_ >= MIN_COMPACTION_RECORDS && depsRecords_ > COMPACTION_RATIO * deps_.size()
+        && compactLocked())
+    {
+        return true;
+    }
+    file_ = std::fopen(path_.c_str(), "ab");
+    return file_ != nullptr;
+}
+
+void DepsLog::close()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (file_ != nullptr)
+    {
+        std::fclose(file_);
+        file_ = nullptr;
+    }
+}
+
+bool DepsLog::isOpen() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return file_ != nullptr;
+}
+
+DepsLog::DepsPtr DepsLog::getDeps(const std::string& target) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = deps_.find(target);
+    return it == deps_.end() ? nullptr : it->second;
+}
+
+bool DepsLog::record(const std::string& target, std::vector<std::string> deps)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& entry = deps_[target];
+    if (entry && *entry == deps)
+    {
+        return file_ != nullptr;
+    }
+    entry = std::make_shared<const std::vector<std::string>>(std::move(deps));
+    if (file_ == nullptr)
+    {
+        return false;
+    }
+
+    std::string payload;
+    std::uint32_t id = 0;
+    if (!intern(target, id))
+    {
+        return false;
+    }
+    putU32(payload, id);
+    for (const auto& dep : *entry)
+    {
+        if (!intern(dep, id))
+        {
+            return false;
+        }
+        putU32(payload, id);
+    }
+    ++depsRecords_;
+    return writeRecord(payload, true) && std::fflush(file_) == 0;
+}
+
+bool DepsLog::recompact()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (file_ != nullptr)
+    {
+        std::fclose(file_);
+        file_ = nullptr;
+    }
+    const bool compacted = compactLocked();
+    if (!compacted)
+    {
+        file_ = std::fopen(path_.c_str(), "ab");
+    }
+    return compacted;
+}
+
+size_t DepsLog::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return deps_.size();
+}
+
+const std::string& DepsLog::getPath() const noexcept
+{
+    return path_;
+}
+
+bool DepsLog::load()
+{
+    paths_.clear();
+    ids_.clear();
+    deps_.clear();
+    depsRecords_ = 0;
+
+    MappedFile file;
+    if (!file.open(path_))
+    {
+        return false;
+    }
+    const std::string_view bytes = file.view();
+    if (bytes.size() < HEADER_SIZE || std::memcmp(bytes.data(), MAGIC, sizeof(MAGIC)) != 0
+        || getU32(bytes.data() + sizeof(MAGIC)) != VERSION
+        || getU32(bytes.data() + sizeof(MAGIC) + sizeof(std::uint32_t)) != BYTE_ORDER_MARK)
+    {
+        return false;
+    }
+
+    size_t pos = HEADER_SIZE;
+    while (pos + sizeof(std::uint32_t) <= bytes.size())
+    {
+        const std::uint32_t word = getU32(bytes.data() + pos);
+        const bool isDeps = (word & DEPS_RECORD) != 0;
+        const std::uint32_t size = word & ~DEPS_RECORD;
+        const char* payload = bytes.data() + pos + sizeof(std::uint32_t);
+        if (size > MAX_RECORD_SIZE || size < sizeof(std::uint32_t) || (isDeps && size % sizeof(std::uint32_t) != 0)
+            || bytes.size() - pos - sizeof(std::uint32_t) < size)
+        {
+            break;
+        }
+
+        if (isDeps)
+        {
+            const size_t count = size / sizeof(std::uint32_t);
+            std::vector<std::uint32_t> ids(count);
+            std::memcpy(ids.data(), payload, size);
+            bool valid = true;
+            for (const std::uint32_t id : ids)
+            {
+                valid = valid && id < paths_.size();
+            }
+            if (!valid)
+            {
+                break;
+            }
+            std::vector<std::string> deps;
+            deps.reserve(count - 1);
+            for (size_t i = 1; i < count; ++i)
+            {
+                deps.push_back(paths_[ids[i]]);
+            }
+            deps_[paths_[ids[0]]] = std::make_shared<const std::vector<std::string>>(std::move(deps));
+            ++depsRecords_;
+        }
+        else
+        {
+            const size_t length = size - sizeof(std::uint32_t);
+            const auto id = static_cast<std::uint32_t>(paths_.size());
+            if (getU32(payload + length) != ~id)
+            {
+                break;
+            }
+            paths_.emplace_back(payload, length);
+            ids_.emplace(paths_.back(), id);
+        }
+        pos += sizeof(std::uint32_t) + size;
+    }
+
+    file.close();
+    if (pos != bytes.size())
+    {
+        // Drop the torn or corrupt tail so appends continue from intact records
+        std::error_code ec;
+        fs::resize_file(path_, pos, ec);
+        if (ec)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool DepsLog::compactLocked()
+{
+    // Ids are handed out afresh, so paths no live record uses are dropped
+    std::vector<std::string> paths;
+    std::unordered_map<std::string, std::uint32_t> ids;
+    std::string bytes(MAGIC, sizeof(MAGIC));
+    putU32(bytes, VERSION);
+    putU32(bytes, BYTE_ORDER_MARK);
+    auto idOf = [&](const std::string& path)
+    {
+        const auto [it, added] = ids.emplace(path, static_cast<std::uint32_t>(paths.size()));
+        if (added)
+        {
+            std::string payload = path;
+            putU32(payload, ~it->second);
+            appendRecord(bytes, payload, false);
+            paths.push_back(path);
+        }
+        return it->second;
+    };
+    for (const auto& [target, deps] : deps_)
+    {
+        std::string payload;
+        putU32(payload, idOf(target));
+        for (const auto& dep : *deps)
+        {
+            putU32(payload, idOf(dep));
+        }
+        appendRecord(bytes, payload, true);
+    }
+
+    const std::string tmpPath = path_ + ".tmp";
+    std::FILE* tmp = std::fopen(tmpPath.c_str(), "wb");
+    bool ok = tmp != nullptr && std::fwrite(bytes.data(), 1, bytes.size(), tmp) == bytes.size();
+    ok = tmp != nullptr && std::fclose(tmp) == 0 && ok;
+    std::error_code ec;
+    if (ok)
+    {
+        fs::rename(tmpPath, path_, ec);
+    }
+    if (!ok || ec)
+    {
+        fs::remove(tmpPath, ec);
+        return false;
+    }
+
+    paths_ = std::move(paths);
+    ids_ = std::move(ids);
+    depsRecords_ = deps_.size();
+    file_ = std::fopen(path_.c_str(), "ab");
+    return file_ != nullptr;
+}
+
+bool DepsLog::startFile()
+{
+    file_ = std::fopen(path_.c_str(), "wb");
+    if (file_ == nullptr)
+    {
+        return false;
+    }
+    std::string header(MAGIC, sizeof(MAGIC));
+    putU32(header, VERSION);
+    putU32(header, BYTE_ORDER_MARK);
+    if (std::fwrite(header.data(), 1, header.size(), file_) != header.size() || std::fflush(file_) != 0)
+    {
+        std::fclose(file_);
+        file_ = nullptr;
+        return false;
+    }
+    return true;
+}
+
+bool DepsLog::writeRecord(const std::string& payload, const bool deps)
+{
+    std::string frame;
+    frame.reserve(sizeof(std::uint32_t) + payload.size());
+    appendRecord(frame, payload, deps);
+    return std::fwrite(frame.data(), 1, frame.size(), file_) == frame.size();
+}
+
+bool DepsLog::intern(const std::string& path, std::uint32_t& id)
+{
+    const auto it = ids_.find(path);
+    if (it != ids_.end())
+    {
+        id = it->second;
+        return true;
+    }
+    if (path.size() + sizeof(std::uint32_t) > MAX_RECORD_SIZE)
+    {
+        return false;
+    }
+    id = static_cast<std::uint32_t>(paths_.size());
+    std::string payload = path;
+    putU32(payload, ~id);
+    if (!writeRecord(payload, false))
+    {
+        return false;
+    }
+    paths_.push_back(path);
+    ids_.emplace(path, id);
+    return true;
+}
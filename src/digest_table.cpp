@@ -0,0 +1,76 @@
+#include "mimir/digest_table.h"
+
+using namespace mimir;
+
+namespace
+{
+    size_t roundUpToPowerOfTwo(size_t value)
+    {
+        size_t result = 1;
+        while (result < value)
+        {
+            result <<= 1;
+        }
+        return result;
+    }
+}
+
+FileDigestTable::FileDigestTable(const size_t shardCount)
+    : shards_(roundUpToPowerOfTwo(shardCount == 0 ? 1 : shardCount))
+    , mask_(shards_.size() - 1)
+{
+}
+
+FileDigestTable::Shard& FileDigestTable::shardFor(const std::string& path)
+{
+    return shards_[std::hash<std::string>{}(path) & mask_];
+}
+
+std::string FileDigestTable::get(const std::string& path, const ComputeFn& compute)
+{
+    Entry* entry = nullptr;
+    {
+        Shard& shard = shardFor(path);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto& slot = shard.entries[path];
+        if (!slot)
+        {
+            slot = std::make_unique<Entry>();
+        }
+        entry = slot.get();
+    }
+
+    // The shard lock is released before hashing; only callers for this path wait
+    std::call_once(entry->once, [&]()
+    {
+        entry->digest = compute(path);
+        computations_.fetch_add(1, std::memory_order_relaxed);
+    });
+    return entry->digest;
+}
+
+size_t FileDigestTable::size() const
+{
+    size_t total = 0;
+    for (const auto& shard : shards_)
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        total += shard.entries.size();
+    }
+    return total;
+}
+
+size_t FileDigestTable::computations() const noexcept
+{
+    return computations_.load(std::memory_order_relaxed);
+}
+
+void FileDigestTable::clear()
+{
+    for (auto& shard : shards_)
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.entries.clear();
+    }
+    computations_.store(0, std::memory_order_relaxed);
+}
@@ -1,14 +1,22 @@
 #include "mimir/executor.h"
 #include "mimir/signature.h"
+#include "mimir/depfile.h"
+#include "mimir/mapped_file.h"
 #include <iostream>
 #include <fstream>
 #include <thread>
 #include <vector>
 #include <mutex>
 #include <condition_variable>
+#include <deque>
 #include <queue>
+#include <algorithm>
+#include <unordered_map>
+#include <memory>
 #include <chrono>
 #include <cstdlib>
+#include <filesystem>
+#include <limits>
 
 using namespace mimir;
 
@@ -39,32 +47,231 @@ Executor::Executor(int numThreads, CommandRunnerPtr runner)
     }
 }
 
-bool Executor::isOutOfDate(const Target& target, const Cache& cache) const
+std::string Executor::computeSignature(const Target& target, Cache& cache, FileDigestTable& digests) const
 {
-    const std::string currentSig = Signature::computeTargetSignature(target.getCommand(), target.getInputs());
-    return cache.needsRebuild(target.getName(), currentSig);
+    const FileDigestTable::ComputeFn compute = config_.paranoid
+        ? FileDigestTable::ComputeFn(&Signature::computeFileSignature)
+        : FileDigestTable::ComputeFn([&cache](const std::string& path) { return cache.getFileSignature(path); });
+
+    // Headers the last run reported count as inputs, so only those are hashed
+    const DepsLog::DepsPtr discovered = depsLog_ && target.getDepsFormat() != DepsFormat::None
+        ? depsLog_->getDeps(target.getName()) : nullptr;
+    std::vector<std::string> fileSignatures;
+    fileSignatures.reserve(target.getInputs().size() + (discovered ? discovered->size() : 0));
+    for (const auto& input : target.getInputs())
+    {
+        fileSignatures.push_back(digests.get(input, compute));
+    }
+    if (discovered)
+    {
+        for (const auto& dep : *discovered)
+        {
+            fileSignatures.push_back(digests.get(dep, compute));
+        }
+    }
+
+    // A dependency counts through its output signature if it is a restat target,
+    // so a rebuild that reproduces the same outputs leaves dependents clean
+    for (const auto& dependency : target.getDependencies())
+    {
+        auto produced = cache.findOutputSignature(dependency);
+        fileSignatures.push_back(produced ? std::move(*produced) : cache.getSignature(dependency));
+    }
+    return Signature::combineTargetSignature(target.getCommand(), fileSignatures);
+}
+
+std::string Executor::computeOutputSignature(const Target& target, Cache& cache) const
+{
+    std::vector<std::string> fileSignatures;
+    fileSignatures.reserve(target.getOutputs().size());
+    for (const auto& output : target.getOutputs())
+    {
+        fileSignatures.push_back(config_.paranoid
+            ? Signature::computeFileSignature(output) : cache.getFileSignature(output));
+    }
+    return Signature::combineTargetSignature("", fileSignatures);
+}
+
+void Executor::recordOutputSignature(const Target& target, const std::string& signature, Cache& cache) const
+{
+    if (target.getRestat())
+    {
+        cache.setOutputSignature(target.getName(), computeOutputSignature(target, cache));
+    }
+    else if (cache.findOutputSignature(target.getName()))
+    {
+        // Left over from when the target was restat; dependents follow its signature again
+        cache.setOutputSignature(target.getName(), signature);
+    }
+}
+
+const char* Executor::statusName(const TargetStatus status) noexcept
+{
+    switch (status)
+    {
+        case TargetStatus::UpToDate:
+            return "UP-TO-DATE";
+        case TargetStatus::Built:
+            return "SUCCESS";
+        case TargetStatus::Restored:
+            return "RESTORED";
+        case TargetStatus::Failed:
+            break;
+    }
+    return "FAILED";
+}
+
+TraceEvent Executor::beginTrace(const CompiledGraph& graph, const NodeId node, const size_t worker,
+    const std::vector<std::int64_t>& finishedUs) const
+{
+    TraceEvent event;
+    event.name = graph.target(node).getName();
+    event.worker = worker;
+    for (const NodeId dependency : graph.dependencies(node))
+    {
+        event.readyUs = std::max(event.readyUs, finishedUs[dependency]);
+    }
+    event.startUs = trace_->elapsedUs();
+    return event;
+}
+
+void Executor::endTrace(TraceEvent& event, const TargetStatus status, std::vector<std::int64_t>& finishedUs,
+    const NodeId node) const
+{
+    event.endUs = trace_->elapsedUs();
+    event.status = statusName(status);
+    finishedUs[node] = event.endUs;
+    trace_->record(std::move(event));
+}
+
+bool Executor::isOutOfDate(const Target& target, const std::string& signature, const Cache& cache) const
+{
+    return depsUnknown(target) || cache.needsRebuild(target.getName(), signature);
+}
+
+bool Executor::depsUnknown(const Target& target) const
+{
+    return depsLog_ && target.getDepsFormat() != DepsFormat::None && !depsLog_->getDeps(target.getName());
+}
+
+namespace
+{
+    /// @brief Jobserver slot held for the lifetime of one command \class JobToken
+    class JobToken
+    {
+    public:
+        explicit JobToken(Jobserver* jobserver)
+            : jobserver_(jobserver)
+            , held_(jobserver == nullptr || jobserver->acquire())
+        {
+        }
+
+        ~JobToken()
+        {
+            if (jobserver_ != nullptr && held_)
+            {
+                jobserver_->release();
+            }
+        }
+
+        JobToken(const JobToken&) = delete;
+        JobToken& operator=(const JobToken&) = delete;
+
+        bool held() const noexcept
+        {
+            return held_;
+        }
+
+    private:
+        Jobserver* jobserver_;
+        bool held_;
+    };
+
+    /**
+    * @brief Read the dependencies a gcc-style command wrote to its depfile
+    * @param path The depfile
+    * @param error Receives a message if the depfile is missing or malformed
+    * @return The dependencies, or nullopt on error
+    */
+    std::optional<std::vector<std::string>> readDepfile(const std::string& path, std::string& error)
+    {
+        MappedFile file;
+        if (!file.open(path))
+        {
+            error = "mimir: depfile '" + path + "' was not written\n";
+            return std::nullopt;
+        }
+        auto deps = parseDepfile(file.view());
+        if (!deps)
+        {
+            error = "mimir: malformed depfile '" + path + "'\n";
+        }
+        return deps;
+    }
 }
 
-bool Executor::runCommand(const std::string& command) const
+CommandResult Executor::runCommand(const Target& target, const bool capture) const
 {
     if (config_.dryRun)
     {
-        return true;
+        return CommandResult{0, "", "", false};
+    }
+    CommandOptions options;
+    options.captureOutput = capture;
+    options.timeoutSeconds = config_.timeoutSeconds;
+    if (target.getDepsFormat() == DepsFormat::MSVC)
+    {
+        // Every include note is a dependency, so none may fall out of the capture window
+        options.maxCaptureBytes = std::numeric_limits<size_t>::max();
+    }
+    if (!childMakeflags_.empty())
+    {
+        // Clients' children already inherit the parent's MAKEFLAGS
+        options.environment.emplace_back("MAKEFLAGS", childMakeflags_);
+    }
+
+    // Headers a target has never reported can't be shipped, so its first build stays local
+    if (target.getRemote() && !depsUnknown(target))
+    {
+        options.hermetic = true;
+        options.inputs = target.getInputs();
+        if (const auto discovered = depsLog_ ? depsLog_->getDeps(target.getName()) : nullptr)
+        {
+            options.inputs.insert(options.inputs.end(), discovered->begin(), discovered->end());
+        }
+        options.outputs = target.getOutputs();
+        if (target.getDepsFormat() == DepsFormat::GCC)
+        {
+            options.outputs.push_back(target.getDepfile());
+        }
+    }
+
+    const bool offHost = options.hermetic && config_.remoteJobs > 0;
+    const JobToken token(offHost ? nullptr : jobserver_.get());
+    if (!token.held())
+    {
+        return CommandResult{-1, "", "mimir: jobserver shut down\n", false};
     }
-    return commandRunner_->runSimple(command);
+    return commandRunner_->run(target.getCommand(), options);
+}
+
+int Executor::workerCount() const noexcept
+{
+    return config_.numThreads + std::max(config_.remoteJobs, 0);
 }
 
 void Executor::printStatus(
     const std::string& status,
     const std::string& targetName,
-    const std::string& message) const
+    const std::string& message,
+    const std::string& output) const
 {
     std::lock_guard<std::mutex> lock(outputMutex_);
 
     const char* color = COLOR_RESET;
     if (config_.colorOutput)
     {
-        if (status == "SUCCESS" || status == "UP-TO-DATE")
+        if (status == "SUCCESS" || status == "UP-TO-DATE" || status == "RESTORED")
         {
             color = COLOR_GREEN;
         }
@@ -78,64 +285,196 @@ void Executor::printStatus(
         }
     }
 
+    std::string text;
     if (config_.colorOutput)
     {
-        std::cout << color;
+        text += color;
     }
     
-    std::cout << "[ " << status << " ] " << targetName;
+    text += "[ " + status + " ] " + targetName;
     
     if (!message.empty() && config_.verbose)
     {
-        std::cout << "\n  " << message;
+        text += "\n  " + message;
     }
     
-    std::cout << std::endl;
-    
     if (config_.colorOutput)
     {
-        std::cout << COLOR_RESET;
+        text += COLOR_RESET;
     }
-}
 
-bool Executor::executeTarget(const Target& target, Cache& cache) const
-{
-    if (cancelled_.load())
+    text += "\n";
+    if (!output.empty())
     {
-        return false;
+        text += output;
+        if (output.back() != '\n')
+        {
+            text += "\n";
+        }
+    }
+
+    if (outputSink_)
+    {
+        outputSink_(text);
+        return;
     }
+    std::cout << text;
+    std::cout.flush();
+}
 
-    // Check if outputs exist
-    bool outputsExist = true;
+bool Executor::outputsExist(const Target& target) const
+{
     for (const auto& output : target.getOutputs())
     {
         std::ifstream file(output);
         if (!file.good())
         {
-            outputsExist = false;
-            break;
+            return false;
         }
     }
+    return true;
+}
+
+Executor::TargetStatus Executor::processTarget(
+    const Target& target,
+    Cache& cache,
+    FileDigestTable& digests,
+    TraceEvent* event) const
+{
+    if (upToDateHint_ && upToDateHint_(target))
+    {
+        printStatus("UP-TO-DATE", target.getName());
+        return TargetStatus::UpToDate;
+    }
 
-    if (outputsExist && !isOutOfDate(target, cache))
+    const auto hashStart = std::chrono::steady_clock::now();
+    const std::string currentSig = computeSignature(target, cache, digests);
+    if (event != nullptr)
+    {
+        event->hashUs += std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - hashStart).count();
+    }
+    if (outputsExist(target) && !isOutOfDate(target, currentSig, cache))
     {
         printStatus("UP-TO-DATE", target.getName());
-        return true;
+        return TargetStatus::UpToDate;
+    }
+
+    // A restored target's headers are unknown here, so it has to run once
+    const bool shareOutputs = artifactStore_ && !config_.dryRun && target.hasOutputs();
+    if (shareOutputs && !depsUnknown(target) && artifactStore_->restore(currentSig, target.getOutputs()))
+    {
+        cache.setSignature(target.getName(), currentSig);
+        recordOutputSignature(target, currentSig, cache);
+        printStatus("RESTORED", target.getName());
+        return TargetStatus::Restored;
     }
 
     printStatus("BUILD", target.getName(), target.getCommand());
 
-    if (!runCommand(target.getCommand()))
+    if (event != nullptr)
     {
-        printStatus("FAILED", target.getName());
-        return false;
+        event->commandStartUs = trace_->elapsedUs();
+    }
+    const auto commandStart = std::chrono::steady_clock::now();
+    const bool showIncludes = target.getDepsFormat() == DepsFormat::MSVC;
+    const CommandResult result = runCommand(target, config_.bufferOutput || showIncludes);
+    const auto commandTime = std::chrono::steady_clock::now() - commandStart;
+    if (event != nullptr)
+    {
+        event->commandUs = std::chrono::duration_cast<std::chrono::microseconds>(commandTime).count();
+        event->spawnUs = static_cast<std::int64_t>(result.spawnSeconds * 1e6);
+        event->usage = result.usage;
+    }
+    std::vector<std::string> discovered;
+    std::string output;
+    if (showIncludes)
+    {
+        discovered = parseShowIncludes(result.stdOut, output);
+        output += result.stdErr;
+        if (result.droppedBytes > 0 && result.success())
+        {
+            // A shortened header list would let later builds miss header changes
+            printStatus("FAILED", target.getName(), "",
+                output + "[mimir: " + std::to_string(result.droppedBytes)
+                    + " bytes of output were discarded, so the reported headers are incomplete]\n");
+            return TargetStatus::Failed;
+        }
+    }
+    else
+    {
+        output = result.stdOut + result.stdErr;
+    }
+    if (result.timedOut)
+    {
+        if (!output.empty() && output.back() != '\n')
+        {
+            output += '\n';
+        }
+        output += "[mimir: command timed out after " + std::to_string(config_.timeoutSeconds.value_or(0)) + "s]\n";
+    }
+    if (!result.success())
+    {
+        printStatus("FAILED", target.getName(), "", output);
+        return TargetStatus::Failed;
+    }
+
+    if (target.getDepsFormat() != DepsFormat::None && !config_.dryRun)
+    {
+        if (target.getDepsFormat() == DepsFormat::GCC)
+        {
+            std::string error;
+            auto deps = readDepfile(target.getDepfile(), error);
+            if (!deps)
+            {
+                printStatus("FAILED", target.getName(), "", output + error);
+                return TargetStatus::Failed;
+            }
+            discovered = std::move(*deps);
+        }
+        if (depsLog_ && depsLog_->record(target.getName(), std::move(discovered))
+            && target.getDepsFormat() == DepsFormat::GCC)
+        {
+            // The log holds it now, as with ninja's deps = gcc
+            std::error_code ec;
+            std::filesystem::remove(target.getDepfile(), ec);
+        }
     }
 
-    const std::string newSig = Signature::computeTargetSignature(target.getCommand(), target.getInputs());
+    // Inputs are hashed once per build, so this reuses the digests computed above;
+    // newly discovered headers are hashed here for the first time
+    const auto rehashStart = std::chrono::steady_clock::now();
+    const std::string newSig = computeSignature(target, cache, digests);
+    if (event != nullptr)
+    {
+        event->hashUs += std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - rehashStart).count();
+    }
     cache.setSignature(target.getName(), newSig);
+    if (!config_.dryRun)
+    {
+        recordOutputSignature(target, newSig, cache);
+        cache.setDuration(target.getName(), static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(commandTime).count()));
+    }
+    if (shareOutputs)
+    {
+        artifactStore_->storeAsync(newSig, target.getOutputs());
+    }
 
-    printStatus("SUCCESS", target.getName());
-    return true;
+    printStatus("SUCCESS", target.getName(), "", output);
+    return TargetStatus::Built;
+}
+
+bool Executor::executeTarget(const Target& target, Cache& cache) const
+{
+    if (cancelled_.load())
+    {
+        return false;
+    }
+
+    FileDigestTable digests;
+    return processTarget(target, cache, digests) != TargetStatus::Failed;
 }
 
 bool Executor::executeSingleThreaded(
@@ -143,11 +482,14 @@ bool Executor::executeSingleThreaded(
     Cache& cache,
     BuildStats& stats) const
 {
-    const std::vector<std::string> order = dag.topologicalSort();
+    const CompiledGraph graph(dag);
+    const std::vector<NodeId> order = graph.topologicalOrder();
     stats.totalTargets = order.size();
+    FileDigestTable digests;
+    std::vector<std::int64_t> finishedUs(trace_ ? graph.nodeCount() : 0, 0);
 
     size_t current = 0;
-    for (const auto& targetName : order)
+    for (const NodeId node : order)
     {
         if (cancelled_.load())
         {
@@ -155,45 +497,50 @@ bool Executor::executeSingleThreaded(
         }
 
         ++current;
-        const Target* target = dag.getTarget(targetName);
-        
-        if (!target)
-        {
-            continue;
-        }
+        const Target* target = &graph.target(node);
+        const std::string& targetName = target->getName();
 
         if (progressCallback_)
         {
             progressCallback_(targetName, current, stats.totalTargets, "BUILDING");
         }
 
-        bool outputsExist = true;
-        for (const auto& output : target->getOutputs())
+        TraceEvent event;
+        if (trace_)
         {
-            std::ifstream file(output);
-            if (!file.good())
-            {
-                outputsExist = false;
-                break;
-            }
+            event = beginTrace(graph, node, 0, finishedUs);
         }
-
-        if (outputsExist && !isOutOfDate(*target, cache))
+        const TargetStatus status = processTarget(*target, cache, digests, trace_ ? &event : nullptr);
+        if (trace_)
+        {
+            endTrace(event, status, finishedUs, node);
+        }
+        if (status == TargetStatus::UpToDate)
         {
-            printStatus("UP-TO-DATE", target->getName());
             ++stats.skippedTargets;
             if (progressCallback_)
             {
                 progressCallback_(targetName, current, stats.totalTargets, "UP-TO-DATE");
             }
-            continue;
         }
-
-        printStatus("BUILD", target->getName(), target->getCommand());
-
-        if (!runCommand(target->getCommand()))
+        else if (status == TargetStatus::Built)
+        {
+            ++stats.builtTargets;
+            if (progressCallback_)
+            {
+                progressCallback_(targetName, current, stats.totalTargets, "SUCCESS");
+            }
+        }
+        else if (status == TargetStatus::Restored)
+        {
+            ++stats.restoredTargets;
+            if (progressCallback_)
+            {
+                progressCallback_(targetName, current, stats.totalTargets, "RESTORED");
+            }
+        }
+        else
         {
-            printStatus("FAILED", target->getName());
             ++stats.failedTargets;
             if (progressCallback_)
             {
@@ -203,223 +550,618 @@ bool Executor::executeSingleThreaded(
             {
                 return false;
             }
-            continue;
         }
+    }
 
-        const std::string newSig = Signature::computeTargetSignature(target->getCommand(), target->getInputs());
-        cache.setSignature(target->getName(), newSig);
+    return stats.failedTargets == 0;
+}
 
-        printStatus("SUCCESS", target->getName());
-        ++stats.builtTargets;
-        if (progressCallback_)
+namespace
+{
+    /// @brief Worker-owned deque: the owner pops newest-first, thieves take oldest-first
+    class WorkDeque
+    {
+    public:
+        void push(NodeId idx)
         {
-            progressCallback_(targetName, current, stats.totalTargets, "SUCCESS");
+            std::lock_guard<std::mutex> lock(mutex_);
+            items_.push_back(idx);
         }
-    }
 
-    return stats.failedTargets == 0;
+        bool pop(NodeId& idx)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (items_.empty())
+            {
+                return false;
+            }
+            idx = items_.back();
+            items_.pop_back();
+            return true;
+        }
+
+        bool steal(NodeId& idx)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (items_.empty())
+            {
+                return false;
+            }
+            idx = items_.front();
+            items_.pop_front();
+            return true;
+        }
+
+    private:
+        std::mutex mutex_;
+        std::deque<NodeId> items_;
+    };
+
+    /// @brief Holds one load governor slot for the rest of a worker loop iteration
+    class SlotLease
+    {
+    public:
+        explicit SlotLease(LoadGovernor* governor)
+            : governor_(governor)
+            , held_(governor == nullptr || governor->acquire())
+        {
+        }
+
+        ~SlotLease()
+        {
+            release();
+        }
+
+        void release()
+        {
+            if (governor_ != nullptr && held_)
+            {
+                governor_->release();
+            }
+            held_ = false;
+        }
+
+        SlotLease(const SlotLease&) = delete;
+        SlotLease& operator=(const SlotLease&) = delete;
+
+        bool held() const noexcept
+        {
+            return held_;
+        }
+
+    private:
+        LoadGovernor* governor_;
+        bool held_;
+    };
 }
 
-bool Executor::executeMultiThreaded(
-    const DAG& dag,
-    Cache& cache,
-    BuildStats& stats) const
+struct Executor::ScheduleState
 {
-    const std::vector<std::string> order = dag.topologicalSort();
-    stats.totalTargets = order.size();
+    /// @brief Admission state of one resource pool
+    struct PoolState
+    {
+        std::uint32_t capacity = 0;
+        std::uint32_t inUse = 0;
+        std::vector<NodeId> waiting;        ///< Ready targets parked until capacity frees up
+    };
 
-    std::mutex mtx;
-    std::condition_variable cv;
-    std::unordered_map<std::string, bool> completed;
-    std::unordered_map<std::string, bool> inProgress;
-    std::atomic<bool> failed{false};
-    std::atomic<size_t> processedCount{0};
+    const CompiledGraph& graph;
+    size_t total;
+    std::unique_ptr<std::atomic<std::uint32_t>[]> pending;
+    std::vector<std::uint64_t> priority;    ///< Critical path in expected microseconds
+    std::vector<NodeId> roots;              ///< Highest priority first
+    std::vector<std::int32_t> poolOf;       ///< Index into pools, or -1 for none
+    std::vector<PoolState> pools;
+    std::mutex poolMutex;                   ///< Guards every PoolState
+    std::unique_ptr<LoadGovernor> governor; ///< Null unless ExecutorConfig::loadLimits is set
+    std::atomic<size_t> processed{0};
+    std::atomic<size_t> built{0};
+    std::atomic<size_t> skipped{0};
+    std::atomic<size_t> failed{0};
+    std::atomic<size_t> restored{0};
+    FileDigestTable digests;
+    std::vector<std::int64_t> finishedUs;   ///< Per node when tracing; published with the pending counters
 
-    for (const auto& name : order)
+    ScheduleState(const CompiledGraph& compiled, const Cache& cache, const PoolCapacities& capacities,
+        const std::uint32_t localCapacity)
+        : graph(compiled)
+        , total(compiled.topologicalOrder().size())
+        , pending(new std::atomic<std::uint32_t>[compiled.nodeCount()])
+        , poolOf(compiled.nodeCount(), -1)
     {
-        completed[name] = false;
-        inProgress[name] = false;
+        std::unordered_map<std::string, std::int32_t> poolIndex;
+        std::int32_t localPool = -1;
+        for (NodeId node = 0; node < graph.nodeCount(); ++node)
+        {
+            const std::string& pool = graph.target(node).getPool();
+            auto capacity = capacities.find(pool);
+            if (pool.empty() || capacity == capacities.end())
+            {
+                // Keeps local commands to the host's slots while remote workers fill the rest
+                if (localCapacity > 0 && !graph.target(node).getRemote())
+                {
+                    if (localPool < 0)
+                    {
+                        localPool = static_cast<std::int32_t>(pools.size());
+                        pools.emplace_back();
+                        pools.back().capacity = localCapacity;
+                    }
+                    poolOf[node] = localPool;
+                }
+                continue;
+            }
+            auto [it, inserted] = poolIndex.emplace(pool, static_cast<std::int32_t>(pools.size()));
+            if (inserted)
+            {
+                pools.emplace_back();
+                pools.back().capacity = std::max<std::uint32_t>(capacity->second, 1);
+            }
+            poolOf[node] = it->second;
+        }
+
+        // Targets that never ran are assumed to take as long as the average one
+        // that did; with no history at all every target weighs the same and the
+        // priority degenerates to the length of the longest chain below it
+        std::vector<std::optional<std::uint64_t>> recorded(graph.nodeCount());
+        std::uint64_t recordedTotal = 0;
+        size_t recordedCount = 0;
+        for (NodeId node = 0; node < graph.nodeCount(); ++node)
+        {
+            recorded[node] = cache.findDuration(graph.target(node).getName());
+            if (recorded[node])
+            {
+                recordedTotal += *recorded[node];
+                ++recordedCount;
+            }
+        }
+        const std::uint64_t fallback = recordedCount > 0 ? recordedTotal / recordedCount : 1;
+
+        std::vector<std::uint64_t> weights(graph.nodeCount());
+        for (NodeId node = 0; node < graph.nodeCount(); ++node)
+        {
+            // Never zero, so a chain of instant targets still outranks a single one
+            weights[node] = std::max<std::uint64_t>(recorded[node].value_or(fallback), 1);
+        }
+        priority = graph.criticalPaths(weights);
+
+        for (NodeId node = 0; node < graph.nodeCount(); ++node)
+        {
+            const std::uint32_t degree = graph.inDegree(node);
+            pending[node].store(degree, std::memory_order_relaxed);
+            if (degree == 0)
+            {
+                roots.push_back(node);
+            }
+        }
+        std::stable_sort(roots.begin(), roots.end(), [this](NodeId a, NodeId b)
+        {
+            return priority[a] > priority[b];
+        });
+    }
+
+    /// True if a should be started before b; ties go to the earlier-declared target
+    bool runsBefore(NodeId a, NodeId b) const noexcept
+    {
+        return priority[a] != priority[b] ? priority[a] > priority[b] : a < b;
+    }
+
+    /// Capacity a node takes from its pool; clamped so a heavy target can still run alone
+    std::uint32_t weightOf(NodeId node) const noexcept
+    {
+        return std::min(std::max<std::uint32_t>(graph.target(node).getWeight(), 1),
+                        pools[static_cast<size_t>(poolOf[node])].capacity);
+    }
+
+    /**
+    * @brief Claim a ready node's share of its pool
+    * @return True if the node may run now; false if it was parked in the pool
+    */
+    bool admit(NodeId node)
+    {
+        if (poolOf[node] < 0)
+        {
+            return true;
+        }
+        std::lock_guard<std::mutex> lock(poolMutex);
+        PoolState& pool = pools[static_cast<size_t>(poolOf[node])];
+        const std::uint32_t weight = weightOf(node);
+        if (pool.inUse + weight <= pool.capacity)
+        {
+            pool.inUse += weight;
+            return true;
+        }
+        // Someone holds the capacity this node needs, so its release() requeues it
+        pool.waiting.push_back(node);
+        return false;
     }
 
-    auto canExecute = [&](const Target& target) -> bool
+    /**
+    * @brief Return a finished node's share and hand back parked nodes that now fit
+    * @param node The finished node
+    * @param requeued Receives the parked nodes to schedule again, most critical first
+    */
+    void release(NodeId node, std::vector<NodeId>& requeued)
     {
-        for (const auto& dep : target.getDependencies())
+        if (poolOf[node] < 0)
+        {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(poolMutex);
+        PoolState& pool = pools[static_cast<size_t>(poolOf[node])];
+        pool.inUse -= weightOf(node);
+
+        std::sort(pool.waiting.begin(), pool.waiting.end(), [this](NodeId a, NodeId b)
         {
-            if (!completed[dep])
+            return runsBefore(a, b);
+        });
+        std::uint32_t available = pool.capacity - pool.inUse;
+        auto keep = pool.waiting.begin();
+        for (auto it = pool.waiting.begin(); it != pool.waiting.end(); ++it)
+        {
+            const std::uint32_t weight = weightOf(*it);
+            if (weight <= available)
             {
-                return false;
+                available -= weight;
+                requeued.push_back(*it);
+            }
+            else
+            {
+                *keep++ = *it;
             }
         }
-        return !inProgress[target.getName()];
-    };
+        pool.waiting.erase(keep, pool.waiting.end());
+    }
+};
+
+bool Executor::shouldStop(const ScheduleState& state) const
+{
+    return cancelled_.load() || (config_.stopOnError && state.failed.load() > 0);
+}
 
-    auto worker = [&]()
+Executor::TargetStatus Executor::runScheduled(
+    ScheduleState& state,
+    Cache& cache,
+    NodeId idx,
+    const size_t worker,
+    std::vector<NodeId>& unblocked) const
+{
+    const Target& target = state.graph.target(idx);
+    const size_t current = ++state.processed;
+    if (progressCallback_)
+    {
+        progressCallback_(target.getName(), current, state.total, "BUILDING");
+    }
+
+    TraceEvent event;
+    if (trace_)
+    {
+        event = beginTrace(state.graph, idx, worker, state.finishedUs);
+    }
+    const TargetStatus status = processTarget(target, cache, state.digests, trace_ ? &event : nullptr);
+    if (trace_)
+    {
+        endTrace(event, status, state.finishedUs, idx);
+    }
+    unblocked.clear();
+    state.release(idx, unblocked);
+    const char* outcome = "FAILED";
+    switch (status)
+    {
+        case TargetStatus::UpToDate:
+            ++state.skipped;
+            outcome = "UP-TO-DATE";
+            break;
+        case TargetStatus::Built:
+            ++state.built;
+            outcome = "SUCCESS";
+            break;
+        case TargetStatus::Restored:
+            ++state.restored;
+            outcome = "RESTORED";
+            break;
+        case TargetStatus::Failed:
+            ++state.failed;
+            break;
+    }
+    if (progressCallback_)
     {
+        progressCallback_(target.getName(), current, state.total, outcome);
+    }
+
+    // Only the worker that drops a counter to zero gets to schedule that dependent
+    for (const NodeId dependent : state.graph.dependents(idx))
+    {
+        if (state.pending[dependent].fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            unblocked.push_back(dependent);
+        }
+    }
+    return status;
+}
+
+void Executor::runSharedQueue(ScheduleState& state, Cache& cache) const
+{
+    std::mutex mtx;
+    std::condition_variable cv;
+    // Max-heap on critical path: whenever a worker frees up it starts the ready
+    // target with the most (expected) work still hanging off it
+    const auto lowerPriority = [&state](NodeId a, NodeId b) { return state.runsBefore(b, a); };
+    std::priority_queue<NodeId, std::vector<NodeId>, decltype(lowerPriority)> ready(
+        lowerPriority, std::vector<NodeId>(state.roots.begin(), state.roots.end()));
+    size_t remaining = state.total;
+    bool stopping = false;
+
+    auto worker = [&](size_t self)
+    {
+        std::vector<NodeId> unblocked;
         while (true)
         {
-            if (cancelled_.load())
+            const SlotLease slot(state.governor.get());
+            if (!slot.held())
             {
                 return;
             }
 
-            std::string targetName;
+            NodeId idx;
             {
                 std::unique_lock<std::mutex> lock(mtx);
                 cv.wait(lock, [&]()
                 {
-                    if (failed.load() && config_.stopOnError)
-                    {
-                        return true;
-                    }
-                    if (cancelled_.load())
-                    {
-                        return true;
-                    }
+                    return stopping || remaining == 0 || !ready.empty();
+                });
+                if (stopping || ready.empty())
+                {
+                    return;
+                }
+                idx = ready.top();
+                ready.pop();
+            }
 
-                    bool allDone = true;
-                    for (const auto& [name, done] : completed)
-                    {
-                        if (!done)
-                        {
-                            allDone = false;
-                            break;
-                        }
-                    }
-                    if (allDone)
-                    {
-                        return true;
-                    }
+            if (!state.admit(idx))
+            {
+                continue;
+            }
 
-                    for (const auto& name : order)
-                    {
-                        const Target* t = dag.getTarget(name);
-                        if (t && !completed[name] && canExecute(*t))
-                        {
-                            return true;
-                        }
-                    }
-                    return false;
-                });
+            runScheduled(state, cache, idx, self, unblocked);
 
-                if (cancelled_.load() || (failed.load() && config_.stopOnError))
+            bool wakeAll = false;
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                --remaining;
+                stopping = stopping || shouldStop(state);
+                for (const NodeId dependent : unblocked)
                 {
-                    return;
+                    ready.push(dependent);
                 }
+                wakeAll = stopping || remaining == 0;
+            }
 
-                bool allDone = true;
-                for (const auto& [name, done] : completed)
+            if (wakeAll)
+            {
+                if (state.governor)
                 {
-                    if (!done)
-                    {
-                        allDone = false;
-                        break;
-                    }
+                    state.governor->shutdown();
                 }
-                if (allDone)
+                cv.notify_all();
+            }
+            else
+            {
+                // This worker picks up one of the unblocked targets itself
+                for (size_t i = 1; i < unblocked.size(); ++i)
                 {
-                    return;
+                    cv.notify_one();
                 }
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(static_cast<size_t>(workerCount()));
+    for (int i = 0; i < workerCount(); ++i)
+    {
+        threads.emplace_back(worker, static_cast<size_t>(i));
+    }
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+}
+
+void Executor::runWorkStealing(ScheduleState& state, Cache& cache) const
+{
+    const size_t numWorkers = static_cast<size_t>(workerCount());
+    std::vector<WorkDeque> deques(numWorkers);
+    std::atomic<size_t> queued{state.roots.size()};
+    std::atomic<size_t> remaining{state.total};
+    std::atomic<size_t> idle{0};
+    std::atomic<bool> stopping{false};
+    std::mutex parkMutex;
+    std::condition_variable parkCv;
+
+    // Owners pop newest-first, so push each worker's share lowest priority first
+    for (size_t i = state.roots.size(); i-- > 0;)
+    {
+        deques[i % numWorkers].push(state.roots[i]);
+    }
+
+    auto wakeAll = [&]()
+    {
+        {
+            std::lock_guard<std::mutex> lock(parkMutex);
+            stopping.store(true);
+        }
+        if (state.governor)
+        {
+            state.governor->shutdown();
+        }
+        parkCv.notify_all();
+    };
+
+    auto findWork = [&](size_t self, NodeId& idx) -> bool
+    {
+        if (deques[self].pop(idx))
+        {
+            queued.fetch_sub(1);
+            return true;
+        }
+        for (size_t k = 1; k < numWorkers; ++k)
+        {
+            if (deques[(self + k) % numWorkers].steal(idx))
+            {
+                queued.fetch_sub(1);
+                return true;
+            }
+        }
+        return false;
+    };
 
-                for (const auto& name : order)
+    auto worker = [&](size_t self)
+    {
+        std::vector<NodeId> unblocked;
+        bool haveNext = false;
+        NodeId next = 0;
+        while (true)
+        {
+            // Taken before looking for work, so when the limit shrinks the
+            // surplus workers wait here instead of draining the deques
+            SlotLease slot(state.governor.get());
+            if (!slot.held())
+            {
+                return;
+            }
+
+            NodeId idx;
+            if (haveNext)
+            {
+                idx = next;
+                haveNext = false;
+            }
+            else if (!findWork(self, idx))
+            {
+                // An idle worker must not sit on a slot another worker's kept
+                // target is waiting for
+                slot.release();
+                std::unique_lock<std::mutex> lock(parkMutex);
+                ++idle;
+                parkCv.wait(lock, [&]()
                 {
-                    const Target* t = dag.getTarget(name);
-                    if (t && !completed[name] && canExecute(*t))
-                    {
-                        targetName = name;
-                        inProgress[name] = true;
-                        break;
-                    }
+                    return stopping.load() || queued.load() > 0;
+                });
+                --idle;
+                if (stopping.load())
+                {
+                    return;
                 }
+                continue;
             }
 
-            if (!targetName.empty())
+            if (!state.admit(idx))
             {
-                const Target* target = dag.getTarget(targetName);
-                if (target)
-                {
-                    size_t current = ++processedCount;
-                    if (progressCallback_)
-                    {
-                        progressCallback_(targetName, current, stats.totalTargets, "BUILDING");
-                    }
+                continue;
+            }
 
-                    bool success = false;
-                    
-                    // Check if up-to-date
-                    bool outputsExist = true;
-                    for (const auto& output : target->getOutputs())
-                    {
-                        std::ifstream file(output);
-                        if (!file.good())
-                        {
-                            outputsExist = false;
-                            break;
-                        }
-                    }
+            runScheduled(state, cache, idx, self, unblocked);
 
-                    if (outputsExist && !isOutOfDate(*target, cache))
-                    {
-                        printStatus("UP-TO-DATE", target->getName());
-                        success = true;
-                        {
-                            std::lock_guard<std::mutex> statsLock(mtx);
-                            ++stats.skippedTargets;
-                        }
-                    }
-                    else
-                    {
-                        printStatus("BUILD", target->getName(), target->getCommand());
-                        
-                        if (runCommand(target->getCommand()))
-                        {
-                            const std::string newSig = Signature::computeTargetSignature(
-                                target->getCommand(), target->getInputs());
-                            cache.setSignature(target->getName(), newSig);
-                            printStatus("SUCCESS", target->getName());
-                            success = true;
-                            {
-                                std::lock_guard<std::mutex> statsLock(mtx);
-                                ++stats.builtTargets;
-                            }
-                        }
-                        else
-                        {
-                            printStatus("FAILED", target->getName());
-                            {
-                                std::lock_guard<std::mutex> statsLock(mtx);
-                                ++stats.failedTargets;
-                            }
-                        }
-                    }
+            if (remaining.fetch_sub(1) == 1 || shouldStop(state))
+            {
+                wakeAll();
+                return;
+            }
 
-                    {
-                        std::unique_lock<std::mutex> lock(mtx);
-                        inProgress[targetName] = false;
-                        completed[targetName] = true;
-                        if (!success)
-                        {
-                            failed.store(true);
-                        }
-                    }
-                    cv.notify_all();
+            if (unblocked.empty())
+            {
+                continue;
+            }
+
+            // Keep the most critical dependent hot on this core and leave the
+            // rest for thieves, pushed so the owner's next pop is the runner-up
+            std::sort(unblocked.begin(), unblocked.end(), [&state](NodeId a, NodeId b)
+            {
+                return state.runsBefore(b, a);
+            });
+            next = unblocked.back();
+            haveNext = true;
+            const size_t extra = unblocked.size() - 1;
+            if (extra == 0)
+            {
+                continue;
+            }
+            for (size_t i = 0; i < extra; ++i)
+            {
+                deques[self].push(unblocked[i]);
+            }
+            queued.fetch_add(extra);
+
+            if (idle.load() > 0)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(parkMutex);
+                }
+                for (size_t i = 0; i < extra; ++i)
+                {
+                    parkCv.notify_one();
                 }
             }
         }
     };
 
+    if (state.total == 0)
+    {
+        return;
+    }
+
     std::vector<std::thread> threads;
-    threads.reserve(config_.numThreads);
-    for (int i = 0; i < config_.numThreads; ++i)
+    threads.reserve(numWorkers);
+    for (size_t i = 0; i < numWorkers; ++i)
     {
-        threads.emplace_back(worker);
+        threads.emplace_back(worker, i);
     }
 
     for (auto& thread : threads)
     {
         thread.join();
     }
+}
 
-    return !failed.load();
+bool Executor::executeMultiThreaded(
+    const DAG& dag,
+    Cache& cache,
+    BuildStats& stats) const
+{
+    const CompiledGraph graph(dag);
+    const auto localCapacity = static_cast<std::uint32_t>(config_.remoteJobs > 0 ? config_.numThreads : 0);
+    ScheduleState state(graph, cache, config_.pools, localCapacity);
+    stats.totalTargets = state.total;
+    if (trace_)
+    {
+        state.finishedUs.assign(graph.nodeCount(), 0);
+    }
+    if (config_.loadLimits.enabled())
+    {
+        state.governor = std::make_unique<LoadGovernor>(
+            static_cast<size_t>(workerCount()), config_.loadLimits, loadProbe_);
+    }
+
+    if (config_.scheduler == SchedulerType::WorkStealing)
+    {
+        runWorkStealing(state, cache);
+    }
+    else
+    {
+        runSharedQueue(state, cache);
+    }
+
+    stats.builtTargets += state.built.load();
+    stats.skippedTargets += state.skipped.load();
+    stats.failedTargets += state.failed.load();
+    stats.restoredTargets += state.restored.load();
+    if (state.governor)
+    {
+        stats.lowestJobSlots = state.governor->lowestLimit();
+    }
+
+    return state.failed.load() == 0 && !cancelled_.load();
 }
 
 bool Executor::execute(const DAG& dag, Cache& cache) const
@@ -431,9 +1173,13 @@ bool Executor::execute(const DAG& dag, Cache& cache) const
 bool Executor::executeWithStats(const DAG& dag, Cache& cache, BuildStats& stats) const
 {
     auto startTime = std::chrono::steady_clock::now();
+    if (trace_)
+    {
+        trace_->start();
+    }
 
     bool success;
-    if (config_.numThreads <= 1)
+    if (workerCount() <= 1)
     {
         success = executeSingleThreaded(dag, cache, stats);
     }
@@ -442,17 +1188,110 @@ bool Executor::executeWithStats(const DAG& dag, Cache& cache, BuildStats& stats)
         success = executeMultiThreaded(dag, cache, stats);
     }
 
+    if (artifactStore_)
+    {
+        artifactStore_->waitForUploads();
+    }
+
     auto endTime = std::chrono::steady_clock::now();
     stats.elapsedSeconds = std::chrono::duration<double>(endTime - startTime).count();
 
     return success;
 }
 
+bool Executor::executeWithStats(
+    const DAG& dag,
+    const std::vector<std::string>& goals,
+    Cache& cache,
+    BuildStats& stats) const
+{
+    if (goals.empty())
+    {
+        return executeWithStats(dag, cache, stats);
+    }
+
+    bool known = true;
+    for (const auto& goal : goals)
+    {
+        if (!dag.hasTarget(goal))
+        {
+            printStatus("FAILED", goal, "", "No such target");
+            known = false;
+        }
+    }
+    if (!known)
+    {
+        return false;
+    }
+    return executeWithStats(dag.closure(goals), cache, stats);
+}
+
 void Executor::setProgressCallback(ProgressCallback callback)
 {
     progressCallback_ = std::move(callback);
 }
 
+void Executor::setOutputSink(OutputSink sink)
+{
+    outputSink_ = std::move(sink);
+}
+
+void Executor::setUpToDateHint(UpToDateHint hint)
+{
+    upToDateHint_ = std::move(hint);
+}
+
+void Executor::setArtifactStore(std::shared_ptr<ArtifactStore> store)
+{
+    artifactStore_ = std::move(store);
+}
+
+const std::shared_ptr<ArtifactStore>& Executor::getArtifactStore() const noexcept
+{
+    return artifactStore_;
+}
+
+void Executor::setDepsLog(std::shared_ptr<DepsLog> log)
+{
+    depsLog_ = std::move(log);
+}
+
+const std::shared_ptr<DepsLog>& Executor::getDepsLog() const noexcept
+{
+    return depsLog_;
+}
+
+void Executor::setBuildTrace(std::shared_ptr<BuildTrace> trace)
+{
+    trace_ = std::move(trace);
+}
+
+const std::shared_ptr<BuildTrace>& Executor::getBuildTrace() const noexcept
+{
+    return trace_;
+}
+
+void Executor::setLoadProbe(LoadProbePtr probe)
+{
+    loadProbe_ = std::move(probe);
+}
+
+void Executor::setJobserver(JobserverPtr jobserver)
+{
+    jobserver_ = std::move(jobserver);
+    childMakeflags_.clear();
+    if (jobserver_ && jobserver_->isServer())
+    {
+        // Keep the caller's flags; make honours the last -j and --jobserver-auth.
+        // Variable overrides follow a " -- ", so the flags must go in front of it
+        const char* inherited = std::getenv("MAKEFLAGS");
+        std::string flags = " " + std::string(inherited != nullptr ? inherited : "");
+        const size_t overrides = flags.find(" -- ");
+        flags.insert(overrides == std::string::npos ? flags.size() : overrides, jobserver_->makeflags());
+        childMakeflags_ = flags.substr(1);
+    }
+}
+
 const ExecutorConfig& Executor::getConfig() const noexcept
 {
     return config_;
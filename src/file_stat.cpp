@@ -0,0 +1,49 @@
+#include "mimir/file_stat.h"
+#include <chrono>
+#include <sys/stat.h>
+
+using namespace mimir;
+
+namespace
+{
+    FileStamp toStamp(const struct stat& st)
+    {
+        FileStamp stamp;
+        stamp.size = static_cast<std::uint64_t>(st.st_size);
+        stamp.inode = static_cast<std::uint64_t>(st.st_ino);
+#if defined(__APPLE__)
+        stamp.mtimeNs = static_cast<std::int64_t>(st.st_mtimespec.tv_sec) * 1000000000 + st.st_mtimespec.tv_nsec;
+#elif defined(_WIN32)
+        stamp.mtimeNs = static_cast<std::int64_t>(st.st_mtime) * 1000000000;
+#else
+        stamp.mtimeNs = static_cast<std::int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+        return stamp;
+    }
+}
+
+std::optional<FileStamp> mimir::statFile(const std::string& path)
+{
+    struct stat st{};
+    if (::stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+    {
+        return std::nullopt;
+    }
+    return toStamp(st);
+}
+
+std::optional<FileStamp> mimir::statDirectory(const std::string& path)
+{
+    struct stat st{};
+    if (::stat(path.c_str(), &st) != 0 || !S_ISDIR(st.st_mode))
+    {
+        return std::nullopt;
+    }
+    return toStamp(st);
+}
+
+std::int64_t mimir::currentTimeNs() noexcept
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
@@ -0,0 +1,226 @@
+#include "mimir/file_watcher.h"
+#include <filesystem>
+
+#ifdef __linux__
+#include <cerrno>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+using namespace mimir;
+
+#ifdef __linux__
+namespace
+{
+    // Renames cover editors that save via a temporary file; IN_ATTRIB covers touch
+    constexpr std::uint32_t WATCH_MASK = IN_CLOSE_WRITE | IN_MODIFY | IN_ATTRIB | IN_CREATE
+        | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF;
+
+    /// Events that change which names a directory holds
+    constexpr std::uint32_t ENTRY_MASK = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO;
+}
+#endif
+
+FileWatcher::FileWatcher()
+{
+#ifdef __linux__
+    fd_ = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+}
+
+FileWatcher::~FileWatcher()
+{
+#ifdef __linux__
+    if (fd_ >= 0)
+    {
+        ::close(fd_);
+    }
+#endif
+}
+
+bool FileWatcher::available() const noexcept
+{
+    return fd_ >= 0;
+}
+
+std::string FileWatcher::normalize(const std::string& path)
+{
+    std::error_code ec;
+    const fs::path absolute = fs::absolute(path, ec);
+    std::string normal = (ec ? fs::path(path) : absolute).lexically_normal().string();
+    // "dir/." normalizes to "dir/"; drop the separator so it matches the parent paths of files
+    if (normal.size() > 1 && normal.back() == '/')
+    {
+        normal.pop_back();
+    }
+    return normal;
+}
+
+bool FileWatcher::watch(const std::string& path)
+{
+#ifdef __linux__
+    if (fd_ < 0)
+    {
+        return false;
+    }
+    const std::string file = normalize(path);
+    if (!addDirectory(fs::path(file).parent_path().string()))
+    {
+        return false;
+    }
+    files_.insert(file);
+    return true;
+#else
+    (void)path;
+    return false;
+#endif
+}
+
+bool FileWatcher::watchDirectory(const std::string& path)
+{
+#ifdef __linux__
+    if (fd_ < 0)
+    {
+        return false;
+    }
+    const std::string directory = normalize(path);
+    if (!addDirectory(directory))
+    {
+        return false;
+    }
+    listings_.insert(directory);
+    return true;
+#else
+    (void)path;
+    return false;
+#endif
+}
+
+bool FileWatcher::addDirectory(const std::string& directory)
+{
+#ifdef __linux__
+    if (directoryWatches_.find(directory) != directoryWatches_.end())
+    {
+        return true;
+    }
+    const int wd = ::inotify_add_watch(fd_, directory.c_str(), WATCH_MASK | IN_ONLYDIR);
+    if (wd < 0)
+    {
+        return false;
+    }
+    directories_[wd] = directory;
+    directoryWatches_[directory] = wd;
+    return true;
+#else
+    (void)directory;
+    return false;
+#endif
+}
+
+void FileWatcher::clear()
+{
+#ifdef __linux__
+    for (const auto& [wd, directory] : directories_)
+    {
+        ::inotify_rm_watch(fd_, wd);
+    }
+    // Discard the IN_IGNORED events those removals queued, so a reused watch
+    // descriptor never receives them
+    if (fd_ >= 0)
+    {
+        alignas(inotify_event) char buffer[4096];
+        while (::read(fd_, buffer, sizeof(buffer)) > 0)
+        {
+        }
+    }
+#endif
+    directories_.clear();
+    directoryWatches_.clear();
+    files_.clear();
+    listings_.clear();
+}
+
+std::vector<std::string> FileWatcher::poll(const int timeoutMs)
+{
+    std::vector<std::string> changed;
+#ifdef __linux__
+    if (fd_ < 0)
+    {
+        return changed;
+    }
+    if (timeoutMs != 0)
+    {
+        pollfd pfd{fd_, POLLIN, 0};
+        if (::poll(&pfd, 1, timeoutMs) <= 0)
+        {
+            return changed;
+        }
+    }
+
+    std::unordered_set<std::string> seen;
+    alignas(inotify_event) char buffer[16 * 1024];
+    while (true)
+    {
+        const ssize_t length = ::read(fd_, buffer, sizeof(buffer));
+        if (length <= 0)
+        {
+            break;
+        }
+        for (ssize_t offset = 0; offset < length;)
+        {
+            const auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+
+            if ((event->mask & IN_Q_OVERFLOW) != 0)
+            {
+                overflow_ = true;
+                continue;
+            }
+            const auto dir = directories_.find(event->wd);
+            if (dir == directories_.end())
+            {
+                continue;
+            }
+            if ((event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) != 0)
+            {
+                // The directory itself is gone; its files can no longer be tracked
+                overflow_ = true;
+                directoryWatches_.erase(dir->second);
+                directories_.erase(dir);
+                continue;
+            }
+            if (event->len == 0)
+            {
+                continue;
+            }
+            if ((event->mask & ENTRY_MASK) != 0 && listings_.count(dir->second) != 0
+                && seen.insert(dir->second).second)
+            {
+                changed.push_back(dir->second);
+            }
+            std::string file = (fs::path(dir->second) / event->name).string();
+            if (files_.count(file) != 0 && seen.insert(file).second)
+            {
+                changed.push_back(std::move(file));
+            }
+        }
+    }
+#else
+    (void)timeoutMs;
+#endif
+    return changed;
+}
+
+bool FileWatcher::takeOverflow() noexcept
+{
+    const bool overflow = overflow_;
+    overflow_ = false;
+    return overflow;
+}
+
+int FileWatcher::fd() const noexcept
+{
+    return fd_;
+}
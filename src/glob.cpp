@@ -0,0 +1,441 @@
+#include "mimir/glob.h"
+#include <algorithm>
+#include <condition_variable>
+#include <filesystem>
+#include <functional>
+
+namespace fs = std::filesystem;
+using namespace mimir;
+
+namespace
+{
+    /**
+    * @brief Check a segment for wildcard characters
+    * @param segment Path segment
+    * @return True if it contains `*`, `?` or `[`
+    */
+    bool hasWildcards(std::string_view segment) noexcept
+    {
+        return segment.find_first_of("*?[") != std::string_view::npos;
+    }
+
+    /**
+    * @brief Check for a hidden file or directory
+    * @param name File name
+    * @return True if it starts with '.', which only an explicit '.' in a pattern matches
+    */
+    bool isHidden(std::string_view name) noexcept
+    {
+        return !name.empty() && name.front() == '.';
+    }
+
+    /**
+    * @brief Match one character against a `[...]` set
+    * @param glob Segment containing the set
+    * @param pos Position of the opening '['; moved past the closing ']' on success
+    * @param c The character to test
+    * @param matched Set to whether c is in the set
+    * @return False if the set is not terminated (the '[' is then literal)
+    */
+    bool matchSet(std::string_view glob, size_t& pos, const char c, bool& matched) noexcept
+    {
+        size_t i = pos + 1;
+        const bool negated = i < glob.size() && (glob[i] == '!' || glob[i] == '^');
+        if (negated)
+        {
+            ++i;
+        }
+        bool found = false;
+        const size_t first = i;
+        while (i < glob.size() && (glob[i] != ']' || i == first))
+        {
+            const char low = glob[i];
+            if (i + 2 < glob.size() && glob[i + 1] == '-' && glob[i + 2] != ']')
+            {
+                found = found || (low <= c && c <= glob[i + 2]);
+                i += 3;
+            }
+            else
+            {
+                found = found || low == c;
+                ++i;
+            }
+        }
+        if (i >= glob.size())
+        {
+            return false;
+        }
+        pos = i + 1;
+        matched = found != negated;
+        return true;
+    }
+
+    /// @brief Counts outstanding tasks so a caller can wait for a whole tree \class Countdown
+    class Countdown
+    {
+    public:
+        void add()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            ++pending_;
+        }
+
+        void done()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (--pending_ == 0)
+            {
+                cv_.notify_all();
+            }
+        }
+
+        void wait()
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this]() { return pending_ == 0; });
+        }
+
+    private:
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        size_t pending_ = 0;
+    };
+}
+
+GlobPattern::GlobPattern(std::string_view pattern)
+{
+    size_t start = 0;
+    bool wild = false;
+    while (start <= pattern.size())
+    {
+        size_t end = pattern.find('/', start);
+        if (end == std::string_view::npos)
+        {
+            end = pattern.size();
+        }
+        const std::string_view segment = pattern.substr(start, end - start);
+        if (!wild && hasWildcards(segment))
+        {
+            wild = true;
+            base_ = std::string(pattern.substr(0, start));
+        }
+        if (wild && !segment.empty())
+        {
+            Segment compiled;
+            compiled.text = std::string(segment);
+            compiled.recursive = segment == "**";
+            compiled.literal = !hasWildcards(segment);
+            recursive_ = recursive_ || compiled.recursive;
+            segments_.push_back(std::move(compiled));
+        }
+        start = end + 1;
+    }
+    if (!wild)
+    {
+        base_ = std::string(pattern);
+    }
+}
+
+bool GlobPattern::isLiteral() const noexcept
+{
+    return segments_.empty();
+}
+
+bool GlobPattern::isRecursive() const noexcept
+{
+    return recursive_;
+}
+
+const std::string& GlobPattern::base() const noexcept
+{
+    return base_;
+}
+
+const std::vector<GlobPattern::Segment>& GlobPattern::segments() const noexcept
+{
+    return segments_;
+}
+
+bool GlobPattern::matchSegment(std::string_view glob, std::string_view name) noexcept
+{
+    if (isHidden(name) && !isHidden(glob))
+    {
+        return false;
+    }
+
+    // Greedy match that backtracks to the last '*' on a mismatch
+    size_t g = 0;
+    size_t n = 0;
+    size_t starGlob = std::string_view::npos;
+    size_t starName = 0;
+    while (n < name.size())
+    {
+        if (g < glob.size())
+        {
+            const char c = glob[g];
+            if (c == '*')
+            {
+                starGlob = ++g;
+                starName = n;
+                continue;
+            }
+            if (c == '?')
+            {
+                ++g;
+                ++n;
+                continue;
+            }
+            bool matched = false;
+            size_t next = g;
+            if (c == '[' && matchSet(glob, next, name[n], matched))
+            {
+                if (matched)
+                {
+                    g = next;
+                    ++n;
+                    continue;
+                }
+            }
+            else if (c == name[n])
+            {
+                ++g;
+                ++n;
+                continue;
+            }
+        }
+        if (starGlob == std::string_view::npos)
+        {
+            return false;
+        }
+        g = starGlob;
+        n = ++starName;
+    }
+    while (g < glob.size() && glob[g] == '*')
+    {
+        ++g;
+    }
+    return g == glob.size();
+}
+
+GlobEngine::GlobEngine(const size_t numThreads)
+    : numThreads_(numThreads)
+{
+}
+
+GlobEngine::~GlobEngine() = default;
+
+void GlobEngine::beginPass()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++pass_;
+    walked_.clear();
+}
+
+std::vector<std::string> GlobEngine::expand(const std::string& pattern)
+{
+    std::shared_ptr<const GlobPattern> compiled;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto& slot = patterns_[pattern];
+        if (!slot)
+        {
+            slot = std::make_shared<const GlobPattern>(pattern);
+        }
+        compiled = slot;
+    }
+
+    std::vector<std::string> files;
+    if (compiled->isLiteral())
+    {
+        std::error_code ec;
+        if (fs::exists(pattern, ec))
+        {
+            files.push_back(pattern);
+        }
+        return files;
+    }
+
+    match(*compiled, compiled->base(), 0, files);
+    std::sort(files.begin(), files.end());
+    files.erase(std::unique(files.begin(), files.end()), files.end());
+    return files;
+}
+
+size_t GlobEngine::directoriesRead() const noexcept
+{
+    return reads_.load();
+}
+
+std::shared_ptr<const GlobEngine::Listing> GlobEngine::list(const std::string& prefix)
+{
+    Slot* slot;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto& entry = slots_[prefix];
+        if (!entry)
+        {
+            entry = std::make_unique<Slot>();
+        }
+        slot = entry.get();
+    }
+
+    std::lock_guard<std::mutex> lock(slot->mutex);
+    const std::uint64_t pass = pass_.load();
+    if (slot->listing && slot->pass == pass)
+    {
+        return slot->listing;
+    }
+
+    const std::string path = prefix.empty() ? std::string(".") : prefix;
+    if (slot->listing && slot->stamp && slot->stamp->mtimeNs + TIMESTAMP_SLACK_NS <= slot->listedAtNs)
+    {
+        const auto stamp = statDirectory(path);
+        if (stamp && *stamp == *slot->stamp)
+        {
+            slot->pass = pass;
+            return slot->listing;
+        }
+    }
+
+    // Stamp before reading, so an entry added while listing shows up next pass
+    slot->listedAtNs = currentTimeNs();
+    slot->stamp = statDirectory(path);
+    auto listing = std::make_shared<Listing>();
+    std::error_code ec;
+    for (fs::directory_iterator it(path, ec), end; !ec && it != end; it.increment(ec))
+    {
+        std::error_code typeEc;
+        Entry entry;
+        entry.symlink = it->is_symlink(typeEc);
+        entry.directory = it->is_directory(typeEc);
+        if (!entry.directory && !it->is_regular_file(typeEc))
+        {
+            continue;
+        }
+        entry.name = it->path().filename().string();
+        listing->push_back(std::move(entry));
+    }
+    std::sort(listing->begin(), listing->end(),
+        [](const Entry& a, const Entry& b) { return a.name < b.name; });
+    ++reads_;
+
+    slot->listing = std::move(listing);
+    slot->pass = pass;
+    return slot->listing;
+}
+
+void GlobEngine::prefetch(const std::string& prefix)
+{
+    if (numThreads_ <= 1)
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!walked_.insert(prefix).second)
+        {
+            return;
+        }
+        if (!pool_)
+        {
+            pool_ = std::make_unique<ThreadPool>(numThreads_);
+        }
+    }
+
+    // Tasks only queue more tasks, never wait on them, so the pool cannot deadlock
+    Countdown pending;
+    std::function<void(const std::string&)> visit = [&](const std::string& directory)
+    {
+        const auto listing = list(directory);
+        for (const auto& entry : *listing)
+        {
+            if (entry.directory && !entry.symlink && !isHidden(entry.name))
+            {
+                pending.add();
+                pool_->submit([&visit, &pending, child = directory + entry.name + "/"]()
+                {
+                    visit(child);
+                    pending.done();
+                });
+            }
+        }
+    };
+    pending.add();
+    pool_->submit([&visit, &pending, &prefix]()
+    {
+        visit(prefix);
+        pending.done();
+    });
+    pending.wait();
+}
+
+void GlobEngine::match(const GlobPattern& pattern, const std::string& prefix, const size_t index,
+    std::vector<std::string>& out)
+{
+    const auto& segments = pattern.segments();
+    const GlobPattern::Segment& segment = segments[index];
+    const bool last = index + 1 == segments.size();
+
+    if (segment.recursive)
+    {
+        prefetch(prefix);
+        if (last)
+        {
+            collect(prefix, out);
+            return;
+        }
+        match(pattern, prefix, index + 1, out);
+        const auto listing = list(prefix);
+        for (const auto& entry : *listing)
+        {
+            if (entry.directory && !entry.symlink && !isHidden(entry.name))
+            {
+                match(pattern, prefix + entry.name + "/", index, out);
+            }
+        }
+        return;
+    }
+
+    const auto listing = list(prefix);
+    for (const auto& entry : *listing)
+    {
+        if (entry.directory == last)
+        {
+            continue;
+        }
+        const bool matches = segment.literal ? entry.name == segment.text
+            : GlobPattern::matchSegment(segment.text, entry.name);
+        if (!matches)
+        {
+            continue;
+        }
+        if (last)
+        {
+            out.push_back(prefix + entry.name);
+        }
+        else
+        {
+            match(pattern, prefix + entry.name + "/", index + 1, out);
+        }
+    }
+}
+
+void GlobEngine::collect(const std::string& prefix, std::vector<std::string>& out)
+{
+    const auto listing = list(prefix);
+    for (const auto& entry : *listing)
+    {
+        if (isHidden(entry.name))
+        {
+            continue;
+        }
+        if (!entry.directory)
+        {
+            out.push_back(prefix + entry.name);
+        }
+        else if (!entry.symlink)
+        {
+            collect(prefix + entry.name + "/", out);
+        }
+    }
+}
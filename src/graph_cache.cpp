@@ -0,0 +1,494 @@
+#include "mimir/graph_cache.h"
+#include "mimir/glob.h"
+#include "mimir/mapped_file.h"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <unordered_map>
+
+namespace fs = std::filesystem;
+
+using namespace mimir;
+
+namespace
+{
+    constexpr std::uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+    /// Header flag: sourceStamp holds the build file's stat tuple
+    constexpr std::uint32_t HAS_SOURCE_STAMP = 1;
+
+    /// Directory index of probes that are always re-run
+    constexpr std::uint32_t NO_DIRECTORY = 0xFFFFFFFF;
+
+    /// @brief Fixed header preceding the record stream
+    struct Header
+    {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t byteOrder;        ///< BYTE_ORDER_MARK as written; rejects foreign-endian files
+        std::uint32_t flags;
+        std::uint32_t reserved;
+        std::uint8_t sourceHash[32];    ///< GraphCache::hashSource() of the parsed contents
+        std::uint64_t sourceSize;       ///< Build file stat tuple, if HAS_SOURCE_STAMP
+        std::int64_t sourceMtimeNs;
+        std::uint64_t sourceInode;
+        std::int64_t parsedAtNs;        ///< Time before the build file was stat'ed
+        std::uint64_t payloadSize;      ///< Bytes of records following the header
+    };
+
+    /**
+    * @brief Check if a recorded stamp proves nothing changed
+    * @param recorded Stamp recorded with the parse
+    * @param current Stamp now
+    * @param parsedAtNs Time of the parse
+    * @return True if both match and the recording was not racy
+    */
+    bool stampVouches(const std::optional<FileStamp>& recorded, const std::optional<FileStamp>& current,
+        const std::int64_t parsedAtNs)
+    {
+        if (!recorded || !current)
+        {
+            return !recorded && !current;
+        }
+        return *recorded == *current && recorded->mtimeNs + TIMESTAMP_SLACK_NS <= parsedAtNs;
+    }
+
+    /**
+    * @brief Get the directory whose stamp covers a probe
+    * @param pattern Probe pattern
+    * @return The directory, or nullopt if the probe must always be re-run
+    * @note Covers single files and wildcards within one directory; a symlink's
+    *       target can come and go without touching its directory
+    */
+    std::optional<std::string> probeDirectory(const std::string& pattern)
+    {
+        const GlobPattern glob(pattern);
+        std::error_code ec;
+        if (glob.isLiteral())
+        {
+            if (fs::is_symlink(fs::symlink_status(pattern, ec)))
+            {
+                return std::nullopt;
+            }
+            const std::string directory = fs::path(pattern).parent_path().string();
+            return directory.empty() ? std::string(".") : directory;
+        }
+        if (glob.isRecursive() || glob.segments().size() != 1)
+        {
+            return std::nullopt;
+        }
+        std::string directory = glob.base();
+        if (directory.size() > 1)
+        {
+            directory.pop_back();
+        }
+        if (directory.empty())
+        {
+            directory = ".";
+        }
+        for (fs::directory_iterator it(directory, ec), end; !ec && it != end; it.increment(ec))
+        {
+            std::error_code typeEc;
+            if (it->is_symlink(typeEc))
+            {
+                return std::nullopt;
+            }
+        }
+        return directory;
+    }
+
+    /// @brief Appends native-endian integers and length-prefixed strings
+    class RecordWriter
+    {
+    public:
+        void u32(const std::uint32_t value)
+        {
+            bytes_.append(reinterpret_cast<const char*>(&value), sizeof(value));
+        }
+
+        void u64(const std::uint64_t value)
+        {
+            bytes_.append(reinterpret_cast<const char*>(&value), sizeof(value));
+        }
+
+        void string(std::string_view value)
+        {
+            u32(static_cast<std::uint32_t>(value.size()));
+            bytes_.append(value.data(), value.size());
+        }
+
+        void strings(const std::vector<std::string>& values)
+        {
+            u32(static_cast<std::uint32_t>(values.size()));
+            for (const auto& value : values)
+            {
+                string(value);
+            }
+        }
+
+        void stamp(const std::optional<FileStamp>& value)
+        {
+            u32(value ? 1 : 0);
+            if (value)
+            {
+                u64(value->size);
+                u64(static_cast<std::uint64_t>(value->mtimeNs));
+                u64(value->inode);
+            }
+        }
+
+        const std::string& bytes() const noexcept
+        {
+            return bytes_;
+        }
+
+    private:
+        std::string bytes_;
+    };
+
+    /// @brief Bounds-checked reader over the record stream; any overrun sets failed()
+    class RecordReader
+    {
+    public:
+        explicit RecordReader(std::string_view bytes)
+            : bytes_(bytes)
+        {
+        }
+
+        std::uint32_t u32()
+        {
+            std::uint32_t value = 0;
+            if (take(sizeof(value)))
+            {
+                std::memcpy(&value, bytes_.data() + offset_ - sizeof(value), sizeof(value));
+            }
+            return value;
+        }
+
+        std::uint64_t u64()
+        {
+            std::uint64_t value = 0;
+            if (take(sizeof(value)))
+            {
+                std::memcpy(&value, bytes_.data() + offset_ - sizeof(value), sizeof(value));
+            }
+            return value;
+        }
+
+        std::string string()
+        {
+            const std::uint32_t length = u32();
+            if (!take(length))
+            {
+                return {};
+            }
+            return std::string(bytes_.substr(offset_ - length, length));
+        }
+
+        std::vector<std::string> strings()
+        {
+            std::vector<std::string> values;
+            const std::uint32_t count = u32();
+            // Every string costs at least its length prefix, which bounds a corrupt count
+            if (failed_ || count > (bytes_.size() - offset_) / sizeof(std::uint32_t))
+            {
+                failed_ = true;
+                return values;
+            }
+            values.reserve(count);
+            for (std::uint32_t i = 0; i < count && !failed_; ++i)
+            {
+                values.push_back(string());
+            }
+            return values;
+        }
+
+        std::optional<FileStamp> stamp()
+        {
+            if (u32() == 0)
+            {
+                return std::nullopt;
+            }
+            return FileStamp{u64(), static_cast<std::int64_t>(u64()), u64()};
+        }
+
+        bool failed() const noexcept
+        {
+            return failed_;
+        }
+
+        bool atEnd() const noexcept
+        {
+            return offset_ == bytes_.size();
+        }
+
+    private:
+        bool take(const size_t length)
+        {
+            if (failed_ || length > bytes_.size() - offset_)
+            {
+                failed_ = true;
+                return false;
+            }
+            offset_ += length;
+            return true;
+        }
+
+        std::string_view bytes_;
+        size_t offset_ = 0;
+        bool failed_ = false;
+    };
+}
+
+Digest GraphCache::hashSource(std::string_view contents) noexcept
+{
+    Hasher hasher(HashAlgorithm::BLAKE3);
+    hasher.update(contents);
+    return hasher.finalize();
+}
+
+std::optional<CachedGraph> GraphCache::load(
+    const std::string& path,
+    std::string_view buildFile,
+    std::string_view contents,
+    const std::optional<FileStamp>& sourceStamp)
+{
+    MappedFile file;
+    if (!file.open(path))
+    {
+        return std::nullopt;
+    }
+    const std::string_view bytes = file.view();
+    if (bytes.size() < sizeof(Header))
+    {
+        return std::nullopt;
+    }
+    Header header{};
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0
+        || header.version != VERSION
+        || header.byteOrder != BYTE_ORDER_MARK
+        || header.payloadSize != bytes.size() - sizeof(Header))
+    {
+        return std::nullopt;
+    }
+
+    CachedGraph cached;
+    std::memcpy(cached.sourceHash.data(), header.sourceHash, cached.sourceHash.size());
+    std::optional<FileStamp> recordedStamp;
+    if ((header.flags & HAS_SOURCE_STAMP) != 0)
+    {
+        recordedStamp = FileStamp{header.sourceSize, header.sourceMtimeNs, header.sourceInode};
+    }
+    if (!recordedStamp || !stampVouches(recordedStamp, sourceStamp, header.parsedAtNs))
+    {
+        if (hashSource(contents) != cached.sourceHash)
+        {
+            return std::nullopt;
+        }
+        cached.refresh = true;
+    }
+
+    RecordReader reader(bytes.substr(sizeof(Header)));
+    if (reader.string() != buildFile)
+    {
+        return std::nullopt;
+    }
+
+    ParsedGraph& graph = cached.graph;
+    const std::uint32_t targetCount = reader.u32();
+    for (std::uint32_t i = 0; i < targetCount && !reader.failed(); ++i)
+    {
+        Target target(reader.string());
+        target.setCommand(reader.string());
+        target.setPool(reader.string());
+        target.setWeight(reader.u32());
+        target.setDepfile(reader.string());
+        target.setDepsFormat(static_cast<DepsFormat>(reader.u32()));
+        target.setRestat(reader.u32() != 0);
+        target.setRemote(reader.u32() != 0);
+        target.setInputs(reader.strings());
+        target.setOutputs(reader.strings());
+        target.setDependencies(reader.strings());
+        graph.targets.push_back(std::move(target));
+    }
+
+    const std::uint32_t poolCount = reader.u32();
+    for (std::uint32_t i = 0; i < poolCount && !reader.failed(); ++i)
+    {
+        std::string name = reader.string();
+        graph.pools[std::move(name)] = reader.u32();
+    }
+
+    const std::uint32_t includeCount = reader.u32();
+    for (std::uint32_t i = 0; i < includeCount && !reader.failed(); ++i)
+    {
+        SourceFile include;
+        include.path = reader.string();
+        const std::string hash = reader.string();
+        include.stamp = reader.stamp();
+        if (reader.failed() || hash.size() != include.hash.size())
+        {
+            return std::nullopt;
+        }
+        std::memcpy(include.hash.data(), hash.data(), include.hash.size());
+        if (!include.stamp || !stampVouches(include.stamp, statFile(include.path), header.parsedAtNs))
+        {
+            MappedFile contents;
+            if (!contents.open(include.path) || hashSource(contents.view()) != include.hash)
+            {
+                return std::nullopt;
+            }
+            cached.refresh = true;
+        }
+        graph.includes.push_back(std::move(include));
+    }
+
+    // One stat per directory vouches for every probe inside it
+    std::vector<bool> directoryVouches;
+    const std::uint32_t directoryCount = reader.u32();
+    for (std::uint32_t i = 0; i < directoryCount && !reader.failed(); ++i)
+    {
+        const std::string directory = reader.string();
+        const auto recorded = reader.stamp();
+        directoryVouches.push_back(!reader.failed()
+            && stampVouches(recorded, statDirectory(directory), header.parsedAtNs));
+    }
+
+    const std::uint32_t probeCount = reader.u32();
+    for (std::uint32_t i = 0; i < probeCount && !reader.failed(); ++i)
+    {
+        GlobProbe probe;
+        probe.pattern = reader.string();
+        const std::uint32_t directory = reader.u32();
+        probe.matches = reader.strings();
+        if (directory == NO_DIRECTORY || directory >= directoryVouches.size() || !directoryVouches[directory])
+        {
+            cached.recheck.push_back(graph.probes.size());
+        }
+        graph.probes.push_back(std::move(probe));
+    }
+
+    if (reader.failed() || !reader.atEnd())
+    {
+        return std::nullopt;
+    }
+    cached.refresh = cached.refresh || !cached.recheck.empty();
+    return cached;
+}
+
+bool GraphCache::write(
+    const std::string& path,
+    std::string_view buildFile,
+    const Digest& sourceHash,
+    const std::optional<FileStamp>& sourceStamp,
+    const std::int64_t parsedAtNs,
+    const ParsedGraph& graph)
+{
+    RecordWriter records;
+    records.string(buildFile);
+    records.u32(static_cast<std::uint32_t>(graph.targets.size()));
+    for (const auto& target : graph.targets)
+    {
+        records.string(target.getName());
+        records.string(target.getCommand());
+        records.string(target.getPool());
+        records.u32(target.getWeight());
+        records.string(target.getDepfile());
+        records.u32(static_cast<std::uint32_t>(target.getDepsFormat()));
+        records.u32(target.getRestat() ? 1 : 0);
+        records.u32(target.getRemote() ? 1 : 0);
+        records.strings(target.getInputs());
+        records.strings(target.getOutputs());
+        records.strings(target.getDependencies());
+    }
+    records.u32(static_cast<std::uint32_t>(graph.pools.size()));
+    for (const auto& [name, capacity] : graph.pools)
+    {
+        records.string(name);
+        records.u32(capacity);
+    }
+    records.u32(static_cast<std::uint32_t>(graph.includes.size()));
+    for (const auto& include : graph.includes)
+    {
+        records.string(include.path);
+        records.string(std::string_view(reinterpret_cast<const char*>(include.hash.data()), include.hash.size()));
+        records.stamp(include.stamp);
+    }
+
+    // Stamp directories after the parse probed them: a change in between
+    // leaves an mtime newer than parsedAtNs, which load() refuses to trust
+    std::vector<std::uint32_t> probeDirectories;
+    std::vector<std::string> directories;
+    std::unordered_map<std::string, std::uint32_t> directoryIndex;
+    probeDirectories.reserve(graph.probes.size());
+    for (const auto& probe : graph.probes)
+    {
+        const auto directory = probeDirectory(probe.pattern);
+        if (!directory)
+        {
+            probeDirectories.push_back(NO_DIRECTORY);
+            continue;
+        }
+        const auto [it, added] = directoryIndex.emplace(*directory, static_cast<std::uint32_t>(directories.size()));
+        if (added)
+        {
+            directories.push_back(*directory);
+        }
+        probeDirectories.push_back(it->second);
+    }
+    records.u32(static_cast<std::uint32_t>(directories.size()));
+    for (const auto& directory : directories)
+    {
+        records.string(directory);
+        records.stamp(statDirectory(directory));
+    }
+    records.u32(static_cast<std::uint32_t>(graph.probes.size()));
+    for (size_t i = 0; i < graph.probes.size(); ++i)
+    {
+        records.string(graph.probes[i].pattern);
+        records.u32(probeDirectories[i]);
+        records.strings(graph.probes[i].matches);
+    }
+
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.byteOrder = BYTE_ORDER_MARK;
+    std::memcpy(header.sourceHash, sourceHash.data(), sourceHash.size());
+    if (sourceStamp)
+    {
+        header.flags |= HAS_SOURCE_STAMP;
+        header.sourceSize = sourceStamp->size;
+        header.sourceMtimeNs = sourceStamp->mtimeNs;
+        header.sourceInode = sourceStamp->inode;
+    }
+    header.parsedAtNs = parsedAtNs;
+    header.payloadSize = records.bytes().size();
+
+    // Write beside the destination and rename over it, so a concurrent reader
+    // sees either the old cache or the new one
+    const std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+        {
+            return false;
+        }
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(records.bytes().data(), static_cast<std::streamsize>(records.bytes().size()));
+        if (!file)
+        {
+            file.close();
+            std::remove(tmpPath.c_str());
+            return false;
+        }
+    }
+    if (std::rename(tmpPath.c_str(), path.c_str()) != 0)
+    {
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
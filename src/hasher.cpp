@@ -0,0 +1,100 @@
+#include "mimir/hasher.h"
+
+using namespace mimir;
+
+Hasher::Hasher(const HashAlgorithm algorithm)
+    : algorithm_(algorithm)
+{
+    if (algorithm_ == HashAlgorithm::BLAKE3)
+    {
+        detail::blake3Init(blake3_);
+    }
+    else
+    {
+        detail::sha256Init(sha256_);
+    }
+}
+
+void Hasher::update(const void* data, const size_t len) noexcept
+{
+    const auto bytes = static_cast<const std::uint8_t*>(data);
+    if (algorithm_ == HashAlgorithm::BLAKE3)
+    {
+        detail::blake3Update(blake3_, bytes, len);
+    }
+    else
+    {
+        detail::sha256Update(sha256_, bytes, len);
+    }
+}
+
+void Hasher::update(const std::string_view data) noexcept
+{
+    update(data.data(), data.size());
+}
+
+Digest Hasher::finalize() noexcept
+{
+    Digest digest{};
+    if (algorithm_ == HashAlgorithm::BLAKE3)
+    {
+        detail::blake3Final(blake3_, digest.data());
+    }
+    else
+    {
+        detail::sha256Final(sha256_, digest.data());
+    }
+    return digest;
+}
+
+std::string Hasher::finalizeHex()
+{
+    return toHex(finalize());
+}
+
+HashAlgorithm Hasher::algorithm() const noexcept
+{
+    return algorithm_;
+}
+
+std::string Hasher::hashHex(const HashAlgorithm algorithm, const std::string_view data)
+{
+    Hasher hasher(algorithm);
+    hasher.update(data);
+    return hasher.finalizeHex();
+}
+
+std::string Hasher::toHex(const Digest& digest)
+{
+    static constexpr char HEX[] = "0123456789abcdef";
+    std::string hex(digest.size() * 2, '0');
+    for (size_t i = 0; i < digest.size(); ++i)
+    {
+        hex[2 * i] = HEX[digest[i] >> 4];
+        hex[2 * i + 1] = HEX[digest[i] & 0x0f];
+    }
+    return hex;
+}
+
+const char* Hasher::algorithmName(const HashAlgorithm algorithm) noexcept
+{
+    return algorithm == HashAlgorithm::BLAKE3 ? "blake3" : "sha256";
+}
+
+std::optional<HashAlgorithm> Hasher::parseAlgorithm(const std::string_view name) noexcept
+{
+    if (name == "sha256" || name == "sha-256")
+    {
+        return HashAlgorithm::SHA256;
+    }
+    if (name == "blake3")
+    {
+        return HashAlgorithm::BLAKE3;
+    }
+    return std::nullopt;
+}
+
+bool Hasher::hardwareSha256() noexcept
+{
+    return detail::sha256Accelerated();
+}
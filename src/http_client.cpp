@@ -0,0 +1,319 @@
+#include "mimir/http_client.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#ifndef _WIN32
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+using namespace mimir;
+
+namespace
+{
+    bool iequals(std::string_view a, std::string_view b)
+    {
+        return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y)
+        {
+            return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y));
+        });
+    }
+
+    std::string_view trim(std::string_view s)
+    {
+        while (!s.empty() && (s.front() == ' ' || s.front() == '\t'))
+        {
+            s.remove_prefix(1);
+        }
+        while (!s.empty() && (s.back() == ' ' || s.back() == '\t' || s.back() == '\r'))
+        {
+            s.remove_suffix(1);
+        }
+        return s;
+    }
+
+    bool decodeChunked(std::string_view data, std::string& out)
+    {
+        out.clear();
+        while (true)
+        {
+            const size_t lineEnd = data.find("\r\n");
+            if (lineEnd == std::string_view::npos)
+            {
+                return false;
+            }
+            const std::string sizeLine(data.substr(0, lineEnd));
+            char* end = nullptr;
+            const unsigned long long chunkSize = std::strtoull(sizeLine.c_str(), &end, 16);
+            if (end == sizeLine.c_str())
+            {
+                return false;
+            }
+            data.remove_prefix(lineEnd + 2);
+            if (chunkSize == 0)
+            {
+                return true;
+            }
+            if (data.size() < chunkSize + 2)
+            {
+                return false;
+            }
+            out.append(data.data(), chunkSize);
+            data.remove_prefix(chunkSize + 2);
+        }
+    }
+
+    std::optional<HttpResponse> parseResponse(const std::string& raw, const bool isHead)
+    {
+        const size_t headerEnd = raw.find("\r\n\r\n");
+        if (headerEnd == std::string::npos || raw.compare(0, 5, "HTTP/") != 0)
+        {
+            return std::nullopt;
+        }
+
+        HttpResponse response;
+        const size_t statusStart = raw.find(' ');
+        if (statusStart == std::string::npos || statusStart > headerEnd)
+        {
+            return std::nullopt;
+        }
+        response.status = std::atoi(raw.c_str() + statusStart + 1);
+
+        std::optional<size_t> contentLength;
+        bool chunked = false;
+        std::string_view headers(raw.data(), headerEnd);
+        headers.remove_prefix(std::min(headers.size(), headers.find("\r\n") + 2));
+        while (!headers.empty())
+        {
+            const size_t eol = std::min(headers.find("\r\n"), headers.size());
+            const std::string_view line = headers.substr(0, eol);
+            headers.remove_prefix(std::min(headers.size(), eol + 2));
+
+            const size_t colon = line.find(':');
+            if (colon == std::string_view::npos)
+            {
+                continue;
+            }
+            const std::string_view name = trim(line.substr(0, colon));
+            const std::string_view value = trim(line.substr(colon + 1));
+            if (iequals(name, "Content-Length"))
+            {
+                contentLength = std::strtoull(std::string(value).c_str(), nullptr, 10);
+            }
+            else if (iequals(name, "Transfer-Encoding") && iequals(value, "chunked"))
+            {
+                chunked = true;
+            }
+        }
+
+        if (isHead)
+        {
+            return response;
+        }
+
+        const std::string_view body(raw.data() + headerEnd + 4, raw.size() - headerEnd - 4);
+        if (chunked)
+        {
+            if (!decodeChunked(body, response.body))
+            {
+                return std::nullopt;
+            }
+        }
+        else if (contentLength)
+        {
+            if (body.size() < *contentLength)
+            {
+                return std::nullopt;
+            }
+            response.body.assign(body.data(), *contentLength);
+        }
+        else
+        {
+            response.body.assign(body.data(), body.size());
+        }
+        return response;
+    }
+}
+
+std::optional<HttpUrl> HttpUrl::parse(std::string_view url)
+{
+    constexpr std::string_view scheme = "http://";
+    if (url.size() <= scheme.size() || !iequals(url.substr(0, scheme.size()), scheme))
+    {
+        return std::nullopt;
+    }
+    url.remove_prefix(scheme.size());
+
+    HttpUrl result;
+    const size_t slash = url.find('/');
+    std::string_view authority = url.substr(0, slash);
+    if (slash != std::string_view::npos)
+    {
+        std::string_view path = url.substr(slash);
+        while (!path.empty() && path.back() == '/')
+        {
+            path.remove_suffix(1);
+        }
+        result.basePath = std::string(path);
+    }
+
+    const size_t colon = authority.rfind(':');
+    if (colon != std::string_view::npos)
+    {
+        const std::string portText(authority.substr(colon + 1));
+        char* end = nullptr;
+        const unsigned long port = std::strtoul(portText.c_str(), &end, 10);
+        if (portText.empty() || *end != '\0' || port == 0 || port > 65535)
+        {
+            return std::nullopt;
+        }
+        result.port = static_cast<std::uint16_t>(port);
+        authority = authority.substr(0, colon);
+    }
+    if (authority.empty())
+    {
+        return std::nullopt;
+    }
+    result.host = std::string(authority);
+    return result;
+}
+
+HttpClient::HttpClient(HttpUrl baseUrl, const int timeoutMs)
+    : baseUrl_(std::move(baseUrl))
+    , timeoutMs_(timeoutMs)
+{
+}
+
+std::optional<HttpResponse> HttpClient::get(const std::string& path) const
+{
+    return request("GET", path, {});
+}
+
+std::optional<HttpResponse> HttpClient::head(const std::string& path) const
+{
+    return request("HEAD", path, {});
+}
+
+std::optional<HttpResponse> HttpClient::put(const std::string& path, const std::string_view body) const
+{
+    return request("PUT", path, body);
+}
+
+const HttpUrl& HttpClient::getBaseUrl() const noexcept
+{
+    return baseUrl_;
+}
+
+std::optional<HttpResponse> HttpClient::request(const char* method, const std::string& path, const std::string_view body) const
+{
+#ifdef _WIN32
+    (void)method;
+    (void)path;
+    (void)body;
+    return std::nullopt;
+#else
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* addresses = nullptr;
+    const std::string port = std::to_string(baseUrl_.port);
+    if (getaddrinfo(baseUrl_.host.c_str(), port.c_str(), &hints, &addresses) != 0)
+    {
+        return std::nullopt;
+    }
+
+    timeval timeout{};
+    timeout.tv_sec = timeoutMs_ / 1000;
+    timeout.tv_usec = (timeoutMs_ % 1000) * 1000;
+
+    int fd = -1;
+    for (addrinfo* ai = addresses; ai != nullptr; ai = ai->ai_next)
+    {
+        fd = ::socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0)
+        {
+            continue;
+        }
+        // SO_SNDTIMEO also bounds connect() on Linux
+        ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        if (::connect(fd, ai->ai_addr, ai->ai_addrlen) == 0)
+        {
+            break;
+        }
+        ::close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(addresses);
+    if (fd < 0)
+    {
+        return std::nullopt;
+    }
+
+    std::string message;
+    message.reserve(256 + body.size());
+    message += method;
+    message += ' ';
+    message += baseUrl_.basePath;
+    message += path;
+    message += " HTTP/1.1\r\nHost: ";
+    message += baseUrl_.host;
+    message += ':';
+    message += port;
+    message += "\r\nConnection: close\r\nContent-Length: ";
+    message += std::to_string(body.size());
+    message += "\r\n\r\n";
+    message.append(body.data(), body.size());
+
+#ifdef MSG_NOSIGNAL
+    constexpr int sendFlags = MSG_NOSIGNAL;
+#else
+    constexpr int sendFlags = 0;
+#endif
+    size_t sent = 0;
+    while (sent < message.size())
+    {
+        const ssize_t n = ::send(fd, message.data() + sent, message.size() - sent, sendFlags);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            ::close(fd);
+            return std::nullopt;
+        }
+        sent += static_cast<size_t>(n);
+    }
+
+    std::string raw;
+    char buffer[64 * 1024];
+    while (true)
+    {
+        const ssize_t n = ::recv(fd, buffer, sizeof(buffer), 0);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n < 0)
+        {
+            ::close(fd);
+            return std::nullopt;
+        }
+        if (n == 0)
+        {
+            break;
+        }
+        raw.append(buffer, static_cast<size_t>(n));
+    }
+    ::close(fd);
+
+    return parseResponse(raw, std::strcmp(method, "HEAD") == 0);
+#endif
+}
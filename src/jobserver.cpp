@@ -0,0 +1,386 @@
+#include "mimir/jobserver.h"
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+using namespace mimir;
+
+std::optional<std::string> Jobserver::authFromMakeflags(const std::string& makeflags)
+{
+    std::optional<std::string> auth;
+    for (const char* option : {"--jobserver-auth=", "--jobserver-fds="})
+    {
+        const size_t optionLength = std::strlen(option);
+        size_t pos = 0;
+        while ((pos = makeflags.find(option, pos)) != std::string::npos)
+        {
+            const size_t start = pos + optionLength;
+            const size_t end = makeflags.find_first_of(" \t", start);
+            auth = makeflags.substr(start, end == std::string::npos ? std::string::npos : end - start);
+            pos = start;
+        }
+        if (auth)
+        {
+            break;
+        }
+    }
+    return auth;
+}
+
+#ifndef _WIN32
+namespace
+{
+    /// Threads waiting for a token re-check the implicit slot at least this often (ms)
+    constexpr int POLL_INTERVAL_MS = 100;
+
+    /**
+    * @brief Open a new, non-blocking description of an inherited pipe end
+    * @param fd The inherited descriptor
+    * @return The new descriptor, or -1 if /proc is unavailable
+    * @note Setting O_NONBLOCK on fd itself would change it for every process
+    *       sharing the pipe, including make
+    */
+    int reopenNonBlocking(const int fd)
+    {
+        const std::string path = "/proc/self/fd/" + std::to_string(fd);
+        return ::open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    }
+
+    bool isOpenDescriptor(const int fd)
+    {
+        return fd >= 0 && ::fcntl(fd, F_GETFD) != -1;
+    }
+
+    bool writeToken(const int fd, const char token)
+    {
+        while (true)
+        {
+            const ssize_t written = ::write(fd, &token, 1);
+            if (written == 1)
+            {
+                return true;
+            }
+            if (written < 0 && errno != EINTR && errno != EAGAIN)
+            {
+                return false;
+            }
+        }
+    }
+
+    bool writeTokens(const int fd, const size_t count)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (!writeToken(fd, '+'))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+
+std::unique_ptr<Jobserver> Jobserver::connect(const std::string& makeflags)
+{
+    const std::optional<std::string> auth = authFromMakeflags(makeflags);
+    if (!auth || auth->empty())
+    {
+        return nullptr;
+    }
+
+    std::unique_ptr<Jobserver> client(new Jobserver());
+    if (auth->rfind("fifo:", 0) == 0)
+    {
+        const int fd = ::open(auth->c_str() + 5, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+        if (fd < 0)
+        {
+            return nullptr;
+        }
+        client->ownsWriteFd_ = true;
+        if (!client->openChannels(fd, fd))
+        {
+            ::close(fd);
+            return nullptr;
+        }
+    }
+    else
+    {
+        // R,W: descriptors inherited from make (negative when make withheld them)
+        char* end = nullptr;
+        const long readFd = std::strtol(auth->c_str(), &end, 10);
+        if (end == nullptr || *end != ',')
+        {
+            return nullptr;
+        }
+        const long writeFd = std::strtol(end + 1, nullptr, 10);
+        if (!isOpenDescriptor(static_cast<int>(readFd)) || !isOpenDescriptor(static_cast<int>(writeFd)))
+        {
+            return nullptr;
+        }
+        if (!client->openChannels(static_cast<int>(readFd), static_cast<int>(writeFd)))
+        {
+            return nullptr;
+        }
+    }
+    client->makeflags_ = makeflags;
+    return client;
+}
+
+std::unique_ptr<Jobserver> Jobserver::fromEnvironment()
+{
+    const char* makeflags = std::getenv("MAKEFLAGS");
+    return makeflags != nullptr ? connect(makeflags) : nullptr;
+}
+
+std::unique_ptr<Jobserver> Jobserver::create(const size_t jobs, const Style style)
+{
+    const size_t tokens = jobs > 1 ? jobs - 1 : 0;
+    std::unique_ptr<Jobserver> server(new Jobserver());
+    server->server_ = true;
+
+    if (style == Style::Fifo)
+    {
+        static std::atomic<unsigned> counter{0};
+        std::error_code ec;
+        const fs::path dir = fs::temp_directory_path(ec);
+        server->fifoPath_ = (ec ? fs::path("/tmp") : dir).string() + "/mimir-jobserver-"
+            + std::to_string(::getpid()) + "-" + std::to_string(counter++);
+        if (::mkfifo(server->fifoPath_.c_str(), 0600) != 0)
+        {
+            server->fifoPath_.clear();
+            return nullptr;
+        }
+        // Read-write so the fifo never sees EOF while children come and go
+        const int fd = ::open(server->fifoPath_.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+        if (fd < 0)
+        {
+            return nullptr;
+        }
+        server->ownsWriteFd_ = true;
+        if (!server->openChannels(fd, fd))
+        {
+            ::close(fd);
+            return nullptr;
+        }
+        server->makeflags_ = " -j" + std::to_string(jobs) + " --jobserver-auth=fifo:" + server->fifoPath_;
+    }
+    else
+    {
+        // Deliberately inheritable: children find the pool at these numbers
+        if (::pipe(server->serverFds_) != 0)
+        {
+            return nullptr;
+        }
+        if (!server->openChannels(server->serverFds_[0], server->serverFds_[1]))
+        {
+            return nullptr;
+        }
+        server->makeflags_ = " -j" + std::to_string(jobs) + " --jobserver-auth="
+            + std::to_string(server->serverFds_[0]) + "," + std::to_string(server->serverFds_[1]);
+    }
+
+    if (!writeTokens(server->writeFd_, tokens))
+    {
+        return nullptr;
+    }
+    return server;
+}
+
+bool Jobserver::openChannels(const int readFd, const int writeFd)
+{
+    writeFd_ = writeFd;
+    if (readFd == writeFd)
+    {
+        // Our own fifo descriptor is already private and non-blocking
+        readFd_ = readFd;
+    }
+    else
+    {
+        readFd_ = reopenNonBlocking(readFd);
+        if (readFd_ < 0)
+        {
+            return false;
+        }
+    }
+
+    int wakeFds[2];
+    if (::pipe2(wakeFds, O_CLOEXEC | O_NONBLOCK) != 0)
+    {
+        return false;
+    }
+    wakeRead_ = wakeFds[0];
+    wakeWrite_ = wakeFds[1];
+    return true;
+}
+
+Jobserver::~Jobserver()
+{
+    for (const char token : tokens_)
+    {
+        writeToken(writeFd_, token);
+    }
+    if (readFd_ >= 0 && readFd_ != writeFd_)
+    {
+        ::close(readFd_);
+    }
+    if (ownsWriteFd_ && writeFd_ >= 0)
+    {
+        ::close(writeFd_);
+    }
+    for (const int fd : {wakeRead_, wakeWrite_, serverFds_[0], serverFds_[1]})
+    {
+        if (fd >= 0)
+        {
+            ::close(fd);
+        }
+    }
+    if (!fifoPath_.empty())
+    {
+        ::unlink(fifoPath_.c_str());
+    }
+}
+
+bool Jobserver::acquire()
+{
+    while (true)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (shutdown_)
+            {
+                return false;
+            }
+            if (!implicitHeld_)
+            {
+                implicitHeld_ = true;
+                return true;
+            }
+        }
+
+        char token = 0;
+        if (::read(readFd_, &token, 1) == 1)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (shutdown_)
+            {
+                writeToken(writeFd_, token);
+                return false;
+            }
+            tokens_.push_back(token);
+            return true;
+        }
+
+        // Empty pool (or another process won the race): wait for a token, the
+        // implicit slot, or shutdown
+        pollfd fds[2] = {{readFd_, POLLIN, 0}, {wakeRead_, POLLIN, 0}};
+        if (::poll(fds, 2, POLL_INTERVAL_MS) > 0 && (fds[1].revents & POLLIN) != 0)
+        {
+            char drain[64];
+            while (::read(wakeRead_, drain, sizeof(drain)) > 0)
+            {
+            }
+        }
+    }
+}
+
+void Jobserver::release()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!tokens_.empty())
+    {
+        const char token = tokens_.back();
+        tokens_.pop_back();
+        lock.unlock();
+        writeToken(writeFd_, token);
+        return;
+    }
+    implicitHeld_ = false;
+    lock.unlock();
+    wake();
+}
+
+void Jobserver::shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        shutdown_ = true;
+    }
+    wake();
+}
+
+void Jobserver::wake() noexcept
+{
+    const char byte = 0;
+    const ssize_t written = ::write(wakeWrite_, &byte, 1);
+    (void)written;
+}
+
+#else
+// make's Windows jobserver is a named semaphore; it is not supported here
+
+std::unique_ptr<Jobserver> Jobserver::connect(const std::string&)
+{
+    return nullptr;
+}
+
+std::unique_ptr<Jobserver> Jobserver::fromEnvironment()
+{
+    return nullptr;
+}
+
+std::unique_ptr<Jobserver> Jobserver::create(size_t, Style)
+{
+    return nullptr;
+}
+
+bool Jobserver::openChannels(int, int)
+{
+    return false;
+}
+
+Jobserver::~Jobserver() = default;
+
+bool Jobserver::acquire()
+{
+    return false;
+}
+
+void Jobserver::release()
+{
+}
+
+void Jobserver::shutdown()
+{
+}
+
+void Jobserver::wake() noexcept
+{
+}
+#endif
+
+const std::string& Jobserver::makeflags() const noexcept
+{
+    return makeflags_;
+}
+
+bool Jobserver::isServer() const noexcept
+{
+    return server_;
+}
+
+size_t Jobserver::heldTokens() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return tokens_.size();
+}
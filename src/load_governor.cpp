@@ -0,0 +1,218 @@
+#include "mimir/load_governor.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+using namespace mimir;
+
+namespace
+{
+    /// Metrics must fall this far below their threshold before a slot is given back
+    constexpr double RECOVERY_FACTOR = 0.8;
+}
+
+ProcLoadProbe::ProcLoadProbe(std::string procRoot)
+    : procRoot_(std::move(procRoot))
+{
+}
+
+LoadSample ProcLoadProbe::sample()
+{
+    LoadSample result;
+
+    std::ifstream loadavg(procRoot_ + "/loadavg");
+    double load = 0.0;
+    if (loadavg >> load)
+    {
+        result.loadAverage = load;
+    }
+#ifndef _WIN32
+    else
+    {
+        double averages[1];
+        if (::getloadavg(averages, 1) == 1)
+        {
+            result.loadAverage = averages[0];
+        }
+    }
+#endif
+
+    // some avg10=1.23 avg60=0.50 avg300=0.10 total=123456
+    std::ifstream pressure(procRoot_ + "/pressure/memory");
+    std::string line;
+    while (std::getline(pressure, line))
+    {
+        if (line.rfind("some ", 0) != 0)
+        {
+            continue;
+        }
+        const size_t pos = line.find("avg10=");
+        if (pos != std::string::npos)
+        {
+            result.memoryPressure = std::strtod(line.c_str() + pos + 6, nullptr);
+        }
+        break;
+    }
+
+    std::ifstream meminfo(procRoot_ + "/meminfo");
+    while (std::getline(meminfo, line))
+    {
+        if (line.rfind("MemAvailable:", 0) == 0)
+        {
+            std::istringstream fields(line.substr(13));
+            std::uint64_t kb = 0;
+            if (fields >> kb)
+            {
+                result.availableMemoryKb = kb;
+            }
+            break;
+        }
+    }
+    return result;
+}
+
+LoadGovernor::LoadGovernor(
+    const size_t maxSlots,
+    LoadLimits limits,
+    LoadProbePtr probe,
+    const std::chrono::milliseconds interval)
+    : maxSlots_(std::max<size_t>(maxSlots, 1))
+    , limits_(std::move(limits))
+    , probe_(probe ? std::move(probe) : createDefaultLoadProbe())
+    , interval_(interval)
+    , limit_(maxSlots_)
+    , lowestLimit_(maxSlots_)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    refreshLocked();
+}
+
+bool LoadGovernor::acquire()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true)
+    {
+        maybeRefreshLocked();
+        if (shutdown_)
+        {
+            return false;
+        }
+        if (active_ < limit_)
+        {
+            ++active_;
+            return true;
+        }
+        slotFreed_.wait_for(lock, interval_);
+    }
+}
+
+void LoadGovernor::release()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        --active_;
+        maybeRefreshLocked();
+    }
+    slotFreed_.notify_one();
+}
+
+void LoadGovernor::shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        shutdown_ = true;
+    }
+    slotFreed_.notify_all();
+}
+
+void LoadGovernor::refresh()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        refreshLocked();
+    }
+    slotFreed_.notify_all();
+}
+
+size_t LoadGovernor::limit() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return limit_;
+}
+
+size_t LoadGovernor::active() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return active_;
+}
+
+size_t LoadGovernor::lowestLimit() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return lowestLimit_;
+}
+
+void LoadGovernor::maybeRefreshLocked()
+{
+    if (Clock::now() - lastSample_ >= interval_)
+    {
+        const size_t previous = limit_;
+        refreshLocked();
+        if (limit_ > previous)
+        {
+            slotFreed_.notify_all();
+        }
+    }
+}
+
+void LoadGovernor::refreshLocked()
+{
+    lastSample_ = Clock::now();
+    const LoadSample sample = probe_->sample();
+
+    // Memory trouble escalates quickly into swapping or the OOM killer, so it
+    // halves the limit; the load average lags by design and only takes one slot
+    bool memoryHigh = false;
+    bool memoryRecovered = true;
+    if (limits_.maxMemoryPressure && sample.memoryPressure)
+    {
+        memoryHigh = memoryHigh || *sample.memoryPressure > *limits_.maxMemoryPressure;
+        memoryRecovered = memoryRecovered
+            && *sample.memoryPressure <= *limits_.maxMemoryPressure * RECOVERY_FACTOR;
+    }
+    if (limits_.minAvailableMemoryKb && sample.availableMemoryKb)
+    {
+        memoryHigh = memoryHigh || *sample.availableMemoryKb < *limits_.minAvailableMemoryKb;
+        memoryRecovered = memoryRecovered
+            && static_cast<double>(*sample.availableMemoryKb)
+                >= static_cast<double>(*limits_.minAvailableMemoryKb) / RECOVERY_FACTOR;
+    }
+
+    bool loadHigh = false;
+    bool loadRecovered = true;
+    if (limits_.maxLoadAverage && sample.loadAverage)
+    {
+        loadHigh = *sample.loadAverage > *limits_.maxLoadAverage;
+        loadRecovered = *sample.loadAverage <= *limits_.maxLoadAverage * RECOVERY_FACTOR;
+    }
+
+    if (memoryHigh)
+    {
+        limit_ = std::max<size_t>(limit_ / 2, 1);
+    }
+    else if (loadHigh)
+    {
+        limit_ = std::max<size_t>(limit_ - 1, 1);
+    }
+    else if (memoryRecovered && loadRecovered && limit_ < maxSlots_)
+    {
+        ++limit_;
+    }
+    lowestLimit_ = std::min(lowestLimit_, limit_);
+}
+
+LoadProbePtr mimir::createDefaultLoadProbe()
+{
+    return std::make_shared<ProcLoadProbe>();
+}
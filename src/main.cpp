@@ -2,17 +2,130 @@
 #include "mimir/dag.h"
 #include "mimir/executor.h"
 #include "mimir/cache.h"
+#include "mimir/signature.h"
+#include "mimir/artifact_store.h"
+#include "mimir/build_trace.h"
+#include "mimir/daemon.h"
+#include "mimir/remote_execution.h"
+#include "mimir/process_supervisor.h"
+#include <csignal>
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
 #include <iostream>
 #include <string>
+#include <vector>
 #include <cstring>
 #include <iomanip>
+#include <sstream>
+#include <thread>
+#ifndef _WIN32
+#include <pthread.h>
+#include <signal.h>
+#endif
+
+namespace
+{
+    constexpr const char* DAEMON_SOCKET = ".mimir/daemon.sock";
+
+    mimir::BuildDaemon* activeDaemon = nullptr;
+    mimir::RemoteWorker* activeWorker = nullptr;
+
+    void stopActiveDaemon(int)
+    {
+        if (activeDaemon != nullptr)
+        {
+            activeDaemon->stop();
+        }
+    }
+
+    void stopActiveWorker(int)
+    {
+        if (activeWorker != nullptr)
+        {
+            activeWorker->stop();
+        }
+    }
+
+    /// @brief Command-line options that change how a build runs or what it prints \struct BuildSettings
+    struct BuildSettings
+    {
+        const mimir::ExecutorConfig& config;
+        bool jobsGiven;
+        std::string artifactCache;
+        bool artifactReadOnly;
+        bool useJobserver;
+        mimir::Jobserver::Style jobserverStyle;
+        const std::vector<mimir::RemoteEndpoint>& remoteWorkers;
+        bool remoteJobsGiven;
+
+        /**
+        * @brief Fingerprint the settings
+        * @return Digest a daemon compares with the one it was started with, so a
+        *         client asking for other options builds in-process instead
+        */
+        std::string fingerprint() const
+        {
+            std::ostringstream text;
+            text << config.numThreads << ' ' << jobsGiven << ' ' << config.verbose << ' ' << config.stopOnError << ' '
+                 << config.colorOutput << ' ' << static_cast<int>(config.scheduler) << ' ' << config.paranoid << ' '
+                 << config.bufferOutput << ' ' << config.timeoutSeconds.value_or(0) << ' '
+                 << config.loadLimits.maxLoadAverage.value_or(0) << ' '
+                 << config.loadLimits.maxMemoryPressure.value_or(0) << ' '
+                 << config.loadLimits.minAvailableMemoryKb.value_or(0) << ' '
+                 << mimir::Hasher::algorithmName(mimir::Signature::getAlgorithm()) << ' '
+                 << artifactReadOnly << ' ' << useJobserver << ' ' << static_cast<int>(jobserverStyle) << ' '
+                 << config.remoteJobs << ' ' << remoteJobsGiven << '\n' << artifactCache << '\n';
+            for (const auto& worker : remoteWorkers)
+            {
+                text << worker.host << ':' << worker.port << '\n';
+            }
+            // Under make the parent's jobserver limits a local build; a daemon has its own
+            const char* makeflags = std::getenv("MAKEFLAGS");
+            text << (useJobserver && makeflags != nullptr && std::strstr(makeflags, "--jobserver") != nullptr);
+            return mimir::Hasher::hashHex(mimir::HashAlgorithm::SHA256, text.str());
+        }
+    };
+
+    /**
+    * @brief Make Ctrl-C and SIGTERM reach the commands of an in-process build
+    * @details Timed commands lead their own process groups, out of reach of the
+    *          terminal's Ctrl-C. The signals are blocked in every thread and
+    *          taken by one that may lock the supervisor, which passes them on
+    *          to every group it watches before the build exits.
+    * @note Must run before any other thread starts, so all of them inherit the mask
+    */
+    void forwardInterrupts()
+    {
+#ifndef _WIN32
+        sigset_t signals;
+        sigemptyset(&signals);
+        sigaddset(&signals, SIGINT);
+        sigaddset(&signals, SIGTERM);
+        ::pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+        std::thread([signals]
+        {
+            int signal = 0;
+            if (::sigwait(&signals, &signal) == 0)
+            {
+                mimir::ProcessSupervisor::instance().signalAll(signal);
+                std::_Exit(128 + signal);
+            }
+        }).detach();
+#endif
+    }
+}
 
 void printUsage(const char* prog)
 {
     std::cout << "Mimir - Modern C++ Build System\n\n";
     std::cout << "Usage: " << prog << " [OPTIONS] [COMMAND]\n\n";
     std::cout << "Commands:\n";
-    std::cout << "  build       Build targets (default)\n";
+    std::cout << "  build [TARGET...]  Build the targets and their dependencies\n";
+    std::cout << "                     (default: everything)\n";
+    std::cout << "  stats       Show the slowest targets and the critical path of past builds\n";
+    std::cout << "  worker      Run remote targets for other machines' builds; needs\n";
+    std::cout << "              --artifact-cache shared with them\n";
     std::cout << "  clean       Clean cache\n\n";
     std::cout << "Options:\n";
     std::cout << "  -f FILE     Build file (default: build.yaml)\n";
@@ -20,6 +133,38 @@ void printUsage(const char* prog)
     std::cout << "  -n          Dry run (don't execute commands)\n";
     std::cout << "  -v          Verbose output\n";
     std::cout << "  --no-color  Disable colored output\n";
+    std::cout << "  --work-stealing  Use the work-stealing scheduler for -j > 1\n";
+    std::cout << "  --hash ALGO Signature hash: sha256 (default) or blake3, which\n";
+    std::cout << "              hashes large files faster (SSE4.1/AVX2)\n";
+    std::cout << "  --paranoid  Rehash every input instead of trusting size/mtime/inode\n";
+    std::cout << "  -l LOAD     Run fewer jobs while the load average is above LOAD\n";
+    std::cout << "  --max-memory-pressure PCT  Halve the jobs while memory PSI (some avg10)\n";
+    std::cout << "                             is above PCT percent\n";
+    std::cout << "  --min-free-memory MB  Halve the jobs while less than MB is available\n";
+    std::cout << "  --daemon    Keep the graph and cache in memory and serve builds on\n";
+    std::cout << "              " << DAEMON_SOCKET << "; later invocations build through it\n";
+    std::cout << "  --no-daemon Build in this process even if a daemon is running\n";
+    std::cout << "  --stop-daemon  Ask the running daemon to exit\n";
+    std::cout << "  --no-jobserver  Ignore a make jobserver in MAKEFLAGS and don't start one\n";
+    std::cout << "  --jobserver-style STYLE  Jobserver offered to commands for -j > 1:\n";
+    std::cout << "                           fifo (default) or pipe\n";
+    std::cout << "  --timeout SECONDS  Kill any command running longer than this\n";
+    std::cout << "  --stream-output  Let commands write straight to the terminal instead of\n";
+    std::cout << "                   buffering each target's output until it finishes\n";
+    std::cout << "  --artifact-cache LOC  Share outputs via a directory or http:// cache\n";
+    std::cout << "                        (default: $MIMIR_ARTIFACT_CACHE)\n";
+    std::cout << "  --artifact-read-only  Restore from the artifact cache but never upload\n";
+    std::cout << "  --trace FILE  Write a Chrome trace (chrome://tracing, ui.perfetto.dev)\n";
+    std::cout << "                of the build to FILE\n";
+    std::cout << "  --remote HOST[:PORT],...  Run targets marked remote on these workers; inputs\n";
+    std::cout << "                            go through --artifact-cache\n";
+    std::cout << "  --remote-jobs N  Remote targets in flight on top of -j (default: 8 per worker)\n";
+    std::cout << "  --remote-token TOKEN  Secret shared by workers and their clients; required\n";
+    std::cout << "                        for both (default: $MIMIR_REMOTE_TOKEN)\n";
+    std::cout << "  --listen [ADDR:]PORT  Worker address (default: 127.0.0.1:"
+              << mimir::RemoteEndpoint::DEFAULT_PORT << "; name an\n";
+    std::cout << "                        address such as 0.0.0.0 to accept other hosts)\n";
+    std::cout << "  --work-dir DIR  Worker blob cache and sandboxes (default: .mimir/worker)\n";
     std::cout << "  -h          Show this help\n";
 }
 
@@ -31,15 +176,133 @@ void printBuildStats(const mimir::BuildStats& stats)
     std::cout << "  Built:           " << stats.builtTargets << "\n";
     std::cout << "  Skipped:         " << stats.skippedTargets << "\n";
     std::cout << "  Failed:          " << stats.failedTargets << "\n";
+    if (stats.restoredTargets > 0)
+    {
+        std::cout << "  Restored:        " << stats.restoredTargets << "\n";
+    }
+    if (stats.lowestJobSlots > 0)
+    {
+        std::cout << "  Fewest job slots: " << stats.lowestJobSlots << "\n";
+    }
     std::cout << "  Elapsed time:    " << std::fixed << std::setprecision(2) 
               << stats.elapsedSeconds << "s\n";
 }
 
+void printProfile(const mimir::BuildProfile& profile)
+{
+    const auto seconds = [](const std::uint64_t us) { return static_cast<double>(us) / 1e6; };
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "Recorded durations for " << profile.recorded << " of " << profile.targets << " targets\n";
+    std::cout << "  Total command time: " << seconds(profile.totalUs) << "s\n";
+    std::cout << "  Critical path:      " << seconds(profile.criticalPathUs) << "s";
+    if (profile.criticalPathUs > 0)
+    {
+        std::cout << " (at most " << static_cast<double>(profile.totalUs) / static_cast<double>(profile.criticalPathUs)
+                  << "x parallelism)";
+    }
+    std::cout << "\n";
+
+    std::cout << "\nCritical path:\n";
+    for (const auto& [name, durationUs] : profile.criticalPath)
+    {
+        std::cout << std::setw(10) << seconds(durationUs) << "s  " << name << "\n";
+    }
+    std::cout << "\nSlowest targets:\n";
+    for (const auto& [name, durationUs] : profile.slowest)
+    {
+        std::cout << std::setw(10) << seconds(durationUs) << "s  " << name << "\n";
+    }
+}
+
+void printRemoteStats(const mimir::RemoteExecutionStats& stats)
+{
+    std::cout << "  Remote:          " << stats.remoteRuns << " run remotely";
+    if (stats.fallbacks > 0)
+    {
+        std::cout << ", " << stats.fallbacks << " fell back to local";
+    }
+    std::cout << "; " << stats.blobsUploaded << " input blob(s) uploaded, " << stats.blobsReused << " reused\n";
+}
+
+int runWorker(const mimir::RemoteWorkerOptions& options, mimir::ArtifactBackendPtr backend)
+{
+    mimir::RemoteWorker worker(options, backend);
+    if (const auto error = worker.start())
+    {
+        std::cerr << "Error: " << *error << std::endl;
+        return 1;
+    }
+    activeWorker = &worker;
+    std::signal(SIGINT, stopActiveWorker);
+    std::signal(SIGTERM, stopActiveWorker);
+#ifdef SIGPIPE
+    std::signal(SIGPIPE, SIG_IGN);
+#endif
+    std::cout << "Mimir worker listening on " << options.bindAddress << ":" << worker.port()
+              << " with blobs from " << backend->describe() << std::endl;
+    worker.serve();
+    activeWorker = nullptr;
+    std::cout << "Worker stopped after " << worker.actionsRun() << " action(s)." << std::endl;
+    return 0;
+}
+
+int runDaemon(
+    const std::string& buildFile,
+    const mimir::ExecutorConfig& config,
+    mimir::JobserverPtr jobserver,
+    std::shared_ptr<mimir::ArtifactStore> store,
+    mimir::CommandRunnerPtr runner,
+    std::string settings)
+{
+    mimir::DaemonOptions options;
+    options.buildFile = buildFile;
+    options.socketPath = DAEMON_SOCKET;
+    options.config = config;
+    options.jobserver = std::move(jobserver);
+    options.artifactStore = std::move(store);
+    options.settings = std::move(settings);
+
+    mimir::BuildDaemon daemon(options, std::move(runner));
+    if (const auto error = daemon.start())
+    {
+        std::cerr << "Error: " << *error << std::endl;
+        return 1;
+    }
+
+    activeDaemon = &daemon;
+    std::signal(SIGINT, stopActiveDaemon);
+    std::signal(SIGTERM, stopActiveDaemon);
+#ifdef SIGPIPE
+    std::signal(SIGPIPE, SIG_IGN);
+#endif
+    std::cout << "Mimir daemon serving " << daemon.buildFile() << " on " << daemon.socketPath() << std::endl;
+    daemon.serve();
+    activeDaemon = nullptr;
+    std::cout << "Daemon stopped." << std::endl;
+    return 0;
+}
+
 int main(const int argc, char* argv[])
 {
     std::string buildFile = "build.yaml";
     mimir::ExecutorConfig config;
     std::string command = "build";
+    std::vector<std::string> goals;
+    const char* artifactEnv = std::getenv("MIMIR_ARTIFACT_CACHE");
+    std::string artifactCache = artifactEnv != nullptr ? artifactEnv : "";
+    const char* tokenEnv = std::getenv("MIMIR_REMOTE_TOKEN");
+    std::string remoteToken = tokenEnv != nullptr ? tokenEnv : "";
+    bool artifactReadOnly = false;
+    bool jobsGiven = false;
+    bool daemonMode = false;
+    bool useDaemon = true;
+    bool stopDaemonRequested = false;
+    bool useJobserver = true;
+    std::string traceFile;
+    std::vector<mimir::RemoteEndpoint> remoteWorkers;
+    bool remoteJobsGiven = false;
+    mimir::RemoteWorkerOptions workerOptions;
+    mimir::Jobserver::Style jobserverStyle = mimir::Jobserver::Style::Fifo;
     
     for (int i = 1; i < argc; i++)
     {
@@ -59,6 +322,7 @@ int main(const int argc, char* argv[])
             {
                 config.numThreads = 1;
             }
+            jobsGiven = true;
         }
         else if (strcmp(argv[i], "-n") == 0 || strcmp(argv[i], "--dry-run") == 0)
         {
@@ -72,6 +336,155 @@ int main(const int argc, char* argv[])
         {
             config.colorOutput = false;
         }
+        else if (strcmp(argv[i], "--work-stealing") == 0)
+        {
+            config.scheduler = mimir::SchedulerType::WorkStealing;
+        }
+        else if (strcmp(argv[i], "--paranoid") == 0)
+        {
+            config.paranoid = true;
+        }
+        else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc)
+        {
+            const double load = std::atof(argv[++i]);
+            if (load <= 0.0)
+            {
+                std::cerr << "Invalid load average: " << argv[i] << std::endl;
+                return 1;
+            }
+            config.loadLimits.maxLoadAverage = load;
+        }
+        else if (strcmp(argv[i], "--max-memory-pressure") == 0 && i + 1 < argc)
+        {
+            const double percent = std::atof(argv[++i]);
+            if (percent <= 0.0 || percent > 100.0)
+            {
+                std::cerr << "Invalid memory pressure: " << argv[i] << std::endl;
+                return 1;
+            }
+            config.loadLimits.maxMemoryPressure = percent;
+        }
+        else if (strcmp(argv[i], "--min-free-memory") == 0 && i + 1 < argc)
+        {
+            const long long megabytes = std::atoll(argv[++i]);
+            if (megabytes <= 0)
+            {
+                std::cerr << "Invalid free memory threshold: " << argv[i] << std::endl;
+                return 1;
+            }
+            config.loadLimits.minAvailableMemoryKb = static_cast<std::uint64_t>(megabytes) * 1024;
+        }
+        else if (strcmp(argv[i], "--daemon") == 0)
+        {
+            daemonMode = true;
+        }
+        else if (strcmp(argv[i], "--no-daemon") == 0)
+        {
+            useDaemon = false;
+        }
+        else if (strcmp(argv[i], "--stop-daemon") == 0)
+        {
+            stopDaemonRequested = true;
+        }
+        else if (strcmp(argv[i], "--no-jobserver") == 0)
+        {
+            useJobserver = false;
+        }
+        else if (strcmp(argv[i], "--jobserver-style") == 0 && i + 1 < argc)
+        {
+            const std::string style = argv[++i];
+            if (style == "fifo")
+            {
+                jobserverStyle = mimir::Jobserver::Style::Fifo;
+            }
+            else if (style == "pipe")
+            {
+                jobserverStyle = mimir::Jobserver::Style::Pipe;
+            }
+            else
+            {
+                std::cerr << "Unknown jobserver style: " << style << std::endl;
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--timeout") == 0 && i + 1 < argc)
+        {
+            const int seconds = std::atoi(argv[++i]);
+            if (seconds <= 0)
+            {
+                std::cerr << "Invalid timeout: " << argv[i] << std::endl;
+                return 1;
+            }
+            config.timeoutSeconds = seconds;
+        }
+        else if (strcmp(argv[i], "--stream-output") == 0)
+        {
+            config.bufferOutput = false;
+        }
+        else if (strcmp(argv[i], "--hash") == 0 && i + 1 < argc)
+        {
+            const auto algorithm = mimir::Hasher::parseAlgorithm(argv[++i]);
+            if (!algorithm)
+            {
+                std::cerr << "Unknown hash algorithm: " << argv[i] << std::endl;
+                return 1;
+            }
+            mimir::Signature::setAlgorithm(*algorithm);
+        }
+        else if (strcmp(argv[i], "--artifact-cache") == 0 && i + 1 < argc)
+        {
+            artifactCache = argv[++i];
+        }
+        else if (strcmp(argv[i], "--artifact-read-only") == 0)
+        {
+            artifactReadOnly = true;
+        }
+        else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+        {
+            traceFile = argv[++i];
+        }
+        else if (strcmp(argv[i], "--remote") == 0 && i + 1 < argc)
+        {
+            const auto workers = mimir::RemoteEndpoint::parseList(argv[++i]);
+            if (!workers)
+            {
+                std::cerr << "Invalid worker list: " << argv[i] << std::endl;
+                return 1;
+            }
+            remoteWorkers = *workers;
+        }
+        else if (strcmp(argv[i], "--remote-jobs") == 0 && i + 1 < argc)
+        {
+            config.remoteJobs = std::atoi(argv[++i]);
+            if (config.remoteJobs < 0)
+            {
+                std::cerr << "Invalid remote job count: " << argv[i] << std::endl;
+                return 1;
+            }
+            remoteJobsGiven = true;
+        }
+        else if (strcmp(argv[i], "--remote-token") == 0 && i + 1 < argc)
+        {
+            remoteToken = argv[++i];
+        }
+        else if (strcmp(argv[i], "--listen") == 0 && i + 1 < argc)
+        {
+            // A bare port stays on loopback; other hosts are only reached when an address is named
+            const std::string address = argv[++i];
+            const auto endpoint = mimir::RemoteEndpoint::parse(
+                address.find(':') == std::string::npos ? workerOptions.bindAddress + ":" + address : address);
+            if (!endpoint)
+            {
+                std::cerr << "Invalid listen address: " << address << std::endl;
+                return 1;
+            }
+            workerOptions.bindAddress = endpoint->host;
+            workerOptions.port = endpoint->port;
+        }
+        else if (strcmp(argv[i], "--work-dir") == 0 && i + 1 < argc)
+        {
+            workerOptions.workDir = argv[++i];
+        }
         else if (strcmp(argv[i], "build") == 0)
         {
             command = "build";
@@ -80,10 +493,27 @@ int main(const int argc, char* argv[])
         {
             command = "clean";
         }
+        else if (strcmp(argv[i], "stats") == 0)
+        {
+            command = "stats";
+        }
+        else if (strcmp(argv[i], "worker") == 0)
+        {
+            command = "worker";
+        }
+        else if (argv[i][0] != '-')
+        {
+            goals.push_back(argv[i]);
+        }
     }
     
     if (command == "clean")
     {
+        // The daemon would write its in-memory cache straight back
+        if (mimir::stopDaemon(DAEMON_SOCKET))
+        {
+            std::cout << "Stopped the build daemon.\n";
+        }
         std::cout << "Cleaning cache...\n";
         mimir::Cache cache;
         cache.clear();
@@ -93,38 +523,152 @@ int main(const int argc, char* argv[])
         return 0;
     }
     
-    std::vector<mimir::Target> targets;
-    mimir::Parser parser;
-    
-    if (buildFile.find(".yaml") != std::string::npos || buildFile.find(".yml") != std::string::npos)
+    if (command == "worker")
     {
-        targets = parser.parseYAML(buildFile);
+        const auto backend = artifactCache.empty() ? nullptr : mimir::createArtifactBackend(artifactCache);
+        if (!backend)
+        {
+            std::cerr << "A worker needs the --artifact-cache its clients use" << std::endl;
+            return 1;
+        }
+        if (remoteToken.empty())
+        {
+            std::cerr << "A worker needs --remote-token or $MIMIR_REMOTE_TOKEN" << std::endl;
+            return 1;
+        }
+        if (jobsGiven)
+        {
+            workerOptions.maxJobs = static_cast<size_t>(config.numThreads);
+        }
+        workerOptions.token = remoteToken;
+        return runWorker(workerOptions, backend);
     }
-    else if (buildFile.find(".toml") != std::string::npos)
+
+    if (stopDaemonRequested)
     {
-        targets = parser.parseTOML(buildFile);
+        const bool stopped = mimir::stopDaemon(DAEMON_SOCKET);
+        std::cout << (stopped ? "Daemon stopped.\n" : "No daemon is running.\n");
+        return 0;
     }
-    else
+
+    // Taken before the jobserver and remote setup below adjust the config
+    const mimir::ExecutorConfig requested = config;
+    const BuildSettings settings{requested, jobsGiven, artifactCache, artifactReadOnly, useJobserver,
+                                 jobserverStyle, remoteWorkers, remoteJobsGiven};
+
+    // A running daemon already has the graph and cache loaded; dry runs and traces stay local
+    const bool building = command == "build";
+    if (building && !daemonMode && useDaemon && !config.dryRun && traceFile.empty())
     {
-        std::cerr << "Unknown file format: " << buildFile << std::endl;
-        return 1;
+        if (const auto code = mimir::buildOnDaemon(DAEMON_SOCKET, buildFile, settings.fingerprint(), goals, std::cout))
+        {
+            return *code;
+        }
     }
-    
-    if (targets.empty())
+
+    if (building && !daemonMode)
+    {
+        forwardInterrupts();
+    }
+
+    // Under make, the parent's jobserver decides how many commands run at
+    // once; otherwise offer our own -j slots to nested make/ninja/mimir.
+    mimir::JobserverPtr jobserver;
+    if (building && useJobserver && !config.dryRun)
     {
-        if (auto error = parser.getLastError())
+        jobserver = mimir::Jobserver::fromEnvironment();
+        if (jobserver)
         {
-            std::cerr << "Parse error in " << error->file << ":" << error->line 
-                      << ": " << error->message << std::endl;
+            if (!jobsGiven)
+            {
+                config.numThreads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+            }
+            std::cout << "Joined the make jobserver from MAKEFLAGS\n";
         }
-        else
+        else if (config.numThreads > 1)
+        {
+            jobserver = mimir::Jobserver::create(static_cast<size_t>(config.numThreads), jobserverStyle);
+            if (!jobserver)
+            {
+                std::cerr << "Warning: could not start a jobserver; nested builds won't share -j slots\n";
+            }
+        }
+    }
+
+    std::shared_ptr<mimir::ArtifactStore> store;
+    if (building && !artifactCache.empty())
+    {
+        auto backend = mimir::createArtifactBackend(artifactCache);
+        if (!backend)
+        {
+            std::cerr << "Invalid artifact cache location: " << artifactCache << std::endl;
+            return 1;
+        }
+        store = std::make_shared<mimir::ArtifactStore>(std::move(backend));
+        store->setReadOnly(artifactReadOnly);
+        std::cout << "Using artifact cache " << store->getBackend()->describe()
+                  << (artifactReadOnly ? " (read-only)" : "") << "\n";
+    }
+
+    // Remote inputs go to the same content store the artifact cache uses
+    std::shared_ptr<mimir::RemoteCommandRunner> remoteRunner;
+    if (building && !remoteWorkers.empty() && !config.dryRun)
+    {
+        if (!store)
+        {
+            std::cerr << "Remote execution needs --artifact-cache shared with the workers" << std::endl;
+            return 1;
+        }
+        if (remoteToken.empty())
+        {
+            std::cerr << "Remote execution needs the workers' --remote-token or $MIMIR_REMOTE_TOKEN" << std::endl;
+            return 1;
+        }
+        if (!remoteJobsGiven)
         {
-            std::cerr << "No targets found in " << buildFile << std::endl;
+            config.remoteJobs = static_cast<int>(8 * remoteWorkers.size());
         }
+        remoteRunner = std::make_shared<mimir::RemoteCommandRunner>(remoteWorkers, store->getBackend(), remoteToken);
+        std::cout << "Running remote targets on " << remoteWorkers.size() << " worker(s), up to "
+                  << config.remoteJobs << " at a time\n";
+    }
+    
+
+    if (daemonMode)
+    {
+        return runDaemon(buildFile, config, jobserver, store, remoteRunner, settings.fingerprint());
+    }
+
+    if (buildFile.find(".yaml") == std::string::npos && buildFile.find(".yml") == std::string::npos
+        && buildFile.find(".toml") == std::string::npos)
+    {
+        std::cerr << "Unknown file format: " << buildFile << std::endl;
+        return 1;
+    }
+
+    mimir::Parser parser;
+    parser.setCacheDirectory(".mimir");
+    auto parsed = parser.parseFile(buildFile);
+    if (const auto* error = std::get_if<mimir::ParseError>(&parsed))
+    {
+        std::cerr << "Parse error in " << error->file << ":" << error->line
+                  << ": " << error->message << std::endl;
+        return 1;
+    }
+    std::vector<mimir::Target> targets = std::move(std::get<std::vector<mimir::Target>>(parsed));
+    if (targets.empty())
+    {
+        std::cerr << "No targets found in " << buildFile << std::endl;
         return 1;
     }
     
-    std::cout << "Loaded " << targets.size() << " targets from " << buildFile << std::endl;
+    std::cout << "Loaded " << targets.size() << " targets from " << buildFile;
+    if (parser.getSourceFiles().size() > 1)
+    {
+        std::cout << " and " << parser.getSourceFiles().size() - 1 << " included file(s)";
+    }
+    std::cout << (parser.loadedFromCache() ? " (cached)" : "") << std::endl;
+    config.pools = parser.getPools();
     
     mimir::DAG dag;
     for (const auto& target : targets)
@@ -143,14 +687,37 @@ int main(const int argc, char* argv[])
         return 1;
     }
     
+    bool unknownGoal = false;
+    for (const auto& goal : goals)
+    {
+        if (!dag.hasTarget(goal))
+        {
+            std::cerr << "Error: Unknown target: " << goal << "\n";
+            unknownGoal = true;
+        }
+    }
+    if (unknownGoal)
+    {
+        return 1;
+    }
+    
     auto cycleResult = dag.detectCyclesWithResult();
     if (cycleResult.hasCycle)
     {
         std::cerr << "Error: Cycle detected in dependency graph!\n";
         if (!cycleResult.cycleNodes.empty())
+        {
+            std::cerr << "  Cycle: ";
+            for (size_t i = 0; i < cycleResult.cycleNodes.size(); ++i)
+            {
+                std::cerr << (i > 0 ? " -> " : "") << cycleResult.cycleNodes[i];
+            }
+            std::cerr << "\n";
+        }
+        for (const auto& component : cycleResult.components)
         {
             std::cerr << "  Involved targets: ";
-            for (const auto& node : cycleResult.cycleNodes)
+            for (const auto& node : component)
             {
                 std::cerr << node << " ";
             }
@@ -161,9 +728,33 @@ int main(const int argc, char* argv[])
     
     mimir::Cache cache;
     cache.load();
+    if (command == "stats")
+    {
+        printProfile(mimir::profileBuild(dag, cache));
+        return 0;
+    }
+    if (!cache.enableJournal())
+    {
+        std::cerr << "Warning: could not open cache journal; progress is only saved at the end\n";
+    }
 
-    mimir::Executor executor(config);
-    
+    auto depsLog = std::make_shared<mimir::DepsLog>(cache.getCacheDir() + "/deps.bin");
+    if (!config.dryRun && !depsLog->open())
+    {
+        std::cerr << "Warning: could not open " << depsLog->getPath() << "; discovered dependencies are not kept\n";
+    }
+
+    mimir::Executor executor(config.numThreads, remoteRunner);
+    executor.setConfig(config);
+    executor.setJobserver(jobserver);
+    executor.setArtifactStore(store);
+    executor.setDepsLog(depsLog);
+    std::shared_ptr<mimir::BuildTrace> trace;
+    if (!traceFile.empty())
+    {
+        trace = std::make_shared<mimir::BuildTrace>();
+        executor.setBuildTrace(trace);
+    }
     if (config.dryRun)
     {
         std::cout << "[DRY RUN] ";
@@ -171,11 +762,27 @@ int main(const int argc, char* argv[])
     std::cout << "Building with " << config.numThreads << " parallel job(s)...\n";
 
     mimir::BuildStats stats;
-    const bool success = executor.executeWithStats(dag, cache, stats);
+    const bool success = executor.executeWithStats(dag, goals, cache, stats);
     
-    cache.save();
+    // Only the journal is flushed; the snapshot is rewritten once the journal grows large
+    cache.checkpoint();
     
     printBuildStats(stats);
+    if (remoteRunner)
+    {
+        printRemoteStats(remoteRunner->getStats());
+    }
+    if (trace)
+    {
+        if (trace->writeChromeTrace(traceFile))
+        {
+            std::cout << "  Trace written to " << traceFile << "\n";
+        }
+        else
+        {
+            std::cerr << "Warning: could not write trace to " << traceFile << "\n";
+        }
+    }
     
     if (!success)
     {
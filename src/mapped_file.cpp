@@ -0,0 +1,162 @@
+#include "mimir/mapped_file.h"
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace mimir;
+
+namespace
+{
+    /**
+    * @brief Read a whole stream into a heap buffer
+    * @param path File to read
+    * @param data Receives the buffer (nullptr when empty)
+    * @param size Receives the length
+    * @return True if the file could be read
+    */
+    bool readWhole(const std::string& path, const char*& data, size_t& size)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open())
+        {
+            return false;
+        }
+        const std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        if (file.bad())
+        {
+            return false;
+        }
+        size = contents.size();
+        if (size > 0)
+        {
+            auto* buffer = new char[size];
+            contents.copy(buffer, size);
+            data = buffer;
+        }
+        return true;
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : data_(other.data_)
+    , size_(other.size_)
+    , open_(other.open_)
+    , mapped_(other.mapped_)
+{
+    other.data_ = nullptr;
+    other.size_ = 0;
+    other.open_ = false;
+    other.mapped_ = false;
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other)
+    {
+        close();
+        data_ = other.data_;
+        size_ = other.size_;
+        open_ = other.open_;
+        mapped_ = other.mapped_;
+        other.data_ = nullptr;
+        other.size_ = 0;
+        other.open_ = false;
+        other.mapped_ = false;
+    }
+    return *this;
+}
+
+bool MappedFile::open(const std::string& path)
+{
+    close();
+
+#ifndef _WIN32
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct stat st{};
+    if (::fstat(fd, &st) != 0)
+    {
+        ::close(fd);
+        return false;
+    }
+    if (S_ISREG(st.st_mode))
+    {
+        const auto length = static_cast<size_t>(st.st_size);
+        if (length > 0)
+        {
+            void* mapping = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping != MAP_FAILED)
+            {
+                ::close(fd);
+                data_ = static_cast<const char*>(mapping);
+                size_ = length;
+                mapped_ = true;
+                open_ = true;
+                return true;
+            }
+        }
+        else
+        {
+            ::close(fd);
+            open_ = true;
+            return true;
+        }
+    }
+    ::close(fd);
+#endif
+
+    // Pipes, devices and failed mappings are read instead
+    if (!readWhole(path, data_, size_))
+    {
+        return false;
+    }
+    open_ = true;
+    return true;
+}
+
+void MappedFile::close() noexcept
+{
+    if (data_ != nullptr)
+    {
+#ifndef _WIN32
+        if (mapped_)
+        {
+            ::munmap(const_cast<char*>(data_), size_);
+        }
+        else
+#endif
+        {
+            delete[] data_;
+        }
+    }
+    data_ = nullptr;
+    size_ = 0;
+    open_ = false;
+    mapped_ = false;
+}
+
+bool MappedFile::isOpen() const noexcept
+{
+    return open_;
+}
+
+std::string_view MappedFile::view() const noexcept
+{
+    return {data_, size_};
+}
@@ -0,0 +1,79 @@
+#include "mimir/output_buffer.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace mimir;
+
+OutputBuffer::OutputBuffer(const size_t capacity)
+    : capacity_(capacity == 0 ? 1 : capacity)
+    , start_(0)
+    , dropped_(0)
+{
+}
+
+void OutputBuffer::append(const char* data, size_t len)
+{
+    if (data_.size() < capacity_)
+    {
+        const size_t take = std::min(len, capacity_ - data_.size());
+        data_.append(data, take);
+        data += take;
+        len -= take;
+        if (len == 0)
+        {
+            return;
+        }
+    }
+
+    // Full: overwrite the oldest bytes in place
+    dropped_ += len;
+    if (len >= capacity_)
+    {
+        data += len - capacity_;
+        len = capacity_;
+    }
+    const size_t first = std::min(len, capacity_ - start_);
+    std::memcpy(&data_[start_], data, first);
+    std::memcpy(&data_[0], data + first, len - first);
+    start_ = (start_ + len) % capacity_;
+}
+
+std::string OutputBuffer::str() const
+{
+    if (start_ == 0)
+    {
+        return data_;
+    }
+    std::string out;
+    out.reserve(data_.size());
+    out.append(data_, start_, std::string::npos);
+    out.append(data_, 0, start_);
+    return out;
+}
+
+size_t OutputBuffer::size() const noexcept
+{
+    return data_.size();
+}
+
+bool OutputBuffer::empty() const noexcept
+{
+    return data_.empty();
+}
+
+size_t OutputBuffer::capacity() const noexcept
+{
+    return capacity_;
+}
+
+size_t OutputBuffer::droppedBytes() const noexcept
+{
+    return dropped_;
+}
+
+void OutputBuffer::clear() noexcept
+{
+    data_.clear();
+    start_ = 0;
+    dropped_ = 0;
+}
@@ -1,15 +1,302 @@
 #include "mimir/parser.h"
-#include <fstream>
+#include "mimir/glob.h"
+#include "mimir/mapped_file.h"
+#include "mimir/thread_pool.h"
 #include <sstream>
 #include <iostream>
-#include <regex>
 #include <unordered_map>
+#include <unordered_set>
 #include <filesystem>
-#include <cmath>
+#include <thread>
 
 namespace fs = std::filesystem;
 using namespace mimir;
 
+namespace
+{
+    /// Variables and config entries, as views into the mapped build file
+    using VariableMap = std::unordered_map<std::string_view, std::string_view>;
+
+    /// Nesting limit for variables whose values reference other variables
+    constexpr int MAX_EXPANSION_DEPTH = 32;
+
+    /// @brief Splits text into lines the way std::getline does
+    class LineReader
+    {
+    public:
+        explicit LineReader(std::string_view text)
+            : text_(text)
+        {
+        }
+
+        bool next(std::string_view& line)
+        {
+            if (pos_ >= text_.size())
+            {
+                return false;
+            }
+            const size_t end = text_.find('\n', pos_);
+            if (end == std::string_view::npos)
+            {
+                line = text_.substr(pos_);
+                pos_ = text_.size();
+            }
+            else
+            {
+                line = text_.substr(pos_, end - pos_);
+                pos_ = end + 1;
+            }
+            return true;
+        }
+
+    private:
+        std::string_view text_;
+        size_t pos_ = 0;
+    };
+
+    /**
+    * @brief Map a deps: value to its format
+    * @param value "gcc" or "msvc"
+    * @return The format, or nullopt for anything else
+    */
+    std::optional<DepsFormat> parseDepsFormat(std::string_view value)
+    {
+        if (value == "gcc")
+        {
+            return DepsFormat::GCC;
+        }
+        if (value == "msvc")
+        {
+            return DepsFormat::MSVC;
+        }
+        return std::nullopt;
+    }
+
+    /**
+    * @brief Map a boolean value
+    * @param value "true"/"false" or "yes"/"no"
+    * @return The flag, or nullopt for anything else
+    */
+    std::optional<bool> parseFlag(std::string_view value)
+    {
+        if (value == "true" || value == "yes")
+        {
+            return true;
+        }
+        if (value == "false" || value == "no")
+        {
+            return false;
+        }
+        return std::nullopt;
+    }
+
+    /**
+    * @brief Drop leading blanks
+    * @param value Text to trim
+    * @return value without leading spaces and tabs, or value itself if it is all blanks
+    */
+    std::string_view skipBlank(std::string_view value)
+    {
+        const size_t start = value.find_first_not_of(" \t");
+        return start == std::string_view::npos ? value : value.substr(start);
+    }
+
+    bool isWordChar(const char c) noexcept
+    {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+    }
+
+    bool isSpace(const char c) noexcept
+    {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+    }
+
+    /// @brief Hand-rolled scanner for the small expression grammar
+    class Cursor
+    {
+    public:
+        explicit Cursor(std::string_view text)
+            : text_(text)
+        {
+        }
+
+        size_t spaces()
+        {
+            const size_t start = pos_;
+            while (pos_ < text_.size() && isSpace(text_[pos_]))
+            {
+                ++pos_;
+            }
+            return pos_ - start;
+        }
+
+        bool literal(std::string_view expected)
+        {
+            if (text_.substr(pos_, expected.size()) != expected)
+            {
+                return false;
+            }
+            pos_ += expected.size();
+            return true;
+        }
+
+        std::string_view word()
+        {
+            const size_t start = pos_;
+            while (pos_ < text_.size() && isWordChar(text_[pos_]))
+            {
+                ++pos_;
+            }
+            return text_.substr(start, pos_ - start);
+        }
+
+        std::string_view until(const char stop)
+        {
+            const size_t start = pos_;
+            while (pos_ < text_.size() && text_[pos_] != stop)
+            {
+                ++pos_;
+            }
+            return text_.substr(start, pos_ - start);
+        }
+
+        bool done() const noexcept
+        {
+            return pos_ == text_.size();
+        }
+
+    private:
+        std::string_view text_;
+        size_t pos_ = 0;
+    };
+
+    /// @brief A parsed `A if config.KEY == "VALUE" else B` expression
+    struct Ternary
+    {
+        std::string_view whenTrue;
+        std::string_view configKey;
+        std::string_view configValue;
+        std::string_view whenFalse;
+    };
+
+    /**
+    * @brief Parse a conditional expression
+    * @param expr Expression text
+    * @return The parts, or nullopt if expr is not a conditional
+    */
+    std::optional<Ternary> parseTernary(std::string_view expr)
+    {
+        Cursor cursor(expr);
+        Ternary ternary;
+        cursor.spaces();
+        ternary.whenTrue = cursor.word();
+        if (ternary.whenTrue.empty() || cursor.spaces() == 0 || !cursor.literal("if") || cursor.spaces() == 0
+            || !cursor.literal("config."))
+        {
+            return std::nullopt;
+        }
+        ternary.configKey = cursor.word();
+        cursor.spaces();
+        if (ternary.configKey.empty() || !cursor.literal("=="))
+        {
+            return std::nullopt;
+        }
+        cursor.spaces();
+        if (!cursor.literal("\""))
+        {
+            return std::nullopt;
+        }
+        ternary.configValue = cursor.until('"');
+        if (ternary.configValue.empty() || !cursor.literal("\""))
+        {
+            return std::nullopt;
+        }
+        cursor.spaces();
+        if (!cursor.literal("else"))
+        {
+            return std::nullopt;
+        }
+        cursor.spaces();
+        ternary.whenFalse = cursor.word();
+        cursor.spaces();
+        if (ternary.whenFalse.empty() || !cursor.done())
+        {
+            return std::nullopt;
+        }
+        return ternary;
+    }
+
+    /// List variables available to commands, in lookup order
+    constexpr std::string_view LIST_VARIABLES[] = {"inputs", "outputs", "dependencies"};
+
+    /**
+    * @brief Call fn for every item of a TOML array such as ["a", "b"]
+    * @param value Text of the array, starting at '['
+    * @param fn Receives each item without quotes or surrounding blanks
+    */
+    template <typename Fn>
+    void forEachListItem(std::string_view value, Fn&& fn)
+    {
+        const size_t endPos = value.find(']');
+        std::string_view items = value.substr(1, endPos - 1);
+        while (!items.empty())
+        {
+            const size_t comma = items.find(',');
+            const std::string_view item = items.substr(0, comma);
+            items = comma == std::string_view::npos ? std::string_view{} : items.substr(comma + 1);
+
+            const size_t start = item.find_first_not_of(" \t\"");
+            const size_t end = item.find_last_not_of(" \t\"");
+            if (start != std::string_view::npos && end != std::string_view::npos)
+            {
+                fn(item.substr(start, end - start + 1));
+            }
+        }
+    }
+
+    bool isYAMLPath(const std::string& path)
+    {
+        return path.find(".yaml") != std::string::npos || path.find(".yml") != std::string::npos;
+    }
+
+    bool isTOMLPath(const std::string& path)
+    {
+        return path.find(".toml") != std::string::npos;
+    }
+}
+
+/// @brief Variables visible while expanding one target's command
+struct Parser::VariableScope
+{
+    const VariableMap& vars;        ///< Build file variables
+    const VariableMap& cfg;         ///< Build file config entries
+    const Target& target;           ///< Target whose lists back ${inputs} etc.
+    bool globLists;                 ///< Expand list items through expandGlob (YAML) or join them verbatim (TOML)
+    std::optional<std::string> lists[3];    ///< Joined lists, computed on first use
+};
+
+/// @brief Variables a build file starts with and ends up defining
+struct Parser::FileScope
+{
+    VariableMap vars;                       ///< Inherited, then the file's own variables
+    VariableMap cfg;                        ///< Inherited, then the file's own config entries
+    std::vector<std::string> includes;      ///< Include paths as written in the file
+};
+
+/// @brief One file of an include tree, parsed by its own Parser so files can be parsed concurrently
+struct Parser::IncludeUnit
+{
+    std::string path;                       ///< Path resolved against the including file
+    std::vector<size_t> children;           ///< Units for this file's includes, in order
+    MappedFile file;                        ///< Keeps the views in scope alive until the tree is merged
+    std::string_view text;                  ///< Contents (the root's are supplied by the caller)
+    std::optional<FileStamp> stamp;         ///< stat() tuple taken before reading
+    Digest hash{};                          ///< Digest of the contents, if requested
+    Parser parser;                          ///< Error, pool and glob state of this file
+    FileScope scope;
+    std::vector<Target> targets;
+};
+
 std::string ParseError::toString() const
 {
     std::ostringstream oss;
@@ -40,19 +327,153 @@ void Parser::clearError()
     lastError_.reset();
 }
 
+const PoolCapacities& Parser::getPools() const noexcept
+{
+    return pools_;
+}
+
+const std::vector<std::string>& Parser::getSourceFiles() const noexcept
+{
+    return sourceFiles_;
+}
+
+const std::vector<GlobProbe>& Parser::getGlobProbes() const noexcept
+{
+    return probes_;
+}
+
+void Parser::setCacheDirectory(std::string cacheDir)
+{
+    cacheDir_ = std::move(cacheDir);
+}
+
+bool Parser::loadedFromCache() const noexcept
+{
+    return loadedFromCache_;
+}
+
+std::optional<std::uint32_t> Parser::parsePositive(std::string_view value)
+{
+    if (value.empty() || value.size() > 9 || value.find_first_not_of("0123456789") != std::string_view::npos)
+    {
+        return std::nullopt;
+    }
+    std::uint32_t number = 0;
+    for (const char digit : value)
+    {
+        number = number * 10 + static_cast<std::uint32_t>(digit - '0');
+    }
+    if (number == 0)
+    {
+        return std::nullopt;
+    }
+    return number;
+}
+
+bool Parser::validatePools(const std::vector<Target>& targets, const std::string& filepath)
+{
+    for (const auto& target : targets)
+    {
+        if (!target.getPool().empty() && pools_.count(target.getPool()) == 0)
+        {
+            lastError_ = ParseError("Target '" + target.getName() + "' uses undefined pool '"
+                + target.getPool() + "'", filepath);
+            return false;
+        }
+    }
+    return true;
+}
+
 ParseResult<std::vector<Target>> Parser::parseFile(const std::string& filepath)
 {
-    if (filepath.find(".yaml") != std::string::npos || 
-        filepath.find(".yml") != std::string::npos)
+    const bool yaml = isYAMLPath(filepath);
+    if (!yaml && !isTOMLPath(filepath))
+    {
+        return ParseError("Unknown file format", filepath);
+    }
+    probes_.clear();
+    if (cacheDir_.empty())
     {
-        return parseYAMLWithResult(filepath);
+        loadedFromCache_ = false;
+        auto result = yaml ? parseYAMLWithResult(filepath) : parseTOMLWithResult(filepath);
+        for (const auto& [pattern, matches] : globs_)
+        {
+            probes_.push_back(GlobProbe{pattern, matches});
+        }
+        return result;
     }
-    else if (filepath.find(".toml") != std::string::npos)
+
+    lastError_.reset();
+    pools_.clear();
+    globs_.clear();
+    globEngine().beginPass();
+    sourceFiles_ = {filepath};
+    includes_.clear();
+    loadedFromCache_ = false;
+
+    // Stamp before reading, so an edit made while parsing shows up next time
+    const std::int64_t parsedAtNs = currentTimeNs();
+    const auto sourceStamp = statFile(filepath);
+    MappedFile file;
+    if (!file.open(filepath))
     {
-        return parseTOMLWithResult(filepath);
+        lastError_ = ParseError("Failed to open file", filepath);
+        return *lastError_;
     }
-    
-    return ParseError("Unknown file format", filepath);
+
+    const std::string cachePath = cacheDir_ + "/graph.bin";
+    if (auto cached = GraphCache::load(cachePath, filepath, file.view(), sourceStamp))
+    {
+        if (probesMatch(*cached))
+        {
+            if (cached->refresh)
+            {
+                GraphCache::write(cachePath, filepath, cached->sourceHash, sourceStamp, parsedAtNs, cached->graph);
+            }
+            pools_ = std::move(cached->graph.pools);
+            for (const auto& include : cached->graph.includes)
+            {
+                sourceFiles_.push_back(include.path);
+            }
+            probes_ = std::move(cached->graph.probes);
+            loadedFromCache_ = true;
+            return std::move(cached->graph.targets);
+        }
+        globs_.clear();
+    }
+
+    ParsedGraph graph;
+    graph.targets = parseTree(filepath, file.view(), yaml, true);
+    if (lastError_)
+    {
+        return *lastError_;
+    }
+
+    graph.pools = pools_;
+    graph.includes = includes_;
+    graph.probes.reserve(globs_.size());
+    for (const auto& [pattern, matches] : globs_)
+    {
+        graph.probes.push_back(GlobProbe{pattern, matches});
+    }
+    std::error_code ec;
+    fs::create_directories(cacheDir_, ec);
+    GraphCache::write(cachePath, filepath, GraphCache::hashSource(file.view()), sourceStamp, parsedAtNs, graph);
+    probes_ = std::move(graph.probes);
+    return std::move(graph.targets);
+}
+
+bool Parser::probesMatch(const CachedGraph& cached)
+{
+    for (const size_t index : cached.recheck)
+    {
+        const GlobProbe& probe = cached.graph.probes[index];
+        if (expandGlob(probe.pattern) != probe.matches)
+        {
+            return false;
+        }
+    }
+    return true;
 }
 
 ParseResult<std::vector<Target>> Parser::parseYAMLWithResult(const std::string& filepath)
@@ -77,80 +498,254 @@ ParseResult<std::vector<Target>> Parser::parseTOMLWithResult(const std::string&
 
 std::vector<Target> Parser::parseYAML(const std::string& filepath)
 {
-    std::vector<Target> targets;
     lastError_.reset();
-    
-    std::ifstream file(filepath);
-    if (!file.is_open())
+    pools_.clear();
+    globs_.clear();
+    globEngine().beginPass();
+    sourceFiles_ = {filepath};
+    includes_.clear();
+
+    MappedFile file;
+    if (!file.open(filepath))
     {
         lastError_ = ParseError("Failed to open file", filepath);
         std::cerr << "Failed to open file: " << filepath << std::endl;
-        return targets;
+        return {};
     }
+    return parseTree(filepath, file.view(), true, false);
+}
 
-    Target current;
-    std::string line;
-    bool inTarget = false;
-    std::string currentList;
-    std::string currentSection;
-    size_t multilineIndentLevel = 0;
-    bool readingMultilineCommand = false;
-    std::stringstream multilineBuffer;
-    size_t lineNumber = 0;
+std::vector<Target> Parser::parseTree(
+    const std::string& filepath,
+    std::string_view text,
+    const bool yaml,
+    const bool hashSources)
+{
+    std::vector<std::unique_ptr<IncludeUnit>> units;
+    units.push_back(std::make_unique<IncludeUnit>());
+    units[0]->path = filepath;
+    units[0]->text = text;
 
-    std::unordered_map<std::string, std::string> vars;
-    std::unordered_map<std::string, std::string> cfg;
+    // Every file of the tree shares one engine, so directories are listed once
+    globEngine();
+    const std::shared_ptr<GlobEngine> engine = globEngine_;
+    auto parseUnit = [hashSources, &engine](IncludeUnit& unit, const bool root, const bool rootIsYAML)
+    {
+        Parser& parser = unit.parser;
+        parser.globEngine_ = engine;
+        if (!root)
+        {
+            unit.stamp = statFile(unit.path);
+            if (!unit.file.open(unit.path))
+            {
+                parser.lastError_ = ParseError("Failed to open included file", unit.path);
+                return;
+            }
+            unit.text = unit.file.view();
+            if (hashSources)
+            {
+                unit.hash = GraphCache::hashSource(unit.text);
+            }
+        }
+        const bool asYAML = root ? rootIsYAML : isYAMLPath(unit.path);
+        if (!asYAML && !root && !isTOMLPath(unit.path))
+        {
+            parser.lastError_ = ParseError("Unknown file format", unit.path);
+            return;
+        }
+        unit.targets = asYAML ? parser.parseYAMLText(unit.text, unit.path, unit.scope)
+            : parser.parseTOMLText(unit.text, unit.path, unit.scope);
+    };
 
-    auto expandAllLists = [&](const Target& t) -> std::unordered_map<std::string, std::string>
+    // Parse one include depth at a time: a file's includes inherit the
+    // variables it defines, so they can only start once it is done
+    std::unordered_set<std::string> seen;
+    std::error_code ec;
+    const fs::path rootCanonical = fs::weakly_canonical(filepath, ec);
+    seen.insert(ec ? filepath : rootCanonical.string());
+    std::unique_ptr<ThreadPool> pool;
+    std::vector<size_t> wave{0};
+    while (!wave.empty())
     {
-        std::unordered_map<std::string, std::string> tmpVars = vars;
+        if (wave.size() == 1)
+        {
+            parseUnit(*units[wave[0]], wave[0] == 0, yaml);
+        }
+        else
+        {
+            if (!pool)
+            {
+                pool = std::make_unique<ThreadPool>(std::max(1u, std::thread::hardware_concurrency()));
+            }
+            std::vector<std::future<void>> pending;
+            pending.reserve(wave.size());
+            for (const size_t index : wave)
+            {
+                IncludeUnit* unit = units[index].get();
+                pending.push_back(pool->submit([&parseUnit, unit] { parseUnit(*unit, false, false); }));
+            }
+            for (auto& done : pending)
+            {
+                done.get();
+            }
+        }
 
-        std::vector<std::string> expandedInputs;
-        for (const auto& i : t.getInputs())
+        std::vector<size_t> next;
+        for (const size_t index : wave)
         {
-            auto v = expandGlob(i);
-            expandedInputs.insert(expandedInputs.end(), v.begin(), v.end());
+            IncludeUnit& unit = *units[index];
+            if (unit.parser.lastError_)
+            {
+                lastError_ = unit.parser.lastError_;
+                return {};
+            }
+            const fs::path directory = fs::path(unit.path).parent_path();
+            for (const auto& include : unit.scope.includes)
+            {
+                const fs::path resolved = fs::path(include).is_absolute()
+                    ? fs::path(include) : (directory / include).lexically_normal();
+                const fs::path canonical = fs::weakly_canonical(resolved, ec);
+                if (!seen.insert(ec ? resolved.string() : canonical.string()).second)
+                {
+                    continue;
+                }
+                auto child = std::make_unique<IncludeUnit>();
+                child->path = resolved.string();
+                child->scope.vars = unit.scope.vars;
+                child->scope.cfg = unit.scope.cfg;
+                unit.children.push_back(units.size());
+                next.push_back(units.size());
+                units.push_back(std::move(child));
+            }
         }
+        wave = std::move(next);
+    }
+
+    // Merge in file order: each file's targets, then its includes' (depth first)
+    std::vector<size_t> order;
+    order.reserve(units.size());
+    std::vector<size_t> stack{0};
+    while (!stack.empty())
+    {
+        const size_t index = stack.back();
+        stack.pop_back();
+        order.push_back(index);
+        const auto& children = units[index]->children;
+        stack.insert(stack.end(), children.rbegin(), children.rend());
+    }
 
-        std::vector<std::string> expandedOutputs;
-        for (const auto& o : t.getOutputs())
+    std::unordered_map<std::string, size_t> poolOwners;
+    for (const size_t index : order)
+    {
+        for (const auto& [name, capacity] : units[index]->parser.pools_)
         {
-            auto v = expandGlob(o);
-            expandedOutputs.insert(expandedOutputs.end(), v.begin(), v.end());
+            const auto [it, added] = poolOwners.emplace(name, index);
+            if (!added && pools_[name] != capacity)
+            {
+                lastError_ = ParseError("Pool '" + name + "' is already defined with capacity "
+                    + std::to_string(pools_[name]) + " in " + units[it->second]->path, units[index]->path);
+                return {};
+            }
+            pools_[name] = capacity;
         }
+    }
 
-        std::vector<std::string> expandedDeps;
-        for (const auto& d : t.getDependencies())
+    std::vector<Target> targets;
+    std::unordered_map<std::string, size_t> targetOwners;
+    std::unordered_map<std::string, std::pair<std::string, size_t>> outputOwners;
+    for (const size_t index : order)
+    {
+        IncludeUnit& unit = *units[index];
+        if (!validatePools(unit.targets, unit.path))
         {
-            auto v = expandGlob(d);
-            expandedDeps.insert(expandedDeps.end(), v.begin(), v.end());
+            return {};
         }
+        for (auto& target : unit.targets)
+        {
+            // A depfile alone implies the gcc format
+            if (target.getDepsFormat() == DepsFormat::None && !target.getDepfile().empty())
+            {
+                target.setDepsFormat(DepsFormat::GCC);
+            }
+            if (target.getDepsFormat() == DepsFormat::GCC && target.getDepfile().empty())
+            {
+                lastError_ = ParseError("Target '" + target.getName() + "' uses deps: gcc without a depfile",
+                    unit.path);
+                return {};
+            }
+            const auto [owner, added] = targetOwners.emplace(target.getName(), index);
+            if (!added)
+            {
+                lastError_ = ParseError("Target '" + target.getName() + "' is already defined in "
+                    + units[owner->second]->path, unit.path);
+                return {};
+            }
+            for (const auto& output : target.getOutputs())
+            {
+                const auto [producer, fresh] = outputOwners.emplace(output, std::make_pair(target.getName(), index));
+                if (!fresh)
+                {
+                    lastError_ = ParseError("Output '" + output + "' of target '" + target.getName()
+                        + "' is already produced by target '" + producer->second.first + "' in "
+                        + units[producer->second.second]->path, unit.path);
+                    return {};
+                }
+            }
+            targets.push_back(std::move(target));
+        }
+        for (auto& [pattern, matches] : unit.parser.globs_)
+        {
+            globs_.emplace(pattern, std::move(matches));
+        }
+        if (index != 0)
+        {
+            sourceFiles_.push_back(unit.path);
+            includes_.push_back(SourceFile{unit.path, unit.hash, unit.stamp});
+        }
+    }
+    return targets;
+}
 
-        tmpVars["inputs"] = joinList(expandedInputs);
-        tmpVars["outputs"] = joinList(expandedOutputs);
-        tmpVars["dependencies"] = joinList(expandedDeps);
+std::vector<Target> Parser::parseYAMLText(std::string_view text, const std::string& filepath, FileScope& scope)
+{
+    std::vector<Target> targets;
+
+    Target current;
+    std::string_view line;
+    bool inTarget = false;
+    std::string_view currentList;
+    std::string_view currentSection;
+    size_t multilineIndentLevel = 0;
+    bool readingMultilineCommand = false;
+    std::string multilineBuffer;
+    size_t lineNumber = 0;
+
+    VariableMap& vars = scope.vars;
+    VariableMap& cfg = scope.cfg;
 
-        return tmpVars;
+    auto expandCommand = [&](std::string_view command)
+    {
+        VariableScope scope{vars, cfg, current, true, {}};
+        current.setCommand(expandVariables(command, scope));
     };
 
-    while (std::getline(file, line))
+    LineReader lines(text);
+    while (lines.next(line))
     {
         ++lineNumber;
-        
+
         if (readingMultilineCommand)
         {
-            size_t indent = line.find_first_not_of(" \t");
-            if (indent != std::string::npos && indent >= multilineIndentLevel)
+            const size_t indent = line.find_first_not_of(" \t");
+            if (indent != std::string_view::npos && indent >= multilineIndentLevel)
             {
-                multilineBuffer << line.substr(multilineIndentLevel) << "\n";
+                multilineBuffer.append(line.substr(multilineIndentLevel));
+                multilineBuffer.push_back('\n');
                 continue;
             }
-            else
-            {
-                current.setCommand(expandVariables(multilineBuffer.str(), expandAllLists(current), cfg));
-                readingMultilineCommand = false;
-                multilineBuffer.str("");
-            }
+            expandCommand(multilineBuffer);
+            readingMultilineCommand = false;
+            multilineBuffer.clear();
         }
 
         if (line.empty() || line[0] == '#')
@@ -158,12 +753,12 @@ std::vector<Target> Parser::parseYAML(const std::string& filepath)
             continue;
         }
 
-        size_t indent = line.find_first_not_of(" \t");
-        if (indent == std::string::npos)
+        const size_t indent = line.find_first_not_of(" \t");
+        if (indent == std::string_view::npos)
         {
             continue;
         }
-        std::string trimmed = line.substr(indent);
+        const std::string_view trimmed = line.substr(indent);
 
         if (indent == 0)
         {
@@ -177,25 +772,45 @@ std::vector<Target> Parser::parseYAML(const std::string& filepath)
                 currentSection = "config";
                 continue;
             }
+            if (trimmed == "pools:")
+            {
+                currentSection = "pools";
+                continue;
+            }
             if (trimmed == "targets:")
             {
-                currentSection.clear();
+                currentSection = {};
+                continue;
+            }
+            if (trimmed == "include:")
+            {
+                currentSection = "include";
+                continue;
+            }
+            if (trimmed.substr(0, 8) == "include:")
+            {
+                scope.includes.emplace_back(skipBlank(trimmed.substr(8)));
+                currentSection = {};
                 continue;
             }
         }
 
+        if (currentSection == "include")
+        {
+            if (trimmed[0] == '-')
+            {
+                scope.includes.emplace_back(skipBlank(trimmed.substr(1)));
+            }
+            continue;
+        }
+
         if (!currentSection.empty())
         {
-            size_t colonPos = trimmed.find(':');
-            if (colonPos != std::string::npos)
+            const size_t colonPos = trimmed.find(':');
+            if (colonPos != std::string_view::npos)
             {
-                std::string key = trimmed.substr(0, colonPos);
-                std::string value = trimmed.substr(colonPos + 1);
-                size_t valueStart = value.find_first_not_of(" \t");
-                if (valueStart != std::string::npos)
-                {
-                    value = value.substr(valueStart);
-                }
+                const std::string_view key = trimmed.substr(0, colonPos);
+                const std::string_view value = skipBlank(trimmed.substr(colonPos + 1));
 
                 if (currentSection == "variables")
                 {
@@ -205,6 +820,17 @@ std::vector<Target> Parser::parseYAML(const std::string& filepath)
                 {
                     cfg[key] = value;
                 }
+                else if (currentSection == "pools")
+                {
+                    const auto capacity = parsePositive(value);
+                    if (!capacity)
+                    {
+                        lastError_ = ParseError("Pool '" + std::string(key) + "' needs a positive capacity",
+                            filepath, lineNumber);
+                        return {};
+                    }
+                    pools_[std::string(key)] = *capacity;
+                }
                 continue;
             }
         }
@@ -213,23 +839,17 @@ std::vector<Target> Parser::parseYAML(const std::string& filepath)
         {
             if (inTarget && !current.getName().empty())
             {
-                targets.push_back(current);
+                targets.push_back(std::move(current));
             }
 
             current = Target();
-            currentList.clear();
+            currentList = {};
             inTarget = true;
 
-            if (trimmed.find("name:") != std::string::npos)
+            const size_t pos = trimmed.find("name:");
+            if (pos != std::string_view::npos)
             {
-                size_t pos = trimmed.find("name:");
-                std::string nameValue = trimmed.substr(pos + 5);
-                size_t start = nameValue.find_first_not_of(" \t");
-                if (start != std::string::npos)
-                {
-                    nameValue = nameValue.substr(start);
-                }
-                current.setName(nameValue);
+                current.setName(std::string(skipBlank(trimmed.substr(pos + 5))));
             }
             continue;
         }
@@ -239,21 +859,16 @@ std::vector<Target> Parser::parseYAML(const std::string& filepath)
             continue;
         }
 
-        size_t colonPos = trimmed.find(':');
-        if (colonPos != std::string::npos)
+        const size_t colonPos = trimmed.find(':');
+        if (colonPos != std::string_view::npos)
         {
-            std::string key = trimmed.substr(0, colonPos);
-            std::string value = trimmed.substr(colonPos + 1);
-            size_t start = value.find_first_not_of(" \t");
-            if (start != std::string::npos)
-            {
-                value = value.substr(start);
-            }
+            const std::string_view key = trimmed.substr(0, colonPos);
+            const std::string_view value = skipBlank(trimmed.substr(colonPos + 1));
 
             if (key == "name")
             {
-                current.setName(value);
-                currentList.clear();
+                current.setName(std::string(value));
+                currentList = {};
             }
             else if (key == "command")
             {
@@ -261,96 +876,162 @@ std::vector<Target> Parser::parseYAML(const std::string& filepath)
                 {
                     readingMultilineCommand = true;
                     multilineIndentLevel = indent + 2;
-                    multilineBuffer.str("");
+                    multilineBuffer.clear();
                     continue;
                 }
-                else
+                expandCommand(value);
+                currentList = {};
+            }
+            else if (key == "pool")
+            {
+                current.setPool(std::string(value));
+                currentList = {};
+            }
+            else if (key == "depfile")
+            {
+                VariableScope depfileScope{vars, cfg, current, true, {}};
+                current.setDepfile(expandVariables(value, depfileScope));
+                currentList = {};
+            }
+            else if (key == "deps")
+            {
+                const auto format = parseDepsFormat(value);
+                if (!format)
                 {
-                    current.setCommand(expandVariables(value, expandAllLists(current), cfg));
+                    lastError_ = ParseError("Unknown deps format '" + std::string(value) + "' (expected gcc or msvc)",
+                        filepath, lineNumber);
+                    return {};
                 }
-                currentList.clear();
+                current.setDepsFormat(*format);
+                currentList = {};
             }
-            else if (key == "inputs")
+            else if (key == "restat")
             {
-                currentList = "inputs";
+                const auto restat = parseFlag(value);
+                if (!restat)
+                {
+                    lastError_ = ParseError("restat must be true or false", filepath, lineNumber);
+                    return {};
+                }
+                current.setRestat(*restat);
+                currentList = {};
             }
-            else if (key == "outputs")
+            else if (key == "remote")
             {
-                currentList = "outputs";
+                const auto remote = parseFlag(value);
+                if (!remote)
+                {
+                    lastError_ = ParseError("remote must be true or false", filepath, lineNumber);
+                    return {};
+                }
+                current.setRemote(*remote);
+                currentList = {};
             }
-            else if (key == "dependencies")
+            else if (key == "weight")
             {
-                currentList = "dependencies";
+                const auto weight = parsePositive(value);
+                if (!weight)
+                {
+                    lastError_ = ParseError("Weight must be a positive integer", filepath, lineNumber);
+                    return {};
+                }
+                current.setWeight(*weight);
+                currentList = {};
+            }
+            else if (key == "inputs" || key == "outputs" || key == "dependencies")
+            {
+                currentList = key;
             }
         }
         else if (trimmed[0] == '-' && !currentList.empty())
         {
-            std::string item = trimmed.substr(1);
-            size_t start = item.find_first_not_of(" \t");
-            if (start != std::string::npos)
-            {
-                item = item.substr(start);
-            }
+            std::string item(skipBlank(trimmed.substr(1)));
 
             if (currentList == "inputs")
             {
-                current.addInput(item);
+                current.addInput(std::move(item));
             }
             else if (currentList == "outputs")
             {
-                current.addOutput(item);
+                current.addOutput(std::move(item));
             }
-            else if (currentList == "dependencies")
+            else
             {
-                current.addDependency(item);
+                current.addDependency(std::move(item));
             }
         }
     }
 
     if (readingMultilineCommand)
     {
-        current.setCommand(expandVariables(multilineBuffer.str(), expandAllLists(current), cfg));
+        expandCommand(multilineBuffer);
     }
 
     if (inTarget && !current.getName().empty())
     {
-        targets.push_back(current);
+        targets.push_back(std::move(current));
     }
-    
+
     return targets;
 }
 
 std::vector<Target> Parser::parseTOML(const std::string& filepath)
 {
-    std::vector<Target> targets;
     lastError_.reset();
-    
-    std::ifstream file(filepath);
-    if (!file.is_open())
+    pools_.clear();
+    globs_.clear();
+    globEngine().beginPass();
+    sourceFiles_ = {filepath};
+    includes_.clear();
+
+    MappedFile file;
+    if (!file.open(filepath))
     {
         lastError_ = ParseError("Failed to open file", filepath);
         std::cerr << "Failed to open file: " << filepath << std::endl;
-        return targets;
+        return {};
     }
+    return parseTree(filepath, file.view(), false, false);
+}
+
+std::vector<Target> Parser::parseTOMLText(std::string_view text, const std::string& filepath, FileScope& scope)
+{
+    std::vector<Target> targets;
 
     Target current;
-    std::string line;
-    std::string currentList;
-    std::unordered_map<std::string, std::string> vars;
-    std::unordered_map<std::string, std::string> cfg;
+    std::string_view line;
+    bool inPools = false;
+    bool inTable = false;
     size_t lineNumber = 0;
 
-    while (std::getline(file, line))
+    auto addToList = [&current](std::string_view list, std::string item)
+    {
+        if (list == "inputs")
+        {
+            current.addInput(std::move(item));
+        }
+        else if (list == "outputs")
+        {
+            current.addOutput(std::move(item));
+        }
+        else
+        {
+            current.addDependency(std::move(item));
+        }
+    };
+
+    LineReader lines(text);
+    while (lines.next(line))
     {
         ++lineNumber;
-        
+
         if (line.empty() || line[0] == '#')
         {
             continue;
         }
 
-        size_t trimStart = line.find_first_not_of(" \t");
-        if (trimStart == std::string::npos)
+        const size_t trimStart = line.find_first_not_of(" \t");
+        if (trimStart == std::string_view::npos)
         {
             continue;
         }
@@ -361,100 +1042,136 @@ std::vector<Target> Parser::parseTOML(const std::string& filepath)
         {
             if (!current.getName().empty())
             {
-                targets.push_back(current);
+                targets.push_back(std::move(current));
             }
             current = Target();
-            currentList.clear();
-            std::string section = line.substr(1, line.length() - 2);
-            if (section.find("target") == 0)
+            const std::string_view section = line.substr(1, line.length() - 2);
+            inPools = section == "pools";
+            inTable = true;
+            if (section.substr(0, 6) == "target")
             {
-                size_t dot = section.find('.');
-                if (dot != std::string::npos)
+                const size_t dot = section.find('.');
+                if (dot != std::string_view::npos)
                 {
-                    current.setName(section.substr(dot + 1));
+                    current.setName(std::string(section.substr(dot + 1)));
                 }
             }
             continue;
         }
 
-        size_t eqPos = line.find('=');
-        if (eqPos == std::string::npos)
+        const size_t eqPos = line.find('=');
+        if (eqPos == std::string_view::npos)
         {
             continue;
         }
 
-        std::string key = line.substr(0, eqPos);
-        std::string value = line.substr(eqPos + 1);
+        std::string_view key = line.substr(0, eqPos);
+        std::string_view value = skipBlank(line.substr(eqPos + 1));
 
-        size_t keyEnd = key.find_last_not_of(" \t");
-        if (keyEnd != std::string::npos)
+        const size_t keyEnd = key.find_last_not_of(" \t");
+        if (keyEnd != std::string_view::npos)
         {
             key = key.substr(0, keyEnd + 1);
         }
 
-        size_t valStart = value.find_first_not_of(" \t");
-        if (valStart != std::string::npos)
-        {
-            value = value.substr(valStart);
-        }
-
         if (!value.empty() && value.front() == '"' && value.back() == '"')
         {
             value = value.substr(1, value.size() - 2);
         }
 
-        if (key == "name")
+        if (!inTable && key == "include")
         {
-            current.setName(value);
+            if (!value.empty() && value.front() == '[')
+            {
+                forEachListItem(value, [&scope](std::string_view item) { scope.includes.emplace_back(item); });
+            }
+            else
+            {
+                scope.includes.emplace_back(value);
+            }
         }
-        else if (key == "command")
+        else if (inPools)
         {
-            std::unordered_map<std::string, std::string> tmpVars = vars;
-            tmpVars["inputs"] = joinList(current.getInputs());
-            tmpVars["outputs"] = joinList(current.getOutputs());
-            tmpVars["dependencies"] = joinList(current.getDependencies());
-            current.setCommand(expandVariables(value, tmpVars, cfg));
-            currentList.clear();
+            const auto capacity = parsePositive(value);
+            if (!capacity)
+            {
+                lastError_ = ParseError("Pool '" + std::string(key) + "' needs a positive capacity",
+                    filepath, lineNumber);
+                return {};
+            }
+            pools_[std::string(key)] = *capacity;
         }
-        else if (key == "inputs" || key == "outputs" || key == "dependencies")
+        else if (key == "name")
         {
-            currentList = key;
-            if (!value.empty() && value.front() == '[')
+            current.setName(std::string(value));
+        }
+        else if (key == "pool")
+        {
+            current.setPool(std::string(value));
+        }
+        else if (key == "depfile")
+        {
+            VariableScope variables{scope.vars, scope.cfg, current, false, {}};
+            current.setDepfile(expandVariables(value, variables));
+        }
+        else if (key == "deps")
+        {
+            const auto format = parseDepsFormat(value);
+            if (!format)
             {
-                size_t endPos = value.find(']');
-                std::string items = value.substr(1, endPos - 1);
-                std::istringstream iss(items);
-                std::string item;
-                while (std::getline(iss, item, ','))
-                {
-                    size_t start = item.find_first_not_of(" \t\"");
-                    size_t end = item.find_last_not_of(" \t\"");
-                    if (start != std::string::npos && end != std::string::npos)
-                    {
-                        item = item.substr(start, end - start + 1);
-                        if (currentList == "inputs")
-                        {
-                            current.addInput(item);
-                        }
-                        else if (currentList == "outputs")
-                        {
-                            current.addOutput(item);
-                        }
-                        else if (currentList == "dependencies")
-                        {
-                            current.addDependency(item);
-                        }
-                    }
-                }
+                lastError_ = ParseError("Unknown deps format '" + std::string(value) + "' (expected gcc or msvc)",
+                    filepath, lineNumber);
+                return {};
+            }
+            current.setDepsFormat(*format);
+        }
+        else if (key == "restat")
+        {
+            const auto restat = parseFlag(value);
+            if (!restat)
+            {
+                lastError_ = ParseError("restat must be true or false", filepath, lineNumber);
+                return {};
             }
+            current.setRestat(*restat);
+        }
+        else if (key == "remote")
+        {
+            const auto remote = parseFlag(value);
+            if (!remote)
+            {
+                lastError_ = ParseError("remote must be true or false", filepath, lineNumber);
+                return {};
+            }
+            current.setRemote(*remote);
+        }
+        else if (key == "weight")
+        {
+            const auto weight = parsePositive(value);
+            if (!weight)
+            {
+                lastError_ = ParseError("Weight must be a positive integer", filepath, lineNumber);
+                return {};
+            }
+            current.setWeight(*weight);
+        }
+        else if (key == "command")
+        {
+            VariableScope variables{scope.vars, scope.cfg, current, false, {}};
+            current.setCommand(expandVariables(value, variables));
+        }
+        else if ((key == "inputs" || key == "outputs" || key == "dependencies")
+            && !value.empty() && value.front() == '[')
+        {
+            forEachListItem(value, [&](std::string_view item) { addToList(key, std::string(item)); });
         }
     }
 
     if (!current.getName().empty())
     {
-        targets.push_back(current);
+        targets.push_back(std::move(current));
     }
-    
+
     return targets;
 }
 
@@ -468,108 +1185,155 @@ void Parser::replaceAll(std::string& str, const std::string& from, const std::st
     }
 }
 
-std::string Parser::evaluateExpression(
-    const std::string& expr,
-    const std::unordered_map<std::string, std::string>& vars,
-    const std::unordered_map<std::string, std::string>& cfg)
+std::optional<std::string_view> Parser::lookupVariable(std::string_view name, VariableScope& scope)
 {
-    std::regex ternary_expr(R"lit(^\s*(\w+)\s+if\s+config\.(\w+)\s*==\s*"([^"]+)"\s*else\s*(\w+)\s*$)lit");
-    std::smatch m;
-    if (std::regex_match(expr, m, ternary_expr))
+    for (size_t i = 0; i < 3; ++i)
     {
-        std::string varTrue = m[1];
-        std::string cfgKey = m[2];
-        std::string cfgVal = m[3];
-        std::string varFalse = m[4];
-
-        auto itCfg = cfg.find(cfgKey);
-        if (itCfg != cfg.end() && itCfg->second == cfgVal)
+        if (name != LIST_VARIABLES[i])
         {
-            auto itVar = vars.find(varTrue);
-            return itVar != vars.end() ? itVar->second : "";
+            continue;
         }
-        else
+        if (!scope.lists[i])
         {
-            auto itVar = vars.find(varFalse);
-            return itVar != vars.end() ? itVar->second : "";
+            const auto& items = i == 0 ? scope.target.getInputs()
+                : i == 1 ? scope.target.getOutputs() : scope.target.getDependencies();
+            if (!scope.globLists)
+            {
+                scope.lists[i] = joinList(items);
+            }
+            else
+            {
+                std::vector<std::string> expanded;
+                for (const auto& item : items)
+                {
+                    const auto& matches = expandGlob(item);
+                    expanded.insert(expanded.end(), matches.begin(), matches.end());
+                }
+                scope.lists[i] = joinList(expanded);
+            }
         }
+        return std::string_view(*scope.lists[i]);
     }
 
-    auto itVar = vars.find(expr);
-    if (itVar != vars.end())
+    const auto it = scope.vars.find(name);
+    if (it != scope.vars.end())
     {
-        return itVar->second;
+        return it->second;
     }
-    return expr;
+    return std::nullopt;
 }
 
-std::string Parser::expandVariables(
-    const std::string& input,
-    const std::unordered_map<std::string, std::string>& vars,
-    const std::unordered_map<std::string, std::string>& cfg)
+void Parser::evaluateExpression(std::string_view expr, VariableScope& scope, std::string& out, const int depth)
 {
-    std::string out = input;
-
-    std::regex varPattern(R"(\$\{(\w+)\})");
-    std::smatch m;
-    std::string tmp;
-    while (std::regex_search(out, m, varPattern))
+    if (const auto ternary = parseTernary(expr))
     {
-        tmp = evaluateExpression(m[1].str(), vars, cfg);
-        out.replace(m.position(0), m.length(0), tmp);
+        const auto itCfg = scope.cfg.find(ternary->configKey);
+        const bool matches = itCfg != scope.cfg.end() && itCfg->second == ternary->configValue;
+        if (const auto value = lookupVariable(matches ? ternary->whenTrue : ternary->whenFalse, scope))
+        {
+            expandInto(*value, scope, out, depth + 1);
+        }
+        return;
     }
 
-    std::regex exprPattern(R"(\$\{\{([^\}]+)\}\})");
-    while (std::regex_search(out, m, exprPattern))
+    if (const auto value = lookupVariable(expr, scope))
     {
-        tmp = evaluateExpression(m[1].str(), vars, cfg);
-        out.replace(m.position(0), m.length(0), tmp);
+        expandInto(*value, scope, out, depth + 1);
+        return;
     }
-
-    return out;
+    out.append(expr);
 }
 
-std::vector<std::string> Parser::expandGlob(const std::string& pattern)
+void Parser::expandInto(std::string_view input, VariableScope& scope, std::string& out, const int depth)
 {
-    std::vector<std::string> files;
+    if (depth > MAX_EXPANSION_DEPTH)
+    {
+        out.append(input);
+        return;
+    }
 
-    if (pattern.find("**") != std::string::npos)
+    size_t pos = 0;
+    while (true)
     {
-        std::string base = pattern.substr(0, pattern.find("**"));
-        std::error_code ec;
-        if (fs::exists(base, ec))
+        const size_t dollar = input.find("${", pos);
+        if (dollar == std::string_view::npos)
         {
-            for (const auto& p : fs::recursive_directory_iterator(base, ec))
+            out.append(input.substr(pos));
+            return;
+        }
+        out.append(input.substr(pos, dollar - pos));
+
+        const size_t open = dollar + 2;
+        if (open < input.size() && input[open] == '{')
+        {
+            // ${{expression}}: no braces inside, closed by "}}"
+            const size_t close = input.find('}', open + 1);
+            if (close != std::string_view::npos && close > open + 1
+                && close + 1 < input.size() && input[close + 1] == '}')
             {
-                if (fs::is_regular_file(p, ec))
-                {
-                    files.push_back(p.path().string());
-                }
+                evaluateExpression(input.substr(open + 1, close - open - 1), scope, out, depth);
+                pos = close + 2;
+                continue;
             }
         }
-    }
-    else
-    {
-        std::error_code ec;
-        if (fs::exists(pattern, ec))
+        else
         {
-            files.push_back(pattern);
+            // ${name}
+            size_t end = open;
+            while (end < input.size() && isWordChar(input[end]))
+            {
+                ++end;
+            }
+            if (end > open && end < input.size() && input[end] == '}')
+            {
+                evaluateExpression(input.substr(open, end - open), scope, out, depth);
+                pos = end + 1;
+                continue;
+            }
         }
+
+        out.push_back('$');
+        pos = dollar + 1;
     }
+}
 
-    return files;
+std::string Parser::expandVariables(std::string_view input, VariableScope& scope)
+{
+    std::string out;
+    out.reserve(input.size());
+    expandInto(input, scope, out, 0);
+    return out;
+}
+
+const std::vector<std::string>& Parser::expandGlob(const std::string& pattern)
+{
+    const auto known = globs_.find(pattern);
+    if (known != globs_.end())
+    {
+        return known->second;
+    }
+    return globs_.emplace(pattern, globEngine().expand(pattern)).first->second;
+}
+
+GlobEngine& Parser::globEngine()
+{
+    if (!globEngine_)
+    {
+        globEngine_ = std::make_shared<GlobEngine>(std::max(1u, std::thread::hardware_concurrency()));
+    }
+    return *globEngine_;
 }
 
 std::string Parser::joinList(const std::vector<std::string>& list)
 {
-    std::ostringstream oss;
+    std::string joined;
     for (size_t i = 0; i < list.size(); ++i)
     {
         if (i > 0)
         {
-            oss << " ";
+            joined.push_back(' ');
         }
-        oss << list[i];
+        joined.append(list[i]);
     }
-    return oss.str();
-}
\ No newline at end of file
+    return joined;
+}
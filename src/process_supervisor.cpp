@@ -0,0 +1,120 @@
+#include "mimir/process_supervisor.h"
+
+#ifndef _WIN32
+#include <signal.h>
+#endif
+
+using namespace mimir;
+
+ProcessSupervisor& ProcessSupervisor::instance()
+{
+    static ProcessSupervisor supervisor;
+    return supervisor;
+}
+
+ProcessSupervisor::ProcessSupervisor(const std::chrono::milliseconds killGrace)
+    : killGrace_(killGrace)
+    , nextToken_(1)
+    , stopping_(false)
+{
+    thread_ = std::thread(&ProcessSupervisor::run, this);
+}
+
+ProcessSupervisor::~ProcessSupervisor()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    thread_.join();
+}
+
+ProcessSupervisor::Token ProcessSupervisor::watch(const int processGroup, const Clock::time_point deadline)
+{
+    Token token;
+    bool earliest;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        token = nextToken_++;
+        watches_.emplace(token, Watch{processGroup, false});
+        earliest = heap_.empty() || deadline < heap_.top().when;
+        heap_.push(Deadline{deadline, token});
+    }
+    // Only a new earliest deadline changes how long the thread should sleep
+    if (earliest)
+    {
+        cv_.notify_one();
+    }
+    return token;
+}
+
+bool ProcessSupervisor::release(const Token token)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = watches_.find(token);
+    if (it == watches_.end())
+    {
+        return false;
+    }
+    const bool expired = it->second.expired;
+    watches_.erase(it);
+    return expired;
+}
+
+size_t ProcessSupervisor::signalAll(const int signal)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+#ifndef _WIN32
+    for (const auto& [token, watch] : watches_)
+    {
+        ::kill(-watch.processGroup, signal);
+    }
+#else
+    (void)signal;
+#endif
+    return watches_.size();
+}
+
+size_t ProcessSupervisor::watchedCount() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return watches_.size();
+}
+
+void ProcessSupervisor::run()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_)
+    {
+        if (heap_.empty())
+        {
+            cv_.wait(lock);
+            continue;
+        }
+
+        const Deadline next = heap_.top();
+        if (Clock::now() < next.when)
+        {
+            cv_.wait_until(lock, next.when);
+            continue;
+        }
+        heap_.pop();
+
+        const auto it = watches_.find(next.token);
+        if (it == watches_.end())
+        {
+            continue;
+        }
+
+        Watch& watch = it->second;
+#ifndef _WIN32
+        ::kill(-watch.processGroup, watch.expired ? SIGKILL : SIGTERM);
+#endif
+        if (!watch.expired)
+        {
+            watch.expired = true;
+            heap_.push(Deadline{Clock::now() + killGrace_, next.token});
+        }
+    }
+}
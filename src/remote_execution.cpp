@@ -0,0 +1,988 @@
+#include "mimir/remote_execution.h"
+#include "mimir/hasher.h"
+#include "mimir/socket_io.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+using namespace mimir;
+
+namespace
+{
+    /// How long a worker that failed is skipped
+    constexpr std::int64_t RETRY_DELAY_MS = 30000;
+
+    /// Time a client has to send its whole request
+    constexpr int REQUEST_TIMEOUT_MS = 30000;
+
+    /// Slack on top of a command's own time limit before the reply is given up on
+    constexpr int REPLY_GRACE_SECONDS = 60;
+
+    std::int64_t nowMs()
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    double secondsSince(const std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    std::string frame(const char tag, const std::string_view payload)
+    {
+        std::string out(1, tag);
+        out += ' ';
+        out += std::to_string(payload.size());
+        out += '\n';
+        out.append(payload.data(), payload.size());
+        return out;
+    }
+
+    std::string octal(const unsigned value)
+    {
+        std::ostringstream out;
+        out << std::oct << value;
+        return out.str();
+    }
+
+    /// True for a relative path that cannot climb out of the directory it is resolved against
+    bool staysInside(const std::string& path)
+    {
+        if (path.empty())
+        {
+            return false;
+        }
+        const fs::path normal = fs::path(path).lexically_normal();
+        if (normal.is_absolute() || normal.has_root_name() || normal.empty())
+        {
+            return false;
+        }
+        const std::string first = normal.begin()->string();
+        return first != ".." && first != ".";
+    }
+
+    /// Compare secrets without an early exit that would leak how much of a guess matched
+    bool sameSecret(const std::string& given, const std::string& expected)
+    {
+        if (given.size() != expected.size() || expected.empty())
+        {
+            return false;
+        }
+        unsigned char difference = 0;
+        for (size_t i = 0; i < given.size(); ++i)
+        {
+            difference |= static_cast<unsigned char>(given[i] ^ expected[i]);
+        }
+        return difference == 0;
+    }
+
+    /// Read a frame's payload, refusing lengths past its limit before anything is buffered
+    bool readPayload(SocketReader& reader, std::istringstream& fields, const size_t limit, std::string& payload)
+    {
+        size_t length = 0;
+        return static_cast<bool>(fields >> length) && length <= limit && reader.readExact(length, payload);
+    }
+
+    bool isDigest(const std::string& text)
+    {
+        return text.size() == 64 && std::all_of(text.begin(), text.end(), [](const char c)
+        {
+            return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f');
+        });
+    }
+
+    unsigned modeOf(const std::string& path)
+    {
+        std::error_code ec;
+        const auto perms = fs::status(path, ec).permissions();
+        return ec ? 0644u : static_cast<unsigned>(perms & fs::perms::mask);
+    }
+
+    std::optional<std::string> readWholeFile(const std::string& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+        {
+            return std::nullopt;
+        }
+        std::ostringstream contents;
+        contents << file.rdbuf();
+        if (file.bad())
+        {
+            return std::nullopt;
+        }
+        return std::move(contents).str();
+    }
+
+    bool writeFileAtomically(const std::string& path, const std::string_view data, const std::optional<unsigned> mode)
+    {
+        std::error_code ec;
+        const fs::path target(path);
+        if (target.has_parent_path())
+        {
+            fs::create_directories(target.parent_path(), ec);
+        }
+
+        // Unique per process and call, so concurrent writers of one file never share a temp file
+        static std::atomic<unsigned> counter{0};
+        std::string tmpPath = path + ".tmp.";
+#ifndef _WIN32
+        tmpPath += std::to_string(::getpid()) + ".";
+#endif
+        tmpPath += std::to_string(counter.fetch_add(1));
+        {
+            std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+            if (!out)
+            {
+                return false;
+            }
+            out.write(data.data(), static_cast<std::streamsize>(data.size()));
+            if (!out.flush())
+            {
+                out.close();
+                fs::remove(tmpPath, ec);
+                return false;
+            }
+        }
+        if (mode)
+        {
+            fs::permissions(tmpPath, static_cast<fs::perms>(*mode) & fs::perms::mask, ec);
+        }
+        fs::rename(tmpPath, path, ec);
+        if (ec)
+        {
+            fs::remove(tmpPath, ec);
+            return false;
+        }
+        return true;
+    }
+
+#ifndef _WIN32
+    int connectEndpoint(const RemoteEndpoint& endpoint, const int timeoutMs)
+    {
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo* addresses = nullptr;
+        const std::string port = std::to_string(endpoint.port);
+        if (getaddrinfo(endpoint.host.c_str(), port.c_str(), &hints, &addresses) != 0)
+        {
+            return -1;
+        }
+
+        timeval timeout{};
+        timeout.tv_sec = timeoutMs / 1000;
+        timeout.tv_usec = (timeoutMs % 1000) * 1000;
+        int fd = -1;
+        for (addrinfo* ai = addresses; ai != nullptr; ai = ai->ai_next)
+        {
+            fd = ::socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+            if (fd < 0)
+            {
+                continue;
+            }
+            setCloseOnExec(fd);
+            // SO_SNDTIMEO also bounds connect() on Linux; keepalive notices a worker that vanished mid-command
+            const int enable = 1;
+            ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+            ::setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &enable, sizeof(enable));
+            if (::connect(fd, ai->ai_addr, ai->ai_addrlen) == 0)
+            {
+                break;
+            }
+            ::close(fd);
+            fd = -1;
+        }
+        freeaddrinfo(addresses);
+        return fd;
+    }
+#endif
+}
+
+std::optional<RemoteEndpoint> RemoteEndpoint::parse(std::string_view text)
+{
+    RemoteEndpoint endpoint;
+    const size_t colon = text.rfind(':');
+    if (colon != std::string_view::npos)
+    {
+        const std::string portText(text.substr(colon + 1));
+        char* end = nullptr;
+        const unsigned long port = std::strtoul(portText.c_str(), &end, 10);
+        if (portText.empty() || *end != '\0' || port == 0 || port > 65535)
+        {
+            return std::nullopt;
+        }
+        endpoint.port = static_cast<std::uint16_t>(port);
+        text = text.substr(0, colon);
+    }
+    if (text.empty())
+    {
+        return std::nullopt;
+    }
+    endpoint.host = std::string(text);
+    return endpoint;
+}
+
+std::optional<std::vector<RemoteEndpoint>> RemoteEndpoint::parseList(std::string_view text)
+{
+    std::vector<RemoteEndpoint> endpoints;
+    while (true)
+    {
+        const size_t comma = text.find(',');
+        const auto endpoint = parse(text.substr(0, comma));
+        if (!endpoint)
+        {
+            return std::nullopt;
+        }
+        endpoints.push_back(*endpoint);
+        if (comma == std::string_view::npos)
+        {
+            return endpoints;
+        }
+        text.remove_prefix(comma + 1);
+    }
+}
+
+std::string RemoteEndpoint::describe() const
+{
+    return host + ":" + std::to_string(port);
+}
+
+RemoteCommandRunner::RemoteCommandRunner(
+    std::vector<RemoteEndpoint> workers,
+    ArtifactBackendPtr backend,
+    std::string token,
+    CommandRunnerPtr local,
+    const int connectTimeoutMs)
+    : workers_(std::move(workers))
+    , backend_(std::move(backend))
+    , token_(std::move(token))
+    , local_(local ? std::move(local) : createDefaultCommandRunner())
+    , connectTimeoutMs_(connectTimeoutMs)
+    , states_(workers_.size())
+{
+}
+
+CommandResult RemoteCommandRunner::run(const std::string& command, const CommandOptions& options)
+{
+    if (workers_.empty() || !backend_ || !isShippable(options))
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            ++stats_.localRuns;
+        }
+        return local_->run(command, options);
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<Input> inputs;
+    if (uploadInputs(options, inputs))
+    {
+        const double uploadSeconds = secondsSince(start);
+        std::string request = frame('A', token_) + frame('C', command);
+        if (options.timeoutSeconds)
+        {
+            request += "T " + std::to_string(*options.timeoutSeconds) + "\n";
+        }
+        request += "L " + std::to_string(options.maxCaptureBytes) + "\n";
+        for (const auto& [name, value] : options.environment)
+        {
+            request += frame('V', name + "=" + value);
+        }
+        for (const auto& input : inputs)
+        {
+            request += "I " + input.digest + " " + octal(input.mode) + " " + std::to_string(input.path.size())
+                + "\n" + input.path;
+        }
+        for (const auto& output : options.outputs)
+        {
+            request += frame('O', output);
+        }
+        request += "G\n";
+
+        std::vector<bool> tried(workers_.size(), false);
+        while (const auto index = acquireWorker(tried))
+        {
+            tried[*index] = true;
+            CommandResult result{-1, "", "", false};
+            const bool ok = runOn(workers_[*index], request, options, result);
+            releaseWorker(*index, !ok);
+            if (!ok)
+            {
+                continue;
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                ++stats_.remoteRuns;
+            }
+            result.spawnSeconds += uploadSeconds;
+            if (!options.captureOutput)
+            {
+                // Nothing was passed through as it happened, so show it now
+                std::cout << result.stdOut << std::flush;
+                std::cerr << result.stdErr << std::flush;
+                result.stdOut.clear();
+                result.stdErr.clear();
+            }
+            return result;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++stats_.fallbacks;
+    }
+    return local_->run(command, options);
+}
+
+bool RemoteCommandRunner::runSimple(const std::string& command)
+{
+    return local_->runSimple(command);
+}
+
+bool RemoteCommandRunner::isShippable(const CommandOptions& options)
+{
+    return options.hermetic && options.workingDir.empty()
+        && std::all_of(options.inputs.begin(), options.inputs.end(), staysInside)
+        && std::all_of(options.outputs.begin(), options.outputs.end(), staysInside);
+}
+
+RemoteExecutionStats RemoteCommandRunner::getStats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+const std::vector<RemoteEndpoint>& RemoteCommandRunner::getWorkers() const noexcept
+{
+    return workers_;
+}
+
+bool RemoteCommandRunner::uploadInputs(const CommandOptions& options, std::vector<Input>& inputs)
+{
+    std::unordered_set<std::string> seen;
+    for (const auto& path : options.inputs)
+    {
+        if (!seen.insert(path).second)
+        {
+            continue;
+        }
+        std::optional<std::string> raw;
+        const auto digest = digestOf(path, raw);
+        if (!digest)
+        {
+            return false;
+        }
+        inputs.push_back(Input{path, *digest, modeOf(path)});
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stored_.count(*digest) != 0)
+            {
+                continue;
+            }
+        }
+
+        const std::string key = "cas/" + *digest;
+        if (backend_->contains(key))
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stored_.insert(*digest);
+            ++stats_.blobsReused;
+            continue;
+        }
+        if (!raw)
+        {
+            raw = readWholeFile(path);
+            if (!raw || Hasher::hashHex(HashAlgorithm::SHA256, *raw) != *digest)
+            {
+                return false;
+            }
+        }
+        const std::string blob = ArtifactStore::encodeBlob(*raw);
+        if (!backend_->store(key, blob))
+        {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        stored_.insert(*digest);
+        ++stats_.blobsUploaded;
+        stats_.bytesUploaded += blob.size();
+    }
+    return true;
+}
+
+std::optional<std::string> RemoteCommandRunner::digestOf(const std::string& path, std::optional<std::string>& raw)
+{
+    const auto stamp = statFile(path);
+    if (!stamp)
+    {
+        return std::nullopt;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto it = digests_.find(path);
+        if (it != digests_.end() && it->second.first == *stamp)
+        {
+            return it->second.second;
+        }
+    }
+
+    raw = readWholeFile(path);
+    if (!raw)
+    {
+        return std::nullopt;
+    }
+    std::string digest = Hasher::hashHex(HashAlgorithm::SHA256, *raw);
+    // A file modified within the timestamp granularity could still change unseen
+    if (currentTimeNs() - stamp->mtimeNs > 1000000000)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        digests_[path] = {*stamp, digest};
+    }
+    return digest;
+}
+
+std::optional<size_t> RemoteCommandRunner::acquireWorker(const std::vector<bool>& tried)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    const std::int64_t now = nowMs();
+    std::optional<size_t> best;
+    for (size_t i = 0; i < states_.size(); ++i)
+    {
+        if (tried[i] || states_[i].downUntilMs > now)
+        {
+            continue;
+        }
+        if (!best || states_[i].inFlight < states_[*best].inFlight)
+        {
+            best = i;
+        }
+    }
+    if (best)
+    {
+        ++states_[*best].inFlight;
+    }
+    return best;
+}
+
+void RemoteCommandRunner::releaseWorker(const size_t index, const bool failed)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    --states_[index].inFlight;
+    if (failed)
+    {
+        states_[index].downUntilMs = nowMs() + RETRY_DELAY_MS;
+    }
+}
+
+#ifndef _WIN32
+bool RemoteCommandRunner::runOn(const RemoteEndpoint& worker, const std::string& request,
+    const CommandOptions& options, CommandResult& result)
+{
+    const auto start = std::chrono::steady_clock::now();
+    const int fd = connectEndpoint(worker, connectTimeoutMs_);
+    if (fd < 0)
+    {
+        return false;
+    }
+    if (!sendAll(fd, request))
+    {
+        ::close(fd);
+        return false;
+    }
+    result.spawnSeconds = secondsSince(start);
+
+    // The reply only comes once the command finished, so wait as long as it may run
+    const int replyTimeoutMs = options.timeoutSeconds ? (*options.timeoutSeconds + REPLY_GRACE_SECONDS) * 1000 : -1;
+    SocketReader reader(fd, replyTimeoutMs);
+    struct Output
+    {
+        std::string path;
+        std::string contents;
+        unsigned mode;
+    };
+    std::vector<Output> outputs;
+    size_t downloaded = 0;
+    bool ok = true;
+    bool finished = false;
+    std::string line;
+    while (ok && !finished && reader.readLine(line))
+    {
+        if (line.size() < 3 || line[1] != ' ')
+        {
+            ok = false;
+            break;
+        }
+        std::istringstream fields(line.substr(2));
+        switch (line[0])
+        {
+            case 'S':
+            case 'E':
+            {
+                size_t length = 0;
+                std::string data;
+                ok = static_cast<bool>(fields >> length) && reader.readExact(length, data);
+                (line[0] == 'S' ? result.stdOut : result.stdErr) = std::move(data);
+                break;
+            }
+            case 'F':
+            {
+                unsigned mode = 0;
+                size_t pathLength = 0;
+                size_t blobLength = 0;
+                std::string path;
+                std::string blob;
+                ok = static_cast<bool>(fields >> std::oct >> mode >> std::dec >> pathLength >> blobLength)
+                    && reader.readExact(pathLength, path) && reader.readExact(blobLength, blob)
+                    && std::find(options.outputs.begin(), options.outputs.end(), path) != options.outputs.end();
+                auto contents = ok ? ArtifactStore::decodeBlob(blob) : std::nullopt;
+                ok = ok && contents.has_value();
+                if (ok)
+                {
+                    downloaded += blob.size();
+                    outputs.push_back(Output{std::move(path), std::move(*contents), mode});
+                }
+                break;
+            }
+            case 'X':
+            {
+                int timedOut = 0;
+                ok = static_cast<bool>(fields >> result.exitCode >> timedOut >> result.usage.userSeconds
+                    >> result.usage.systemSeconds >> result.usage.maxRssKb >> result.droppedBytes);
+                result.timedOut = timedOut != 0;
+                finished = ok;
+                break;
+            }
+            case 'R':
+            {
+                // The store lost a blob we thought it had; upload it again next time
+                std::string reason;
+                std::string digest;
+                if (fields >> reason >> digest && reason == "missing")
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    stored_.erase(digest);
+                }
+                ok = false;
+                break;
+            }
+            default:
+                ok = false;
+        }
+    }
+    ::close(fd);
+    if (!ok || !finished)
+    {
+        return false;
+    }
+
+    for (const auto& output : outputs)
+    {
+        if (!writeFileAtomically(output.path, output.contents, output.mode))
+        {
+            result.stdErr += "mimir: cannot write output '" + output.path + "' from " + worker.describe() + "\n";
+            result.exitCode = result.exitCode == 0 ? 1 : result.exitCode;
+        }
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.bytesDownloaded += downloaded;
+    return true;
+}
+#else
+bool RemoteCommandRunner::runOn(const RemoteEndpoint&, const std::string&, const CommandOptions&, CommandResult&)
+{
+    return false;
+}
+#endif
+
+RemoteWorker::RemoteWorker(RemoteWorkerOptions options, ArtifactBackendPtr backend, CommandRunnerPtr runner)
+    : options_(std::move(options))
+    , backend_(std::move(backend))
+    , runner_(runner ? std::move(runner) : createDefaultCommandRunner())
+{
+}
+
+RemoteWorker::~RemoteWorker()
+{
+    stop();
+    // Joins the pool, so no action outlives the sockets and directories it uses
+    pool_.reset();
+#ifndef _WIN32
+    for (const int fd : {listenFd_, wakeRead_, wakeWrite_})
+    {
+        if (fd >= 0)
+        {
+            ::close(fd);
+        }
+    }
+#endif
+}
+
+std::uint16_t RemoteWorker::port() const noexcept
+{
+    return port_;
+}
+
+size_t RemoteWorker::actionsRun() const noexcept
+{
+    return actions_.load();
+}
+
+std::optional<std::string> RemoteWorker::cachedBlob(const std::string& digest)
+{
+    const std::string path = (fs::path(options_.workDir) / "cas" / digest.substr(0, 2) / digest).string();
+    std::error_code ec;
+    if (fs::is_regular_file(path, ec))
+    {
+        return path;
+    }
+    const auto blob = backend_->fetch("cas/" + digest);
+    if (!blob)
+    {
+        return std::nullopt;
+    }
+    const auto raw = ArtifactStore::decodeBlob(*blob);
+    if (!raw || Hasher::hashHex(HashAlgorithm::SHA256, *raw) != digest)
+    {
+        return std::nullopt;
+    }
+    // Concurrent fetches of one blob each rename a complete copy into place
+    if (!writeFileAtomically(path, *raw, std::nullopt))
+    {
+        return std::nullopt;
+    }
+    return path;
+}
+
+#ifndef _WIN32
+std::optional<std::string> RemoteWorker::start()
+{
+    if (!backend_)
+    {
+        return std::string("A remote worker needs a content store");
+    }
+    if (options_.token.empty() || options_.token.size() > MAX_REMOTE_TOKEN_BYTES)
+    {
+        return "A remote worker needs a token of 1 to " + std::to_string(MAX_REMOTE_TOKEN_BYTES) + " bytes";
+    }
+    std::error_code ec;
+    const fs::path actions = fs::path(options_.workDir) / "actions";
+    // Sandboxes left behind by a killed worker are garbage
+    fs::remove_all(actions, ec);
+    fs::create_directories(actions, ec);
+    fs::create_directories(fs::path(options_.workDir) / "cas", ec);
+    if (ec)
+    {
+        return "Cannot create " + options_.workDir + ": " + ec.message();
+    }
+
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    addrinfo* addresses = nullptr;
+    const std::string port = std::to_string(options_.port);
+    const char* host = options_.bindAddress.empty() ? nullptr : options_.bindAddress.c_str();
+    if (getaddrinfo(host, port.c_str(), &hints, &addresses) != 0 || addresses == nullptr)
+    {
+        return "Cannot resolve " + options_.bindAddress;
+    }
+    std::string error = "Cannot listen on " + options_.bindAddress + ":" + port;
+    for (addrinfo* ai = addresses; ai != nullptr && listenFd_ < 0; ai = ai->ai_next)
+    {
+        const int fd = ::socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0)
+        {
+            continue;
+        }
+        setCloseOnExec(fd);
+        const int enable = 1;
+        ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+        if (::bind(fd, ai->ai_addr, ai->ai_addrlen) != 0 || ::listen(fd, 64) != 0)
+        {
+            error += std::string(": ") + std::strerror(errno);
+            ::close(fd);
+            continue;
+        }
+        listenFd_ = fd;
+    }
+    freeaddrinfo(addresses);
+    if (listenFd_ < 0)
+    {
+        return error;
+    }
+
+    sockaddr_storage bound{};
+    socklen_t length = sizeof(bound);
+    if (::getsockname(listenFd_, reinterpret_cast<sockaddr*>(&bound), &length) == 0)
+    {
+        const std::uint16_t networkPort = bound.ss_family == AF_INET6
+            ? reinterpret_cast<const sockaddr_in6*>(&bound)->sin6_port
+            : reinterpret_cast<const sockaddr_in*>(&bound)->sin_port;
+        port_ = ntohs(networkPort);
+    }
+
+    int wakeFds[2];
+    if (::pipe(wakeFds) != 0)
+    {
+        return std::string("Cannot create wake pipe: ") + std::strerror(errno);
+    }
+    wakeRead_ = wakeFds[0];
+    wakeWrite_ = wakeFds[1];
+    for (const int fd : wakeFds)
+    {
+        setCloseOnExec(fd);
+        ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+    }
+
+    const size_t jobs = options_.maxJobs > 0 ? options_.maxJobs : std::max(1u, std::thread::hardware_concurrency());
+    pool_ = std::make_unique<ThreadPool>(jobs);
+    return std::nullopt;
+}
+
+void RemoteWorker::serve()
+{
+    while (!stopping_.load() && listenFd_ >= 0)
+    {
+        pollfd fds[2] = {
+            {listenFd_, POLLIN, 0},
+            {wakeRead_, POLLIN, 0},
+        };
+        if (::poll(fds, 2, -1) < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            break;
+        }
+        if ((fds[0].revents & POLLIN) != 0)
+        {
+            const int client = ::accept(listenFd_, nullptr, nullptr);
+            if (client >= 0)
+            {
+                setCloseOnExec(client);
+                // Connections beyond maxJobs wait in the pool's queue
+                pool_->submit([this, client]() { handleClient(client); });
+            }
+        }
+    }
+
+    if (listenFd_ >= 0)
+    {
+        ::close(listenFd_);
+        listenFd_ = -1;
+    }
+}
+
+void RemoteWorker::stop() noexcept
+{
+    stopping_.store(true);
+    if (wakeWrite_ >= 0)
+    {
+        const char byte = 0;
+        const ssize_t written = ::write(wakeWrite_, &byte, 1);
+        (void)written;
+    }
+}
+
+void RemoteWorker::handleClient(const int fd)
+{
+    SocketReader reader(fd, REQUEST_TIMEOUT_MS, MAX_REMOTE_REQUEST_BYTES);
+    const auto reject = [fd](const std::string& reason)
+    {
+        sendAll(fd, "R " + reason + "\n");
+        ::close(fd);
+    };
+
+    // Nothing else is read from a client that does not know the token
+    std::string line;
+    std::string token;
+    if (!reader.readLine(line) || line.rfind("A ", 0) != 0)
+    {
+        reject("unauthorized");
+        return;
+    }
+    std::istringstream header(line.substr(2));
+    if (!readPayload(reader, header, MAX_REMOTE_TOKEN_BYTES, token) || !sameSecret(token, options_.token))
+    {
+        reject("unauthorized");
+        return;
+    }
+
+    std::string command;
+    CommandOptions runOptions;
+    runOptions.captureOutput = true;
+    std::vector<std::pair<std::string, std::pair<std::string, unsigned>>> inputs;   // path -> digest, mode
+    std::vector<std::string> outputs;
+    bool complete = false;
+    while (!complete && reader.readLine(line))
+    {
+        if (line == "G")
+        {
+            complete = true;
+            break;
+        }
+        if (line.size() < 3 || line[1] != ' ')
+        {
+            break;
+        }
+        std::istringstream fields(line.substr(2));
+        std::string payload;
+        bool ok = true;
+        switch (line[0])
+        {
+            case 'C':
+                ok = readPayload(reader, fields, MAX_REMOTE_COMMAND_BYTES, command);
+                break;
+            case 'T':
+            {
+                int seconds = 0;
+                ok = static_cast<bool>(fields >> seconds) && seconds > 0;
+                runOptions.timeoutSeconds = seconds;
+                break;
+            }
+            case 'L':
+            {
+                // Whatever the client asks for, the worker holds at most its own limit per stream
+                size_t limit = 0;
+                ok = static_cast<bool>(fields >> limit) && limit > 0;
+                runOptions.maxCaptureBytes = std::min(limit, MAX_REMOTE_CAPTURE_BYTES);
+                break;
+            }
+            case 'V':
+            {
+                ok = readPayload(reader, fields, MAX_REMOTE_VARIABLE_BYTES, payload);
+                const size_t equals = payload.find('=');
+                ok = ok && equals != std::string::npos && equals > 0;
+                if (ok)
+                {
+                    runOptions.environment.emplace_back(payload.substr(0, equals), payload.substr(equals + 1));
+                }
+                break;
+            }
+            case 'I':
+            {
+                std::string digest;
+                unsigned mode = 0;
+                ok = static_cast<bool>(fields >> digest >> std::oct >> mode >> std::dec)
+                    && readPayload(reader, fields, MAX_REMOTE_PATH_BYTES, payload)
+                    && isDigest(digest) && staysInside(payload);
+                inputs.emplace_back(payload, std::make_pair(digest, mode));
+                break;
+            }
+            case 'O':
+                ok = readPayload(reader, fields, MAX_REMOTE_PATH_BYTES, payload) && staysInside(payload);
+                outputs.push_back(payload);
+                break;
+            default:
+                ok = false;
+        }
+        if (!ok)
+        {
+            break;
+        }
+    }
+    if (!complete || command.empty())
+    {
+        reject("malformed request");
+        return;
+    }
+
+    const fs::path sandbox = fs::path(options_.workDir) / "actions" / std::to_string(nextSandbox_.fetch_add(1));
+    std::error_code ec;
+    fs::remove_all(sandbox, ec);
+    fs::create_directories(sandbox, ec);
+    for (const auto& [path, blob] : inputs)
+    {
+        const auto cached = cachedBlob(blob.first);
+        if (!cached)
+        {
+            fs::remove_all(sandbox, ec);
+            reject("missing " + blob.first);
+            return;
+        }
+        // Copied rather than linked, so a command that writes an input can't corrupt the cache
+        const fs::path destination = sandbox / path;
+        fs::create_directories(destination.parent_path(), ec);
+        fs::copy_file(*cached, destination, fs::copy_options::overwrite_existing, ec);
+        fs::permissions(destination, static_cast<fs::perms>(blob.second) & fs::perms::mask, ec);
+        if (ec)
+        {
+            fs::remove_all(sandbox, ec);
+            reject("cannot stage " + path);
+            return;
+        }
+    }
+    for (const auto& output : outputs)
+    {
+        fs::create_directories((sandbox / output).parent_path(), ec);
+    }
+
+    runOptions.workingDir = sandbox.string();
+    const CommandResult result = runner_->run(command, runOptions);
+    ++actions_;
+
+    std::string reply = frame('S', result.stdOut) + frame('E', result.stdErr);
+    for (const auto& output : outputs)
+    {
+        const std::string produced = (sandbox / output).string();
+        if (!fs::is_regular_file(produced, ec))
+        {
+            continue;
+        }
+        const auto raw = readWholeFile(produced);
+        if (!raw)
+        {
+            continue;
+        }
+        const std::string blob = ArtifactStore::encodeBlob(*raw);
+        reply += "F " + octal(modeOf(produced)) + " " + std::to_string(output.size()) + " "
+            + std::to_string(blob.size()) + "\n" + output + blob;
+    }
+    std::ostringstream exit;
+    exit << "X " << result.exitCode << ' ' << (result.timedOut ? 1 : 0) << ' ' << result.usage.userSeconds << ' '
+         << result.usage.systemSeconds << ' ' << result.usage.maxRssKb << ' ' << result.droppedBytes << '\n';
+    reply += exit.str();
+    fs::remove_all(sandbox, ec);
+    sendAll(fd, reply);
+    ::close(fd);
+}
+#else
+std::optional<std::string> RemoteWorker::start()
+{
+    return std::string("Remote workers need POSIX sockets, which this platform lacks");
+}
+
+void RemoteWorker::serve()
+{
+}
+
+void RemoteWorker::stop() noexcept
+{
+    stopping_.store(true);
+}
+
+void RemoteWorker::handleClient(int)
+{
+}
+#endif
@@ -0,0 +1,283 @@
+#include "mimir/hasher.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define MIMIR_SHA256_X86 1
+#include <cpuid.h>
+#include <immintrin.h>
+#elif defined(__aarch64__) && (defined(__ARM_FEATURE_SHA2) || defined(__ARM_FEATURE_CRYPTO))
+#define MIMIR_SHA256_ARM 1
+#include <arm_neon.h>
+#endif
+
+using namespace mimir;
+
+namespace
+{
+    alignas(16) constexpr std::uint32_t K[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+    };
+
+    constexpr std::uint32_t H0[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+    };
+
+    inline std::uint32_t rotr(std::uint32_t x, int n) noexcept
+    {
+        return (x >> n) | (x << (32 - n));
+    }
+
+    inline std::uint32_t loadBE32(const std::uint8_t* p) noexcept
+    {
+        return (static_cast<std::uint32_t>(p[0]) << 24) | (static_cast<std::uint32_t>(p[1]) << 16)
+            | (static_cast<std::uint32_t>(p[2]) << 8) | static_cast<std::uint32_t>(p[3]);
+    }
+
+    void compressPortable(std::uint32_t h[8], const std::uint8_t* data, size_t blocks) noexcept
+    {
+        std::uint32_t w[64];
+        while (blocks-- > 0)
+        {
+            for (int i = 0; i < 16; ++i)
+            {
+                w[i] = loadBE32(data + 4 * i);
+            }
+            for (int i = 16; i < 64; ++i)
+            {
+                const std::uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+                const std::uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+                w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+            }
+
+            std::uint32_t a = h[0], b = h[1], c = h[2], d = h[3];
+            std::uint32_t e = h[4], f = h[5], g = h[6], k = h[7];
+            for (int i = 0; i < 64; ++i)
+            {
+                const std::uint32_t S1 = rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25);
+                const std::uint32_t ch = (e & f) ^ (~e & g);
+                const std::uint32_t t1 = k + S1 + ch + K[i] + w[i];
+                const std::uint32_t S0 = rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22);
+                const std::uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+                const std::uint32_t t2 = S0 + maj;
+                k = g;
+                g = f;
+                f = e;
+                e = d + t1;
+                d = c;
+                c = b;
+                b = a;
+                a = t1 + t2;
+            }
+            h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+            h[4] += e; h[5] += f; h[6] += g; h[7] += k;
+            data += 64;
+        }
+    }
+
+#if defined(MIMIR_SHA256_X86)
+    __attribute__((target("sha,sse4.1,ssse3")))
+    void compressShaNi(std::uint32_t h[8], const std::uint8_t* data, size_t blocks) noexcept
+    {
+        const __m128i shuffleMask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+        // The SHA extensions operate on the state as ABEF / CDGH pairs
+        __m128i tmp = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&h[0]));
+        __m128i state1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&h[4]));
+        tmp = _mm_shuffle_epi32(tmp, 0xB1);
+        state1 = _mm_shuffle_epi32(state1, 0x1B);
+        __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);
+        state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+
+        while (blocks-- > 0)
+        {
+            const __m128i abefSave = state0;
+            const __m128i cdghSave = state1;
+            __m128i msgs[4];
+
+            for (int g = 0; g < 16; ++g)
+            {
+                if (g < 4)
+                {
+                    msgs[g] = _mm_shuffle_epi8(
+                        _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16 * g)), shuffleMask);
+                }
+
+                __m128i msg = _mm_add_epi32(msgs[g % 4], _mm_load_si128(reinterpret_cast<const __m128i*>(&K[4 * g])));
+                state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+                if (g >= 3 && g < 15)
+                {
+                    const __m128i carry = _mm_alignr_epi8(msgs[g % 4], msgs[(g + 3) % 4], 4);
+                    msgs[(g + 1) % 4] = _mm_add_epi32(msgs[(g + 1) % 4], carry);
+                    msgs[(g + 1) % 4] = _mm_sha256msg2_epu32(msgs[(g + 1) % 4], msgs[g % 4]);
+                }
+                msg = _mm_shuffle_epi32(msg, 0x0E);
+                state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+                if (g >= 1 && g < 13)
+                {
+                    msgs[(g + 3) % 4] = _mm_sha256msg1_epu32(msgs[(g + 3) % 4], msgs[g % 4]);
+                }
+            }
+
+            state0 = _mm_add_epi32(state0, abefSave);
+            state1 = _mm_add_epi32(state1, cdghSave);
+            data += 64;
+        }
+
+        tmp = _mm_shuffle_epi32(state0, 0x1B);
+        state1 = _mm_shuffle_epi32(state1, 0xB1);
+        state0 = _mm_blend_epi16(tmp, state1, 0xF0);
+        state1 = _mm_alignr_epi8(state1, tmp, 8);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&h[0]), state0);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&h[4]), state1);
+    }
+
+    bool detectShaNi() noexcept
+    {
+        unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+        if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+        {
+            return false;
+        }
+        const bool ssse3 = (ecx & (1u << 9)) != 0;
+        const bool sse41 = (ecx & (1u << 19)) != 0;
+        if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+        {
+            return false;
+        }
+        const bool sha = (ebx & (1u << 29)) != 0;
+        return ssse3 && sse41 && sha;
+    }
+#elif defined(MIMIR_SHA256_ARM)
+    void compressArm(std::uint32_t h[8], const std::uint8_t* data, size_t blocks) noexcept
+    {
+        uint32x4_t state0 = vld1q_u32(&h[0]);
+        uint32x4_t state1 = vld1q_u32(&h[4]);
+
+        while (blocks-- > 0)
+        {
+            const uint32x4_t abcdSave = state0;
+            const uint32x4_t efghSave = state1;
+            uint32x4_t msgs[4];
+            for (int i = 0; i < 4; ++i)
+            {
+                msgs[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 16 * i)));
+            }
+
+            for (int g = 0; g < 16; ++g)
+            {
+                const uint32x4_t wk = vaddq_u32(msgs[g % 4], vld1q_u32(&K[4 * g]));
+                if (g < 12)
+                {
+                    msgs[g % 4] = vsha256su0q_u32(msgs[g % 4], msgs[(g + 1) % 4]);
+                }
+                const uint32x4_t saved = state0;
+                state0 = vsha256hq_u32(state0, state1, wk);
+                state1 = vsha256h2q_u32(state1, saved, wk);
+                if (g < 12)
+                {
+                    msgs[g % 4] = vsha256su1q_u32(msgs[g % 4], msgs[(g + 2) % 4], msgs[(g + 3) % 4]);
+                }
+            }
+
+            state0 = vaddq_u32(state0, abcdSave);
+            state1 = vaddq_u32(state1, efghSave);
+            data += 64;
+        }
+
+        vst1q_u32(&h[0], state0);
+        vst1q_u32(&h[4], state1);
+    }
+#endif
+
+    using CompressFn = void (*)(std::uint32_t*, const std::uint8_t*, size_t) noexcept;
+
+    CompressFn selectCompress() noexcept
+    {
+#if defined(MIMIR_SHA256_X86)
+        if (detectShaNi())
+        {
+            return &compressShaNi;
+        }
+#elif defined(MIMIR_SHA256_ARM)
+        return &compressArm;
+#endif
+        return &compressPortable;
+    }
+
+    const CompressFn compress = selectCompress();
+}
+
+void detail::sha256Init(Sha256State& state) noexcept
+{
+    std::memcpy(state.h, H0, sizeof(H0));
+    state.length = 0;
+    state.bufferLen = 0;
+}
+
+void detail::sha256Update(Sha256State& state, const std::uint8_t* data, size_t len) noexcept
+{
+    state.length += len;
+
+    if (state.bufferLen > 0)
+    {
+        const size_t take = std::min(len, sizeof(state.buffer) - state.bufferLen);
+        std::memcpy(state.buffer + state.bufferLen, data, take);
+        state.bufferLen += take;
+        data += take;
+        len -= take;
+        if (state.bufferLen < sizeof(state.buffer))
+        {
+            return;
+        }
+        compress(state.h, state.buffer, 1);
+        state.bufferLen = 0;
+    }
+
+    // Whole blocks go straight from the caller's buffer
+    const size_t blocks = len / 64;
+    if (blocks > 0)
+    {
+        compress(state.h, data, blocks);
+        data += blocks * 64;
+        len -= blocks * 64;
+    }
+
+    if (len > 0)
+    {
+        std::memcpy(state.buffer, data, len);
+        state.bufferLen = len;
+    }
+}
+
+void detail::sha256Final(Sha256State& state, std::uint8_t out[32]) noexcept
+{
+    const std::uint64_t bitLength = state.length * 8;
+    std::uint8_t pad[72] = {0x80};
+    const size_t padLen = (state.bufferLen < 56) ? (56 - state.bufferLen) : (120 - state.bufferLen);
+    for (int i = 0; i < 8; ++i)
+    {
+        pad[padLen + i] = static_cast<std::uint8_t>(bitLength >> (56 - 8 * i));
+    }
+    sha256Update(state, pad, padLen + 8);
+
+    for (int i = 0; i < 8; ++i)
+    {
+        out[4 * i] = static_cast<std::uint8_t>(state.h[i] >> 24);
+        out[4 * i + 1] = static_cast<std::uint8_t>(state.h[i] >> 16);
+        out[4 * i + 2] = static_cast<std::uint8_t>(state.h[i] >> 8);
+        out[4 * i + 3] = static_cast<std::uint8_t>(state.h[i]);
+    }
+}
+
+bool detail::sha256Accelerated() noexcept
+{
+    return compress != &compressPortable;
+}
@@ -1,74 +1,177 @@
 #include "mimir/signature.h"
+#include <atomic>
+#include <memory>
+
+#ifdef _WIN32
 #include <fstream>
-#include <sstream>
-#include <iomanip>
-#include <cstring>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 using namespace mimir;
 
-std::string Signature::sha256(const std::string& data)
+namespace
 {
-    unsigned char hash[32];
-    std::memset(hash, 0, 32);
-
-    const auto d = reinterpret_cast<const unsigned char*>(data.c_str());
-    const size_t len = data.length();
-    
-    unsigned int h0 = 0x6a09e667;
-    unsigned int h1 = 0xbb67ae85;
-    unsigned int h2 = 0x3c6ef372;
-    constexpr unsigned int h3 = 0xa54ff53a;
-    constexpr unsigned int h4 = 0x510e527f;
-    constexpr unsigned int h5 = 0x9b05688c;
-    constexpr unsigned int h6 = 0x1f83d9ab;
-    constexpr unsigned int h7 = 0x5be0cd19;
-    
-    for (size_t i = 0; i < len; i++)
+    /// Files at least this large are hashed through mmap; smaller ones are pread into a buffer
+    constexpr size_t MMAP_THRESHOLD = 256 * 1024;
+
+    std::atomic<HashAlgorithm> signatureAlgorithm{HashAlgorithm::SHA256};
+
+    /**
+    * @brief Get this thread's read buffer, allocated once per thread
+    * @return Buffer of MMAP_THRESHOLD bytes
+    */
+    char* threadReadBuffer()
+    {
+        thread_local const std::unique_ptr<char[]> buffer(new char[MMAP_THRESHOLD]);
+        return buffer.get();
+    }
+
+#ifdef _WIN32
+    bool hashFile(const std::string& filepath, Hasher& hasher)
+    {
+        std::ifstream file(filepath, std::ios::binary);
+        if (!file.is_open())
+        {
+            return false;
+        }
+
+        char* buffer = threadReadBuffer();
+        while (file)
+        {
+            file.read(buffer, MMAP_THRESHOLD);
+            const std::streamsize got = file.gcount();
+            if (got <= 0)
+            {
+                break;
+            }
+            hasher.update(buffer, static_cast<size_t>(got));
+        }
+        return !file.bad();
+    }
+#else
+    /// @brief Closes a file descriptor on scope exit \struct FdGuard
+    struct FdGuard
+    {
+        int fd;
+        ~FdGuard() { ::close(fd); }
+    };
+
+    bool hashMapped(const int fd, const size_t size, Hasher& hasher)
+    {
+        void* data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED)
+        {
+            return false;
+        }
+        ::madvise(data, size, MADV_SEQUENTIAL);
+        hasher.update(data, size);
+        ::munmap(data, size);
+        return true;
+    }
+
+    bool hashRead(const int fd, const off_t size, Hasher& hasher)
+    {
+        // A regular file is read up to the size fstat reported, so a small one
+        // takes a single pread; anything else (size <= 0, which includes
+        // /proc files) is read until EOF
+        char* buffer = threadReadBuffer();
+        off_t offset = 0;
+        while (size <= 0 || offset < size)
+        {
+            const ssize_t got = ::pread(fd, buffer, MMAP_THRESHOLD, offset);
+            if (got < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                return false;
+            }
+            if (got == 0)
+            {
+                return true;
+            }
+            hasher.update(buffer, static_cast<size_t>(got));
+            offset += got;
+        }
+        return true;
+    }
+
+    bool hashFile(const std::string& filepath, Hasher& hasher)
     {
-        h0 ^= d[i];
-        h0 = (h0 << 7) | (h0 >> 25);
-        h1 ^= h0;
-        h2 += d[i];
+        const int fd = ::open(filepath.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            return false;
+        }
+        FdGuard guard{fd};
+
+        struct stat st{};
+        if (::fstat(fd, &st) != 0 || S_ISDIR(st.st_mode))
+        {
+            return false;
+        }
+
+        const auto size = static_cast<size_t>(st.st_size);
+        if (S_ISREG(st.st_mode) && size >= MMAP_THRESHOLD && hashMapped(fd, size, hasher))
+        {
+            return true;
+        }
+        return hashRead(fd, S_ISREG(st.st_mode) ? st.st_size : -1, hasher);
     }
-    
-    std::ostringstream oss;
-    oss << std::hex << std::setfill('0')
-        << std::setw(8) << h0
-        << std::setw(8) << h1
-        << std::setw(8) << h2
-        << std::setw(8) << h3
-        << std::setw(8) << h4
-        << std::setw(8) << h5
-        << std::setw(8) << h6
-        << std::setw(8) << h7;
-    
-    return oss.str();
+#endif
+}
+
+void Signature::setAlgorithm(const HashAlgorithm algorithm) noexcept
+{
+    signatureAlgorithm.store(algorithm, std::memory_order_relaxed);
+}
+
+HashAlgorithm Signature::getAlgorithm() noexcept
+{
+    return signatureAlgorithm.load(std::memory_order_relaxed);
 }
 
 std::string Signature::computeFileSignature(const std::string& filepath)
 {
-    std::ifstream file(filepath, std::ios::binary);
-    if (!file.is_open())
+    Hasher hasher(getAlgorithm());
+    if (!hashFile(filepath, hasher))
     {
         return "";
     }
-    
-    std::ostringstream oss;
-    oss << file.rdbuf();
-    return sha256(oss.str());
+    return hasher.finalizeHex();
 }
 
 std::string Signature::computeCommandSignature(const std::string& command)
 {
-    return sha256(command);
+    return Hasher::hashHex(getAlgorithm(), command);
 }
 
 std::string Signature::computeTargetSignature(const std::string& command, const std::vector<std::string>& inputs)
 {
-    std::string combined = command;
+    std::vector<std::string> fileSignatures;
+    fileSignatures.reserve(inputs.size());
     for (const auto& input : inputs)
     {
-        combined += "|" + computeFileSignature(input);
+        fileSignatures.push_back(computeFileSignature(input));
+    }
+    return combineTargetSignature(command, fileSignatures);
+}
+
+std::string Signature::combineTargetSignature(const std::string& command, const std::vector<std::string>& fileSignatures)
+{
+    // Same byte stream as hashing "command|sig1|sig2...", without building the string
+    Hasher hasher(getAlgorithm());
+    hasher.update(command);
+    for (const auto& fileSignature : fileSignatures)
+    {
+        hasher.update("|");
+        hasher.update(fileSignature);
     }
-    return sha256(combined);
+    return hasher.finalizeHex();
 }
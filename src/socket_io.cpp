@@ -0,0 +1,181 @@
+#include "mimir/socket_io.h"
+#include <cerrno>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+using namespace mimir;
+
+#ifndef _WIN32
+namespace
+{
+#ifdef MSG_NOSIGNAL
+    constexpr int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+    constexpr int SEND_FLAGS = 0;
+#endif
+
+    constexpr size_t CHUNK_SIZE = 64 * 1024;
+}
+
+bool mimir::sendAll(const int fd, const std::string_view data)
+{
+    size_t sent = 0;
+    while (sent < data.size())
+    {
+        const ssize_t n = ::send(fd, data.data() + sent, data.size() - sent, SEND_FLAGS);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return false;
+        }
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+void mimir::setCloseOnExec(const int fd)
+{
+    ::fcntl(fd, F_SETFD, ::fcntl(fd, F_GETFD) | FD_CLOEXEC);
+}
+
+SocketReader::SocketReader(const int fd, const int timeoutMs, const size_t maxBytes)
+    : fd_(fd)
+    , timeoutMs_(timeoutMs)
+    , maxBytes_(maxBytes)
+{
+}
+
+bool SocketReader::readLine(std::string& line)
+{
+    while (true)
+    {
+        const size_t newline = buffer_.find('\n', scanned_);
+        if (newline != std::string::npos)
+        {
+            if (newline >= remaining())
+            {
+                return false;
+            }
+            line = buffer_.substr(0, newline);
+            buffer_.erase(0, newline + 1);
+            scanned_ = 0;
+            consumed_ += newline + 1;
+            return true;
+        }
+        scanned_ = buffer_.size();
+        if (scanned_ >= remaining() || !fill())
+        {
+            return false;
+        }
+    }
+}
+
+bool SocketReader::readExact(const size_t length, std::string& data)
+{
+    if (length > remaining())
+    {
+        return false;
+    }
+    while (buffer_.size() < length)
+    {
+        if (!fill())
+        {
+            return false;
+        }
+    }
+    data = buffer_.substr(0, length);
+    buffer_.erase(0, length);
+    scanned_ = 0;
+    consumed_ += length;
+    return true;
+}
+
+size_t SocketReader::consumed() const noexcept
+{
+    return consumed_;
+}
+
+size_t SocketReader::remaining() const noexcept
+{
+    return maxBytes_ - consumed_;
+}
+
+bool SocketReader::fill()
+{
+    while (true)
+    {
+        pollfd pfd{fd_, POLLIN, 0};
+        const int ready = ::poll(&pfd, 1, timeoutMs_);
+        if (ready < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (ready <= 0)
+        {
+            return false;
+        }
+        break;
+    }
+    char chunk[CHUNK_SIZE];
+    ssize_t n;
+    do
+    {
+        n = ::recv(fd_, chunk, sizeof(chunk), 0);
+    } while (n < 0 && errno == EINTR);
+    if (n <= 0)
+    {
+        return false;
+    }
+    buffer_.append(chunk, static_cast<size_t>(n));
+    return true;
+}
+#else
+bool mimir::sendAll(const int, const std::string_view)
+{
+    return false;
+}
+
+void mimir::setCloseOnExec(const int)
+{
+}
+
+SocketReader::SocketReader(const int fd, const int timeoutMs, const size_t maxBytes)
+    : fd_(fd)
+    , timeoutMs_(timeoutMs)
+    , maxBytes_(maxBytes)
+{
+}
+
+bool SocketReader::readLine(std::string&)
+{
+    return false;
+}
+
+bool SocketReader::readExact(const size_t, std::string&)
+{
+    return false;
+}
+
+size_t SocketReader::consumed() const noexcept
+{
+    return consumed_;
+}
+
+size_t SocketReader::remaining() const noexcept
+{
+    return maxBytes_ - consumed_;
+}
+
+bool SocketReader::fill()
+{
+    return false;
+}
+#endif
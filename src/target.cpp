@@ -73,6 +73,66 @@ void Target::setDependencies(std::vector<std::string> deps)
     dependencies_ = std::move(deps);
 }
 
+const std::string& Target::getPool() const noexcept
+{
+    return pool_;
+}
+
+void Target::setPool(std::string pool)
+{
+    pool_ = std::move(pool);
+}
+
+std::uint32_t Target::getWeight() const noexcept
+{
+    return weight_;
+}
+
+void Target::setWeight(const std::uint32_t weight)
+{
+    weight_ = weight;
+}
+
+const std::string& Target::getDepfile() const noexcept
+{
+    return depfile_;
+}
+
+void Target::setDepfile(std::string depfile)
+{
+    depfile_ = std::move(depfile);
+}
+
+DepsFormat Target::getDepsFormat() const noexcept
+{
+    return depsFormat_;
+}
+
+void Target::setDepsFormat(const DepsFormat format)
+{
+    depsFormat_ = format;
+}
+
+bool Target::getRestat() const noexcept
+{
+    return restat_;
+}
+
+void Target::setRestat(const bool restat)
+{
+    restat_ = restat;
+}
+
+bool Target::getRemote() const noexcept
+{
+    return remote_;
+}
+
+void Target::setRemote(const bool remote)
+{
+    remote_ = remote;
+}
+
 const std::string& Target::getSignature() const noexcept
 {
     return signature_;
@@ -0,0 +1,74 @@
+#include "mimir/thread_pool.h"
+
+using namespace mimir;
+
+ThreadPool::ThreadPool(const size_t numThreads)
+    : active_(0)
+    , stopping_(false)
+{
+    const size_t count = numThreads == 0 ? 1 : numThreads;
+    threads_.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        threads_.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    workCv_.notify_all();
+    for (auto& thread : threads_)
+    {
+        thread.join();
+    }
+}
+
+void ThreadPool::enqueue(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks_.push_back(std::move(task));
+    }
+    workCv_.notify_one();
+}
+
+void ThreadPool::wait()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    idleCv_.wait(lock, [this]() { return tasks_.empty() && active_ == 0; });
+}
+
+size_t ThreadPool::threadCount() const noexcept
+{
+    return threads_.size();
+}
+
+void ThreadPool::workerLoop()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true)
+    {
+        // Queued work is drained even while stopping so the destructor never drops tasks
+        workCv_.wait(lock, [this]() { return stopping_ || !tasks_.empty(); });
+        if (tasks_.empty())
+        {
+            return;
+        }
+
+        std::function<void()> task = std::move(tasks_.front());
+        tasks_.pop_front();
+        ++active_;
+        lock.unlock();
+        task();
+        lock.lock();
+        --active_;
+        if (tasks_.empty() && active_ == 0)
+        {
+            idleCv_.notify_all();
+        }
+    }
+}
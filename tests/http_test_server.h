@@ -0,0 +1,169 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/// @brief In-process HTTP server holding PUT bodies in memory, for tests
+/// @note Serves one connection at a time; enough for request/response tests
+class HttpTestServer
+{
+public:
+    HttpTestServer()
+    {
+        fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+        const int one = 1;
+        ::setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+        ::bind(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+        ::listen(fd_, 64);
+        socklen_t len = sizeof(addr);
+        ::getsockname(fd_, reinterpret_cast<sockaddr*>(&addr), &len);
+        port_ = ntohs(addr.sin_port);
+        thread_ = std::thread([this]() { serve(); });
+    }
+
+    ~HttpTestServer()
+    {
+        stopping_ = true;
+        ::shutdown(fd_, SHUT_RDWR);
+        ::close(fd_);
+        thread_.join();
+    }
+
+    std::uint16_t port() const { return port_; }
+
+    std::string url() const { return "http://127.0.0.1:" + std::to_string(port_); }
+
+    size_t objectCount()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return objects_.size();
+    }
+
+    void setObject(const std::string& path, const std::string& body)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        objects_[path] = body;
+    }
+
+    /// Respond to every request with chunked transfer encoding
+    void setChunked(bool chunked) { chunked_ = chunked; }
+
+    size_t requestCount() const { return requests_.load(); }
+
+private:
+    void serve()
+    {
+        while (!stopping_)
+        {
+            const int client = ::accept(fd_, nullptr, nullptr);
+            if (client < 0)
+            {
+                continue;
+            }
+            handle(client);
+            ::close(client);
+        }
+    }
+
+    void handle(int client)
+    {
+        std::string data;
+        char buffer[8192];
+        size_t headerEnd = std::string::npos;
+        size_t contentLength = 0;
+        while (true)
+        {
+            if (headerEnd == std::string::npos)
+            {
+                headerEnd = data.find("\r\n\r\n");
+                if (headerEnd != std::string::npos)
+                {
+                    const size_t pos = data.find("Content-Length: ");
+                    if (pos != std::string::npos && pos < headerEnd)
+                    {
+                        contentLength = std::strtoull(data.c_str() + pos + 16, nullptr, 10);
+                    }
+                }
+            }
+            if (headerEnd != std::string::npos && data.size() >= headerEnd + 4 + contentLength)
+            {
+                break;
+            }
+            const ssize_t n = ::recv(client, buffer, sizeof(buffer), 0);
+            if (n <= 0)
+            {
+                return;
+            }
+            data.append(buffer, static_cast<size_t>(n));
+        }
+        ++requests_;
+
+        const std::string method = data.substr(0, data.find(' '));
+        const size_t pathStart = method.size() + 1;
+        const std::string path = data.substr(pathStart, data.find(' ', pathStart) - pathStart);
+        const std::string body = data.substr(headerEnd + 4, contentLength);
+
+        std::string status = "200 OK";
+        std::string responseBody;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (method == "PUT")
+            {
+                objects_[path] = body;
+            }
+            else
+            {
+                const auto it = objects_.find(path);
+                if (it == objects_.end())
+                {
+                    status = "404 Not Found";
+                }
+                else if (method == "GET")
+                {
+                    responseBody = it->second;
+                }
+            }
+        }
+
+        std::string response = "HTTP/1.1 " + status + "\r\n";
+        if (chunked_ && method == "GET")
+        {
+            response += "Transfer-Encoding: chunked\r\n\r\n";
+            for (size_t i = 0; i < responseBody.size(); i += 7)
+            {
+                const std::string chunk = responseBody.substr(i, 7);
+                char size[16];
+                std::snprintf(size, sizeof(size), "%zx\r\n", chunk.size());
+                response += size + chunk + "\r\n";
+            }
+            response += "0\r\n\r\n";
+        }
+        else
+        {
+            response += "Content-Length: " + std::to_string(responseBody.size()) + "\r\n\r\n" + responseBody;
+        }
+        ::send(client, response.data(), response.size(), MSG_NOSIGNAL);
+    }
+
+    int fd_ = -1;
+    std::uint16_t port_ = 0;
+    std::atomic<bool> stopping_{false};
+    std::atomic<bool> chunked_{false};
+    std::atomic<size_t> requests_{0};
+    std::mutex mutex_;
+    std::map<std::string, std::string> objects_;
+    std::thread thread_;
+};
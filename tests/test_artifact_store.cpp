@@ -0,0 +1,316 @@
+#include "mimir/artifact_store.h"
+#include "mimir/executor.h"
+#include "mimir/command_runner.h"
+#include "mimir/dag.h"
+#include "http_test_server.h"
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    /// Local backend whose stores wait until release() is called
+    class GatedBackend : public mimir::LocalArtifactBackend
+    {
+    public:
+        using LocalArtifactBackend::LocalArtifactBackend;
+
+        bool store(const std::string& key, const std::string_view data) override
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            ++waiting_;
+            changed_.notify_all();
+            changed_.wait(lock, [this] { return open_; });
+            lock.unlock();
+            return LocalArtifactBackend::store(key, data);
+        }
+
+        void waitForStore()
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            changed_.wait(lock, [this] { return waiting_ > 0; });
+        }
+
+        void release()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            open_ = true;
+            changed_.notify_all();
+        }
+
+    private:
+        std::mutex mutex_;
+        std::condition_variable changed_;
+        size_t waiting_ = 0;
+        bool open_ = false;
+    };
+}
+
+class ArtifactStoreTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        testDir_ = "/tmp/test_mimir_artifacts_" + std::to_string(::testing::UnitTest::GetInstance()->random_seed());
+        fs::remove_all(testDir_);
+        fs::create_directories(testDir_ + "/work");
+        storeDir_ = testDir_ + "/store";
+    }
+
+    void TearDown() override
+    {
+        fs::remove_all(testDir_);
+    }
+
+    std::string writeFile(const std::string& name, const std::string& content)
+    {
+        const std::string path = testDir_ + "/work/" + name;
+        fs::create_directories(fs::path(path).parent_path());
+        std::ofstream file(path, std::ios::binary);
+        file << content;
+        return path;
+    }
+
+    static std::string readFile(const std::string& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        std::ostringstream contents;
+        contents << file.rdbuf();
+        return contents.str();
+    }
+
+    std::string testDir_;
+    std::string storeDir_;
+};
+
+TEST_F(ArtifactStoreTest, BlobRoundTrip)
+{
+    const std::string compressible(100000, 'x');
+    const std::string blob = mimir::ArtifactStore::encodeBlob(compressible);
+    if (mimir::ArtifactStore::compressionAvailable())
+    {
+        EXPECT_LT(blob.size(), compressible.size() / 10);
+    }
+    EXPECT_EQ(mimir::ArtifactStore::decodeBlob(blob), compressible);
+
+    const std::string tiny = "ab";
+    EXPECT_EQ(mimir::ArtifactStore::decodeBlob(mimir::ArtifactStore::encodeBlob(tiny)), tiny);
+    EXPECT_EQ(mimir::ArtifactStore::decodeBlob(mimir::ArtifactStore::encodeBlob("")), std::string());
+}
+
+TEST_F(ArtifactStoreTest, CorruptBlobIsRejected)
+{
+    std::string blob = mimir::ArtifactStore::encodeBlob(std::string(1000, 'y'));
+    EXPECT_FALSE(mimir::ArtifactStore::decodeBlob(blob.substr(0, blob.size() - 1)).has_value());
+    blob[0] = 'X';
+    EXPECT_FALSE(mimir::ArtifactStore::decodeBlob(blob).has_value());
+    EXPECT_FALSE(mimir::ArtifactStore::decodeBlob("MZ").has_value());
+}
+
+TEST_F(ArtifactStoreTest, ActionKeyCoversOutputs)
+{
+    const auto a = mimir::ArtifactStore::actionKey("sig", {"a.o"});
+    EXPECT_EQ(a, mimir::ArtifactStore::actionKey("sig", {"a.o"}));
+    EXPECT_NE(a, mimir::ArtifactStore::actionKey("sig", {"b.o"}));
+    EXPECT_NE(a, mimir::ArtifactStore::actionKey("sig2", {"a.o"}));
+    EXPECT_NE(mimir::ArtifactStore::actionKey("sig", {"ab", "c"}), mimir::ArtifactStore::actionKey("sig", {"a", "bc"}));
+}
+
+TEST_F(ArtifactStoreTest, CreateBackendFromLocation)
+{
+    EXPECT_NE(std::dynamic_pointer_cast<mimir::LocalArtifactBackend>(mimir::createArtifactBackend(storeDir_)), nullptr);
+    EXPECT_NE(std::dynamic_pointer_cast<mimir::HttpArtifactBackend>(mimir::createArtifactBackend("http://cache:9090/x")), nullptr);
+    EXPECT_EQ(mimir::createArtifactBackend("http://"), nullptr);
+    EXPECT_EQ(mimir::createArtifactBackend("s3://bucket"), nullptr);
+    EXPECT_EQ(mimir::createArtifactBackend(""), nullptr);
+}
+
+TEST_F(ArtifactStoreTest, LocalBackendStoresAndFetches)
+{
+    mimir::LocalArtifactBackend backend(storeDir_);
+    EXPECT_FALSE(backend.contains("cas/abcdef"));
+    EXPECT_FALSE(backend.fetch("cas/abcdef").has_value());
+    ASSERT_TRUE(backend.store("cas/abcdef", "payload"));
+    EXPECT_TRUE(backend.contains("cas/abcdef"));
+    EXPECT_EQ(backend.fetch("cas/abcdef"), std::string("payload"));
+    EXPECT_TRUE(fs::exists(storeDir_ + "/cas/ab/abcdef"));
+}
+
+TEST_F(ArtifactStoreTest, PublishThenRestore)
+{
+    const std::string objectPath = writeFile("out/main.o", std::string(5000, 'o') + "object");
+    const std::string toolPath = writeFile("out/tool", "#!/bin/sh\n");
+    fs::permissions(toolPath, fs::perms::owner_all | fs::perms::group_read);
+    const std::vector<std::string> outputs = {objectPath, toolPath};
+
+    {
+        mimir::ArtifactStore store(std::make_shared<mimir::LocalArtifactBackend>(storeDir_));
+        store.storeAsync("signature", outputs);
+        store.waitForUploads();
+        EXPECT_EQ(store.getStats().uploads, 1u);
+        EXPECT_GT(store.getStats().bytesUploaded, 0u);
+    }
+
+    fs::remove_all(testDir_ + "/work/out");
+
+    mimir::ArtifactStore store(std::make_shared<mimir::LocalArtifactBackend>(storeDir_));
+    EXPECT_FALSE(store.restore("other-signature", outputs));
+    EXPECT_FALSE(store.restore("signature", {objectPath}));
+    ASSERT_TRUE(store.restore("signature", outputs));
+    EXPECT_EQ(readFile(objectPath), std::string(5000, 'o') + "object");
+    EXPECT_EQ(readFile(toolPath), "#!/bin/sh\n");
+    EXPECT_EQ(fs::status(toolPath).permissions() & fs::perms::owner_exec, fs::perms::owner_exec);
+
+    const auto stats = store.getStats();
+    EXPECT_EQ(stats.hits, 1u);
+    EXPECT_EQ(stats.misses, 2u);
+}
+
+TEST_F(ArtifactStoreTest, RestoresDoNotWaitBehindUploads)
+{
+    const std::string restored = writeFile("restored.o", "restored");
+    {
+        mimir::ArtifactStore store(std::make_shared<mimir::LocalArtifactBackend>(storeDir_));
+        store.storeAsync("restored", {restored});
+    }
+    fs::remove(restored);
+
+    auto backend = std::make_shared<GatedBackend>(storeDir_);
+    mimir::ArtifactStore store(backend, 1);
+    store.storeAsync("pending", {writeFile("pending.o", "pending")});
+    backend->waitForStore();
+    // The only transfer thread of each kind: uploads hold theirs, downloads still run
+    EXPECT_TRUE(store.restore("restored", {restored}));
+    EXPECT_EQ(readFile(restored), "restored");
+    backend->release();
+    store.waitForUploads();
+    EXPECT_EQ(store.getStats().uploads, 1u);
+}
+
+TEST_F(ArtifactStoreTest, OutputsRewrittenBeforeTheUploadAreNotPublished)
+{
+    const std::string path = writeFile("a.o", "built by sig");
+    auto backend = std::make_shared<GatedBackend>(storeDir_);
+    {
+        mimir::ArtifactStore store(backend, 1);
+        store.storeAsync("blocker", {writeFile("blocker.o", "blocker")});
+        backend->waitForStore();
+        store.storeAsync("sig", {path});
+        writeFile("a.o", "built by another signature");
+        backend->release();
+        store.waitForUploads();
+        EXPECT_EQ(store.getStats().uploads, 1u);
+        EXPECT_EQ(store.getStats().uploadFailures, 1u);
+    }
+
+    mimir::ArtifactStore store(std::make_shared<mimir::LocalArtifactBackend>(storeDir_));
+    EXPECT_FALSE(store.restore("sig", {path}));
+    EXPECT_EQ(readFile(path), "built by another signature");
+}
+
+TEST_F(ArtifactStoreTest, TamperedBlobIsAMiss)
+{
+    const std::string path = writeFile("a.txt", "original contents");
+    auto backend = std::make_shared<mimir::LocalArtifactBackend>(storeDir_);
+    {
+        mimir::ArtifactStore store(backend);
+        store.storeAsync("sig", {path});
+    }
+
+    for (const auto& entry : fs::recursive_directory_iterator(storeDir_ + "/cas"))
+    {
+        if (entry.is_regular_file())
+        {
+            std::ofstream(entry.path(), std::ios::binary) << mimir::ArtifactStore::encodeBlob("tampered contents");
+        }
+    }
+
+    writeFile("a.txt", "local");
+    mimir::ArtifactStore store(backend);
+    EXPECT_FALSE(store.restore("sig", {path}));
+    EXPECT_EQ(readFile(path), "local");
+}
+
+TEST_F(ArtifactStoreTest, ReadOnlyStoreNeverUploads)
+{
+    const std::string path = writeFile("a.txt", "data");
+    mimir::ArtifactStore store(std::make_shared<mimir::LocalArtifactBackend>(storeDir_));
+    store.setReadOnly(true);
+    store.storeAsync("sig", {path});
+    store.waitForUploads();
+    EXPECT_EQ(store.getStats().uploads, 0u);
+    EXPECT_FALSE(fs::exists(storeDir_));
+}
+
+TEST_F(ArtifactStoreTest, HttpBackendRoundTrip)
+{
+    HttpTestServer server;
+    const std::string path = writeFile("lib.a", std::string(20000, 'l'));
+
+    {
+        mimir::ArtifactStore store(mimir::createArtifactBackend(server.url() + "/cache"));
+        store.storeAsync("sig", {path});
+        store.waitForUploads();
+        EXPECT_EQ(store.getStats().uploads, 1u);
+    }
+    EXPECT_EQ(server.objectCount(), 2u);
+
+    fs::remove(path);
+    mimir::ArtifactStore store(mimir::createArtifactBackend(server.url() + "/cache"));
+    ASSERT_TRUE(store.restore("sig", {path}));
+    EXPECT_EQ(readFile(path), std::string(20000, 'l'));
+}
+
+TEST_F(ArtifactStoreTest, ExecutorRestoresInsteadOfRunning)
+{
+    const std::string input = writeFile("main.c", "int main() { return 0; }");
+    const std::string output = testDir_ + "/work/main.o";
+    auto runner = std::make_shared<mimir::MockCommandRunner>();
+    runner->setHandler([&output](const std::string&, const mimir::CommandOptions&)
+    {
+        std::ofstream(output) << "compiled";
+        return mimir::CommandResult{0, "", "", false};
+    });
+
+    mimir::Target target("main");
+    target.addInput(input);
+    target.addOutput(output);
+    target.setCommand("cc -c main.c");
+    mimir::DAG dag;
+    dag.addTarget(target);
+
+    mimir::ExecutorConfig config;
+    config.colorOutput = false;
+    auto store = std::make_shared<mimir::ArtifactStore>(std::make_shared<mimir::LocalArtifactBackend>(storeDir_));
+    {
+        mimir::Executor executor(1, runner);
+        executor.setConfig(config);
+        executor.setArtifactStore(store);
+        mimir::Cache cache(testDir_ + "/cache-a");
+        mimir::BuildStats stats;
+        ASSERT_TRUE(executor.executeWithStats(dag, cache, stats));
+        EXPECT_EQ(stats.builtTargets, 1u);
+        EXPECT_EQ(store->getStats().uploads, 1u);
+    }
+
+    // A fresh checkout on another machine: no local cache, no outputs
+    fs::remove(output);
+    runner->reset();
+    mimir::Executor executor(1, runner);
+    executor.setConfig(config);
+    executor.setArtifactStore(store);
+    mimir::Cache cache(testDir_ + "/cache-b");
+    mimir::BuildStats stats;
+    ASSERT_TRUE(executor.executeWithStats(dag, cache, stats));
+    EXPECT_EQ(stats.restoredTargets, 1u);
+    EXPECT_EQ(stats.builtTargets, 0u);
+    EXPECT_EQ(runner->getCommandCount(), 0u);
+    EXPECT_EQ(readFile(output), "compiled");
+    EXPECT_FALSE(cache.needsRebuild("main", cache.getSignature("main")));
+    EXPECT_EQ(cache.size(), 1u);
+}
@@ -0,0 +1,110 @@
+#include "mimir/build_trace.h"
+#include <gtest/gtest.h>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    mimir::TraceEvent makeEvent(const std::string& name, size_t worker, std::int64_t start, std::int64_t end)
+    {
+        mimir::TraceEvent event;
+        event.name = name;
+        event.status = "SUCCESS";
+        event.worker = worker;
+        event.startUs = start;
+        event.endUs = end;
+        return event;
+    }
+
+    mimir::Target makeTarget(const std::string& name, const std::vector<std::string>& dependencies)
+    {
+        mimir::Target target(name);
+        target.setCommand("run " + name);
+        target.setDependencies(dependencies);
+        return target;
+    }
+}
+
+TEST(BuildTraceTest, EventsAreOrderedByStartTime)
+{
+    mimir::BuildTrace trace;
+    trace.record(makeEvent("late", 1, 50, 60));
+    trace.record(makeEvent("early", 0, 10, 20));
+
+    const auto events = trace.events();
+    ASSERT_EQ(events.size(), 2u);
+    EXPECT_EQ(events[0].name, "early");
+    EXPECT_EQ(events[1].name, "late");
+
+    trace.start();
+    EXPECT_TRUE(trace.events().empty());
+    EXPECT_GE(trace.elapsedUs(), 0);
+}
+
+TEST(BuildTraceTest, ChromeTraceNamesWorkersAndNestsCommands)
+{
+    mimir::BuildTrace trace;
+    mimir::TraceEvent built = makeEvent("compile \"main\"\n", 1, 100, 900);
+    built.readyUs = 40;
+    built.hashUs = 30;
+    built.commandStartUs = 150;
+    built.commandUs = 700;
+    built.spawnUs = 5;
+    built.usage.userSeconds = 0.25;
+    built.usage.maxRssKb = 2048;
+    trace.record(built);
+    mimir::TraceEvent skipped = makeEvent("link", 0, 950, 960);
+    skipped.status = "UP-TO-DATE";
+    skipped.readyUs = 950;
+    trace.record(skipped);
+
+    const std::string json = trace.toChromeTrace();
+    EXPECT_EQ(json.find("{\"displayTimeUnit\":\"ms\",\"traceEvents\":["), 0u);
+    EXPECT_NE(json.find("\"args\":{\"name\":\"worker 0\"}"), std::string::npos);
+    EXPECT_NE(json.find("\"args\":{\"name\":\"worker 1\"}"), std::string::npos);
+    EXPECT_NE(json.find("\"name\":\"compile \\\"main\\\"\\n\",\"cat\":\"target\",\"ph\":\"X\",\"pid\":1,\"tid\":1,"
+                        "\"ts\":100,\"dur\":800"), std::string::npos);
+    EXPECT_NE(json.find("\"queue_us\":60,\"hash_us\":30,\"command_us\":700,\"spawn_us\":5,"
+                        "\"user_ms\":250.000,\"sys_ms\":0.000,\"max_rss_kb\":2048"), std::string::npos);
+    EXPECT_NE(json.find("\"cat\":\"command\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":150,\"dur\":700"),
+              std::string::npos);
+    // A target whose command did not run has no command span or usage
+    EXPECT_NE(json.find("\"status\":\"UP-TO-DATE\",\"queue_us\":0,\"hash_us\":0}}"), std::string::npos);
+    EXPECT_EQ(json.substr(json.size() - 4), "\n]}\n");
+
+    const std::string path = (fs::temp_directory_path() / "mimir_trace_test.json").string();
+    ASSERT_TRUE(trace.writeChromeTrace(path));
+    EXPECT_EQ(fs::file_size(path), json.size());
+    fs::remove(path);
+}
+
+TEST(BuildTraceTest, ProfileFollowsTheHeaviestChain)
+{
+    const std::string cacheDir = (fs::temp_directory_path() / "mimir_profile_test").string();
+    fs::remove_all(cacheDir);
+    mimir::DAG dag;
+    dag.addTarget(makeTarget("proto", {}));
+    dag.addTarget(makeTarget("small", {}));
+    dag.addTarget(makeTarget("compile_a", {"proto"}));
+    dag.addTarget(makeTarget("compile_b", {"proto", "small"}));
+    dag.addTarget(makeTarget("link", {"compile_a", "compile_b"}));
+    dag.addTarget(makeTarget("docs", {}));
+
+    mimir::Cache cache(cacheDir);
+    cache.setDuration("proto", 100);
+    cache.setDuration("small", 900);
+    cache.setDuration("compile_a", 300);
+    cache.setDuration("compile_b", 200);
+    cache.setDuration("link", 50);
+
+    const mimir::BuildProfile profile = mimir::profileBuild(dag, cache, 2);
+    EXPECT_EQ(profile.targets, 6u);
+    EXPECT_EQ(profile.recorded, 5u);
+    EXPECT_EQ(profile.totalUs, 1550u);
+    EXPECT_EQ(profile.criticalPathUs, 1150u);
+    using Entries = std::vector<mimir::BuildProfile::Entry>;
+    EXPECT_EQ(profile.criticalPath, (Entries{{"small", 900}, {"compile_b", 200}, {"link", 50}}));
+    EXPECT_EQ(profile.slowest, (Entries{{"small", 900}, {"compile_a", 300}}));
+    fs::remove_all(cacheDir);
+}
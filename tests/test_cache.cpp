@@ -5,6 +5,8 @@
 #include <thread>
 #include <vector>
 #include <atomic>
+#include <fstream>
+#include "mimir/signature.h"
 
 namespace fs = std::filesystem;
 
@@ -288,3 +290,408 @@ TEST_F(CacheTest, DefaultCacheDirectory)
     fs::remove_all(".mimir");
 }
 
+
+TEST_F(CacheTest, FileSignatureMatchesContentHash)
+{
+    mimir::Cache cache(testDir_);
+    const std::string path = testDir_ + "/input.txt";
+    std::ofstream(path) << "hello";
+
+    EXPECT_EQ(cache.getFileSignature(path), mimir::Signature::computeFileSignature(path));
+    EXPECT_EQ(cache.fileRecordCount(), 1u);
+
+    auto record = cache.findFileRecord(path);
+    ASSERT_TRUE(record.has_value());
+    EXPECT_EQ(record->stamp.size, 5u);
+    EXPECT_NE(record->stamp.inode, 0u);
+}
+
+TEST_F(CacheTest, FileSignatureSkipsRehashWhenStatUnchanged)
+{
+    mimir::Cache cache(testDir_);
+    const std::string path = testDir_ + "/input.txt";
+    std::ofstream(path) << "hello";
+
+    mimir::FileRecord record;
+    record.stamp = *mimir::statFile(path);
+    record.hashedAtNs = record.stamp.mtimeNs + 5'000'000'000LL;
+    record.hash = "remembered";
+    cache.setFileRecord(path, record);
+
+    EXPECT_EQ(cache.getFileSignature(path), "remembered");
+
+    std::ofstream(path) << "changed size";
+    EXPECT_EQ(cache.getFileSignature(path), mimir::Signature::computeFileSignature(path));
+}
+
+TEST_F(CacheTest, FileSignatureRehashesRacilyCleanRecords)
+{
+    mimir::Cache cache(testDir_);
+    const std::string path = testDir_ + "/input.txt";
+    std::ofstream(path) << "hello";
+
+    // Hashed within the timestamp granularity of the last write: not trusted
+    mimir::FileRecord record;
+    record.stamp = *mimir::statFile(path);
+    record.hashedAtNs = record.stamp.mtimeNs;
+    record.hash = "remembered";
+    cache.setFileRecord(path, record);
+
+    EXPECT_EQ(cache.getFileSignature(path), mimir::Signature::computeFileSignature(path));
+}
+
+TEST_F(CacheTest, FileSignatureMissingFile)
+{
+    mimir::Cache cache(testDir_);
+    EXPECT_TRUE(cache.getFileSignature(testDir_ + "/missing.txt").empty());
+    EXPECT_EQ(cache.fileRecordCount(), 0u);
+}
+
+TEST_F(CacheTest, FileRecordsPersist)
+{
+    const std::string path = testDir_ + "/dir with space/input.txt";
+    {
+        mimir::Cache cache(testDir_);
+        mimir::FileRecord record;
+        record.stamp = {42, 123456789, 7};
+        record.hashedAtNs = 987654321;
+        record.hash = "abcdef";
+        cache.setFileRecord(path, record);
+        cache.setSignature("t", "s");
+        ASSERT_TRUE(cache.save());
+    }
+
+    mimir::Cache loaded(testDir_);
+    ASSERT_TRUE(loaded.load());
+    auto record = loaded.findFileRecord(path);
+    ASSERT_TRUE(record.has_value());
+    EXPECT_EQ(record->stamp.size, 42u);
+    EXPECT_EQ(record->stamp.mtimeNs, 123456789);
+    EXPECT_EQ(record->stamp.inode, 7u);
+    EXPECT_EQ(record->hashedAtNs, 987654321);
+    EXPECT_EQ(record->hash, "abcdef");
+
+    loaded.clear();
+    EXPECT_EQ(loaded.fileRecordCount(), 0u);
+}
+
+TEST_F(CacheTest, SaveWritesBinaryByDefault)
+{
+    mimir::Cache cache(testDir_);
+    EXPECT_EQ(cache.getFormat(), mimir::CacheFormat::Binary);
+    cache.setSignature("target", "sig");
+    ASSERT_TRUE(cache.save());
+
+    EXPECT_TRUE(fs::exists(cache.getCacheFile()));
+    EXPECT_FALSE(fs::exists(cache.getTextCacheFile()));
+
+    mimir::CacheImage image;
+    ASSERT_TRUE(image.open(cache.getCacheFile()));
+    EXPECT_EQ(image.findSignature("target"), std::string_view("sig"));
+}
+
+TEST_F(CacheTest, TextFormatRoundTrip)
+{
+    {
+        mimir::Cache cache(testDir_);
+        cache.setFormat(mimir::CacheFormat::Text);
+        cache.setSignature("a", "1");
+        cache.setSignature("b", "2");
+        ASSERT_TRUE(cache.save());
+    }
+    EXPECT_FALSE(fs::exists(testDir_ + "/cache.bin"));
+
+    std::ifstream text(testDir_ + "/cache.txt");
+    std::string header;
+    std::getline(text, header);
+    EXPECT_EQ(header, "# mimir-cache 4");
+
+    mimir::Cache loaded(testDir_);
+    ASSERT_TRUE(loaded.load());
+    EXPECT_EQ(loaded.getSignature("a"), "1");
+    EXPECT_EQ(loaded.getSignature("b"), "2");
+}
+
+TEST_F(CacheTest, LoadsLegacyUnversionedText)
+{
+    fs::create_directories(testDir_);
+    std::ofstream(testDir_ + "/cache.txt") << "old_target=old_sig\n";
+
+    mimir::Cache cache(testDir_);
+    ASSERT_TRUE(cache.load());
+    EXPECT_EQ(cache.getSignature("old_target"), "old_sig");
+
+    // Saving migrates the cache to the binary format
+    ASSERT_TRUE(cache.save());
+    EXPECT_FALSE(fs::exists(testDir_ + "/cache.txt"));
+    mimir::Cache migrated(testDir_);
+    ASSERT_TRUE(migrated.load());
+    EXPECT_EQ(migrated.getSignature("old_target"), "old_sig");
+}
+
+TEST_F(CacheTest, RejectsNewerTextVersion)
+{
+    fs::create_directories(testDir_);
+    std::ofstream(testDir_ + "/cache.txt") << "# mimir-cache 99\ntarget=sig\n";
+
+    mimir::Cache cache(testDir_);
+    EXPECT_FALSE(cache.load());
+    EXPECT_TRUE(cache.empty());
+}
+
+TEST_F(CacheTest, ChangesOverlayLoadedImage)
+{
+    {
+        mimir::Cache cache(testDir_);
+        cache.setSignature("keep", "k");
+        cache.setSignature("update", "old");
+        cache.setSignature("remove", "r");
+        ASSERT_TRUE(cache.save());
+    }
+
+    mimir::Cache cache(testDir_);
+    ASSERT_TRUE(cache.load());
+    EXPECT_EQ(cache.size(), 3u);
+
+    cache.setSignature("update", "new");
+    cache.setSignature("added", "a");
+    EXPECT_TRUE(cache.removeSignature("remove"));
+    EXPECT_FALSE(cache.removeSignature("remove"));
+
+    EXPECT_EQ(cache.size(), 3u);
+    EXPECT_EQ(cache.getSignature("keep"), "k");
+    EXPECT_EQ(cache.getSignature("update"), "new");
+    EXPECT_FALSE(cache.findSignature("remove").has_value());
+    EXPECT_TRUE(cache.needsRebuild("remove", "r"));
+
+    ASSERT_TRUE(cache.save());
+    mimir::Cache reloaded(testDir_);
+    ASSERT_TRUE(reloaded.load());
+    EXPECT_EQ(reloaded.size(), 3u);
+    EXPECT_EQ(reloaded.getSignature("update"), "new");
+    EXPECT_EQ(reloaded.getSignature("added"), "a");
+    EXPECT_FALSE(reloaded.findSignature("remove").has_value());
+}
+
+TEST_F(CacheTest, JournalSurvivesMissingSave)
+{
+    {
+        mimir::Cache cache(testDir_);
+        cache.setSignature("before_journal", "x");
+        ASSERT_TRUE(cache.save());
+
+        ASSERT_TRUE(cache.enableJournal());
+        EXPECT_TRUE(cache.isJournalEnabled());
+        cache.setSignature("built", "1");
+        cache.setSignature("built_too", "2");
+        EXPECT_TRUE(cache.removeSignature("before_journal"));
+        cache.flushJournal();
+        // No save(): simulates the process being killed after these targets
+    }
+
+    mimir::Cache recovered(testDir_);
+    ASSERT_TRUE(recovered.load());
+    EXPECT_EQ(recovered.getSignature("built"), "1");
+    EXPECT_EQ(recovered.getSignature("built_too"), "2");
+    EXPECT_FALSE(recovered.findSignature("before_journal").has_value());
+}
+
+TEST_F(CacheTest, SaveCompactsJournal)
+{
+    mimir::Cache cache(testDir_);
+    ASSERT_TRUE(cache.enableJournal());
+    for (int i = 0; i < 100; ++i)
+    {
+        cache.setSignature("target_" + std::to_string(i), "sig");
+    }
+    cache.flushJournal();
+    const auto journalSize = fs::file_size(cache.getJournalFile());
+
+    ASSERT_TRUE(cache.save());
+    EXPECT_LT(fs::file_size(cache.getJournalFile()), journalSize);
+
+    mimir::Cache loaded(testDir_);
+    ASSERT_TRUE(loaded.load());
+    EXPECT_EQ(loaded.size(), 100u);
+}
+
+TEST_F(CacheTest, CheckpointLeavesTheSnapshotAloneWhileTheJournalIsSmall)
+{
+    {
+        mimir::Cache cache(testDir_);
+        cache.setSignature("old", "1");
+        ASSERT_TRUE(cache.save());
+    }
+    const auto snapshotTime = fs::last_write_time(testDir_ + "/cache.bin");
+
+    {
+        mimir::Cache cache(testDir_);
+        ASSERT_TRUE(cache.load());
+        ASSERT_TRUE(cache.enableJournal());
+        cache.setSignature("new", "2");
+        ASSERT_TRUE(cache.checkpoint());
+        EXPECT_GT(fs::file_size(cache.getJournalFile()), 0u);
+    }
+    EXPECT_EQ(fs::last_write_time(testDir_ + "/cache.bin"), snapshotTime);
+
+    mimir::Cache loaded(testDir_);
+    ASSERT_TRUE(loaded.load());
+    EXPECT_EQ(loaded.getSignature("old"), "1");
+    EXPECT_EQ(loaded.getSignature("new"), "2");
+}
+
+TEST_F(CacheTest, CheckpointCompactsALargeJournal)
+{
+    mimir::Cache cache(testDir_);
+    ASSERT_TRUE(cache.enableJournal());
+    const std::string signature(64, 'a');
+    for (int i = 0; i < 120000; ++i)
+    {
+        cache.setSignature("target_" + std::to_string(i), signature);
+    }
+    ASSERT_TRUE(cache.checkpoint());
+    EXPECT_TRUE(fs::exists(testDir_ + "/cache.bin"));
+    EXPECT_LT(fs::file_size(cache.getJournalFile()), 1024u);
+
+    mimir::Cache loaded(testDir_);
+    ASSERT_TRUE(loaded.load());
+    EXPECT_EQ(loaded.size(), 120000u);
+}
+
+TEST_F(CacheTest, CheckpointWithoutJournalSaves)
+{
+    {
+        mimir::Cache cache(testDir_);
+        cache.setSignature("target", "1");
+        ASSERT_TRUE(cache.checkpoint());
+    }
+    mimir::Cache loaded(testDir_);
+    ASSERT_TRUE(loaded.load());
+    EXPECT_EQ(loaded.getSignature("target"), "1");
+}
+
+TEST_F(CacheTest, JournaledClearIsReplayed)
+{
+    {
+        mimir::Cache cache(testDir_);
+        cache.setSignature("old", "1");
+        ASSERT_TRUE(cache.save());
+        ASSERT_TRUE(cache.enableJournal());
+        cache.clear();
+        cache.setSignature("new", "2");
+    }
+
+    mimir::Cache loaded(testDir_);
+    ASSERT_TRUE(loaded.load());
+    EXPECT_FALSE(loaded.findSignature("old").has_value());
+    EXPECT_EQ(loaded.getSignature("new"), "2");
+    EXPECT_EQ(loaded.size(), 1u);
+}
+
+TEST_F(CacheTest, ShardCountRoundsUpToPowerOfTwo)
+{
+    EXPECT_EQ(mimir::Cache(testDir_).shardCount(), mimir::Cache::DEFAULT_SHARD_COUNT);
+    EXPECT_EQ(mimir::Cache(testDir_, 0).shardCount(), 1u);
+    EXPECT_EQ(mimir::Cache(testDir_, 1).shardCount(), 1u);
+    EXPECT_EQ(mimir::Cache(testDir_, 5).shardCount(), 8u);
+}
+
+TEST_F(CacheTest, SnapshotIsIndependentOfShardCount)
+{
+    {
+        mimir::Cache cache(testDir_, 4);
+        for (int i = 0; i < 200; ++i)
+        {
+            cache.setSignature("target" + std::to_string(i), "sig" + std::to_string(i));
+        }
+        cache.removeSignature("target7");
+        ASSERT_TRUE(cache.save());
+    }
+
+    mimir::Cache reloaded(testDir_, 1);
+    ASSERT_TRUE(reloaded.load());
+    EXPECT_EQ(reloaded.size(), 199u);
+    EXPECT_FALSE(reloaded.findSignature("target7").has_value());
+    EXPECT_EQ(reloaded.getSignature("target150"), "sig150");
+}
+
+TEST_F(CacheTest, DurationsPersistInBothFormats)
+{
+    for (const auto format : {mimir::CacheFormat::Binary, mimir::CacheFormat::Text})
+    {
+        fs::remove_all(testDir_);
+        {
+            mimir::Cache cache(testDir_);
+            cache.setFormat(format);
+            cache.setDuration("compile main", 1500);
+            cache.setDuration("link", 42);
+            EXPECT_EQ(cache.findDuration("link"), std::optional<std::uint64_t>(42));
+            ASSERT_TRUE(cache.save());
+        }
+
+        mimir::Cache loaded(testDir_);
+        ASSERT_TRUE(loaded.load());
+        EXPECT_EQ(loaded.findDuration("compile main"), std::optional<std::uint64_t>(1500));
+        EXPECT_EQ(loaded.findDuration("link"), std::optional<std::uint64_t>(42));
+        EXPECT_FALSE(loaded.findDuration("never_ran").has_value());
+
+        // Overlay updates win over the loaded snapshot and survive another save
+        loaded.setDuration("link", 43);
+        ASSERT_TRUE(loaded.save());
+        mimir::Cache resaved(testDir_);
+        ASSERT_TRUE(resaved.load());
+        EXPECT_EQ(resaved.findDuration("link"), std::optional<std::uint64_t>(43));
+        EXPECT_EQ(resaved.findDuration("compile main"), std::optional<std::uint64_t>(1500));
+    }
+}
+
+TEST_F(CacheTest, DurationsAreJournaledAndCleared)
+{
+    {
+        mimir::Cache cache(testDir_);
+        ASSERT_TRUE(cache.enableJournal());
+        cache.setDuration("built", 7);
+        cache.flushJournal();
+    }
+
+    mimir::Cache recovered(testDir_);
+    ASSERT_TRUE(recovered.load());
+    EXPECT_EQ(recovered.findDuration("built"), std::optional<std::uint64_t>(7));
+
+    EXPECT_FALSE(recovered.removeSignature("built"));
+    EXPECT_TRUE(recovered.findDuration("built").has_value());
+    recovered.clear();
+    EXPECT_FALSE(recovered.findDuration("built").has_value());
+}
+
+TEST_F(CacheTest, OutputSignaturesPersistAndAreJournaled)
+{
+    for (const auto format : {mimir::CacheFormat::Binary, mimir::CacheFormat::Text})
+    {
+        fs::remove_all(testDir_);
+        {
+            mimir::Cache cache(testDir_);
+            cache.setFormat(format);
+            cache.setOutputSignature("codegen", "out1");
+            ASSERT_TRUE(cache.save());
+            ASSERT_TRUE(cache.enableJournal());
+            cache.setOutputSignature("bison", "out2");
+            cache.flushJournal();
+        }
+
+        mimir::Cache loaded(testDir_);
+        loaded.setFormat(format);
+        ASSERT_TRUE(loaded.load());
+        EXPECT_EQ(loaded.findOutputSignature("codegen"), std::optional<std::string>("out1"));
+        EXPECT_EQ(loaded.findOutputSignature("bison"), std::optional<std::string>("out2"));
+        EXPECT_FALSE(loaded.findOutputSignature("never_ran").has_value());
+        EXPECT_FALSE(loaded.findSignature("codegen").has_value());
+
+        ASSERT_TRUE(loaded.save());
+        mimir::Cache resaved(testDir_);
+        ASSERT_TRUE(resaved.load());
+        EXPECT_EQ(resaved.findOutputSignature("bison"), std::optional<std::string>("out2"));
+        resaved.clear();
+        EXPECT_FALSE(resaved.findOutputSignature("codegen").has_value());
+    }
+}
@@ -0,0 +1,220 @@
+#include "mimir/cache_format.h"
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+class CacheImageTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        testDir_ = "/tmp/test_cache_image_" + std::to_string(::testing::UnitTest::GetInstance()->random_seed());
+        fs::create_directories(testDir_);
+        path_ = testDir_ + "/cache.bin";
+    }
+
+    void TearDown() override
+    {
+        fs::remove_all(testDir_);
+    }
+
+    std::string testDir_;
+    std::string path_;
+};
+
+TEST_F(CacheImageTest, WriteAndLookup)
+{
+    mimir::FileRecord record;
+    record.stamp = {10, 20, 30};
+    record.hashedAtNs = 40;
+    record.algorithm = mimir::HashAlgorithm::BLAKE3;
+    record.hash = "cafe";
+
+    ASSERT_TRUE(mimir::CacheImage::write(path_,
+        {{"zeta", "3"}, {"alpha", "1"}, {"mid", "2"}},
+        {{"src/a.c", &record}}));
+
+    mimir::CacheImage image;
+    ASSERT_TRUE(image.open(path_));
+    EXPECT_EQ(image.signatureCount(), 3u);
+    EXPECT_EQ(image.findSignature("alpha"), std::string_view("1"));
+    EXPECT_EQ(image.findSignature("mid"), std::string_view("2"));
+    EXPECT_EQ(image.findSignature("zeta"), std::string_view("3"));
+    EXPECT_FALSE(image.findSignature("missing").has_value());
+    EXPECT_EQ(image.signatureAt(0).first, "alpha");
+
+    auto loaded = image.findFileRecord("src/a.c");
+    ASSERT_TRUE(loaded.has_value());
+    EXPECT_EQ(loaded->stamp, record.stamp);
+    EXPECT_EQ(loaded->hashedAtNs, 40);
+    EXPECT_EQ(loaded->algorithm, mimir::HashAlgorithm::BLAKE3);
+    EXPECT_EQ(loaded->hash, "cafe");
+    EXPECT_FALSE(image.findFileRecord("src/b.c").has_value());
+}
+
+TEST_F(CacheImageTest, EmptyImage)
+{
+    ASSERT_TRUE(mimir::CacheImage::write(path_, {}, {}));
+
+    mimir::CacheImage image;
+    ASSERT_TRUE(image.open(path_));
+    EXPECT_EQ(image.signatureCount(), 0u);
+    EXPECT_FALSE(image.findSignature("x").has_value());
+}
+
+TEST_F(CacheImageTest, RejectsMissingAndCorruptFiles)
+{
+    mimir::CacheImage image;
+    EXPECT_FALSE(image.open(testDir_ + "/nope.bin"));
+
+    std::ofstream(path_) << "target=signature\n";
+    EXPECT_FALSE(image.open(path_));
+    EXPECT_FALSE(image.isOpen());
+
+    // A truncated image fails validation instead of reading past the mapping
+    ASSERT_TRUE(mimir::CacheImage::write(path_, {{"target", "signature"}}, {}));
+    fs::resize_file(path_, fs::file_size(path_) - 3);
+    EXPECT_FALSE(image.open(path_));
+}
+
+TEST_F(CacheImageTest, MoveTransfersMapping)
+{
+    ASSERT_TRUE(mimir::CacheImage::write(path_, {{"t", "s"}}, {}));
+
+    mimir::CacheImage first;
+    ASSERT_TRUE(first.open(path_));
+    mimir::CacheImage second(std::move(first));
+    EXPECT_FALSE(first.isOpen());
+    EXPECT_EQ(second.findSignature("t"), std::string_view("s"));
+}
+
+TEST_F(CacheImageTest, ManyEntriesSorted)
+{
+    std::vector<std::string> keys;
+    for (int i = 0; i < 5000; ++i)
+    {
+        keys.push_back("target_" + std::to_string(i * 7919 % 5000));
+    }
+    std::vector<mimir::CacheImage::SignatureEntry> entries;
+    for (const auto& key : keys)
+    {
+        entries.emplace_back(key, key);
+    }
+    ASSERT_TRUE(mimir::CacheImage::write(path_, entries, {}));
+
+    mimir::CacheImage image;
+    ASSERT_TRUE(image.open(path_));
+    for (const auto& key : keys)
+    {
+        EXPECT_EQ(image.findSignature(key), std::string_view(key));
+    }
+}
+
+TEST_F(CacheImageTest, DurationsRoundTrip)
+{
+    ASSERT_TRUE(mimir::CacheImage::write(path_,
+        {{"link", "s1"}},
+        {},
+        {{"link", 2500000}, {"compile b", 400}, {"compile a", 300}}));
+
+    mimir::CacheImage image;
+    ASSERT_TRUE(image.open(path_));
+    EXPECT_EQ(image.durationCount(), 3u);
+    EXPECT_EQ(image.findDuration("link"), std::optional<std::uint64_t>(2500000));
+    EXPECT_EQ(image.findDuration("compile a"), std::optional<std::uint64_t>(300));
+    EXPECT_FALSE(image.findDuration("missing").has_value());
+    EXPECT_EQ(image.durationAt(0).first, "compile a");
+    EXPECT_EQ(image.findSignature("link"), std::string_view("s1"));
+}
+
+TEST_F(CacheImageTest, OutputSignaturesRoundTrip)
+{
+    ASSERT_TRUE(mimir::CacheImage::write(path_,
+        {{"codegen", "s1"}},
+        {},
+        {{"codegen", 10}},
+        {{"codegen", "out1"}, {"bison", "out2"}}));
+
+    mimir::CacheImage image;
+    ASSERT_TRUE(image.open(path_));
+    EXPECT_EQ(image.outputSignatureCount(), 2u);
+    EXPECT_EQ(image.findOutputSignature("codegen"), std::string_view("out1"));
+    EXPECT_EQ(image.findOutputSignature("bison"), std::string_view("out2"));
+    EXPECT_FALSE(image.findOutputSignature("missing").has_value());
+    EXPECT_EQ(image.outputSignatureAt(0).first, "bison");
+    EXPECT_EQ(image.findSignature("codegen"), std::string_view("s1"));
+    EXPECT_EQ(image.findDuration("codegen"), std::optional<std::uint64_t>(10));
+}
+
+TEST_F(CacheImageTest, ReadsVersionTwoImages)
+{
+    // Version 2: the word after the duration count was reserved and is ignored
+    auto put = [](std::string& out, auto value)
+    {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    };
+    std::string bytes(mimir::CacheImage::MAGIC, sizeof(mimir::CacheImage::MAGIC));
+    put(bytes, std::uint32_t{2});           // version
+    put(bytes, std::uint32_t{0x01020304});  // byte order
+    put(bytes, std::uint32_t{1});           // signatures
+    put(bytes, std::uint32_t{0});           // file records
+    put(bytes, std::uint64_t{48 + 16});     // pool offset
+    put(bytes, std::uint64_t{4});           // pool size
+    put(bytes, std::uint32_t{0});           // durations
+    put(bytes, std::uint32_t{7});           // reserved
+    put(bytes, std::uint32_t{0});
+    put(bytes, std::uint32_t{1});
+    put(bytes, std::uint32_t{1});
+    put(bytes, std::uint32_t{3});
+    bytes += "tsig";
+    std::ofstream(path_, std::ios::binary) << bytes;
+
+    mimir::CacheImage image;
+    ASSERT_TRUE(image.open(path_));
+    EXPECT_EQ(image.findSignature("t"), std::string_view("sig"));
+    EXPECT_EQ(image.outputSignatureCount(), 0u);
+    EXPECT_FALSE(image.findOutputSignature("t").has_value());
+}
+
+TEST_F(CacheImageTest, ReadsVersionOneImages)
+{
+    // Version 1: 40-byte header (no duration count), then slots and the pool
+    auto put = [](std::string& out, auto value)
+    {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    };
+    std::string bytes(mimir::CacheImage::MAGIC, sizeof(mimir::CacheImage::MAGIC));
+    put(bytes, std::uint32_t{1});           // version
+    put(bytes, std::uint32_t{0x01020304});  // byte order
+    put(bytes, std::uint32_t{1});           // signatures
+    put(bytes, std::uint32_t{0});           // file records
+    put(bytes, std::uint64_t{40 + 16});     // pool offset
+    put(bytes, std::uint64_t{4});           // pool size
+    put(bytes, std::uint32_t{0});
+    put(bytes, std::uint32_t{1});
+    put(bytes, std::uint32_t{1});
+    put(bytes, std::uint32_t{3});
+    bytes += "tsig";
+    std::ofstream(path_, std::ios::binary) << bytes;
+
+    mimir::CacheImage image;
+    ASSERT_TRUE(image.open(path_));
+    EXPECT_EQ(image.findSignature("t"), std::string_view("sig"));
+    EXPECT_EQ(image.durationCount(), 0u);
+    EXPECT_FALSE(image.findDuration("t").has_value());
+}
+
+TEST_F(CacheImageTest, ReplaceFileDurablySwapsContentsWhole)
+{
+    std::ofstream(path_) << "old";
+    ASSERT_TRUE(mimir::replaceFileDurably(path_, {"ne", "", "w"}));
+    std::ifstream file(path_);
+    EXPECT_EQ(std::string(std::istreambuf_iterator<char>(file), {}), "new");
+    EXPECT_FALSE(fs::exists(path_ + ".tmp"));
+
+    // A destination that cannot be written leaves nothing behind
+    EXPECT_FALSE(mimir::replaceFileDurably(testDir_ + "/missing/cache.bin", {"x"}));
+    EXPECT_FALSE(fs::exists(testDir_ + "/missing"));
+}
@@ -0,0 +1,177 @@
+#include "mimir/cache_journal.h"
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+class CacheJournalTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        testDir_ = "/tmp/test_cache_journal_" + std::to_string(::testing::UnitTest::GetInstance()->random_seed());
+        fs::create_directories(testDir_);
+        path_ = testDir_ + "/journal.log";
+    }
+
+    void TearDown() override
+    {
+        fs::remove_all(testDir_);
+    }
+
+    std::vector<mimir::JournalEntry> replayAll(mimir::JournalReplayResult* result = nullptr)
+    {
+        std::vector<mimir::JournalEntry> entries;
+        auto replayed = mimir::CacheJournal::replay(path_, [&entries](const mimir::JournalEntry& entry)
+        {
+            entries.push_back(entry);
+        });
+        if (result)
+        {
+            *result = replayed;
+        }
+        return entries;
+    }
+
+    std::string testDir_;
+    std::string path_;
+};
+
+TEST_F(CacheJournalTest, ReplaysRecordsInOrder)
+{
+    mimir::FileRecord record;
+    record.stamp = {1, 2, 3};
+    record.hashedAtNs = 4;
+    record.hash = "h";
+    {
+        mimir::CacheJournal journal(path_);
+        ASSERT_TRUE(journal.open());
+        journal.appendSetSignature("a", "1");
+        journal.appendFileRecord("src/a.c", record);
+        journal.appendRemoveSignature("a");
+        journal.appendRemoveFileRecord("src/a.c");
+        journal.appendClear();
+    }
+
+    const auto entries = replayAll();
+    ASSERT_EQ(entries.size(), 5u);
+    EXPECT_EQ(entries[0].type, mimir::JournalRecordType::SetSignature);
+    EXPECT_EQ(entries[0].key, "a");
+    EXPECT_EQ(entries[0].value, "1");
+    EXPECT_EQ(entries[1].type, mimir::JournalRecordType::SetFileRecord);
+    EXPECT_EQ(entries[1].record.stamp, record.stamp);
+    EXPECT_EQ(entries[1].record.hash, "h");
+    EXPECT_EQ(entries[2].type, mimir::JournalRecordType::RemoveSignature);
+    EXPECT_EQ(entries[3].type, mimir::JournalRecordType::RemoveFileRecord);
+    EXPECT_EQ(entries[4].type, mimir::JournalRecordType::Clear);
+}
+
+TEST_F(CacheJournalTest, FlushMakesRecordsDurable)
+{
+    mimir::CacheJournal journal(path_);
+    ASSERT_TRUE(journal.open());
+    journal.appendSetSignature("t", "s");
+    journal.flush();
+
+    // Readable while the journal is still open
+    EXPECT_EQ(replayAll().size(), 1u);
+    EXPECT_GT(journal.sizeBytes(), 8u);
+}
+
+TEST_F(CacheJournalTest, TornTailIsIgnoredAndCutOnOpen)
+{
+    {
+        mimir::CacheJournal journal(path_);
+        ASSERT_TRUE(journal.open());
+        journal.appendSetSignature("good", "1");
+    }
+    const auto intactSize = fs::file_size(path_);
+    {
+        std::ofstream file(path_, std::ios::binary | std::ios::app);
+        file << "\x20\x00\x00\x00garbage";
+    }
+
+    mimir::JournalReplayResult result;
+    EXPECT_EQ(replayAll(&result).size(), 1u);
+    EXPECT_TRUE(result.truncatedTail);
+    EXPECT_EQ(result.validBytes, intactSize);
+
+    {
+        mimir::CacheJournal journal(path_);
+        ASSERT_TRUE(journal.open());
+        journal.appendSetSignature("after", "2");
+    }
+    const auto entries = replayAll(&result);
+    ASSERT_EQ(entries.size(), 2u);
+    EXPECT_EQ(entries[1].key, "after");
+    EXPECT_FALSE(result.truncatedTail);
+}
+
+TEST_F(CacheJournalTest, CorruptRecordStopsReplay)
+{
+    {
+        mimir::CacheJournal journal(path_);
+        ASSERT_TRUE(journal.open());
+        journal.appendSetSignature("first", "1");
+        journal.appendSetSignature("second", "2");
+    }
+
+    // Flip a byte in the last record's payload: its checksum no longer matches
+    {
+        std::fstream file(path_, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(-1, std::ios::end);
+        file.put('X');
+    }
+    EXPECT_EQ(replayAll().size(), 1u);
+}
+
+TEST_F(CacheJournalTest, TruncateDropsRecords)
+{
+    mimir::CacheJournal journal(path_);
+    ASSERT_TRUE(journal.open());
+    journal.appendSetSignature("t", "s");
+    journal.truncate();
+    EXPECT_TRUE(replayAll().empty());
+
+    journal.appendSetSignature("u", "v");
+    journal.flush();
+    EXPECT_EQ(replayAll().size(), 1u);
+}
+
+TEST_F(CacheJournalTest, ConcurrentAppends)
+{
+    {
+        mimir::CacheJournal journal(path_);
+        ASSERT_TRUE(journal.open());
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t)
+        {
+            threads.emplace_back([&journal, t]()
+            {
+                for (int i = 0; i < 250; ++i)
+                {
+                    journal.appendSetSignature("t" + std::to_string(t) + "_" + std::to_string(i), "sig");
+                }
+            });
+        }
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+    }
+    EXPECT_EQ(replayAll().size(), 1000u);
+}
+
+TEST_F(CacheJournalTest, MissingOrForeignFile)
+{
+    mimir::JournalReplayResult result;
+    EXPECT_TRUE(replayAll(&result).empty());
+    EXPECT_EQ(result.validBytes, 0u);
+
+    std::ofstream(path_) << "not a journal";
+    EXPECT_TRUE(replayAll(&result).empty());
+    EXPECT_TRUE(result.truncatedTail);
+}
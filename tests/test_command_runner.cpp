@@ -3,6 +3,10 @@
 #include <gmock/gmock.h>
 #include <filesystem>
 #include <fstream>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
 
 namespace fs = std::filesystem;
 
@@ -213,3 +217,190 @@ TEST_F(CommandRunnerTest, CommandOptionsDefaults)
     EXPECT_TRUE(options.inheritEnvironment);
 }
 
+
+TEST_F(CommandRunnerTest, DirectArgumentsSplitsPlainCommands)
+{
+    const auto args = mimir::SystemCommandRunner::directArguments("gcc -O2  -c main.c\t-o build/main.o");
+    ASSERT_TRUE(args.has_value());
+    EXPECT_EQ(*args, (std::vector<std::string>{"gcc", "-O2", "-c", "main.c", "-o", "build/main.o"}));
+}
+
+TEST_F(CommandRunnerTest, DirectArgumentsRejectsShellSyntax)
+{
+    EXPECT_FALSE(mimir::SystemCommandRunner::directArguments("echo hi > out.txt").has_value());
+    EXPECT_FALSE(mimir::SystemCommandRunner::directArguments("a && b").has_value());
+    EXPECT_FALSE(mimir::SystemCommandRunner::directArguments("echo 'quoted'").has_value());
+    EXPECT_FALSE(mimir::SystemCommandRunner::directArguments("echo $HOME").has_value());
+    EXPECT_FALSE(mimir::SystemCommandRunner::directArguments("ls *.c").has_value());
+    EXPECT_FALSE(mimir::SystemCommandRunner::directArguments("CC=clang make").has_value());
+    EXPECT_FALSE(mimir::SystemCommandRunner::directArguments("cd build").has_value());
+    EXPECT_FALSE(mimir::SystemCommandRunner::directArguments("   ").has_value());
+}
+
+TEST_F(CommandRunnerTest, SystemCommandRunnerCapturesBothStreams)
+{
+    mimir::SystemCommandRunner runner;
+    mimir::CommandOptions options;
+    options.captureOutput = true;
+
+    // Enough output on both pipes to block a child whose parent drains them one at a time
+    const auto result = runner.run(
+        "i=0; while [ $i -lt 20000 ]; do echo out; echo err >&2; i=$((i+1)); done", options);
+
+    EXPECT_TRUE(result.success());
+    EXPECT_EQ(result.stdOut.size(), 20000u * 4);
+    EXPECT_EQ(result.stdErr.size(), 20000u * 4);
+}
+
+TEST_F(CommandRunnerTest, SystemCommandRunnerDirectExecCapturesOutput)
+{
+    mimir::SystemCommandRunner runner;
+    mimir::CommandOptions options;
+    options.captureOutput = true;
+
+    const auto result = runner.run("echo direct exec", options);
+
+    EXPECT_TRUE(result.success());
+    EXPECT_EQ(result.stdOut, "direct exec\n");
+}
+
+TEST_F(CommandRunnerTest, SystemCommandRunnerMissingProgramIs127)
+{
+    mimir::SystemCommandRunner runner;
+    mimir::CommandOptions options;
+    options.captureOutput = true;
+
+    const auto result = runner.run("mimir-no-such-program --flag", options);
+
+    EXPECT_EQ(result.exitCode, 127);
+    EXPECT_FALSE(result.stdErr.empty());
+}
+
+TEST_F(CommandRunnerTest, SystemCommandRunnerReportsSignals)
+{
+    mimir::SystemCommandRunner runner;
+
+    const auto result = runner.run("kill -9 $$");
+
+    EXPECT_EQ(result.exitCode, 128 + 9);
+}
+
+TEST_F(CommandRunnerTest, SystemCommandRunnerReportsResourceUsage)
+{
+    mimir::SystemCommandRunner runner;
+
+    const auto result = runner.run("i=0; while [ $i -lt 200000 ]; do i=$((i+1)); done");
+
+    EXPECT_TRUE(result.success());
+    EXPECT_GT(result.usage.userSeconds + result.usage.systemSeconds, 0.0);
+    EXPECT_GT(result.usage.maxRssKb, 0);
+}
+
+TEST_F(CommandRunnerTest, SystemCommandRunnerWithoutEnvironment)
+{
+    mimir::SystemCommandRunner runner;
+    mimir::CommandOptions options;
+    options.captureOutput = true;
+    options.inheritEnvironment = false;
+
+    const auto result = runner.run("/usr/bin/env", options);
+
+    EXPECT_TRUE(result.success());
+    EXPECT_EQ(result.stdOut, "");
+}
+
+TEST_F(CommandRunnerTest, SystemCommandRunnerEnvironmentOverrides)
+{
+    setenv("MIMIR_TEST_OVERRIDE", "inherited", 1);
+    mimir::SystemCommandRunner runner;
+    mimir::CommandOptions options;
+    options.captureOutput = true;
+    options.environment = {{"MIMIR_TEST_OVERRIDE", "replaced"}, {"MIMIR_TEST_ADDED", "new"}};
+
+    const auto result = runner.run("/bin/sh -c 'echo $MIMIR_TEST_OVERRIDE-$MIMIR_TEST_ADDED'", options);
+    EXPECT_EQ(result.stdOut, "replaced-new\n");
+
+    options.inheritEnvironment = false;
+    const auto isolated = runner.run("/usr/bin/env", options);
+    EXPECT_EQ(isolated.stdOut, "MIMIR_TEST_OVERRIDE=replaced\nMIMIR_TEST_ADDED=new\n");
+    unsetenv("MIMIR_TEST_OVERRIDE");
+}
+
+TEST_F(CommandRunnerTest, SystemCommandRunnerDirectExecInWorkingDir)
+{
+    mimir::SystemCommandRunner runner;
+    mimir::CommandOptions options;
+    options.workingDir = testDir_;
+
+    EXPECT_TRUE(runner.run("touch direct_workdir.txt", options).success());
+    EXPECT_TRUE(fs::exists(testDir_ + "/direct_workdir.txt"));
+}
+
+TEST_F(CommandRunnerTest, SystemCommandRunnerCaptureLimitKeepsTail)
+{
+    mimir::SystemCommandRunner runner;
+    mimir::CommandOptions options;
+    options.captureOutput = true;
+    options.maxCaptureBytes = 16;
+
+    const auto result = runner.run("printf 'aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaatail'", options);
+
+    EXPECT_TRUE(result.success());
+    EXPECT_EQ(result.stdOut, "[mimir: 28 earlier bytes discarded]\naaaaaaaaaaaatail");
+    EXPECT_EQ(result.droppedBytes, 28u);
+}
+
+TEST_F(CommandRunnerTest, SystemCommandRunnerSameCommandInParallel)
+{
+    mimir::SystemCommandRunner runner;
+    mimir::CommandOptions options;
+    options.captureOutput = true;
+
+    std::vector<std::thread> threads;
+    std::atomic<int> matches{0};
+    for (int i = 0; i < 8; ++i)
+    {
+        threads.emplace_back([&runner, &options, &matches]()
+        {
+            // Identical command text used to map to the same temporary capture files
+            const auto result = runner.run("echo same", options);
+            if (result.stdOut == "same\n")
+            {
+                ++matches;
+            }
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    EXPECT_EQ(matches.load(), 8);
+}
+
+TEST_F(CommandRunnerTest, SystemCommandRunnerTimeoutKillsProcessGroup)
+{
+    mimir::SystemCommandRunner runner;
+    mimir::CommandOptions options;
+    options.captureOutput = true;
+    options.timeoutSeconds = 1;
+
+    // The background sleep holds the capture pipes open; only a group kill releases them
+    const auto start = std::chrono::steady_clock::now();
+    const auto result = runner.run("sleep 30 & sleep 30; wait", options);
+
+    EXPECT_TRUE(result.timedOut);
+    EXPECT_FALSE(result.success());
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(10));
+}
+
+TEST_F(CommandRunnerTest, SystemCommandRunnerFinishesWithinTimeout)
+{
+    mimir::SystemCommandRunner runner;
+    mimir::CommandOptions options;
+    options.timeoutSeconds = 30;
+
+    const auto result = runner.run("true", options);
+
+    EXPECT_TRUE(result.success());
+    EXPECT_FALSE(result.timedOut);
+}
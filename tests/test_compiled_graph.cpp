@@ -0,0 +1,197 @@
+#include "mimir/compiled_graph.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <string>
+
+class CompiledGraphTest : public ::testing::Test
+{
+protected:
+    mimir::DAG dag;
+};
+
+TEST_F(CompiledGraphTest, EmptyDAG)
+{
+    mimir::CompiledGraph graph(dag);
+
+    EXPECT_EQ(graph.nodeCount(), 0u);
+    EXPECT_EQ(graph.edgeCount(), 0u);
+    EXPECT_TRUE(graph.topologicalOrder().empty());
+}
+
+TEST_F(CompiledGraphTest, EdgesInBothDirections)
+{
+    mimir::Target a("a");
+    mimir::Target b("b");
+    b.addDependency("a");
+    mimir::Target c("c");
+    c.addDependency("a");
+    c.addDependency("b");
+
+    dag.addTarget(a);
+    dag.addTarget(b);
+    dag.addTarget(c);
+
+    mimir::CompiledGraph graph(dag);
+    const mimir::NodeId na = graph.findNode("a");
+    const mimir::NodeId nb = graph.findNode("b");
+    const mimir::NodeId nc = graph.findNode("c");
+
+    ASSERT_NE(na, mimir::INVALID_NODE);
+    EXPECT_EQ(graph.nodeName(nb), "b");
+    EXPECT_EQ(&graph.target(nc), dag.getTarget("c"));
+    EXPECT_EQ(graph.edgeCount(), 3u);
+    EXPECT_EQ(graph.dependencies(nc).size(), 2u);
+    EXPECT_EQ(graph.dependents(na).size(), 2u);
+    ASSERT_EQ(graph.dependents(nb).size(), 1u);
+    EXPECT_EQ(graph.dependents(nb)[0], nc);
+    EXPECT_TRUE(graph.dependents(nc).empty());
+    EXPECT_EQ(graph.findNode("missing"), mimir::INVALID_NODE);
+}
+
+TEST_F(CompiledGraphTest, RepeatedDependencyIsOneEdge)
+{
+    mimir::Target a("a");
+    mimir::Target b("b");
+    b.addDependency("a");
+    b.addDependency("a");
+
+    dag.addTarget(a);
+    dag.addTarget(b);
+
+    mimir::CompiledGraph graph(dag);
+
+    EXPECT_EQ(graph.edgeCount(), 1u);
+    EXPECT_EQ(graph.inDegree(graph.findNode("b")), 1u);
+    EXPECT_EQ(graph.topologicalOrder().size(), 2u);
+}
+
+TEST_F(CompiledGraphTest, UnresolvedDependencyBlocksNode)
+{
+    mimir::Target a("a");
+    a.addDependency("ghost");
+    mimir::Target b("b");
+    b.addDependency("a");
+
+    dag.addTarget(a);
+    dag.addTarget(b);
+
+    mimir::CompiledGraph graph(dag);
+
+    EXPECT_EQ(graph.unresolvedDependencies(graph.findNode("a")), 1u);
+    EXPECT_EQ(graph.inDegree(graph.findNode("a")), 1u);
+    EXPECT_TRUE(graph.topologicalOrder().empty());
+}
+
+TEST_F(CompiledGraphTest, TopologicalOrderRespectsEdges)
+{
+    for (int i = 0; i < 50; ++i)
+    {
+        mimir::Target t("n" + std::to_string(i));
+        if (i > 0)
+        {
+            t.addDependency("n" + std::to_string(i - 1));
+        }
+        if (i > 1)
+        {
+            t.addDependency("n" + std::to_string(i - 2));
+        }
+        dag.addTarget(t);
+    }
+
+    mimir::CompiledGraph graph(dag);
+    auto order = graph.topologicalOrder();
+    ASSERT_EQ(order.size(), 50u);
+
+    std::vector<size_t> position(graph.nodeCount());
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+        position[order[i]] = i;
+    }
+    for (mimir::NodeId node = 0; node < graph.nodeCount(); ++node)
+    {
+        for (mimir::NodeId dep : graph.dependencies(node))
+        {
+            EXPECT_LT(position[dep], position[node]);
+        }
+    }
+}
+
+TEST_F(CompiledGraphTest, CyclicComponentsEmptyForAcyclicGraph)
+{
+    mimir::Target a("a");
+    mimir::Target b("b");
+    b.addDependency("a");
+
+    dag.addTarget(a);
+    dag.addTarget(b);
+
+    mimir::CompiledGraph graph(dag);
+
+    EXPECT_TRUE(graph.cyclicComponents().empty());
+}
+
+TEST_F(CompiledGraphTest, CycleInComponentIsClosedWalk)
+{
+    // Component {a, b, c, d} with a chord so several cycles exist
+    mimir::Target a("a");
+    a.addDependency("b");
+    mimir::Target b("b");
+    b.addDependency("c");
+    b.addDependency("d");
+    mimir::Target c("c");
+    c.addDependency("a");
+    mimir::Target d("d");
+    d.addDependency("b");
+
+    dag.addTarget(a);
+    dag.addTarget(b);
+    dag.addTarget(c);
+    dag.addTarget(d);
+
+    mimir::CompiledGraph graph(dag);
+    auto components = graph.cyclicComponents();
+    ASSERT_EQ(components.size(), 1u);
+    EXPECT_EQ(components[0].size(), 4u);
+
+    auto cycle = graph.cycleIn(components[0]);
+    ASSERT_GE(cycle.size(), 3u);
+    EXPECT_EQ(cycle.front(), cycle.back());
+    for (size_t i = 0; i + 1 < cycle.size(); ++i)
+    {
+        auto deps = graph.dependencies(cycle[i]);
+        EXPECT_NE(std::find(deps.begin(), deps.end(), cycle[i + 1]), deps.end());
+    }
+}
+
+TEST_F(CompiledGraphTest, CriticalPathsFollowHeaviestChain)
+{
+    // a -> b -> d and a -> c -> d: the path through the slow c dominates
+    mimir::Target a("a");
+    mimir::Target b("b");
+    b.addDependency("a");
+    mimir::Target c("c");
+    c.addDependency("a");
+    mimir::Target d("d");
+    d.addDependency("b");
+    d.addDependency("c");
+    mimir::Target lone("lone");
+    for (const auto& t : {a, b, c, d, lone})
+    {
+        dag.addTarget(t);
+    }
+
+    mimir::CompiledGraph graph(dag);
+    std::vector<std::uint64_t> weights(graph.nodeCount());
+    weights[graph.findNode("a")] = 1;
+    weights[graph.findNode("b")] = 2;
+    weights[graph.findNode("c")] = 10;
+    weights[graph.findNode("d")] = 3;
+    weights[graph.findNode("lone")] = 5;
+
+    const auto paths = graph.criticalPaths(weights);
+    EXPECT_EQ(paths[graph.findNode("d")], 3u);
+    EXPECT_EQ(paths[graph.findNode("b")], 5u);
+    EXPECT_EQ(paths[graph.findNode("c")], 13u);
+    EXPECT_EQ(paths[graph.findNode("a")], 14u);
+    EXPECT_EQ(paths[graph.findNode("lone")], 5u);
+}
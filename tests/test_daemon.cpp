@@ -0,0 +1,279 @@
+#include "mimir/daemon.h"
+#include "mimir/command_runner.h"
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+class DaemonTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        testDir_ = "/tmp/test_daemon_" + std::to_string(::testing::UnitTest::GetInstance()->random_seed());
+        fs::create_directories(testDir_);
+        std::ofstream(path("main.c")) << "int main() {}\n";
+        writeBuildFile("");
+
+        // Commands are "make <output>": the mock writes fresh contents to the output
+        runner_ = std::make_shared<mimir::MockCommandRunner>();
+        runner_->setHandler([this](const std::string& command, const mimir::CommandOptions&)
+        {
+            size_t run;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                executed_.push_back(command);
+                run = ++runs_;
+            }
+            std::ofstream(command.substr(5)) << "run " << run << "\n";
+            return mimir::CommandResult{0, "", "", false};
+        });
+
+        options_.buildFile = path("build.yaml");
+        options_.cacheDir = path("cache");
+        options_.socketPath = path("d.sock");
+        options_.config.colorOutput = false;
+        options_.settings = "client settings";
+    }
+
+    void TearDown() override
+    {
+        fs::remove_all(testDir_);
+    }
+
+    std::string path(const std::string& name) const
+    {
+        return testDir_ + "/" + name;
+    }
+
+    void writeBuildFile(const std::string& extra)
+    {
+        std::ofstream(path("build.yaml"))
+            << "targets:\n"
+            << "  - name: compile\n"
+            << "    inputs:\n      - " << path("main.c") << "\n"
+            << "    outputs:\n      - " << path("main.o") << "\n"
+            << "    command: make " << path("main.o") << "\n"
+            << "  - name: link\n"
+            << "    inputs:\n      - " << path("main.o") << "\n"
+            << "    outputs:\n      - " << path("app") << "\n"
+            << "    command: make " << path("app") << "\n"
+            << "    dependencies:\n      - compile\n"
+            << "  - name: docs\n"
+            << "    outputs:\n      - " << path("docs.html") << "\n"
+            << "    command: make " << path("docs.html") << "\n"
+            << extra;
+    }
+
+    std::vector<std::string> takeExecuted()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<std::string> executed;
+        executed.swap(executed_);
+        return executed;
+    }
+
+    static int build(mimir::BuildDaemon& daemon, const std::vector<std::string>& goals, std::string* output = nullptr)
+    {
+        std::string text;
+        const int code = daemon.build(goals, [&text](const std::string& chunk) { text += chunk; });
+        if (output != nullptr)
+        {
+            *output = text;
+        }
+        return code;
+    }
+
+    std::string testDir_;
+    std::shared_ptr<mimir::MockCommandRunner> runner_;
+    mimir::DaemonOptions options_;
+    std::mutex mutex_;
+    std::vector<std::string> executed_;
+    size_t runs_ = 0;
+};
+
+TEST_F(DaemonTest, OnlyChangedFilesAndTheirDependentsAreChecked)
+{
+    mimir::BuildDaemon daemon(options_, runner_);
+    ASSERT_FALSE(daemon.load().has_value());
+    EXPECT_EQ(daemon.dirtyCount(), 3u);
+
+    ASSERT_EQ(build(daemon, {}), 0);
+    EXPECT_EQ(takeExecuted().size(), 3u);
+    EXPECT_EQ(daemon.dirtyCount(), 0u);
+
+    std::string output;
+    ASSERT_EQ(build(daemon, {}, &output), 0);
+    EXPECT_TRUE(takeExecuted().empty());
+    EXPECT_NE(output.find("up to date 3"), std::string::npos);
+
+    std::ofstream(path("main.c")) << "int main() { return 1; }\n";
+    daemon.refresh();
+    EXPECT_TRUE(daemon.isDirty("compile"));
+    EXPECT_TRUE(daemon.isDirty("link"));
+    EXPECT_FALSE(daemon.isDirty("docs"));
+
+    ASSERT_EQ(build(daemon, {"link"}), 0);
+    EXPECT_EQ(takeExecuted(), (std::vector<std::string>{"make " + path("main.o"), "make " + path("app")}));
+    EXPECT_EQ(daemon.dirtyCount(), 0u);
+}
+
+TEST_F(DaemonTest, DeletedOutputIsRebuilt)
+{
+    mimir::BuildDaemon daemon(options_, runner_);
+    ASSERT_FALSE(daemon.load().has_value());
+    ASSERT_EQ(build(daemon, {}), 0);
+    takeExecuted();
+
+    fs::remove(path("docs.html"));
+    ASSERT_EQ(build(daemon, {}), 0);
+    EXPECT_EQ(takeExecuted(), (std::vector<std::string>{"make " + path("docs.html")}));
+}
+
+TEST_F(DaemonTest, BuildFileChangesAreReloaded)
+{
+    mimir::BuildDaemon daemon(options_, runner_);
+    ASSERT_FALSE(daemon.load().has_value());
+    ASSERT_EQ(build(daemon, {}), 0);
+    takeExecuted();
+
+    std::ofstream(path("build.yaml")) << "targets:\n  - name: broken\n    command: make x\n    dependencies:\n      - nowhere\n";
+    std::string output;
+    EXPECT_EQ(build(daemon, {}, &output), 1);
+    EXPECT_NE(output.find("Missing dependencies: nowhere"), std::string::npos);
+
+    writeBuildFile("  - name: extra\n    outputs:\n      - " + path("extra") + "\n    command: make " + path("extra") + "\n");
+    ASSERT_EQ(build(daemon, {}), 0);
+    // Unchanged targets are still up to date by signature; only the new one runs
+    EXPECT_EQ(takeExecuted(), (std::vector<std::string>{"make " + path("extra")}));
+}
+
+TEST_F(DaemonTest, IncludedFileChangesAreReloaded)
+{
+    std::ofstream(path("pkg.yaml")) << "targets:\n  - name: pkg\n    outputs:\n      - " << path("pkg.out")
+        << "\n    command: make " << path("pkg.out") << "\n";
+    writeBuildFile("include:\n  - pkg.yaml\n");
+    mimir::BuildDaemon daemon(options_, runner_);
+    ASSERT_FALSE(daemon.load().has_value());
+    ASSERT_EQ(build(daemon, {"pkg"}), 0);
+    EXPECT_EQ(takeExecuted(), (std::vector<std::string>{"make " + path("pkg.out")}));
+
+    std::ofstream(path("pkg.yaml"), std::ios::app) << "  - name: extra\n    outputs:\n      - " << path("extra")
+        << "\n    command: make " << path("extra") << "\n";
+    ASSERT_EQ(build(daemon, {"pkg", "extra"}), 0);
+    EXPECT_EQ(takeExecuted(), (std::vector<std::string>{"make " + path("extra")}));
+}
+
+TEST_F(DaemonTest, NewFilesMatchingAGlobAreReloaded)
+{
+    fs::create_directories(path("src"));
+    std::ofstream(path("src/a.c")) << "a\n";
+    writeBuildFile("  - name: objects\n    inputs:\n      - " + path("src/*.c") + "\n    outputs:\n      - "
+        + path("objects") + "\n    command: cc ${inputs}\n");
+    runner_->setHandler([this](const std::string& command, const mimir::CommandOptions&)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        executed_.push_back(command);
+        std::ofstream(command.rfind("make ", 0) == 0 ? command.substr(5) : path("objects")) << command << "\n";
+        return mimir::CommandResult{0, "", "", false};
+    });
+    mimir::BuildDaemon daemon(options_, runner_);
+    ASSERT_FALSE(daemon.load().has_value());
+    ASSERT_EQ(build(daemon, {}), 0);
+    EXPECT_EQ(takeExecuted().size(), 4u);
+    // Settles the events of the first build's own writes
+    ASSERT_EQ(build(daemon, {}), 0);
+    EXPECT_TRUE(takeExecuted().empty());
+
+    // Entries the glob does not match leave the graph alone; a reload would mark everything dirty
+    std::ofstream(path("src/notes.txt")) << "x\n";
+    daemon.refresh();
+    EXPECT_FALSE(daemon.isDirty("docs"));
+
+    std::ofstream(path("src/b.c")) << "b\n";
+    ASSERT_EQ(build(daemon, {"objects"}), 0);
+    EXPECT_EQ(takeExecuted(), (std::vector<std::string>{"cc " + path("src/a.c") + " " + path("src/b.c")}));
+
+    fs::remove(path("src/a.c"));
+    ASSERT_EQ(build(daemon, {"objects"}), 0);
+    EXPECT_EQ(takeExecuted(), (std::vector<std::string>{"cc " + path("src/b.c")}));
+}
+
+TEST_F(DaemonTest, DiscoveredHeadersAreWatched)
+{
+    std::ofstream(path("config.h")) << "#define A 1\n";
+    writeBuildFile("  - name: msvc\n    deps: msvc\n    outputs:\n      - " + path("msvc.obj")
+        + "\n    command: make " + path("msvc.obj") + "\n");
+    runner_->setHandler([this](const std::string& command, const mimir::CommandOptions&)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            executed_.push_back(command);
+        }
+        std::ofstream(command.substr(5)) << "built\n";
+        return mimir::CommandResult{0, "Note: including file: " + path("config.h") + "\n", "", false};
+    });
+    mimir::BuildDaemon daemon(options_, runner_);
+    ASSERT_FALSE(daemon.load().has_value());
+
+    ASSERT_EQ(build(daemon, {"msvc"}), 0);
+    EXPECT_EQ(takeExecuted(), (std::vector<std::string>{"make " + path("msvc.obj")}));
+    ASSERT_EQ(build(daemon, {"msvc"}), 0);
+    EXPECT_TRUE(takeExecuted().empty());
+
+    std::ofstream(path("config.h")) << "#define A 2\n";
+    ASSERT_EQ(build(daemon, {"msvc"}), 0);
+    EXPECT_EQ(takeExecuted(), (std::vector<std::string>{"make " + path("msvc.obj")}));
+}
+
+TEST_F(DaemonTest, UnknownGoalFails)
+{
+    mimir::BuildDaemon daemon(options_, runner_);
+    ASSERT_FALSE(daemon.load().has_value());
+    std::string output;
+    EXPECT_EQ(build(daemon, {"nope"}, &output), 1);
+    EXPECT_NE(output.find("Unknown target: nope"), std::string::npos);
+    EXPECT_TRUE(takeExecuted().empty());
+}
+
+TEST_F(DaemonTest, ServesClientsOverTheSocket)
+{
+    mimir::BuildDaemon daemon(options_, runner_);
+    const auto error = daemon.start();
+    ASSERT_FALSE(error.has_value()) << *error;
+    std::thread server([&daemon]() { daemon.serve(); });
+
+    {
+        mimir::BuildDaemon second(options_, runner_);
+        const auto refused = second.start();
+        ASSERT_TRUE(refused.has_value());
+        EXPECT_NE(refused->find("already running"), std::string::npos);
+    }
+
+    std::ostringstream out;
+    EXPECT_EQ(mimir::buildOnDaemon(options_.socketPath, options_.buildFile, options_.settings, {"compile"}, out),
+              std::optional<int>(0));
+    EXPECT_NE(out.str().find("[ SUCCESS ] compile"), std::string::npos);
+    EXPECT_NE(out.str().find("Build completed successfully!"), std::string::npos);
+    EXPECT_EQ(takeExecuted().size(), 1u);
+
+    std::ostringstream failed;
+    EXPECT_EQ(mimir::buildOnDaemon(options_.socketPath, options_.buildFile, options_.settings, {"nope"}, failed),
+              std::optional<int>(1));
+
+    // A daemon for another build file declines, so the client builds locally
+    std::ostringstream other;
+    EXPECT_FALSE(mimir::buildOnDaemon(options_.socketPath, path("other.yaml"), options_.settings, {}, other).has_value());
+    // So does one started with other options, rather than ignore the client's
+    EXPECT_FALSE(mimir::buildOnDaemon(options_.socketPath, options_.buildFile, "other", {"compile"}, other).has_value());
+    EXPECT_TRUE(takeExecuted().empty());
+
+    EXPECT_TRUE(mimir::stopDaemon(options_.socketPath));
+    server.join();
+    EXPECT_FALSE(mimir::stopDaemon(options_.socketPath));
+    EXPECT_FALSE(mimir::buildOnDaemon(options_.socketPath, options_.buildFile, options_.settings, {}, other).has_value());
+}
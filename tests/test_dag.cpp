@@ -354,3 +354,260 @@ TEST_F(DAGTest, AddTargetPtrAndRetrieve)
     EXPECT_EQ(retrieved->getName(), "ptr_target");
 }
 
+
+TEST_F(DAGTest, RemoveTargetUpdatesDependents)
+{
+    mimir::Target t1("t1");
+    mimir::Target t2("t2");
+    t2.addDependency("t1");
+    mimir::Target t3("t3");
+    t3.addDependency("t1");
+
+    dag.addTarget(t1);
+    dag.addTarget(t2);
+    dag.addTarget(t3);
+
+    EXPECT_TRUE(dag.removeTarget("t2"));
+
+    auto dependents = dag.getDependents("t1");
+    ASSERT_EQ(dependents.size(), 1u);
+    EXPECT_EQ(dependents[0], "t3");
+    EXPECT_FALSE(dag.removeTarget("t2"));
+}
+
+TEST_F(DAGTest, RemoveTargetClearsMissingDependency)
+{
+    mimir::Target t1("t1");
+    t1.addDependency("missing");
+    dag.addTarget(t1);
+
+    ASSERT_EQ(dag.validateDependencies().size(), 1u);
+
+    dag.removeTarget("t1");
+
+    EXPECT_TRUE(dag.validateDependencies().empty());
+}
+
+TEST_F(DAGTest, TopologicalSortAfterRemovingDependency)
+{
+    mimir::Target t1("t1");
+    mimir::Target t2("t2");
+    t2.addDependency("t1");
+
+    dag.addTarget(t1);
+    dag.addTarget(t2);
+    dag.removeTarget("t1");
+
+    // t2 now depends on a missing target and cannot be scheduled
+    EXPECT_TRUE(dag.topologicalSort().empty());
+}
+
+TEST_F(DAGTest, TopologicalSortOmitsCycleMembers)
+{
+    mimir::Target a("a");
+    mimir::Target b("b");
+    b.addDependency("c");
+    mimir::Target c("c");
+    c.addDependency("b");
+    mimir::Target d("d");
+    d.addDependency("b");
+
+    dag.addTarget(a);
+    dag.addTarget(b);
+    dag.addTarget(c);
+    dag.addTarget(d);
+
+    auto order = dag.topologicalSort();
+    ASSERT_EQ(order.size(), 1u);
+    EXPECT_EQ(order[0], "a");
+}
+
+TEST_F(DAGTest, TopologicalSortLongChainAndWideFanIn)
+{
+    constexpr int count = 20000;
+    mimir::Target sink("sink");
+    for (int i = 0; i < count; ++i)
+    {
+        mimir::Target t("n" + std::to_string(i));
+        if (i > 0)
+        {
+            t.addDependency("n" + std::to_string(i - 1));
+        }
+        sink.addDependency("n" + std::to_string(i));
+        dag.addTarget(std::move(t));
+    }
+    dag.addTarget(std::move(sink));
+
+    auto order = dag.topologicalSort();
+    ASSERT_EQ(order.size(), static_cast<size_t>(count + 1));
+    EXPECT_EQ(order.front(), "n0");
+    EXPECT_EQ(order.back(), "sink");
+    EXPECT_EQ(dag.getDependents("n0").size(), 2u);
+}
+
+TEST_F(DAGTest, GetDependentsDeduplicatesRepeatedDependency)
+{
+    mimir::Target t1("t1");
+    mimir::Target t2("t2");
+    t2.addDependency("t1");
+    t2.addDependency("t1");
+
+    dag.addTarget(t1);
+    dag.addTarget(t2);
+
+    auto dependents = dag.getDependents("t1");
+    ASSERT_EQ(dependents.size(), 1u);
+    EXPECT_EQ(dependents[0], "t2");
+
+    auto order = dag.topologicalSort();
+    ASSERT_EQ(order.size(), 2u);
+    EXPECT_EQ(order[1], "t2");
+}
+
+TEST_F(DAGTest, DetectCyclesReportsEveryComponent)
+{
+    // Two disjoint cycles plus an acyclic target hanging off one of them
+    mimir::Target a("a");
+    a.addDependency("b");
+    mimir::Target b("b");
+    b.addDependency("a");
+    mimir::Target x("x");
+    x.addDependency("y");
+    mimir::Target y("y");
+    y.addDependency("z");
+    mimir::Target z("z");
+    z.addDependency("x");
+    mimir::Target leaf("leaf");
+    leaf.addDependency("a");
+
+    dag.addTarget(a);
+    dag.addTarget(b);
+    dag.addTarget(x);
+    dag.addTarget(y);
+    dag.addTarget(z);
+    dag.addTarget(leaf);
+
+    auto result = dag.detectCyclesWithResult();
+
+    ASSERT_TRUE(result.hasCycle);
+    ASSERT_EQ(result.components.size(), 2u);
+    std::vector<size_t> sizes = {result.components[0].size(), result.components[1].size()};
+    std::sort(sizes.begin(), sizes.end());
+    EXPECT_EQ(sizes[0], 2u);
+    EXPECT_EQ(sizes[1], 3u);
+    for (const auto& component : result.components)
+    {
+        EXPECT_EQ(std::find(component.begin(), component.end(), "leaf"), component.end());
+    }
+}
+
+TEST_F(DAGTest, DetectCyclesPathFollowsDependencies)
+{
+    mimir::Target a("a");
+    a.addDependency("b");
+    mimir::Target b("b");
+    b.addDependency("c");
+    mimir::Target c("c");
+    c.addDependency("a");
+
+    dag.addTarget(a);
+    dag.addTarget(b);
+    dag.addTarget(c);
+
+    auto result = dag.detectCyclesWithPath();
+
+    ASSERT_TRUE(result.hasCycle);
+    ASSERT_EQ(result.cycleNodes.size(), 4u);
+    EXPECT_EQ(result.cycleNodes.front(), result.cycleNodes.back());
+    for (size_t i = 0; i + 1 < result.cycleNodes.size(); ++i)
+    {
+        auto deps = dag.getDependencies(result.cycleNodes[i]);
+        EXPECT_NE(std::find(deps.begin(), deps.end(), result.cycleNodes[i + 1]), deps.end());
+    }
+}
+
+TEST_F(DAGTest, DetectSelfCycleComponent)
+{
+    mimir::Target t1("self");
+    t1.addDependency("self");
+    mimir::Target t2("other");
+
+    dag.addTarget(t1);
+    dag.addTarget(t2);
+
+    auto result = dag.detectCyclesWithResult();
+
+    ASSERT_TRUE(result.hasCycle);
+    ASSERT_EQ(result.components.size(), 1u);
+    EXPECT_EQ(result.components[0], std::vector<std::string>{"self"});
+    EXPECT_EQ(result.cycleNodes, (std::vector<std::string>{"self", "self"}));
+}
+
+TEST_F(DAGTest, DetectCyclesDeepChainDoesNotRecurse)
+{
+    constexpr int depth = 200000;
+    for (int i = 0; i < depth; ++i)
+    {
+        mimir::Target t("n" + std::to_string(i));
+        if (i > 0)
+        {
+            t.addDependency("n" + std::to_string(i - 1));
+        }
+        dag.addTarget(std::move(t));
+    }
+
+    EXPECT_FALSE(dag.detectCycles());
+
+    // Closing the chain turns the whole graph into one component
+    dag.removeTarget("n0");
+    mimir::Target closing("n0");
+    closing.addDependency("n" + std::to_string(depth - 1));
+    dag.addTarget(std::move(closing));
+
+    auto result = dag.detectCyclesWithResult();
+    ASSERT_TRUE(result.hasCycle);
+    ASSERT_EQ(result.components.size(), 1u);
+    EXPECT_EQ(result.components[0].size(), static_cast<size_t>(depth));
+    EXPECT_EQ(result.cycleNodes.size(), static_cast<size_t>(depth + 1));
+}
+
+TEST_F(DAGTest, DetectCyclesIgnoresMissingDependencies)
+{
+    mimir::Target t1("t1");
+    t1.addDependency("missing");
+
+    dag.addTarget(t1);
+
+    EXPECT_FALSE(dag.detectCycles());
+}
+
+TEST_F(DAGTest, ClosureHoldsGoalsAndTheirDependencies)
+{
+    // base <- lib <- app, base <- tool, unrelated
+    mimir::Target base("base");
+    mimir::Target lib("lib");
+    lib.addDependency("base");
+    mimir::Target app("app");
+    app.addDependency("lib");
+    app.addDependency("base");
+    mimir::Target tool("tool");
+    tool.addDependency("base");
+    mimir::Target unrelated("unrelated");
+    for (const auto* target : {&base, &lib, &app, &tool, &unrelated})
+    {
+        dag.addTarget(*target);
+    }
+
+    const mimir::DAG sub = dag.closure({"app"});
+    EXPECT_EQ(sub.size(), 3u);
+    EXPECT_TRUE(sub.hasTarget("app"));
+    EXPECT_TRUE(sub.hasTarget("lib"));
+    EXPECT_TRUE(sub.hasTarget("base"));
+    EXPECT_EQ(sub.getTargetPtr("lib"), dag.getTargetPtr("lib"));
+    EXPECT_EQ(sub.topologicalSort().back(), "app");
+
+    const mimir::DAG both = dag.closure({"tool", "lib", "missing"});
+    EXPECT_EQ(both.size(), 3u);
+    EXPECT_FALSE(both.hasTarget("app"));
+    EXPECT_TRUE(dag.closure({}).empty());
+}
@@ -0,0 +1,50 @@
+#include "mimir/depfile.h"
+#include <gtest/gtest.h>
+
+using Paths = std::vector<std::string>;
+
+TEST(DepfileTest, ParsesGccOutput)
+{
+    const auto deps = mimir::parseDepfile("build/main.o: src/main.c include/a.h \\\n  include/b.h\n");
+    ASSERT_TRUE(deps.has_value());
+    EXPECT_EQ(*deps, (Paths{"src/main.c", "include/a.h", "include/b.h"}));
+}
+
+TEST(DepfileTest, MergesPhonyRulesAndDropsDuplicates)
+{
+    const auto deps = mimir::parseDepfile("main.o main.d: main.c a.h\n\na.h:\n\nmain.o: a.h b.h\r\n");
+    ASSERT_TRUE(deps.has_value());
+    EXPECT_EQ(*deps, (Paths{"main.c", "a.h", "b.h"}));
+}
+
+TEST(DepfileTest, UnescapesSpacesHashesAndDollars)
+{
+    const auto deps = mimir::parseDepfile("out.o : my\\ file.c odd\\#name.h cost$$.h\n");
+    ASSERT_TRUE(deps.has_value());
+    EXPECT_EQ(*deps, (Paths{"my file.c", "odd#name.h", "cost$.h"}));
+}
+
+TEST(DepfileTest, KeepsWindowsPaths)
+{
+    const auto deps = mimir::parseDepfile("C:\\build\\main.obj: C:\\src\\main.c \\\r\n C:\\src\\a.h\r\n");
+    ASSERT_TRUE(deps.has_value());
+    EXPECT_EQ(*deps, (Paths{"C:\\src\\main.c", "C:\\src\\a.h"}));
+}
+
+TEST(DepfileTest, AcceptsEmptyInputAndRejectsRulesWithoutColon)
+{
+    EXPECT_EQ(mimir::parseDepfile(""), Paths{});
+    EXPECT_EQ(mimir::parseDepfile("# only a comment\n"), Paths{});
+    EXPECT_FALSE(mimir::parseDepfile("main.o main.c\n").has_value());
+    EXPECT_FALSE(mimir::parseDepfile(": main.c\n").has_value());
+}
+
+TEST(DepfileTest, ExtractsShowIncludes)
+{
+    std::string filtered;
+    const auto headers = mimir::parseShowIncludes(
+        "main.cpp\r\nNote: including file: C:\\inc\\a.h\r\nNote: including file:  C:\\inc\\b.h\r\n"
+        "Note: including file: C:\\inc\\a.h\r\nmain.cpp(3): warning C4100\r\n", filtered);
+    EXPECT_EQ(headers, (Paths{"C:\\inc\\a.h", "C:\\inc\\b.h"}));
+    EXPECT_EQ(filtered, "main.cpp\r\nmain.cpp(3): warning C4100\r\n");
+}
@@ -0,0 +1,116 @@
+#include "mimir/deps_log.h"
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+class DepsLogTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        testDir_ = "/tmp/test_deps_log_" + std::to_string(::testing::UnitTest::GetInstance()->random_seed());
+        fs::create_directories(testDir_);
+        path_ = testDir_ + "/deps.bin";
+    }
+
+    void TearDown() override
+    {
+        fs::remove_all(testDir_);
+    }
+
+    std::string testDir_;
+    std::string path_;
+};
+
+TEST_F(DepsLogTest, RecordsSurviveReopening)
+{
+    {
+        mimir::DepsLog log(path_);
+        ASSERT_TRUE(log.open());
+        EXPECT_EQ(log.getDeps("main"), nullptr);
+        EXPECT_TRUE(log.record("main", {"main.c", "a.h"}));
+        EXPECT_TRUE(log.record("util", {"util.c", "a.h"}));
+        EXPECT_TRUE(log.record("main", {"main.c", "b.h"}));
+        EXPECT_TRUE(log.record("empty", {}));
+    }
+
+    mimir::DepsLog log(path_);
+    ASSERT_TRUE(log.open());
+    EXPECT_EQ(log.size(), 3u);
+    ASSERT_NE(log.getDeps("main"), nullptr);
+    EXPECT_EQ(*log.getDeps("main"), (std::vector<std::string>{"main.c", "b.h"}));
+    EXPECT_EQ(*log.getDeps("util"), (std::vector<std::string>{"util.c", "a.h"}));
+    EXPECT_TRUE(log.getDeps("empty")->empty());
+}
+
+TEST_F(DepsLogTest, UnchangedDepsWriteNothing)
+{
+    mimir::DepsLog log(path_);
+    ASSERT_TRUE(log.open());
+    EXPECT_TRUE(log.record("main", {"main.c", "a.h"}));
+    const auto size = fs::file_size(path_);
+    EXPECT_TRUE(log.record("main", {"main.c", "a.h"}));
+    EXPECT_EQ(fs::file_size(path_), size);
+}
+
+TEST_F(DepsLogTest, TornTailIsCutOff)
+{
+    {
+        mimir::DepsLog log(path_);
+        ASSERT_TRUE(log.open());
+        log.record("first", {"a.h"});
+        log.record("second", {"b.h"});
+    }
+    fs::resize_file(path_, fs::file_size(path_) - 2);
+
+    {
+        mimir::DepsLog log(path_);
+        ASSERT_TRUE(log.open());
+        EXPECT_NE(log.getDeps("first"), nullptr);
+        EXPECT_EQ(log.getDeps("second"), nullptr);
+        EXPECT_TRUE(log.record("third", {"c.h", "a.h"}));
+    }
+
+    mimir::DepsLog log(path_);
+    ASSERT_TRUE(log.open());
+    EXPECT_EQ(*log.getDeps("third"), (std::vector<std::string>{"c.h", "a.h"}));
+}
+
+TEST_F(DepsLogTest, ForeignFileStartsEmpty)
+{
+    std::ofstream(path_) << "not a deps log at all";
+    mimir::DepsLog log(path_);
+    ASSERT_TRUE(log.open());
+    EXPECT_EQ(log.size(), 0u);
+    EXPECT_TRUE(log.record("main", {"a.h"}));
+}
+
+TEST_F(DepsLogTest, RecompactionKeepsOnlyLatestRecords)
+{
+    {
+        mimir::DepsLog log(path_);
+        ASSERT_TRUE(log.open());
+        for (int i = 0; i < 2000; ++i)
+        {
+            log.record("main", {"main.c", "header" + std::to_string(i) + ".h"});
+        }
+    }
+    const auto before = fs::file_size(path_);
+
+    {
+        // Reopening compacts a log of mostly superseded records
+        mimir::DepsLog log(path_);
+        ASSERT_TRUE(log.open());
+        EXPECT_LT(fs::file_size(path_), before / 100);
+        EXPECT_EQ(*log.getDeps("main"), (std::vector<std::string>{"main.c", "header1999.h"}));
+        EXPECT_TRUE(log.record("util", {"header1999.h"}));
+        EXPECT_TRUE(log.recompact());
+    }
+
+    mimir::DepsLog log(path_);
+    ASSERT_TRUE(log.open());
+    EXPECT_EQ(log.size(), 2u);
+    EXPECT_EQ(*log.getDeps("util"), (std::vector<std::string>{"header1999.h"}));
+}
@@ -0,0 +1,92 @@
+#include "mimir/digest_table.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+TEST(FileDigestTableTest, ComputesOncePerPath)
+{
+    mimir::FileDigestTable table;
+    int calls = 0;
+    auto compute = [&calls](const std::string& path)
+    {
+        ++calls;
+        return "digest:" + path;
+    };
+
+    EXPECT_EQ(table.get("a.h", compute), "digest:a.h");
+    EXPECT_EQ(table.get("a.h", compute), "digest:a.h");
+    EXPECT_EQ(table.get("b.h", compute), "digest:b.h");
+    EXPECT_EQ(calls, 2);
+    EXPECT_EQ(table.size(), 2u);
+    EXPECT_EQ(table.computations(), 2u);
+}
+
+TEST(FileDigestTableTest, ConcurrentCallersShareOneComputation)
+{
+    mimir::FileDigestTable table(4);
+    std::atomic<int> calls{0};
+    auto compute = [&calls](const std::string& path)
+    {
+        ++calls;
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        return "digest:" + path;
+    };
+
+    std::vector<std::thread> threads;
+    std::vector<std::string> results(16);
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        threads.emplace_back([&, i]()
+        {
+            results[i] = table.get("common.h", compute);
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    EXPECT_EQ(calls.load(), 1);
+    for (const auto& result : results)
+    {
+        EXPECT_EQ(result, "digest:common.h");
+    }
+}
+
+TEST(FileDigestTableTest, FailedComputationIsRetried)
+{
+    mimir::FileDigestTable table;
+    bool fail = true;
+    auto compute = [&fail](const std::string&) -> std::string
+    {
+        if (fail)
+        {
+            throw std::runtime_error("read error");
+        }
+        return "ok";
+    };
+
+    EXPECT_THROW(table.get("x", compute), std::runtime_error);
+    fail = false;
+    EXPECT_EQ(table.get("x", compute), "ok");
+}
+
+TEST(FileDigestTableTest, ClearDropsEntries)
+{
+    mimir::FileDigestTable table;
+    int calls = 0;
+    auto compute = [&calls](const std::string&)
+    {
+        ++calls;
+        return std::string("d");
+    };
+
+    table.get("x", compute);
+    table.clear();
+    EXPECT_EQ(table.size(), 0u);
+    table.get("x", compute);
+    EXPECT_EQ(calls, 2);
+}
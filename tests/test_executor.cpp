@@ -10,6 +10,10 @@
 #include <thread>
 #include <chrono>
 #include <atomic>
+#include <mutex>
+#include <algorithm>
+#include <limits>
+#include <vector>
 
 namespace fs = std::filesystem;
 
@@ -335,6 +339,8 @@ TEST_F(ExecutorTest, ExecutorConfigDefaults)
     EXPECT_FALSE(config.verbose);
     EXPECT_TRUE(config.stopOnError);
     EXPECT_TRUE(config.colorOutput);
+    EXPECT_EQ(config.scheduler, mimir::SchedulerType::SharedQueue);
+    EXPECT_FALSE(config.paranoid);
 }
 
 TEST_F(ExecutorTest, ConstructorWithConfig)
@@ -593,3 +599,1126 @@ TEST_F(ExecutorTest, InstanceExecuteTargetWithMock)
     EXPECT_EQ(mockRunner->getLastCommand(), "mock command here");
 }
 
+
+TEST_F(ExecutorTest, MultiThreadedRespectsDependencyOrder)
+{
+    auto mockRunner = std::make_shared<mimir::MockCommandRunner>();
+    std::mutex orderMutex;
+    std::vector<std::string> executed;
+    mockRunner->setHandler([&](const std::string& command, const mimir::CommandOptions&)
+    {
+        std::lock_guard<std::mutex> lock(orderMutex);
+        executed.push_back(command);
+        return mimir::CommandResult{0, "", "", false};
+    });
+
+    mimir::Executor executor(4, mockRunner);
+    mimir::DAG dag;
+    mimir::Cache cache(cacheDir_);
+
+    // Two chains of ten targets joined by a final sink
+    for (int chain = 0; chain < 2; ++chain)
+    {
+        for (int i = 0; i < 10; ++i)
+        {
+            std::string name = "c" + std::to_string(chain) + "_" + std::to_string(i);
+            mimir::Target target(name);
+            target.setCommand(name);
+            if (i > 0)
+            {
+                target.addDependency("c" + std::to_string(chain) + "_" + std::to_string(i - 1));
+            }
+            dag.addTarget(target);
+        }
+    }
+    mimir::Target sink("sink");
+    sink.setCommand("sink");
+    sink.addDependency("c0_9");
+    sink.addDependency("c1_9");
+    dag.addTarget(sink);
+
+    mimir::BuildStats stats;
+    EXPECT_TRUE(executor.executeWithStats(dag, cache, stats));
+    EXPECT_EQ(stats.builtTargets, 21u);
+
+    ASSERT_EQ(executed.size(), 21u);
+    auto position = [&](const std::string& name)
+    {
+        return std::find(executed.begin(), executed.end(), name) - executed.begin();
+    };
+    for (int chain = 0; chain < 2; ++chain)
+    {
+        for (int i = 1; i < 10; ++i)
+        {
+            EXPECT_LT(position("c" + std::to_string(chain) + "_" + std::to_string(i - 1)),
+                      position("c" + std::to_string(chain) + "_" + std::to_string(i)));
+        }
+    }
+    EXPECT_EQ(executed.back(), "sink");
+}
+
+TEST_F(ExecutorTest, MultiThreadedStopsDependentsOnFailure)
+{
+    auto mockRunner = std::make_shared<mimir::MockCommandRunner>();
+    mockRunner->setResultFor("broken", mimir::CommandResult{1, "", "", false});
+
+    mimir::Executor executor(4, mockRunner);
+    mimir::DAG dag;
+    mimir::Cache cache(cacheDir_);
+
+    mimir::Target root("root");
+    root.setCommand("broken");
+    dag.addTarget(root);
+
+    for (int i = 0; i < 8; ++i)
+    {
+        mimir::Target child("child_" + std::to_string(i));
+        child.setCommand("child_" + std::to_string(i));
+        child.addDependency("root");
+        dag.addTarget(child);
+    }
+
+    mimir::BuildStats stats;
+    EXPECT_FALSE(executor.executeWithStats(dag, cache, stats));
+    EXPECT_EQ(stats.failedTargets, 1u);
+    EXPECT_EQ(stats.builtTargets, 0u);
+    EXPECT_EQ(mockRunner->getCommandCount(), 1u);
+}
+
+TEST_F(ExecutorTest, MultiThreadedWideGraphBuildsEveryTarget)
+{
+    auto mockRunner = std::make_shared<mimir::MockCommandRunner>();
+    std::atomic<size_t> runs{0};
+    mockRunner->setHandler([&](const std::string&, const mimir::CommandOptions&)
+    {
+        ++runs;
+        return mimir::CommandResult{0, "", "", false};
+    });
+
+    mimir::Executor executor(8, mockRunner);
+    mimir::DAG dag;
+    mimir::Cache cache(cacheDir_);
+
+    mimir::Target root("root");
+    root.setCommand("root");
+    dag.addTarget(root);
+    for (int i = 0; i < 200; ++i)
+    {
+        mimir::Target leaf("leaf_" + std::to_string(i));
+        leaf.setCommand("leaf_" + std::to_string(i));
+        leaf.addDependency("root");
+        dag.addTarget(leaf);
+    }
+
+    mimir::BuildStats stats;
+    EXPECT_TRUE(executor.executeWithStats(dag, cache, stats));
+    EXPECT_EQ(stats.totalTargets, 201u);
+    EXPECT_EQ(stats.builtTargets, 201u);
+    EXPECT_EQ(runs.load(), 201u);
+}
+
+TEST_F(ExecutorTest, WorkStealingRespectsDependencyOrder)
+{
+    auto mockRunner = std::make_shared<mimir::MockCommandRunner>();
+    std::mutex orderMutex;
+    std::vector<std::string> executed;
+    mockRunner->setHandler([&](const std::string& command, const mimir::CommandOptions&)
+    {
+        std::lock_guard<std::mutex> lock(orderMutex);
+        executed.push_back(command);
+        return mimir::CommandResult{0, "", "", false};
+    });
+
+    mimir::Executor executor(4, mockRunner);
+    mimir::ExecutorConfig config = executor.getConfig();
+    config.scheduler = mimir::SchedulerType::WorkStealing;
+    executor.setConfig(config);
+
+    mimir::DAG dag;
+    mimir::Cache cache(cacheDir_);
+
+    // Diamond fan-out: root -> 16 mids -> sink
+    mimir::Target root("root");
+    root.setCommand("root");
+    dag.addTarget(root);
+    mimir::Target sink("sink");
+    sink.setCommand("sink");
+    for (int i = 0; i < 16; ++i)
+    {
+        mimir::Target mid("mid_" + std::to_string(i));
+        mid.setCommand("mid_" + std::to_string(i));
+        mid.addDependency("root");
+        dag.addTarget(mid);
+        sink.addDependency("mid_" + std::to_string(i));
+    }
+    dag.addTarget(sink);
+
+    mimir::BuildStats stats;
+    EXPECT_TRUE(executor.executeWithStats(dag, cache, stats));
+    EXPECT_EQ(stats.builtTargets, 18u);
+
+    ASSERT_EQ(executed.size(), 18u);
+    EXPECT_EQ(executed.front(), "root");
+    EXPECT_EQ(executed.back(), "sink");
+}
+
+TEST_F(ExecutorTest, WorkStealingStopsDependentsOnFailure)
+{
+    auto mockRunner = std::make_shared<mimir::MockCommandRunner>();
+    mockRunner->setResultFor("broken", mimir::CommandResult{1, "", "", false});
+
+    mimir::Executor executor(4, mockRunner);
+    mimir::ExecutorConfig config = executor.getConfig();
+    config.scheduler = mimir::SchedulerType::WorkStealing;
+    executor.setConfig(config);
+
+    mimir::DAG dag;
+    mimir::Cache cache(cacheDir_);
+
+    mimir::Target root("root");
+    root.setCommand("broken");
+    dag.addTarget(root);
+    for (int i = 0; i < 8; ++i)
+    {
+        mimir::Target child("child_" + std::to_string(i));
+        child.setCommand("child_" + std::to_string(i));
+        child.addDependency("root");
+        dag.addTarget(child);
+    }
+
+    mimir::BuildStats stats;
+    EXPECT_FALSE(executor.executeWithStats(dag, cache, stats));
+    EXPECT_EQ(stats.failedTargets, 1u);
+    EXPECT_EQ(mockRunner->getCommandCount(), 1u);
+}
+
+TEST_F(ExecutorTest, WorkStealingDeepChainBuildsEveryTarget)
+{
+    auto mockRunner = std::make_shared<mimir::MockCommandRunner>();
+
+    mimir::Executor executor(4, mockRunner);
+    mimir::ExecutorConfig config = executor.getConfig();
+    config.scheduler = mimir::SchedulerType::WorkStealing;
+    executor.setConfig(config);
+
+    mimir::DAG dag;
+    mimir::Cache cache(cacheDir_);
+    for (int i = 0; i < 100; ++i)
+    {
+        mimir::Target target("step_" + std::to_string(i));
+        target.setCommand("step_" + std::to_string(i));
+        if (i > 0)
+        {
+            target.addDependency("step_" + std::to_string(i - 1));
+        }
+        dag.addTarget(target);
+    }
+
+    mimir::BuildStats stats;
+    EXPECT_TRUE(executor.executeWithStats(dag, cache, stats));
+    EXPECT_EQ(stats.builtTargets, 100u);
+    EXPECT_EQ(mockRunner->getLastCommand(), "step_99");
+}
+
+TEST_F(ExecutorTest, StatCacheTrustsUnchangedInputs)
+{
+    const std::string input = createTestFile("input.txt", "v1");
+    auto mockRunner = std::make_shared<mimir::MockCommandRunner>();
+
+    mimir::DAG dag;
+    mimir::Target target("stat_target");
+    target.setCommand("compile");
+    target.addInput(input);
+    dag.addTarget(target);
+
+    mimir::Cache cache(cacheDir_);
+    mimir::Executor executor(1, mockRunner);
+    ASSERT_TRUE(executor.execute(dag, cache));
+    EXPECT_EQ(mockRunner->getCommandCount(), 1);
+
+    // Pretend the recorded hash is old enough to be trusted, but stale: the
+    // stat fast path must use it, paranoid mode must not
+    auto record = cache.findFileRecord(input);
+    ASSERT_TRUE(record.has_value());
+    record->hashedAtNs = record->stamp.mtimeNs + 10'000'000'000LL;
+    record->hash = "stale";
+    cache.setFileRecord(input, *record);
+
+    ASSERT_TRUE(executor.execute(dag, cache));
+    EXPECT_EQ(mockRunner->getCommandCount(), 2);
+    ASSERT_TRUE(executor.execute(dag, cache));
+    EXPECT_EQ(mockRunner->getCommandCount(), 2);
+
+    mimir::ExecutorConfig config;
+    config.paranoid = true;
+    executor.setConfig(config);
+    ASSERT_TRUE(executor.execute(dag, cache));
+    EXPECT_EQ(mockRunner->getCommandCount(), 3);
+}
+
+TEST_F(ExecutorTest, SharedInputHashedOncePerBuild)
+{
+    const std::string header = createTestFile("common.h", "shared");
+    auto mockRunner = std::make_shared<mimir::MockCommandRunner>();
+
+    mimir::DAG dag;
+    for (int i = 0; i < 20; ++i)
+    {
+        mimir::Target target("t" + std::to_string(i));
+        target.setCommand("compile " + std::to_string(i));
+        target.addInput(header);
+        dag.addTarget(target);
+    }
+
+    mimir::ExecutorConfig config;
+    config.numThreads = 4;
+    config.paranoid = true;
+    mimir::Executor executor(4, mockRunner);
+    executor.setConfig(config);
+
+    mimir::Cache cache(cacheDir_);
+    ASSERT_TRUE(executor.execute(dag, cache));
+    EXPECT_EQ(mockRunner->getCommandCount(), 20);
+
+    const std::string expected = mimir::Signature::computeTargetSignature("compile 0", {header});
+    EXPECT_EQ(cache.getSignature("t0"), expected);
+}
+
+TEST_F(ExecutorTest, ParallelOutputIsPrintedPerTarget)
+{
+    auto mockRunner = std::make_shared<mimir::MockCommandRunner>();
+    mockRunner->setHandler([](const std::string& command, const mimir::CommandOptions& options)
+    {
+        EXPECT_TRUE(options.captureOutput);
+        std::string out;
+        for (int line = 0; line < 50; ++line)
+        {
+            out += command + " line\n";
+        }
+        return mimir::CommandResult{0, out, command + " warning\n", false};
+    });
+
+    mimir::DAG dag;
+    for (int i = 0; i < 8; ++i)
+    {
+        mimir::Target target("t" + std::to_string(i));
+        target.setCommand("gen" + std::to_string(i));
+        dag.addTarget(target);
+    }
+
+    mimir::ExecutorConfig config;
+    config.numThreads = 4;
+    config.colorOutput = false;
+    mimir::Executor executor(4, mockRunner);
+    executor.setConfig(config);
+    mimir::Cache cache(cacheDir_);
+
+    testing::internal::CaptureStdout();
+    ASSERT_TRUE(executor.execute(dag, cache));
+    const std::string printed = testing::internal::GetCapturedStdout();
+
+    for (int i = 0; i < 8; ++i)
+    {
+        const std::string name = "gen" + std::to_string(i);
+        std::string block = "[ SUCCESS ] t" + std::to_string(i) + "\n";
+        for (int line = 0; line < 50; ++line)
+        {
+            block += name + " line\n";
+        }
+        block += name + " warning\n";
+        EXPECT_NE(printed.find(block), std::string::npos) << "output of " << name << " was split";
+    }
+}
+
+TEST_F(ExecutorTest, StreamOutputDisablesCapture)
+{
+    auto mockRunner = std::make_shared<mimir::MockCommandRunner>();
+    bool captured = true;
+    mockRunner->setHandler([&captured](const std::string&, const mimir::CommandOptions& options)
+    {
+        captured = options.captureOutput;
+        return mimir::CommandResult{0, "", "", false};
+    });
+
+    mimir::DAG dag;
+    mimir::Target target("t");
+    target.setCommand("cmd");
+    dag.addTarget(target);
+
+    mimir::ExecutorConfig config;
+    config.bufferOutput = false;
+    mimir::Executor executor(1, mockRunner);
+    executor.setConfig(config);
+    mimir::Cache cache(cacheDir_);
+    ASSERT_TRUE(executor.execute(dag, cache));
+    EXPECT_FALSE(captured);
+}
+
+TEST_F(ExecutorTest, TimedOutTargetFailsAndFreesItsSlot)
+{
+    mimir::DAG dag;
+    mimir::Target hung("hung");
+    hung.setCommand("sleep 30");
+    dag.addTarget(hung);
+    for (int i = 0; i < 4; ++i)
+    {
+        mimir::Target quick("quick" + std::to_string(i));
+        quick.setCommand("true");
+        dag.addTarget(quick);
+    }
+
+    mimir::ExecutorConfig config;
+    config.numThreads = 2;
+    config.stopOnError = false;
+    config.colorOutput = false;
+    config.timeoutSeconds = 1;
+    mimir::Executor executor(config);
+    mimir::Cache cache(cacheDir_);
+    mimir::BuildStats stats;
+
+    testing::internal::CaptureStdout();
+    const auto start = std::chrono::steady_clock::now();
+    EXPECT_FALSE(executor.executeWithStats(dag, cache, stats));
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    const std::string printed = testing::internal::GetCapturedStdout();
+
+    EXPECT_LT(elapsed, std::chrono::seconds(10));
+    EXPECT_EQ(stats.failedTargets, 1u);
+    EXPECT_EQ(stats.builtTargets, 4u);
+    EXPECT_NE(printed.find("timed out after 1s"), std::string::npos);
+}
+
+TEST_F(ExecutorTest, BuiltTargetsRecordTheirDuration)
+{
+    auto mockRunner = std::make_shared<mimir::MockCommandRunner>();
+    mockRunner->setHandler([](const std::string&, const mimir::CommandOptions&)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        return mimir::CommandResult{0, "", "", false};
+    });
+
+    mimir::Executor executor(1, mockRunner);
+    mimir::DAG dag;
+    mimir::Target target("timed");
+    target.setCommand("work");
+    dag.addTarget(target);
+    mimir::Cache cache(cacheDir_);
+
+    EXPECT_TRUE(executor.execute(dag, cache));
+    const auto duration = cache.findDuration("timed");
+    ASSERT_TRUE(duration.has_value());
+    EXPECT_GE(*duration, 20000u);
+}
+
+TEST_F(ExecutorTest, SchedulersStartTheCriticalPathFirst)
+{
+    for (const auto scheduler : {mimir::SchedulerType::SharedQueue, mimir::SchedulerType::WorkStealing})
+    {
+        auto mockRunner = std::make_shared<mimir::MockCommandRunner>();
+        std::mutex orderMutex;
+        std::vector<std::string> executed;
+        mockRunner->setHandler([&](const std::string& command, const mimir::CommandOptions&)
+        {
+            {
+                std::lock_guard<std::mutex> lock(orderMutex);
+                executed.push_back(command);
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            return mimir::CommandResult{0, "", "", false};
+        });
+
+        // Quick independent targets are declared first; without a priority they
+        // would all start before the slow chain declared after them
+        mimir::DAG dag;
+        mimir::Cache cache(cacheDir_ + std::to_string(static_cast<int>(scheduler)));
+        for (int i = 0; i < 6; ++i)
+        {
+            mimir::Target quick("quick" + std::to_string(i));
+            quick.setCommand(quick.getName());
+            dag.addTarget(quick);
+            cache.setDuration(quick.getName(), 1000);
+        }
+        mimir::Target head("slow_head");
+        head.setCommand("slow_head");
+        dag.addTarget(head);
+        mimir::Target tail("slow_tail");
+        tail.setCommand("slow_tail");
+        tail.addDependency("slow_head");
+        dag.addTarget(tail);
+        cache.setDuration("slow_head", 2000000);
+        cache.setDuration("slow_tail", 2000000);
+
+        mimir::ExecutorConfig config;
+        config.numThreads = 2;
+        config.scheduler = scheduler;
+        config.colorOutput = false;
+        mimir::Executor executor(2, mockRunner);
+        executor.setConfig(config);
+
+        testing::internal::CaptureStdout();
+        EXPECT_TRUE(executor.execute(dag, cache));
+        testing::internal::GetCapturedStdout();
+
+        ASSERT_EQ(executed.size(), 8u);
+        const auto headPosition = std::find(executed.begin(), executed.end(), "slow_head") - executed.begin();
+        EXPECT_LT(headPosition, 2);
+    }
+}
+
+TEST_F(ExecutorTest, PoolCapsConcurrentTargets)
+{
+    for (const auto scheduler : {mimir::SchedulerType::SharedQueue, mimir::SchedulerType::WorkStealing})
+    {
+        auto mockRunner = std::make_shared<mimir::MockCommandRunner>();
+        std::atomic<int> running{0};
+        std::atomic<int> peakLinks{0};
+        std::atomic<int> linksRunning{0};
+        std::atomic<int> peakTotal{0};
+        mockRunner->setHandler([&](const std::string& command, const mimir::CommandOptions&)
+        {
+            const bool isLink = command.rfind("link", 0) == 0;
+            const int total = ++running;
+            int links = isLink ? ++linksRunning : linksRunning.load();
+            int seen = peakLinks.load();
+            while (links > seen && !peakLinks.compare_exchange_weak(seen, links))
+            {
+            }
+            seen = peakTotal.load();
+            while (total > seen && !peakTotal.compare_exchange_weak(seen, total))
+            {
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            if (isLink)
+            {
+                --linksRunning;
+            }
+            --running;
+            return mimir::CommandResult{0, "", "", false};
+        });
+
+        // Links take 2 of the pool's 2 units, so they run one at a time while
+        // compiles use the remaining workers
+        mimir::DAG dag;
+        for (int i = 0; i < 6; ++i)
+        {
+            mimir::Target link("link" + std::to_string(i));
+            link.setCommand(link.getName());
+            link.setPool("link");
+            link.setWeight(2);
+            dag.addTarget(link);
+            mimir::Target compile("compile" + std::to_string(i));
+            compile.setCommand(compile.getName());
+            dag.addTarget(compile);
+        }
+
+        mimir::ExecutorConfig config;
+        config.numThreads = 4;
+        config.scheduler = scheduler;
+        config.colorOutput = false;
+        config.pools["link"] = 2;
+        mimir::Executor executor(4, mockRunner);
+        executor.setConfig(config);
+        mimir::Cache cache(cacheDir_ + std::to_string(static_cast<int>(scheduler)));
+
+        mimir::BuildStats stats;
+        testing::internal::CaptureStdout();
+        EXPECT_TRUE(executor.executeWithStats(dag, cache, stats));
+        testing::internal::GetCapturedStdout();
+
+        EXPECT_EQ(stats.builtTargets, 12u);
+        EXPECT_EQ(peakLinks.load(), 1);
+        EXPECT_LE(peakTotal.load(), 4);
+    }
+}
+
+TEST_F(ExecutorTest, RemoteJobsRunBeyondTheLocalSlots)
+{
+    for (const auto scheduler : {mimir::SchedulerType::SharedQueue, mimir::SchedulerType::WorkStealing})
+    {
+        auto mockRunner = std::make_shared<mimir::MockCommandRunner>();
+        std::mutex mutex;
+        int localRunning = 0;
+        int remoteRunning = 0;
+        int peakLocal = 0;
+        int peakRemote = 0;
+        std::vector<std::string> shippedInputs;
+        mockRunner->setHandler([&](const std::string& command, const mimir::CommandOptions& options)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                int& running = options.hermetic ? remoteRunning : localRunning;
+                int& peak = options.hermetic ? peakRemote : peakLocal;
+                peak = std::max(peak, ++running);
+                if (command == "remote0")
+                {
+                    shippedInputs = options.inputs;
+                    EXPECT_EQ(options.outputs, std::vector<std::string>{"remote0.o"});
+                }
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            std::lock_guard<std::mutex> lock(mutex);
+            --(options.hermetic ? remoteRunning : localRunning);
+            return mimir::CommandResult{0, "", "", false};
+        });
+
+        mimir::DAG dag;
+        for (int i = 0; i < 4; ++i)
+        {
+            mimir::Target local("local" + std::to_string(i));
+            local.setCommand(local.getName());
+            dag.addTarget(local);
+            mimir::Target remote("remote" + std::to_string(i));
+            remote.setCommand(remote.getName());
+            remote.addInput(createTestFile(remote.getName() + ".c", "int x;"));
+            remote.addOutput(remote.getName() + ".o");
+            remote.setRemote(true);
+            dag.addTarget(remote);
+        }
+
+        mimir::ExecutorConfig config;
+        config.numThreads = 1;
+        config.remoteJobs = 4;
+        config.scheduler = scheduler;
+        config.colorOutput = false;
+        mimir::Executor executor(1, mockRunner);
+        executor.setConfig(config);
+        mimir::Cache cache(cacheDir_ + std::to_string(static_cast<int>(scheduler)));
+
+        mimir::BuildStats stats;
+        testing::internal::CaptureStdout();
+        EXPECT_TRUE(executor.executeWithStats(dag, cache, stats));
+        testing::internal::GetCapturedStdout();
+
+        EXPECT_EQ(stats.builtTargets, 8u);
+        EXPECT_EQ(peakLocal, 1);
+        EXPECT_GT(peakRemote, 1);
+        EXPECT_EQ(shippedInputs, std::vector<std::string>{testDir_ + "/remote0.c"});
+    }
+}
+
+TEST_F(ExecutorTest, TargetHeavierThanItsPoolStillRuns)
+{
+    auto mockRunner = std::make_shared<mimir::MockCommandRunner>();
+    mimir::DAG dag;
+    mimir::Target heavy("heavy");
+    heavy.setCommand("heavy");
+    heavy.setPool("small");
+    heavy.setWeight(10);
+    dag.addTarget(heavy);
+
+    mimir::ExecutorConfig config;
+    config.numThreads = 2;
+    config.colorOutput = false;
+    config.pools["small"] = 1;
+    mimir::Executor executor(2, mockRunner);
+    executor.setConfig(config);
+    mimir::Cache cache(cacheDir_);
+
+    testing::internal::CaptureStdout();
+    EXPECT_TRUE(executor.execute(dag, cache));
+    testing::internal::GetCapturedStdout();
+}
+
+TEST_F(ExecutorTest, MemoryPressureLowersJobSlots)
+{
+    class PressuredProbe : public mimir::ILoadProbe
+    {
+    public:
+        mimir::LoadSample sample() override
+        {
+            mimir::LoadSample sample;
+            sample.memoryPressure = 80.0;
+            return sample;
+        }
+    };
+
+    for (const auto scheduler : {mimir::SchedulerType::SharedQueue, mimir::SchedulerType::WorkStealing})
+    {
+        auto mockRunner = std::make_shared<mimir::MockCommandRunner>();
+        std::atomic<int> running{0};
+        std::atomic<int> peak{0};
+        mockRunner->setHandler([&](const std::string&, const mimir::CommandOptions&)
+        {
+            const int now = ++running;
+            int seen = peak.load();
+            while (now > seen && !peak.compare_exchange_weak(seen, now))
+            {
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            --running;
+            return mimir::CommandResult{0, "", "", false};
+        });
+
+        mimir::DAG dag;
+        for (int i = 0; i < 12; ++i)
+        {
+            mimir::Target target("t" + std::to_string(i));
+            target.setCommand(target.getName());
+            dag.addTarget(target);
+        }
+
+        mimir::ExecutorConfig config;
+        config.numThreads = 4;
+        config.scheduler = scheduler;
+        config.colorOutput = false;
+        config.loadLimits.maxMemoryPressure = 10.0;
+        mimir::Executor executor(4, mockRunner);
+        executor.setConfig(config);
+        executor.setLoadProbe(std::make_shared<PressuredProbe>());
+        mimir::Cache cache(cacheDir_ + std::to_string(static_cast<int>(scheduler)));
+
+        mimir::BuildStats stats;
+        testing::internal::CaptureStdout();
+        EXPECT_TRUE(executor.executeWithStats(dag, cache, stats));
+        testing::internal::GetCapturedStdout();
+
+        EXPECT_EQ(stats.builtTargets, 12u);
+        EXPECT_LE(peak.load(), 2);
+        EXPECT_GE(stats.lowestJobSlots, 1u);
+        EXPECT_LE(stats.lowestJobSlots, 2u);
+    }
+}
+
+TEST_F(ExecutorTest, JobserverServesCommandsAndCapsThem)
+{
+    auto jobserver = std::shared_ptr<mimir::Jobserver>(mimir::Jobserver::create(2));
+    ASSERT_NE(jobserver, nullptr);
+
+    std::atomic<int> running{0};
+    std::atomic<int> peak{0};
+    std::mutex flagsMutex;
+    std::vector<std::string> makeflags;
+    auto mockRunner = std::make_shared<mimir::MockCommandRunner>();
+    mockRunner->setHandler([&](const std::string&, const mimir::CommandOptions& options)
+    {
+        {
+            std::lock_guard<std::mutex> lock(flagsMutex);
+            for (const auto& variable : options.environment)
+            {
+                if (variable.first == "MAKEFLAGS")
+                {
+                    makeflags.push_back(variable.second);
+                }
+            }
+        }
+        const int now = ++running;
+        int seen = peak.load();
+        while (now > seen && !peak.compare_exchange_weak(seen, now))
+        {
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        --running;
+        return mimir::CommandResult{0, "", "", false};
+    });
+
+    mimir::DAG dag;
+    for (int i = 0; i < 8; ++i)
+    {
+        mimir::Target target("t" + std::to_string(i));
+        target.setCommand(target.getName());
+        dag.addTarget(target);
+    }
+
+    mimir::ExecutorConfig config;
+    config.numThreads = 4;
+    config.colorOutput = false;
+    mimir::Executor executor(4, mockRunner);
+    executor.setConfig(config);
+    setenv("MAKEFLAGS", "k -- VERBOSE=1", 1);
+    executor.setJobserver(jobserver);
+    unsetenv("MAKEFLAGS");
+    mimir::Cache cache(cacheDir_);
+
+    testing::internal::CaptureStdout();
+    EXPECT_TRUE(executor.execute(dag, cache));
+    testing::internal::GetCapturedStdout();
+
+    EXPECT_LE(peak.load(), 2);
+    ASSERT_EQ(makeflags.size(), 8u);
+    // The caller's flags survive, with the jobserver ahead of its variable overrides
+    EXPECT_EQ(makeflags.front(), "k" + jobserver->makeflags() + " -- VERBOSE=1");
+    EXPECT_EQ(jobserver->heldTokens(), 0u);
+}
+
+TEST_F(ExecutorTest, GoalsBuildOnlyTheirClosure)
+{
+    std::mutex executedMutex;
+    std::vector<std::string> executed;
+    auto mockRunner = std::make_shared<mimir::MockCommandRunner>();
+    mockRunner->setHandler([&](const std::string& command, const mimir::CommandOptions&)
+    {
+        std::lock_guard<std::mutex> lock(executedMutex);
+        executed.push_back(command);
+        return mimir::CommandResult{0, "", "", false};
+    });
+
+    mimir::DAG dag;
+    mimir::Target base("base");
+    base.setCommand("base");
+    mimir::Target app("app");
+    app.setCommand("app");
+    app.addDependency("base");
+    mimir::Target other("other");
+    other.setCommand("other");
+    dag.addTarget(base);
+    dag.addTarget(app);
+    dag.addTarget(other);
+
+    for (const int threads : {1, 2})
+    {
+        executed.clear();
+        mimir::ExecutorConfig config;
+        config.numThreads = threads;
+        config.colorOutput = false;
+        mimir::Executor executor(threads, mockRunner);
+        executor.setConfig(config);
+        mimir::Cache cache(cacheDir_ + std::to_string(threads));
+        mimir::BuildStats stats;
+
+        testing::internal::CaptureStdout();
+        EXPECT_TRUE(executor.executeWithStats(dag, {"app"}, cache, stats));
+        EXPECT_FALSE(executor.executeWithStats(dag, {"app", "nope"}, cache, stats));
+        const std::string printed = testing::internal::GetCapturedStdout();
+
+        EXPECT_EQ(executed, (std::vector<std::string>{"base", "app"}));
+        EXPECT_EQ(stats.totalTargets, 2u);
+        EXPECT_NE(printed.find("[ FAILED ] nope"), std::string::npos);
+    }
+}
+
+TEST_F(ExecutorTest, UpToDateHintSkipsChecksAndSinkReceivesOutput)
+{
+    auto mockRunner = std::make_shared<mimir::MockCommandRunner>();
+    std::vector<std::string> executed;
+    mockRunner->setHandler([&executed](const std::string& command, const mimir::CommandOptions&)
+    {
+        executed.push_back(command);
+        return mimir::CommandResult{0, "out of " + command + "\n", "", false};
+    });
+
+    mimir::DAG dag;
+    for (const char* name : {"known", "unknown"})
+    {
+        mimir::Target target(name);
+        target.setCommand(name);
+        dag.addTarget(target);
+    }
+
+    mimir::ExecutorConfig config;
+    config.colorOutput = false;
+    mimir::Executor executor(1, mockRunner);
+    executor.setConfig(config);
+    executor.setUpToDateHint([](const mimir::Target& target) { return target.getName() == "known"; });
+    std::string sunk;
+    executor.setOutputSink([&sunk](const std::string& text) { sunk += text; });
+    mimir::Cache cache(cacheDir_);
+
+    testing::internal::CaptureStdout();
+    mimir::BuildStats stats;
+    EXPECT_TRUE(executor.executeWithStats(dag, cache, stats));
+    EXPECT_TRUE(testing::internal::GetCapturedStdout().empty());
+
+    EXPECT_EQ(executed, (std::vector<std::string>{"unknown"}));
+    EXPECT_EQ(stats.skippedTargets, 1u);
+    EXPECT_NE(sunk.find("[ UP-TO-DATE ] known\n"), std::string::npos);
+    EXPECT_NE(sunk.find("[ SUCCESS ] unknown\nout of unknown\n"), std::string::npos);
+}
+
+TEST_F(ExecutorTest, DepfileHeadersJoinTheSignature)
+{
+    const std::string source = createTestFile("main.c", "int main() {}\n");
+    const std::string header = createTestFile("config.h", "#define A 1\n");
+    const std::string depfile = testDir_ + "/main.d";
+    const std::string object = testDir_ + "/main.o";
+    auto mockRunner = std::make_shared<mimir::MockCommandRunner>();
+    mockRunner->setHandler([&](const std::string&, const mimir::CommandOptions&)
+    {
+        std::ofstream(depfile) << object << ": " << source << " \\\n  " << header << "\n";
+        std::ofstream(object) << "obj";
+        return mimir::CommandResult{0, "", "", false};
+    });
+
+    mimir::DAG dag;
+    mimir::Target target("main");
+    target.setCommand("cc -MD -MF main.d -c main.c");
+    target.addInput(source);
+    target.addOutput(object);
+    target.setDepfile(depfile);
+    target.setDepsFormat(mimir::DepsFormat::GCC);
+    dag.addTarget(target);
+
+    auto depsLog = std::make_shared<mimir::DepsLog>(cacheDir_ + "/deps.bin");
+    ASSERT_TRUE(depsLog->open());
+    mimir::Cache cache(cacheDir_);
+    auto build = [&]()
+    {
+        mimir::Executor executor(1, mockRunner);
+        executor.setDepsLog(depsLog);
+        mimir::BuildStats stats;
+        EXPECT_TRUE(executor.executeWithStats(dag, cache, stats));
+        return stats.builtTargets;
+    };
+
+    EXPECT_EQ(build(), 1u);
+    EXPECT_FALSE(fs::exists(depfile));
+    ASSERT_NE(depsLog->getDeps("main"), nullptr);
+    EXPECT_EQ(*depsLog->getDeps("main"), (std::vector<std::string>{source, header}));
+    EXPECT_EQ(build(), 0u);
+
+    std::ofstream(header) << "#define A 2 /* changed */\n";
+    EXPECT_EQ(build(), 1u);
+    EXPECT_EQ(mockRunner->getCommandCount(), 2u);
+}
+
+TEST_F(ExecutorTest, MissingDepfileFailsTheTarget)
+{
+    auto mockRunner = std::make_shared<mimir::MockCommandRunner>();
+    mimir::DAG dag;
+    mimir::Target target("main");
+    target.setCommand("cc -c main.c");
+    target.setDepfile(testDir_ + "/never.d");
+    target.setDepsFormat(mimir::DepsFormat::GCC);
+    dag.addTarget(target);
+
+    mimir::ExecutorConfig config;
+    config.colorOutput = false;
+    mimir::Executor executor(1, mockRunner);
+    executor.setConfig(config);
+    executor.setDepsLog(std::make_shared<mimir::DepsLog>(cacheDir_ + "/deps.bin"));
+    std::string sunk;
+    executor.setOutputSink([&sunk](const std::string& text) { sunk += text; });
+    mimir::Cache cache(cacheDir_);
+
+    EXPECT_FALSE(executor.execute(dag, cache));
+    EXPECT_NE(sunk.find("depfile '" + testDir_ + "/never.d' was not written"), std::string::npos);
+}
+
+TEST_F(ExecutorTest, ShowIncludesAreRecordedAndFilteredFromOutput)
+{
+    const std::string header = createTestFile("stdafx.h", "#pragma once\n");
+    auto mockRunner = std::make_shared<mimir::MockCommandRunner>();
+    mockRunner->setHandler([&](const std::string&, const mimir::CommandOptions& options)
+    {
+        EXPECT_TRUE(options.captureOutput);
+        EXPECT_EQ(options.maxCaptureBytes, std::numeric_limits<size_t>::max());
+        return mimir::CommandResult{0, "main.cpp\nNote: including file: " + header + "\nwarning C4100\n", "", false};
+    });
+
+    mimir::DAG dag;
+    mimir::Target target("main");
+    target.setCommand("cl /showIncludes /c main.cpp");
+    target.setDepsFormat(mimir::DepsFormat::MSVC);
+    dag.addTarget(target);
+
+    mimir::ExecutorConfig config;
+    config.colorOutput = false;
+    config.bufferOutput = false;
+    mimir::Executor executor(1, mockRunner);
+    executor.setConfig(config);
+    auto depsLog = std::make_shared<mimir::DepsLog>(cacheDir_ + "/deps.bin");
+    executor.setDepsLog(depsLog);
+    std::string sunk;
+    executor.setOutputSink([&sunk](const std::string& text) { sunk += text; });
+    mimir::Cache cache(cacheDir_);
+
+    EXPECT_TRUE(executor.execute(dag, cache));
+    ASSERT_NE(depsLog->getDeps("main"), nullptr);
+    EXPECT_EQ(*depsLog->getDeps("main"), (std::vector<std::string>{header}));
+    EXPECT_NE(sunk.find("main.cpp\nwarning C4100\n"), std::string::npos);
+    EXPECT_EQ(sunk.find("Note: including file"), std::string::npos);
+}
+
+TEST_F(ExecutorTest, ShowIncludesWithDiscardedOutputFail)
+{
+    auto mockRunner = std::make_shared<mimir::MockCommandRunner>();
+    mockRunner->setHandler([](const std::string&, const mimir::CommandOptions&)
+    {
+        mimir::CommandResult result{0, "Note: including file: late.h\n", "", false};
+        result.droppedBytes = 4096;
+        return result;
+    });
+
+    mimir::DAG dag;
+    mimir::Target target("main");
+    target.setCommand("cl /showIncludes /c main.cpp");
+    target.setDepsFormat(mimir::DepsFormat::MSVC);
+    dag.addTarget(target);
+
+    mimir::ExecutorConfig config;
+    config.colorOutput = false;
+    mimir::Executor executor(1, mockRunner);
+    executor.setConfig(config);
+    auto depsLog = std::make_shared<mimir::DepsLog>(cacheDir_ + "/deps.bin");
+    executor.setDepsLog(depsLog);
+    std::string sunk;
+    executor.setOutputSink([&sunk](const std::string& text) { sunk += text; });
+    mimir::Cache cache(cacheDir_);
+
+    EXPECT_FALSE(executor.execute(dag, cache));
+    EXPECT_EQ(depsLog->getDeps("main"), nullptr);
+    EXPECT_FALSE(cache.findSignature("main").has_value());
+    EXPECT_NE(sunk.find("reported headers are incomplete"), std::string::npos);
+}
+
+TEST_F(ExecutorTest, RestatCutsOffDependentsWhenOutputsAreUnchanged)
+{
+    const std::string proto = createTestFile("api.proto", "message A {}\n");
+    const std::string header = testDir_ + "/api.pb.h";
+    std::string generated = "struct A {};\n";
+    auto mockRunner = std::make_shared<mimir::MockCommandRunner>();
+    mockRunner->setHandler([&](const std::string& command, const mimir::CommandOptions&)
+    {
+        if (command == "protoc api.proto")
+        {
+            std::ofstream(header) << generated;
+        }
+        return mimir::CommandResult{0, "", "", false};
+    });
+
+    mimir::DAG dag;
+    mimir::Target codegen("codegen");
+    codegen.setCommand("protoc api.proto");
+    codegen.addInput(proto);
+    codegen.addOutput(header);
+    codegen.setRestat(true);
+    mimir::Target compile("compile");
+    compile.setCommand("cc -c api.cc");
+    compile.addDependency("codegen");
+    dag.addTarget(codegen);
+    dag.addTarget(compile);
+
+    mimir::Cache cache(cacheDir_);
+    auto build = [&]()
+    {
+        mimir::Executor executor(1, mockRunner);
+        mimir::BuildStats stats;
+        EXPECT_TRUE(executor.executeWithStats(dag, cache, stats));
+        return stats.builtTargets;
+    };
+
+    EXPECT_EQ(build(), 2u);
+    ASSERT_TRUE(cache.findOutputSignature("codegen").has_value());
+
+    // Regenerated byte for byte: only the generator runs
+    std::ofstream(proto) << "message A {} // comment\n";
+    EXPECT_EQ(build(), 1u);
+    EXPECT_EQ(build(), 0u);
+
+    generated = "struct A { int x; };\n";
+    std::ofstream(proto) << "message A { int32 x = 1; }\n";
+    EXPECT_EQ(build(), 2u);
+    EXPECT_EQ(mockRunner->getCommandCount(), 5u);
+}
+
+TEST_F(ExecutorTest, DependentsRebuildWhenADependencyRebuilds)
+{
+    const std::string proto = createTestFile("api.proto", "message A {}\n");
+    const std::string header = testDir_ + "/api.pb.h";
+    auto mockRunner = std::make_shared<mimir::MockCommandRunner>();
+    mockRunner->setHandler([&](const std::string& command, const mimir::CommandOptions&)
+    {
+        if (command == "protoc api.proto")
+        {
+            std::ofstream(header) << "struct A {};\n";
+        }
+        return mimir::CommandResult{0, "", "", false};
+    });
+
+    mimir::DAG dag;
+    mimir::Target codegen("codegen");
+    codegen.setCommand("protoc api.proto");
+    codegen.addInput(proto);
+    codegen.addOutput(header);
+    mimir::Target compile("compile");
+    compile.setCommand("cc -c api.cc");
+    compile.addDependency("codegen");
+    dag.addTarget(codegen);
+    dag.addTarget(compile);
+
+    mimir::Cache cache(cacheDir_);
+    auto build = [&]()
+    {
+        mimir::Executor executor(1, mockRunner);
+        mimir::BuildStats stats;
+        EXPECT_TRUE(executor.executeWithStats(dag, cache, stats));
+        return stats.builtTargets;
+    };
+
+    EXPECT_EQ(build(), 2u);
+    EXPECT_EQ(build(), 0u);
+
+    // Without restat the dependent follows the generator's signature
+    std::ofstream(proto) << "message A {} // comment\n";
+    EXPECT_EQ(build(), 2u);
+    EXPECT_FALSE(cache.findOutputSignature("codegen").has_value());
+}
+
+TEST_F(ExecutorTest, TraceRecordsEveryTargetWithTimings)
+{
+    auto mockRunner = std::make_shared<mimir::MockCommandRunner>();
+    mockRunner->setHandler([](const std::string&, const mimir::CommandOptions&)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        mimir::CommandResult result{0, "", "", false};
+        result.usage.userSeconds = 0.5;
+        result.usage.maxRssKb = 1024;
+        result.spawnSeconds = 0.001;
+        return result;
+    });
+
+    mimir::DAG dag;
+    for (const std::string name : {"a", "b", "c"})
+    {
+        mimir::Target target(name);
+        target.setCommand("build " + name);
+        dag.addTarget(target);
+    }
+    mimir::Target link("link");
+    link.setCommand("link");
+    link.setDependencies({"a", "b", "c"});
+    dag.addTarget(link);
+
+    for (const auto scheduler : {mimir::SchedulerType::SharedQueue, mimir::SchedulerType::WorkStealing})
+    {
+        fs::remove_all(cacheDir_);
+        mimir::ExecutorConfig config;
+        config.numThreads = 2;
+        config.scheduler = scheduler;
+        config.colorOutput = false;
+        mimir::Executor executor(2, mockRunner);
+        executor.setConfig(config);
+        auto trace = std::make_shared<mimir::BuildTrace>();
+        executor.setBuildTrace(trace);
+        mimir::Cache cache(cacheDir_);
+        ASSERT_TRUE(executor.execute(dag, cache));
+
+        const auto events = trace->events();
+        ASSERT_EQ(events.size(), 4u);
+        std::int64_t lastDependencyEnd = 0;
+        for (const auto& event : events)
+        {
+            EXPECT_EQ(event.status, "SUCCESS");
+            EXPECT_LT(event.worker, 2u);
+            EXPECT_LE(event.startUs, event.commandStartUs);
+            EXPECT_LE(event.commandStartUs + event.commandUs, event.endUs);
+            EXPECT_GE(event.commandUs, 2000);
+            EXPECT_EQ(event.spawnUs, 1000);
+            EXPECT_EQ(event.usage.maxRssKb, 1024);
+            if (event.name != "link")
+            {
+                EXPECT_EQ(event.readyUs, 0);
+                lastDependencyEnd = std::max(lastDependencyEnd, event.endUs);
+            }
+        }
+        EXPECT_EQ(events.back().name, "link");
+        EXPECT_EQ(events.back().readyUs, lastDependencyEnd);
+        EXPECT_GE(events.back().queueUs(), 0);
+
+        // A second build restarts the trace and records the skipped targets
+        ASSERT_TRUE(executor.execute(dag, cache));
+        const auto rebuilt = trace->events();
+        ASSERT_EQ(rebuilt.size(), 4u);
+        EXPECT_EQ(rebuilt[0].status, "UP-TO-DATE");
+        EXPECT_EQ(rebuilt[0].commandStartUs, -1);
+    }
+}
@@ -0,0 +1,124 @@
+#include "mimir/file_watcher.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+class FileWatcherTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        testDir_ = "/tmp/test_file_watcher_" + std::to_string(::testing::UnitTest::GetInstance()->random_seed());
+        fs::create_directories(testDir_);
+        if (!watcher_.available())
+        {
+            GTEST_SKIP() << "no file change notification on this platform";
+        }
+    }
+
+    void TearDown() override
+    {
+        fs::remove_all(testDir_);
+    }
+
+    std::string path(const std::string& name) const
+    {
+        return testDir_ + "/" + name;
+    }
+
+    static bool contains(const std::vector<std::string>& changed, const std::string& file)
+    {
+        return std::find(changed.begin(), changed.end(), mimir::FileWatcher::normalize(file)) != changed.end();
+    }
+
+    std::string testDir_;
+    mimir::FileWatcher watcher_;
+};
+
+TEST_F(FileWatcherTest, ReportsOnlyWatchedFiles)
+{
+    std::ofstream(path("watched")) << "1";
+    std::ofstream(path("other")) << "1";
+    ASSERT_TRUE(watcher_.watch(path("watched")));
+
+    std::ofstream(path("watched")) << "2";
+    std::ofstream(path("other")) << "2";
+    const auto changed = watcher_.poll(1000);
+    EXPECT_TRUE(contains(changed, path("watched")));
+    EXPECT_FALSE(contains(changed, path("other")));
+    EXPECT_EQ(std::count(changed.begin(), changed.end(), mimir::FileWatcher::normalize(path("watched"))), 1);
+    EXPECT_TRUE(watcher_.poll().empty());
+}
+
+TEST_F(FileWatcherTest, SeesRenamesCreationAndDeletion)
+{
+    std::ofstream(path("input")) << "1";
+    ASSERT_TRUE(watcher_.watch(path("input")));
+    ASSERT_TRUE(watcher_.watch(path("later")));
+
+    // Editors save by writing a temporary file and renaming it into place
+    std::ofstream(path("input.tmp")) << "2";
+    fs::rename(path("input.tmp"), path("input"));
+    EXPECT_TRUE(contains(watcher_.poll(1000), path("input")));
+
+    std::ofstream(path("later")) << "new";
+    EXPECT_TRUE(contains(watcher_.poll(1000), path("later")));
+
+    fs::remove(path("input"));
+    EXPECT_TRUE(contains(watcher_.poll(1000), path("input")));
+}
+
+TEST_F(FileWatcherTest, RemovedDirectoryReportsOverflow)
+{
+    fs::create_directories(path("sub"));
+    ASSERT_TRUE(watcher_.watch(path("sub/file")));
+    EXPECT_FALSE(watcher_.watch(path("missing/file")));
+
+    fs::remove_all(path("sub"));
+    watcher_.poll(1000);
+    EXPECT_TRUE(watcher_.takeOverflow());
+    EXPECT_FALSE(watcher_.takeOverflow());
+}
+
+TEST_F(FileWatcherTest, ClearStopsReporting)
+{
+    std::ofstream(path("input")) << "1";
+    ASSERT_TRUE(watcher_.watch(path("input")));
+    watcher_.clear();
+    std::ofstream(path("input")) << "2";
+    EXPECT_TRUE(watcher_.poll(50).empty());
+    EXPECT_FALSE(watcher_.takeOverflow());
+}
+
+TEST_F(FileWatcherTest, WatchedDirectoriesReportEntriesComingAndGoing)
+{
+    fs::create_directories(path("dir"));
+    std::ofstream(path("dir/existing")) << "1";
+    ASSERT_TRUE(watcher_.watchDirectory(path("dir/.")));
+
+    // Writes to existing entries are not listing changes
+    std::ofstream(path("dir/existing")) << "2";
+    EXPECT_TRUE(watcher_.poll(50).empty());
+
+    std::ofstream(path("dir/new")) << "1";
+    auto changed = watcher_.poll(1000);
+    EXPECT_TRUE(contains(changed, path("dir")));
+    EXPECT_EQ(std::count(changed.begin(), changed.end(), mimir::FileWatcher::normalize(path("dir"))), 1);
+
+    fs::rename(path("dir/new"), path("moved"));
+    EXPECT_TRUE(contains(watcher_.poll(1000), path("dir")));
+    fs::remove(path("dir/existing"));
+    EXPECT_TRUE(contains(watcher_.poll(1000), path("dir")));
+}
+
+TEST(FileWatcherNormalizeTest, MakesPathsAbsoluteAndNormal)
+{
+    const std::string cwd = fs::current_path().string();
+    EXPECT_EQ(mimir::FileWatcher::normalize("a/../b/./c"), (fs::path(cwd) / "b/c").string());
+    EXPECT_EQ(mimir::FileWatcher::normalize("/x//y/../z"), "/x/z");
+    EXPECT_EQ(mimir::FileWatcher::normalize("/x/y/."), "/x/y");
+    EXPECT_EQ(mimir::FileWatcher::normalize("/"), "/");
+}
@@ -0,0 +1,160 @@
+#include "mimir/glob.h"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+class GlobTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        testDir_ = "/tmp/test_glob_" + std::to_string(::testing::UnitTest::GetInstance()->random_seed());
+        fs::create_directories(testDir_);
+        for (const char* file : {"src/a.c", "src/b.h", "src/.hidden.c", "src/sub/c.c", "src/sub/deep/d.c", "src/sub/deep/e.h"})
+        {
+            createTestFile(file);
+        }
+    }
+
+    void TearDown() override
+    {
+        fs::remove_all(testDir_);
+    }
+
+    void createTestFile(const std::string& name)
+    {
+        const fs::path path = fs::path(testDir_) / name;
+        fs::create_directories(path.parent_path());
+        std::ofstream(path) << name;
+    }
+
+    std::vector<std::string> paths(std::initializer_list<const char*> names) const
+    {
+        std::vector<std::string> result;
+        for (const char* name : names)
+        {
+            result.push_back(testDir_ + "/" + name);
+        }
+        return result;
+    }
+
+    /// Backdate a directory so its stamp is outside TIMESTAMP_SLACK_NS
+    void age(const std::string& name)
+    {
+        fs::last_write_time(testDir_ + "/" + name, fs::file_time_type::clock::now() - std::chrono::seconds(10));
+    }
+
+    std::string testDir_;
+};
+
+TEST(GlobPatternTest, MatchesSegments)
+{
+    using mimir::GlobPattern;
+    EXPECT_TRUE(GlobPattern::matchSegment("*.c", "main.c"));
+    EXPECT_FALSE(GlobPattern::matchSegment("*.c", ".c"));
+    EXPECT_FALSE(GlobPattern::matchSegment("?git", ".git"));
+    EXPECT_FALSE(GlobPattern::matchSegment("[.]git", ".git"));
+    EXPECT_TRUE(GlobPattern::matchSegment(".*", ".git"));
+    EXPECT_FALSE(GlobPattern::matchSegment("*.c", "main.cc"));
+    EXPECT_TRUE(GlobPattern::matchSegment("a*b*c", "abbbc"));
+    EXPECT_FALSE(GlobPattern::matchSegment("a*b*c", "abcb"));
+    EXPECT_TRUE(GlobPattern::matchSegment("?.h", "x.h"));
+    EXPECT_FALSE(GlobPattern::matchSegment("?.h", "xy.h"));
+    EXPECT_TRUE(GlobPattern::matchSegment("[a-c]x", "bx"));
+    EXPECT_FALSE(GlobPattern::matchSegment("[a-c]x", "dx"));
+    EXPECT_TRUE(GlobPattern::matchSegment("[!a-c]x", "dx"));
+    EXPECT_TRUE(GlobPattern::matchSegment("[]]", "]"));
+    EXPECT_TRUE(GlobPattern::matchSegment("[*]", "*"));
+    EXPECT_FALSE(GlobPattern::matchSegment("[*]", "a"));
+    EXPECT_TRUE(GlobPattern::matchSegment("[ab", "[ab"));
+    EXPECT_TRUE(GlobPattern::matchSegment("**", "anything"));
+}
+
+TEST(GlobPatternTest, SplitsLiteralBaseFromWildcardSegments)
+{
+    const mimir::GlobPattern pattern("src/lib/*/include/**/*.h");
+    EXPECT_FALSE(pattern.isLiteral());
+    EXPECT_TRUE(pattern.isRecursive());
+    EXPECT_EQ(pattern.base(), "src/lib/");
+    ASSERT_EQ(pattern.segments().size(), 4);
+    EXPECT_FALSE(pattern.segments()[0].literal);
+    EXPECT_TRUE(pattern.segments()[1].literal);
+    EXPECT_TRUE(pattern.segments()[2].recursive);
+
+    EXPECT_EQ(mimir::GlobPattern("*.c").base(), "");
+    EXPECT_EQ(mimir::GlobPattern("/usr/include/*.h").base(), "/usr/include/");
+    EXPECT_TRUE(mimir::GlobPattern("src/main.c").isLiteral());
+}
+
+TEST_F(GlobTest, ExpandsPatternsInSortedOrder)
+{
+    mimir::GlobEngine engine(1);
+    EXPECT_EQ(engine.expand(testDir_ + "/src/*.c"), paths({"src/a.c"}));
+    EXPECT_EQ(engine.expand(testDir_ + "/src/.*.c"), paths({"src/.hidden.c"}));
+    EXPECT_EQ(engine.expand(testDir_ + "/src/[ab].?"), paths({"src/a.c", "src/b.h"}));
+    EXPECT_EQ(engine.expand(testDir_ + "/src/*/*.c"), paths({"src/sub/c.c"}));
+    EXPECT_EQ(engine.expand(testDir_ + "/src/**/*.c"),
+        paths({"src/a.c", "src/sub/c.c", "src/sub/deep/d.c"}));
+    EXPECT_EQ(engine.expand(testDir_ + "/src/**/deep/*.h"), paths({"src/sub/deep/e.h"}));
+    EXPECT_EQ(engine.expand(testDir_ + "/src/sub/**"), paths({"src/sub/c.c", "src/sub/deep/d.c", "src/sub/deep/e.h"}));
+    EXPECT_EQ(engine.expand(testDir_ + "/src/a.c"), paths({"src/a.c"}));
+    EXPECT_TRUE(engine.expand(testDir_ + "/src/missing.c").empty());
+    EXPECT_TRUE(engine.expand(testDir_ + "/nowhere/*.c").empty());
+}
+
+TEST_F(GlobTest, RecursiveWildcardsSkipHiddenDirectories)
+{
+    createTestFile("src/.git/objects/x.c");
+    createTestFile("src/sub/.mimir/y.c");
+    mimir::GlobEngine engine(4);
+    EXPECT_EQ(engine.expand(testDir_ + "/src/**/*.c"), paths({"src/a.c", "src/sub/c.c", "src/sub/deep/d.c"}));
+    EXPECT_EQ(engine.expand(testDir_ + "/src/sub/**"), paths({"src/sub/c.c", "src/sub/deep/d.c", "src/sub/deep/e.h"}));
+    // Naming the hidden directory explicitly still reaches it
+    EXPECT_EQ(engine.expand(testDir_ + "/src/.git/**/*.c"), paths({"src/.git/objects/x.c"}));
+    EXPECT_EQ(engine.expand(testDir_ + "/src/*/.mimir/*.c"), paths({"src/sub/.mimir/y.c"}));
+}
+
+TEST_F(GlobTest, RecursiveWildcardsDoNotFollowDirectorySymlinks)
+{
+    fs::create_directory_symlink(testDir_ + "/src", testDir_ + "/src/sub/loop");
+    mimir::GlobEngine engine(4);
+    EXPECT_EQ(engine.expand(testDir_ + "/src/sub/**/*.c"), paths({"src/sub/c.c", "src/sub/deep/d.c"}));
+    // Explicit segments still resolve through the link
+    EXPECT_EQ(engine.expand(testDir_ + "/src/sub/loop/*.h"), paths({"src/sub/loop/b.h"}));
+}
+
+TEST_F(GlobTest, EachDirectoryIsReadOncePerPass)
+{
+    mimir::GlobEngine engine(4);
+    EXPECT_EQ(engine.expand(testDir_ + "/src/**/*.c").size(), 3);
+    EXPECT_EQ(engine.expand(testDir_ + "/src/**/*.h").size(), 2);
+    EXPECT_EQ(engine.expand(testDir_ + "/src/*").size(), 2);
+    EXPECT_EQ(engine.directoriesRead(), 3);
+}
+
+TEST_F(GlobTest, ListingsAreReusedUntilTheirDirectoryChanges)
+{
+    age("src");
+    age("src/sub");
+    age("src/sub/deep");
+    mimir::GlobEngine engine(1);
+    EXPECT_EQ(engine.expand(testDir_ + "/src/**/*.c").size(), 3);
+    EXPECT_EQ(engine.directoriesRead(), 3);
+
+    engine.beginPass();
+    EXPECT_EQ(engine.expand(testDir_ + "/src/**/*.c").size(), 3);
+    EXPECT_EQ(engine.directoriesRead(), 3);
+
+    createTestFile("src/sub/new.c");
+    engine.beginPass();
+    EXPECT_EQ(engine.expand(testDir_ + "/src/**/*.c").size(), 4);
+    EXPECT_EQ(engine.directoriesRead(), 4);
+
+    // The fresh listing is too recent to trust, so it is read again
+    engine.beginPass();
+    EXPECT_EQ(engine.expand(testDir_ + "/src/**/*.c").size(), 4);
+    EXPECT_EQ(engine.directoriesRead(), 5);
+}
@@ -0,0 +1,172 @@
+#include "mimir/graph_cache.h"
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+class GraphCacheTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        testDir_ = "/tmp/test_graph_cache_" + std::to_string(::testing::UnitTest::GetInstance()->random_seed());
+        fs::create_directories(testDir_);
+        cachePath_ = testDir_ + "/graph.bin";
+
+        mimir::Target compile("compile");
+        compile.setCommand("cc -c main.c");
+        compile.addInput("main.c");
+        compile.addOutput("main.o");
+        compile.setRestat(true);
+        mimir::Target link("link");
+        link.setCommand("cc main.o -o app");
+        link.setPool("linkers");
+        link.setWeight(3);
+        link.setRemote(true);
+        link.addDependency("compile");
+        graph_.targets = {compile, link};
+        graph_.pools["linkers"] = 4;
+        graph_.probes.push_back(mimir::GlobProbe{"src/**", {"src/a.c", "src/b.c"}});
+        hash_ = mimir::GraphCache::hashSource(CONTENTS);
+        stamp_ = mimir::FileStamp{8, 1000, 42};
+    }
+
+    /// A parse time long after every stamp the test creates, so none is racy
+    static std::int64_t trustedTime()
+    {
+        return mimir::currentTimeNs() + 10 * mimir::TIMESTAMP_SLACK_NS;
+    }
+
+    bool write(const std::int64_t parsedAtNs)
+    {
+        return mimir::GraphCache::write(cachePath_, "build.yaml", hash_, stamp_, parsedAtNs, graph_);
+    }
+
+    static constexpr std::string_view CONTENTS = "contents";
+
+    void TearDown() override
+    {
+        fs::remove_all(testDir_);
+    }
+
+    std::string testDir_;
+    std::string cachePath_;
+    mimir::ParsedGraph graph_;
+    mimir::Digest hash_{};
+    mimir::FileStamp stamp_;
+};
+
+TEST_F(GraphCacheTest, RoundTripsTargetsPoolsAndProbes)
+{
+    ASSERT_TRUE(write(trustedTime()));
+
+    auto loaded = mimir::GraphCache::load(cachePath_, "build.yaml", CONTENTS, stamp_);
+    ASSERT_TRUE(loaded.has_value());
+    const auto& graph = loaded->graph;
+    ASSERT_EQ(graph.targets.size(), 2);
+    EXPECT_EQ(graph.targets[0].getName(), "compile");
+    EXPECT_EQ(graph.targets[0].getCommand(), "cc -c main.c");
+    EXPECT_EQ(graph.targets[0].getInputs(), std::vector<std::string>{"main.c"});
+    EXPECT_EQ(graph.targets[0].getOutputs(), std::vector<std::string>{"main.o"});
+    EXPECT_TRUE(graph.targets[0].getRestat());
+    EXPECT_FALSE(graph.targets[1].getRestat());
+    EXPECT_FALSE(graph.targets[0].getRemote());
+    EXPECT_TRUE(graph.targets[1].getRemote());
+    EXPECT_EQ(graph.targets[1].getPool(), "linkers");
+    EXPECT_EQ(graph.targets[1].getWeight(), 3u);
+    EXPECT_EQ(graph.targets[1].getDependencies(), std::vector<std::string>{"compile"});
+    EXPECT_EQ(graph.pools.at("linkers"), 4u);
+    ASSERT_EQ(graph.probes.size(), 1);
+    EXPECT_EQ(graph.probes[0].pattern, "src/**");
+    EXPECT_EQ(graph.probes[0].matches, (std::vector<std::string>{"src/a.c", "src/b.c"}));
+    EXPECT_EQ(loaded->sourceHash, hash_);
+    // Recursive globs are never vouched for by a directory stamp
+    EXPECT_EQ(loaded->recheck, std::vector<size_t>{0});
+}
+
+TEST_F(GraphCacheTest, MissesOnOtherContentsOrFile)
+{
+    ASSERT_TRUE(write(trustedTime()));
+    const mimir::FileStamp edited{9, 2000, 42};
+
+    EXPECT_FALSE(mimir::GraphCache::load(cachePath_, "build.yaml", "changed", edited).has_value());
+    EXPECT_FALSE(mimir::GraphCache::load(cachePath_, "other.yaml", CONTENTS, stamp_).has_value());
+    EXPECT_FALSE(mimir::GraphCache::load(testDir_ + "/absent.bin", "build.yaml", CONTENTS, stamp_).has_value());
+
+    // Touched but identical contents still hit, and ask to be rewritten with the new stamp
+    auto touched = mimir::GraphCache::load(cachePath_, "build.yaml", CONTENTS, edited);
+    ASSERT_TRUE(touched.has_value());
+    EXPECT_TRUE(touched->refresh);
+}
+
+TEST_F(GraphCacheTest, TrustsOnlyNonRacyStamps)
+{
+    // An unchanged, settled stamp stands in for hashing the contents
+    ASSERT_TRUE(write(trustedTime()));
+    EXPECT_TRUE(mimir::GraphCache::load(cachePath_, "build.yaml", "not hashed", stamp_).has_value());
+
+    // A stamp taken right when the file was modified proves nothing
+    ASSERT_TRUE(write(stamp_.mtimeNs));
+    EXPECT_FALSE(mimir::GraphCache::load(cachePath_, "build.yaml", "not hashed", stamp_).has_value());
+    EXPECT_TRUE(mimir::GraphCache::load(cachePath_, "build.yaml", CONTENTS, stamp_).has_value());
+}
+
+TEST_F(GraphCacheTest, DirectoryStampsVouchForSingleFileProbes)
+{
+    const std::string source = testDir_ + "/src/main.c";
+    fs::create_directories(testDir_ + "/src");
+    graph_.probes = {mimir::GlobProbe{source, {}}, mimir::GlobProbe{testDir_ + "/gone/file.c", {}}};
+    ASSERT_TRUE(write(trustedTime()));
+
+    auto settled = mimir::GraphCache::load(cachePath_, "build.yaml", CONTENTS, stamp_);
+    ASSERT_TRUE(settled.has_value());
+    EXPECT_TRUE(settled->recheck.empty());
+    EXPECT_FALSE(settled->refresh);
+
+    std::ofstream(source) << "int main() {}\n";
+    fs::create_directories(testDir_ + "/gone");
+    auto changed = mimir::GraphCache::load(cachePath_, "build.yaml", CONTENTS, stamp_);
+    ASSERT_TRUE(changed.has_value());
+    EXPECT_EQ(changed->recheck, (std::vector<size_t>{0, 1}));
+    EXPECT_TRUE(changed->refresh);
+}
+
+TEST_F(GraphCacheTest, WildcardProbesAreVouchedForWithinOneDirectory)
+{
+    fs::create_directories(testDir_ + "/src/sub");
+    fs::create_directories(testDir_ + "/linked");
+    fs::create_symlink(testDir_ + "/src/sub", testDir_ + "/linked/sub");
+    graph_.probes = {
+        mimir::GlobProbe{testDir_ + "/src/*.c", {}},
+        mimir::GlobProbe{testDir_ + "/src/**/*.c", {}},
+        mimir::GlobProbe{testDir_ + "/src/*/main.c", {}},
+        mimir::GlobProbe{testDir_ + "/linked/*", {}}};
+    ASSERT_TRUE(write(trustedTime()));
+
+    auto settled = mimir::GraphCache::load(cachePath_, "build.yaml", CONTENTS, stamp_);
+    ASSERT_TRUE(settled.has_value());
+    EXPECT_EQ(settled->recheck, (std::vector<size_t>{1, 2, 3}));
+
+    std::ofstream(testDir_ + "/src/main.c") << "int main() {}\n";
+    auto changed = mimir::GraphCache::load(cachePath_, "build.yaml", CONTENTS, stamp_);
+    ASSERT_TRUE(changed.has_value());
+    EXPECT_EQ(changed->recheck, (std::vector<size_t>{0, 1, 2, 3}));
+}
+
+TEST_F(GraphCacheTest, RejectsTruncatedAndCorruptFiles)
+{
+    ASSERT_TRUE(write(trustedTime()));
+    const auto size = fs::file_size(cachePath_);
+
+    fs::resize_file(cachePath_, size - 5);
+    EXPECT_FALSE(mimir::GraphCache::load(cachePath_, "build.yaml", CONTENTS, stamp_).has_value());
+
+    ASSERT_TRUE(write(trustedTime()));
+    {
+        std::fstream file(cachePath_, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(0);
+        file.put('X');
+    }
+    EXPECT_FALSE(mimir::GraphCache::load(cachePath_, "build.yaml", CONTENTS, stamp_).has_value());
+}
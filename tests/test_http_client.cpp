@@ -0,0 +1,77 @@
+#include "mimir/http_client.h"
+#include "http_test_server.h"
+#include <gtest/gtest.h>
+
+TEST(HttpUrlTest, ParsesHostPortAndPath)
+{
+    const auto url = mimir::HttpUrl::parse("http://cache.example:8080/mimir/");
+    ASSERT_TRUE(url.has_value());
+    EXPECT_EQ(url->host, "cache.example");
+    EXPECT_EQ(url->port, 8080);
+    EXPECT_EQ(url->basePath, "/mimir");
+}
+
+TEST(HttpUrlTest, DefaultsToPort80)
+{
+    const auto url = mimir::HttpUrl::parse("http://cache");
+    ASSERT_TRUE(url.has_value());
+    EXPECT_EQ(url->port, 80);
+    EXPECT_EQ(url->basePath, "");
+}
+
+TEST(HttpUrlTest, RejectsOtherSchemesAndBadPorts)
+{
+    EXPECT_FALSE(mimir::HttpUrl::parse("https://cache").has_value());
+    EXPECT_FALSE(mimir::HttpUrl::parse("cache:80").has_value());
+    EXPECT_FALSE(mimir::HttpUrl::parse("http://cache:0").has_value());
+    EXPECT_FALSE(mimir::HttpUrl::parse("http://cache:99999").has_value());
+    EXPECT_FALSE(mimir::HttpUrl::parse("http://:80").has_value());
+}
+
+TEST(HttpClientTest, PutGetHead)
+{
+    HttpTestServer server;
+    mimir::HttpClient client(*mimir::HttpUrl::parse(server.url() + "/base"));
+
+    const std::string body("binary\0payload", 14);
+    const auto put = client.put("/key", body);
+    ASSERT_TRUE(put.has_value());
+    EXPECT_TRUE(put->ok());
+
+    const auto get = client.get("/key");
+    ASSERT_TRUE(get.has_value());
+    EXPECT_EQ(get->status, 200);
+    EXPECT_EQ(get->body, body);
+
+    const auto head = client.head("/key");
+    ASSERT_TRUE(head.has_value());
+    EXPECT_TRUE(head->ok());
+    EXPECT_TRUE(head->body.empty());
+
+    const auto missing = client.get("/other");
+    ASSERT_TRUE(missing.has_value());
+    EXPECT_EQ(missing->status, 404);
+}
+
+TEST(HttpClientTest, DecodesChunkedBodies)
+{
+    HttpTestServer server;
+    server.setObject("/blob", "a body longer than one chunk");
+    server.setChunked(true);
+    mimir::HttpClient client(*mimir::HttpUrl::parse(server.url()));
+
+    const auto get = client.get("/blob");
+    ASSERT_TRUE(get.has_value());
+    EXPECT_EQ(get->body, "a body longer than one chunk");
+}
+
+TEST(HttpClientTest, ConnectionFailureIsNullopt)
+{
+    std::uint16_t port;
+    {
+        HttpTestServer server;
+        port = server.port();
+    }
+    mimir::HttpClient client(*mimir::HttpUrl::parse("http://127.0.0.1:" + std::to_string(port)), 1000);
+    EXPECT_FALSE(client.get("/key").has_value());
+}
@@ -0,0 +1,196 @@
+#include "mimir/jobserver.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <thread>
+#include <vector>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    /// @brief Pipe holding a given number of tokens, like make creates for -jN
+    class TokenPipe
+    {
+    public:
+        explicit TokenPipe(size_t tokens)
+        {
+            EXPECT_EQ(::pipe(fds_), 0);
+            for (size_t i = 0; i < tokens; ++i)
+            {
+                EXPECT_EQ(::write(fds_[1], "+", 1), 1);
+            }
+        }
+
+        ~TokenPipe()
+        {
+            ::close(fds_[0]);
+            ::close(fds_[1]);
+        }
+
+        std::string makeflags() const
+        {
+            return " -j3 --jobserver-auth=" + std::to_string(fds_[0]) + "," + std::to_string(fds_[1]);
+        }
+
+        size_t available() const
+        {
+            int bytes = 0;
+            EXPECT_EQ(::ioctl(fds_[0], FIONREAD, &bytes), 0);
+            return static_cast<size_t>(bytes);
+        }
+
+    private:
+        int fds_[2] = {-1, -1};
+    };
+}
+
+TEST(JobserverTest, AuthFromMakeflags)
+{
+    using mimir::Jobserver;
+    EXPECT_FALSE(Jobserver::authFromMakeflags("-k -j4").has_value());
+    EXPECT_EQ(Jobserver::authFromMakeflags(" -j4 --jobserver-auth=3,4"), std::optional<std::string>("3,4"));
+    EXPECT_EQ(Jobserver::authFromMakeflags("--jobserver-fds=5,6 -j"), std::optional<std::string>("5,6"));
+    EXPECT_EQ(Jobserver::authFromMakeflags("--jobserver-auth=3,4 --jobserver-auth=fifo:/tmp/x"),
+              std::optional<std::string>("fifo:/tmp/x"));
+}
+
+TEST(JobserverTest, RejectsUnusableAuth)
+{
+    EXPECT_EQ(mimir::Jobserver::connect("-j4"), nullptr);
+    EXPECT_EQ(mimir::Jobserver::connect("--jobserver-auth=-1,-1"), nullptr);
+    EXPECT_EQ(mimir::Jobserver::connect("--jobserver-auth=987,988"), nullptr);
+    EXPECT_EQ(mimir::Jobserver::connect("--jobserver-auth=fifo:/nonexistent/mimir-fifo"), nullptr);
+}
+
+TEST(JobserverTest, PipeClientTakesTokensAfterTheImplicitSlot)
+{
+    TokenPipe pipe(2);
+    auto client = mimir::Jobserver::connect(pipe.makeflags());
+    ASSERT_NE(client, nullptr);
+    EXPECT_FALSE(client->isServer());
+
+    ASSERT_TRUE(client->acquire());
+    EXPECT_EQ(client->heldTokens(), 0u);
+    ASSERT_TRUE(client->acquire());
+    ASSERT_TRUE(client->acquire());
+    EXPECT_EQ(client->heldTokens(), 2u);
+    EXPECT_EQ(pipe.available(), 0u);
+
+    std::atomic<bool> fourth{false};
+    std::thread waiter([&]()
+    {
+        fourth = client->acquire();
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_FALSE(fourth.load());
+
+    client->release();
+    waiter.join();
+    EXPECT_TRUE(fourth.load());
+
+    // Pooled tokens go back first; the implicit slot never enters the pipe
+    client->release();
+    client->release();
+    EXPECT_EQ(client->heldTokens(), 0u);
+    EXPECT_EQ(pipe.available(), 2u);
+    client->release();
+    EXPECT_EQ(pipe.available(), 2u);
+}
+
+TEST(JobserverTest, DestructorReturnsHeldTokens)
+{
+    TokenPipe pipe(3);
+    {
+        auto client = mimir::Jobserver::connect(pipe.makeflags());
+        ASSERT_NE(client, nullptr);
+        for (int i = 0; i < 3; ++i)
+        {
+            ASSERT_TRUE(client->acquire());
+        }
+        EXPECT_EQ(pipe.available(), 1u);
+    }
+    EXPECT_EQ(pipe.available(), 3u);
+}
+
+TEST(JobserverTest, FifoServerSharesTokensWithClients)
+{
+    std::string fifo;
+    {
+        auto server = mimir::Jobserver::create(3);
+        ASSERT_NE(server, nullptr);
+        EXPECT_TRUE(server->isServer());
+        const auto auth = mimir::Jobserver::authFromMakeflags(server->makeflags());
+        ASSERT_TRUE(auth.has_value());
+        ASSERT_EQ(auth->rfind("fifo:", 0), 0u);
+        fifo = auth->substr(5);
+        EXPECT_TRUE(fs::exists(fifo));
+        EXPECT_NE(server->makeflags().find("-j3"), std::string::npos);
+
+        auto client = mimir::Jobserver::connect(server->makeflags());
+        ASSERT_NE(client, nullptr);
+
+        // Two pooled tokens: the client takes one past its implicit slot, the server the other
+        ASSERT_TRUE(client->acquire());
+        ASSERT_TRUE(client->acquire());
+        ASSERT_TRUE(server->acquire());
+        ASSERT_TRUE(server->acquire());
+        EXPECT_EQ(client->heldTokens() + server->heldTokens(), 2u);
+
+        client->release();
+        client->release();
+        server->release();
+        server->release();
+    }
+    EXPECT_FALSE(fs::exists(fifo));
+}
+
+TEST(JobserverTest, PipeServerAnnouncesInheritableDescriptors)
+{
+    auto server = mimir::Jobserver::create(2, mimir::Jobserver::Style::Pipe);
+    ASSERT_NE(server, nullptr);
+    const auto auth = mimir::Jobserver::authFromMakeflags(server->makeflags());
+    ASSERT_TRUE(auth.has_value());
+    EXPECT_EQ(auth->find("fifo:"), std::string::npos);
+
+    auto client = mimir::Jobserver::connect(server->makeflags());
+    ASSERT_NE(client, nullptr);
+    ASSERT_TRUE(client->acquire());
+    ASSERT_TRUE(client->acquire());
+    EXPECT_EQ(client->heldTokens(), 1u);
+    client->release();
+    client->release();
+}
+
+TEST(JobserverTest, ShutdownReleasesWaiters)
+{
+    TokenPipe pipe(0);
+    auto client = mimir::Jobserver::connect(pipe.makeflags());
+    ASSERT_NE(client, nullptr);
+    ASSERT_TRUE(client->acquire());
+
+    std::atomic<int> refused{0};
+    std::vector<std::thread> waiters;
+    for (int i = 0; i < 3; ++i)
+    {
+        waiters.emplace_back([&]()
+        {
+            if (!client->acquire())
+            {
+                ++refused;
+            }
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    client->shutdown();
+    for (auto& waiter : waiters)
+    {
+        waiter.join();
+    }
+    EXPECT_EQ(refused.load(), 3);
+    EXPECT_FALSE(client->acquire());
+    client->release();
+}
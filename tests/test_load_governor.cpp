@@ -0,0 +1,232 @@
+#include "mimir/load_governor.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    /// @brief Probe returning whatever the test last stored
+    class FakeProbe : public mimir::ILoadProbe
+    {
+    public:
+        mimir::LoadSample sample() override
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return sample_;
+        }
+
+        void set(const mimir::LoadSample& sample)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            sample_ = sample;
+        }
+
+    private:
+        std::mutex mutex_;
+        mimir::LoadSample sample_;
+    };
+
+    mimir::LoadSample pressure(double percent)
+    {
+        mimir::LoadSample sample;
+        sample.memoryPressure = percent;
+        return sample;
+    }
+}
+
+class ProcLoadProbeTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        procDir_ = "/tmp/test_load_probe_" + std::to_string(::testing::UnitTest::GetInstance()->random_seed());
+        fs::create_directories(procDir_ + "/pressure");
+    }
+
+    void TearDown() override
+    {
+        fs::remove_all(procDir_);
+    }
+
+    std::string procDir_;
+};
+
+TEST_F(ProcLoadProbeTest, ParsesProcFiles)
+{
+    std::ofstream(procDir_ + "/loadavg") << "3.50 2.00 1.00 2/300 4242\n";
+    std::ofstream(procDir_ + "/pressure/memory")
+        << "some avg10=12.34 avg60=5.00 avg300=1.00 total=999\n"
+        << "full avg10=2.00 avg60=1.00 avg300=0.50 total=111\n";
+    std::ofstream(procDir_ + "/meminfo")
+        << "MemTotal:       16000000 kB\n"
+        << "MemFree:         1000000 kB\n"
+        << "MemAvailable:    4000000 kB\n";
+
+    mimir::ProcLoadProbe probe(procDir_);
+    const mimir::LoadSample sample = probe.sample();
+    ASSERT_TRUE(sample.loadAverage.has_value());
+    EXPECT_DOUBLE_EQ(*sample.loadAverage, 3.5);
+    ASSERT_TRUE(sample.memoryPressure.has_value());
+    EXPECT_DOUBLE_EQ(*sample.memoryPressure, 12.34);
+    EXPECT_EQ(sample.availableMemoryKb, std::optional<std::uint64_t>(4000000));
+}
+
+TEST_F(ProcLoadProbeTest, MissingFilesLeaveMetricsUnknown)
+{
+    mimir::ProcLoadProbe probe(procDir_ + "/missing");
+    const mimir::LoadSample sample = probe.sample();
+    EXPECT_FALSE(sample.memoryPressure.has_value());
+    EXPECT_FALSE(sample.availableMemoryKb.has_value());
+}
+
+TEST(LoadGovernorTest, MemoryPressureHalvesAndRecoveryGrowsByOne)
+{
+    auto probe = std::make_shared<FakeProbe>();
+    mimir::LoadLimits limits;
+    limits.maxMemoryPressure = 10.0;
+
+    probe->set(pressure(50.0));
+    mimir::LoadGovernor governor(16, limits, probe, std::chrono::hours(1));
+    EXPECT_EQ(governor.limit(), 8u);
+    governor.refresh();
+    EXPECT_EQ(governor.limit(), 4u);
+
+    // Between 80% and 100% of the threshold the limit holds steady
+    probe->set(pressure(9.0));
+    governor.refresh();
+    EXPECT_EQ(governor.limit(), 4u);
+
+    probe->set(pressure(1.0));
+    governor.refresh();
+    EXPECT_EQ(governor.limit(), 5u);
+    EXPECT_EQ(governor.lowestLimit(), 4u);
+}
+
+TEST(LoadGovernorTest, LoadAverageTakesOneSlotAndNeverBelowOne)
+{
+    auto probe = std::make_shared<FakeProbe>();
+    mimir::LoadLimits limits;
+    limits.maxLoadAverage = 4.0;
+
+    mimir::LoadSample busy;
+    busy.loadAverage = 20.0;
+    probe->set(busy);
+    mimir::LoadGovernor governor(3, limits, probe, std::chrono::hours(1));
+    EXPECT_EQ(governor.limit(), 2u);
+    governor.refresh();
+    governor.refresh();
+    EXPECT_EQ(governor.limit(), 1u);
+
+    // Metrics the limits don't mention are ignored
+    mimir::LoadSample quiet;
+    quiet.loadAverage = 0.5;
+    quiet.memoryPressure = 90.0;
+    probe->set(quiet);
+    for (int i = 0; i < 10; ++i)
+    {
+        governor.refresh();
+    }
+    EXPECT_EQ(governor.limit(), 3u);
+}
+
+TEST(LoadGovernorTest, LowFreeMemoryShrinks)
+{
+    auto probe = std::make_shared<FakeProbe>();
+    mimir::LoadLimits limits;
+    limits.minAvailableMemoryKb = 1024 * 1024;
+
+    mimir::LoadSample sample;
+    sample.availableMemoryKb = 256 * 1024;
+    probe->set(sample);
+    mimir::LoadGovernor governor(8, limits, probe, std::chrono::hours(1));
+    EXPECT_EQ(governor.limit(), 4u);
+}
+
+TEST(LoadGovernorTest, AcquireBlocksAtTheLimit)
+{
+    auto probe = std::make_shared<FakeProbe>();
+    mimir::LoadLimits limits;
+    limits.maxMemoryPressure = 10.0;
+    probe->set(pressure(50.0));
+    mimir::LoadGovernor governor(2, limits, probe, std::chrono::hours(1));
+    ASSERT_EQ(governor.limit(), 1u);
+
+    ASSERT_TRUE(governor.acquire());
+    std::atomic<bool> second{false};
+    std::thread waiter([&]()
+    {
+        if (governor.acquire())
+        {
+            second = true;
+            governor.release();
+        }
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_FALSE(second.load());
+
+    governor.release();
+    waiter.join();
+    EXPECT_TRUE(second.load());
+    EXPECT_EQ(governor.active(), 0u);
+}
+
+TEST(LoadGovernorTest, ShutdownReleasesWaiters)
+{
+    auto probe = std::make_shared<FakeProbe>();
+    mimir::LoadLimits limits;
+    limits.maxMemoryPressure = 10.0;
+    probe->set(pressure(50.0));
+    mimir::LoadGovernor governor(1, limits, probe, std::chrono::hours(1));
+
+    ASSERT_TRUE(governor.acquire());
+    std::atomic<int> refused{0};
+    std::vector<std::thread> waiters;
+    for (int i = 0; i < 3; ++i)
+    {
+        waiters.emplace_back([&]()
+        {
+            if (!governor.acquire())
+            {
+                ++refused;
+            }
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    governor.shutdown();
+    for (auto& waiter : waiters)
+    {
+        waiter.join();
+    }
+    EXPECT_EQ(refused.load(), 3);
+    governor.release();
+}
+
+TEST(LoadGovernorTest, WaitersResampleAndGrow)
+{
+    auto probe = std::make_shared<FakeProbe>();
+    mimir::LoadLimits limits;
+    limits.maxMemoryPressure = 10.0;
+    probe->set(pressure(50.0));
+    mimir::LoadGovernor governor(2, limits, probe, std::chrono::milliseconds(10));
+    ASSERT_EQ(governor.limit(), 1u);
+    ASSERT_TRUE(governor.acquire());
+
+    // Pressure clears while the slot is still held; the waiter notices by itself
+    probe->set(pressure(0.0));
+    std::atomic<bool> second{false};
+    std::thread waiter([&]()
+    {
+        second = governor.acquire();
+    });
+    waiter.join();
+    EXPECT_TRUE(second.load());
+    EXPECT_EQ(governor.active(), 2u);
+    governor.release();
+    governor.release();
+}
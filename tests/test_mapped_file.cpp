@@ -0,0 +1,63 @@
+#include "mimir/mapped_file.h"
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+class MappedFileTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        testDir_ = "/tmp/test_mapped_file_" + std::to_string(::testing::UnitTest::GetInstance()->random_seed());
+        fs::create_directories(testDir_);
+    }
+
+    void TearDown() override
+    {
+        fs::remove_all(testDir_);
+    }
+
+    std::string createTestFile(const std::string& name, const std::string& content)
+    {
+        std::string path = testDir_ + "/" + name;
+        std::ofstream file(path, std::ios::binary);
+        file << content;
+        return path;
+    }
+
+    std::string testDir_;
+};
+
+TEST_F(MappedFileTest, ViewsWholeFile)
+{
+    mimir::MappedFile file;
+    ASSERT_TRUE(file.open(createTestFile("a.txt", std::string("line\n\0binary", 12))));
+    EXPECT_TRUE(file.isOpen());
+    EXPECT_EQ(file.view(), std::string_view("line\n\0binary", 12));
+}
+
+TEST_F(MappedFileTest, EmptyAndMissingFiles)
+{
+    mimir::MappedFile file;
+    ASSERT_TRUE(file.open(createTestFile("empty.txt", "")));
+    EXPECT_TRUE(file.view().empty());
+
+    EXPECT_FALSE(file.open(testDir_ + "/missing.txt"));
+    EXPECT_FALSE(file.isOpen());
+}
+
+TEST_F(MappedFileTest, MoveTransfersTheMapping)
+{
+    mimir::MappedFile file;
+    ASSERT_TRUE(file.open(createTestFile("a.txt", "contents")));
+
+    mimir::MappedFile moved(std::move(file));
+    EXPECT_EQ(moved.view(), "contents");
+    EXPECT_FALSE(file.isOpen());
+
+    moved.close();
+    EXPECT_FALSE(moved.isOpen());
+    EXPECT_TRUE(moved.view().empty());
+}
@@ -0,0 +1,78 @@
+#include "mimir/output_buffer.h"
+#include <gtest/gtest.h>
+#include <string>
+
+TEST(OutputBufferTest, StartsEmpty)
+{
+    mimir::OutputBuffer buffer(16);
+    EXPECT_TRUE(buffer.empty());
+    EXPECT_EQ(buffer.size(), 0u);
+    EXPECT_EQ(buffer.str(), "");
+    EXPECT_EQ(buffer.droppedBytes(), 0u);
+}
+
+TEST(OutputBufferTest, KeepsEverythingBelowCapacity)
+{
+    mimir::OutputBuffer buffer(16);
+    buffer.append("hello ", 6);
+    buffer.append("world", 5);
+    EXPECT_EQ(buffer.str(), "hello world");
+    EXPECT_EQ(buffer.droppedBytes(), 0u);
+}
+
+TEST(OutputBufferTest, KeepsMostRecentBytesWhenFull)
+{
+    mimir::OutputBuffer buffer(8);
+    buffer.append("0123456", 7);
+    buffer.append("789", 3);
+    EXPECT_EQ(buffer.str(), "23456789");
+    EXPECT_EQ(buffer.droppedBytes(), 2u);
+
+    buffer.append("abcde", 5);
+    EXPECT_EQ(buffer.str(), "789abcde");
+    EXPECT_EQ(buffer.droppedBytes(), 7u);
+    EXPECT_EQ(buffer.size(), 8u);
+}
+
+TEST(OutputBufferTest, OversizedAppendKeepsItsTail)
+{
+    mimir::OutputBuffer buffer(4);
+    buffer.append("ab", 2);
+    const std::string big = "0123456789";
+    buffer.append(big.data(), big.size());
+    EXPECT_EQ(buffer.str(), "6789");
+    EXPECT_EQ(buffer.droppedBytes(), 8u);
+}
+
+TEST(OutputBufferTest, ManySmallAppendsWrapCorrectly)
+{
+    mimir::OutputBuffer buffer(5);
+    std::string all;
+    for (int i = 0; i < 100; ++i)
+    {
+        const char c = static_cast<char>('a' + i % 26);
+        buffer.append(&c, 1);
+        all += c;
+    }
+    EXPECT_EQ(buffer.str(), all.substr(all.size() - 5));
+    EXPECT_EQ(buffer.droppedBytes(), 95u);
+}
+
+TEST(OutputBufferTest, ClearResets)
+{
+    mimir::OutputBuffer buffer(3);
+    buffer.append("abcdef", 6);
+    buffer.clear();
+    EXPECT_TRUE(buffer.empty());
+    EXPECT_EQ(buffer.droppedBytes(), 0u);
+    buffer.append("xy", 2);
+    EXPECT_EQ(buffer.str(), "xy");
+}
+
+TEST(OutputBufferTest, ZeroCapacityKeepsOneByte)
+{
+    mimir::OutputBuffer buffer(0);
+    EXPECT_EQ(buffer.capacity(), 1u);
+    buffer.append("abc", 3);
+    EXPECT_EQ(buffer.str(), "c");
+}
@@ -323,3 +323,465 @@ targets:
     EXPECT_EQ(targets[0].getDependencies()[1], "dep2");
     EXPECT_EQ(targets[0].getDependencies()[2], "dep3");
 }
+
+TEST_F(ParserTest, ParseYAMLPoolsAndWeights)
+{
+    std::string yaml = R"(
+pools:
+  link: 2
+  codegen: 8
+
+targets:
+  - name: compile
+    command: cc -c a.c
+  - name: link
+    pool: link
+    weight: 2
+    command: cc a.o -o a
+)";
+    std::string path = createTestFile("build.yaml", yaml);
+
+    auto targets = parser_.parseYAML(path);
+
+    ASSERT_EQ(targets.size(), 2u);
+    EXPECT_TRUE(targets[0].getPool().empty());
+    EXPECT_EQ(targets[0].getWeight(), 1u);
+    EXPECT_EQ(targets[1].getPool(), "link");
+    EXPECT_EQ(targets[1].getWeight(), 2u);
+    EXPECT_EQ(targets[1].getCommand(), "cc a.o -o a");
+    ASSERT_EQ(parser_.getPools().size(), 2u);
+    EXPECT_EQ(parser_.getPools().at("link"), 2u);
+    EXPECT_EQ(parser_.getPools().at("codegen"), 8u);
+}
+
+TEST_F(ParserTest, ParseTOMLPoolsAndWeights)
+{
+    std::string toml = R"(
+[pools]
+link = 1
+
+[target.link]
+pool = "link"
+weight = 3
+command = "cc a.o -o a"
+)";
+    std::string path = createTestFile("build.toml", toml);
+
+    auto targets = parser_.parseTOML(path);
+
+    ASSERT_EQ(targets.size(), 1u);
+    EXPECT_EQ(targets[0].getPool(), "link");
+    EXPECT_EQ(targets[0].getWeight(), 3u);
+    EXPECT_EQ(parser_.getPools().at("link"), 1u);
+}
+
+TEST_F(ParserTest, RejectsUndefinedPoolAndBadWeight)
+{
+    std::string undefinedPool = createTestFile("undefined.yaml", R"(
+targets:
+  - name: link
+    pool: nowhere
+    command: cc a.o
+)");
+    EXPECT_TRUE(parser_.parseYAML(undefinedPool).empty());
+    ASSERT_TRUE(parser_.getLastError().has_value());
+    EXPECT_NE(parser_.getLastError()->message.find("nowhere"), std::string::npos);
+
+    std::string badWeight = createTestFile("weight.yaml", R"(
+targets:
+  - name: link
+    weight: 0
+    command: cc a.o
+)");
+    EXPECT_TRUE(parser_.parseYAML(badWeight).empty());
+    ASSERT_TRUE(parser_.getLastError().has_value());
+    EXPECT_EQ(parser_.getLastError()->line, 4u);
+
+    std::string badCapacity = createTestFile("capacity.toml", "[pools]\nlink = many\n");
+    EXPECT_TRUE(parser_.parseTOML(badCapacity).empty());
+    ASSERT_TRUE(parser_.getLastError().has_value());
+    EXPECT_EQ(parser_.getLastError()->line, 2u);
+}
+
+TEST_F(ParserTest, ExpandsConditionalsListsAndNestedVariables)
+{
+    std::string source = createTestFile("main.c", "int main() {}\n");
+    std::string yaml = R"(
+variables:
+  base: -O2
+  flags: ${base} -g
+  debug: -O0
+config:
+  mode: release
+targets:
+  - name: compile
+    inputs:
+      - )" + source + R"(
+      - )" + testDir_ + R"(/missing.c
+    outputs:
+      - )" + testDir_ + R"(/main.o
+    command: cc ${flags} ${{ debug if config.mode == "debug" else flags }} ${unknown} $HOME ${inputs} -o ${outputs}
+)";
+    std::string path = createTestFile("build.yaml", yaml);
+
+    auto targets = parser_.parseYAML(path);
+
+    ASSERT_EQ(targets.size(), 1);
+    // Lists name only files that exist; unknown variables expand to their name
+    EXPECT_EQ(targets[0].getCommand(), "cc -O2 -g -O2 -g unknown $HOME " + source + " -o ");
+}
+
+TEST_F(ParserTest, SelfReferencingVariableTerminates)
+{
+    std::string path = createTestFile("build.yaml", R"(
+variables:
+  loop: x${loop}
+targets:
+  - name: t
+    command: echo ${loop}
+)");
+
+    auto targets = parser_.parseYAML(path);
+
+    ASSERT_EQ(targets.size(), 1);
+    EXPECT_EQ(targets[0].getCommand().rfind("echo xx", 0), 0u);
+}
+
+TEST_F(ParserTest, GraphCacheServesUnchangedFiles)
+{
+    std::string yaml = R"(
+pools:
+  link: 2
+targets:
+  - name: link
+    pool: link
+    weight: 2
+    inputs:
+      - a.o
+    outputs:
+      - app
+    command: cc a.o -o app
+)";
+    std::string path = createTestFile("build.yaml", yaml);
+    const std::string cacheDir = testDir_ + "/cache";
+
+    mimir::Parser first;
+    first.setCacheDirectory(cacheDir);
+    auto parsed = first.parseFile(path);
+    ASSERT_TRUE(std::holds_alternative<std::vector<mimir::Target>>(parsed));
+    EXPECT_FALSE(first.loadedFromCache());
+    EXPECT_TRUE(fs::exists(cacheDir + "/graph.bin"));
+
+    mimir::Parser second;
+    second.setCacheDirectory(cacheDir);
+    auto cached = second.parseFile(path);
+    ASSERT_TRUE(std::holds_alternative<std::vector<mimir::Target>>(cached));
+    EXPECT_TRUE(second.loadedFromCache());
+    const auto& targets = std::get<std::vector<mimir::Target>>(cached);
+    ASSERT_EQ(targets.size(), 1);
+    EXPECT_EQ(targets[0].getName(), "link");
+    EXPECT_EQ(targets[0].getCommand(), "cc a.o -o app");
+    EXPECT_EQ(targets[0].getPool(), "link");
+    EXPECT_EQ(targets[0].getWeight(), 2u);
+    EXPECT_EQ(targets[0].getInputs(), std::vector<std::string>{"a.o"});
+    EXPECT_EQ(second.getPools().at("link"), 2u);
+
+    createTestFile("build.yaml", yaml + "  - name: extra\n    command: true\n");
+    mimir::Parser third;
+    third.setCacheDirectory(cacheDir);
+    auto changed = third.parseFile(path);
+    ASSERT_TRUE(std::holds_alternative<std::vector<mimir::Target>>(changed));
+    EXPECT_FALSE(third.loadedFromCache());
+    EXPECT_EQ(std::get<std::vector<mimir::Target>>(changed).size(), 2);
+}
+
+TEST_F(ParserTest, GraphCacheNoticesFilesAppearing)
+{
+    const std::string source = testDir_ + "/late.c";
+    std::string path = createTestFile("build.yaml", R"(
+targets:
+  - name: compile
+    inputs:
+      - )" + source + R"(
+    command: cc ${inputs}
+)");
+    const std::string cacheDir = testDir_ + "/cache";
+
+    mimir::Parser first;
+    first.setCacheDirectory(cacheDir);
+    auto before = first.parseFile(path);
+    ASSERT_TRUE(std::holds_alternative<std::vector<mimir::Target>>(before));
+    EXPECT_EQ(std::get<std::vector<mimir::Target>>(before)[0].getCommand(), "cc ");
+
+    createTestFile("late.c", "int x;\n");
+    mimir::Parser second;
+    second.setCacheDirectory(cacheDir);
+    auto after = second.parseFile(path);
+    ASSERT_TRUE(std::holds_alternative<std::vector<mimir::Target>>(after));
+    EXPECT_FALSE(second.loadedFromCache());
+    EXPECT_EQ(std::get<std::vector<mimir::Target>>(after)[0].getCommand(), "cc " + source);
+}
+
+TEST_F(ParserTest, WildcardInputsAreExpandedAndCached)
+{
+    fs::create_directories(testDir_ + "/src/lib");
+    createTestFile("src/main.c", "");
+    createTestFile("src/util.h", "");
+    createTestFile("src/lib/b.c", "");
+    createTestFile("src/lib/a.c", "");
+    std::string path = createTestFile("build.yaml", R"(
+targets:
+  - name: compile
+    inputs:
+      - )" + testDir_ + R"(/src/**/*.c
+      - )" + testDir_ + R"(/src/*.[hx]
+    command: cc ${inputs}
+)");
+    const std::string cacheDir = testDir_ + "/cache";
+    const std::string expected = "cc " + testDir_ + "/src/lib/a.c " + testDir_ + "/src/lib/b.c " + testDir_
+        + "/src/main.c " + testDir_ + "/src/util.h";
+
+    mimir::Parser first;
+    first.setCacheDirectory(cacheDir);
+    auto parsed = first.parseFile(path);
+    ASSERT_TRUE(std::holds_alternative<std::vector<mimir::Target>>(parsed));
+    EXPECT_EQ(std::get<std::vector<mimir::Target>>(parsed)[0].getCommand(), expected);
+
+    mimir::Parser second;
+    second.setCacheDirectory(cacheDir);
+    auto cached = second.parseFile(path);
+    ASSERT_TRUE(std::holds_alternative<std::vector<mimir::Target>>(cached));
+    EXPECT_TRUE(second.loadedFromCache());
+    EXPECT_EQ(std::get<std::vector<mimir::Target>>(cached)[0].getCommand(), expected);
+
+    createTestFile("src/lib/c.c", "");
+    mimir::Parser third;
+    third.setCacheDirectory(cacheDir);
+    auto changed = third.parseFile(path);
+    ASSERT_TRUE(std::holds_alternative<std::vector<mimir::Target>>(changed));
+    EXPECT_FALSE(third.loadedFromCache());
+    EXPECT_NE(std::get<std::vector<mimir::Target>>(changed)[0].getCommand().find("src/lib/c.c"), std::string::npos);
+}
+
+TEST_F(ParserTest, IncludesAreMergedInFileOrderWithInheritedVariables)
+{
+    fs::create_directories(testDir_ + "/pkg/a/sub");
+    fs::create_directories(testDir_ + "/pkg/b");
+    createTestFile("pkg/a/build.yaml", R"(
+variables:
+  cc: clang
+include:
+  - sub/build.yaml
+targets:
+  - name: a
+    command: ${cc} a.c
+)");
+    createTestFile("pkg/a/sub/build.yaml", R"(
+targets:
+  - name: a_sub
+    command: ${cc} sub.c ${flags}
+)");
+    createTestFile("pkg/b/build.toml", R"(
+[target.b]
+command = "${cc} b.c"
+dependencies = ["a"]
+)");
+    std::string path = createTestFile("build.yaml", R"(
+variables:
+  cc: gcc
+  flags: -O2
+include:
+  - pkg/a/build.yaml
+  - pkg/b/build.toml
+targets:
+  - name: all
+    command: ${cc} -o app
+)");
+
+    auto targets = parser_.parseYAML(path);
+
+    ASSERT_FALSE(parser_.getLastError().has_value()) << parser_.getLastError()->toString();
+    ASSERT_EQ(targets.size(), 4);
+    EXPECT_EQ(targets[0].getName(), "all");
+    EXPECT_EQ(targets[0].getCommand(), "gcc -o app");
+    EXPECT_EQ(targets[1].getName(), "a");
+    EXPECT_EQ(targets[1].getCommand(), "clang a.c");
+    // Nested includes see their includer's overrides and everything above it
+    EXPECT_EQ(targets[2].getName(), "a_sub");
+    EXPECT_EQ(targets[2].getCommand(), "clang sub.c -O2");
+    // Siblings do not see each other's variables
+    EXPECT_EQ(targets[3].getName(), "b");
+    EXPECT_EQ(targets[3].getCommand(), "gcc b.c");
+    EXPECT_EQ(parser_.getSourceFiles(), (std::vector<std::string>{
+        path, testDir_ + "/pkg/a/build.yaml", testDir_ + "/pkg/a/sub/build.yaml", testDir_ + "/pkg/b/build.toml"}));
+}
+
+TEST_F(ParserTest, ManyIncludesAndRepeatedIncludesAreParsedOnce)
+{
+    std::string root = "include = [";
+    for (int i = 0; i < 200; ++i)
+    {
+        const std::string name = "pkg" + std::to_string(i) + ".toml";
+        createTestFile(name, "include = [\"common.toml\", \"" + name + "\"]\n[target.t" + std::to_string(i)
+            + "]\ncommand = \"make " + std::to_string(i) + "\"\n");
+        root += (i > 0 ? ", \"" : "\"") + name + "\"";
+    }
+    createTestFile("common.toml", "include = [\"build.toml\"]\n[target.common]\ncommand = \"true\"\n");
+    std::string path = createTestFile("build.toml", root + "]\n");
+
+    auto targets = parser_.parseTOML(path);
+
+    ASSERT_FALSE(parser_.getLastError().has_value()) << parser_.getLastError()->toString();
+    ASSERT_EQ(targets.size(), 201);
+    EXPECT_EQ(targets[0].getName(), "t0");
+    EXPECT_EQ(targets[1].getName(), "common");
+    EXPECT_EQ(targets[200].getName(), "t199");
+    EXPECT_EQ(targets[200].getCommand(), "make 199");
+}
+
+TEST_F(ParserTest, IncludeConflictsAreReported)
+{
+    createTestFile("dup.yaml", "targets:\n  - name: compile\n    command: true\n");
+    std::string duplicate = createTestFile("build.yaml",
+        "include:\n  - dup.yaml\ntargets:\n  - name: compile\n    command: true\n");
+    EXPECT_TRUE(parser_.parseYAML(duplicate).empty());
+    ASSERT_TRUE(parser_.getLastError().has_value());
+    EXPECT_EQ(parser_.getLastError()->file, testDir_ + "/dup.yaml");
+    EXPECT_NE(parser_.getLastError()->message.find("'compile' is already defined in " + duplicate),
+        std::string::npos);
+
+    createTestFile("out.yaml", "targets:\n  - name: other\n    outputs:\n      - app\n    command: true\n");
+    std::string output = createTestFile("output.yaml",
+        "include: out.yaml\ntargets:\n  - name: link\n    outputs:\n      - app\n    command: true\n");
+    EXPECT_TRUE(parser_.parseYAML(output).empty());
+    ASSERT_TRUE(parser_.getLastError().has_value());
+    EXPECT_NE(parser_.getLastError()->message.find("Output 'app' of target 'other' is already produced by target 'link'"),
+        std::string::npos);
+
+    createTestFile("pool.yaml", "pools:\n  link: 2\n");
+    std::string pool = createTestFile("pools.yaml",
+        "pools:\n  link: 1\ninclude:\n  - pool.yaml\ntargets:\n  - name: x\n    command: true\n");
+    EXPECT_TRUE(parser_.parseYAML(pool).empty());
+    ASSERT_TRUE(parser_.getLastError().has_value());
+    EXPECT_NE(parser_.getLastError()->message.find("Pool 'link' is already defined with capacity 1"), std::string::npos);
+
+    std::string missing = createTestFile("missing.yaml", "include:\n  - nowhere.yaml\n");
+    EXPECT_TRUE(parser_.parseYAML(missing).empty());
+    ASSERT_TRUE(parser_.getLastError().has_value());
+    EXPECT_EQ(parser_.getLastError()->file, testDir_ + "/nowhere.yaml");
+}
+
+TEST_F(ParserTest, IncludedPoolsAreVisibleToTheWholeTree)
+{
+    createTestFile("pools.toml", "[pools]\nlink = 2\n");
+    std::string path = createTestFile("build.yaml",
+        "include:\n  - pools.toml\ntargets:\n  - name: x\n    pool: link\n    command: true\n");
+
+    auto targets = parser_.parseYAML(path);
+
+    ASSERT_EQ(targets.size(), 1);
+    EXPECT_EQ(parser_.getPools().at("link"), 2u);
+}
+
+TEST_F(ParserTest, GraphCacheNoticesIncludedFileChanges)
+{
+    createTestFile("pkg.yaml", "targets:\n  - name: pkg\n    command: true\n");
+    std::string path = createTestFile("build.yaml", "include:\n  - pkg.yaml\ntargets:\n  - name: root\n    command: true\n");
+    const std::string cacheDir = testDir_ + "/cache";
+
+    mimir::Parser first;
+    first.setCacheDirectory(cacheDir);
+    ASSERT_TRUE(std::holds_alternative<std::vector<mimir::Target>>(first.parseFile(path)));
+
+    mimir::Parser second;
+    second.setCacheDirectory(cacheDir);
+    ASSERT_TRUE(std::holds_alternative<std::vector<mimir::Target>>(second.parseFile(path)));
+    EXPECT_TRUE(second.loadedFromCache());
+    EXPECT_EQ(second.getSourceFiles().size(), 2);
+
+    createTestFile("pkg.yaml", "targets:\n  - name: pkg\n    command: true\n  - name: more\n    command: true\n");
+    mimir::Parser third;
+    third.setCacheDirectory(cacheDir);
+    auto changed = third.parseFile(path);
+    ASSERT_TRUE(std::holds_alternative<std::vector<mimir::Target>>(changed));
+    EXPECT_FALSE(third.loadedFromCache());
+    EXPECT_EQ(std::get<std::vector<mimir::Target>>(changed).size(), 3);
+}
+
+TEST_F(ParserTest, ParsesDepfilesAndDepsFormats)
+{
+    std::string yaml = createTestFile("build.yaml", R"(
+variables:
+  objdir: build
+targets:
+  - name: main
+    depfile: ${objdir}/main.o.d
+    command: cc -MD -MF main.o.d -c main.c
+  - name: win
+    deps: msvc
+    command: cl /showIncludes /c win.cpp
+)");
+    auto targets = parser_.parseYAML(yaml);
+    ASSERT_EQ(targets.size(), 2);
+    EXPECT_EQ(targets[0].getDepfile(), "build/main.o.d");
+    EXPECT_EQ(targets[0].getDepsFormat(), mimir::DepsFormat::GCC);
+    EXPECT_EQ(targets[1].getDepsFormat(), mimir::DepsFormat::MSVC);
+
+    std::string toml = createTestFile("build.toml", "[target.main]\ndepfile = \"main.d\"\ndeps = \"gcc\"\ncommand = \"cc\"\n");
+    auto tomlTargets = parser_.parseTOML(toml);
+    ASSERT_EQ(tomlTargets.size(), 1);
+    EXPECT_EQ(tomlTargets[0].getDepfile(), "main.d");
+    EXPECT_EQ(tomlTargets[0].getDepsFormat(), mimir::DepsFormat::GCC);
+
+    std::string unknown = createTestFile("unknown.yaml", "targets:\n  - name: x\n    deps: clang\n    command: true\n");
+    EXPECT_TRUE(parser_.parseYAML(unknown).empty());
+    ASSERT_TRUE(parser_.getLastError().has_value());
+    EXPECT_EQ(parser_.getLastError()->line, 3);
+
+    std::string missing = createTestFile("missing.yaml", "targets:\n  - name: x\n    deps: gcc\n    command: true\n");
+    EXPECT_TRUE(parser_.parseYAML(missing).empty());
+    ASSERT_TRUE(parser_.getLastError().has_value());
+    EXPECT_NE(parser_.getLastError()->message.find("without a depfile"), std::string::npos);
+}
+
+TEST_F(ParserTest, ParsesRestat)
+{
+    std::string yaml = createTestFile("build.yaml",
+        "targets:\n  - name: gen\n    restat: true\n    command: protoc api.proto\n"
+        "  - name: cc\n    command: cc -c api.cc\n");
+    auto targets = parser_.parseYAML(yaml);
+    ASSERT_EQ(targets.size(), 2);
+    EXPECT_TRUE(targets[0].getRestat());
+    EXPECT_FALSE(targets[1].getRestat());
+
+    std::string toml = createTestFile("build.toml", "[target.gen]\nrestat = true\ncommand = \"protoc\"\n");
+    auto tomlTargets = parser_.parseTOML(toml);
+    ASSERT_EQ(tomlTargets.size(), 1);
+    EXPECT_TRUE(tomlTargets[0].getRestat());
+
+    std::string invalid = createTestFile("invalid.yaml", "targets:\n  - name: x\n    restat: maybe\n    command: true\n");
+    EXPECT_TRUE(parser_.parseYAML(invalid).empty());
+    ASSERT_TRUE(parser_.getLastError().has_value());
+    EXPECT_EQ(parser_.getLastError()->line, 3);
+}
+
+TEST_F(ParserTest, ParsesRemote)
+{
+    std::string yaml = createTestFile("build.yaml",
+        "targets:\n  - name: obj\n    remote: yes\n    command: cc -c a.c\n"
+        "  - name: install\n    command: cp app /usr/local/bin\n");
+    auto targets = parser_.parseYAML(yaml);
+    ASSERT_EQ(targets.size(), 2);
+    EXPECT_TRUE(targets[0].getRemote());
+    EXPECT_FALSE(targets[1].getRemote());
+
+    std::string toml = createTestFile("build.toml", "[target.obj]\nremote = true\ncommand = \"cc\"\n");
+    auto tomlTargets = parser_.parseTOML(toml);
+    ASSERT_EQ(tomlTargets.size(), 1);
+    EXPECT_TRUE(tomlTargets[0].getRemote());
+
+    std::string invalid = createTestFile("invalid.yaml", "targets:\n  - name: x\n    remote: sometimes\n    command: true\n");
+    EXPECT_TRUE(parser_.parseYAML(invalid).empty());
+    ASSERT_TRUE(parser_.getLastError().has_value());
+    EXPECT_EQ(parser_.getLastError()->message, "remote must be true or false");
+}
@@ -0,0 +1,114 @@
+#include "mimir/process_supervisor.h"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <thread>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace
+{
+    /// Fork a child that leads its own process group and sleeps
+    pid_t spawnSleeper(bool ignoreTerm)
+    {
+        const pid_t pid = ::fork();
+        if (pid == 0)
+        {
+            ::setpgid(0, 0);
+            if (ignoreTerm)
+            {
+                ::signal(SIGTERM, SIG_IGN);
+            }
+            ::sleep(30);
+            ::_exit(0);
+        }
+        ::setpgid(pid, pid);
+        return pid;
+    }
+
+    int reap(pid_t pid)
+    {
+        siginfo_t info{};
+        ::waitid(P_PID, static_cast<id_t>(pid), &info, WEXITED | WNOWAIT);
+        int status = 0;
+        ::waitpid(pid, &status, 0);
+        return status;
+    }
+}
+
+TEST(ProcessSupervisorTest, ReleaseBeforeDeadlineDoesNotKill)
+{
+    mimir::ProcessSupervisor supervisor;
+    const pid_t pid = spawnSleeper(false);
+    const auto token = supervisor.watch(pid, mimir::ProcessSupervisor::Clock::now() + std::chrono::seconds(60));
+    EXPECT_EQ(supervisor.watchedCount(), 1u);
+    EXPECT_FALSE(supervisor.release(token));
+    EXPECT_EQ(supervisor.watchedCount(), 0u);
+
+    ::kill(pid, SIGKILL);
+    reap(pid);
+}
+
+TEST(ProcessSupervisorTest, ExpiredGroupGetsSigterm)
+{
+    mimir::ProcessSupervisor supervisor;
+    const pid_t pid = spawnSleeper(false);
+    const auto start = std::chrono::steady_clock::now();
+    const auto token = supervisor.watch(pid, mimir::ProcessSupervisor::Clock::now() + std::chrono::milliseconds(100));
+
+    const int status = reap(pid);
+    EXPECT_TRUE(supervisor.release(token));
+    ASSERT_TRUE(WIFSIGNALED(status));
+    EXPECT_EQ(WTERMSIG(status), SIGTERM);
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(10));
+}
+
+TEST(ProcessSupervisorTest, EscalatesToSigkill)
+{
+    mimir::ProcessSupervisor supervisor(std::chrono::milliseconds(100));
+    const pid_t pid = spawnSleeper(true);
+    // Give the child time to install its SIG_IGN before the deadline
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    const auto token = supervisor.watch(pid, mimir::ProcessSupervisor::Clock::now() + std::chrono::milliseconds(50));
+
+    const int status = reap(pid);
+    EXPECT_TRUE(supervisor.release(token));
+    ASSERT_TRUE(WIFSIGNALED(status));
+    EXPECT_EQ(WTERMSIG(status), SIGKILL);
+}
+
+TEST(ProcessSupervisorTest, SignalAllReachesEveryGroupBeforeItsDeadline)
+{
+    mimir::ProcessSupervisor supervisor;
+    const pid_t first = spawnSleeper(false);
+    const pid_t second = spawnSleeper(false);
+    const auto deadline = mimir::ProcessSupervisor::Clock::now() + std::chrono::seconds(60);
+    const auto firstToken = supervisor.watch(first, deadline);
+    const auto secondToken = supervisor.watch(second, deadline);
+
+    EXPECT_EQ(supervisor.signalAll(SIGINT), 2u);
+    for (const pid_t pid : {first, second})
+    {
+        const int status = reap(pid);
+        ASSERT_TRUE(WIFSIGNALED(status));
+        EXPECT_EQ(WTERMSIG(status), SIGINT);
+    }
+    // An interruption is not a timeout
+    EXPECT_FALSE(supervisor.release(firstToken));
+    EXPECT_FALSE(supervisor.release(secondToken));
+}
+
+TEST(ProcessSupervisorTest, EarlierDeadlineWakesSupervisor)
+{
+    mimir::ProcessSupervisor supervisor;
+    const pid_t slow = spawnSleeper(false);
+    const pid_t fast = spawnSleeper(false);
+    const auto slowToken = supervisor.watch(slow, mimir::ProcessSupervisor::Clock::now() + std::chrono::seconds(60));
+    const auto fastToken = supervisor.watch(fast, mimir::ProcessSupervisor::Clock::now() + std::chrono::milliseconds(50));
+
+    reap(fast);
+    EXPECT_TRUE(supervisor.release(fastToken));
+    EXPECT_FALSE(supervisor.release(slowToken));
+    ::kill(slow, SIGKILL);
+    reap(slow);
+}
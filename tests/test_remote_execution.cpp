@@ -0,0 +1,302 @@
+#include "mimir/remote_execution.h"
+#include "mimir/artifact_store.h"
+#include "mimir/command_runner.h"
+#include "mimir/hasher.h"
+#include "mimir/socket_io.h"
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#ifndef _WIN32
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    const std::string TOKEN = "s3cret";
+}
+
+class RemoteExecutionTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        testDir_ = "/tmp/test_mimir_remote_" + std::to_string(::testing::UnitTest::GetInstance()->random_seed());
+        fs::remove_all(testDir_);
+        fs::create_directories(testDir_ + "/project");
+        // Remote actions name project-relative paths, so run from inside the project
+        previousDir_ = fs::current_path();
+        fs::current_path(testDir_ + "/project");
+        backend_ = std::make_shared<mimir::LocalArtifactBackend>(testDir_ + "/store");
+    }
+
+    void TearDown() override
+    {
+        stopWorker();
+        fs::current_path(previousDir_);
+        fs::remove_all(testDir_);
+    }
+
+    void startWorker()
+    {
+        mimir::RemoteWorkerOptions options;
+        options.bindAddress = "127.0.0.1";
+        options.port = 0;
+        options.workDir = testDir_ + "/worker";
+        options.maxJobs = 2;
+        options.token = TOKEN;
+        worker_ = std::make_unique<mimir::RemoteWorker>(options, backend_);
+        ASSERT_EQ(worker_->start(), std::nullopt);
+        serving_ = std::thread([this]() { worker_->serve(); });
+    }
+
+    void stopWorker()
+    {
+        if (worker_)
+        {
+            worker_->stop();
+            serving_.join();
+            worker_.reset();
+        }
+    }
+
+    mimir::RemoteEndpoint endpoint() const
+    {
+        return mimir::RemoteEndpoint{"127.0.0.1", worker_->port()};
+    }
+
+    static void writeFile(const std::string& path, const std::string& content)
+    {
+        if (fs::path(path).has_parent_path())
+        {
+            fs::create_directories(fs::path(path).parent_path());
+        }
+        std::ofstream file(path, std::ios::binary);
+        file << content;
+    }
+
+    static std::string readFile(const std::string& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        std::ostringstream contents;
+        contents << file.rdbuf();
+        return contents.str();
+    }
+
+    static mimir::CommandOptions hermetic(std::vector<std::string> inputs, std::vector<std::string> outputs)
+    {
+        mimir::CommandOptions options;
+        options.captureOutput = true;
+        options.hermetic = true;
+        options.inputs = std::move(inputs);
+        options.outputs = std::move(outputs);
+        return options;
+    }
+
+    std::string testDir_;
+    fs::path previousDir_;
+    mimir::ArtifactBackendPtr backend_;
+    std::unique_ptr<mimir::RemoteWorker> worker_;
+    std::thread serving_;
+};
+
+TEST_F(RemoteExecutionTest, ParsesEndpoints)
+{
+    const auto plain = mimir::RemoteEndpoint::parse("build1");
+    ASSERT_TRUE(plain.has_value());
+    EXPECT_EQ(plain->host, "build1");
+    EXPECT_EQ(plain->port, mimir::RemoteEndpoint::DEFAULT_PORT);
+
+    const auto list = mimir::RemoteEndpoint::parseList("build1,10.0.0.2:7500");
+    ASSERT_TRUE(list.has_value());
+    ASSERT_EQ(list->size(), 2u);
+    EXPECT_EQ((*list)[1].describe(), "10.0.0.2:7500");
+
+    EXPECT_FALSE(mimir::RemoteEndpoint::parse("build1:0").has_value());
+    EXPECT_FALSE(mimir::RemoteEndpoint::parse(":7500").has_value());
+    EXPECT_FALSE(mimir::RemoteEndpoint::parseList("build1,,build2").has_value());
+}
+
+TEST_F(RemoteExecutionTest, OnlyHermeticProjectPathsAreShippable)
+{
+    EXPECT_TRUE(mimir::RemoteCommandRunner::isShippable(hermetic({"src/a.c", "./include/a.h"}, {"build/a.o"})));
+    EXPECT_FALSE(mimir::RemoteCommandRunner::isShippable(hermetic({"/usr/include/stdio.h"}, {"a.o"})));
+    EXPECT_FALSE(mimir::RemoteCommandRunner::isShippable(hermetic({"src/../../secret"}, {"a.o"})));
+    EXPECT_FALSE(mimir::RemoteCommandRunner::isShippable(hermetic({"a.c"}, {"."})));
+
+    mimir::CommandOptions local = hermetic({"a.c"}, {"a.o"});
+    local.hermetic = false;
+    EXPECT_FALSE(mimir::RemoteCommandRunner::isShippable(local));
+    local.hermetic = true;
+    local.workingDir = "sub";
+    EXPECT_FALSE(mimir::RemoteCommandRunner::isShippable(local));
+}
+
+TEST_F(RemoteExecutionTest, RunsOnWorkerAndStreamsOutputsBack)
+{
+    startWorker();
+    writeFile("src/in.txt", "hello\n");
+    auto local = std::make_shared<mimir::MockCommandRunner>();
+    mimir::RemoteCommandRunner runner({endpoint()}, backend_, TOKEN, local);
+
+    const auto result = runner.run("mkdir -p out && tr a-z A-Z < src/in.txt > out/up.txt && echo done",
+        hermetic({"src/in.txt"}, {"out/up.txt", "out/never.txt"}));
+    EXPECT_TRUE(result.success());
+    EXPECT_EQ(result.stdOut, "done\n");
+    EXPECT_EQ(readFile("out/up.txt"), "HELLO\n");
+    EXPECT_FALSE(fs::exists("out/never.txt"));
+    EXPECT_EQ(local->getCommandCount(), 0u);
+    EXPECT_EQ(worker_->actionsRun(), 1u);
+
+    const auto stats = runner.getStats();
+    EXPECT_EQ(stats.remoteRuns, 1u);
+    EXPECT_EQ(stats.blobsUploaded, 1u);
+    EXPECT_GT(stats.bytesDownloaded, 0u);
+    const std::string digest = mimir::Hasher::hashHex(mimir::HashAlgorithm::SHA256, "hello\n");
+    EXPECT_TRUE(backend_->contains("cas/" + digest));
+
+    // The worker's sandbox is gone; only its blob cache remains
+    EXPECT_TRUE(fs::is_empty(testDir_ + "/worker/actions"));
+}
+
+TEST_F(RemoteExecutionTest, ReusesBlobsTheStoreAlreadyHas)
+{
+    startWorker();
+    writeFile("a.txt", "shared input");
+    mimir::ArtifactStore store(backend_);
+    store.storeAsync("signature", {"a.txt"});
+    store.waitForUploads();
+
+    mimir::RemoteCommandRunner runner({endpoint()}, backend_, TOKEN);
+    EXPECT_TRUE(runner.run("cp a.txt b.txt", hermetic({"a.txt"}, {"b.txt"})).success());
+    EXPECT_TRUE(runner.run("cp a.txt c.txt", hermetic({"a.txt"}, {"c.txt"})).success());
+    EXPECT_EQ(readFile("c.txt"), "shared input");
+
+    const auto stats = runner.getStats();
+    EXPECT_EQ(stats.remoteRuns, 2u);
+    EXPECT_EQ(stats.blobsUploaded, 0u);
+    EXPECT_EQ(stats.blobsReused, 1u);
+}
+
+TEST_F(RemoteExecutionTest, ReportsFailuresAndKeepsExecutableBits)
+{
+    startWorker();
+    writeFile("tool.sh", "#!/bin/sh\necho \"$1\" > \"$2\"\nexit 3\n");
+    fs::permissions("tool.sh", fs::perms::owner_all, fs::perm_options::add);
+    mimir::RemoteCommandRunner runner({endpoint()}, backend_, TOKEN);
+
+    const auto result = runner.run("./tool.sh hi out.txt", hermetic({"tool.sh"}, {"out.txt"}));
+    EXPECT_EQ(result.exitCode, 3);
+    EXPECT_EQ(readFile("out.txt"), "hi\n");
+    EXPECT_EQ(runner.getStats().remoteRuns, 1u);
+}
+
+TEST_F(RemoteExecutionTest, KeepsOtherCommandsLocal)
+{
+    auto local = std::make_shared<mimir::MockCommandRunner>();
+    mimir::RemoteCommandRunner runner({mimir::RemoteEndpoint{"127.0.0.1", 1}}, backend_, TOKEN, local);
+
+    mimir::CommandOptions options;
+    EXPECT_TRUE(runner.run("make install", options).success());
+    EXPECT_TRUE(runner.run("cc /abs/a.c", hermetic({"/abs/a.c"}, {"a.o"})).success());
+    EXPECT_EQ(local->getCommandCount(), 2u);
+    EXPECT_EQ(runner.getStats().localRuns, 2u);
+}
+
+TEST_F(RemoteExecutionTest, FallsBackToLocalWhenNoWorkerAnswers)
+{
+    // Nothing listens on a port we just bound and released
+    startWorker();
+    const mimir::RemoteEndpoint gone = endpoint();
+    stopWorker();
+
+    writeFile("a.c", "int a;");
+    auto local = std::make_shared<mimir::MockCommandRunner>();
+    mimir::RemoteCommandRunner runner({gone}, backend_, TOKEN, local);
+    EXPECT_TRUE(runner.run("cc -c a.c", hermetic({"a.c"}, {"a.o"})).success());
+    EXPECT_EQ(local->getLastCommand(), "cc -c a.c");
+    EXPECT_EQ(runner.getStats().fallbacks, 1u);
+
+    // The failed worker is skipped for a while instead of being retried every time
+    EXPECT_TRUE(runner.run("cc -c a.c", hermetic({"a.c"}, {"a.o"})).success());
+    EXPECT_EQ(runner.getStats().fallbacks, 2u);
+    EXPECT_EQ(local->getCommandCount(), 2u);
+}
+
+TEST_F(RemoteExecutionTest, FallsBackWhenAnInputIsUnreadable)
+{
+    startWorker();
+    auto local = std::make_shared<mimir::MockCommandRunner>();
+    mimir::RemoteCommandRunner runner({endpoint()}, backend_, TOKEN, local);
+    EXPECT_TRUE(runner.run("cc -c missing.c", hermetic({"missing.c"}, {"missing.o"})).success());
+    EXPECT_EQ(local->getCommandCount(), 1u);
+    EXPECT_EQ(runner.getStats().fallbacks, 1u);
+    EXPECT_EQ(worker_->actionsRun(), 0u);
+}
+
+TEST_F(RemoteExecutionTest, WorkerNeedsATokenAndDefaultsToLoopback)
+{
+    mimir::RemoteWorkerOptions options;
+    EXPECT_EQ(options.bindAddress, "127.0.0.1");
+    options.port = 0;
+    options.workDir = testDir_ + "/worker";
+    mimir::RemoteWorker worker(options, backend_);
+    EXPECT_NE(worker.start(), std::nullopt);
+}
+
+TEST_F(RemoteExecutionTest, RejectsClientsWithTheWrongToken)
+{
+    startWorker();
+    writeFile("a.txt", "x");
+    auto local = std::make_shared<mimir::MockCommandRunner>();
+    mimir::RemoteCommandRunner runner({endpoint()}, backend_, "guess", local);
+    EXPECT_TRUE(runner.run("cp a.txt b.txt", hermetic({"a.txt"}, {"b.txt"})).success());
+    EXPECT_EQ(local->getCommandCount(), 1u);
+    EXPECT_EQ(runner.getStats().fallbacks, 1u);
+    EXPECT_EQ(worker_->actionsRun(), 0u);
+    EXPECT_FALSE(fs::exists("b.txt"));
+}
+
+#ifndef _WIN32
+TEST_F(RemoteExecutionTest, RefusesOversizedFramesWithoutBufferingThem)
+{
+    startWorker();
+    const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    ASSERT_GE(fd, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(worker_->port());
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    ASSERT_EQ(::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)), 0);
+
+    // Announces a 4 GB command but sends none of it; the worker must answer at once
+    const std::string request = "A " + std::to_string(TOKEN.size()) + "\n" + TOKEN + "C 4000000000\n";
+    ASSERT_EQ(::send(fd, request.data(), request.size(), 0), static_cast<ssize_t>(request.size()));
+    mimir::SocketReader reader(fd, 5000);
+    std::string reply;
+    EXPECT_TRUE(reader.readLine(reply));
+    EXPECT_EQ(reply, "R malformed request");
+    ::close(fd);
+    EXPECT_EQ(worker_->actionsRun(), 0u);
+}
+#endif
+
+TEST_F(RemoteExecutionTest, ForwardsTheCaptureLimitAndDroppedBytes)
+{
+    startWorker();
+    writeFile("a.txt", "x");
+    mimir::RemoteCommandRunner runner({endpoint()}, backend_, TOKEN);
+    mimir::CommandOptions options = hermetic({"a.txt"}, {"b.txt"});
+    options.maxCaptureBytes = 4;
+
+    const auto result = runner.run("printf abcdefgh", options);
+    EXPECT_EQ(runner.getStats().remoteRuns, 1u);
+    EXPECT_EQ(result.droppedBytes, 4u);
+    EXPECT_NE(result.stdOut.find("efgh"), std::string::npos);
+}
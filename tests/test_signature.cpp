@@ -159,3 +159,89 @@ TEST_F(SignatureTest, ComputeTargetSignatureMultipleInputs)
     
     fs::remove(testFile2);
 }
+
+TEST_F(SignatureTest, FileSignatureIsSha256OfContents)
+{
+    std::ofstream file(testFile_, std::ios::binary);
+    file << "abc";
+    file.close();
+
+    EXPECT_EQ(mimir::Signature::computeFileSignature(testFile_),
+              "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+}
+
+TEST_F(SignatureTest, FileSignatureStreamsLargeFiles)
+{
+    const std::string content(300 * 1024 + 17, 'x');
+    std::ofstream file(testFile_, std::ios::binary);
+    file << content;
+    file.close();
+
+    EXPECT_EQ(mimir::Signature::computeFileSignature(testFile_),
+              mimir::Hasher::hashHex(mimir::HashAlgorithm::SHA256, content));
+}
+
+TEST_F(SignatureTest, TargetSignatureMatchesCombinedString)
+{
+    std::ofstream file(testFile_);
+    file << "content";
+    file.close();
+
+    const std::string command = "gcc -c a.c";
+    const std::string combined = command + "|" + mimir::Signature::computeFileSignature(testFile_);
+    EXPECT_EQ(mimir::Signature::computeTargetSignature(command, {testFile_}),
+              mimir::Signature::computeCommandSignature(combined));
+}
+
+TEST_F(SignatureTest, AlgorithmSelection)
+{
+    EXPECT_EQ(mimir::Signature::getAlgorithm(), mimir::HashAlgorithm::SHA256);
+    const std::string sha = mimir::Signature::computeCommandSignature("abc");
+
+    mimir::Signature::setAlgorithm(mimir::HashAlgorithm::BLAKE3);
+    const std::string blake = mimir::Signature::computeCommandSignature("abc");
+    mimir::Signature::setAlgorithm(mimir::HashAlgorithm::SHA256);
+
+    EXPECT_EQ(blake, "6437b3ac38465133ffb63b75273a8db548c558465d79db03fd359c6cd5bd9d85");
+    EXPECT_NE(sha, blake);
+}
+
+TEST_F(SignatureTest, FileSignatureMappedAndReadPathsAgree)
+{
+    // Sizes either side of the mmap threshold must hash exactly like the bytes themselves
+    for (const size_t size : {size_t{0}, size_t{255 * 1024}, size_t{256 * 1024}, size_t{2 * 1024 * 1024 + 3}})
+    {
+        std::string content(size, '\0');
+        for (size_t i = 0; i < size; ++i)
+        {
+            content[i] = static_cast<char>(i * 31 % 253);
+        }
+        std::ofstream file(testFile_, std::ios::binary | std::ios::trunc);
+        file << content;
+        file.close();
+
+        EXPECT_EQ(mimir::Signature::computeFileSignature(testFile_),
+                  mimir::Hasher::hashHex(mimir::HashAlgorithm::SHA256, content)) << "size " << size;
+    }
+}
+
+TEST_F(SignatureTest, FileSignatureOfDirectoryIsEmpty)
+{
+    EXPECT_TRUE(mimir::Signature::computeFileSignature("/tmp").empty());
+}
+
+TEST_F(SignatureTest, FileSignatureReadsSizelessFilesUntilEof)
+{
+    // /proc files are regular but report a size of 0, so the size can't bound the read
+    const std::string path = "/proc/self/cmdline";
+    if (!fs::exists(path))
+    {
+        GTEST_SKIP() << "no /proc";
+    }
+    std::ifstream file(path, std::ios::binary);
+    const std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    ASSERT_FALSE(content.empty());
+
+    EXPECT_EQ(mimir::Signature::computeFileSignature(path),
+              mimir::Hasher::hashHex(mimir::HashAlgorithm::SHA256, content));
+}
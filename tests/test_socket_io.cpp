@@ -0,0 +1,66 @@
+#include "mimir/socket_io.h"
+#include <gtest/gtest.h>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <unistd.h>
+
+class SocketIOTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds_), 0);
+    }
+
+    void TearDown() override
+    {
+        ::close(fds_[0]);
+        ::close(fds_[1]);
+    }
+
+    int fds_[2] = {-1, -1};
+};
+
+TEST_F(SocketIOTest, ReadsLinesAndBlocks)
+{
+    ASSERT_TRUE(mimir::sendAll(fds_[0], "first\nabcdefsecond\n"));
+    mimir::SocketReader reader(fds_[1], 1000);
+    std::string data;
+    EXPECT_TRUE(reader.readLine(data));
+    EXPECT_EQ(data, "first");
+    EXPECT_TRUE(reader.readExact(6, data));
+    EXPECT_EQ(data, "abcdef");
+    EXPECT_TRUE(reader.readLine(data));
+    EXPECT_EQ(data, "second");
+    EXPECT_EQ(reader.consumed(), 19u);
+}
+
+TEST_F(SocketIOTest, TimesOutWhenThePeerIsSilent)
+{
+    mimir::SocketReader reader(fds_[1], 10);
+    std::string data;
+    EXPECT_FALSE(reader.readLine(data));
+}
+
+TEST_F(SocketIOTest, RefusesReadsPastTheByteLimit)
+{
+    ASSERT_TRUE(mimir::sendAll(fds_[0], "0123456789"));
+    mimir::SocketReader reader(fds_[1], 1000, 8);
+    std::string data;
+    // Refused up front, without waiting for bytes the peer may never send
+    EXPECT_FALSE(reader.readExact(1000000000, data));
+    EXPECT_TRUE(reader.readExact(5, data));
+    EXPECT_FALSE(reader.readExact(4, data));
+    EXPECT_TRUE(reader.readExact(3, data));
+    EXPECT_EQ(data, "567");
+}
+
+TEST_F(SocketIOTest, RefusesLinesPastTheByteLimit)
+{
+    ASSERT_TRUE(mimir::sendAll(fds_[0], std::string(64, 'x') + "\n"));
+    mimir::SocketReader reader(fds_[1], 1000, 16);
+    std::string data;
+    EXPECT_FALSE(reader.readLine(data));
+}
+#endif
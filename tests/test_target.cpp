@@ -254,3 +254,15 @@ TEST_F(TargetTest, MixedAccessorAndPublicMember)
     EXPECT_EQ(target.getInputs().size(), 1u);
 }
 
+
+TEST_F(TargetTest, PoolAndWeightDefaults)
+{
+    mimir::Target target("link");
+    EXPECT_TRUE(target.getPool().empty());
+    EXPECT_EQ(target.getWeight(), 1u);
+
+    target.setPool("link_pool");
+    target.setWeight(4);
+    EXPECT_EQ(target.getPool(), "link_pool");
+    EXPECT_EQ(target.getWeight(), 4u);
+}
@@ -0,0 +1,58 @@
+#include "mimir/thread_pool.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+TEST(ThreadPoolTest, ReturnsResults)
+{
+    mimir::ThreadPool pool(4);
+    std::vector<std::future<int>> results;
+    for (int i = 0; i < 100; ++i)
+    {
+        results.push_back(pool.submit([i]() { return i * i; }));
+    }
+    for (int i = 0; i < 100; ++i)
+    {
+        EXPECT_EQ(results[i].get(), i * i);
+    }
+}
+
+TEST(ThreadPoolTest, ForwardsExceptions)
+{
+    mimir::ThreadPool pool(2);
+    auto future = pool.submit([]() -> int { throw std::runtime_error("boom"); });
+    EXPECT_THROW(future.get(), std::runtime_error);
+}
+
+TEST(ThreadPoolTest, WaitDrainsQueue)
+{
+    mimir::ThreadPool pool(3);
+    std::atomic<int> counter{0};
+    for (int i = 0; i < 500; ++i)
+    {
+        pool.submit([&counter]() { ++counter; });
+    }
+    pool.wait();
+    EXPECT_EQ(counter.load(), 500);
+}
+
+TEST(ThreadPoolTest, DestructorRunsQueuedTasks)
+{
+    std::atomic<int> counter{0};
+    {
+        mimir::ThreadPool pool(1);
+        for (int i = 0; i < 50; ++i)
+        {
+            pool.submit([&counter]() { ++counter; });
+        }
+    }
+    EXPECT_EQ(counter.load(), 50);
+}
+
+TEST(ThreadPoolTest, ZeroThreadsStartsOne)
+{
+    mimir::ThreadPool pool(0);
+    EXPECT_EQ(pool.threadCount(), 1u);
+    EXPECT_EQ(pool.submit([]() { return 7; }).get(), 7);
+}